@@ -40,6 +40,7 @@ THE SOFTWARE.
 #include <cmath>
 #include <cstring>
 #include <cstdlib>
+#include <algorithm>
 
 #include <iostream>
 #include <fstream>
@@ -1178,6 +1179,19 @@ void OGE_RegisterScriptFunctions(CogeScripter* pScripter, const std::string& sFu
     if(flags[i++]<'1') pScripter->RegisterFunction((void*)OGE_GetStrFieldValue, "string OGE_GetStrFieldValue(int, string &in)");
     if(flags[i++]<'1') pScripter->RegisterFunction((void*)OGE_GetTimeFieldValue, "string OGE_GetTimeFieldValue(int, string &in)");
 
+    if(flags[i++]<'1') pScripter->RegisterFunction((void*)OGE_GetPaletteColor, "int OGE_GetPaletteColor(int, int)");
+    if(flags[i++]<'1') pScripter->RegisterFunction((void*)OGE_SetPaletteColor, "bool OGE_SetPaletteColor(int, int, int)");
+    if(flags[i++]<'1') pScripter->RegisterFunction((void*)OGE_FindPaletteColor, "int OGE_FindPaletteColor(int, int)");
+    if(flags[i++]<'1') pScripter->RegisterFunction((void*)OGE_ResetPalette, "void OGE_ResetPalette(int)");
+
+    if(flags[i++]<'1') pScripter->RegisterFunction((void*)OGE_SetScrollReuseMode, "void OGE_SetScrollReuseMode(bool)");
+    if(flags[i++]<'1') pScripter->RegisterFunction((void*)OGE_GetUploadBytes, "int OGE_GetUploadBytes()");
+    if(flags[i++]<'1') pScripter->RegisterFunction((void*)OGE_SetDirectScreen, "void OGE_SetDirectScreen(bool)");
+    if(flags[i++]<'1') pScripter->RegisterFunction((void*)OGE_SetPresentThread, "void OGE_SetPresentThread(bool)");
+    if(flags[i++]<'1') pScripter->RegisterFunction((void*)OGE_LockUPS, "void OGE_LockUPS(int)");
+    if(flags[i++]<'1') pScripter->RegisterFunction((void*)OGE_GetLockedUPS, "int OGE_GetLockedUPS()");
+    if(flags[i++]<'1') pScripter->RegisterFunction((void*)OGE_GetFrameAlpha, "double OGE_GetFrameAlpha()");
+
 
 
 
@@ -1187,6 +1201,8 @@ void OGE_RegisterScriptFunctions(CogeScripter* pScripter, const std::string& sFu
 
 #ifdef __OGE_AS_TOOL__
 
+#include "SDL_image.h"
+
 int OGE_HandleInputScript(const std::string& sInputConfigFile)
 {
     if(!g_script) return -1;
@@ -1347,6 +1363,248 @@ int OGE_HandleInputScript(const std::string& sInputConfigFile)
     return 0;
 }
 
+struct CogeAtlasEntry
+{
+    std::string sName;
+    SDL_Surface* pImage;
+    int iSheet;
+    int iPosX;
+    int iPosY;
+};
+
+static bool OGE_CompareAtlasEntry(const CogeAtlasEntry& a, const CogeAtlasEntry& b)
+{
+    if(a.pImage->h != b.pImage->h) return a.pImage->h > b.pImage->h;
+    return a.pImage->w > b.pImage->w;
+}
+
+/* packs the images marked with "Atlas=1" in an image config into a few large sheets (shelf by shelf, the tallest first),
+   adds the sheets to the files to pack and saves a copy of the image config in which those images become
+   rects (AtlasX, AtlasY) of the sheets, so the engine loads each sheet once and shares it among the images
+*/
+static int OGE_BuildImageAtlas(CogeIniFile& ini, const std::string& sCurrentPath, std::map<std::string, std::string>& files)
+{
+    if(ini.ReadString("Atlas", "ImageConfig", "").length() == 0) return 0;
+
+    std::string sImageConfig = ini.ReadPath("Atlas", "ImageConfig", "");
+
+    if(ini.ReadString("Atlas", "OutputConfig", "").length() == 0)
+    {
+        printf("Fail to get output image config for atlas in config file \n");
+        return -1;
+    }
+
+    std::string sOutputConfig = ini.ReadPath("Atlas", "OutputConfig", "");
+    std::string sConfigName = ini.ReadString("Atlas", "ConfigName", "");
+    std::string sSheetName = ini.ReadString("Atlas", "SheetName", "atlas");
+    std::string sSheetFolder = ini.ReadPath("Atlas", "SheetFolder", "");
+    std::string sFilePath = ini.ReadString("Atlas", "FilePath", "");
+
+    int iSheetSize = ini.ReadInteger("Atlas", "SheetSize", 1024);
+    int iMaxImageSize = ini.ReadInteger("Atlas", "MaxImageSize", 256);
+
+    if(sSheetFolder.length() > 0 && sSheetFolder[sSheetFolder.length()-1] != '/') sSheetFolder = sSheetFolder + "/";
+
+    CogeIniFile images;
+    if(!images.Load(sImageConfig))
+    {
+        printf("Fail to load image config file: %s \n", sImageConfig.c_str());
+        return -1;
+    }
+
+    images.SetCurrentPath(sCurrentPath);
+
+    int iSheetCount = 0;
+    int iPackedCount = 0;
+
+    // the images with alpha channel and the ones without go to different sheets
+    for(int iAlpha=0; iAlpha<=1; iAlpha++)
+    {
+        std::vector<CogeAtlasEntry> entries;
+
+        int iImageCount = images.GetSectionCount();
+
+        for(int i=0; i<iImageCount; i++)
+        {
+            std::string sName = images.GetSectionNameByIndex(i);
+
+            if(images.ReadInteger(sName, "Atlas", 0) == 0) continue;
+            if((images.ReadInteger(sName, "AlphaChannel", 0) != 0) != (iAlpha != 0)) continue;
+
+            std::string sFileName = images.ReadFilePath(sName, "File", "");
+            if(sFileName.length() == 0) continue;
+
+#ifndef __OGE_WITH_SDL2__
+            if(iAlpha)
+            {
+                printf("Skipped image with alpha channel (png sheet needs SDL2): %s \n", sName.c_str());
+                continue;
+            }
+#endif
+
+            SDL_Surface* pImage = IMG_Load(sFileName.c_str());
+            if(pImage == NULL)
+            {
+                printf("Fail to load image file: %s \n", sFileName.c_str());
+                continue;
+            }
+
+            if(pImage->w > iMaxImageSize || pImage->h > iMaxImageSize
+               || pImage->w > iSheetSize || pImage->h > iSheetSize)
+            {
+                SDL_FreeSurface(pImage);
+                continue;
+            }
+
+            CogeAtlasEntry entry;
+            entry.sName = sName;
+            entry.pImage = pImage;
+            entry.iSheet = -1;
+            entry.iPosX = 0;
+            entry.iPosY = 0;
+
+            entries.push_back(entry);
+        }
+
+        if(entries.size() == 0) continue;
+
+        std::sort(entries.begin(), entries.end(), OGE_CompareAtlasEntry);
+
+        std::vector<int> heights;
+
+        int iSheet = -1;
+        int iShelfX = 0;
+        int iShelfY = 0;
+        int iShelfHeight = 0;
+
+        for(size_t i=0; i<entries.size(); i++)
+        {
+            int w = entries[i].pImage->w;
+            int h = entries[i].pImage->h;
+
+            if(iShelfX + w > iSheetSize)
+            {
+                // next shelf
+                iShelfY += iShelfHeight;
+                iShelfX = 0;
+                iShelfHeight = 0;
+            }
+
+            if(iSheet < 0 || iShelfY + h > iSheetSize)
+            {
+                // next sheet
+                iSheet = heights.size();
+                heights.push_back(0);
+                iShelfX = 0;
+                iShelfY = 0;
+                iShelfHeight = 0;
+            }
+
+            entries[i].iSheet = iSheet;
+            entries[i].iPosX = iShelfX;
+            entries[i].iPosY = iShelfY;
+
+            iShelfX += w;
+            if(h > iShelfHeight) iShelfHeight = h;
+            if(iShelfY + h > heights[iSheet]) heights[iSheet] = iShelfY + h;
+        }
+
+        for(int s=0; s<(int)heights.size(); s++)
+        {
+            SDL_Surface* pSheet = SDL_CreateRGBSurface(SDL_SWSURFACE, iSheetSize, heights[s], 32,
+                                                       0x00ff0000, 0x0000ff00, 0x000000ff,
+                                                       iAlpha ? 0xff000000 : 0);
+            if(pSheet == NULL) continue;
+
+            for(size_t i=0; i<entries.size(); i++)
+            {
+                if(entries[i].iSheet != s) continue;
+
+                // copy the pixels as they are (the color key is applied by the engine)
+                SDL_Surface* pImage = entries[i].pImage;
+#ifdef __OGE_WITH_SDL2__
+                SDL_SetColorKey(pImage, SDL_FALSE, 0);
+                SDL_SetSurfaceBlendMode(pImage, SDL_BLENDMODE_NONE);
+#else
+                SDL_SetColorKey(pImage, 0, 0);
+                SDL_SetAlpha(pImage, 0, 255);
+#endif
+
+                SDL_Rect dst;
+                dst.x = entries[i].iPosX;
+                dst.y = entries[i].iPosY;
+                dst.w = pImage->w;
+                dst.h = pImage->h;
+
+                SDL_BlitSurface(pImage, NULL, pSheet, &dst);
+            }
+
+            iSheetCount++;
+
+            std::string sBlockName = sSheetName + OGE_itoa(iSheetCount) + (iAlpha ? ".png" : ".bmp");
+            std::string sSheetFile = sSheetFolder + sBlockName;
+
+            int iResult = -1;
+#ifdef __OGE_WITH_SDL2__
+            if(iAlpha) iResult = IMG_SavePNG(pSheet, sSheetFile.c_str());
+            else iResult = SDL_SaveBMP(pSheet, sSheetFile.c_str());
+#else
+            iResult = SDL_SaveBMP(pSheet, sSheetFile.c_str());
+#endif
+
+            SDL_FreeSurface(pSheet);
+
+            if(iResult != 0)
+            {
+                printf("Fail to save atlas sheet: %s \n", sSheetFile.c_str());
+                continue;
+            }
+
+            files.insert(std::map<std::string, std::string>::value_type(sSheetFile, sBlockName));
+
+            for(size_t i=0; i<entries.size(); i++)
+            {
+                if(entries[i].iSheet != s) continue;
+
+                images.WriteString(entries[i].sName, "File", sFilePath + sBlockName);
+                images.WriteInteger(entries[i].sName, "Width", entries[i].pImage->w);
+                images.WriteInteger(entries[i].sName, "Height", entries[i].pImage->h);
+                images.WriteInteger(entries[i].sName, "AtlasX", entries[i].iPosX);
+                images.WriteInteger(entries[i].sName, "AtlasY", entries[i].iPosY);
+
+                iPackedCount++;
+            }
+
+            printf("Saved atlas sheet: %s \n", sSheetFile.c_str());
+        }
+
+        for(size_t i=0; i<entries.size(); i++) SDL_FreeSurface(entries[i].pImage);
+    }
+
+    if(!images.Save(sOutputConfig))
+    {
+        printf("Fail to save image config file: %s \n", sOutputConfig.c_str());
+        return -1;
+    }
+
+    if(sConfigName.length() > 0)
+    {
+        // the rewritten config takes the place of the original one in the pack
+        std::map<std::string, std::string>::iterator it = files.begin();
+        while(it != files.end())
+        {
+            if(it->second.compare(sConfigName) == 0) files.erase(it++);
+            else it++;
+        }
+
+        files.insert(std::map<std::string, std::string>::value_type(sOutputConfig, sConfigName));
+    }
+
+    printf("Packed %d images into %d atlas sheets \n", iPackedCount, iSheetCount);
+
+    return iPackedCount;
+}
+
 int OGE_PackInputFiles(const std::string& sInputConfigFile)
 {
     CogeIniFile ini;
@@ -1405,6 +1663,9 @@ int OGE_PackInputFiles(const std::string& sInputConfigFile)
 
         }
 
+        std::string sWorkPath = sCurrentPath.length() > 0 ? sCurrentPath : OGE_GetAppMainDir();
+        if(OGE_BuildImageAtlas(ini, sWorkPath, files) < 0) return -1;
+
         if(files.size() > 0)
         {
             CogeBufferManager* memory = new CogeBufferManager();
@@ -1966,6 +2227,10 @@ int  OGE_GetFPS()
 {
     return g_engine->GetVideo()->GetFPS();
 }
+int  OGE_GetUploadBytes()
+{
+    return g_engine->GetVideo()->GetUploadBytes();
+}
 int  OGE_GetLockedFPS()
 {
     return g_engine->GetVideo()->GetLockedFPS();
@@ -1997,12 +2262,38 @@ int  OGE_GetLockedCPS()
     return g_engine->GetLockedCPS();
 }
 
+void OGE_LockUPS(int iUPS)
+{
+    g_engine->LockUPS(iUPS);
+}
+int  OGE_GetLockedUPS()
+{
+    return g_engine->GetLockedUPS();
+}
+double OGE_GetFrameAlpha()
+{
+    return g_engine->GetFrameAlpha();
+}
+
 void OGE_SetDirtyRectMode(bool bValue)
 {
     //if(g_engine)
     g_engine->SetDirtyRectMode(bValue);
 }
 
+void OGE_SetScrollReuseMode(bool bValue)
+{
+    g_engine->SetScrollReuseMode(bValue);
+}
+void OGE_SetDirectScreen(bool bValue)
+{
+    g_engine->GetVideo()->SetDirectScreen(bValue);
+}
+void OGE_SetPresentThread(bool bValue)
+{
+    g_engine->GetVideo()->SetPresentThread(bValue);
+}
+
 void OGE_FreezeSprites(bool bValue)
 {
     g_engine->SetFreeze(bValue);
@@ -3631,6 +3922,23 @@ void OGE_SetColorKey(int iImageId, int iColor)
     ((CogeImage*)iImageId)->SetColorKey(iColor);
 }
 
+int  OGE_GetPaletteColor(int iImageId, int iIndex)
+{
+    return ((CogeImage*)iImageId)->GetPaletteColor(iIndex);
+}
+bool OGE_SetPaletteColor(int iImageId, int iIndex, int iColor)
+{
+    return ((CogeImage*)iImageId)->SetPaletteColor(iIndex, iColor);
+}
+int  OGE_FindPaletteColor(int iImageId, int iColor)
+{
+    return ((CogeImage*)iImageId)->FindPaletteColor(iColor);
+}
+void OGE_ResetPalette(int iImageId)
+{
+    ((CogeImage*)iImageId)->ResetPalette();
+}
+
 int  OGE_GetPenColor(int iImageId)
 {
     return ((CogeImage*)iImageId)->GetPenColor();
@@ -109,6 +109,11 @@ const std::string& OGE_GetImageName(int iImageId);
 int  OGE_GetColorKey(int iImageId);
 void OGE_SetColorKey(int iImageId, int iColor);
 
+int  OGE_GetPaletteColor(int iImageId, int iIndex);
+bool OGE_SetPaletteColor(int iImageId, int iIndex, int iColor);
+int  OGE_FindPaletteColor(int iImageId, int iColor);
+void OGE_ResetPalette(int iImageId);
+
 int  OGE_GetPenColor(int iImageId);
 void OGE_SetPenColor(int iImageId, int iColor);
 
@@ -182,6 +187,7 @@ void OGE_LockFPS(int iFPS);
 //bool OGE_IsFPSLocked();
 int  OGE_GetFPS();
 int  OGE_GetLockedFPS();
+int  OGE_GetUploadBytes();
 
 void OGE_LockCPS(int iCPS);
 //void OGE_UnlockCPS();
@@ -189,10 +195,17 @@ void OGE_LockCPS(int iCPS);
 int  OGE_GetCPS();
 int  OGE_GetLockedCPS();
 
+void OGE_LockUPS(int iUPS);
+int  OGE_GetLockedUPS();
+double OGE_GetFrameAlpha();
+
 void OGE_ShowMousePos(bool bShow);
 //void OGE_HideMousePos();
 
 void OGE_SetDirtyRectMode(bool bValue);
+void OGE_SetScrollReuseMode(bool bValue);
+void OGE_SetDirectScreen(bool bValue);
+void OGE_SetPresentThread(bool bValue);
 
 void OGE_Scroll(int iIncX, int iIncY);
 void OGE_SetViewPos(int iLeft, int iTop);
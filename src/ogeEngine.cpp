@@ -31,6 +31,7 @@ THE SOFTWARE.
 #include "ogeAppParam.h"
 #include "ogeCommon.h"
 #include "ogeIniFile.h"
+#include "ogeGraphicFX.h"
 
 #include "clay.h"
 #include "clay_plugin.h"
@@ -43,6 +44,7 @@ THE SOFTWARE.
 
 #define _OGE_INVALID_POS_             -999999
 #define _OGE_DEFAULT_CPS_             30
+#define _OGE_MAX_CATCH_UP_STEPS_      5
 
 #if SDL_VERSION_ATLEAST(2,0,0)
 #define OGE_DEFAULT_REPEAT_DELAY      500
@@ -335,11 +337,23 @@ m_iState(-1)
     m_iCycleCount    = 0;
 	m_iGlobalTime    = 0;
 
+	m_iLastCycleCounter = 0;
+	m_iCycleTicks       = 0;
+	m_iIntervalRest     = 0;
+	m_iLockedUPS        = 0;
+	m_iStepTicks        = 0;
+	m_iStepTime         = 0;
+	m_iDrawInterval     = 0;
+	m_dFrameAlpha       = 0;
+
     m_bShowVideoMode = false;
     m_bShowFPS = false;
     m_bShowMousePos = false;
 
     m_bUseDirtyRect = false;
+    m_bUseScrollReuse = false;
+
+    m_iSpriteTileSize = 0;
 
     m_bFreeze = false;
 
@@ -449,6 +463,15 @@ m_iState(-1)
     m_iCycleCount    = 0;
 	m_iGlobalTime    = 0;
 
+	m_iLastCycleCounter = 0;
+	m_iCycleTicks       = 0;
+	m_iIntervalRest     = 0;
+	m_iLockedUPS        = 0;
+	m_iStepTicks        = 0;
+	m_iStepTime         = 0;
+	m_iDrawInterval     = 0;
+	m_dFrameAlpha       = 0;
+
     m_iVideoWidth = 0;
     m_iVideoHeight = 0;
     m_iVideoBPP = 0;
@@ -480,6 +503,9 @@ m_iState(-1)
     m_bShowMousePos = false;
 
     m_bUseDirtyRect = false;
+    m_bUseScrollReuse = false;
+
+    m_iSpriteTileSize = 0;
 
     m_bFreeze = false;
 
@@ -649,6 +675,7 @@ void CogeEngine::LockCPS(int iCPS)
 {
     m_iCycleRateWanted = iCPS;
 	m_iCycleInterval = 1000/iCPS;
+	m_iCycleTicks = OGE_GetPerfFrequency()/iCPS;
 	m_iLockedCPS = iCPS;
 }
 void CogeEngine::UnlockCPS()
@@ -668,6 +695,39 @@ int CogeEngine::GetCurrentInterval()
     return m_iCurrentInterval;
 }
 
+int CogeEngine::GetLockedUPS()
+{
+    return m_iLockedUPS;
+}
+void CogeEngine::LockUPS(int iUPS)
+{
+    if(iUPS > 0)
+    {
+        m_iStepTicks = OGE_GetPerfFrequency()/iUPS;
+        m_iLockedUPS = iUPS;
+    }
+    else m_iLockedUPS = 0;
+
+    m_iStepTime = 0;
+    m_iDrawInterval = 0;
+    m_dFrameAlpha = 0;
+}
+double CogeEngine::GetFrameAlpha()
+{
+    return m_dFrameAlpha;
+}
+
+// the ms of some ticks of the counter, the part of a ms which is left is carried to the next call
+int CogeEngine::CounterToMS(Uint64 iTicks)
+{
+    Uint64 iFrequency = OGE_GetPerfFrequency();
+    Uint64 iValue = iTicks * 1000 + m_iIntervalRest;
+
+    m_iIntervalRest = iValue % iFrequency;
+
+    return (int)(iValue / iFrequency);
+}
+
 void CogeEngine::DrawFPS(int x, int y)
 {
     if(m_pVideo) m_pVideo->DrawFPS(x, y);
@@ -1237,12 +1297,12 @@ void CogeEngine::HandleNetworkEvents()
     if(m_iState > 0 && m_pNetwork) m_pNetwork->Update();
 }
 
-void CogeEngine::UpdateActiveScene()
+void CogeEngine::UpdateActiveScene(bool bLogic, bool bDraw)
 {
     if(m_iState > 0 && m_pActiveScene)
     {
         m_pCurrentGameScene = m_pActiveScene;
-        m_pActiveScene->Update();
+        m_pActiveScene->Update(bLogic, bDraw);
     }
 }
 
@@ -1350,6 +1410,7 @@ bool CogeEngine::IsInputMethodReady()
 void CogeEngine::SetDirtyRectMode(bool bValue)
 {
     if(m_bUseDirtyRect != bValue) m_bUseDirtyRect = bValue;
+    if(!m_bUseDirtyRect) m_bUseScrollReuse = false;
     if(m_bUseDirtyRect && m_pActiveScene)
     {
         if(m_pActiveScene->m_pBackground == m_pVideo->GetDefaultBg())
@@ -1360,6 +1421,28 @@ void CogeEngine::SetDirtyRectMode(bool bValue)
     }
 }
 
+bool CogeEngine::IsScrollReuseMode()
+{
+    return m_bUseScrollReuse;
+}
+
+void CogeEngine::SetScrollReuseMode(bool bValue)
+{
+    if(bValue && !m_bUseDirtyRect) SetDirtyRectMode(true);
+    m_bUseScrollReuse = bValue;
+}
+
+int CogeEngine::GetSpriteTileSize()
+{
+    return m_iSpriteTileSize;
+}
+
+void CogeEngine::SetSpriteTileSize(int iTileSize)
+{
+    if(iTileSize <= 0) m_iSpriteTileSize = 0;
+    else m_iSpriteTileSize = iTileSize < 16 ? 16 : iTileSize;
+}
+
 void CogeEngine::UpdateScreen(int x, int y)
 {
     if (m_iState < 0) return;
@@ -1781,6 +1864,10 @@ int CogeEngine::Initialize(const std::string& sConfigFileName)
         else if(iCps < 0) UnlockCPS();
         else if(iCps == 0) LockCPS(_OGE_DEFAULT_CPS_);
 
+        int iUps = m_AppIniFile.ReadInteger("Game", "UPS", 0);
+
+        if(iUps > 0) LockUPS(iUps);
+
 #ifndef __OGE_WITH_GLWIN__
         if (m_sTitle.length() > 0) m_pVideo->SetWindowCaption(m_sTitle);
         if (sIconFile.length() > 0) m_pVideo->SetWindowIcon(sIconFile, sIconMask);
@@ -1796,10 +1883,35 @@ int CogeEngine::Initialize(const std::string& sConfigFileName)
 
         int iFps = m_AppIniFile.ReadInteger("Screen", "FPS", 0);
 
+        int iFXThreads = m_AppIniFile.ReadInteger("Screen", "FXThreads", 0);
+        int iFXThreadPixels = m_AppIniFile.ReadInteger("Screen", "FXThreadPixels", 0);
+
+        int iColorKeySpans = m_AppIniFile.ReadInteger("Screen", "ColorKeySpans", 0);
+
+        int iIndexedImages = m_AppIniFile.ReadInteger("Screen", "IndexedImages", 0);
+
+        int iPremultipliedAlpha = m_AppIniFile.ReadInteger("Screen", "PremultipliedAlpha", 0);
+
+        int iSmoothRotation = m_AppIniFile.ReadInteger("Screen", "SmoothRotation", 0);
+
+        int iSmoothScaling = m_AppIniFile.ReadInteger("Screen", "SmoothScaling", 0);
+
+        int iPresentFilter = m_AppIniFile.ReadInteger("Screen", "PresentFilter", 0);
+
+        int iDirectScreen = m_AppIniFile.ReadInteger("Screen", "DirectScreen", 0);
+
+        int iPresentThread = m_AppIniFile.ReadInteger("Screen", "PresentThread", 0);
+
+        int iFrameCacheSize = m_AppIniFile.ReadInteger("Screen", "FrameCacheSize", 0);
+
         m_bShowFPS = m_AppIniFile.ReadInteger("Screen", "ShowFPS", 0) != 0;
         m_bShowVideoMode = m_AppIniFile.ReadInteger("Screen", "ShowVideoMode", 0) != 0;
         m_bShowMousePos = m_AppIniFile.ReadInteger("Screen", "ShowMousePos", 0) != 0;
 
+        bool bScrollReuse = m_AppIniFile.ReadInteger("Screen", "ScrollReuse", 0) != 0;
+
+        SetSpriteTileSize(m_AppIniFile.ReadInteger("Screen", "SpriteTileSize", 0));
+
         m_bPackedIndex  = m_AppIniFile.ReadInteger("Pack", "Index",  0) != 0;
         m_bPackedImage  = m_AppIniFile.ReadInteger("Pack", "Image",  0) != 0;
         m_bPackedMedia  = m_AppIniFile.ReadInteger("Pack", "Media",  0) != 0;
@@ -2034,6 +2146,28 @@ int CogeEngine::Initialize(const std::string& sConfigFileName)
             if(iFps > 0) m_pVideo->LockFPS(iFps);
             else if(iFps < 0) m_pVideo->UnlockFPS();
 
+            if(iFXThreads != 0) m_pVideo->SetFXThreads(iFXThreads, iFXThreadPixels);
+
+            m_pVideo->SetColorKeySpans(iColorKeySpans);
+
+            m_pVideo->SetIndexedImages(iIndexedImages);
+
+            m_pVideo->SetPremultipliedAlpha(iPremultipliedAlpha != 0);
+
+            m_pVideo->SetSmoothRotation(iSmoothRotation != 0);
+
+            m_pVideo->SetSmoothScaling(iSmoothScaling != 0);
+
+            m_pVideo->SetPresentFilter(iPresentFilter);
+
+            m_pVideo->SetDirectScreen(iDirectScreen != 0);
+
+            m_pVideo->SetPresentThread(iPresentThread != 0);
+
+            m_pVideo->SetFrameCacheSize(iFrameCacheSize);
+
+            if(bScrollReuse) SetScrollReuseMode(true);
+
 #ifdef __OGE_WITH_GLWIN__
             if (m_sTitle.length() > 0) m_pVideo->SetWindowCaption(m_sTitle);
             if (sIconFile.length() > 0) m_pVideo->SetWindowIcon(sIconFile, sIconMask);
@@ -2393,39 +2527,43 @@ int CogeEngine::Run()
     //SDL_WarpMouse(m_iMouseX , m_iMouseY);
     m_pVideo->OGE_WarpMouse(m_iMouseX , m_iMouseY);
 
+    m_iLastCycleCounter = OGE_GetPerfCounter();
+    m_iStepTime = 0;
+
     while (m_iState > 0)
     {
-        int iCurrentTime = SDL_GetTicks();
+        if (m_iLockedUPS > 0 && m_iStepTicks > 0)
+        {
+            RunFixedSteps();
+            continue;
+        }
 
-        if (m_iLockedCPS > 0 && m_iCycleInterval > 0)
+        // the frame is shown as soon as the present thread has drawn it, not at the next draw
+        m_pVideo->PollPresent();
+
+        Uint64 iCounter = OGE_GetPerfCounter();
+
+        if (m_iLockedCPS > 0 && m_iCycleTicks > 0)
         {
-            while (iCurrentTime - m_iGlobalTime < m_iCycleInterval)
-            {
-                SDL_Delay(1);  // cool down cpu time ...
-                iCurrentTime = SDL_GetTicks();
-            }
+            // there is time to wait, so the frame can be waited for
+            if (OGE_GetPerfCounter() < m_iLastCycleCounter + m_iCycleTicks) m_pVideo->WaitPresent();
 
-            m_iCurrentInterval = iCurrentTime - m_iGlobalTime;
+            // sleeps for most of the wait and spins for the rest (the ms ticks made the cycles uneven)
+            OGE_WaitPerfCounter(m_iLastCycleCounter + m_iCycleTicks);
+            iCounter = OGE_GetPerfCounter();
+
+            m_iCurrentInterval = CounterToMS(iCounter - m_iLastCycleCounter);
 
         }
         else
         {
-            m_iCycleInterval = iCurrentTime - m_iGlobalTime;
+            m_iCycleInterval = CounterToMS(iCounter - m_iLastCycleCounter);
             m_iCurrentInterval = m_iCycleInterval;
         }
 
+        m_iLastCycleCounter = iCounter;
 
-        m_iCycleCount++;
-
-        if (iCurrentTime - m_iLastCycleTime >= 1000)
-        {
-            m_iOldCycleRate = m_iCycleRate;
-            m_iCycleRate = m_iCycleCount;
-            m_iCycleCount = 0;
-            m_iLastCycleTime = iCurrentTime;
-        }
-
-        m_iGlobalTime = iCurrentTime;
+        CountCycle();
 
         // start to update ...
 
@@ -2452,6 +2590,87 @@ int CogeEngine::Run()
     return m_iState;
 }
 
+void CogeEngine::CountCycle()
+{
+    int iCurrentTime = SDL_GetTicks();
+
+    m_iCycleCount++;
+
+    if (iCurrentTime - m_iLastCycleTime >= 1000)
+    {
+        m_iOldCycleRate = m_iCycleRate;
+        m_iCycleRate = m_iCycleCount;
+        m_iCycleCount = 0;
+        m_iLastCycleTime = iCurrentTime;
+    }
+
+    m_iGlobalTime = iCurrentTime;
+}
+
+void CogeEngine::RunFixedSteps()
+{
+    Uint64 iCounter = OGE_GetPerfCounter();
+
+    m_iStepTime += iCounter - m_iLastCycleCounter;
+    m_iLastCycleCounter = iCounter;
+
+    // too far behind (after a long load ...), the time which can not be caught up is dropped
+    if (m_iStepTime > m_iStepTicks * _OGE_MAX_CATCH_UP_STEPS_) m_iStepTime = m_iStepTicks * _OGE_MAX_CATCH_UP_STEPS_;
+
+    int iSteps = 0;
+
+    while (m_iStepTime >= m_iStepTicks && m_iState > 0 && m_iLockedUPS > 0)
+    {
+        m_iStepTime -= m_iStepTicks;
+
+        m_iCurrentInterval = CounterToMS(m_iStepTicks);
+        m_iCycleInterval = m_iCurrentInterval;
+        m_iDrawInterval += m_iCurrentInterval;
+
+        CountCycle();
+
+        HandleAppEvents();
+        UpdateMouseInput();
+
+        HandleNetworkEvents();
+
+        HandleEngineEvents();
+        UpdateActiveScene(true, false);
+
+        if (m_iState > 0 && m_iScriptState >= 0) CallEvent(Event_OnUpdate);
+
+        iSteps++;
+    }
+
+    if (m_iState <= 0 || m_iLockedUPS <= 0) return;
+
+    m_dFrameAlpha = (double)m_iStepTime / (double)m_iStepTicks;
+
+    // with a locked fps it is drawn when the frame is due (rather than drawn and dropped), else after the updates
+    Uint64 iNextFrame = m_pVideo->GetNextFrameCounter();
+
+    if (iNextFrame > 0 ? OGE_GetPerfCounter() >= iNextFrame : iSteps > 0)
+    {
+        // the drawing (the fading, the effects of the animations ...) goes on by the time which has been updated
+        m_iCurrentInterval = m_iDrawInterval;
+        m_iDrawInterval = 0;
+
+        UpdateActiveScene(false, true);
+    }
+
+    // then waits for the next update or frame
+    Uint64 iNext = m_iLastCycleCounter + (m_iStepTicks - m_iStepTime);
+
+    iNextFrame = m_pVideo->GetNextFrameCounter();
+    if (iNextFrame > 0 && iNextFrame < iNext) iNext = iNextFrame;
+
+    // the frame just drawn is shown now (not at the next draw), in the time which would be slept anyway
+    if (OGE_GetPerfCounter() < iNext) m_pVideo->WaitPresent();
+    else m_pVideo->PollPresent();
+
+    OGE_WaitPerfCounter(iNext);
+}
+
 CogeScene* CogeEngine::NewScene(const std::string& sSceneName, const std::string& sConfigFileName)
 {
     ogeSceneMap::iterator it;
@@ -4233,7 +4452,49 @@ CogeImage* CogeEngine::NewImage(const std::string& sImageName)
 
         std::string sFileName  = m_ImageIniFile.ReadFilePath(sImageName, "File", "");
 
-        if(!m_bPackedImage)
+        // a part of an atlas sheet (see the Atlas section of the pack tool)
+        int iAtlasX = m_ImageIniFile.ReadInteger(sImageName, "AtlasX", -1);
+        int iAtlasY = m_ImageIniFile.ReadInteger(sImageName, "AtlasY", -1);
+
+        if(iAtlasX >= 0 && iAtlasY >= 0 && sFileName.length() > 0)
+        {
+            SDL_Surface* pAtlas = m_pVideo->FindAtlas(sFileName);
+
+            int iPos = m_bPackedImage ? GetValidPackedFilePathLength(sFileName) : 0;
+
+            if(pAtlas == NULL && iPos == 0)
+            {
+                pAtlas = m_pVideo->LoadAtlas(sFileName, bLoadAlphaChannel);
+            }
+            else if(pAtlas == NULL)
+            {
+                std::string sPackedFilePath = sFileName.substr(0, iPos);
+                std::string sPackedBlockPath = sFileName.substr(iPos+1);
+
+                int iSize = m_pPacker->GetFileSize(sPackedFilePath, sPackedBlockPath);
+
+                if(iSize > 0)
+                {
+                    CogeBuffer* buf = m_pBuffer->GetFreeBuffer(iSize);
+                    if(buf != NULL && buf->GetState() >= 0)
+                    {
+                        buf->Hire();
+
+                        char* pFileData = buf->GetBuffer();
+
+                        int iReadSize = m_pPacker->ReadFile(sPackedFilePath, sPackedBlockPath, pFileData, m_bEncryptedImage);
+                        if(iReadSize > 0) pAtlas = m_pVideo->LoadAtlas(sFileName, bLoadAlphaChannel, pFileData, iReadSize);
+
+                        buf->Fire();
+                    }
+                }
+            }
+
+            if(pAtlas) pNewImage = m_pVideo->NewImageFromAtlas(sImageName, iWidth, iHeight, iColorKeyRGB,
+                                                               bLoadAlphaChannel, bCreateLocalClipboard,
+                                                               pAtlas, iAtlasX, iAtlasY);
+        }
+        else if(!m_bPackedImage)
         {
             if(sFileName.length() == 0 || !OGE_IsFileExisted(sFileName.c_str())) sFileName = ""; // used to handle img with no file
             pNewImage = m_pVideo->NewImage(sImageName, iWidth, iHeight, iColorKeyRGB, bLoadAlphaChannel, bCreateLocalClipboard, sFileName);
@@ -5397,6 +5658,8 @@ void CogeEngine::Screenshot()
 {
     if(m_pVideo && m_pActiveScene)
     {
+        m_pVideo->WaitPresent();
+
         CogeImage* pLastScreen = m_pVideo->GetLastScreen();
         if(pLastScreen)
         {
@@ -6163,6 +6426,8 @@ m_pScript(NULL),
 m_pScreen(NULL),
 m_pBackground(NULL),
 m_pLightMap(NULL),
+m_pLightBuffer(NULL),
+m_pTileRenderer(NULL),
 m_pFadeMask(NULL),
 m_pMap(NULL),
 m_pBackgroundMusic(NULL),
@@ -6201,6 +6466,8 @@ m_iSceneType(-1)
     m_iTotalDirtyRects = 0;
     //m_bNeedRedrawBg = false;
 
+    m_bUpdateAll = true;
+
     m_iTopZ = 0;
 
     m_SceneViewRect.left   = 0;
@@ -6208,6 +6475,12 @@ m_iSceneType(-1)
     m_SceneViewRect.right  = 0;
     m_SceneViewRect.bottom = 0;
 
+    m_LastViewRect = m_SceneViewRect;
+
+    m_FPSInfoRect = m_SceneViewRect;
+    m_VideoModeInfoRect = m_SceneViewRect;
+    m_MousePosInfoRect = m_SceneViewRect;
+
     m_iBackgroundWidth = 0;
     m_iBackgroundHeight = 0;
 
@@ -6401,6 +6674,9 @@ int CogeScene::SetMap(const std::string& sMapName, int iNewLeft, int iNewTop)
     m_pMap->Hire();
     m_pMap->Reset();
 
+    // the screen may be the one on the present thread
+    m_pEngine->m_pVideo->WaitPresent();
+
     if(m_pScreen)
     {
         if(m_pScreen->GetWidth()  == m_pMap->m_iBgWidth &&
@@ -7857,6 +8133,12 @@ void CogeScene::Finalize()
     }
     m_pLightMap = NULL;
 
+    if(m_pLightBuffer) delete m_pLightBuffer;
+    m_pLightBuffer = NULL;
+
+    if(m_pTileRenderer) delete m_pTileRenderer;
+    m_pTileRenderer = NULL;
+
     m_pFadeMask = NULL;
 
     CogeImage* pScreen = m_pEngine->m_pVideo->GetScreen();
@@ -8116,6 +8398,8 @@ void CogeScene::Activate()
     m_pEngine->m_pCurrentGameScene = this;
     m_pEngine->m_pNextActiveScene = NULL;
 
+    m_bUpdateAll = true;
+
     //m_pEngine->m_sActiveSceneName = m_sName;
     m_pEngine->m_sNextSceneName = "";
 
@@ -9159,10 +9443,63 @@ int CogeScene::DoFade()
     return 1;
 }
 
+void CogeScene::AddScrollRects()
+{
+    int dx = m_SceneViewRect.left - m_LastViewRect.left;
+    int dy = m_SceneViewRect.top - m_LastViewRect.top;
+
+    m_LastViewRect = m_SceneViewRect;
+
+    if(dx == 0 && dy == 0) return;
+
+    if(!m_pEngine->m_bUseScrollReuse || !m_pEngine->m_bUseDirtyRect) return;
+
+    int iViewWidth = m_SceneViewRect.right - m_SceneViewRect.left;
+    int iViewHeight = m_SceneViewRect.bottom - m_SceneViewRect.top;
+
+    // a big jump is cheaper to redraw as a whole, and the light (in view space) has moved on every pixel
+    if(m_pLightBuffer || abs(dx) * 2 >= iViewWidth || abs(dy) * 2 >= iViewHeight)
+    {
+        m_iTotalDirtyRects = _OGE_MAX_DIRTY_RECT_NUMBER_ + 8;
+        return;
+    }
+
+    // the screen is as large as the scene, so the rest of the view is still where it was drawn
+    if(dx != 0)
+    {
+        CogeRect* rc = &m_ScrollRects[0];
+        rc->left   = dx > 0 ? m_SceneViewRect.right - dx : m_SceneViewRect.left;
+        rc->right  = rc->left + abs(dx);
+        rc->top    = m_SceneViewRect.top;
+        rc->bottom = m_SceneViewRect.bottom;
+        AddDirtyRect(rc);
+    }
+
+    if(dy != 0)
+    {
+        CogeRect* rc = &m_ScrollRects[1];
+        rc->top    = dy > 0 ? m_SceneViewRect.bottom - dy : m_SceneViewRect.top;
+        rc->bottom = rc->top + abs(dy);
+        rc->left   = m_SceneViewRect.left;
+        rc->right  = m_SceneViewRect.right;
+        AddDirtyRect(rc);
+    }
+
+    // but not what has moved along with the view (the rects stay until ClearDirtyRects())
+    for(size_t i = 0; i < m_LeftRects.size(); i++) AddDirtyRect(&m_LeftRects[i]);
+}
+
+void CogeScene::AddLeftRect(const CogeRect& rc)
+{
+    if(m_pEngine->m_bUseScrollReuse && m_pEngine->m_bUseDirtyRect) m_LeftRects.push_back(rc);
+}
+
 void CogeScene::DrawBackground()
 {
 	if(m_iState < 0) return;
 
+	AddScrollRects();
+
 	if(m_pScreen && m_pBackground)
 	{
 	    //if(m_pBackground == m_pEngine->m_pVideo->GetDefaultBg())
@@ -9170,7 +9507,76 @@ void CogeScene::DrawBackground()
         //    m_pEngine->m_pVideo->ClearDefaultBg(m_iBackgroundColor);
         //}
 
-	    if(m_pEngine->m_bUseDirtyRect)
+	    if(m_pEngine->m_bUseDirtyRect && m_pLightBuffer)
+	    {
+	        // redraws the dirty tiles, the light goes on the same tiles then (a pixel must not get it twice)
+	        if(m_iTotalDirtyRects > _OGE_MAX_DIRTY_RECT_NUMBER_)
+	        {
+	            m_pLightBuffer->MarkAll();
+
+                if(m_pBackground == m_pEngine->m_pVideo->GetDefaultBg())
+                {
+                    m_pEngine->m_pVideo->ClearDefaultBg(m_iBackgroundColor);
+                }
+                m_pScreen->CopyRect(m_pBackground,
+                                    m_SceneViewRect.left, m_SceneViewRect.top,
+                                    m_SceneViewRect.left, m_SceneViewRect.top,
+                                    m_pEngine->m_iVideoWidth, m_pEngine->m_iVideoHeight);
+	        }
+	        else
+	        {
+                ogeRectList::iterator it  = m_DirtyRects.begin();
+
+                size_t count = m_DirtyRects.size();
+
+                while(count > 0)
+                {
+                    CogeRect* rc = *it;
+
+                    if(rc) m_pLightBuffer->MarkRect(rc->left - m_SceneViewRect.left, rc->top - m_SceneViewRect.top,
+                                                    rc->right - rc->left, rc->bottom - rc->top);
+                    it++;
+
+                    count--;
+                }
+
+                // all the sprites in view are drawn again, so they need the light again too
+                ogeSpriteList::iterator its = m_SpritesInView.begin();
+
+                count = m_SpritesInView.size();
+
+                while(count > 0)
+                {
+                    CogeRect* rc = &((*its)->m_DrawPosRect);
+
+                    m_pLightBuffer->MarkRect(rc->left - m_SceneViewRect.left, rc->top - m_SceneViewRect.top,
+                                             rc->right - rc->left, rc->bottom - rc->top);
+                    its++;
+
+                    count--;
+                }
+
+                if(m_pFirstSpr && m_pFirstSpr->m_bVisible)
+                {
+                    CogeRect* rc = &m_pFirstSpr->m_DrawPosRect;
+
+                    m_pLightBuffer->MarkRect(rc->left - m_SceneViewRect.left, rc->top - m_SceneViewRect.top,
+                                             rc->right - rc->left, rc->bottom - rc->top);
+                }
+
+                const std::vector<CogeRect>& regions = m_pLightBuffer->GetRegions();
+
+                for(size_t i=0; i<regions.size(); i++)
+                {
+                    int x = m_SceneViewRect.left + regions[i].left;
+                    int y = m_SceneViewRect.top + regions[i].top;
+
+                    m_pScreen->Draw(m_pBackground, x, y, x, y,
+                                    regions[i].right - regions[i].left, regions[i].bottom - regions[i].top);
+                }
+	        }
+	    }
+	    else if(m_pEngine->m_bUseDirtyRect)
 	    {
             if(m_iTotalDirtyRects > 0 && m_iTotalDirtyRects <= _OGE_MAX_DIRTY_RECT_NUMBER_)
             {
@@ -9287,8 +9693,8 @@ void CogeScene::SetViewPos(int iPosX, int iPosY, bool bImmediately, bool bUpdate
     }
     else
     {
-
-        if(m_pEngine->m_bUseDirtyRect && m_pScreen && m_pBackground)
+        // in scroll reuse mode DrawBackground() redraws what has been scrolled in (or all of the view)
+        if(m_pEngine->m_bUseDirtyRect && !m_pEngine->m_bUseScrollReuse && m_pScreen && m_pBackground)
         {
             //m_pScreen->Draw(m_pBackground, 0, 0);
             //printf("iNextTop > m_pBackground->GetHeight() : Redraw all bg \n");
@@ -10362,10 +10768,26 @@ void CogeScene::UpdateSprites()
 	*/
 }
 
-void CogeScene::DrawSprites()
+CogeTileRenderer* CogeScene::PrepareTileRenderer()
 {
-    PrepareLightMap();
+    // worth it only when there are other threads to share the tiles
+    if(m_pEngine->m_iSpriteTileSize <= 0 || m_pEngine->m_pVideo->GetFXThreads() <= 1 || m_pScreen == NULL)
+    {
+        if(m_pTileRenderer) delete m_pTileRenderer;
+        m_pTileRenderer = NULL;
+        return NULL;
+    }
+
+    if(m_pTileRenderer == NULL) m_pTileRenderer = new CogeTileRenderer();
+
+    m_pTileRenderer->Begin(m_pScreen, m_SceneViewRect.left, m_SceneViewRect.top,
+                           m_pEngine->m_iVideoWidth, m_pEngine->m_iVideoHeight, m_pEngine->m_iSpriteTileSize);
+
+    return m_pTileRenderer;
+}
 
+void CogeScene::DrawSprites()
+{
     ogeSpriteList::iterator it;
 
 	int count = m_SpritesInView.size();
@@ -10410,6 +10832,9 @@ void CogeScene::DrawSprites()
 	bool bMeetWindow = false;
 	bool bIsWindow = false;
 
+	// the plain frames are drawn tile by tile, anything else (effects, windows, scripts) waits for them
+	CogeTileRenderer* pTiles = PrepareTileRenderer();
+
 	it  = m_SpritesInView.begin();
 
 	while (count>0)
@@ -10420,6 +10845,7 @@ void CogeScene::DrawSprites()
 
 	    if(!bMeetWindow && bIsWindow)
 	    {
+	        if(pTiles) pTiles->Flush();
 	        m_pEngine->m_pCurrentGameScene = this;
 	        CallEvent(Event_OnDrawSprFin);
 	        BlendSpriteLight();
@@ -10428,7 +10854,14 @@ void CogeScene::DrawSprites()
 
         if(bIsWindow) bMeetWindow = true;
 
-		if(spr->m_bVisible) spr->Draw();
+		if(spr->m_bVisible)
+		{
+		    if(pTiles == NULL || bIsWindow || !spr->RecordDraw(pTiles))
+		    {
+		        if(pTiles) pTiles->Flush();
+		        spr->Draw();
+		    }
+		}
 		AutoAddDirtyRect(spr);
 
 		it++;
@@ -10437,6 +10870,7 @@ void CogeScene::DrawSprites()
 
 		if(count == 0)
 		{
+		    if(pTiles) pTiles->Flush();
 		    m_pEngine->m_pCurrentGameScene = this;
 		    if(bMeetWindow) CallEvent(Event_OnDrawWinFin);
 		    else
@@ -10462,6 +10896,28 @@ void CogeScene::DrawSprites()
 
 }
 
+void CogeScene::KeepDrawnRects()
+{
+    // the old rect is where a sprite was last drawn, several logic steps may run before the next frame
+    ogeSpriteMap::iterator it = m_ActiveSprites.begin();
+
+    int iCount = m_ActiveSprites.size();
+
+    while(iCount > 0)
+    {
+        CogeSprite* spr = it->second;
+        memcpy(&spr->m_OldPosRect, &spr->m_DrawPosRect, sizeof(spr->m_DrawPosRect));
+
+        it++;
+
+        iCount--;
+    }
+
+    if(m_pFirstSpr) memcpy(&m_pFirstSpr->m_OldPosRect, &m_pFirstSpr->m_DrawPosRect, sizeof(m_pFirstSpr->m_DrawPosRect));
+    if(m_pMouseSpr) memcpy(&m_pMouseSpr->m_OldPosRect, &m_pMouseSpr->m_DrawPosRect, sizeof(m_pMouseSpr->m_DrawPosRect));
+    if(m_pLastSpr) memcpy(&m_pLastSpr->m_OldPosRect, &m_pLastSpr->m_DrawPosRect, sizeof(m_pLastSpr->m_DrawPosRect));
+}
+
 void CogeScene::DrawInfo()
 {
     if (m_iState < 0) return;
@@ -10486,80 +10942,72 @@ void CogeScene::DrawInfo()
 
 void CogeScene::PrepareLightMap()
 {
-    if(m_pEngine->m_bUseDirtyRect) return;
-
-    switch(m_iLightMode)
+    if(m_iLightMode == Light_M_None || m_pLightMap == NULL)
     {
-    case Light_M_View:
-        //if(m_pLightMap) m_pEngine->m_pVideo->m_pDefaultScreen->Draw(m_pLightMap, 0, 0, 0, 0,
-        if(m_pLightMap) m_pEngine->m_pVideo->GetDefaultBg()->CopyRect(m_pLightMap, 0, 0, 0, 0,
-        m_pEngine->m_iVideoWidth, m_pEngine->m_iVideoHeight);
-    break;
-    case Light_M_Map:
-        //if(m_pLightMap) m_pEngine->m_pVideo->m_pDefaultScreen->Draw(m_pLightMap, 0, 0,
-        if(m_pLightMap) m_pEngine->m_pVideo->GetDefaultBg()->CopyRect(m_pLightMap, 0, 0,
-        m_SceneViewRect.left, m_SceneViewRect.top,
-        m_pEngine->m_iVideoWidth, m_pEngine->m_iVideoHeight);
-    break;
-    case Light_M_None:
-    break;
-
-    }
-}
-void CogeScene::BlendSpriteLight()
-{
-    if(m_pEngine->m_bUseDirtyRect) return;
-
-    if(m_iLightMode == Light_M_None ||
-       m_bEnableSpriteLight == false ||
-       m_pLightMap  == NULL )
+        if(m_pLightBuffer) delete m_pLightBuffer;
+        m_pLightBuffer = NULL;
         return;
+    }
 
-    CogeSprite* pSprite = NULL;
+    if(m_pLightBuffer == NULL) m_pLightBuffer = new CogeLightBuffer();
 
-    //int count = m_SpritesInView.size();
-	//ogeSpriteList::iterator it  = m_SpritesInView.begin();
+    // the light space is the view (Light_M_View) or the map (Light_M_Map)
+    int iViewX = 0;
+    int iViewY = 0;
 
-	int count = m_ActiveSprites.size();
-	ogeSpriteMap::iterator it  = m_ActiveSprites.begin();
+    if(m_iLightMode == Light_M_Map)
+    {
+        iViewX = m_SceneViewRect.left;
+        iViewY = m_SceneViewRect.top;
+    }
 
-	while (count>0)
-	{
-	    //pSprite = (*it);
+    m_pLightBuffer->Begin(m_pLightMap, iViewX, iViewY, m_pEngine->m_iVideoWidth, m_pEngine->m_iVideoHeight);
 
-	    pSprite = it->second;
+    if(m_bEnableSpriteLight)
+    {
+        CogeSprite* pSprite = NULL;
 
-	    bool bIsWindow = pSprite->m_iUnitType >= Spr_Window && pSprite->m_iUnitType <= Spr_InputText;
+        int count = m_ActiveSprites.size();
+        ogeSpriteMap::iterator it  = m_ActiveSprites.begin();
 
-	    if(pSprite->m_bEnableLightMap && pSprite->m_pLightMap && pSprite->m_bActive && pSprite->m_bVisible && !bIsWindow)
-	    {
-	        int iMaskWidth = pSprite->m_pLightMap->GetWidth();
-	        int iMaskHeight = pSprite->m_pLightMap->GetHeight();
+        while (count>0)
+        {
+            pSprite = it->second;
 
-	        int x = (pSprite->m_iPosX - m_SceneViewRect.left) - iMaskWidth / 2;
-	        int y = (pSprite->m_iPosY - m_SceneViewRect.top) - iMaskHeight / 2;
+            bool bIsWindow = pSprite->m_iUnitType >= Spr_Window && pSprite->m_iUnitType <= Spr_InputText;
 
-	        m_pEngine->m_pVideo->GetDefaultBg()->LightMaskBlend(pSprite->m_pLightMap, x, y, 0, 0, iMaskWidth, iMaskHeight);
+            if(pSprite->m_bEnableLightMap && pSprite->m_pLightMap && pSprite->m_bActive && pSprite->m_bVisible && !bIsWindow)
+            {
+                int x = pSprite->m_iPosX - pSprite->m_pLightMap->GetWidth() / 2;
+                int y = pSprite->m_iPosY - pSprite->m_pLightMap->GetHeight() / 2;
 
-        }
+                if(m_iLightMode == Light_M_View)
+                {
+                    x = x - m_SceneViewRect.left;
+                    y = y - m_SceneViewRect.top;
+                }
 
-		it++;
+                m_pLightBuffer->AddLight(pSprite->m_pLightMap, x, y);
+            }
 
-		count--;
+            it++;
 
-	}
+            count--;
+        }
+    }
+
+    // the lights which moved make their places dirty
+    m_pLightBuffer->End();
 
+    if(!m_pEngine->m_bUseDirtyRect) m_pLightBuffer->MarkAll();
+}
+void CogeScene::BlendSpriteLight()
+{
+    if(m_pLightBuffer) m_pLightBuffer->Splat();
 }
 void CogeScene::DrawLightMap()
 {
-    if(m_pEngine->m_bUseDirtyRect) return;
-
-    if(m_iLightMode == Light_M_None || m_pLightMap == NULL) return;
-
-    //m_pScreen->LightMaskBlend( m_pEngine->m_pVideo->m_pDefaultScreen,
-    m_pScreen->LightMaskBlend( m_pEngine->m_pVideo->GetDefaultBg(),
-    m_SceneViewRect.left, m_SceneViewRect.top, 0, 0,
-    m_pEngine->m_iVideoWidth, m_pEngine->m_iVideoHeight);
+    if(m_pLightBuffer) m_pLightBuffer->Blend(m_pScreen, m_SceneViewRect.left, m_SceneViewRect.top);
 }
 
 int CogeScene::GetLightMode()
@@ -10573,6 +11021,9 @@ CogeImage* CogeScene::GetLightMap()
 
 void CogeScene::SetLightMap(CogeImage* pLightMapImage, int iLightMode)
 {
+    int iOldLightMode = m_iLightMode;
+    CogeImage* pOldLightMap = m_pLightMap;
+
     m_iLightMode = iLightMode;
 
     if(iLightMode != 0 && pLightMapImage)
@@ -10601,11 +11052,53 @@ void CogeScene::SetLightMap(CogeImage* pLightMapImage, int iLightMode)
         }
         m_pLightMap = NULL;
     }
+
+    // the lit pixels of the last frames stay on the screen in dirty rect mode
+    if(m_pEngine->m_bUseDirtyRect && (m_iLightMode != iOldLightMode || m_pLightMap != pOldLightMap))
+        m_iTotalDirtyRects = _OGE_MAX_DIRTY_RECT_NUMBER_ + 8;
+}
+
+void CogeScene::CollectUpdateRects()
+{
+    if(!m_pEngine->m_bUseDirtyRect || m_bUpdateAll) return;
+
+    // the rects which did not get into the list have been drawn all the same
+    if(m_iTotalDirtyRects >= _OGE_MAX_DIRTY_RECT_NUMBER_)
+    {
+        m_bUpdateAll = true;
+        m_UpdateRects.clear();
+        return;
+    }
+
+    ogeRectList::iterator it = m_DirtyRects.begin();
+
+    size_t count = m_DirtyRects.size();
+
+    while(count > 0)
+    {
+        if(*it) m_UpdateRects.push_back(**it);
+        it++;
+        count--;
+    }
 }
 
 void CogeScene::UpdateScreen()
 {
     if (m_iState < 0) return;
+
+    /* in dirty rect mode only the collected rects have changed, unless something may have drawn out of them
+       (the light in its tiles, the first and the last sprites, the draw events of the scene)
+    */
+    if(m_pEngine->m_bUseDirtyRect && !m_bUpdateAll && m_iLightMode == 0 && m_pLightBuffer == NULL
+       && m_pFirstSpr == NULL && m_pLastSpr == NULL
+       && (m_iScriptState < 0 || (m_Events[Event_OnDraw] < 0 && m_Events[Event_OnDrawSprFin] < 0 && m_Events[Event_OnDrawWinFin] < 0)))
+    {
+        m_pEngine->m_pVideo->SetUpdateRects(m_UpdateRects);
+    }
+
+    m_UpdateRects.clear();
+    m_bUpdateAll = false;
+
     m_pEngine->UpdateScreen(m_SceneViewRect.left, m_SceneViewRect.top);
 }
 
@@ -10632,6 +11125,7 @@ void CogeScene::ClearDirtyRects()
 {
     m_iTotalDirtyRects = 0;
     m_DirtyRects.clear();
+    m_LeftRects.clear();
 }
 
 void CogeScene::ValidateViewRect()
@@ -10669,10 +11163,8 @@ void CogeScene::ValidateViewRect()
 
 }
 
-int CogeScene::Update()
+void CogeScene::UpdateLogic()
 {
-    if (m_iState < 0) return -1;
-
     //ClearDirtyRects();
 
     m_pGettingFocusSpr = NULL;
@@ -10738,12 +11230,23 @@ int CogeScene::Update()
 
     // check scene's interaction events ...
     CheckInteraction();
+}
 
+void CogeScene::DrawScene()
+{
     //if(m_iScrollState > 0) DoScroll();
 
 	// refresh screen ...
 	//UpdatePendingOffset(true);
 
+	// the info goes along with the view, the last frame has drawn it where the view was
+	if (m_SceneViewRect.left != m_LastViewRect.left || m_SceneViewRect.top != m_LastViewRect.top)
+	{
+	    if (m_pEngine->m_bShowFPS) AddLeftRect(m_FPSInfoRect);
+	    if (m_pEngine->m_bShowVideoMode) AddLeftRect(m_VideoModeInfoRect);
+	    if (m_pEngine->m_bShowMousePos) AddLeftRect(m_MousePosInfoRect);
+	}
+
 	// prepare info to show
 	int iTop = m_SceneViewRect.top;
 
@@ -10777,18 +11280,36 @@ int CogeScene::Update()
 		iTop = m_MousePosInfoRect.bottom + 1;
 	}
 
+	// the last frame may still be on the present thread, it has to be out of the screen before it is drawn on
+	m_pEngine->m_pVideo->WaitPresent();
+
+	// what is left on the screen is out of date, so all of it is dirty
+	if (m_pEngine->m_pVideo->IsScreenLost()) m_iTotalDirtyRects = _OGE_MAX_DIRTY_RECT_NUMBER_ + 8;
+
+	// the light of the frame (before the bg, the lights which moved need the bg redrawn in dirty rect mode)
+	PrepareLightMap();
+
 	// draw bg ...
 	DrawBackground();
 
+	// the rects which the bg has just restored
+	CollectUpdateRects();
+
     //...
 	ClearDirtyRects();
 
     // draw spr ...
 	DrawSprites();
 
+	// after their dirty rects have been added
+	KeepDrawnRects();
+
 	// draw global info ...
 	DrawInfo();
 
+	// and the rects which the sprites have been drawn in
+	CollectUpdateRects();
+
 
 	// test - begin
 	/*
@@ -10816,6 +11337,17 @@ int CogeScene::Update()
 
 	// let user have a chance to modify the screen ...
     CallEvent(Event_OnDraw);
+}
+
+int CogeScene::Update(bool bLogic, bool bDraw)
+{
+    if (m_iState < 0) return -1;
+
+    // update sprites, handle events ...
+    if(bLogic) UpdateLogic();
+
+    // draw the frame ...
+    if(bDraw) DrawScene();
 
     //if(m_bNeedRedrawBg)
     //{
@@ -10842,10 +11374,11 @@ int CogeScene::Update()
             return 1;
 	    }
     }
-    else
+    else if(bDraw)
     {
         DoFade();
         bIsFading = true;
+        m_bUpdateAll = true;
     }
 
     // check sprites' lives ..
@@ -10879,7 +11412,7 @@ int CogeScene::Update()
     }
 
     // flip screen ...
-	UpdateScreen();
+	if(bDraw) UpdateScreen();
 
     return 0;
 
@@ -12192,6 +12725,16 @@ const std::string& CogeSprite::GetBaseName()
     return m_sBaseName;
 }
 
+bool CogeSprite::HasEventHandler(int iEventCode)
+{
+    if (m_iScriptState < 0) return false;
+
+    if(m_pLocalScript && m_LocalEvents[iEventCode] >= 0) return true;
+    if(m_pCommonScript && m_CommonEvents[iEventCode] >= 0) return true;
+
+    return m_iUnitType != Spr_Plot && m_pPlotSpr && m_PlotTriggers[iEventCode] > 0;
+}
+
 int CogeSprite::CallEvent(int iEventCode)
 {
     if (m_iScriptState < 0) return -1;
@@ -12945,6 +13488,10 @@ int CogeSprite::AddAnimaEffectEx(int iEffectType, double fStart, double fEnd, do
 
     int iRsl =  m_pAnimaEffect->AddEffectEx(iEffectType, fStart, fEnd, fIncrement, iStepInterval, iRepeat);
 
+    // build the wave tables of the whole effect now rather than frame by frame while it is running
+    if(iRsl > 0 && iEffectType == Effect_Wave && m_pCurrentAnima && m_pCurrentAnima->m_pImage)
+        m_pCurrentAnima->m_pImage->PrepareWave((int)fStart, (int)fEnd);
+
     if(iRsl > 0 && bIncludeChildren)
     {
         ogeSpriteMap::iterator its, ite;
@@ -14412,8 +14959,6 @@ void CogeSprite::Update()
 
     if(m_bIsRelative && !m_pParent) AdjustSceneView();
 
-    memcpy(&m_OldPosRect, &m_DrawPosRect, sizeof(m_DrawPosRect));
-
 	if (m_pCurrentAnima)
 	{
 		m_pCurrentAnima->Update();
@@ -14557,6 +15102,27 @@ void CogeSprite::Draw()
 
 }
 
+bool CogeSprite::RecordDraw(CogeTileRenderer* pRenderer)
+{
+    if(m_iState < 0) return true;
+
+    // the script may draw on the screen, so the frames before must be there
+    if(m_pCurrentScene && HasEventHandler(Event_OnDraw)) return false;
+
+    if(m_bDefaultDraw && m_pCurrentAnima)
+    {
+        if(!m_pCurrentAnima->Record(pRenderer, m_DrawPosRect.left, m_DrawPosRect.top, m_pAnimaEffect)) return false;
+    }
+
+    if(m_pCurrentScene)
+    {
+        m_pCurrentScene->m_pCurrentSpr = this;
+        m_pEngine->m_pCurrentGameSprite = this;
+    }
+
+    return true;
+}
+
 int CogeSprite::Initialize(const std::string& sConfigFileName)
 {
     Finalize();
@@ -15568,6 +16134,332 @@ bool CogeAnima::SetImage(CogeImage* pImage)
     return true;
 }
 
+void CogeAnima::UpdateEffect(CogeEffect* pEffect)
+{
+    if(pEffect->effect_value != pEffect->end_value)
+    {
+        pEffect->time += m_pEngine->m_iCurrentInterval;
+        if (pEffect->time >= pEffect->interval)
+        {
+            if(pEffect->step_value > 0)
+            {
+                if(pEffect->effect_value < pEffect->end_value)
+                pEffect->effect_value = pEffect->effect_value + pEffect->step_value;
+
+                if(pEffect->effect_value > pEffect->end_value)
+                pEffect->effect_value = pEffect->end_value;
+            }
+            else if(pEffect->step_value < 0)
+            {
+                if(pEffect->effect_value > pEffect->end_value)
+                pEffect->effect_value = pEffect->effect_value + pEffect->step_value;
+
+                if(pEffect->effect_value < pEffect->end_value)
+                pEffect->effect_value = pEffect->end_value;
+            }
+
+            pEffect->time = 0;
+        }
+    }
+    else
+    {
+        if(pEffect->repeat_times != 0)
+        {
+            pEffect->effect_value = pEffect->start_value;
+            if(pEffect->repeat_times > 0) pEffect->repeat_times = pEffect->repeat_times - 1;
+        }
+        else pEffect->active = false;
+    }
+}
+
+void CogeAnima::UpdateEffects(CogeFrameEffect* pEffects)
+{
+    const ogeEffectList& Effects = pEffects->GetEffects();
+    ogeEffectList::const_iterator it;
+
+    for(it = Effects.begin(); it != Effects.end(); it++)
+    {
+        CogeEffect* pEffect = *it;
+
+        if(pEffect->active == false) continue;
+
+        UpdateEffect(pEffect);
+
+        if(pEffect->effect_type == Effect_Alpha) break;
+    }
+}
+
+bool CogeAnima::PrepareFused(CogeFrameEffect* pEffects, double& fAngle, int& iDrawWidth, int& iDrawHeight, int& iAlpha)
+{
+    CogeFXColorTransform* pTransform = m_pVideo->GetColorTransform();
+
+    if(pTransform == NULL) return false;
+
+    // the color effects go into one chain, the geometry can be one rotation or one scaling
+    OGE_FX_ClearColorTransform(pTransform);
+
+    bool bRotate = false;
+    bool bScale = false;
+
+    fAngle = 0;
+    iDrawWidth  = m_FrameRect.w;
+    iDrawHeight = m_FrameRect.h;
+    iAlpha = 255;
+
+    const ogeEffectList& Effects = pEffects->GetEffects();
+    ogeEffectList::const_iterator it;
+
+    // the same as the clipboards, the alpha is the last one to draw
+    for(it = Effects.begin(); it != Effects.end(); it++)
+    {
+        CogeEffect* pEffect = *it;
+
+        if(pEffect->active == false) continue;
+
+        int iEffectValue = (int)pEffect->effect_value;
+
+        int iChainLength = 0;
+
+        switch(pEffect->effect_type)
+        {
+        case Effect_Lightness:
+            iChainLength = OGE_FX_AddColorAdjustment(pTransform, _OGE_FX_COLOR_LIGHTNESS_, iEffectValue);
+        break;
+
+        case Effect_RGB:
+        {
+            int iBlueAmount  = iEffectValue & 0x000000ff;
+            int iGreenAmount = (iEffectValue & 0x0000ff00) >> 8;
+            int iRedAmount   = (iEffectValue & 0x00ff0000) >> 16;
+            int iAlphaAmount = (iEffectValue & 0xff000000) >> 24;
+
+            if((iAlphaAmount & 1) > 0) iBlueAmount = 0 - iBlueAmount;
+            if((iAlphaAmount & 2) > 0) iGreenAmount = 0 - iGreenAmount;
+            if((iAlphaAmount & 4) > 0) iRedAmount = 0 - iRedAmount;
+
+            iChainLength = OGE_FX_AddColorAdjustment(pTransform, _OGE_FX_COLOR_RGB_,
+                                                     iRedAmount, iGreenAmount, iBlueAmount);
+        }
+        break;
+
+        case Effect_Color:
+        {
+            uint32_t iRealColor =  iEffectValue & 0x00ffffff;
+            uint32_t iRealAlpha = (iEffectValue & 0xff000000) >> 24;
+
+            iChainLength = OGE_FX_AddColorAdjustment(pTransform, _OGE_FX_COLOR_BLEND_,
+                                                     m_pVideo->FormatColor(iRealColor), iRealAlpha);
+        }
+        break;
+
+        case Effect_Rota:
+            if(bRotate || bScale) return false;
+            bRotate = true;
+            fAngle = iEffectValue;
+        break;
+
+        case Effect_Scale:
+            if(bRotate || bScale) return false;
+            bScale = true;
+            iDrawWidth  = lround(m_FrameRect.w * pEffect->effect_value);
+            iDrawHeight = lround(m_FrameRect.h * pEffect->effect_value);
+        break;
+
+        case Effect_Alpha:
+            iAlpha = iEffectValue;
+        break;
+
+        default:
+            return false;
+        }
+
+        if(iChainLength < 0) return false;
+
+        if(pEffect->effect_type == Effect_Alpha) break;
+    }
+
+    return true;
+}
+
+bool CogeAnima::DrawFused(CogeFrameEffect* pEffects, int iPosX, int iPosY, bool bUpdate)
+{
+    CogeImage* pMainScreen = m_pVideo->GetScreen();
+
+    double fAngle = 0;
+    int iDrawWidth = 0;
+    int iDrawHeight = 0;
+    int iAlpha = 255;
+
+    if(pMainScreen == NULL) return false;
+
+    if(!PrepareFused(pEffects, fAngle, iDrawWidth, iDrawHeight, iAlpha)) return false;
+
+    CogeFXColorTransform* pTransform = m_pVideo->GetColorTransform();
+    if(OGE_FX_GetColorTransformLength(pTransform) == 0) pTransform = NULL;
+
+    int iDrawX  = iPosX + (m_FrameRect.w >> 1) - (iDrawWidth  >> 1);
+    int iDrawY  = iPosY + (m_FrameRect.h >> 1) - (iDrawHeight >> 1);
+
+    if(!pMainScreen->BltFused(m_pImage, fAngle, pTransform, iAlpha,
+                              iDrawX, iDrawY, iDrawWidth, iDrawHeight,
+                              m_FrameRect.x, m_FrameRect.y, m_FrameRect.w, m_FrameRect.h)) return false;
+
+    if(bUpdate) UpdateEffects(pEffects);
+
+    return true;
+}
+
+void CogeAnima::DrawScaled(CogeImage* pDstImage, CogeImage* pSrcImage, int iSrcLeft, int iSrcTop, int iSrcRight, int iSrcBottom,
+                           int iDstLeft, int iDstTop, int iDstRight, int iDstBottom)
+{
+    // the images with alpha channel keep their own way through the clipboards
+    if(m_pVideo->GetSmoothScaling() && !pSrcImage->HasAlphaChannel())
+        pDstImage->BltStretchSmoothly(pSrcImage, iSrcLeft, iSrcTop, iSrcRight, iSrcBottom,
+                                      iDstLeft, iDstTop, iDstRight, iDstBottom);
+    else
+        pDstImage->BltStretch(pSrcImage, iSrcLeft, iSrcTop, iSrcRight, iSrcBottom,
+                              iDstLeft, iDstTop, iDstRight, iDstBottom);
+}
+
+bool CogeAnima::DrawCached(CogeFrameEffect* pEffects, int iPosX, int iPosY, bool bUpdate)
+{
+    CogeImage* pMainScreen = m_pVideo->GetScreen();
+
+    if(pMainScreen == NULL || m_pVideo->GetFrameCacheSize() <= 0) return false;
+
+    if(m_pImage->HasAlphaChannel() || m_pImage->HasLocalClipboard()) return false;
+
+    int iSrcColorKey = m_pImage->GetColorKey();
+
+    CogeFrameCacheKey key;
+
+    key.pImage  = m_pImage;
+    key.iLeft   = m_FrameRect.x;
+    key.iTop    = m_FrameRect.y;
+    key.iWidth  = m_FrameRect.w;
+    key.iHeight = m_FrameRect.h;
+    key.iEffectCount = 0;
+
+    int iAlpha = 255;
+    int iDrawWidth  = m_FrameRect.w;
+    int iDrawHeight = m_FrameRect.h;
+
+    const ogeEffectList& Effects = pEffects->GetEffects();
+    ogeEffectList::const_iterator it;
+
+    // the key is the list of the effects before the alpha one (which is the blending of the frame)
+    for(it = Effects.begin(); it != Effects.end(); it++)
+    {
+        CogeEffect* pEffect = *it;
+
+        if(pEffect->active == false) continue;
+
+        int iEffectValue = (int)pEffect->effect_value;
+
+        if(pEffect->effect_type == Effect_Alpha)
+        {
+            iAlpha = iEffectValue;
+            break;
+        }
+
+        if(key.iEffectCount >= _OGE_MAX_CACHED_EFFECTS_) return false;
+
+        // the rotation needs a color key for the corners
+        if(pEffect->effect_type == Effect_Rota && iSrcColorKey == -1) return false;
+
+        // the size of the scaled frame is the quantized value
+        if(pEffect->effect_type == Effect_Scale)
+        {
+            iDrawWidth  = lround(m_FrameRect.w * pEffect->effect_value);
+            iDrawHeight = lround(m_FrameRect.h * pEffect->effect_value);
+            iEffectValue = (iDrawWidth << 16) | (iDrawHeight & 0xffff);
+        }
+
+        key.iEffectTypes[key.iEffectCount]  = pEffect->effect_type;
+        key.iEffectValues[key.iEffectCount] = iEffectValue;
+        key.iEffectCount++;
+    }
+
+    if(key.iEffectCount == 0) return false;
+
+    CogeImage* pFrame = m_pVideo->FindCachedFrame(key);
+
+    if(pFrame == NULL)
+    {
+        int iType = key.iEffectTypes[0];
+        bool bSingle = key.iEffectCount == 1 && (iType == Effect_Edge || iType == Effect_Wave);
+
+        double fAngle = 0;
+        int iFusedAlpha = 255;
+
+        if(!bSingle && !PrepareFused(pEffects, fAngle, iDrawWidth, iDrawHeight, iFusedAlpha)) return false;
+
+        pFrame = m_pVideo->NewCachedFrame(key, iDrawWidth, iDrawHeight, iSrcColorKey);
+        if(pFrame == NULL) return false;
+
+        if(iType == Effect_Edge && bSingle)
+        {
+            pFrame->BltWithEdge( m_pImage, key.iEffectValues[0],
+            0,  0, m_FrameRect.x,  m_FrameRect.y,  m_FrameRect.w,  m_FrameRect.h);
+        }
+        else if(iType == Effect_Wave && bSingle)
+        {
+            pFrame->BltWave( m_pImage, key.iEffectValues[0],
+            0,  0, m_FrameRect.x,  m_FrameRect.y,  m_FrameRect.w,  m_FrameRect.h);
+        }
+        else
+        {
+            CogeFXColorTransform* pTransform = m_pVideo->GetColorTransform();
+            if(OGE_FX_GetColorTransformLength(pTransform) == 0) pTransform = NULL;
+
+            if(!pFrame->BltFused(m_pImage, fAngle, pTransform, 255,
+                                 0, 0, iDrawWidth, iDrawHeight,
+                                 m_FrameRect.x, m_FrameRect.y, m_FrameRect.w, m_FrameRect.h))
+            {
+                m_pVideo->DelCachedFrames(m_pImage);
+                return false;
+            }
+        }
+
+        if(iSrcColorKey != -1 && m_pVideo->GetColorKeySpans() > 0) pFrame->BuildSpans();
+    }
+
+    int iDrawX  = iPosX + (m_FrameRect.w >> 1) - (iDrawWidth  >> 1);
+    int iDrawY  = iPosY + (m_FrameRect.h >> 1) - (iDrawHeight >> 1);
+
+    if(iAlpha >= 255)
+        pMainScreen->Draw(pFrame, iDrawX, iDrawY, 0, 0, iDrawWidth, iDrawHeight);
+    else
+        pMainScreen->BltAlphaBlend(pFrame, iAlpha, iDrawX, iDrawY, 0, 0, iDrawWidth, iDrawHeight);
+
+    if(bUpdate) UpdateEffects(pEffects);
+
+    return true;
+}
+
+bool CogeAnima::Record(CogeTileRenderer* pRenderer, int iPosX, int iPosY, CogeFrameEffect* pGlobalEffect)
+{
+    if(m_iState < 0 || m_iCurrentFrame <= 0) return true;
+
+    // the effects (and their timers) are left to Draw()
+    if(pGlobalEffect && pGlobalEffect->GetActiveEffectCount() > 0) return false;
+
+    if(m_iEffectMode == Effect_M_Frame)
+    {
+        CogeFrameEffect* pFrameEffect = NULL;
+
+        if(m_iCurrentFrame > m_iTotalFrames) pFrameEffect = GetFrameEffect(m_iCurrentFrame-1);
+        else pFrameEffect = GetFrameEffect(m_iCurrentFrame);
+
+        if(pFrameEffect && pFrameEffect->GetActiveEffectCount() > 0) return false;
+    }
+
+    // the frame is clipped by its parent then
+    if(m_pSprite && m_pSprite->m_pParent && m_pSprite->m_bIsRelative && !m_pSprite->m_bMouseDrag) return false;
+
+    return pRenderer->Add(m_pImage, iPosX, iPosY, m_FrameRect.x, m_FrameRect.y, m_FrameRect.w, m_FrameRect.h);
+}
+
 void CogeAnima::Draw(int iPosX, int iPosY, CogeFrameEffect* pGlobalEffect)
 {
     if(m_iState < 0 || m_iCurrentFrame <= 0) return;
@@ -15602,6 +16494,7 @@ void CogeAnima::Draw(int iPosX, int iPosY, CogeFrameEffect* pGlobalEffect)
 
             int iEffectValue = (int)pEffect->effect_value;
 
+            if(!DrawCached(pGlobalEffect, iPosX, iPosY, false))
             switch(pEffect->effect_type)
             {
             case Effect_Edge:
@@ -15629,7 +16522,8 @@ void CogeAnima::Draw(int iPosX, int iPosY, CogeFrameEffect* pGlobalEffect)
                    || iPosX + m_FrameRect.w > pMainScreen->GetWidth()
                    || iPosY + m_FrameRect.h > pMainScreen->GetHeight())
                 {
-                    if(pClipboardA)
+                    // clips the rotation itself, or goes through the clipboard
+                    if(!DrawFused(pGlobalEffect, iPosX, iPosY, false) && pClipboardA)
                     {
                         int iSrcColorKey = m_pImage->GetColorKey();
 
@@ -15675,7 +16569,7 @@ void CogeAnima::Draw(int iPosX, int iPosY, CogeFrameEffect* pGlobalEffect)
                    || iDrawX + iDrawWidth > pMainScreen->GetWidth()
                    || iDrawY + iDrawHeight > pMainScreen->GetHeight())
                 {
-                    if(pClipboardA)
+                    if(!DrawFused(pGlobalEffect, iPosX, iPosY, false) && pClipboardA)
                     {
                         int iSrcColorKey = m_pImage->GetColorKey();
 
@@ -15683,7 +16577,7 @@ void CogeAnima::Draw(int iPosX, int iPosY, CogeFrameEffect* pGlobalEffect)
 
                         CogeImage* pCurrentClipboard = pClipboardA;
                         if(iSrcColorKey != -1) pCurrentClipboard->FillRect(iSrcColorKey, 0, 0, iDrawWidth, iDrawHeight);
-                        pCurrentClipboard->BltStretch( m_pImage,
+                        DrawScaled(pCurrentClipboard, m_pImage,
                             m_FrameRect.x,  m_FrameRect.y,  m_FrameRect.x+m_FrameRect.w,  m_FrameRect.y+m_FrameRect.h,
                             0,  0, iDrawWidth,  iDrawHeight);
 
@@ -15694,7 +16588,7 @@ void CogeAnima::Draw(int iPosX, int iPosY, CogeFrameEffect* pGlobalEffect)
                 }
                 else
                 {
-                    pMainScreen->BltStretch( m_pImage,
+                    DrawScaled(pMainScreen, m_pImage,
                     m_FrameRect.x,  m_FrameRect.y,  m_FrameRect.x+m_FrameRect.w,  m_FrameRect.y+m_FrameRect.h,
                     iDrawX,  iDrawY, iDrawX + iDrawWidth,  iDrawY + iDrawHeight);
                 }
@@ -15708,56 +16602,13 @@ void CogeAnima::Draw(int iPosX, int iPosY, CogeFrameEffect* pGlobalEffect)
             break;
             }
 
-            if(pEffect->effect_value != pEffect->end_value)
-            {
-                //pEffect->time += m_pEngine->m_iFrameInterval;
-                pEffect->time += m_pEngine->m_iCurrentInterval;
-                if (pEffect->time >= pEffect->interval)
-                {
-                    if(pEffect->step_value > 0)
-                    {
-                        if(pEffect->effect_value < pEffect->end_value)
-                        pEffect->effect_value = pEffect->effect_value + pEffect->step_value;
-
-                        if(pEffect->effect_value > pEffect->end_value)
-                        pEffect->effect_value = pEffect->end_value;
-                    }
-                    else if(pEffect->step_value < 0)
-                    {
-                        if(pEffect->effect_value > pEffect->end_value)
-                        pEffect->effect_value = pEffect->effect_value + pEffect->step_value;
-
-                        if(pEffect->effect_value < pEffect->end_value)
-                        pEffect->effect_value = pEffect->end_value;
-                    }
-
-                    pEffect->time = 0;
-                }
-            }
-            else
-            {
-                if(pEffect->repeat_times != 0)
-                {
-                    pEffect->effect_value = pEffect->start_value;
-                    if(pEffect->repeat_times > 0) pEffect->repeat_times = pEffect->repeat_times - 1;
-                    //else pEffect->repeat_times = 0;
-                }
-                else
-                {
-                    pEffect->active = false;
-
-                    /*
-                    if(m_pSprite && m_pSprite->m_bJoinedPlot && m_pSprite->m_pCurrentScene)
-                    {
-                        CogeSprite* pPlotSpr = m_pSprite->m_pCurrentScene->GetPlotSprite();
-                        if(pPlotSpr) pPlotSpr->ResumeUpdateScript();
-                    }
-                    */
-                }
-            }
+            UpdateEffect(pEffect);
 
         }
 
+        // most of the combinations do not need the clipboards at all
+        if(iGlobalEffectCount > 1 && (DrawCached(pGlobalEffect, iPosX, iPosY) || DrawFused(pGlobalEffect, iPosX, iPosY))) return;
+
         if(iGlobalEffectCount > 1 && pClipboardA && pClipboardB)
         {
             CogeImage* pCurrentClipboard = NULL;
@@ -16082,7 +16933,7 @@ void CogeAnima::Draw(int iPosX, int iPosY, CogeFrameEffect* pGlobalEffect)
                             int iDrawX  = iPosX + (m_FrameRect.w >> 1) - (iDrawWidth  >> 1);
                             int iDrawY  = iPosY + (m_FrameRect.h >> 1) - (iDrawHeight >> 1);
 
-                            pMainScreen->BltStretch( m_pImage,
+                            DrawScaled(pMainScreen, m_pImage,
                              m_FrameRect.x,  m_FrameRect.y,  m_FrameRect.x+m_FrameRect.w,  m_FrameRect.y+m_FrameRect.h,
                             iDrawX,  iDrawY, iDrawX + iDrawWidth,  iDrawY + iDrawHeight);
                         }
@@ -16091,7 +16942,7 @@ void CogeAnima::Draw(int iPosX, int iPosY, CogeFrameEffect* pGlobalEffect)
                             pCurrentClipboard = pClipboardA;
                             if(iSrcColorKey != -1)
                             pCurrentClipboard->FillRect(iSrcColorKey, 0, 0, iDrawWidth, iDrawHeight);
-                            pCurrentClipboard->BltStretch( m_pImage,
+                            DrawScaled(pCurrentClipboard, m_pImage,
                              m_FrameRect.x,  m_FrameRect.y,  m_FrameRect.x+m_FrameRect.w,  m_FrameRect.y+m_FrameRect.h,
                             0,  0, iDrawWidth,  iDrawHeight);
 
@@ -16118,7 +16969,7 @@ void CogeAnima::Draw(int iPosX, int iPosY, CogeFrameEffect* pGlobalEffect)
                             {
                                 if(iSrcColorKey != -1) pFreeClipboard->FillRect(iSrcColorKey, 0, 0, iDrawWidth, iDrawHeight);
 
-                                pFreeClipboard->BltStretch( pCurrentClipboard,
+                                DrawScaled(pFreeClipboard, pCurrentClipboard,
                                 0,  0, m_FrameRect.w, m_FrameRect.h,
                                 0,  0, iDrawWidth, iDrawHeight);
 
@@ -16128,7 +16979,7 @@ void CogeAnima::Draw(int iPosX, int iPosY, CogeFrameEffect* pGlobalEffect)
                             }
                             else
                             {
-                                pMainScreen->BltStretch( pCurrentClipboard,
+                                DrawScaled(pMainScreen, pCurrentClipboard,
                                  0,  0,  m_FrameRect.w,  m_FrameRect.h,
                                 iDrawX,  iDrawY, iDrawX + iDrawWidth,  iDrawY + iDrawHeight);
                             }
@@ -16139,7 +16990,7 @@ void CogeAnima::Draw(int iPosX, int iPosY, CogeFrameEffect* pGlobalEffect)
                             if(iSrcColorKey != -1)
                             pFreeClipboard->FillRect(iSrcColorKey, 0, 0, iDrawWidth, iDrawHeight);
 
-                            pFreeClipboard->BltStretch( pCurrentClipboard,
+                            DrawScaled(pFreeClipboard, pCurrentClipboard,
                             0,  0, m_FrameRect.w, m_FrameRect.h,
                             0,  0, iDrawWidth, iDrawHeight);
 
@@ -16197,42 +17048,7 @@ void CogeAnima::Draw(int iPosX, int iPosY, CogeFrameEffect* pGlobalEffect)
                 break;
                 }
 
-                if(pEffect->effect_value != pEffect->end_value)
-                {
-                    //pEffect->time += m_pEngine->m_iFrameInterval;
-                    pEffect->time += m_pEngine->m_iCurrentInterval;
-                    if (pEffect->time >= pEffect->interval)
-                    {
-                        if(pEffect->step_value > 0)
-                        {
-                            if(pEffect->effect_value < pEffect->end_value)
-                            pEffect->effect_value = pEffect->effect_value + pEffect->step_value;
-
-                            if(pEffect->effect_value > pEffect->end_value)
-                            pEffect->effect_value = pEffect->end_value;
-                        }
-                        else if(pEffect->step_value < 0)
-                        {
-                            if(pEffect->effect_value > pEffect->end_value)
-                            pEffect->effect_value = pEffect->effect_value + pEffect->step_value;
-
-                            if(pEffect->effect_value < pEffect->end_value)
-                            pEffect->effect_value = pEffect->end_value;
-                        }
-
-                        pEffect->time = 0;
-                    }
-                }
-                else
-                {
-                    if(pEffect->repeat_times != 0)
-                    {
-                        pEffect->effect_value = pEffect->start_value;
-                        if(pEffect->repeat_times > 0) pEffect->repeat_times = pEffect->repeat_times - 1;
-                        //else pEffect->repeat_times = 0;
-                    }
-                    else pEffect->active = false;
-                }
+                UpdateEffect(pEffect);
 
                 it++;
             }
@@ -16316,6 +17132,7 @@ void CogeAnima::Draw(int iPosX, int iPosY, CogeFrameEffect* pGlobalEffect)
 
                 int iEffectValue = (int)pEffect->effect_value;
 
+                if(!DrawCached(pFrameEffect, iPosX, iPosY, false))
                 switch(pEffect->effect_type)
                 {
                 case Effect_Edge:
@@ -16358,7 +17175,7 @@ void CogeAnima::Draw(int iPosX, int iPosY, CogeFrameEffect* pGlobalEffect)
                     iDrawHeight = lround(m_FrameRect.h * pEffect->effect_value);
                     int iDrawX  = iPosX + (m_FrameRect.w >> 1) - (iDrawWidth  >> 1);
                     int iDrawY  = iPosY + (m_FrameRect.h >> 1) - (iDrawHeight >> 1);
-                    pMainScreen->BltStretch( m_pImage,
+                    DrawScaled(pMainScreen, m_pImage,
                     m_FrameRect.x,  m_FrameRect.y,  m_FrameRect.x+m_FrameRect.w,  m_FrameRect.y+m_FrameRect.h,
                     iDrawX,  iDrawY, iDrawX + iDrawWidth,  iDrawY + iDrawHeight);
                 }
@@ -16370,45 +17187,12 @@ void CogeAnima::Draw(int iPosX, int iPosY, CogeFrameEffect* pGlobalEffect)
                 break;
                 }
 
-                if(pEffect->effect_value != pEffect->end_value)
-                {
-                    //pEffect->time += m_pEngine->m_iFrameInterval;
-                    pEffect->time += m_pEngine->m_iCurrentInterval;
-                    if (pEffect->time >= pEffect->interval)
-                    {
-                        if(pEffect->step_value > 0)
-                        {
-                            if(pEffect->effect_value < pEffect->end_value)
-                            pEffect->effect_value = pEffect->effect_value + pEffect->step_value;
-
-                            if(pEffect->effect_value > pEffect->end_value)
-                            pEffect->effect_value = pEffect->end_value;
-                        }
-                        else if(pEffect->step_value < 0)
-                        {
-                            if(pEffect->effect_value > pEffect->end_value)
-                            pEffect->effect_value = pEffect->effect_value + pEffect->step_value;
-
-                            if(pEffect->effect_value < pEffect->end_value)
-                            pEffect->effect_value = pEffect->end_value;
-                        }
-
-                        pEffect->time = 0;
-                    }
-                }
-                else
-                {
-                    if(pEffect->repeat_times != 0)
-                    {
-                        pEffect->effect_value = pEffect->start_value;
-                        if(pEffect->repeat_times > 0) pEffect->repeat_times = pEffect->repeat_times - 1;
-                        //else pEffect->repeat_times = 0;
-                    }
-                    else pEffect->active = false;
-                }
+                UpdateEffect(pEffect);
 
             }
 
+            if(iFrameEffectCount > 1 && (DrawCached(pFrameEffect, iPosX, iPosY) || DrawFused(pFrameEffect, iPosX, iPosY))) return;
+
             if(iFrameEffectCount > 1 && pClipboardA && pClipboardB)
             {
                 CogeImage* pCurrentClipboard = NULL;
@@ -16723,7 +17507,7 @@ void CogeAnima::Draw(int iPosX, int iPosY, CogeFrameEffect* pGlobalEffect)
                                 int iDrawX  = iPosX + (m_FrameRect.w >> 1) - (iDrawWidth  >> 1);
                                 int iDrawY  = iPosY + (m_FrameRect.h >> 1) - (iDrawHeight >> 1);
 
-                                pMainScreen->BltStretch( m_pImage,
+                                DrawScaled(pMainScreen, m_pImage,
                                  m_FrameRect.x,  m_FrameRect.y,  m_FrameRect.x+m_FrameRect.w,  m_FrameRect.y+m_FrameRect.h,
                                 iDrawX,  iDrawY, iDrawX + iDrawWidth,  iDrawY + iDrawHeight);
                             }
@@ -16732,7 +17516,7 @@ void CogeAnima::Draw(int iPosX, int iPosY, CogeFrameEffect* pGlobalEffect)
                                 pCurrentClipboard = pClipboardA;
                                 if(iSrcColorKey != -1)
                                 pCurrentClipboard->FillRect(iSrcColorKey, 0, 0, iDrawWidth, iDrawHeight);
-                                pCurrentClipboard->BltStretch( m_pImage,
+                                DrawScaled(pCurrentClipboard, m_pImage,
                                  m_FrameRect.x,  m_FrameRect.y,  m_FrameRect.x+m_FrameRect.w,  m_FrameRect.y+m_FrameRect.h,
                                 0,  0, iDrawWidth,  iDrawHeight);
 
@@ -16752,7 +17536,7 @@ void CogeAnima::Draw(int iPosX, int iPosY, CogeFrameEffect* pGlobalEffect)
                                 int iDrawX  = iPosX + (m_FrameRect.w >> 1) - (iDrawWidth  >> 1);
                                 int iDrawY  = iPosY + (m_FrameRect.h >> 1) - (iDrawHeight >> 1);
 
-                                pMainScreen->BltStretch( pCurrentClipboard,
+                                DrawScaled(pMainScreen, pCurrentClipboard,
                                  0,  0,  m_FrameRect.w,  m_FrameRect.h,
                                 iDrawX,  iDrawY, iDrawX + iDrawWidth,  iDrawY + iDrawHeight);
                             }
@@ -16761,7 +17545,7 @@ void CogeAnima::Draw(int iPosX, int iPosY, CogeFrameEffect* pGlobalEffect)
                                 if(iSrcColorKey != -1)
                                 pFreeClipboard->FillRect(iSrcColorKey, 0, 0, iDrawWidth, iDrawHeight);
 
-                                pFreeClipboard->BltStretch( pCurrentClipboard,
+                                DrawScaled(pFreeClipboard, pCurrentClipboard,
                                 0,  0, m_FrameRect.w, m_FrameRect.h,
                                 0,  0, iDrawWidth, iDrawHeight);
 
@@ -16818,43 +17602,7 @@ void CogeAnima::Draw(int iPosX, int iPosY, CogeFrameEffect* pGlobalEffect)
                     break;
                     }
 
-                    if(pEffect->effect_value != pEffect->end_value)
-                    {
-                        //pEffect->time += m_pEngine->m_iFrameInterval;
-                        pEffect->time += m_pEngine->m_iCurrentInterval;
-                        if (pEffect->time >= pEffect->interval)
-                        {
-
-                            if(pEffect->step_value > 0)
-                            {
-                                if(pEffect->effect_value < pEffect->end_value)
-                                pEffect->effect_value = pEffect->effect_value + pEffect->step_value;
-
-                                if(pEffect->effect_value > pEffect->end_value)
-                                pEffect->effect_value = pEffect->end_value;
-                            }
-                            else if(pEffect->step_value < 0)
-                            {
-                                if(pEffect->effect_value > pEffect->end_value)
-                                pEffect->effect_value = pEffect->effect_value + pEffect->step_value;
-
-                                if(pEffect->effect_value < pEffect->end_value)
-                                pEffect->effect_value = pEffect->end_value;
-                            }
-
-                            pEffect->time = 0;
-                        }
-                    }
-                    else
-                    {
-                        if(pEffect->repeat_times != 0)
-                        {
-                            pEffect->effect_value = pEffect->start_value;
-                            if(pEffect->repeat_times > 0) pEffect->repeat_times = pEffect->repeat_times - 1;
-                            //else pEffect->repeat_times = 0;
-                        }
-                        else pEffect->active = false;
-                    }
+                    UpdateEffect(pEffect);
 
                     it++;
                 }
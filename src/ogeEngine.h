@@ -836,6 +836,9 @@ private:
     bool m_bShowMousePos;
 
     bool m_bUseDirtyRect;
+    bool m_bUseScrollReuse;
+
+    int m_iSpriteTileSize;
 
     bool m_bEnableInput;
 
@@ -897,6 +900,16 @@ private:
     int  m_iCycleInterval;
     int  m_iCurrentInterval;
 
+    Uint64 m_iLastCycleCounter;  // when the last cycle started (see OGE_GetPerfCounter())
+    Uint64 m_iCycleTicks;        // the locked cycle interval in the ticks of the counter
+    Uint64 m_iIntervalRest;      // the part of a ms which is carried to the next interval
+
+    int    m_iLockedUPS;         // the fixed updates per second, 0 = off
+    Uint64 m_iStepTicks;         // the length of an update in the ticks of the counter
+    Uint64 m_iStepTime;          // the time which has not been updated yet
+    int    m_iDrawInterval;      // the ms which have been updated since the last draw
+    double m_dFrameAlpha;
+
 
     int LoadLibraries();
 
@@ -928,7 +941,11 @@ private:
     bool HandleIMEvents();
     void HandleEngineEvents();
     void HandleNetworkEvents();
-    void UpdateActiveScene();
+    void UpdateActiveScene(bool bLogic = true, bool bDraw = true);
+
+    int CounterToMS(Uint64 iTicks);
+    void CountCycle();
+    void RunFixedSteps();
 
     int GetValidPackedFilePathLength(const std::string& sResFilePath);
 
@@ -996,6 +1013,14 @@ public:
     int GetGameUpdateInterval();
     int GetCurrentInterval();
 
+    /* the fixed timestep: the scene is updated iUPS times a second (each time for the same 1000/iUPS ms)
+       and drawn once after the updates or when the next frame is due (if the fps is locked), 0 = off
+    */
+    int GetLockedUPS();
+    void LockUPS(int iUPS);
+    // how far the time is into the next update (0 - 1), to draw things between where they were and where they are going
+    double GetFrameAlpha();
+
     void DrawFPS(int x=0, int y=0);
     void DrawMousePos(int x=0, int y=0);
     void DrawVideoMode(int x=0, int y=0);
@@ -1017,6 +1042,15 @@ public:
     bool IsDirtyRectMode();
     void SetDirtyRectMode(bool bValue);
 
+    // keeps the last frame on the screen when the view scrolls a little, only the strips scrolled in are redrawn
+    // (it works on top of the dirty rect mode, so it turns that on too)
+    bool IsScrollReuseMode();
+    void SetScrollReuseMode(bool bValue);
+
+    // draws the plain frames of the sprites tile by tile on the fx threads (see CogeTileRenderer), 0 turns it off
+    int GetSpriteTileSize();
+    void SetSpriteTileSize(int iTileSize);
+
     bool IsUnicodeIM();
     bool IsInputMethodReady();
 
@@ -1440,6 +1474,10 @@ private:
 
     CogeImage*       m_pLightMap;
 
+    CogeLightBuffer* m_pLightBuffer; // the light of the frame at a quarter of the resolution
+
+    CogeTileRenderer* m_pTileRenderer; // the sprite draws of the frame in tiles
+
     CogeImage*       m_pFadeMask;
 
     CogeGameMap*     m_pMap;
@@ -1508,6 +1546,13 @@ private:
     ogeRectList      m_DirtyRects;
 
     CogeRect         m_SceneViewRect;
+    CogeRect         m_LastViewRect;    // the view of the last drawn frame
+    CogeRect         m_ScrollRects[2];  // the strips scrolled into the view since the last frame
+
+    std::vector<CogeRect> m_LeftRects;  // where the things going with the view were drawn before it moved
+
+    std::vector<CogeRect> m_UpdateRects; // what the frame has redrawn, for the upload of the view
+    bool             m_bUpdateAll;       // the whole view may have changed
 
     CogeRect         m_FPSInfoRect;
     CogeRect         m_VideoModeInfoRect;
@@ -1601,10 +1646,16 @@ private:
 
     void ValidateViewRect();
 
+    void AddScrollRects();
+    void AddLeftRect(const CogeRect& rc);
+    void CollectUpdateRects();
+
     void DrawBackground();
 
     void UpdateSprites();
+    CogeTileRenderer* PrepareTileRenderer();
     void DrawSprites();
+    void KeepDrawnRects();
     void DrawInfo();
 
     void PrepareLightMap();
@@ -1792,7 +1843,11 @@ public:
     bool IsTimerWaiting();
 
 
-    int Update();
+    void UpdateLogic();
+    void DrawScene();
+
+    // the logic (sprites, events, timers) and the drawing of a cycle, the fixed timestep runs them apart
+    int Update(bool bLogic = true, bool bDraw = true);
 
 
     friend class CogeEngine;
@@ -2267,6 +2322,9 @@ public:
     int CallEvent(int iEventCode);
     void CallBaseEvent();
 
+    // a script (or a plot) is waiting for the event
+    bool HasEventHandler(int iEventCode);
+
     //int LoadScript(const std::string& sScriptName);
     int LoadLocalScript(CogeIniFile* pIniFile, const std::string& sSectionName);
 
@@ -2470,6 +2528,9 @@ public:
 
     void Draw();
 
+    // records the plain frame of the sprite, returns false if it must be drawn by Draw()
+    bool RecordDraw(CogeTileRenderer* pRenderer);
+
     void DefaultDraw();
 
     friend class CogeEngine;
@@ -2575,6 +2636,28 @@ private:
 
     void DelAllEffects();
 
+    // steps the value of an effect (or replays or ends it)
+    void UpdateEffect(CogeEffect* pEffect);
+
+    // steps the active effects which are drawn (the ones up to the alpha one)
+    void UpdateEffects(CogeFrameEffect* pEffects);
+
+    // fills the shared color chain of the video and the geometry with the effects,
+    // returns false if they can not be drawn in one pass
+    bool PrepareFused(CogeFrameEffect* pEffects, double& fAngle, int& iDrawWidth, int& iDrawHeight, int& iAlpha);
+
+    // draws the frame with all the active effects in one pass if they can go together,
+    // returns false (and draws nothing) if they need the clipboards
+    bool DrawFused(CogeFrameEffect* pEffects, int iPosX, int iPosY, bool bUpdate = true);
+
+    // draws the transformed frame from the frame cache of the video (makes it first if it is not there),
+    // returns false (and draws nothing) if the cache is off or can not keep the frame
+    bool DrawCached(CogeFrameEffect* pEffects, int iPosX, int iPosY, bool bUpdate = true);
+
+    // the scale effect, smoothly if the video is set to (see CogeVideo::SetSmoothScaling())
+    void DrawScaled(CogeImage* pDstImage, CogeImage* pSrcImage, int iSrcLeft, int iSrcTop, int iSrcRight, int iSrcBottom,
+                    int iDstLeft, int iDstTop, int iDstRight, int iDstBottom);
+
 
 protected:
 
@@ -2603,6 +2686,9 @@ public:
 
     void Draw(int iPosX, int iPosY, CogeFrameEffect* pGlobalEffect = NULL);
 
+    // records the frame if no effect is on, returns false if it must be drawn by Draw()
+    bool Record(CogeTileRenderer* pRenderer, int iPosX, int iPosY, CogeFrameEffect* pGlobalEffect = NULL);
+
 
     friend class CogeVideo;
     friend class CogeSprite;
@@ -31,10 +31,39 @@ THE SOFTWARE.
 
 #include <stdint.h>
 
+#define _OGE_FX_BACKEND_C_      0
+#define _OGE_FX_BACKEND_MMX_    1
+#define _OGE_FX_BACKEND_SSE2_   2
+#define _OGE_FX_BACKEND_AVX2_   3
+
 int OGE_FX_CheckMMX();
 
 int OGE_FX_Init();
 
+/* the backend (_OGE_FX_BACKEND_XXX_) which is running the blit kernels,
+   OGE_FX_Init() selects the best one supported by current cpu,
+   OGE_FX_SetBackend() falls back to a slower one if the required one is not available and returns the one selected
+*/
+int OGE_FX_GetBestBackend();
+int OGE_FX_GetBackend();
+int OGE_FX_SetBackend(int iBackend);
+
+/* worker threads for the big fx operations, a call covering at least iMinPixels pixels is split into row bands
+   and runs on iThreads threads (the calling one included), the output is always the same as the single thread one,
+   iThreads = 0 or 1 turns it off, a negative iThreads means one thread per cpu, returns the number of threads in use
+*/
+int OGE_FX_SetThreads(int iThreads, int iMinPixels);
+int OGE_FX_GetThreads();
+int OGE_FX_GetThreadPixels();
+
+// runs a part [iFromRow, iToRow) of a task
+typedef void (*ogeFXBandProc)(void* pTask, int iFromRow, int iToRow);
+
+/* splits the rows [0, iRows) of a task into bands and runs them on the fx threads (see OGE_FX_SetThreads()),
+   returns false if the threads are off or busy (then the caller should run the task by itself)
+*/
+bool OGE_FX_RunBands(ogeFXBandProc pProc, void* pTask, int iRows);
+
 int OGE_FX_Saturate(int i, int iMax);
 
 void OGE_FX_SetPixel16(uint8_t* pBase, int iDelta, int iX, int iY, uint16_t iColor);
@@ -100,14 +129,52 @@ void OGE_FX_BltChangedRGB(uint8_t* pDstData, int iDstLineSize,
                       int iWidth, int iHeight, int iBPP,
                       int iRedAmount, int iGreenAmount, int iBlueAmount);
 
+/* a chain of color adjustments compiled into lookup tables (one table per channel for 32 bpp, a 64K one for 16 bpp),
+   so the whole chain costs one pass, the result is the same as running the adjustments one by one,
+   except that the other byte (alpha) of a 32 bpp pixel is kept
+*/
+#define _OGE_FX_COLOR_LIGHTNESS_    1  // iAmount1 (see OGE_FX_Lightness())
+#define _OGE_FX_COLOR_SUBLIGHT_     2  // iAmount1 (see OGE_FX_SubLight())
+#define _OGE_FX_COLOR_RGB_          3  // iAmount1, iAmount2, iAmount3: red, green, blue (see OGE_FX_ChangeColorRGB())
+#define _OGE_FX_COLOR_GRAYSCALE_    4  // (see OGE_FX_Grayscale())
+#define _OGE_FX_COLOR_GRAYLEVEL_    5  // iAmount1 (see OGE_FX_ChangeGrayLevel())
+#define _OGE_FX_COLOR_BLEND_        6  // iAmount1: color, iAmount2: alpha (see OGE_FX_BltWithColor())
+
+struct CogeFXColorTransform;
+CogeFXColorTransform* OGE_FX_NewColorTransform();
+void OGE_FX_FreeColorTransform(CogeFXColorTransform* pTransform);
+void OGE_FX_ClearColorTransform(CogeFXColorTransform* pTransform);
+// appends an adjustment to the chain, returns the length of the chain, or -1 if it is full (16) or the type is unknown
+int OGE_FX_AddColorAdjustment(CogeFXColorTransform* pTransform, int iType,
+                int iAmount1 = 0, int iAmount2 = 0, int iAmount3 = 0);
+int OGE_FX_GetColorTransformLength(CogeFXColorTransform* pTransform);
+
+void OGE_FX_ColorTransform(uint8_t* pDstData, int iDstLineSize,
+                int iDstX, int iDstY,
+                int iWidth, int iHeight, int iBPP, CogeFXColorTransform* pTransform);
+
+void OGE_FX_BltColorTransform(uint8_t* pDstData, int iDstLineSize,
+                int iDstX, int iDstY,
+                uint8_t* pSrcData, int iSrcLineSize, int iSrcColorKey,
+                int iSrcX, int iSrcY,
+                int iWidth, int iHeight, int iBPP, CogeFXColorTransform* pTransform);
+
 void OGE_FX_SplitBlur(uint8_t* pDstData, int iDstLineSize,
                       int iDstX, int iDstY,
                       int iWidth, int iHeight, int iBPP, int iAmount);
 
+/* separable blur (three box passes), the cost per pixel does not depend on iAmount,
+   the strength of iAmount is about the same as the one of OGE_FX_IteratedBlur() (which is still used for iAmount < 4)
+*/
 void OGE_FX_GaussianBlur(uint8_t* pDstData, int iDstLineSize,
                           int iDstX, int iDstY,
                           int iWidth, int iHeight, int iBPP, int iAmount);
 
+// the old blur, runs OGE_FX_SplitBlur() iAmount times
+void OGE_FX_IteratedBlur(uint8_t* pDstData, int iDstLineSize,
+                          int iDstX, int iDstY,
+                          int iWidth, int iHeight, int iBPP, int iAmount);
+
 void OGE_FX_AlphaBlend(uint8_t* pDstData, int iDstLineSize,
                 int iDstX, int iDstY,
                 uint8_t* pSrcData, int iSrcLineSize, int iSrcColorKey,
@@ -121,6 +188,35 @@ void OGE_FX_LightMaskBlend(uint8_t* pDstData, int iDstLineSize,
                 int iSrcX, int iSrcY,
                 int iWidth, int iHeight, int iBPP);
 
+/* light buffers: one darkness byte (the blue channel of a light mask, 0 .. 255) per 4x4 pixels
+
+   OGE_FX_DownsampleLight() averages a light mask into the cells of a light buffer, the mask starts at the pixel
+   (iPhaseX, iPhaseY) of the first cell and the pixels of the cells out of the mask count as iOutside,
+   the light buffer gets (iWidth + iPhaseX + 3) / 4 columns and (iHeight + iPhaseY + 3) / 4 rows
+
+   OGE_FX_AddLight() lights the cells of a light buffer (iCols x iRows) with a downsampled light mask at (iDstX, iDstY),
+   the same way as OGE_FX_LightMaskBlend() does with the pixels
+
+   OGE_FX_LightBlend() darkens a rect by a light buffer bilinearly upsampled x4 (as OGE_FX_LightMaskBlend() would do
+   with a full size light mask), (iLightX, iLightY) is the pixel of the light buffer at (iDstX, iDstY)
+*/
+void OGE_FX_DownsampleLight(uint8_t* pLightData, int iLightLineSize,
+                uint8_t* pSrcData, int iSrcLineSize,
+                int iSrcX, int iSrcY,
+                int iWidth, int iHeight, int iBPP,
+                int iPhaseX, int iPhaseY, int iOutside);
+
+void OGE_FX_AddLight(uint8_t* pLightData, int iLightLineSize, int iCols, int iRows,
+                int iDstX, int iDstY,
+                uint8_t* pSrcData, int iSrcLineSize,
+                int iWidth, int iHeight);
+
+void OGE_FX_LightBlend(uint8_t* pDstData, int iDstLineSize,
+                int iDstX, int iDstY,
+                int iWidth, int iHeight, int iBPP,
+                uint8_t* pLightData, int iLightLineSize, int iCols, int iRows,
+                int iLightX, int iLightY);
+
 void OGE_FX_BltMask(uint8_t* pDstData, int iDstLineSize,
                 int iDstX, int iDstY,
                 uint8_t* pSrcData, int iSrcLineSize,
@@ -140,11 +236,59 @@ void OGE_FX_BltStretch(uint8_t* pDstData, int iDstLineSize,
                 uint8_t* pSrcData, int iSrcLineSize, int iSrcColorKey,
                 int iSrcX, int iSrcY, uint32_t iSrcWidth, uint32_t iSrcHeight, int iBPP);
 
+/* scales src to the dst rect (iDstWidth x iDstHeight) with weights computed once per column and per row,
+   bilinear on an axis which grows and box filter (area averaging) on an axis which shrinks,
+   only the part (iClipX, iClipY, iClipWidth, iClipHeight) of the dst rect (relative to it) is drawn,
+   with a color key the pixels mostly covered by it are skipped and the others get the average of the rest
+   (16 or 32 bpp, src and dst must not overlap)
+*/
+void OGE_FX_BltScale(uint8_t* pDstData, int iDstLineSize,
+                int iDstX, int iDstY, int iDstWidth, int iDstHeight,
+                int iClipX, int iClipY, int iClipWidth, int iClipHeight,
+                uint8_t* pSrcData, int iSrcLineSize, int iSrcColorKey,
+                int iSrcX, int iSrcY, int iSrcWidth, int iSrcHeight, int iBPP);
+
+// the filters of OGE_FX_BltPresent()
+#define _OGE_FX_PRESENT_NEAREST_    0  // each pixel is replicated (a column map is used if the ratio is not an integer)
+#define _OGE_FX_PRESENT_PIXELART_   1  // scale2x (even ratios) or scale3x (ratios of 3, 9 ...), nearest for the others
+#define _OGE_FX_PRESENT_SMOOTH_     2  // OGE_FX_BltScale()
+
+/* scales the screen (src) to the whole dst rect, meant for the presenting of a frame to a bigger window,
+   the rows which come from the same src row are copied instead of being scaled again (16 or 32 bpp)
+*/
+void OGE_FX_BltPresent(uint8_t* pDstData, int iDstLineSize,
+                int iDstX, int iDstY, int iDstWidth, int iDstHeight,
+                uint8_t* pSrcData, int iSrcLineSize,
+                int iSrcX, int iSrcY, int iSrcWidth, int iSrcHeight, int iBPP, int iFilter);
+
+/* converts pixels from one format to another, the formats are given by their masks (red, green, blue, alpha),
+   src may be 8 bpp with pPalette (iPaletteSize colors as 0xAARRGGBB), 24 bpp (little endian) or 32 bpp
+   with 8 bit channels, dst may be 16 or 32 bpp, the alpha of dst is full if src has none,
+   returns false if the formats are not supported (then nothing is written)
+*/
+bool OGE_FX_ConvertPixels(uint8_t* pDstData, int iDstLineSize, int iDstBPP, const uint32_t* pDstMasks,
+                uint8_t* pSrcData, int iSrcLineSize, int iSrcBPP, const uint32_t* pSrcMasks,
+                const uint32_t* pPalette, int iPaletteSize,
+                int iWidth, int iHeight);
+
+/* rotates (and zooms, iZoom is 16.16 and 65536 means 1:1, a bigger one gives a smaller image) src around the center,
+   each row only walks the part of dst which the rotated src covers, bBilinear smooths the pixels (16 or 32 bpp)
+*/
 void OGE_FX_BltRotate(uint8_t* pDstData, int iDstLineSize,
                 int iDstX, int iDstY, uint32_t iDstWidth, uint32_t iDstHeight,
                 uint8_t* pSrcData, int iSrcLineSize,
                 int iSrcX, int iSrcY, uint32_t iSrcWidth, uint32_t iSrcHeight, int iBPP,
-                int iSrcColorKey, double fAngle, int iZoom = 65536);
+                int iSrcColorKey, double fAngle, int iZoom = 65536, bool bBilinear = false);
+
+/* draws src into the dst rect with the effects of a sprite in one pass, row by row:
+   a dst rect of the src size rotates src by fAngle (bBilinear smooths it), another size stretches src,
+   then the colors go through pTransform (may be NULL) and the row is blended with iAlpha (255 is a copy)
+*/
+void OGE_FX_BltFused(uint8_t* pDstData, int iDstLineSize, int iDstClipWidth, int iDstClipHeight,
+                int iDstX, int iDstY, int iDstWidth, int iDstHeight,
+                uint8_t* pSrcData, int iSrcLineSize, int iSrcColorKey,
+                int iSrcX, int iSrcY, int iSrcWidth, int iSrcHeight, int iBPP,
+                double fAngle, bool bBilinear, CogeFXColorTransform* pTransform, int iAlpha);
 
 void OGE_FX_BltSquareWave(uint8_t* pDstData, int iDstLineSize,
                 int iDstX, int iDstY,
@@ -160,6 +304,13 @@ void OGE_FX_BltRoundWave(uint8_t* pDstData, int iDstLineSize,
                 int iWidth, int iHeight, int iBPP, int iSrcColorKey,
                 double iXAmount, double iYAmount, double iZAmount, int iXSteps = 0, int iYSteps = 0); // iAmount: 1~50
 
+/* the wave blits read their displacements lround(sin(k / fPeriod) * fAmount) from cached tables,
+   OGE_FX_PrepareWave() builds the table of k = iFromSteps ~ iToSteps + iLength - 1 at once
+   (e.g. fPeriod = iXAmount, iLength = iHeight and the range of iYSteps for the rows of OGE_FX_BltRoundWave())
+*/
+void OGE_FX_PrepareWave(double fPeriod, double fAmount, int iFromSteps, int iToSteps, int iLength);
+void OGE_FX_FreeWaves();
+
 
 void OGE_FX_BltWithEdge(uint8_t* pDstData, int iDstLineSize,
                 int iDstX, int iDstY,
@@ -174,6 +325,133 @@ void OGE_FX_BltWithColor(uint8_t* pDstData, int iDstLineSize,
                 int iWidth, int iHeight, int iBPP, int iColor, int iAlpha);
 
 
+/* premultiplied alpha (32 bpp only), iAlphaShift is the bit position of the alpha channel (0, 8, 16 or 24),
+   OGE_FX_Premultiply() multiplies the other 3 channels of each pixel by its alpha, OGE_FX_Unpremultiply() reverts it
+   (the colors of the pixels with a small alpha may lose some precision)
+*/
+void OGE_FX_Premultiply(uint8_t* pDstData, int iDstLineSize,
+                int iDstX, int iDstY,
+                int iWidth, int iHeight, int iBPP, int iAlphaShift);
+
+void OGE_FX_Unpremultiply(uint8_t* pDstData, int iDstLineSize,
+                int iDstX, int iDstY,
+                int iWidth, int iHeight, int iBPP, int iAlphaShift);
+
+/* draws a premultiplied image with its per-pixel alpha multiplied by the global iAlpha (dst = src * iAlpha + dst * (1 - a)),
+   both images must be 32 bpp with the same channel order, the alpha byte of dst is blended too
+*/
+void OGE_FX_BltPremultiplied(uint8_t* pDstData, int iDstLineSize,
+                int iDstX, int iDstY,
+                uint8_t* pSrcData, int iSrcLineSize,
+                int iSrcX, int iSrcY,
+                int iWidth, int iHeight, int iBPP, int iAlphaShift, uint8_t iAlpha = 255);
+
+
+/* run-length encoded color key image (16 or 32 bpp), only the opaque runs of each row and their pixels are kept,
+   so the span blits below never test the color key and skip the transparent parts at once,
+   OGE_FX_BuildSpans() returns NULL if the bpp is not supported or there is no color key
+*/
+struct CogeFXSpans;
+
+CogeFXSpans* OGE_FX_BuildSpans(uint8_t* pSrcData, int iSrcLineSize,
+                int iWidth, int iHeight, int iBPP, int iColorKey);
+
+void OGE_FX_FreeSpans(CogeFXSpans* pSpans);
+
+// memory used by the spans (in bytes)
+int OGE_FX_GetSpansSize(CogeFXSpans* pSpans);
+
+// writes the whole image back (the transparent parts are filled with iColorKey)
+void OGE_FX_UnpackSpans(uint8_t* pDstData, int iDstLineSize,
+                CogeFXSpans* pSpans, int iColorKey);
+
+void OGE_FX_SpanBlt(uint8_t* pDstData, int iDstLineSize,
+                int iDstX, int iDstY,
+                CogeFXSpans* pSrcSpans,
+                int iSrcX, int iSrcY,
+                int iWidth, int iHeight);
+
+void OGE_FX_SpanAlphaBlend(uint8_t* pDstData, int iDstLineSize,
+                int iDstX, int iDstY,
+                CogeFXSpans* pSrcSpans,
+                int iSrcX, int iSrcY,
+                int iWidth, int iHeight, uint8_t iAlpha);
+
+void OGE_FX_SpanBltLightness(uint8_t* pDstData, int iDstLineSize,
+                int iDstX, int iDstY,
+                CogeFXSpans* pSrcSpans,
+                int iSrcX, int iSrcY,
+                int iWidth, int iHeight, int iAmount);
+
+void OGE_FX_SpanBltChangedRGB(uint8_t* pDstData, int iDstLineSize,
+                int iDstX, int iDstY,
+                CogeFXSpans* pSrcSpans,
+                int iSrcX, int iSrcY,
+                int iWidth, int iHeight,
+                int iRedAmount, int iGreenAmount, int iBlueAmount);
+
+void OGE_FX_SpanBltWithColor(uint8_t* pDstData, int iDstLineSize,
+                int iDstX, int iDstY,
+                CogeFXSpans* pSrcSpans,
+                int iSrcX, int iSrcY,
+                int iWidth, int iHeight, int iColor, int iAlpha);
+
+
+/* 8 bit indexed image (16 or 32 bpp), the pixels are indexes into a palette of up to 256 colors in the pixel format,
+   OGE_FX_BuildIndexed() returns NULL if the bpp is not supported or the image has more than 256 colors,
+   the pixels of the color key (if any) are never drawn, whatever its color in the palette is,
+   the functions which take a palette use the one of the image if pPalette is NULL
+*/
+struct CogeFXIndexed;
+
+CogeFXIndexed* OGE_FX_BuildIndexed(uint8_t* pSrcData, int iSrcLineSize,
+                int iWidth, int iHeight, int iBPP, int iColorKey);
+
+void OGE_FX_FreeIndexed(CogeFXIndexed* pIndexed);
+
+// memory used by the indexed image (in bytes)
+int OGE_FX_GetIndexedSize(CogeFXIndexed* pIndexed);
+
+// the number of the colors in use, the index of the color key (-1 if none) and the palette of the image (256 colors)
+int OGE_FX_GetIndexedColors(CogeFXIndexed* pIndexed);
+int OGE_FX_GetIndexedKey(CogeFXIndexed* pIndexed);
+uint8_t* OGE_FX_GetIndexedPalette(CogeFXIndexed* pIndexed);
+
+// writes the whole image back through a palette
+void OGE_FX_UnpackIndexed(uint8_t* pDstData, int iDstLineSize,
+                CogeFXIndexed* pIndexed, uint8_t* pPalette);
+
+void OGE_FX_IndexedBlt(uint8_t* pDstData, int iDstLineSize,
+                int iDstX, int iDstY,
+                CogeFXIndexed* pSrcIndexed, uint8_t* pPalette,
+                int iSrcX, int iSrcY,
+                int iWidth, int iHeight);
+
+void OGE_FX_IndexedAlphaBlend(uint8_t* pDstData, int iDstLineSize,
+                int iDstX, int iDstY,
+                CogeFXIndexed* pSrcIndexed, uint8_t* pPalette,
+                int iSrcX, int iSrcY,
+                int iWidth, int iHeight, uint8_t iAlpha);
+
+// the colors of the palette are changed instead of the pixels
+void OGE_FX_IndexedBltLightness(uint8_t* pDstData, int iDstLineSize,
+                int iDstX, int iDstY,
+                CogeFXIndexed* pSrcIndexed, uint8_t* pPalette,
+                int iSrcX, int iSrcY,
+                int iWidth, int iHeight, int iAmount);
+
+void OGE_FX_IndexedBltChangedRGB(uint8_t* pDstData, int iDstLineSize,
+                int iDstX, int iDstY,
+                CogeFXIndexed* pSrcIndexed, uint8_t* pPalette,
+                int iSrcX, int iSrcY,
+                int iWidth, int iHeight,
+                int iRedAmount, int iGreenAmount, int iBlueAmount);
+
+void OGE_FX_IndexedBltWithColor(uint8_t* pDstData, int iDstLineSize,
+                int iDstX, int iDstY,
+                CogeFXIndexed* pSrcIndexed, uint8_t* pPalette,
+                int iSrcX, int iSrcY,
+                int iWidth, int iHeight, int iColor, int iAlpha);
 
 
 #endif // __OGE_GRAPHICFX_H_INCLUDED__
@@ -0,0 +1,157 @@
+/*
+-----------------------------------------------------------------------------
+This source file is part of Open Game Engine 2D.
+It is licensed under the terms of the MIT license.
+For the latest info, see http://oge2d.sourceforge.net
+
+Copyright (c) 2010-2012 Lin Jia Jun (Joe Lam)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-----------------------------------------------------------------------------
+*/
+
+// premultiplied alpha images, shared by the c and the mmx backends
+
+#include "ogeGraphicFX_Kernel.h"
+
+// x / 255 with rounding for the 2 bytes of each 16 bit half (x <= 255 * 255 in each half)
+static inline uint32_t OGE_FX_Div255x2(uint32_t x)
+{
+    x += 0x00800080;
+    return ((x + ((x >> 8) & 0x00ff00ff)) >> 8) & 0x00ff00ff;
+}
+
+// all the 4 bytes of c multiplied by iAmount / 255
+static inline uint32_t OGE_FX_Scale8888(uint32_t c, uint32_t iAmount)
+{
+    return OGE_FX_Div255x2((c & 0x00ff00ff) * iAmount) |
+          (OGE_FX_Div255x2(((c >> 8) & 0x00ff00ff) * iAmount) << 8);
+}
+
+void OGE_FX_Premultiply(uint8_t* pDstData, int iDstLineSize,
+                int iDstX, int iDstY,
+                int iWidth, int iHeight, int iBPP, int iAlphaShift)
+{
+    if (iBPP != 32) return;
+
+    uint32_t iAlphaMask = 0xff << iAlphaShift;
+
+    pDstData += iDstY * iDstLineSize + iDstX * 4;
+
+    while(iHeight > 0)
+    {
+        uint32_t* pDst = (uint32_t*) pDstData;
+
+        for(int i=0; i<iWidth; i++)
+        {
+            uint32_t c = pDst[i];
+            uint32_t a = (c & iAlphaMask) >> iAlphaShift;
+
+            if (a == 255) continue;
+
+            pDst[i] = (OGE_FX_Scale8888(c, a) & ~iAlphaMask) | (c & iAlphaMask);
+        }
+
+        pDstData += iDstLineSize;
+
+        iHeight--;
+    }
+}
+
+void OGE_FX_Unpremultiply(uint8_t* pDstData, int iDstLineSize,
+                int iDstX, int iDstY,
+                int iWidth, int iHeight, int iBPP, int iAlphaShift)
+{
+    if (iBPP != 32) return;
+
+    uint32_t iAlphaMask = 0xff << iAlphaShift;
+
+    pDstData += iDstY * iDstLineSize + iDstX * 4;
+
+    while(iHeight > 0)
+    {
+        uint32_t* pDst = (uint32_t*) pDstData;
+
+        for(int i=0; i<iWidth; i++)
+        {
+            uint32_t c = pDst[i];
+            uint32_t a = (c & iAlphaMask) >> iAlphaShift;
+
+            if (a == 255 || a == 0) continue;
+
+            uint32_t iResult = c & iAlphaMask;
+
+            for(int iShift=0; iShift<32; iShift+=8)
+            {
+                if (iShift == iAlphaShift) continue;
+
+                uint32_t v = (((c >> iShift) & 0xff) * 255 + (a >> 1)) / a;
+                if (v > 255) v = 255;
+
+                iResult |= v << iShift;
+            }
+
+            pDst[i] = iResult;
+        }
+
+        pDstData += iDstLineSize;
+
+        iHeight--;
+    }
+}
+
+void OGE_FX_C_BltPremultiplied(uint8_t* pDstData, int iDstLineSize,
+                int iDstX, int iDstY,
+                uint8_t* pSrcData, int iSrcLineSize,
+                int iSrcX, int iSrcY,
+                int iWidth, int iHeight, int iBPP, int iAlphaShift, uint8_t iAlpha)
+{
+    if (iBPP != 32 || iAlpha == 0) return;
+
+    uint32_t iAlphaMask = 0xff << iAlphaShift;
+
+    pDstData += iDstY * iDstLineSize + iDstX * 4;
+    pSrcData += iSrcY * iSrcLineSize + iSrcX * 4;
+
+    while(iHeight > 0)
+    {
+        uint32_t* pSrc = (uint32_t*) pSrcData;
+        uint32_t* pDst = (uint32_t*) pDstData;
+
+        for(int i=0; i<iWidth; i++)
+        {
+            uint32_t s = pSrc[i];
+
+            // the global alpha scales all the channels of a premultiplied pixel
+            if (iAlpha != 255) s = OGE_FX_Scale8888(s, iAlpha);
+
+            uint32_t a = (s & iAlphaMask) >> iAlphaShift;
+
+            if (a == 0) continue;
+
+            if (a == 255) pDst[i] = s;
+            else pDst[i] = s + OGE_FX_Scale8888(pDst[i], 255 - a);
+        }
+
+        pSrcData += iSrcLineSize;
+        pDstData += iDstLineSize;
+
+        iHeight--;
+    }
+}
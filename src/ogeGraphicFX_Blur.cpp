@@ -0,0 +1,373 @@
+/*
+-----------------------------------------------------------------------------
+This source file is part of Open Game Engine 2D.
+It is licensed under the terms of the MIT license.
+For the latest info, see http://oge2d.sourceforge.net
+
+Copyright (c) 2010-2012 Lin Jia Jun (Joe Lam)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-----------------------------------------------------------------------------
+*/
+
+// separable box blur, shared by the c and the mmx backends
+
+#include "ogeGraphicFX_Kernel.h"
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+#define _OGE_FX_BLUR_PASSES_     3
+#define _OGE_FX_BLUR_MIN_AMOUNT_ 4
+#define _OGE_FX_BLUR_MAX_AMOUNT_ 1000
+
+#if defined(__MACOSX__) || defined(__IPHONE__)
+
+static const int iBlurRedOffset   = 8;
+static const int iBlurGreenOffset = 16;
+static const int iBlurBlueOffset  = 24;
+
+#else
+
+static const int iBlurRedOffset   = 16;
+static const int iBlurGreenOffset = 8;
+static const int iBlurBlueOffset  = 0;
+
+#endif
+
+struct CogeFXBlurTask;
+
+typedef void (*ogeFXBlurProc)(CogeFXBlurTask* pTask, int iFromRow, int iToRow);
+
+struct CogeFXBlurTask
+{
+    ogeFXBlurProc pProc;
+
+    uint8_t* pDstData;
+    int      iDstLineSize;
+    int      iBPP;
+
+    uint8_t* pSrc;   // 3 bytes (b, g, r) per pixel, iWidth * iHeight pixels
+    uint8_t* pDst;
+
+    int iWidth;
+    int iHeight;
+    int iRadius;
+};
+
+static void OGE_FX_BlurUnpack(CogeFXBlurTask* pTask, int iFromRow, int iToRow)
+{
+    int iWidth = pTask->iWidth;
+
+    for(int y=iFromRow; y<iToRow; y++)
+    {
+        uint8_t* pLine = pTask->pDstData + y * pTask->iDstLineSize;
+        uint8_t* p = pTask->pSrc + y * iWidth * 3;
+
+        if (pTask->iBPP == 16)
+        {
+            uint16_t* pw = (uint16_t*) pLine;
+            for(int x=0; x<iWidth; x++)
+            {
+                int c = pw[x];
+                int b = c & 0x1f;
+                int g = (c >> 5) & 0x3f;
+                int r = c >> 11;
+                p[0] = (b << 3) | (b >> 2);
+                p[1] = (g << 2) | (g >> 4);
+                p[2] = (r << 3) | (r >> 2);
+                p += 3;
+            }
+        }
+        else
+        {
+            uint32_t* pc = (uint32_t*) pLine;
+            for(int x=0; x<iWidth; x++)
+            {
+                uint32_t c = pc[x];
+                p[0] = c >> iBlurBlueOffset;
+                p[1] = c >> iBlurGreenOffset;
+                p[2] = c >> iBlurRedOffset;
+                p += 3;
+            }
+        }
+    }
+}
+
+static void OGE_FX_BlurPack(CogeFXBlurTask* pTask, int iFromRow, int iToRow)
+{
+    int iWidth = pTask->iWidth;
+
+    for(int y=iFromRow; y<iToRow; y++)
+    {
+        uint8_t* pLine = pTask->pDstData + y * pTask->iDstLineSize;
+        uint8_t* p = pTask->pSrc + y * iWidth * 3;
+
+        if (pTask->iBPP == 16)
+        {
+            uint16_t* pw = (uint16_t*) pLine;
+            for(int x=0; x<iWidth; x++)
+            {
+                pw[x] = (p[0] >> 3) | (p[1] >> 2 << 5) | (p[2] >> 3 << 11);
+                p += 3;
+            }
+        }
+        else
+        {
+            // not support alpha channel ...
+            uint32_t* pc = (uint32_t*) pLine;
+            for(int x=0; x<iWidth; x++)
+            {
+                pc[x] = ((uint32_t)p[0] << iBlurBlueOffset)  |
+                        ((uint32_t)p[1] << iBlurGreenOffset) |
+                        ((uint32_t)p[2] << iBlurRedOffset);
+                p += 3;
+            }
+        }
+    }
+}
+
+// the sum of the window [iPos - iRadius, iPos + iRadius] of a line (the edge pixels are repeated)
+static void OGE_FX_BlurWindowSum(uint32_t* pSums, uint8_t* pLine, int iStep, int iCount,
+                                 int iLength, int iPos, int iRadius)
+{
+    int iFrom = iPos - iRadius;
+    int iTo = iPos + iRadius;
+
+    int iLow = 0, iHigh = 0;
+    if (iFrom < 0) { iLow = -iFrom; iFrom = 0; }
+    if (iTo > iLength - 1) { iHigh = iTo - iLength + 1; iTo = iLength - 1; }
+
+    for(int k=0; k<iCount; k++) pSums[k] = 0;
+
+    for(int i=iFrom; i<=iTo; i++)
+    {
+        uint8_t* p = pLine + i * iStep;
+        for(int k=0; k<iCount; k++) pSums[k] += p[k];
+    }
+
+    uint8_t* pFirst = pLine;
+    uint8_t* pLast = pLine + (iLength - 1) * iStep;
+    for(int k=0; k<iCount; k++) pSums[k] += pFirst[k] * iLow + pLast[k] * iHigh;
+}
+
+// writes one pixel and moves the window by one pixel
+#define _OGE_FX_BLUR_STEP_(pAddPixel, pSubPixel) \
+    { \
+        uint8_t* pA = (pAddPixel); \
+        uint8_t* pS = (pSubPixel); \
+        pOut[0] = (s[0] * iScale + (1 << 23)) >> 24; \
+        pOut[1] = (s[1] * iScale + (1 << 23)) >> 24; \
+        pOut[2] = (s[2] * iScale + (1 << 23)) >> 24; \
+        s[0] += pA[0] - pS[0]; \
+        s[1] += pA[1] - pS[1]; \
+        s[2] += pA[2] - pS[2]; \
+        pOut += 3; \
+    }
+
+static void OGE_FX_BlurRows(CogeFXBlurTask* pTask, int iFromRow, int iToRow)
+{
+    int iWidth = pTask->iWidth;
+    int iRadius = pTask->iRadius;
+    int iLast = iWidth - 1;
+
+    // sum * iScale never goes over 255 << 24
+    uint32_t iScale = (1 << 24) / (iRadius * 2 + 1);
+    uint32_t s[3];
+
+    for(int y=iFromRow; y<iToRow; y++)
+    {
+        uint8_t* pIn = pTask->pSrc + y * iWidth * 3;
+        uint8_t* pOut = pTask->pDst + y * iWidth * 3;
+
+        OGE_FX_BlurWindowSum(s, pIn, 3, 3, iWidth, 0, iRadius);
+
+        // the window only needs to be clamped near the two ends of the line
+        int iMidFrom = iRadius < iWidth ? iRadius : iWidth;
+        int iMidTo = iLast - iRadius;
+        if (iMidTo < iMidFrom) iMidTo = iMidFrom;
+
+        int x = 0;
+
+        for(; x<iMidFrom; x++)
+        {
+            int iAdd = x + iRadius + 1;
+            if (iAdd > iLast) iAdd = iLast;
+            _OGE_FX_BLUR_STEP_(pIn + iAdd * 3, pIn);
+        }
+
+        uint8_t* pAdd = pIn + (x + iRadius + 1) * 3;
+        uint8_t* pSub = pIn + (x - iRadius) * 3;
+
+        for(; x<iMidTo; x++)
+        {
+            _OGE_FX_BLUR_STEP_(pAdd, pSub);
+            pAdd += 3;
+            pSub += 3;
+        }
+
+        for(; x<iWidth; x++)
+        {
+            int iSub = x - iRadius;
+            if (iSub < 0) iSub = 0;
+            _OGE_FX_BLUR_STEP_(pIn + iLast * 3, pIn + iSub * 3);
+        }
+    }
+}
+
+static void OGE_FX_BlurColumns(CogeFXBlurTask* pTask, int iFromRow, int iToRow)
+{
+    int iWidth = pTask->iWidth;
+    int iHeight = pTask->iHeight;
+    int iRadius = pTask->iRadius;
+    int iLast = iHeight - 1;
+    int iLineBytes = iWidth * 3;
+
+    // sum * iScale never goes over 255 << 24
+    uint32_t iScale = (1 << 24) / (iRadius * 2 + 1);
+
+    // the sums of all columns go down the rows together, so the memory is always read by rows
+    uint32_t* pSums = new uint32_t[iLineBytes];
+
+    int iFrom = iFromRow - iRadius;
+    int iTo = iFromRow + iRadius;
+    int iLow = 0, iHigh = 0;
+    if (iFrom < 0) { iLow = -iFrom; iFrom = 0; }
+    if (iTo > iLast) { iHigh = iTo - iLast; iTo = iLast; }
+
+    memset(pSums, 0, iLineBytes * sizeof(uint32_t));
+
+    for(int j=iFrom; j<=iTo; j++)
+    {
+        uint8_t* p = pTask->pSrc + j * iLineBytes;
+        for(int k=0; k<iLineBytes; k++) pSums[k] += p[k];
+    }
+
+    uint8_t* pFirst = pTask->pSrc;
+    uint8_t* pLastRow = pTask->pSrc + iLast * iLineBytes;
+    if (iLow > 0)  for(int k=0; k<iLineBytes; k++) pSums[k] += pFirst[k] * iLow;
+    if (iHigh > 0) for(int k=0; k<iLineBytes; k++) pSums[k] += pLastRow[k] * iHigh;
+
+    for(int y=iFromRow; y<iToRow; y++)
+    {
+        uint8_t* pOut = pTask->pDst + y * iLineBytes;
+
+        int iAdd = y + iRadius + 1;
+        int iSub = y - iRadius;
+        if (iAdd > iLast) iAdd = iLast;
+        if (iSub < 0) iSub = 0;
+
+        uint8_t* pAdd = pTask->pSrc + iAdd * iLineBytes;
+        uint8_t* pSub = pTask->pSrc + iSub * iLineBytes;
+
+        for(int k=0; k<iLineBytes; k++)
+        {
+            pOut[k] = (pSums[k] * iScale + (1 << 23)) >> 24;
+            pSums[k] += pAdd[k] - pSub[k];
+        }
+    }
+
+    delete[] pSums;
+}
+
+static void OGE_FX_BlurBand(void* pTask, int iFromRow, int iToRow)
+{
+    CogeFXBlurTask* pBlurTask = (CogeFXBlurTask*) pTask;
+    pBlurTask->pProc(pBlurTask, iFromRow, iToRow);
+}
+
+static void OGE_FX_RunBlurPass(CogeFXBlurTask* pTask, ogeFXBlurProc pProc, bool bUseThreads)
+{
+    pTask->pProc = pProc;
+
+    if (bUseThreads && OGE_FX_RunBands(OGE_FX_BlurBand, pTask, pTask->iHeight)) return;
+
+    pProc(pTask, 0, pTask->iHeight);
+}
+
+/* the radius of each box pass, three box passes of radius r make a gaussian of variance r*(r+1),
+   it is matched to the variance of the old iterated blur (sum of i*i, i = 1 ~ iAmount)
+*/
+static void OGE_FX_GetBlurRadius(int iAmount, int* pRadius)
+{
+    double fVar = (double)iAmount * (iAmount + 1) * (2 * iAmount + 1) / 6;
+
+    int r = (int) sqrt(fVar);
+    while (r > 0 && (double)r * (r + 1) > fVar) r--;
+    while ((double)(r + 1) * (r + 2) <= fVar) r++;
+
+    // each pass moved up to r+1 adds 2*(r+1)/3 to the variance
+    int iUp = (int) floor((fVar - (double)r * (r + 1)) * 3 / (2 * (r + 1)) + 0.5);
+    if (iUp > _OGE_FX_BLUR_PASSES_) iUp = _OGE_FX_BLUR_PASSES_;
+
+    for(int i=0; i<_OGE_FX_BLUR_PASSES_; i++) pRadius[i] = i < iUp ? r + 1 : r;
+}
+
+void OGE_FX_GaussianBlur(uint8_t* pDstData, int iDstLineSize,
+                          int iDstX, int iDstY,
+                          int iWidth, int iHeight, int iBPP, int iAmount)
+{
+    if (iBPP != 16 && iBPP != 32) return;
+    if (iWidth <= 0 || iHeight <= 0 || iAmount <= 0) return;
+
+    // a few passes of the old one are still cheaper than the six box passes
+    if (iAmount < _OGE_FX_BLUR_MIN_AMOUNT_)
+    {
+        OGE_FX_IteratedBlur(pDstData, iDstLineSize, iDstX, iDstY, iWidth, iHeight, iBPP, iAmount);
+        return;
+    }
+
+    if (iAmount > _OGE_FX_BLUR_MAX_AMOUNT_) iAmount = _OGE_FX_BLUR_MAX_AMOUNT_;
+
+    int iRadius[_OGE_FX_BLUR_PASSES_];
+    OGE_FX_GetBlurRadius(iAmount, iRadius);
+
+    uint8_t* pBuf = new uint8_t[iWidth * iHeight * 3 * 2];
+
+    CogeFXBlurTask task;
+    task.pProc = NULL;
+    task.pDstData = pDstData + iDstY * iDstLineSize + iDstX * (iBPP >> 3);
+    task.iDstLineSize = iDstLineSize;
+    task.iBPP = iBPP;
+    task.pSrc = pBuf;
+    task.pDst = pBuf + iWidth * iHeight * 3;
+    task.iWidth = iWidth;
+    task.iHeight = iHeight;
+    task.iRadius = 0;
+
+    bool bUseThreads = OGE_FX_GetThreads() > 1 && iWidth * iHeight >= OGE_FX_GetThreadPixels();
+
+    OGE_FX_RunBlurPass(&task, OGE_FX_BlurUnpack, bUseThreads);
+
+    for(int i=0; i<_OGE_FX_BLUR_PASSES_; i++)
+    {
+        task.iRadius = iRadius[i];
+        if (task.iRadius <= 0) continue;
+
+        OGE_FX_RunBlurPass(&task, OGE_FX_BlurRows, bUseThreads);
+        std::swap(task.pSrc, task.pDst);
+
+        OGE_FX_RunBlurPass(&task, OGE_FX_BlurColumns, bUseThreads);
+        std::swap(task.pSrc, task.pDst);
+    }
+
+    OGE_FX_RunBlurPass(&task, OGE_FX_BlurPack, bUseThreads);
+
+    delete[] pBuf;
+}
@@ -27,6 +27,7 @@ THE SOFTWARE.
 */
 
 #include "ogeGraphicFX.h"
+#include "ogeGraphicFX_Kernel.h"
 #include <cmath>
 #include <cstring>
 #include <algorithm>
@@ -130,7 +131,6 @@ static uint64_t __attribute__((aligned(8))) i64X16         = 0x003f003f003f003fL
 static uint8_t  ri[65536], gi[65536], bi[65536], div3[766];
 static uint16_t rw[256],   gw[256],   bw[256];
 static uint16_t maskr16, maskg16, maskb16;
-static int wavex[65536], wavey[65536];
 //static int wavesin[65536], wavecos[65536];
 
 static ogeColor32 cm16[65536];
@@ -190,6 +190,8 @@ int OGE_FX_Init()
         div3[k++]=i;
     }
 
+    OGE_FX_SetBackend(OGE_FX_GetBestBackend());
+
     return 0;
 }
 
@@ -426,7 +428,7 @@ void OGE_FX_Circle(uint8_t* pDstData, int iDstLineSize, int iBPP, int iColor, in
 
 }
 
-void OGE_FX_CopyRect(uint8_t* pDstData, int iDstLineSize,
+static void OGE_FX_C_CopyRect(uint8_t* pDstData, int iDstLineSize,
                 int iDstX, int iDstY,
                 uint8_t* pSrcData, int iSrcLineSize,
                 int iSrcX, int iSrcY,
@@ -601,146 +603,174 @@ void OGE_FX_CopyRect(uint8_t* pDstData, int iDstLineSize,
 
 }
 
-void OGE_FX_Blt(uint8_t* pDstData, int iDstLineSize,
-                int iDstX, int iDstY,
-                uint8_t* pSrcData, int iSrcLineSize, int iSrcColorKey,
-                int iSrcX, int iSrcY,
-                int iWidth, int iHeight, int iBPP)
-{
-
-    int iSrcDataPad;
-	int iDstDataPad;
-
-	int iLineBytes;
-	int iLineWidth;
-
-	bool bNoColorKey = iSrcColorKey == -1;
+/*================= Specialised blit rows =======================*/
 
-	switch (iBPP)
-	{
-	case 16:
-    {
-        iLineBytes = iWidth << 1;
-        pDstData += iDstY * iDstLineSize + iDstX * 2;
-        pSrcData += iSrcY * iSrcLineSize + iSrcX * 2;
+/* the blit kernels below walk their rows with OGE_FX_C_BltRows(), which is instantiated for each pixel op
+   (the bpp and the effect of a kernel, the alpha mode or the sign of the amount too) with and without the
+   color key, so an instance has nothing left to test per pixel but the key (when it has one),
+   each kernel keeps a table of its instances and picks one once per call
+*/
 
-        iSrcDataPad = iSrcLineSize - iLineBytes;
-        iDstDataPad = iDstLineSize - iLineBytes;
+// the per call values of the pixel ops
+struct CogeFXBltArgs
+{
+    int iAmount;
+    uint8_t i8Amount;
 
-        uint16_t i16ColorKey = iSrcColorKey & 0x0000ffff;
-        uint16_t i16Color = 0;
+    int iRedDelta;
+    int iGreenDelta;
+    int iBlueDelta;
 
-        while(iHeight > 0)
-        {
-            iLineWidth = iWidth;
-            while(iLineWidth > 0)
-            {
-                i16Color = *((uint16_t*)pSrcData);
-                if(bNoColorKey || i16Color != i16ColorKey) *((uint16_t*)pDstData) = i16Color;
+    uint8_t iAlpha;
+    uint8_t iSmallAlpha;
 
-                pSrcData += 2;
-                pDstData += 2;
+    int iColor;
+    int iColorAlpha;
+};
 
-                iLineWidth--;
+typedef void (*ogeFXBltRows)(uint8_t* pDstData, int iDstLineSize,
+                uint8_t* pSrcData, int iSrcLineSize, uint32_t iColorKey,
+                int iWidth, int iHeight, const CogeFXBltArgs* pArgs);
 
-            }
+template <class OP, bool KEY>
+static void OGE_FX_C_BltRows(uint8_t* pDstData, int iDstLineSize,
+                uint8_t* pSrcData, int iSrcLineSize, uint32_t iColorKey,
+                int iWidth, int iHeight, const CogeFXBltArgs* pArgs)
+{
+    typedef typename OP::Pixel Pixel;
 
-            pSrcData += iSrcDataPad;
-            pDstData += iDstDataPad;
+    const Pixel iKey = (Pixel) iColorKey;
+    const CogeFXBltArgs args = *pArgs;
 
-            iHeight--;
+    while(iHeight > 0)
+    {
+        const Pixel* pSrc = (const Pixel*) pSrcData;
+        Pixel* pDst = (Pixel*) pDstData;
 
+        for(int x=0; x<iWidth; x++)
+        {
+            Pixel iColor = pSrc[x];
+            if(!KEY || iColor != iKey) OP::Apply(pDst + x, iColor, args);
         }
 
-        break;
-    }
+        pSrcData += iSrcLineSize;
+        pDstData += iDstLineSize;
 
+        iHeight--;
+    }
+}
 
-    case 24:
-    {
-        iLineBytes = iWidth * 3;
-        pDstData += iDstY * iDstLineSize + iDstX * 3;
-        pSrcData += iSrcY * iSrcLineSize + iSrcX * 3;
+// the instances of an op without and with the color key
+#define _OGE_FX_BLT_ROWS_(op) { OGE_FX_C_BltRows< op, false >, OGE_FX_C_BltRows< op, true > }
 
-        iSrcDataPad = iSrcLineSize - iLineBytes;
-        iDstDataPad = iDstLineSize - iLineBytes;
+// runs the instance of pRows (see _OGE_FX_BLT_ROWS_) which matches the color key on the rect
+static void OGE_FX_C_BltRect(const ogeFXBltRows* pRows, int iBPP,
+                uint8_t* pDstData, int iDstLineSize,
+                int iDstX, int iDstY,
+                uint8_t* pSrcData, int iSrcLineSize, int iSrcColorKey,
+                int iSrcX, int iSrcY,
+                int iWidth, int iHeight, const CogeFXBltArgs* pArgs)
+{
+    int iPixelSize = iBPP >> 3;
 
-        uint32_t i24ColorKey = iSrcColorKey & 0x00ffffff;
-        uint32_t i24Color = 0;
+    pDstData += iDstY * iDstLineSize + iDstX * iPixelSize;
+    pSrcData += iSrcY * iSrcLineSize + iSrcX * iPixelSize;
 
-        int iColorSize = sizeof(uint8_t) * 3;
+    pRows[iSrcColorKey != -1](pDstData, iDstLineSize, pSrcData, iSrcLineSize, (uint32_t) iSrcColorKey,
+                              iWidth, iHeight, pArgs);
+}
 
-        while(iHeight > 0)
-        {
-            iLineWidth = iWidth;
-            while(iLineWidth > 0)
-            {
-                i24Color = (*(uint32_t*)pSrcData) & 0x00ffffff;
-                if(bNoColorKey || i24Color != i24ColorKey) memcpy(pDstData, pSrcData, iColorSize);
+struct CogeFXCopy16
+{
+    typedef uint16_t Pixel;
 
-                pSrcData += 3;
-                pDstData += 3;
+    static inline void Apply(uint16_t* pDst, uint16_t iSrc, const CogeFXBltArgs&)
+    {
+        *pDst = iSrc;
+    }
+};
 
-                iLineWidth--;
+struct CogeFXCopy32
+{
+    typedef uint32_t Pixel;
 
-            }
+    static inline void Apply(uint32_t* pDst, uint32_t iSrc, const CogeFXBltArgs&)
+    {
+        *pDst = iSrc;
+    }
+};
 
-            pSrcData += iSrcDataPad;
-            pDstData += iDstDataPad;
+static const ogeFXBltRows BltRows[2][2] =
+{
+    _OGE_FX_BLT_ROWS_(CogeFXCopy16),
+    _OGE_FX_BLT_ROWS_(CogeFXCopy32)
+};
 
-            iHeight--;
+static void OGE_FX_C_Blt(uint8_t* pDstData, int iDstLineSize,
+                int iDstX, int iDstY,
+                uint8_t* pSrcData, int iSrcLineSize, int iSrcColorKey,
+                int iSrcX, int iSrcY,
+                int iWidth, int iHeight, int iBPP)
+{
 
-        }
+    if (iBPP == 16 || iBPP == 32)
+    {
+        CogeFXBltArgs args;
+        memset(&args, 0, sizeof(args));
 
-        break;
+        OGE_FX_C_BltRect(BltRows[iBPP == 32], iBPP, pDstData, iDstLineSize, iDstX, iDstY,
+                         pSrcData, iSrcLineSize, iSrcColorKey, iSrcX, iSrcY, iWidth, iHeight, &args);
+        return;
     }
 
-    case 32:
-    {
-        iLineBytes = iWidth << 2;
-        pDstData += iDstY * iDstLineSize + iDstX * 4;
-        pSrcData += iSrcY * iSrcLineSize + iSrcX * 4;
+    if (iBPP != 24) return;
 
-        iSrcDataPad = iSrcLineSize - iLineBytes;
-        iDstDataPad = iDstLineSize - iLineBytes;
+    int iSrcDataPad;
+	int iDstDataPad;
 
-        uint32_t i32ColorKey = iSrcColorKey;
-        uint32_t i32Color = 0;
+	int iLineBytes;
+	int iLineWidth;
 
-        while(iHeight > 0)
-        {
-            iLineWidth = iWidth;
-            while(iLineWidth > 0)
-            {
-                i32Color = *((uint32_t*)pSrcData);
-                if(bNoColorKey || i32Color != i32ColorKey) *((uint32_t*)pDstData) = i32Color;
+	bool bNoColorKey = iSrcColorKey == -1;
 
-                pSrcData += 4;
-                pDstData += 4;
+    iLineBytes = iWidth * 3;
+    pDstData += iDstY * iDstLineSize + iDstX * 3;
+    pSrcData += iSrcY * iSrcLineSize + iSrcX * 3;
 
-                iLineWidth--;
+    iSrcDataPad = iSrcLineSize - iLineBytes;
+    iDstDataPad = iDstLineSize - iLineBytes;
 
-            }
+    uint32_t i24ColorKey = iSrcColorKey & 0x00ffffff;
+    uint32_t i24Color = 0;
 
-            pSrcData += iSrcDataPad;
-            pDstData += iDstDataPad;
+    int iColorSize = sizeof(uint8_t) * 3;
 
-            iHeight--;
+    while(iHeight > 0)
+    {
+        iLineWidth = iWidth;
+        while(iLineWidth > 0)
+        {
+            i24Color = (*(uint32_t*)pSrcData) & 0x00ffffff;
+            if(bNoColorKey || i24Color != i24ColorKey) memcpy(pDstData, pSrcData, iColorSize);
 
-        }
+            pSrcData += 3;
+            pDstData += 3;
 
-        break;
-    }
+            iLineWidth--;
 
+        }
 
-	}
+        pSrcData += iSrcDataPad;
+        pDstData += iDstDataPad;
 
+        iHeight--;
 
+    }
 
 }
 
 
-void OGE_FX_SubLight(uint8_t* pDstData, int iDstLineSize,
+static void OGE_FX_C_SubLight(uint8_t* pDstData, int iDstLineSize,
                       int iDstX, int iDstY,
                       int iWidth, int iHeight, int iBPP, int iAmount)
 {
@@ -838,7 +868,7 @@ void OGE_FX_SubLight(uint8_t* pDstData, int iDstLineSize,
 
 }
 
-void OGE_FX_Lightness(uint8_t* pDstData, int iDstLineSize,
+static void OGE_FX_C_Lightness(uint8_t* pDstData, int iDstLineSize,
                       int iDstX, int iDstY,
                       int iWidth, int iHeight, int iBPP, int iAmount)
 {
@@ -952,7 +982,7 @@ void OGE_FX_Lightness(uint8_t* pDstData, int iDstLineSize,
 
 }
 
-void OGE_FX_ChangeColorRGB(uint8_t* pDstData, int iDstLineSize,
+static void OGE_FX_C_ChangeColorRGB(uint8_t* pDstData, int iDstLineSize,
                       int iDstX, int iDstY,
                       int iWidth, int iHeight, int iBPP,
                       int iRedAmount, int iGreenAmount, int iBlueAmount)
@@ -1161,486 +1191,286 @@ void OGE_FX_ChangeGrayLevel(uint8_t* pDstData, int iDstLineSize,
 }
 
 
-void OGE_FX_BltLightness(uint8_t* pDstData, int iDstLineSize,
-                int iDstX, int iDstY,
-                uint8_t* pSrcData, int iSrcLineSize, int iSrcColorKey,
-                int iSrcX, int iSrcY,
-                int iWidth, int iHeight, int iBPP, int iAmount)
-{
-
-    int iSrcDataPad;
-	int iDstDataPad;
-
-	int iLineBytes;
-	int iLineWidth;
-
-	//int iPixel;
-	uint8_t iB, iG, iR;
-
-	uint8_t i8Amount = abs(iAmount);
+/* the amounts up to 255 can not take a channel out of its range (the darken amount is 8 bits),
+   so only the lighten of a bigger amount has to saturate
+*/
+#define _OGE_FX_DARKEN_             0
+#define _OGE_FX_LIGHTEN_            1
+#define _OGE_FX_LIGHTEN_SATURATED_  2
 
-	bool bNoColorKey = iSrcColorKey == -1;
+template <int MODE>
+struct CogeFXLightness16
+{
+    typedef uint16_t Pixel;
 
-	switch (iBPP)
-	{
-	case 16:
+    static inline void Apply(uint16_t* pDst, uint16_t iSrc, const CogeFXBltArgs& args)
     {
-        iLineBytes = iWidth << 1;
-        pDstData += iDstY * iDstLineSize + iDstX * 2;
-        pSrcData += iSrcY * iSrcLineSize + iSrcX * 2;
-
-        iSrcDataPad = iSrcLineSize - iLineBytes;
-        iDstDataPad = iDstLineSize - iLineBytes;
+        uint8_t iB = iSrc & 0x001f;
+        uint8_t iG = (iSrc >> 5) &  0x003f;
+        uint8_t iR = (iSrc >> 11) & 0x001f;
 
-        uint16_t i16ColorKey = iSrcColorKey & 0x0000ffff;
-        uint16_t i16Color = 0;
-
-        while(iHeight > 0)
+        if (MODE == _OGE_FX_DARKEN_)
         {
-            iLineWidth = iWidth;
-            while(iLineWidth > 0)
-            {
-                i16Color = *((uint16_t*)pSrcData);
-                if (bNoColorKey || i16Color != i16ColorKey)
-                {
-                    iB = i16Color & 0x001f;
-                    iG = (i16Color >> 5) &  0x003f;
-                    iR = (i16Color >> 11) & 0x001f;
-                    if (iAmount >= 0)
-                    {
-                        iB = OGE_FX_Saturate(iB + (iAmount * (iB ^ 31) >> 8), 31);
-                        iG = OGE_FX_Saturate(iG + (iAmount * (iG ^ 63) >> 8), 63);
-                        iR = OGE_FX_Saturate(iR + (iAmount * (iR ^ 31) >> 8), 31);
-                    }
-                    else
-                    {
-                        iB = OGE_FX_Saturate(iB - (i8Amount * iB >> 8), 31);
-                        iG = OGE_FX_Saturate(iG - (i8Amount * iG >> 8), 63);
-                        iR = OGE_FX_Saturate(iR - (i8Amount * iR >> 8), 31);
-                    }
-
-                    *((uint16_t*)pDstData) = (iR << 11) | (iG << 5) | iB;
-                }
-
-                pSrcData += 2;
-                pDstData += 2;
-
-                iLineWidth--;
+            iB = iB - (args.i8Amount * iB >> 8);
+            iG = iG - (args.i8Amount * iG >> 8);
+            iR = iR - (args.i8Amount * iR >> 8);
+        }
+        else if (MODE == _OGE_FX_LIGHTEN_)
+        {
+            iB = iB + (args.iAmount * (iB ^ 31) >> 8);
+            iG = iG + (args.iAmount * (iG ^ 63) >> 8);
+            iR = iR + (args.iAmount * (iR ^ 31) >> 8);
+        }
+        else
+        {
+            iB = OGE_FX_Saturate(iB + (args.iAmount * (iB ^ 31) >> 8), 31);
+            iG = OGE_FX_Saturate(iG + (args.iAmount * (iG ^ 63) >> 8), 63);
+            iR = OGE_FX_Saturate(iR + (args.iAmount * (iR ^ 31) >> 8), 31);
+        }
 
-            }
+        *pDst = (iR << 11) | (iG << 5) | iB;
+    }
+};
 
-            pSrcData += iSrcDataPad;
-            pDstData += iDstDataPad;
+template <int MODE>
+struct CogeFXLightness32
+{
+    typedef uint32_t Pixel;
 
-            iHeight--;
+    static inline void Apply(uint32_t* pDst, uint32_t iSrc, const CogeFXBltArgs& args)
+    {
+        uint8_t iB = (iSrc >> blueoffset)  & 0xff;
+        uint8_t iG = (iSrc >> greenoffset) & 0xff;
+        uint8_t iR = (iSrc >> redoffset)   & 0xff;
 
+        if (MODE == _OGE_FX_DARKEN_)
+        {
+            iB = iB - (args.i8Amount * iB >> 8);
+            iG = iG - (args.i8Amount * iG >> 8);
+            iR = iR - (args.i8Amount * iR >> 8);
+        }
+        else if (MODE == _OGE_FX_LIGHTEN_)
+        {
+            iB = iB + (args.iAmount * (iB ^ 255) >> 8);
+            iG = iG + (args.iAmount * (iG ^ 255) >> 8);
+            iR = iR + (args.iAmount * (iR ^ 255) >> 8);
+        }
+        else
+        {
+            iB = OGE_FX_Saturate(iB + (args.iAmount * (iB ^ 255) >> 8), 255);
+            iG = OGE_FX_Saturate(iG + (args.iAmount * (iG ^ 255) >> 8), 255);
+            iR = OGE_FX_Saturate(iR + (args.iAmount * (iR ^ 255) >> 8), 255);
         }
 
-        break;
+        *pDst = (iR << redoffset) | (iG << greenoffset) | (iB << blueoffset);
     }
+};
 
-    case 32:
+// [32 bpp][mode][color key]
+static const ogeFXBltRows BltLightnessRows[2][3][2] =
+{
     {
-        iLineBytes = iWidth << 2;
-        pDstData += iDstY * iDstLineSize + iDstX * 4;
-        pSrcData += iSrcY * iSrcLineSize + iSrcX * 4;
-
-        iSrcDataPad = iSrcLineSize - iLineBytes;
-        iDstDataPad = iDstLineSize - iLineBytes;
+        _OGE_FX_BLT_ROWS_(CogeFXLightness16<_OGE_FX_DARKEN_>),
+        _OGE_FX_BLT_ROWS_(CogeFXLightness16<_OGE_FX_LIGHTEN_>),
+        _OGE_FX_BLT_ROWS_(CogeFXLightness16<_OGE_FX_LIGHTEN_SATURATED_>)
+    },
+    {
+        _OGE_FX_BLT_ROWS_(CogeFXLightness32<_OGE_FX_DARKEN_>),
+        _OGE_FX_BLT_ROWS_(CogeFXLightness32<_OGE_FX_LIGHTEN_>),
+        _OGE_FX_BLT_ROWS_(CogeFXLightness32<_OGE_FX_LIGHTEN_SATURATED_>)
+    }
+};
 
-        uint32_t i32ColorKey = iSrcColorKey;
-        uint32_t i32Color = 0;
+static void OGE_FX_C_BltLightness(uint8_t* pDstData, int iDstLineSize,
+                int iDstX, int iDstY,
+                uint8_t* pSrcData, int iSrcLineSize, int iSrcColorKey,
+                int iSrcX, int iSrcY,
+                int iWidth, int iHeight, int iBPP, int iAmount)
+{
+    if (iBPP != 16 && iBPP != 32) return;
 
-        while(iHeight > 0)
-        {
-            iLineWidth = iWidth;
-            while(iLineWidth > 0)
-            {
-                i32Color = *((uint32_t*)pSrcData);
-                if(bNoColorKey || i32Color != i32ColorKey)
-                {
-                    iB = (i32Color >> blueoffset)  & 0xff;
-                    iG = (i32Color >> greenoffset) & 0xff;
-                    iR = (i32Color >> redoffset)   & 0xff;
-
-                    if (iAmount >= 0)
-                    {
-                        iB = OGE_FX_Saturate(iB + (iAmount * (iB ^ 255) >> 8), 255);
-                        iG = OGE_FX_Saturate(iG + (iAmount * (iG ^ 255) >> 8), 255);
-                        iR = OGE_FX_Saturate(iR + (iAmount * (iR ^ 255) >> 8), 255);
-                    }
-                    else
-                    {
-                        iB = OGE_FX_Saturate(iB - (i8Amount * iB >> 8), 255);
-                        iG = OGE_FX_Saturate(iG - (i8Amount * iG >> 8), 255);
-                        iR = OGE_FX_Saturate(iR - (i8Amount * iR >> 8), 255);
-                    }
-
-                    *((int*)pDstData) = (iR << redoffset) | (iG << greenoffset) | (iB << blueoffset);
-                }
+    CogeFXBltArgs args;
+    memset(&args, 0, sizeof(args));
 
-                pSrcData += 4;
-                pDstData += 4;
+    args.iAmount = iAmount;
+    args.i8Amount = abs(iAmount);
 
-                iLineWidth--;
+    int iMode = iAmount < 0 ? _OGE_FX_DARKEN_ : iAmount <= 255 ? _OGE_FX_LIGHTEN_ : _OGE_FX_LIGHTEN_SATURATED_;
 
-            }
+    OGE_FX_C_BltRect(BltLightnessRows[iBPP == 32][iMode], iBPP, pDstData, iDstLineSize, iDstX, iDstY,
+                     pSrcData, iSrcLineSize, iSrcColorKey, iSrcX, iSrcY, iWidth, iHeight, &args);
+}
 
-            pSrcData += iSrcDataPad;
-            pDstData += iDstDataPad;
+// the deltas are the amounts (scaled to the channel bits) with their signs
+struct CogeFXChangedRGB16
+{
+    typedef uint16_t Pixel;
 
-            iHeight--;
+    static inline void Apply(uint16_t* pDst, uint16_t iSrc, const CogeFXBltArgs& args)
+    {
+        uint8_t iB = iSrc & 0x001f;
+        uint8_t iG = (iSrc >> 5) &  0x003f;
+        uint8_t iR = (iSrc >> 11) & 0x001f;
 
-        }
+        iB = OGE_FX_Saturate(iB + args.iBlueDelta, 31);
+        iG = OGE_FX_Saturate(iG + args.iGreenDelta, 63);
+        iR = OGE_FX_Saturate(iR + args.iRedDelta, 31);
 
-        break;
+        *pDst = (iR << 11) | (iG << 5) | iB;
     }
+};
 
+struct CogeFXChangedRGB32
+{
+    typedef uint32_t Pixel;
 
-	}
+    static inline void Apply(uint32_t* pDst, uint32_t iSrc, const CogeFXBltArgs& args)
+    {
+        uint8_t iB = (iSrc >> blueoffset)  & 0xff;
+        uint8_t iG = (iSrc >> greenoffset) & 0xff;
+        uint8_t iR = (iSrc >> redoffset)   & 0xff;
 
-}
+        iB = OGE_FX_Saturate(iB + args.iBlueDelta, 255);
+        iG = OGE_FX_Saturate(iG + args.iGreenDelta, 255);
+        iR = OGE_FX_Saturate(iR + args.iRedDelta, 255);
 
-void OGE_FX_BltChangedRGB(uint8_t* pDstData, int iDstLineSize,
+        *pDst = (iR << redoffset) | (iG << greenoffset) | (iB << blueoffset);
+    }
+};
+
+static const ogeFXBltRows BltChangedRGBRows[2][2] =
+{
+    _OGE_FX_BLT_ROWS_(CogeFXChangedRGB16),
+    _OGE_FX_BLT_ROWS_(CogeFXChangedRGB32)
+};
+
+static void OGE_FX_C_BltChangedRGB(uint8_t* pDstData, int iDstLineSize,
                       int iDstX, int iDstY,
                       uint8_t* pSrcData, int iSrcLineSize, int iSrcColorKey,
                       int iSrcX, int iSrcY,
                       int iWidth, int iHeight, int iBPP,
                       int iRedAmount, int iGreenAmount, int iBlueAmount)
 {
-
-    int iSrcDataPad;
-	int iDstDataPad;
-
-	int iLineBytes;
-	int iLineWidth;
+    if (iBPP != 16 && iBPP != 32) return;
 
 #if defined(__MACOSX__) || defined(__IPHONE__)
 
     if(iBPP == 16)
     {
-        iLineBytes = iRedAmount;
+        int iAmount = iRedAmount;
         iRedAmount = iBlueAmount;
-        iBlueAmount = iLineBytes;
+        iBlueAmount = iAmount;
     }
 
 #endif
 
-	//int iPixel;
-	uint8_t iB, iG, iR;
-
 	uint8_t i8RedAmount = abs(iRedAmount);
 	uint8_t i8GreenAmount = abs(iGreenAmount);
 	uint8_t i8BlueAmount = abs(iBlueAmount);
 
-	uint8_t i5RedAmount = i8RedAmount >> 3;
-	uint8_t i6GreenAmount = i8GreenAmount >> 2;
-	uint8_t i5BlueAmount = i8BlueAmount >> 3;
+	int iRed = iBPP == 16 ? i8RedAmount >> 3 : i8RedAmount;
+	int iGreen = iBPP == 16 ? i8GreenAmount >> 2 : i8GreenAmount;
+	int iBlue = iBPP == 16 ? i8BlueAmount >> 3 : i8BlueAmount;
 
-	bool bNoColorKey = iSrcColorKey == -1;
+    CogeFXBltArgs args;
+    memset(&args, 0, sizeof(args));
 
-	switch (iBPP)
-	{
-	case 16:
-    {
-        iLineBytes = iWidth << 1;
-        pDstData += iDstY * iDstLineSize + iDstX * 2;
-        pSrcData += iSrcY * iSrcLineSize + iSrcX * 2;
+    args.iRedDelta = iRedAmount >= 0 ? iRed : -iRed;
+    args.iGreenDelta = iGreenAmount >= 0 ? iGreen : -iGreen;
+    args.iBlueDelta = iBlueAmount >= 0 ? iBlue : -iBlue;
 
-        iSrcDataPad = iSrcLineSize - iLineBytes;
-        iDstDataPad = iDstLineSize - iLineBytes;
-
-        uint16_t i16ColorKey = iSrcColorKey & 0x0000ffff;
-        uint16_t i16Color = 0;
-
-        while(iHeight > 0)
-        {
-            iLineWidth = iWidth;
-            while(iLineWidth > 0)
-            {
-                i16Color = *((uint16_t*)pSrcData);
-                if (bNoColorKey || i16Color != i16ColorKey)
-                {
-                    iB = i16Color & 0x001f;
-                    iG = (i16Color >> 5) &  0x003f;
-                    iR = (i16Color >> 11) & 0x001f;
-
-                    if (iBlueAmount >= 0) iB = OGE_FX_Saturate(iB + i5BlueAmount, 31);
-                    else iB = OGE_FX_Saturate(iB - i5BlueAmount, 31);
-
-                    if (iGreenAmount >= 0) iG = OGE_FX_Saturate(iG + i6GreenAmount, 63);
-                    else iG = OGE_FX_Saturate(iG - i6GreenAmount, 63);
-
-                    if (iRedAmount >= 0) iR = OGE_FX_Saturate(iR + i5RedAmount, 31);
-                    else iR = OGE_FX_Saturate(iR - i5RedAmount, 31);
-
-                    *((uint16_t*)pDstData) = (iR << 11) | (iG << 5) | iB;
-                }
-
-                pSrcData += 2;
-                pDstData += 2;
-
-                iLineWidth--;
-
-            }
-
-            pSrcData += iSrcDataPad;
-            pDstData += iDstDataPad;
-
-            iHeight--;
-
-        }
+    OGE_FX_C_BltRect(BltChangedRGBRows[iBPP == 32], iBPP, pDstData, iDstLineSize, iDstX, iDstY,
+                     pSrcData, iSrcLineSize, iSrcColorKey, iSrcX, iSrcY, iWidth, iHeight, &args);
+}
 
-        break;
-    }
+struct CogeFXAlphaBlend16
+{
+    typedef uint16_t Pixel;
 
-    case 32:
+    static inline void Apply(uint16_t* pDst, uint16_t iSrc, const CogeFXBltArgs& args)
     {
-        iLineBytes = iWidth << 2;
-        pDstData += iDstY * iDstLineSize + iDstX * 4;
-        pSrcData += iSrcY * iSrcLineSize + iSrcX * 4;
-
-        iSrcDataPad = iSrcLineSize - iLineBytes;
-        iDstDataPad = iDstLineSize - iLineBytes;
-
-        uint32_t i32ColorKey = iSrcColorKey;
-        uint32_t i32Color = 0;
+        uint16_t iDst = *pDst;
 
-        while(iHeight > 0)
-        {
-            iLineWidth = iWidth;
-            while(iLineWidth > 0)
-            {
-                i32Color = *((uint32_t*)pSrcData);
-                if(bNoColorKey || i32Color != i32ColorKey)
-                {
-                    iB = (i32Color >> blueoffset)  & 0xff;
-                    iG = (i32Color >> greenoffset) & 0xff;
-                    iR = (i32Color >> redoffset)   & 0xff;
+        uint8_t iB = ((args.iAlpha * ((iSrc & 0x001f) + 64 - (iDst & 0x001f))) >> 8) +
+            (iDst & 0x001f) - args.iSmallAlpha;
 
-                    if (iBlueAmount >= 0) iB = OGE_FX_Saturate(iB + i8BlueAmount, 255);
-                    else iB = OGE_FX_Saturate(iB - i8BlueAmount, 255);
+        uint8_t iG = ((args.iAlpha * (((iSrc & 0x07e0) >> 5) + 64 - ((iDst & 0x07e0) >> 5))) >> 8) +
+            ((iDst & 0x07e0) >> 5) - args.iSmallAlpha;
 
-                    if (iGreenAmount >= 0) iG = OGE_FX_Saturate(iG + i8GreenAmount, 255);
-                    else iG = OGE_FX_Saturate(iG - i8GreenAmount, 255);
+        uint8_t iR = ((args.iAlpha * (((iSrc & 0xf800) >> 11) + 64 - ((iDst & 0xf800) >> 11))) >> 8) +
+            ((iDst & 0xf800) >> 11) - args.iSmallAlpha;
 
-                    if (iRedAmount >= 0) iR = OGE_FX_Saturate(iR + i8RedAmount, 255);
-                    else iR = OGE_FX_Saturate(iR - i8RedAmount, 255);
+        *pDst = (iR << 11) | (iG << 5) | iB;
+    }
+};
 
-                    *((int*)pDstData) = (iR << redoffset) | (iG << greenoffset) | (iB << blueoffset);
-                }
+struct CogeFXHalfAlphaBlend16
+{
+    typedef uint16_t Pixel;
 
-                pSrcData += 4;
-                pDstData += 4;
+    static inline void Apply(uint16_t* pDst, uint16_t iSrc, const CogeFXBltArgs&)
+    {
+        *pDst = ((iSrc & 0xF7DE) >> 1) + ((*pDst & 0xF7DE) >> 1);
+    }
+};
 
-                iLineWidth--;
+struct CogeFXAlphaBlend32
+{
+    typedef uint32_t Pixel;
 
-            }
+    static inline void Apply(uint32_t* pDst, uint32_t iSrc, const CogeFXBltArgs& args)
+    {
+        uint32_t iDst = *pDst;
 
-            pSrcData += iSrcDataPad;
-            pDstData += iDstDataPad;
+        uint8_t iB = ((args.iAlpha * (((iSrc & bluemask)  >>  blueoffset) + 256 - ((iDst & bluemask)  >> blueoffset))) >> 8) +
+            ((iDst & bluemask)  >> blueoffset)  - args.iAlpha;
 
-            iHeight--;
+        uint8_t iG = ((args.iAlpha * (((iSrc & greenmask) >> greenoffset) + 256 - ((iDst & greenmask) >> greenoffset))) >> 8) +
+            ((iDst & greenmask) >> greenoffset) - args.iAlpha;
 
-        }
+        uint8_t iR = ((args.iAlpha * (((iSrc & redmask)   >> redoffset) + 256 - ((iDst & redmask)     >> redoffset))) >> 8) +
+            ((iDst & redmask)   >> redoffset)   - args.iAlpha;
 
-        break;
+        *pDst = (iR << redoffset) | (iG << greenoffset) | (iB << blueoffset);
     }
+};
 
+struct CogeFXHalfAlphaBlend32
+{
+    typedef uint32_t Pixel;
 
-	}
-
+    static inline void Apply(uint32_t* pDst, uint32_t iSrc, const CogeFXBltArgs&)
+    {
+        *pDst = ((iSrc & 0xFEFEFE) >> 1) + ((*pDst & 0xFEFEFE) >> 1);
+    }
+};
 
-}
+// [32 bpp][half alpha][color key]
+static const ogeFXBltRows AlphaBlendRows[2][2][2] =
+{
+    { _OGE_FX_BLT_ROWS_(CogeFXAlphaBlend16), _OGE_FX_BLT_ROWS_(CogeFXHalfAlphaBlend16) },
+    { _OGE_FX_BLT_ROWS_(CogeFXAlphaBlend32), _OGE_FX_BLT_ROWS_(CogeFXHalfAlphaBlend32) }
+};
 
-void OGE_FX_AlphaBlend(uint8_t* pDstData, int iDstLineSize,
+static void OGE_FX_C_AlphaBlend(uint8_t* pDstData, int iDstLineSize,
                 int iDstX, int iDstY,
                 uint8_t* pSrcData, int iSrcLineSize, int iSrcColorKey,
                 int iSrcX, int iSrcY,
                 int iWidth, int iHeight, int iBPP, uint8_t iAlpha)
 {
+    if (iBPP != 16 && iBPP != 32) return;
 
-    int iSrcDataPad;
-	int iDstDataPad;
-
-	int iLineBytes;
-	int iLineWidth;
-
-	//int iPixel;
-	uint8_t iB, iG, iR;
-
-	uint8_t iSmallAlpha = iAlpha >> 2;
-
-	bool bIsHalfAlpha = iAlpha == 128;
-
-	bool bNoColorKey = iSrcColorKey == -1;
-
-	switch (iBPP)
-	{
-	case 16:
-    {
-        iLineBytes = iWidth << 1;
-        pDstData += iDstY * iDstLineSize + iDstX * 2;
-        pSrcData += iSrcY * iSrcLineSize + iSrcX * 2;
-
-        iSrcDataPad = iSrcLineSize - iLineBytes;
-        iDstDataPad = iDstLineSize - iLineBytes;
-
-        uint16_t i16ColorKey = iSrcColorKey & 0x0000ffff;
-        uint16_t i16ColorSrc, i16ColorDst;
-
-        if(bIsHalfAlpha)
-        {
-            while(iHeight > 0)
-            {
-                iLineWidth = iWidth;
-                while(iLineWidth > 0)
-                {
-                    i16ColorSrc = *((uint16_t*)pSrcData);
-                    if (bNoColorKey || i16ColorSrc != i16ColorKey)
-                    {
-                        i16ColorDst = *((uint16_t*)pDstData);
-                        *((uint16_t*)pDstData) = ((i16ColorSrc & 0xF7DE) >> 1) + ((i16ColorDst & 0xF7DE) >> 1);
-                    }
-                    pSrcData += 2;
-                    pDstData += 2;
-                    iLineWidth--;
-                }
-                pSrcData += iSrcDataPad;
-                pDstData += iDstDataPad;
-                iHeight--;
-            }
-        }
-        else
-        {
-
-            while(iHeight > 0)
-            {
-                iLineWidth = iWidth;
-                while(iLineWidth > 0)
-                {
-                    i16ColorSrc = *((uint16_t*)pSrcData);
-                    if (bNoColorKey || i16ColorSrc != i16ColorKey)
-                    {
-                        i16ColorDst = *((uint16_t*)pDstData);
-
-                        iB = ((iAlpha * ((i16ColorSrc & 0x001f) + 64 - (i16ColorDst & 0x001f))) >> 8) +
-                            (i16ColorDst & 0x001f) - iSmallAlpha;
-
-                        iG = ((iAlpha * (((i16ColorSrc & 0x07e0) >> 5) + 64 - ((i16ColorDst & 0x07e0) >> 5))) >> 8) +
-                            ((i16ColorDst & 0x07e0) >> 5) - iSmallAlpha;
-
-                        iR = ((iAlpha * (((i16ColorSrc & 0xf800) >> 11) + 64 - ((i16ColorDst & 0xf800) >> 11))) >> 8) +
-                            ((i16ColorDst & 0xf800) >> 11) - iSmallAlpha;
-
-                        *((uint16_t*)pDstData) = (iR << 11) | (iG << 5) | iB;
-                    }
-
-                    pSrcData += 2;
-                    pDstData += 2;
-
-                    iLineWidth--;
-
-                }
-
-                pSrcData += iSrcDataPad;
-                pDstData += iDstDataPad;
-
-                iHeight--;
-
-            }
-
-        }
-
-        break;
-    }
-
-    case 32:
-    {
-        iLineBytes = iWidth << 2;
-        pDstData += iDstY * iDstLineSize + iDstX * 4;
-        pSrcData += iSrcY * iSrcLineSize + iSrcX * 4;
-
-        iSrcDataPad = iSrcLineSize - iLineBytes;
-        iDstDataPad = iDstLineSize - iLineBytes;
-
-        uint32_t i32ColorKey = iSrcColorKey;
-        uint32_t i32ColorSrc, i32ColorDst;
-
-
-        if(bIsHalfAlpha)
-        {
-            while(iHeight > 0)
-            {
-                iLineWidth = iWidth;
-                while(iLineWidth > 0)
-                {
-                    i32ColorSrc = *((uint32_t*)pSrcData);
-                    if(bNoColorKey || i32ColorSrc != i32ColorKey)
-                    {
-                        i32ColorDst = *((int*)pDstData);
-                        *((int*)pDstData) = ((i32ColorSrc & 0xFEFEFE) >> 1) + ((i32ColorDst & 0xFEFEFE) >> 1);
-                    }
-                    pSrcData += 4;
-                    pDstData += 4;
-                    iLineWidth--;
-                }
-                pSrcData += iSrcDataPad;
-                pDstData += iDstDataPad;
-                iHeight--;
-            }
-        }
-        else
-        {
-
-            while(iHeight > 0)
-            {
-                iLineWidth = iWidth;
-                while(iLineWidth > 0)
-                {
-                    i32ColorSrc = *((uint32_t*)pSrcData);
-                    if(bNoColorKey || i32ColorSrc != i32ColorKey)
-                    {
-                        i32ColorDst = *((int*)pDstData);
-
-                        iB = ((iAlpha * (((i32ColorSrc & bluemask)  >>  blueoffset) + 256 - ((i32ColorDst & bluemask)  >> blueoffset))) >> 8) +
-                            ((i32ColorDst & bluemask)  >> blueoffset)  - iAlpha;
-
-                        iG = ((iAlpha * (((i32ColorSrc & greenmask) >> greenoffset) + 256 - ((i32ColorDst & greenmask) >> greenoffset))) >> 8) +
-                            ((i32ColorDst & greenmask) >> greenoffset) - iAlpha;
-
-                        iR = ((iAlpha * (((i32ColorSrc & redmask)   >> redoffset) + 256 - ((i32ColorDst & redmask)     >> redoffset))) >> 8) +
-                            ((i32ColorDst & redmask)   >> redoffset)   - iAlpha;
-
-                        *((int*)pDstData) = (iR << redoffset) | (iG << greenoffset) | (iB << blueoffset);
+    CogeFXBltArgs args;
+    memset(&args, 0, sizeof(args));
 
-                    }
-
-                    pSrcData += 4;
-                    pDstData += 4;
-
-                    iLineWidth--;
-
-                }
-
-                pSrcData += iSrcDataPad;
-                pDstData += iDstDataPad;
-
-                iHeight--;
-
-            }
-
-        }
-
-        break;
-    }
-
-
-	}
+    args.iAlpha = iAlpha;
+    args.iSmallAlpha = iAlpha >> 2;
 
+    OGE_FX_C_BltRect(AlphaBlendRows[iBPP == 32][iAlpha == 128], iBPP, pDstData, iDstLineSize, iDstX, iDstY,
+                     pSrcData, iSrcLineSize, iSrcColorKey, iSrcX, iSrcY, iWidth, iHeight, &args);
 }
 
-void OGE_FX_LightMaskBlend(uint8_t* pDstData, int iDstLineSize,
+static void OGE_FX_C_LightMaskBlend(uint8_t* pDstData, int iDstLineSize,
                 int iDstX, int iDstY,
                 uint8_t* pSrcData, int iSrcLineSize,
                 int iSrcX, int iSrcY,
@@ -1883,10 +1713,11 @@ void OGE_FX_BltMask(uint8_t* pDstData, int iDstLineSize,
 
 }
 
-void OGE_FX_StretchSmoothly(uint8_t* pDstData, int iDstLineSize,
+static void OGE_FX_C_StretchSmoothly(uint8_t* pDstData, int iDstLineSize,
                 int iDstX, int iDstY, uint32_t iDstWidth, uint32_t iDstHeight,
                 uint8_t* pSrcData, int iSrcLineSize,
-                int iSrcX, int iSrcY, uint32_t iSrcWidth, uint32_t iSrcHeight, int iBPP)
+                int iSrcX, int iSrcY, uint32_t iSrcWidth, uint32_t iSrcHeight, int iBPP,
+                uint32_t iFromY, uint32_t iToY)
 {
     //int X, Y, xp;
 
@@ -1909,11 +1740,11 @@ void OGE_FX_StretchSmoothly(uint8_t* pDstData, int iDstLineSize,
         pSrcData += iSrcY * iSrcLineSize + iSrcX * 2;
 
 
-        yp  = 0;
         xpp = ((iSrcWidth - 1) << 16) / iDstWidth;
         ypp = ((iSrcHeight - 1) << 16) / iDstHeight;
+        yp  = iFromY * ypp;
 
-        for(Y=0;Y<iDstHeight;Y++)
+        for(Y=iFromY;Y<iToY;Y++)
         {
             xp = yp >> 16;
 
@@ -1959,13 +1790,13 @@ void OGE_FX_StretchSmoothly(uint8_t* pDstData, int iDstLineSize,
         //iDstDataPad = (iDstLineSize - iDstWidth << 2) >> 2;
 
 
-        yp  = 0;
         xpp = ((iSrcWidth - 1) << 16) / iDstWidth;
         ypp = ((iSrcHeight - 1) << 16) / iDstHeight;
+        yp  = iFromY * ypp;
 
         //pc  = (ogeColor32*)(pDstData);
 
-        for(Y=0;Y<iDstHeight;Y++)
+        for(Y=iFromY;Y<iToY;Y++)
         {
             xp = yp >> 16;
             y1 = (ogeColor32*)(pSrcData + iSrcLineSize*xp);
@@ -2007,10 +1838,11 @@ void OGE_FX_StretchSmoothly(uint8_t* pDstData, int iDstLineSize,
     }
 }
 
-void OGE_FX_BltStretch(uint8_t* pDstData, int iDstLineSize,
+static void OGE_FX_C_BltStretch(uint8_t* pDstData, int iDstLineSize,
                 int iDstX, int iDstY, uint32_t iDstWidth, uint32_t iDstHeight,
                 uint8_t* pSrcData, int iSrcLineSize, int iSrcColorKey,
-                int iSrcX, int iSrcY, uint32_t iSrcWidth, uint32_t iSrcHeight, int iBPP)
+                int iSrcX, int iSrcY, uint32_t iSrcWidth, uint32_t iSrcHeight, int iBPP,
+                uint32_t iFromY, uint32_t iToY)
 {
     uint32_t X, Y, xp, yp, sx, sy;
 
@@ -2032,11 +1864,11 @@ void OGE_FX_BltStretch(uint8_t* pDstData, int iDstLineSize,
         sx = (iSrcWidth << 16) / iDstWidth;
         sy = (iSrcHeight << 16) / iDstHeight;
 
-        yp = 0;
+        yp = iFromY * sy;
 
         if(iSrcColorKey == -1)
         {
-            for(Y=0;Y<iDstHeight;Y++)
+            for(Y=iFromY;Y<iToY;Y++)
             {
                 xp = yp >> 16;
                 pline16 = (uint16_t*)(pSrcData + iSrcLineSize*xp);
@@ -2054,7 +1886,7 @@ void OGE_FX_BltStretch(uint8_t* pDstData, int iDstLineSize,
         }
         else
         {
-            for(Y=0;Y<iDstHeight;Y++)
+            for(Y=iFromY;Y<iToY;Y++)
             {
                 xp = yp >> 16;
                 pline16 = (uint16_t*)(pSrcData + iSrcLineSize*xp);
@@ -2084,13 +1916,13 @@ void OGE_FX_BltStretch(uint8_t* pDstData, int iDstLineSize,
         sx = (iSrcWidth << 16) / iDstWidth;
         sy = (iSrcHeight << 16) / iDstHeight;
 
-        yp = 0;
+        yp = iFromY * sy;
 
         //pc  = (ogeColor32*)(pDstData);
 
         if(iSrcColorKey == -1)
         {
-            for(Y=0;Y<iDstHeight;Y++)
+            for(Y=iFromY;Y<iToY;Y++)
             {
                 xp = yp >> 16;
                 pline32 = (uint32_t*)(pSrcData + iSrcLineSize*xp);
@@ -2108,7 +1940,7 @@ void OGE_FX_BltStretch(uint8_t* pDstData, int iDstLineSize,
         }
         else
         {
-            for(Y=0;Y<iDstHeight;Y++)
+            for(Y=iFromY;Y<iToY;Y++)
             {
                 xp = yp >> 16;
                 pline32 = (uint32_t*)(pSrcData + iSrcLineSize*xp);
@@ -2191,155 +2023,7 @@ void OGE_FX_UpdateAlphaBlt(uint8_t* pDstData, int iDstLineSize,
 
 }
 
-void OGE_FX_BltRotate(uint8_t* pDstData, int iDstLineSize,
-                int iDstX, int iDstY, uint32_t iDstWidth, uint32_t iDstHeight,
-                uint8_t* pSrcData, int iSrcLineSize,
-                int iSrcX, int iSrcY, uint32_t iSrcWidth, uint32_t iSrcHeight, int iBPP,
-                int iSrcColorKey, double fAngle, int iZoom)
-{
-
-    uint32_t X, Y, dx, dy, xd, yd, sdx, sdy, ax, ay, cx, cy, isin, icos;
-
-    int iColor;
-
-    uint32_t* pc32;
-    uint16_t* pc16;
-
-    bool bNoColorKey = iSrcColorKey == -1;
-
-    cx = iDstWidth >> 1;
-    cy = iDstHeight >> 1;
-
-    //if(iBPP == 16) iZoom = iZoom >> 8;
-
-    isin = lround(sin(fAngle * _OGE_PI_ / 180) * iZoom);
-    icos = lround(cos(fAngle * _OGE_PI_ / 180) * iZoom);
-
-    xd = ((iSrcWidth  << 16) - (iDstWidth  << 16)) / 2;
-    yd = ((iSrcHeight << 16) - (iDstHeight << 16)) / 2;
-    ax = (cx << 16) - (icos * cx);
-    ay = (cy << 16) - (isin * cx);
-
-    //pc  = (ogeColor32*)(pDstData);
-
-
-    if(bNoColorKey)
-    {
-        switch(iBPP)
-        {
-        case 16:
-            pDstData += iDstY * iDstLineSize + iDstX * 2;
-            pSrcData += iSrcY * iSrcLineSize + iSrcX * 2;
-            for(Y=0;Y<iDstHeight;Y++)
-            {
-                dy  = cy - Y;
-                sdx = (ax + (isin * dy)) + xd;
-                sdy = (ay - (icos * dy)) + yd;
-                pc16  = (uint16_t*)(pDstData + iDstLineSize*Y);
-                for(X=0;X<iDstWidth;X++)
-                {
-                    dx = sdx >> 16;
-                    dy = sdy >> 16;
-                    if (dx < iSrcWidth && dy < iSrcHeight)
-                    {
-                        *pc16 = *((uint16_t*)(pSrcData + dy * iSrcLineSize + dx * 2));
-                    }
-                    sdx += icos;
-                    sdy += isin;
-                    pc16++;
-                }
-            }
-        break;
-        case 32:
-            pDstData += iDstY * iDstLineSize + iDstX * 4;
-            pSrcData += iSrcY * iSrcLineSize + iSrcX * 4;
-            //iDstDataPad = (iDstLineSize - iDstWidth << 2) >> 2;
-            for(Y=0;Y<iDstHeight;Y++)
-            {
-                dy  = cy - Y;
-                sdx = (ax + (isin * dy)) + xd;
-                sdy = (ay - (icos * dy)) + yd;
-                pc32  = (uint32_t*)(pDstData + iDstLineSize*Y);
-                for(X=0;X<iDstWidth;X++)
-                {
-                    dx = sdx >> 16;
-                    dy = sdy >> 16;
-                    if (dx < iSrcWidth && dy < iSrcHeight)
-                    {
-                        *pc32 = *((uint32_t*)(pSrcData + dy * iSrcLineSize + dx * 4));
-                    }
-                    sdx += icos;
-                    sdy += isin;
-                    pc32++;
-                }
-            }
-        break;
-        }
-
-    }
-    else
-    {
-        switch(iBPP)
-        {
-        case 16:
-            pDstData += iDstY * iDstLineSize + iDstX * 2;
-            pSrcData += iSrcY * iSrcLineSize + iSrcX * 2;
-            for(Y=0;Y<iDstHeight;Y++)
-            {
-                dy  = cy - Y;
-                sdx = (ax + (isin * dy)) + xd;
-                sdy = (ay - (icos * dy)) + yd;
-                pc16  = (uint16_t*)(pDstData + iDstLineSize*Y);
-                for(X=0;X<iDstWidth;X++)
-                {
-                    dx = sdx >> 16;
-                    dy = sdy >> 16;
-                    if (dx < iSrcWidth && dy < iSrcHeight)
-                    {
-                        iColor = *((uint16_t*)(pSrcData + dy * iSrcLineSize + dx * 2));
-                        if(iColor != iSrcColorKey) *pc16 = iColor;
-                    }
-                    sdx += icos;
-                    sdy += isin;
-                    pc16++;
-                }
-            }
-        break;
-        case 32:
-            pDstData += iDstY * iDstLineSize + iDstX * 4;
-            pSrcData += iSrcY * iSrcLineSize + iSrcX * 4;
-            //iDstDataPad = (iDstLineSize - iDstWidth << 2) >> 2;
-            for(Y=0;Y<iDstHeight;Y++)
-            {
-                dy  = cy - Y;
-                sdx = (ax + (isin * dy)) + xd;
-                sdy = (ay - (icos * dy)) + yd;
-                pc32  = (uint32_t*)(pDstData + iDstLineSize*Y);
-                for(X=0;X<iDstWidth;X++)
-                {
-                    dx = sdx >> 16;
-                    dy = sdy >> 16;
-                    if (dx < iSrcWidth && dy < iSrcHeight)
-                    {
-                        iColor = *((uint32_t*)(pSrcData + dy * iSrcLineSize + dx * 4));
-                        if(iColor != iSrcColorKey) *pc32 = iColor;
-                    }
-                    sdx += icos;
-                    sdy += isin;
-                    pc32++;
-                }
-            }
-        break;
-        }
-
-    }
-
-
-
-
-}
-
-void OGE_FX_Grayscale(uint8_t* pDstData, int iDstLineSize,
+static void OGE_FX_C_Grayscale(uint8_t* pDstData, int iDstLineSize,
                       int iDstX, int iDstY,
                       int iWidth, int iHeight, int iBPP)
 {
@@ -2405,188 +2089,6 @@ void OGE_FX_Grayscale(uint8_t* pDstData, int iDstLineSize,
 }
 
 
-void OGE_FX_BltSquareWave(uint8_t* pDstData, int iDstLineSize,
-                int iDstX, int iDstY,
-                uint8_t* pSrcData, int iSrcLineSize,
-                int iSrcX, int iSrcY,
-                int iWidth, int iHeight, int iBPP,
-                double iXAmount, double iYAmount, double iZAmount)
-{
-    int X, Y, xx, yy;
-    char* start;
-    int* pc32;
-    int* py;
-    uint16_t* pyw;
-    uint16_t* pw;
-
-
-    for(int i=0; i < iWidth; i++)  wavex[i] = lround(sin(i / iXAmount) * iZAmount);
-    for(int i=0; i < iHeight; i++) wavey[i] = lround(sin(i / iYAmount) * iZAmount);
-
-    switch(iBPP)
-    {
-    case 16:
-
-        pDstData += iDstY * iDstLineSize + iDstX * 2;
-        pSrcData += iSrcY * iSrcLineSize + iSrcX * 2;
-
-        pw  = (uint16_t*)(pDstData);
-
-        for(Y=0;Y<iHeight;Y++)
-        {
-            start = (char*)pw;
-
-            yy = wavey[Y] + Y;
-
-            if (yy >= 0 && yy < iHeight)
-            {
-                pyw  = (uint16_t*)(pSrcData + iSrcLineSize*yy);
-
-                for(X=0;X<iWidth;X++)
-                {
-                    xx = wavex[X] + X;
-                    if (xx >= 0 && xx < iWidth) *pw = *(pyw+xx);
-                    pw++;
-                }
-            }
-
-            pw = (uint16_t*)(start + iDstLineSize);
-        }
-
-
-    break;
-    case 32:
-
-        pDstData += iDstY * iDstLineSize + iDstX * 4;
-        pSrcData += iSrcY * iSrcLineSize + iSrcX * 4;
-
-        pc32  = (int*)(pDstData);
-
-        for(Y=0;Y<iHeight;Y++)
-        {
-            start = (char*)pc32;
-
-            yy = wavey[Y] + Y;
-
-            if (yy >= 0 && yy < iHeight)
-            {
-                py    = (int*)(pSrcData + iSrcLineSize*yy);
-
-                for(X=0;X<iWidth;X++)
-                {
-                    xx = wavex[X] + X;
-                    if (xx >= 0 && xx < iWidth) *pc32 = *(py+xx);
-                    pc32++;
-                }
-            }
-
-            pc32 = (int*)(start + iDstLineSize);
-        }
-
-
-    break;
-    }
-}
-
-void OGE_FX_BltRoundWave(uint8_t* pDstData, int iDstLineSize,
-                int iDstX, int iDstY,
-                uint8_t* pSrcData, int iSrcLineSize,
-                int iSrcX, int iSrcY,
-                int iWidth, int iHeight, int iBPP, int iSrcColorKey,
-                double iXAmount, double iYAmount, double iZAmount,
-                int iXSteps, int iYSteps)
-{
-    int X, Y, xx, yy;
-    char* start;
-    int* pc32;
-    int* py;
-    uint16_t* pyw;
-    uint16_t* pw;
-
-    int iColor;
-
-    if(iYSteps > 0)
-        for(int i=0; i < iHeight; i++) wavex[i] = lround(sin((i+iYSteps) / iXAmount) * iZAmount);
-    else
-        for(int i=0; i < iHeight; i++) wavex[i] = lround(sin(i / iXAmount) * iZAmount);
-
-    if(iXSteps > 0)
-        for(int i=0; i < iWidth; i++)  wavey[i] = lround(sin((i+iXSteps) / iYAmount) * iZAmount);
-    else
-        for(int i=0; i < iWidth; i++)  wavey[i] = lround(sin(i / iYAmount) * iZAmount);
-
-    switch(iBPP)
-    {
-    case 16:
-
-        pDstData += iDstY * iDstLineSize + iDstX * 2;
-        pSrcData += iSrcY * iSrcLineSize + iSrcX * 2;
-
-        pw  = (uint16_t*)(pDstData);
-
-        for(Y=0;Y<iHeight;Y++)
-        {
-            start = (char*)pw;
-
-            xx = wavex[Y];
-
-            for(X=0;X<iWidth;X++)
-            {
-                yy = wavey[X] + Y;
-
-                if (xx >= 0 && xx < iWidth
-                 && yy >= 0 && yy < iHeight)
-                {
-                    pyw = (uint16_t*)(pSrcData + iSrcLineSize*yy);
-                    iColor = *(pyw+xx);
-                    if(iSrcColorKey == -1 || iColor != iSrcColorKey) *pw = iColor;
-                }
-                pw++;
-                xx++;
-            }
-
-            pw = (uint16_t*)(start + iDstLineSize);
-        }
-
-
-    break;
-    case 32:
-
-        pDstData += iDstY * iDstLineSize + iDstX * 4;
-        pSrcData += iSrcY * iSrcLineSize + iSrcX * 4;
-
-        pc32  = (int*)(pDstData);
-
-        for(Y=0;Y<iHeight;Y++)
-        {
-            start = (char*)pc32;
-
-            xx = wavex[Y];
-
-            for(X=0;X<iWidth;X++)
-            {
-                yy = wavey[X] + Y;
-
-                if (xx >= 0 && xx < iWidth
-                 && yy >= 0 && yy < iHeight)
-                {
-                    py = (int*)(pSrcData + iSrcLineSize*yy);
-                    iColor = *(py+xx);
-                    if(iSrcColorKey == -1 || iColor != iSrcColorKey) *pc32 = iColor;
-
-                }
-                pc32++;
-                xx++;
-            }
-
-            pc32 = (int*)(start + iDstLineSize);
-        }
-
-
-    break;
-    }
-}
-
 void OGE_FX_SplitBlur(uint8_t* pDstData, int iDstLineSize,
                       int iDstX, int iDstY,
                       int iWidth, int iHeight, int iBPP, int iAmount)
@@ -2683,7 +2185,7 @@ void OGE_FX_SplitBlur(uint8_t* pDstData, int iDstLineSize,
     }
 }
 
-void OGE_FX_GaussianBlur(uint8_t* pDstData, int iDstLineSize,
+void OGE_FX_IteratedBlur(uint8_t* pDstData, int iDstLineSize,
                           int iDstX, int iDstY,
                           int iWidth, int iHeight, int iBPP, int iAmount)
 {
@@ -2817,144 +2319,492 @@ void OGE_FX_BltWithEdge(uint8_t* pDstData, int iDstLineSize,
 
 }
 
-void OGE_FX_BltWithColor(uint8_t* pDstData, int iDstLineSize,
-                int iDstX, int iDstY,
-                uint8_t* pSrcData, int iSrcLineSize, int iSrcColorKey,
-                int iSrcX, int iSrcY,
-                int iWidth, int iHeight, int iBPP, int iColor, int iAlpha)
+// result = (ALPHA * (src - dst)) / 256 + dst, where dst is the color
+struct CogeFXWithColor16
 {
+    typedef uint16_t Pixel;
 
-    int iSrcDataPad;
-	int iDstDataPad;
+    static inline void Apply(uint16_t* pDst, uint16_t iSrc, const CogeFXBltArgs& args)
+    {
+        uint16_t iColor = args.iColor;
+        int iAlpha = args.iColorAlpha;
 
-	int iLineBytes;
-	int iLineWidth;
+        uint8_t iB = ((iAlpha * ((iSrc & 0x001f) - (iColor & 0x001f))) >> 8) +
+            (iColor & 0x001f);
 
-	//int iPixel;
-	uint8_t iB, iG, iR;
+        uint8_t iG = ((iAlpha * (((iSrc & 0x07e0) >> 5) - ((iColor & 0x07e0) >> 5))) >> 8) +
+            ((iColor & 0x07e0) >> 5);
 
-	//uint8_t iSmallAlpha = iAlpha >> 2;
+        uint8_t iR = ((iAlpha * (((iSrc & 0xf800) >> 11) - ((iColor & 0xf800) >> 11))) >> 8) +
+            ((iColor & 0xf800) >> 11);
 
-	bool bNoColorKey = iSrcColorKey == -1;
+        *pDst = (iR << 11) | (iG << 5) | iB;
+    }
+};
+
+struct CogeFXWithColor32
+{
+    typedef uint32_t Pixel;
+
+    static inline void Apply(uint32_t* pDst, uint32_t iSrc, const CogeFXBltArgs& args)
+    {
+        uint32_t iColor = args.iColor;
+        int iAlpha = args.iColorAlpha;
+
+        uint8_t iB = ((iAlpha * (((iSrc & bluemask) >> blueoffset) - ((iColor & bluemask) >> blueoffset))) >> 8) +
+            ((iColor & bluemask) >> blueoffset);
+
+        uint8_t iG = ((iAlpha * (((iSrc & greenmask) >> greenoffset) - ((iColor & greenmask) >> greenoffset))) >> 8) +
+            ((iColor & greenmask) >> greenoffset);
+
+        uint8_t iR = ((iAlpha * (((iSrc & redmask) >> redoffset) - ((iColor & redmask) >> redoffset))) >> 8) +
+            ((iColor & redmask) >> redoffset);
+
+        *pDst = (iR << redoffset) | (iG << greenoffset) | (iB << blueoffset);
+    }
+};
+
+static const ogeFXBltRows BltWithColorRows[2][2] =
+{
+    _OGE_FX_BLT_ROWS_(CogeFXWithColor16),
+    _OGE_FX_BLT_ROWS_(CogeFXWithColor32)
+};
+
+static void OGE_FX_C_BltWithColor(uint8_t* pDstData, int iDstLineSize,
+                int iDstX, int iDstY,
+                uint8_t* pSrcData, int iSrcLineSize, int iSrcColorKey,
+                int iSrcX, int iSrcY,
+                int iWidth, int iHeight, int iBPP, int iColor, int iAlpha)
+{
+    if (iBPP != 16 && iBPP != 32) return;
 
 	if(iAlpha > 256) iAlpha = 256;
 	else if(iAlpha < 0) iAlpha = 0;
 
-	iAlpha = 256 - iAlpha;
+    CogeFXBltArgs args;
+    memset(&args, 0, sizeof(args));
 
-	switch (iBPP)
-	{
-	case 16:
-    {
-        iLineBytes = iWidth << 1;
-        pDstData += iDstY * iDstLineSize + iDstX * 2;
-        pSrcData += iSrcY * iSrcLineSize + iSrcX * 2;
+    args.iColor = iColor;
+    args.iColorAlpha = 256 - iAlpha;
 
-        iSrcDataPad = iSrcLineSize - iLineBytes;
-        iDstDataPad = iDstLineSize - iLineBytes;
+    OGE_FX_C_BltRect(BltWithColorRows[iBPP == 32], iBPP, pDstData, iDstLineSize, iDstX, iDstY,
+                     pSrcData, iSrcLineSize, iSrcColorKey, iSrcX, iSrcY, iWidth, iHeight, &args);
+}
 
-        uint16_t i16ColorKey = iSrcColorKey & 0x0000ffff;
-        uint16_t i16ColorSrc, i16ColorDst;
+/*================= Kernel dispatch =======================*/
 
-        while(iHeight > 0)
-        {
-            iLineWidth = iWidth;
-            while(iLineWidth > 0)
-            {
-                i16ColorSrc = *((uint16_t*)pSrcData);
-                if (bNoColorKey || i16ColorSrc != i16ColorKey)
-                {
+static const CogeFXKernels fxc =
+{
+    OGE_FX_C_CopyRect,
+    OGE_FX_C_Blt,
+    OGE_FX_C_SubLight,
+    OGE_FX_C_Lightness,
+    OGE_FX_C_ChangeColorRGB,
+    OGE_FX_C_BltLightness,
+    OGE_FX_C_BltChangedRGB,
+    OGE_FX_C_AlphaBlend,
+    OGE_FX_C_LightMaskBlend,
+    OGE_FX_C_BltWithColor,
+    OGE_FX_C_BltPremultiplied
+};
+
+static CogeFXKernels fx = fxc;
+
+static int fxbackend = _OGE_FX_BACKEND_C_;
+
+int OGE_FX_GetBestBackend()
+{
+#ifdef __FX_WITH_SSE__
+    return OGE_FX_SSE_Check();
+#else
+    return _OGE_FX_BACKEND_C_;
+#endif
+}
 
-                    i16ColorDst = iColor;
+int OGE_FX_GetBackend()
+{
+    return fxbackend;
+}
 
-                    // result = (ALPHA * (src - dst)) / 256 + dst
+int OGE_FX_SetBackend(int iBackend)
+{
+    int iBest = OGE_FX_GetBestBackend();
+    if (iBackend > iBest) iBackend = iBest;
 
-                    iB = ((iAlpha * ((i16ColorSrc & 0x001f) - (i16ColorDst & 0x001f))) >> 8) +
-                        (i16ColorDst & 0x001f);
+    // no mmx in this build
+    if (iBackend < _OGE_FX_BACKEND_SSE2_) iBackend = _OGE_FX_BACKEND_C_;
 
-                    iG = ((iAlpha * (((i16ColorSrc & 0x07e0) >> 5) - ((i16ColorDst & 0x07e0) >> 5))) >> 8) +
-                        ((i16ColorDst & 0x07e0) >> 5);
+    fx = fxc;
 
-                    iR = ((iAlpha * (((i16ColorSrc & 0xf800) >> 11) - ((i16ColorDst & 0xf800) >> 11))) >> 8) +
-                        ((i16ColorDst & 0xf800) >> 11);
+#ifdef __FX_WITH_SSE__
+    if (iBackend != _OGE_FX_BACKEND_C_) OGE_FX_SSE_Setup(&fx, &fxc, iBackend);
+#endif
 
-                    *((uint16_t*)pDstData) = (iR << 11) | (iG << 5) | iB;
+    fxbackend = iBackend;
 
-                }
+    return fxbackend;
+}
 
-                pSrcData += 2;
-                pDstData += 2;
+/*================= Row bands =======================*/
 
-                iLineWidth--;
+enum ogeFXTaskKernel
+{
+    _FX_TASK_COPYRECT_ = 0,
+    _FX_TASK_BLT_,
+    _FX_TASK_SUBLIGHT_,
+    _FX_TASK_LIGHTNESS_,
+    _FX_TASK_CHANGECOLORRGB_,
+    _FX_TASK_BLTLIGHTNESS_,
+    _FX_TASK_BLTCHANGEDRGB_,
+    _FX_TASK_ALPHABLEND_,
+    _FX_TASK_LIGHTMASKBLEND_,
+    _FX_TASK_BLTWITHCOLOR_,
+    _FX_TASK_GRAYSCALE_,
+    _FX_TASK_STRETCHSMOOTHLY_,
+    _FX_TASK_BLTSTRETCH_,
+    _FX_TASK_BLTPREMULTIPLIED_
+};
 
-            }
+// one fx call, the bands only differ in the rows they cover
+struct CogeFXTask
+{
+    int iKernel;
+
+    uint8_t* pDstData;
+    int iDstLineSize;
+    int iDstX;
+    int iDstY;
+
+    uint8_t* pSrcData;
+    int iSrcLineSize;
+    int iSrcColorKey;
+    int iSrcX;
+    int iSrcY;
+
+    int iWidth;   // for the stretch kernels they are the size of the dst rect
+    int iHeight;
+    int iBPP;
+
+    int iParam1;  // for the stretch kernels they are the size of the src rect
+    int iParam2;
+    int iParam3;
+};
 
-            pSrcData += iSrcDataPad;
-            pDstData += iDstDataPad;
+static void OGE_FX_RunTaskBand(void* pTask, int iFromRow, int iToRow)
+{
+    CogeFXTask* t = (CogeFXTask*) pTask;
 
-            iHeight--;
+    int iDstY = t->iDstY + iFromRow;
+    int iSrcY = t->iSrcY + iFromRow;
+    int iRows = iToRow - iFromRow;
 
-        }
+    switch(t->iKernel)
+    {
+    case _FX_TASK_COPYRECT_:
+        fx.CopyRect(t->pDstData, t->iDstLineSize, t->iDstX, iDstY, t->pSrcData, t->iSrcLineSize,
+                    t->iSrcX, iSrcY, t->iWidth, iRows, t->iBPP);
+        break;
+    case _FX_TASK_BLT_:
+        fx.Blt(t->pDstData, t->iDstLineSize, t->iDstX, iDstY, t->pSrcData, t->iSrcLineSize, t->iSrcColorKey,
+               t->iSrcX, iSrcY, t->iWidth, iRows, t->iBPP);
+        break;
+    case _FX_TASK_SUBLIGHT_:
+        fx.SubLight(t->pDstData, t->iDstLineSize, t->iDstX, iDstY, t->iWidth, iRows, t->iBPP, t->iParam1);
+        break;
+    case _FX_TASK_LIGHTNESS_:
+        fx.Lightness(t->pDstData, t->iDstLineSize, t->iDstX, iDstY, t->iWidth, iRows, t->iBPP, t->iParam1);
+        break;
+    case _FX_TASK_CHANGECOLORRGB_:
+        fx.ChangeColorRGB(t->pDstData, t->iDstLineSize, t->iDstX, iDstY, t->iWidth, iRows, t->iBPP,
+                          t->iParam1, t->iParam2, t->iParam3);
+        break;
+    case _FX_TASK_BLTLIGHTNESS_:
+        fx.BltLightness(t->pDstData, t->iDstLineSize, t->iDstX, iDstY, t->pSrcData, t->iSrcLineSize, t->iSrcColorKey,
+                        t->iSrcX, iSrcY, t->iWidth, iRows, t->iBPP, t->iParam1);
+        break;
+    case _FX_TASK_BLTCHANGEDRGB_:
+        fx.BltChangedRGB(t->pDstData, t->iDstLineSize, t->iDstX, iDstY, t->pSrcData, t->iSrcLineSize, t->iSrcColorKey,
+                         t->iSrcX, iSrcY, t->iWidth, iRows, t->iBPP, t->iParam1, t->iParam2, t->iParam3);
+        break;
+    case _FX_TASK_ALPHABLEND_:
+        fx.AlphaBlend(t->pDstData, t->iDstLineSize, t->iDstX, iDstY, t->pSrcData, t->iSrcLineSize, t->iSrcColorKey,
+                      t->iSrcX, iSrcY, t->iWidth, iRows, t->iBPP, t->iParam1);
+        break;
+    case _FX_TASK_LIGHTMASKBLEND_:
+        fx.LightMaskBlend(t->pDstData, t->iDstLineSize, t->iDstX, iDstY, t->pSrcData, t->iSrcLineSize,
+                          t->iSrcX, iSrcY, t->iWidth, iRows, t->iBPP);
+        break;
+    case _FX_TASK_BLTWITHCOLOR_:
+        fx.BltWithColor(t->pDstData, t->iDstLineSize, t->iDstX, iDstY, t->pSrcData, t->iSrcLineSize, t->iSrcColorKey,
+                        t->iSrcX, iSrcY, t->iWidth, iRows, t->iBPP, t->iParam1, t->iParam2);
+        break;
+    case _FX_TASK_BLTPREMULTIPLIED_:
+        fx.BltPremultiplied(t->pDstData, t->iDstLineSize, t->iDstX, iDstY, t->pSrcData, t->iSrcLineSize,
+                            t->iSrcX, iSrcY, t->iWidth, iRows, t->iBPP, t->iParam1, t->iParam2);
+        break;
+    case _FX_TASK_GRAYSCALE_:
+        OGE_FX_C_Grayscale(t->pDstData, t->iDstLineSize, t->iDstX, iDstY, t->iWidth, iRows, t->iBPP);
+        break;
 
+    // the stretch kernels keep the whole rects and only walk the rows of the band
+    case _FX_TASK_STRETCHSMOOTHLY_:
+        OGE_FX_C_StretchSmoothly(t->pDstData, t->iDstLineSize, t->iDstX, t->iDstY, t->iWidth, t->iHeight,
+                                 t->pSrcData, t->iSrcLineSize, t->iSrcX, t->iSrcY, t->iParam1, t->iParam2, t->iBPP,
+                                 iFromRow, iToRow);
+        break;
+    case _FX_TASK_BLTSTRETCH_:
+        OGE_FX_C_BltStretch(t->pDstData, t->iDstLineSize, t->iDstX, t->iDstY, t->iWidth, t->iHeight,
+                            t->pSrcData, t->iSrcLineSize, t->iSrcColorKey, t->iSrcX, t->iSrcY, t->iParam1, t->iParam2, t->iBPP,
+                            iFromRow, iToRow);
         break;
     }
+}
 
-    case 32:
+static bool OGE_FX_IsOverlapped(CogeFXTask* t)
+{
+    if (t->pSrcData == NULL) return false;
+
+    int iPixelSize = (t->iBPP + 7) >> 3;
+
+    int iSrcWidth  = t->iWidth;
+    int iSrcHeight = t->iHeight;
+    if (t->iKernel == _FX_TASK_STRETCHSMOOTHLY_ || t->iKernel == _FX_TASK_BLTSTRETCH_)
     {
-        iLineBytes = iWidth << 2;
-        pDstData += iDstY * iDstLineSize + iDstX * 4;
-        pSrcData += iSrcY * iSrcLineSize + iSrcX * 4;
+        iSrcWidth  = t->iParam1;
+        iSrcHeight = t->iParam2;
+    }
 
-        iSrcDataPad = iSrcLineSize - iLineBytes;
-        iDstDataPad = iDstLineSize - iLineBytes;
+    uint8_t* pSrcFirst = t->pSrcData + t->iSrcY * t->iSrcLineSize + t->iSrcX * iPixelSize;
+    uint8_t* pSrcLast  = pSrcFirst + (iSrcHeight - 1) * t->iSrcLineSize + iSrcWidth * iPixelSize;
+    uint8_t* pDstFirst = t->pDstData + t->iDstY * t->iDstLineSize + t->iDstX * iPixelSize;
+    uint8_t* pDstLast  = pDstFirst + (t->iHeight - 1) * t->iDstLineSize + t->iWidth * iPixelSize;
 
-        uint32_t i32ColorKey = iSrcColorKey;
-        uint32_t i32ColorSrc, i32ColorDst;
+    // a pixel which only reads itself is fine
+    if (pSrcFirst == pDstFirst && t->iSrcLineSize == t->iDstLineSize &&
+        t->iKernel != _FX_TASK_STRETCHSMOOTHLY_ && t->iKernel != _FX_TASK_BLTSTRETCH_) return false;
 
-        while(iHeight > 0)
-        {
-            iLineWidth = iWidth;
-            while(iLineWidth > 0)
-            {
-                i32ColorSrc = *((uint32_t*)pSrcData);
-                if(bNoColorKey || i32ColorSrc != i32ColorKey)
-                {
+    return pSrcFirst < pDstLast && pDstFirst < pSrcLast;
+}
 
-                    i32ColorDst = iColor;
+// returns false if the call is not worth (or not safe) to be split, then the caller should run it by itself
+static bool OGE_FX_RunTask(int iKernel,
+                uint8_t* pDstData, int iDstLineSize, int iDstX, int iDstY,
+                uint8_t* pSrcData, int iSrcLineSize, int iSrcColorKey, int iSrcX, int iSrcY,
+                int iWidth, int iHeight, int iBPP,
+                int iParam1 = 0, int iParam2 = 0, int iParam3 = 0)
+{
+    if (iWidth <= 0 || iHeight <= 1) return false;
+    if (iWidth * iHeight < OGE_FX_GetThreadPixels() || OGE_FX_GetThreads() <= 1) return false;
 
-                    iB = ((iAlpha * (((i32ColorSrc & bluemask) >> blueoffset) - ((i32ColorDst & bluemask) >> blueoffset))) >> 8) +
-                        ((i32ColorDst & bluemask) >> blueoffset);
+    CogeFXTask task;
 
-                    iG = ((iAlpha * (((i32ColorSrc & greenmask) >> greenoffset) - ((i32ColorDst & greenmask) >> greenoffset))) >> 8) +
-                        ((i32ColorDst & greenmask) >> greenoffset);
+    task.iKernel = iKernel;
 
-                    iR = ((iAlpha * (((i32ColorSrc & redmask) >> redoffset) - ((i32ColorDst & redmask) >> redoffset))) >> 8) +
-                        ((i32ColorDst & redmask) >> redoffset);
+    task.pDstData = pDstData;
+    task.iDstLineSize = iDstLineSize;
+    task.iDstX = iDstX;
+    task.iDstY = iDstY;
 
-                    *((int*)pDstData) = (iR << redoffset) | (iG << greenoffset) | (iB << blueoffset);
+    task.pSrcData = pSrcData;
+    task.iSrcLineSize = iSrcLineSize;
+    task.iSrcColorKey = iSrcColorKey;
+    task.iSrcX = iSrcX;
+    task.iSrcY = iSrcY;
 
-                }
+    task.iWidth = iWidth;
+    task.iHeight = iHeight;
+    task.iBPP = iBPP;
 
-                pSrcData += 4;
-                pDstData += 4;
+    task.iParam1 = iParam1;
+    task.iParam2 = iParam2;
+    task.iParam3 = iParam3;
 
-                iLineWidth--;
+    if (OGE_FX_IsOverlapped(&task)) return false;
 
-            }
+    return OGE_FX_RunBands(OGE_FX_RunTaskBand, &task, iHeight);
+}
 
-            pSrcData += iSrcDataPad;
-            pDstData += iDstDataPad;
+/*================= Public kernels =======================*/
 
-            iHeight--;
+void OGE_FX_CopyRect(uint8_t* pDstData, int iDstLineSize,
+                int iDstX, int iDstY,
+                uint8_t* pSrcData, int iSrcLineSize,
+                int iSrcX, int iSrcY,
+                int iWidth, int iHeight, int iBPP)
+{
+    if (OGE_FX_RunTask(_FX_TASK_COPYRECT_, pDstData, iDstLineSize, iDstX, iDstY,
+                       pSrcData, iSrcLineSize, -1, iSrcX, iSrcY, iWidth, iHeight, iBPP)) return;
 
-        }
+    fx.CopyRect(pDstData, iDstLineSize, iDstX, iDstY, pSrcData, iSrcLineSize,
+                iSrcX, iSrcY, iWidth, iHeight, iBPP);
+}
 
-        break;
-    }
+void OGE_FX_Blt(uint8_t* pDstData, int iDstLineSize,
+                int iDstX, int iDstY,
+                uint8_t* pSrcData, int iSrcLineSize, int iSrcColorKey,
+                int iSrcX, int iSrcY,
+                int iWidth, int iHeight, int iBPP)
+{
+    if (OGE_FX_RunTask(_FX_TASK_BLT_, pDstData, iDstLineSize, iDstX, iDstY,
+                       pSrcData, iSrcLineSize, iSrcColorKey, iSrcX, iSrcY, iWidth, iHeight, iBPP)) return;
 
+    fx.Blt(pDstData, iDstLineSize, iDstX, iDstY, pSrcData, iSrcLineSize, iSrcColorKey,
+           iSrcX, iSrcY, iWidth, iHeight, iBPP);
+}
 
-	}
+void OGE_FX_SubLight(uint8_t* pDstData, int iDstLineSize,
+                      int iDstX, int iDstY,
+                      int iWidth, int iHeight, int iBPP, int iAmount)
+{
+    if (OGE_FX_RunTask(_FX_TASK_SUBLIGHT_, pDstData, iDstLineSize, iDstX, iDstY,
+                       NULL, 0, -1, 0, 0, iWidth, iHeight, iBPP, iAmount)) return;
+
+    fx.SubLight(pDstData, iDstLineSize, iDstX, iDstY, iWidth, iHeight, iBPP, iAmount);
+}
+
+void OGE_FX_Lightness(uint8_t* pDstData, int iDstLineSize,
+                      int iDstX, int iDstY,
+                      int iWidth, int iHeight, int iBPP, int iAmount)
+{
+    if (OGE_FX_RunTask(_FX_TASK_LIGHTNESS_, pDstData, iDstLineSize, iDstX, iDstY,
+                       NULL, 0, -1, 0, 0, iWidth, iHeight, iBPP, iAmount)) return;
+
+    fx.Lightness(pDstData, iDstLineSize, iDstX, iDstY, iWidth, iHeight, iBPP, iAmount);
+}
+
+void OGE_FX_ChangeColorRGB(uint8_t* pDstData, int iDstLineSize,
+                      int iDstX, int iDstY,
+                      int iWidth, int iHeight, int iBPP,
+                      int iRedAmount, int iGreenAmount, int iBlueAmount)
+{
+    if (OGE_FX_RunTask(_FX_TASK_CHANGECOLORRGB_, pDstData, iDstLineSize, iDstX, iDstY,
+                       NULL, 0, -1, 0, 0, iWidth, iHeight, iBPP,
+                       iRedAmount, iGreenAmount, iBlueAmount)) return;
+
+    fx.ChangeColorRGB(pDstData, iDstLineSize, iDstX, iDstY, iWidth, iHeight, iBPP,
+                      iRedAmount, iGreenAmount, iBlueAmount);
+}
+
+void OGE_FX_BltLightness(uint8_t* pDstData, int iDstLineSize,
+                int iDstX, int iDstY,
+                uint8_t* pSrcData, int iSrcLineSize, int iSrcColorKey,
+                int iSrcX, int iSrcY,
+                int iWidth, int iHeight, int iBPP, int iAmount)
+{
+    if (OGE_FX_RunTask(_FX_TASK_BLTLIGHTNESS_, pDstData, iDstLineSize, iDstX, iDstY,
+                       pSrcData, iSrcLineSize, iSrcColorKey, iSrcX, iSrcY, iWidth, iHeight, iBPP,
+                       iAmount)) return;
+
+    fx.BltLightness(pDstData, iDstLineSize, iDstX, iDstY, pSrcData, iSrcLineSize, iSrcColorKey,
+                    iSrcX, iSrcY, iWidth, iHeight, iBPP, iAmount);
+}
+
+void OGE_FX_BltChangedRGB(uint8_t* pDstData, int iDstLineSize,
+                      int iDstX, int iDstY,
+                      uint8_t* pSrcData, int iSrcLineSize, int iSrcColorKey,
+                      int iSrcX, int iSrcY,
+                      int iWidth, int iHeight, int iBPP,
+                      int iRedAmount, int iGreenAmount, int iBlueAmount)
+{
+    if (OGE_FX_RunTask(_FX_TASK_BLTCHANGEDRGB_, pDstData, iDstLineSize, iDstX, iDstY,
+                       pSrcData, iSrcLineSize, iSrcColorKey, iSrcX, iSrcY, iWidth, iHeight, iBPP,
+                       iRedAmount, iGreenAmount, iBlueAmount)) return;
+
+    fx.BltChangedRGB(pDstData, iDstLineSize, iDstX, iDstY, pSrcData, iSrcLineSize, iSrcColorKey,
+                     iSrcX, iSrcY, iWidth, iHeight, iBPP, iRedAmount, iGreenAmount, iBlueAmount);
+}
+
+void OGE_FX_AlphaBlend(uint8_t* pDstData, int iDstLineSize,
+                int iDstX, int iDstY,
+                uint8_t* pSrcData, int iSrcLineSize, int iSrcColorKey,
+                int iSrcX, int iSrcY,
+                int iWidth, int iHeight, int iBPP, uint8_t iAlpha)
+{
+    if (OGE_FX_RunTask(_FX_TASK_ALPHABLEND_, pDstData, iDstLineSize, iDstX, iDstY,
+                       pSrcData, iSrcLineSize, iSrcColorKey, iSrcX, iSrcY, iWidth, iHeight, iBPP,
+                       iAlpha)) return;
+
+    fx.AlphaBlend(pDstData, iDstLineSize, iDstX, iDstY, pSrcData, iSrcLineSize, iSrcColorKey,
+                  iSrcX, iSrcY, iWidth, iHeight, iBPP, iAlpha);
+}
+
+void OGE_FX_LightMaskBlend(uint8_t* pDstData, int iDstLineSize,
+                int iDstX, int iDstY,
+                uint8_t* pSrcData, int iSrcLineSize,
+                int iSrcX, int iSrcY,
+                int iWidth, int iHeight, int iBPP)
+{
+    if (OGE_FX_RunTask(_FX_TASK_LIGHTMASKBLEND_, pDstData, iDstLineSize, iDstX, iDstY,
+                       pSrcData, iSrcLineSize, -1, iSrcX, iSrcY, iWidth, iHeight, iBPP)) return;
+
+    fx.LightMaskBlend(pDstData, iDstLineSize, iDstX, iDstY, pSrcData, iSrcLineSize,
+                      iSrcX, iSrcY, iWidth, iHeight, iBPP);
+}
+
+void OGE_FX_BltWithColor(uint8_t* pDstData, int iDstLineSize,
+                int iDstX, int iDstY,
+                uint8_t* pSrcData, int iSrcLineSize, int iSrcColorKey,
+                int iSrcX, int iSrcY,
+                int iWidth, int iHeight, int iBPP, int iColor, int iAlpha)
+{
+    if (OGE_FX_RunTask(_FX_TASK_BLTWITHCOLOR_, pDstData, iDstLineSize, iDstX, iDstY,
+                       pSrcData, iSrcLineSize, iSrcColorKey, iSrcX, iSrcY, iWidth, iHeight, iBPP,
+                       iColor, iAlpha)) return;
+
+    fx.BltWithColor(pDstData, iDstLineSize, iDstX, iDstY, pSrcData, iSrcLineSize, iSrcColorKey,
+                    iSrcX, iSrcY, iWidth, iHeight, iBPP, iColor, iAlpha);
+}
+
+void OGE_FX_BltPremultiplied(uint8_t* pDstData, int iDstLineSize,
+                int iDstX, int iDstY,
+                uint8_t* pSrcData, int iSrcLineSize,
+                int iSrcX, int iSrcY,
+                int iWidth, int iHeight, int iBPP, int iAlphaShift, uint8_t iAlpha)
+{
+    if (OGE_FX_RunTask(_FX_TASK_BLTPREMULTIPLIED_, pDstData, iDstLineSize, iDstX, iDstY,
+                       pSrcData, iSrcLineSize, -1, iSrcX, iSrcY, iWidth, iHeight, iBPP,
+                       iAlphaShift, iAlpha)) return;
+
+    fx.BltPremultiplied(pDstData, iDstLineSize, iDstX, iDstY, pSrcData, iSrcLineSize,
+                        iSrcX, iSrcY, iWidth, iHeight, iBPP, iAlphaShift, iAlpha);
+}
+
+void OGE_FX_Grayscale(uint8_t* pDstData, int iDstLineSize,
+                      int iDstX, int iDstY,
+                      int iWidth, int iHeight, int iBPP)
+{
+    if (OGE_FX_RunTask(_FX_TASK_GRAYSCALE_, pDstData, iDstLineSize, iDstX, iDstY,
+                       NULL, 0, -1, 0, 0, iWidth, iHeight, iBPP)) return;
+
+    OGE_FX_C_Grayscale(pDstData, iDstLineSize, iDstX, iDstY, iWidth, iHeight, iBPP);
+}
+
+void OGE_FX_StretchSmoothly(uint8_t* pDstData, int iDstLineSize,
+                int iDstX, int iDstY, uint32_t iDstWidth, uint32_t iDstHeight,
+                uint8_t* pSrcData, int iSrcLineSize,
+                int iSrcX, int iSrcY, uint32_t iSrcWidth, uint32_t iSrcHeight, int iBPP)
+{
+    if (OGE_FX_RunTask(_FX_TASK_STRETCHSMOOTHLY_, pDstData, iDstLineSize, iDstX, iDstY,
+                       pSrcData, iSrcLineSize, -1, iSrcX, iSrcY, iDstWidth, iDstHeight, iBPP,
+                       iSrcWidth, iSrcHeight)) return;
+
+    OGE_FX_C_StretchSmoothly(pDstData, iDstLineSize, iDstX, iDstY, iDstWidth, iDstHeight,
+                             pSrcData, iSrcLineSize, iSrcX, iSrcY, iSrcWidth, iSrcHeight, iBPP,
+                             0, iDstHeight);
+}
+
+void OGE_FX_BltStretch(uint8_t* pDstData, int iDstLineSize,
+                int iDstX, int iDstY, uint32_t iDstWidth, uint32_t iDstHeight,
+                uint8_t* pSrcData, int iSrcLineSize, int iSrcColorKey,
+                int iSrcX, int iSrcY, uint32_t iSrcWidth, uint32_t iSrcHeight, int iBPP)
+{
+    if (OGE_FX_RunTask(_FX_TASK_BLTSTRETCH_, pDstData, iDstLineSize, iDstX, iDstY,
+                       pSrcData, iSrcLineSize, iSrcColorKey, iSrcX, iSrcY, iDstWidth, iDstHeight, iBPP,
+                       iSrcWidth, iSrcHeight)) return;
 
+    OGE_FX_C_BltStretch(pDstData, iDstLineSize, iDstX, iDstY, iDstWidth, iDstHeight,
+                        pSrcData, iSrcLineSize, iSrcColorKey, iSrcX, iSrcY, iSrcWidth, iSrcHeight, iBPP,
+                        0, iDstHeight);
 }
 
 #endif //__FX_WITH_MMX__
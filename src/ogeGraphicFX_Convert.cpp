@@ -0,0 +1,272 @@
+/*
+-----------------------------------------------------------------------------
+This source file is part of Open Game Engine 2D.
+It is licensed under the terms of the MIT license.
+For the latest info, see http://oge2d.sourceforge.net
+
+Copyright (c) 2010-2012 Lin Jia Jun (Joe Lam)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-----------------------------------------------------------------------------
+*/
+
+// the pixel format converters of the loaded images, shared by the c and the mmx backends
+
+#include "ogeGraphicFX_Kernel.h"
+#include <cstring>
+
+#ifdef __FX_WITH_SSE__
+#include <emmintrin.h>
+#endif
+
+/* a dst channel is (src & iMask) shifted left by iLeft and then right by iRight (one of them is 0),
+   the channels which src does not have are or-ed in as iFill
+*/
+struct CogeFXConvertMap
+{
+    uint32_t iMask[4];
+    int iLeft[4];
+    int iRight[4];
+    int iChannels;
+    uint32_t iFill;
+};
+
+// the lowest bit and the number of bits of a mask, false if the bits are not contiguous
+static bool OGE_FX_GetMaskBits(uint32_t iMask, int* pShift, int* pBits)
+{
+    int iShift = 0;
+    int iBits = 0;
+
+    if (iMask == 0)
+    {
+        *pShift = 0;
+        *pBits = 0;
+        return true;
+    }
+
+    while ((iMask & 1) == 0) { iMask >>= 1; iShift++; }
+    while (iMask & 1) { iMask >>= 1; iBits++; }
+
+    *pShift = iShift;
+    *pBits = iBits;
+
+    return iMask == 0;
+}
+
+static bool OGE_FX_PrepareConvertMap(CogeFXConvertMap* pMap, int iDstBPP, const uint32_t* pDstMasks,
+                const uint32_t* pSrcMasks)
+{
+    pMap->iChannels = 0;
+    pMap->iFill = 0;
+
+    for(int c=0; c<4; c++)
+    {
+        int iDstShift, iDstBits, iSrcShift, iSrcBits;
+
+        if (!OGE_FX_GetMaskBits(pDstMasks[c], &iDstShift, &iDstBits)) return false;
+        if (!OGE_FX_GetMaskBits(pSrcMasks[c], &iSrcShift, &iSrcBits)) return false;
+
+        if (iDstBits == 0) continue;
+        if (iDstBits > 8 || (iDstBPP == 32 && iDstBits != 8)) return false;
+
+        if (iSrcBits == 0)
+        {
+            // only the alpha may be missing
+            if (c != 3) return false;
+            pMap->iFill |= pDstMasks[c];
+            continue;
+        }
+
+        if (iSrcBits != 8) return false;
+
+        // the top bits of the src channel
+        int n = pMap->iChannels++;
+        int iFrom = iSrcShift + 8 - iDstBits;
+
+        pMap->iMask[n] = ((1u << iDstBits) - 1) << iFrom;
+        pMap->iLeft[n] = iDstShift > iFrom ? iDstShift - iFrom : 0;
+        pMap->iRight[n] = iDstShift < iFrom ? iFrom - iDstShift : 0;
+    }
+
+    return true;
+}
+
+static inline uint32_t OGE_FX_ConvertPixel(const CogeFXConvertMap* pMap, uint32_t iPixel)
+{
+    uint32_t iResult = pMap->iFill;
+
+    for(int n=0; n<pMap->iChannels; n++) iResult |= ((iPixel & pMap->iMask[n]) << pMap->iLeft[n]) >> pMap->iRight[n];
+
+    return iResult;
+}
+
+// converts a row of 32 bit src pixels (pDst may be pSrc at 32 bpp)
+static void OGE_FX_ConvertRow(const CogeFXConvertMap* pMap, uint8_t* pDst, const uint32_t* pSrc, int iWidth,
+                int iDstBPP, bool bUseSSE2)
+{
+    int x = 0;
+
+#ifdef __FX_WITH_SSE__
+    if (bUseSSE2)
+    {
+        __m128i mMask[4];
+        __m128i mLeft[4];
+        __m128i mRight[4];
+
+        for(int n=0; n<pMap->iChannels; n++)
+        {
+            mMask[n] = _mm_set1_epi32(pMap->iMask[n]);
+            mLeft[n] = _mm_cvtsi32_si128(pMap->iLeft[n]);
+            mRight[n] = _mm_cvtsi32_si128(pMap->iRight[n]);
+        }
+
+        __m128i mFill = _mm_set1_epi32(pMap->iFill);
+
+        for(; x+8<=iWidth; x+=8)
+        {
+            __m128i a = _mm_loadu_si128((const __m128i*)(pSrc + x));
+            __m128i b = _mm_loadu_si128((const __m128i*)(pSrc + x + 4));
+            __m128i ra = mFill;
+            __m128i rb = mFill;
+
+            for(int n=0; n<pMap->iChannels; n++)
+            {
+                __m128i va = _mm_and_si128(a, mMask[n]);
+                __m128i vb = _mm_and_si128(b, mMask[n]);
+
+                ra = _mm_or_si128(ra, _mm_srl_epi32(_mm_sll_epi32(va, mLeft[n]), mRight[n]));
+                rb = _mm_or_si128(rb, _mm_srl_epi32(_mm_sll_epi32(vb, mLeft[n]), mRight[n]));
+            }
+
+            if (iDstBPP == 32)
+            {
+                _mm_storeu_si128((__m128i*)(pDst + x * 4), ra);
+                _mm_storeu_si128((__m128i*)(pDst + x * 4 + 16), rb);
+            }
+            else
+            {
+                // sign extended, so the signed pack keeps the 16 bits as they are
+                ra = _mm_srai_epi32(_mm_slli_epi32(ra, 16), 16);
+                rb = _mm_srai_epi32(_mm_slli_epi32(rb, 16), 16);
+
+                _mm_storeu_si128((__m128i*)(pDst + x * 2), _mm_packs_epi32(ra, rb));
+            }
+        }
+    }
+#endif
+
+    if (iDstBPP == 32)
+    {
+        uint32_t* d = (uint32_t*) pDst;
+        for(; x<iWidth; x++) d[x] = OGE_FX_ConvertPixel(pMap, pSrc[x]);
+    }
+    else
+    {
+        uint16_t* d = (uint16_t*) pDst;
+        for(; x<iWidth; x++) d[x] = (uint16_t) OGE_FX_ConvertPixel(pMap, pSrc[x]);
+    }
+}
+
+// unpacks a row of 24 bpp pixels (little endian) to 32 bit, four at a time from three words
+static void OGE_FX_UnpackRow24(uint32_t* pDst, const uint8_t* pSrc, int iWidth)
+{
+    int x = 0;
+
+    for(; x+4<=iWidth; x+=4, pSrc+=12)
+    {
+        uint32_t w0, w1, w2;
+
+        memcpy(&w0, pSrc, 4);
+        memcpy(&w1, pSrc + 4, 4);
+        memcpy(&w2, pSrc + 8, 4);
+
+        pDst[x]     = w0 & 0xffffff;
+        pDst[x + 1] = (w0 >> 24) | ((w1 & 0xffff) << 8);
+        pDst[x + 2] = (w1 >> 16) | ((w2 & 0xff) << 16);
+        pDst[x + 3] = w2 >> 8;
+    }
+
+    for(; x<iWidth; x++, pSrc+=3) pDst[x] = pSrc[0] | (pSrc[1] << 8) | (pSrc[2] << 16);
+}
+
+bool OGE_FX_ConvertPixels(uint8_t* pDstData, int iDstLineSize, int iDstBPP, const uint32_t* pDstMasks,
+                uint8_t* pSrcData, int iSrcLineSize, int iSrcBPP, const uint32_t* pSrcMasks,
+                const uint32_t* pPalette, int iPaletteSize,
+                int iWidth, int iHeight)
+{
+    static const uint32_t iPaletteMasks[4] = { 0x00ff0000, 0x0000ff00, 0x000000ff, 0xff000000 };
+
+    if (iDstBPP != 16 && iDstBPP != 32) return false;
+    if (iSrcBPP != 8 && iSrcBPP != 24 && iSrcBPP != 32) return false;
+    if (iSrcBPP == 8 && (pPalette == NULL || iPaletteSize <= 0)) return false;
+
+    CogeFXConvertMap map;
+
+    if (!OGE_FX_PrepareConvertMap(&map, iDstBPP, pDstMasks, iSrcBPP == 8 ? iPaletteMasks : pSrcMasks)) return false;
+
+    if (iWidth <= 0 || iHeight <= 0) return true;
+
+    bool bUseSSE2 = OGE_FX_GetBackend() >= _OGE_FX_BACKEND_SSE2_;
+
+    if (iSrcBPP == 8)
+    {
+        // the palette in the dst format, the pixels are only looked up in it
+        uint32_t iColors[256];
+
+        memset(iColors, 0, sizeof(iColors));
+        for(int i=0; i<256 && i<iPaletteSize; i++) iColors[i] = OGE_FX_ConvertPixel(&map, pPalette[i]);
+
+        for(int y=0; y<iHeight; y++)
+        {
+            const uint8_t* s = pSrcData + y * iSrcLineSize;
+
+            if (iDstBPP == 32)
+            {
+                uint32_t* d = (uint32_t*)(pDstData + y * iDstLineSize);
+                for(int x=0; x<iWidth; x++) d[x] = iColors[s[x]];
+            }
+            else
+            {
+                uint16_t* d = (uint16_t*)(pDstData + y * iDstLineSize);
+                for(int x=0; x<iWidth; x++) d[x] = (uint16_t) iColors[s[x]];
+            }
+        }
+
+        return true;
+    }
+
+    uint32_t* pRow = iSrcBPP == 24 ? new uint32_t[iWidth] : NULL;
+
+    for(int y=0; y<iHeight; y++)
+    {
+        const uint8_t* s = pSrcData + y * iSrcLineSize;
+        uint8_t* d = pDstData + y * iDstLineSize;
+
+        if (iSrcBPP == 24)
+        {
+            OGE_FX_UnpackRow24(pRow, s, iWidth);
+            OGE_FX_ConvertRow(&map, d, pRow, iWidth, iDstBPP, bUseSSE2);
+        }
+        else OGE_FX_ConvertRow(&map, d, (const uint32_t*) s, iWidth, iDstBPP, bUseSSE2);
+    }
+
+    delete [] pRow;
+
+    return true;
+}
@@ -0,0 +1,391 @@
+/*
+-----------------------------------------------------------------------------
+This source file is part of Open Game Engine 2D.
+It is licensed under the terms of the MIT license.
+For the latest info, see http://oge2d.sourceforge.net
+
+Copyright (c) 2010-2012 Lin Jia Jun (Joe Lam)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-----------------------------------------------------------------------------
+*/
+
+// 8 bit indexed images, shared by the c and the mmx backends
+
+#include "ogeGraphicFX_Kernel.h"
+#include <cstring>
+
+struct CogeFXIndexed
+{
+    int iWidth;
+    int iHeight;
+    int iBPP;
+    int iPixelSize;
+
+    int iColors;
+    int iKeyIndex;  // the index of the color key, -1 if there is none
+
+    uint8_t* pIndices; // iWidth x iHeight
+    uint8_t* pPalette; // 256 colors in the format of the pixels
+};
+
+// the size of the hash table of the colors while an image is being indexed (a power of 2, over 256)
+#define _FX_INDEX_HASH_SIZE_ 1024
+
+static inline uint32_t OGE_FX_ReadPixel(const uint8_t* p, int iPixelSize)
+{
+    if (iPixelSize == 2) return *((const uint16_t*)p);
+    else return *((const uint32_t*)p);
+}
+
+static inline void OGE_FX_WritePixel(uint8_t* p, int iPixelSize, uint32_t iPixel)
+{
+    if (iPixelSize == 2) *((uint16_t*)p) = (uint16_t) iPixel;
+    else *((uint32_t*)p) = iPixel;
+}
+
+CogeFXIndexed* OGE_FX_BuildIndexed(uint8_t* pSrcData, int iSrcLineSize,
+                int iWidth, int iHeight, int iBPP, int iColorKey)
+{
+    if (iBPP != 16 && iBPP != 32) return NULL;
+    if (iWidth <= 0 || iHeight <= 0) return NULL;
+
+    int iPixelSize = iBPP >> 3;
+
+    uint32_t iKeys[_FX_INDEX_HASH_SIZE_];
+    int iSlots[_FX_INDEX_HASH_SIZE_]; // the index of a color + 1, 0 for an empty slot
+
+    memset(iSlots, 0, sizeof(iSlots));
+
+    CogeFXIndexed* pIndexed = new CogeFXIndexed();
+
+    pIndexed->iWidth = iWidth;
+    pIndexed->iHeight = iHeight;
+    pIndexed->iBPP = iBPP;
+    pIndexed->iPixelSize = iPixelSize;
+    pIndexed->iColors = 0;
+    pIndexed->iKeyIndex = -1;
+    pIndexed->pIndices = new uint8_t[iWidth * iHeight];
+    pIndexed->pPalette = new uint8_t[256 * iPixelSize];
+
+    memset(pIndexed->pPalette, 0, 256 * iPixelSize);
+
+    uint32_t iKeyPixel = iPixelSize == 2 ? (uint32_t)(iColorKey & 0xffff) : (uint32_t)iColorKey;
+
+    // the pixels next to each other are mostly the same
+    uint32_t iLastPixel = 0;
+    int iLastIndex = -1;
+
+    for(int y=0; y<iHeight; y++)
+    {
+        const uint8_t* s = pSrcData + y * iSrcLineSize;
+        uint8_t* d = pIndexed->pIndices + y * iWidth;
+
+        for(int x=0; x<iWidth; x++, s+=iPixelSize)
+        {
+            uint32_t iPixel = OGE_FX_ReadPixel(s, iPixelSize);
+
+            if (iPixel != iLastPixel || iLastIndex < 0)
+            {
+                uint32_t h = (iPixel * 2654435761u) >> 22;
+
+                while (iSlots[h] != 0 && iKeys[h] != iPixel) h = (h + 1) & (_FX_INDEX_HASH_SIZE_ - 1);
+
+                if (iSlots[h] == 0)
+                {
+                    if (pIndexed->iColors == 256)
+                    {
+                        OGE_FX_FreeIndexed(pIndexed);
+                        return NULL;
+                    }
+
+                    int iIndex = pIndexed->iColors++;
+
+                    iKeys[h] = iPixel;
+                    iSlots[h] = iIndex + 1;
+
+                    OGE_FX_WritePixel(pIndexed->pPalette + iIndex * iPixelSize, iPixelSize, iPixel);
+
+                    if (iColorKey != -1 && iPixel == iKeyPixel) pIndexed->iKeyIndex = iIndex;
+                }
+
+                iLastPixel = iPixel;
+                iLastIndex = iSlots[h] - 1;
+            }
+
+            d[x] = (uint8_t) iLastIndex;
+        }
+    }
+
+    return pIndexed;
+}
+
+void OGE_FX_FreeIndexed(CogeFXIndexed* pIndexed)
+{
+    if (pIndexed == NULL) return;
+
+    delete [] pIndexed->pIndices;
+    delete [] pIndexed->pPalette;
+    delete pIndexed;
+}
+
+int OGE_FX_GetIndexedSize(CogeFXIndexed* pIndexed)
+{
+    if (pIndexed == NULL) return 0;
+
+    return sizeof(CogeFXIndexed) + pIndexed->iWidth * pIndexed->iHeight + 256 * pIndexed->iPixelSize;
+}
+
+int OGE_FX_GetIndexedColors(CogeFXIndexed* pIndexed)
+{
+    return pIndexed ? pIndexed->iColors : 0;
+}
+
+int OGE_FX_GetIndexedKey(CogeFXIndexed* pIndexed)
+{
+    return pIndexed ? pIndexed->iKeyIndex : -1;
+}
+
+uint8_t* OGE_FX_GetIndexedPalette(CogeFXIndexed* pIndexed)
+{
+    return pIndexed ? pIndexed->pPalette : NULL;
+}
+
+// expands a row through the palette, the pixels of the key index are skipped if bSkipKey
+static void OGE_FX_IndexedRow(uint8_t* pDst, const uint8_t* pIndices, const uint8_t* pPalette,
+                int iWidth, int iPixelSize, int iKeyIndex, bool bSkipKey)
+{
+    if (!bSkipKey) iKeyIndex = -1;
+
+    // four indexes at a time, a zero byte of (indexes ^ keys) is a pixel of the color key
+    uint32_t iKeys = iKeyIndex < 0 ? 0 : (uint32_t) iKeyIndex * 0x01010101u;
+
+    int x = 0;
+
+    if (iPixelSize == 4)
+    {
+        const uint32_t* pColors = (const uint32_t*) pPalette;
+        uint32_t* d = (uint32_t*) pDst;
+
+        for(; x+4<=iWidth; x+=4)
+        {
+            uint32_t iFour;
+            memcpy(&iFour, pIndices + x, 4);
+
+            if (iKeyIndex >= 0)
+            {
+                uint32_t v = iFour ^ iKeys;
+
+                if (v == 0) continue;
+
+                if ((v - 0x01010101u) & ~v & 0x80808080u)
+                {
+                    for(int k=0; k<4; k++)
+                        if (pIndices[x + k] != iKeyIndex) d[x + k] = pColors[pIndices[x + k]];
+                    continue;
+                }
+            }
+
+            d[x]     = pColors[pIndices[x]];
+            d[x + 1] = pColors[pIndices[x + 1]];
+            d[x + 2] = pColors[pIndices[x + 2]];
+            d[x + 3] = pColors[pIndices[x + 3]];
+        }
+
+        for(; x<iWidth; x++)
+            if (pIndices[x] != iKeyIndex) d[x] = pColors[pIndices[x]];
+    }
+    else
+    {
+        const uint16_t* pColors = (const uint16_t*) pPalette;
+        uint16_t* d = (uint16_t*) pDst;
+
+        for(; x+4<=iWidth; x+=4)
+        {
+            uint32_t iFour;
+            memcpy(&iFour, pIndices + x, 4);
+
+            if (iKeyIndex >= 0)
+            {
+                uint32_t v = iFour ^ iKeys;
+
+                if (v == 0) continue;
+
+                if ((v - 0x01010101u) & ~v & 0x80808080u)
+                {
+                    for(int k=0; k<4; k++)
+                        if (pIndices[x + k] != iKeyIndex) d[x + k] = pColors[pIndices[x + k]];
+                    continue;
+                }
+            }
+
+            d[x]     = pColors[pIndices[x]];
+            d[x + 1] = pColors[pIndices[x + 1]];
+            d[x + 2] = pColors[pIndices[x + 2]];
+            d[x + 3] = pColors[pIndices[x + 3]];
+        }
+
+        for(; x<iWidth; x++)
+            if (pIndices[x] != iKeyIndex) d[x] = pColors[pIndices[x]];
+    }
+}
+
+void OGE_FX_UnpackIndexed(uint8_t* pDstData, int iDstLineSize,
+                CogeFXIndexed* pIndexed, uint8_t* pPalette)
+{
+    if (pIndexed == NULL) return;
+    if (pPalette == NULL) pPalette = pIndexed->pPalette;
+
+    for(int y=0; y<pIndexed->iHeight; y++)
+        OGE_FX_IndexedRow(pDstData + y * iDstLineSize, pIndexed->pIndices + y * pIndexed->iWidth, pPalette,
+                          pIndexed->iWidth, pIndexed->iPixelSize, pIndexed->iKeyIndex, false);
+}
+
+void OGE_FX_IndexedBlt(uint8_t* pDstData, int iDstLineSize,
+                int iDstX, int iDstY,
+                CogeFXIndexed* pSrcIndexed, uint8_t* pPalette,
+                int iSrcX, int iSrcY,
+                int iWidth, int iHeight)
+{
+    if (pSrcIndexed == NULL || iWidth <= 0 || iHeight <= 0) return;
+    if (pPalette == NULL) pPalette = pSrcIndexed->pPalette;
+
+    int iPixelSize = pSrcIndexed->iPixelSize;
+
+    for(int y=0; y<iHeight; y++)
+        OGE_FX_IndexedRow(pDstData + (iDstY + y) * iDstLineSize + iDstX * iPixelSize,
+                          pSrcIndexed->pIndices + (iSrcY + y) * pSrcIndexed->iWidth + iSrcX, pPalette,
+                          iWidth, iPixelSize, pSrcIndexed->iKeyIndex, true);
+}
+
+void OGE_FX_IndexedAlphaBlend(uint8_t* pDstData, int iDstLineSize,
+                int iDstX, int iDstY,
+                CogeFXIndexed* pSrcIndexed, uint8_t* pPalette,
+                int iSrcX, int iSrcY,
+                int iWidth, int iHeight, uint8_t iAlpha)
+{
+    if (pSrcIndexed == NULL || iWidth <= 0 || iHeight <= 0) return;
+    if (pPalette == NULL) pPalette = pSrcIndexed->pPalette;
+
+    int iPixelSize = pSrcIndexed->iPixelSize;
+    int iKeyIndex = pSrcIndexed->iKeyIndex;
+
+    int iColorKey = -1;
+    if (iKeyIndex >= 0) iColorKey = (int) OGE_FX_ReadPixel(pPalette + iKeyIndex * iPixelSize, iPixelSize);
+
+    // a few rows at a time through the normal kernel (with the color key of the palette)
+    const int iBandRows = 8;
+
+    uint8_t* pRows = new uint8_t[iWidth * iPixelSize * iBandRows];
+
+    for(int y=0; y<iHeight; y+=iBandRows)
+    {
+        int iRows = iHeight - y < iBandRows ? iHeight - y : iBandRows;
+
+        for(int k=0; k<iRows; k++)
+            OGE_FX_IndexedRow(pRows + k * iWidth * iPixelSize,
+                              pSrcIndexed->pIndices + (iSrcY + y + k) * pSrcIndexed->iWidth + iSrcX, pPalette,
+                              iWidth, iPixelSize, iKeyIndex, false);
+
+        OGE_FX_AlphaBlend(pDstData, iDstLineSize, iDstX, iDstY + y,
+                          pRows, iWidth * iPixelSize, iColorKey,
+                          0, 0, iWidth, iRows, pSrcIndexed->iBPP, iAlpha);
+    }
+
+    delete [] pRows;
+}
+
+// the key color of a palette, or -1
+static int OGE_FX_GetPaletteKey(CogeFXIndexed* pIndexed, uint8_t* pPalette)
+{
+    if (pIndexed->iKeyIndex < 0) return -1;
+    return (int) OGE_FX_ReadPixel(pPalette + pIndexed->iKeyIndex * pIndexed->iPixelSize, pIndexed->iPixelSize);
+}
+
+/* the effects below change the colors of the palette (a row of iColors pixels) with the normal kernel
+   and then draw the pixels through the changed palette, so they cost about the same as OGE_FX_IndexedBlt()
+*/
+
+void OGE_FX_IndexedBltLightness(uint8_t* pDstData, int iDstLineSize,
+                int iDstX, int iDstY,
+                CogeFXIndexed* pSrcIndexed, uint8_t* pPalette,
+                int iSrcX, int iSrcY,
+                int iWidth, int iHeight, int iAmount)
+{
+    if (pSrcIndexed == NULL || iWidth <= 0 || iHeight <= 0) return;
+    if (pPalette == NULL) pPalette = pSrcIndexed->pPalette;
+
+    uint32_t iColors[256];
+    int iLineSize = pSrcIndexed->iColors * pSrcIndexed->iPixelSize;
+
+    memcpy(iColors, pPalette, 256 * pSrcIndexed->iPixelSize);
+
+    OGE_FX_BltLightness((uint8_t*)iColors, iLineSize, 0, 0,
+                        pPalette, iLineSize, OGE_FX_GetPaletteKey(pSrcIndexed, pPalette),
+                        0, 0, pSrcIndexed->iColors, 1, pSrcIndexed->iBPP, iAmount);
+
+    OGE_FX_IndexedBlt(pDstData, iDstLineSize, iDstX, iDstY, pSrcIndexed, (uint8_t*)iColors,
+                      iSrcX, iSrcY, iWidth, iHeight);
+}
+
+void OGE_FX_IndexedBltChangedRGB(uint8_t* pDstData, int iDstLineSize,
+                int iDstX, int iDstY,
+                CogeFXIndexed* pSrcIndexed, uint8_t* pPalette,
+                int iSrcX, int iSrcY,
+                int iWidth, int iHeight,
+                int iRedAmount, int iGreenAmount, int iBlueAmount)
+{
+    if (pSrcIndexed == NULL || iWidth <= 0 || iHeight <= 0) return;
+    if (pPalette == NULL) pPalette = pSrcIndexed->pPalette;
+
+    uint32_t iColors[256];
+    int iLineSize = pSrcIndexed->iColors * pSrcIndexed->iPixelSize;
+
+    memcpy(iColors, pPalette, 256 * pSrcIndexed->iPixelSize);
+
+    OGE_FX_BltChangedRGB((uint8_t*)iColors, iLineSize, 0, 0,
+                         pPalette, iLineSize, OGE_FX_GetPaletteKey(pSrcIndexed, pPalette),
+                         0, 0, pSrcIndexed->iColors, 1, pSrcIndexed->iBPP,
+                         iRedAmount, iGreenAmount, iBlueAmount);
+
+    OGE_FX_IndexedBlt(pDstData, iDstLineSize, iDstX, iDstY, pSrcIndexed, (uint8_t*)iColors,
+                      iSrcX, iSrcY, iWidth, iHeight);
+}
+
+void OGE_FX_IndexedBltWithColor(uint8_t* pDstData, int iDstLineSize,
+                int iDstX, int iDstY,
+                CogeFXIndexed* pSrcIndexed, uint8_t* pPalette,
+                int iSrcX, int iSrcY,
+                int iWidth, int iHeight, int iColor, int iAlpha)
+{
+    if (pSrcIndexed == NULL || iWidth <= 0 || iHeight <= 0) return;
+    if (pPalette == NULL) pPalette = pSrcIndexed->pPalette;
+
+    uint32_t iColors[256];
+    int iLineSize = pSrcIndexed->iColors * pSrcIndexed->iPixelSize;
+
+    memcpy(iColors, pPalette, 256 * pSrcIndexed->iPixelSize);
+
+    OGE_FX_BltWithColor((uint8_t*)iColors, iLineSize, 0, 0,
+                        pPalette, iLineSize, OGE_FX_GetPaletteKey(pSrcIndexed, pPalette),
+                        0, 0, pSrcIndexed->iColors, 1, pSrcIndexed->iBPP, iColor, iAlpha);
+
+    OGE_FX_IndexedBlt(pDstData, iDstLineSize, iDstX, iDstY, pSrcIndexed, (uint8_t*)iColors,
+                      iSrcX, iSrcY, iWidth, iHeight);
+}
@@ -0,0 +1,147 @@
+/*
+-----------------------------------------------------------------------------
+This source file is part of Open Game Engine 2D.
+It is licensed under the terms of the MIT license.
+For the latest info, see http://oge2d.sourceforge.net
+
+Copyright (c) 2010-2012 Lin Jia Jun (Joe Lam)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-----------------------------------------------------------------------------
+*/
+
+#ifndef __OGE_GRAPHICFX_KERNEL_H_INCLUDED__
+#define __OGE_GRAPHICFX_KERNEL_H_INCLUDED__
+
+// internal header shared by the fx backends (not a part of the public api)
+
+#include "ogeGraphicFX.h"
+
+// the sse backend is only built along with the c backend ...
+#ifndef __FX_WITH_MMX__
+#ifndef __FX_WITHOUT_SSE__
+#if defined(__SSE2__) || defined(__x86_64__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define __FX_WITH_SSE__
+#endif
+#endif
+#endif
+
+typedef void (*ogeFXCopyRect)(uint8_t* pDstData, int iDstLineSize,
+                int iDstX, int iDstY,
+                uint8_t* pSrcData, int iSrcLineSize,
+                int iSrcX, int iSrcY,
+                int iWidth, int iHeight, int iBPP);
+
+typedef void (*ogeFXBlt)(uint8_t* pDstData, int iDstLineSize,
+                int iDstX, int iDstY,
+                uint8_t* pSrcData, int iSrcLineSize, int iSrcColorKey,
+                int iSrcX, int iSrcY,
+                int iWidth, int iHeight, int iBPP);
+
+typedef void (*ogeFXAdjust)(uint8_t* pDstData, int iDstLineSize,
+                int iDstX, int iDstY,
+                int iWidth, int iHeight, int iBPP, int iAmount);
+
+typedef void (*ogeFXAdjustRGB)(uint8_t* pDstData, int iDstLineSize,
+                int iDstX, int iDstY,
+                int iWidth, int iHeight, int iBPP,
+                int iRedAmount, int iGreenAmount, int iBlueAmount);
+
+typedef void (*ogeFXBltAdjust)(uint8_t* pDstData, int iDstLineSize,
+                int iDstX, int iDstY,
+                uint8_t* pSrcData, int iSrcLineSize, int iSrcColorKey,
+                int iSrcX, int iSrcY,
+                int iWidth, int iHeight, int iBPP, int iAmount);
+
+typedef void (*ogeFXBltAdjustRGB)(uint8_t* pDstData, int iDstLineSize,
+                int iDstX, int iDstY,
+                uint8_t* pSrcData, int iSrcLineSize, int iSrcColorKey,
+                int iSrcX, int iSrcY,
+                int iWidth, int iHeight, int iBPP,
+                int iRedAmount, int iGreenAmount, int iBlueAmount);
+
+typedef void (*ogeFXAlphaBlend)(uint8_t* pDstData, int iDstLineSize,
+                int iDstX, int iDstY,
+                uint8_t* pSrcData, int iSrcLineSize, int iSrcColorKey,
+                int iSrcX, int iSrcY,
+                int iWidth, int iHeight, int iBPP, uint8_t iAlpha);
+
+typedef void (*ogeFXLightMaskBlend)(uint8_t* pDstData, int iDstLineSize,
+                int iDstX, int iDstY,
+                uint8_t* pSrcData, int iSrcLineSize,
+                int iSrcX, int iSrcY,
+                int iWidth, int iHeight, int iBPP);
+
+typedef void (*ogeFXBltWithColor)(uint8_t* pDstData, int iDstLineSize,
+                int iDstX, int iDstY,
+                uint8_t* pSrcData, int iSrcLineSize, int iSrcColorKey,
+                int iSrcX, int iSrcY,
+                int iWidth, int iHeight, int iBPP, int iColor, int iAlpha);
+
+typedef void (*ogeFXBltPremultiplied)(uint8_t* pDstData, int iDstLineSize,
+                int iDstX, int iDstY,
+                uint8_t* pSrcData, int iSrcLineSize,
+                int iSrcX, int iSrcY,
+                int iWidth, int iHeight, int iBPP, int iAlphaShift, uint8_t iAlpha);
+
+// the kernels which may be replaced by a faster backend at runtime
+struct CogeFXKernels
+{
+    ogeFXCopyRect       CopyRect;
+    ogeFXBlt            Blt;
+    ogeFXAdjust         SubLight;
+    ogeFXAdjust         Lightness;
+    ogeFXAdjustRGB      ChangeColorRGB;
+    ogeFXBltAdjust      BltLightness;
+    ogeFXBltAdjustRGB   BltChangedRGB;
+    ogeFXAlphaBlend     AlphaBlend;
+    ogeFXLightMaskBlend LightMaskBlend;
+    ogeFXBltWithColor   BltWithColor;
+    ogeFXBltPremultiplied BltPremultiplied;
+};
+
+// the c version of OGE_FX_BltPremultiplied() (see ogeGraphicFX_Alpha.cpp)
+void OGE_FX_C_BltPremultiplied(uint8_t* pDstData, int iDstLineSize,
+                int iDstX, int iDstY,
+                uint8_t* pSrcData, int iSrcLineSize,
+                int iSrcX, int iSrcY,
+                int iWidth, int iHeight, int iBPP, int iAlphaShift, uint8_t iAlpha);
+
+// compiles the tables of a color transform for iBPP if they are out of date (see ogeGraphicFX_LUT.cpp)
+bool OGE_FX_PrepareColorTransform(CogeFXColorTransform* pTransform, int iBPP);
+
+// runs a prepared color transform on a row, the pixels of iSrcColorKey are skipped (pDst may be pSrc)
+void OGE_FX_ColorTransformRow(CogeFXColorTransform* pTransform, uint8_t* pDst, uint8_t* pSrc,
+                int iWidth, int iBPP, int iSrcColorKey);
+
+#ifdef __FX_WITH_SSE__
+
+/* returns the best simd backend supported by current cpu (_OGE_FX_BACKEND_SSE2_ or _OGE_FX_BACKEND_AVX2_),
+   or _OGE_FX_BACKEND_C_ if none of them is supported
+*/
+int OGE_FX_SSE_Check();
+
+/* replaces the kernels in pKernels with the simd versions of iBackend,
+   pFallback is used for the cases which the simd kernels do not handle (other bpp, the remain columns ...)
+*/
+void OGE_FX_SSE_Setup(CogeFXKernels* pKernels, const CogeFXKernels* pFallback, int iBackend);
+
+#endif // __FX_WITH_SSE__
+
+#endif // __OGE_GRAPHICFX_KERNEL_H_INCLUDED__
@@ -0,0 +1,577 @@
+/*
+-----------------------------------------------------------------------------
+This source file is part of Open Game Engine 2D.
+It is licensed under the terms of the MIT license.
+For the latest info, see http://oge2d.sourceforge.net
+
+Copyright (c) 2010-2012 Lin Jia Jun (Joe Lam)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-----------------------------------------------------------------------------
+*/
+
+// color transforms (chains of color adjustments compiled into lookup tables), shared by the c and the mmx backends
+
+#include "ogeGraphicFX_Kernel.h"
+#include <cstring>
+#include <cstdlib>
+
+#ifdef __FX_WITH_SSE__
+#include <immintrin.h>
+
+#if defined(__GNUC__)
+#define _FX_AVX2_FUNC_ __attribute__((target("avx2")))
+#else
+#define _FX_AVX2_FUNC_
+#endif
+
+#endif // __FX_WITH_SSE__
+
+#define _OGE_FX_COLOR_MAX_OPS_  16
+
+#define _FX_MIX_NONE_   0
+#define _FX_MIX_GRAY_   1
+
+#if defined(__MACOSX__) || defined(__IPHONE__)
+
+static const int lutredshift   = 8;
+static const int lutgreenshift = 16;
+static const int lutblueshift  = 24;
+
+#else
+
+static const int lutredshift   = 16;
+static const int lutgreenshift = 8;
+static const int lutblueshift  = 0;
+
+#endif
+
+struct CogeFXColorOp
+{
+    int iType;
+    int iAmount1;
+    int iAmount2;
+    int iAmount3;
+};
+
+/* one stage of a compiled 32 bpp chain, the channels first go through the (optional) gray mix
+   c = Saturate(iMixValues[r + g + b] + iMixAdds[c], 255), and then through the tables of the channels
+*/
+struct CogeFXColorStage
+{
+    int iMix;
+    int iMixValues[768];
+    int iMixAdds[256];
+    uint8_t iTables[3][256]; // r, g, b
+};
+
+struct CogeFXColorTransform
+{
+    int iOpCount;
+    CogeFXColorOp ops[_OGE_FX_COLOR_MAX_OPS_];
+
+    int iBPP; // the bpp of the compiled tables, 0 if they are out of date
+    int iCompiledOpCount;
+
+    // 32 bpp
+    int iStageCount;
+    CogeFXColorStage* pStages;
+    uint32_t iTables32[3][256]; // the tables of a single stage without mix, already shifted to the channels
+
+    // 16 bpp, the chains without gray adjustments only need the tables of the 3 channels (already shifted)
+    bool bSplit16;
+    uint16_t iTables16[3][64]; // bits 11 ~ 15, 5 ~ 10, 0 ~ 4
+    uint16_t* pTable16;
+};
+
+struct CogeFXColorTask
+{
+    CogeFXColorTransform* pTransform;
+
+    uint8_t* pDstData;
+    int iDstLineSize;
+
+    uint8_t* pSrcData;
+    int iSrcLineSize;
+    int iSrcColorKey;
+
+    int iWidth;
+    int iHeight;
+    int iBPP;
+
+    bool bUseAVX2;
+};
+
+CogeFXColorTransform* OGE_FX_NewColorTransform()
+{
+    CogeFXColorTransform* pTransform = (CogeFXColorTransform*) malloc(sizeof(CogeFXColorTransform));
+    if (pTransform) memset(pTransform, 0, sizeof(CogeFXColorTransform));
+    return pTransform;
+}
+
+void OGE_FX_FreeColorTransform(CogeFXColorTransform* pTransform)
+{
+    if (pTransform == NULL) return;
+
+    if (pTransform->pStages) free(pTransform->pStages);
+    if (pTransform->pTable16) free(pTransform->pTable16);
+
+    free(pTransform);
+}
+
+// the compiled tables are kept, so building the same chain again does not compile it again
+void OGE_FX_ClearColorTransform(CogeFXColorTransform* pTransform)
+{
+    if (pTransform == NULL) return;
+
+    pTransform->iOpCount = 0;
+}
+
+int OGE_FX_AddColorAdjustment(CogeFXColorTransform* pTransform, int iType,
+                int iAmount1, int iAmount2, int iAmount3)
+{
+    if (pTransform == NULL) return -1;
+    if (iType < _OGE_FX_COLOR_LIGHTNESS_ || iType > _OGE_FX_COLOR_BLEND_) return -1;
+    if (pTransform->iOpCount >= _OGE_FX_COLOR_MAX_OPS_) return -1;
+
+    CogeFXColorOp* pOp = &pTransform->ops[pTransform->iOpCount];
+
+    if (pTransform->iOpCount >= pTransform->iCompiledOpCount || pOp->iType != iType ||
+        pOp->iAmount1 != iAmount1 || pOp->iAmount2 != iAmount2 || pOp->iAmount3 != iAmount3)
+        pTransform->iBPP = 0;
+
+    pOp->iType = iType;
+    pOp->iAmount1 = iAmount1;
+    pOp->iAmount2 = iAmount2;
+    pOp->iAmount3 = iAmount3;
+
+    pTransform->iOpCount++;
+
+    return pTransform->iOpCount;
+}
+
+int OGE_FX_GetColorTransformLength(CogeFXColorTransform* pTransform)
+{
+    if (pTransform == NULL) return 0;
+    else return pTransform->iOpCount;
+}
+
+// runs one adjustment on a probe image (the same kernels as the ones of the single adjustments)
+static void OGE_FX_RunColorOp(const CogeFXColorOp* pOp, uint8_t* pData, int iLineSize,
+                int iWidth, int iHeight, int iBPP)
+{
+    switch (pOp->iType)
+    {
+    case _OGE_FX_COLOR_LIGHTNESS_:
+        OGE_FX_Lightness(pData, iLineSize, 0, 0, iWidth, iHeight, iBPP, pOp->iAmount1);
+        break;
+    case _OGE_FX_COLOR_SUBLIGHT_:
+        OGE_FX_SubLight(pData, iLineSize, 0, 0, iWidth, iHeight, iBPP, pOp->iAmount1);
+        break;
+    case _OGE_FX_COLOR_RGB_:
+        OGE_FX_ChangeColorRGB(pData, iLineSize, 0, 0, iWidth, iHeight, iBPP,
+                              pOp->iAmount1, pOp->iAmount2, pOp->iAmount3);
+        break;
+    case _OGE_FX_COLOR_GRAYSCALE_:
+        OGE_FX_Grayscale(pData, iLineSize, 0, 0, iWidth, iHeight, iBPP);
+        break;
+    case _OGE_FX_COLOR_GRAYLEVEL_:
+        OGE_FX_ChangeGrayLevel(pData, iLineSize, 0, 0, iWidth, iHeight, iBPP, pOp->iAmount1);
+        break;
+    case _OGE_FX_COLOR_BLEND_:
+        OGE_FX_BltWithColor(pData, iLineSize, 0, 0, pData, iLineSize, -1, 0, 0, iWidth, iHeight, iBPP,
+                            pOp->iAmount1, pOp->iAmount2);
+        break;
+    }
+}
+
+static inline int OGE_FX_Clamp255(int i)
+{
+    return i < 0 ? 0 : (i > 255 ? 255 : i);
+}
+
+static bool OGE_FX_IsGrayOp(int iType)
+{
+    return iType == _OGE_FX_COLOR_GRAYSCALE_ || iType == _OGE_FX_COLOR_GRAYLEVEL_;
+}
+
+static bool OGE_FX_Compile16(CogeFXColorTransform* pTransform)
+{
+    pTransform->bSplit16 = true;
+    for(int i=0; i<pTransform->iOpCount; i++)
+    {
+        if (OGE_FX_IsGrayOp(pTransform->ops[i].iType)) pTransform->bSplit16 = false;
+    }
+
+    if (pTransform->bSplit16)
+    {
+        // probe i carries the value i in each channel (5, 6 and 5 bits)
+        uint16_t iProbe[64];
+
+        for(int i=0; i<64; i++) iProbe[i] = ((i & 31) << 11) | (i << 5) | (i & 31);
+
+        for(int i=0; i<pTransform->iOpCount; i++)
+            OGE_FX_RunColorOp(&pTransform->ops[i], (uint8_t*)iProbe, 128, 64, 1, 16);
+
+        for(int i=0; i<64; i++)
+        {
+            pTransform->iTables16[0][i] = iProbe[i & 31] & 0xf800;
+            pTransform->iTables16[1][i] = iProbe[i] & 0x07e0;
+            pTransform->iTables16[2][i] = iProbe[i & 31] & 0x001f;
+        }
+
+        return true;
+    }
+
+    // every 565 color goes through the whole chain, so any adjustment (the gray ones included) fits in the table
+    if (pTransform->pTable16 == NULL)
+    {
+        pTransform->pTable16 = (uint16_t*) malloc(65536 * sizeof(uint16_t));
+        if (pTransform->pTable16 == NULL) return false;
+    }
+
+    uint16_t* pTable = pTransform->pTable16;
+
+    for(int i=0; i<65536; i++) pTable[i] = i;
+
+    for(int i=0; i<pTransform->iOpCount; i++)
+        OGE_FX_RunColorOp(&pTransform->ops[i], (uint8_t*)pTable, 512, 256, 256, 16);
+
+    return true;
+}
+
+// the tables of the channels for a run of adjustments without gray mix
+static void OGE_FX_CompileStageTables(CogeFXColorStage* pStage, const CogeFXColorOp* pOps, int iCount)
+{
+    uint32_t iProbe[256];
+
+    for(int i=0; i<256; i++) iProbe[i] = (i << lutredshift) | (i << lutgreenshift) | (i << lutblueshift);
+
+    for(int i=0; i<iCount; i++) OGE_FX_RunColorOp(&pOps[i], (uint8_t*)iProbe, 1024, 256, 1, 32);
+
+    for(int i=0; i<256; i++)
+    {
+        pStage->iTables[0][i] = (iProbe[i] >> lutredshift)   & 0xff;
+        pStage->iTables[1][i] = (iProbe[i] >> lutgreenshift) & 0xff;
+        pStage->iTables[2][i] = (iProbe[i] >> lutblueshift)  & 0xff;
+    }
+}
+
+// the gray adjustments mix the channels, so they can not be put into the tables (see OGE_FX_ChangeGrayLevel())
+static void OGE_FX_CompileStageMix(CogeFXColorStage* pStage, const CogeFXColorOp* pOp)
+{
+    pStage->iMix = _FX_MIX_GRAY_;
+
+    if (pOp->iType == _OGE_FX_COLOR_GRAYSCALE_)
+    {
+        for(int i=0; i<768; i++) pStage->iMixValues[i] = i / 3;
+        for(int i=0; i<256; i++) pStage->iMixAdds[i] = 0;
+    }
+    else
+    {
+        // keep the uint16_t of OGE_FX_ChangeGrayLevel(), the result of a negative amount depends on it
+        for(int i=0; i<256; i++) pStage->iMixAdds[i] = (uint16_t)((i * pOp->iAmount1) >> 8);
+        for(int i=0; i<768; i++) pStage->iMixValues[i] = i / 3 - pStage->iMixAdds[i / 3];
+    }
+}
+
+static bool OGE_FX_Compile32(CogeFXColorTransform* pTransform)
+{
+    int iStageCount = 1;
+    for(int i=0; i<pTransform->iOpCount; i++)
+    {
+        int iType = pTransform->ops[i].iType;
+        if (i > 0 && OGE_FX_IsGrayOp(iType)) iStageCount++;
+    }
+
+    if (pTransform->pStages) free(pTransform->pStages);
+    pTransform->pStages = (CogeFXColorStage*) malloc(iStageCount * sizeof(CogeFXColorStage));
+    if (pTransform->pStages == NULL) return false;
+
+    pTransform->iStageCount = iStageCount;
+
+    // each gray adjustment starts a new stage, the others are put into the tables of current stage
+    int iFrom = 0;
+    for(int s=0; s<iStageCount; s++)
+    {
+        CogeFXColorStage* pStage = &pTransform->pStages[s];
+        pStage->iMix = _FX_MIX_NONE_;
+
+        if (iFrom < pTransform->iOpCount)
+        {
+            if (OGE_FX_IsGrayOp(pTransform->ops[iFrom].iType))
+            {
+                OGE_FX_CompileStageMix(pStage, &pTransform->ops[iFrom]);
+                iFrom++;
+            }
+        }
+
+        int iTo = iFrom;
+        while (iTo < pTransform->iOpCount && !OGE_FX_IsGrayOp(pTransform->ops[iTo].iType)) iTo++;
+
+        OGE_FX_CompileStageTables(pStage, &pTransform->ops[iFrom], iTo - iFrom);
+
+        iFrom = iTo;
+    }
+
+    for(int i=0; i<256; i++)
+    {
+        pTransform->iTables32[0][i] = pTransform->pStages[0].iTables[0][i] << lutredshift;
+        pTransform->iTables32[1][i] = pTransform->pStages[0].iTables[1][i] << lutgreenshift;
+        pTransform->iTables32[2][i] = pTransform->pStages[0].iTables[2][i] << lutblueshift;
+    }
+
+    return true;
+}
+
+bool OGE_FX_PrepareColorTransform(CogeFXColorTransform* pTransform, int iBPP)
+{
+    if (iBPP != 16 && iBPP != 32) return false;
+
+    if (pTransform->iBPP == iBPP && pTransform->iCompiledOpCount == pTransform->iOpCount) return true;
+
+    bool bDone = iBPP == 16 ? OGE_FX_Compile16(pTransform) : OGE_FX_Compile32(pTransform);
+
+    pTransform->iBPP = bDone ? iBPP : 0;
+    pTransform->iCompiledOpCount = bDone ? pTransform->iOpCount : 0;
+
+    return bDone;
+}
+
+static void OGE_FX_ColorRow16(const CogeFXColorTransform* pTransform, uint16_t* pDst, const uint16_t* pSrc,
+                int iWidth, int iSrcColorKey)
+{
+    bool bNoColorKey = iSrcColorKey == -1;
+    uint16_t i16ColorKey = iSrcColorKey & 0xffff;
+
+    if (pTransform->bSplit16)
+    {
+        const uint16_t* pRed   = pTransform->iTables16[0];
+        const uint16_t* pGreen = pTransform->iTables16[1];
+        const uint16_t* pBlue  = pTransform->iTables16[2];
+
+        for(int x=0; x<iWidth; x++)
+        {
+            uint16_t iColor = pSrc[x];
+            if (bNoColorKey || iColor != i16ColorKey)
+                pDst[x] = pRed[iColor >> 11] | pGreen[(iColor >> 5) & 0x3f] | pBlue[iColor & 0x1f];
+        }
+
+        return;
+    }
+
+    const uint16_t* pTable = pTransform->pTable16;
+
+    for(int x=0; x<iWidth; x++)
+    {
+        uint16_t iColor = pSrc[x];
+        if (bNoColorKey || iColor != i16ColorKey) pDst[x] = pTable[iColor];
+    }
+}
+
+static void OGE_FX_ColorRow32(const CogeFXColorTransform* pTransform, uint32_t* pDst, const uint32_t* pSrc,
+                int iWidth, int iSrcColorKey, int iFrom)
+{
+    const uint32_t iOtherMask = ~((0xffu << lutredshift) | (0xffu << lutgreenshift) | (0xffu << lutblueshift));
+    bool bNoColorKey = iSrcColorKey == -1;
+    uint32_t i32ColorKey = iSrcColorKey;
+
+    if (pTransform->iStageCount == 1 && pTransform->pStages[0].iMix == _FX_MIX_NONE_)
+    {
+        const uint32_t* pRed   = pTransform->iTables32[0];
+        const uint32_t* pGreen = pTransform->iTables32[1];
+        const uint32_t* pBlue  = pTransform->iTables32[2];
+
+        for(int x=iFrom; x<iWidth; x++)
+        {
+            uint32_t iColor = pSrc[x];
+            if (bNoColorKey || iColor != i32ColorKey)
+                pDst[x] = (iColor & iOtherMask) |
+                          pRed[(iColor >> lutredshift) & 0xff] |
+                          pGreen[(iColor >> lutgreenshift) & 0xff] |
+                          pBlue[(iColor >> lutblueshift) & 0xff];
+        }
+
+        return;
+    }
+
+    for(int x=iFrom; x<iWidth; x++)
+    {
+        uint32_t iColor = pSrc[x];
+        if (!bNoColorKey && iColor == i32ColorKey) continue;
+
+        int r = (iColor >> lutredshift)   & 0xff;
+        int g = (iColor >> lutgreenshift) & 0xff;
+        int b = (iColor >> lutblueshift)  & 0xff;
+
+        for(int s=0; s<pTransform->iStageCount; s++)
+        {
+            const CogeFXColorStage* pStage = &pTransform->pStages[s];
+
+            if (pStage->iMix == _FX_MIX_GRAY_)
+            {
+                int iGray = pStage->iMixValues[r + g + b];
+                r = OGE_FX_Clamp255(iGray + pStage->iMixAdds[r]);
+                g = OGE_FX_Clamp255(iGray + pStage->iMixAdds[g]);
+                b = OGE_FX_Clamp255(iGray + pStage->iMixAdds[b]);
+            }
+
+            r = pStage->iTables[0][r];
+            g = pStage->iTables[1][g];
+            b = pStage->iTables[2][b];
+        }
+
+        pDst[x] = (iColor & iOtherMask) | (r << lutredshift) | (g << lutgreenshift) | (b << lutblueshift);
+    }
+}
+
+#ifdef __FX_WITH_SSE__
+
+// 8 pixels a time with the gathers of avx2 (single stage without mix only), returns the number of pixels done
+_FX_AVX2_FUNC_
+static int OGE_FX_AVX2_ColorRow32(const CogeFXColorTransform* pTransform, uint32_t* pDst, const uint32_t* pSrc,
+                int iWidth, int iSrcColorKey)
+{
+    const uint32_t iOtherMask = ~((0xffu << lutredshift) | (0xffu << lutgreenshift) | (0xffu << lutblueshift));
+
+    const int* pRed   = (const int*) pTransform->iTables32[0];
+    const int* pGreen = (const int*) pTransform->iTables32[1];
+    const int* pBlue  = (const int*) pTransform->iTables32[2];
+
+    __m256i vByte  = _mm256_set1_epi32(0xff);
+    __m256i vOther = _mm256_set1_epi32((int)iOtherMask);
+    __m256i vKey   = _mm256_set1_epi32(iSrcColorKey);
+
+    int x = 0;
+    for(; x + 8 <= iWidth; x += 8)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(pSrc + x));
+
+        __m256i r = _mm256_i32gather_epi32(pRed,   _mm256_and_si256(_mm256_srli_epi32(v, lutredshift),   vByte), 4);
+        __m256i g = _mm256_i32gather_epi32(pGreen, _mm256_and_si256(_mm256_srli_epi32(v, lutgreenshift), vByte), 4);
+        __m256i b = _mm256_i32gather_epi32(pBlue,  _mm256_and_si256(_mm256_srli_epi32(v, lutblueshift),  vByte), 4);
+
+        __m256i c = _mm256_or_si256(_mm256_and_si256(v, vOther), _mm256_or_si256(r, _mm256_or_si256(g, b)));
+
+        if (iSrcColorKey != -1)
+        {
+            __m256i vSkip = _mm256_cmpeq_epi32(v, vKey);
+            __m256i d = _mm256_loadu_si256((const __m256i*)(pDst + x));
+            c = _mm256_blendv_epi8(c, d, vSkip);
+        }
+
+        _mm256_storeu_si256((__m256i*)(pDst + x), c);
+    }
+
+    return x;
+}
+
+#endif // __FX_WITH_SSE__
+
+static bool OGE_FX_UseAVX2(const CogeFXColorTransform* pTransform, int iBPP)
+{
+#ifdef __FX_WITH_SSE__
+    return iBPP == 32 && OGE_FX_GetBackend() >= _OGE_FX_BACKEND_AVX2_ &&
+           pTransform->iStageCount == 1 && pTransform->pStages[0].iMix == _FX_MIX_NONE_;
+#else
+    return false;
+#endif
+}
+
+static void OGE_FX_RunColorRow(CogeFXColorTransform* pTransform, uint8_t* pDst, uint8_t* pSrc,
+                int iWidth, int iBPP, int iSrcColorKey, bool bUseAVX2)
+{
+    if (iBPP == 16)
+    {
+        OGE_FX_ColorRow16(pTransform, (uint16_t*)pDst, (uint16_t*)pSrc, iWidth, iSrcColorKey);
+        return;
+    }
+
+    int x = 0;
+
+#ifdef __FX_WITH_SSE__
+    if (bUseAVX2) x = OGE_FX_AVX2_ColorRow32(pTransform, (uint32_t*)pDst, (uint32_t*)pSrc, iWidth, iSrcColorKey);
+#endif
+
+    OGE_FX_ColorRow32(pTransform, (uint32_t*)pDst, (uint32_t*)pSrc, iWidth, iSrcColorKey, x);
+}
+
+void OGE_FX_ColorTransformRow(CogeFXColorTransform* pTransform, uint8_t* pDst, uint8_t* pSrc,
+                int iWidth, int iBPP, int iSrcColorKey)
+{
+    OGE_FX_RunColorRow(pTransform, pDst, pSrc, iWidth, iBPP, iSrcColorKey, OGE_FX_UseAVX2(pTransform, iBPP));
+}
+
+static void OGE_FX_ColorBand(void* pTask, int iFromRow, int iToRow)
+{
+    CogeFXColorTask* t = (CogeFXColorTask*) pTask;
+
+    for(int y=iFromRow; y<iToRow; y++)
+    {
+        OGE_FX_RunColorRow(t->pTransform, t->pDstData + y * t->iDstLineSize, t->pSrcData + y * t->iSrcLineSize,
+                           t->iWidth, t->iBPP, t->iSrcColorKey, t->bUseAVX2);
+    }
+}
+
+void OGE_FX_BltColorTransform(uint8_t* pDstData, int iDstLineSize,
+                int iDstX, int iDstY,
+                uint8_t* pSrcData, int iSrcLineSize, int iSrcColorKey,
+                int iSrcX, int iSrcY,
+                int iWidth, int iHeight, int iBPP, CogeFXColorTransform* pTransform)
+{
+    if (pTransform == NULL) return;
+    if (iBPP != 16 && iBPP != 32) return;
+    if (iWidth <= 0 || iHeight <= 0) return;
+
+    if (!OGE_FX_PrepareColorTransform(pTransform, iBPP)) return;
+
+    int iPixelSize = iBPP >> 3;
+
+    CogeFXColorTask task;
+
+    task.pTransform = pTransform;
+
+    task.pDstData = pDstData + iDstY * iDstLineSize + iDstX * iPixelSize;
+    task.iDstLineSize = iDstLineSize;
+    task.pSrcData = pSrcData + iSrcY * iSrcLineSize + iSrcX * iPixelSize;
+    task.iSrcLineSize = iSrcLineSize;
+    task.iSrcColorKey = iSrcColorKey;
+
+    task.iWidth = iWidth;
+    task.iHeight = iHeight;
+    task.iBPP = iBPP;
+
+    task.bUseAVX2 = OGE_FX_UseAVX2(pTransform, iBPP);
+
+    // each pixel only depends on itself, so the rows can always run on the fx threads (in place too)
+    bool bUseThreads = OGE_FX_GetThreads() > 1 && iWidth * iHeight >= OGE_FX_GetThreadPixels();
+
+    if (bUseThreads && OGE_FX_RunBands(OGE_FX_ColorBand, &task, iHeight)) return;
+
+    OGE_FX_ColorBand(&task, 0, iHeight);
+}
+
+void OGE_FX_ColorTransform(uint8_t* pDstData, int iDstLineSize,
+                int iDstX, int iDstY,
+                int iWidth, int iHeight, int iBPP, CogeFXColorTransform* pTransform)
+{
+    OGE_FX_BltColorTransform(pDstData, iDstLineSize, iDstX, iDstY,
+                             pDstData, iDstLineSize, -1, iDstX, iDstY,
+                             iWidth, iHeight, iBPP, pTransform);
+}
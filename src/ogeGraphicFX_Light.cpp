@@ -0,0 +1,468 @@
+/*
+-----------------------------------------------------------------------------
+This source file is part of Open Game Engine 2D.
+It is licensed under the terms of the MIT license.
+For the latest info, see http://oge2d.sourceforge.net
+
+Copyright (c) 2010-2012 Lin Jia Jun (Joe Lam)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-----------------------------------------------------------------------------
+*/
+
+// quarter resolution light buffers (one darkness byte per 4x4 pixels), shared by the c and the mmx backends
+
+#include "ogeGraphicFX_Kernel.h"
+#include <cstring>
+
+#ifdef __FX_WITH_SSE__
+#include <emmintrin.h>
+#endif
+
+#if defined(__MACOSX__) || defined(__IPHONE__)
+static const int lightblueshift = 24;
+#else
+static const int lightblueshift = 0;
+#endif
+
+// the darkness of a light mask pixel is its blue channel (what OGE_FX_LightMaskBlend() reads), as 0 .. 255
+static inline int OGE_FX_LightAmount16(uint16_t iPixel)
+{
+    int b = iPixel & 0x1f;
+    return (b << 3) | (b >> 2);
+}
+
+static inline int OGE_FX_LightAmount32(uint32_t iPixel)
+{
+    return (iPixel >> lightblueshift) & 0xff;
+}
+
+void OGE_FX_DownsampleLight(uint8_t* pLightData, int iLightLineSize,
+                uint8_t* pSrcData, int iSrcLineSize,
+                int iSrcX, int iSrcY,
+                int iWidth, int iHeight, int iBPP,
+                int iPhaseX, int iPhaseY, int iOutside)
+{
+    if (iWidth <= 0 || iHeight <= 0 || (iBPP != 16 && iBPP != 32)) return;
+
+    iPhaseX &= 3;
+    iPhaseY &= 3;
+
+    int iCols = (iWidth + iPhaseX + 3) >> 2;
+    int iRows = (iHeight + iPhaseY + 3) >> 2;
+
+    int* pSums = new int[iCols];
+
+    pSrcData += iSrcY * iSrcLineSize + iSrcX * (iBPP >> 3);
+
+    for(int j=0; j<iRows; j++)
+    {
+        memset(pSums, 0, iCols * sizeof(int));
+
+        // the rows of the mask in the cell row
+        int iFrom = (j << 2) - iPhaseY;
+        int iTo = iFrom + 4;
+        if (iFrom < 0) iFrom = 0;
+        if (iTo > iHeight) iTo = iHeight;
+
+        for(int y=iFrom; y<iTo; y++)
+        {
+            uint8_t* pLine = pSrcData + y * iSrcLineSize;
+
+            if (iBPP == 16)
+            {
+                for(int x=0; x<iWidth; x++)
+                    pSums[(x + iPhaseX) >> 2] += OGE_FX_LightAmount16(((uint16_t*)pLine)[x]);
+            }
+            else
+            {
+                for(int x=0; x<iWidth; x++)
+                    pSums[(x + iPhaseX) >> 2] += OGE_FX_LightAmount32(((uint32_t*)pLine)[x]);
+            }
+        }
+
+        uint8_t* pLight = pLightData + j * iLightLineSize;
+
+        for(int i=0; i<iCols; i++)
+        {
+            int iLeft = (i << 2) - iPhaseX;
+            int iRight = iLeft + 4;
+            if (iLeft < 0) iLeft = 0;
+            if (iRight > iWidth) iRight = iWidth;
+
+            // the pixels of the cell out of the mask count as iOutside
+            int iInside = (iRight - iLeft) * (iTo - iFrom);
+
+            pLight[i] = (pSums[i] + iOutside * (16 - iInside) + 8) >> 4;
+        }
+    }
+
+    delete [] pSums;
+}
+
+void OGE_FX_AddLight(uint8_t* pLightData, int iLightLineSize, int iCols, int iRows,
+                int iDstX, int iDstY,
+                uint8_t* pSrcData, int iSrcLineSize,
+                int iWidth, int iHeight)
+{
+    int iSrcX = 0;
+    int iSrcY = 0;
+
+    if (iDstX < 0) { iSrcX = -iDstX; iWidth += iDstX; iDstX = 0; }
+    if (iDstY < 0) { iSrcY = -iDstY; iHeight += iDstY; iDstY = 0; }
+    if (iDstX + iWidth > iCols) iWidth = iCols - iDstX;
+    if (iDstY + iHeight > iRows) iHeight = iRows - iDstY;
+
+    if (iWidth <= 0 || iHeight <= 0) return;
+
+    for(int y=0; y<iHeight; y++)
+    {
+        uint8_t* pLight = pLightData + (iDstY + y) * iLightLineSize + iDstX;
+        uint8_t* pSrc = pSrcData + (iSrcY + y) * iSrcLineSize + iSrcX;
+
+        // the same as OGE_FX_LightMaskBlend() on the darkness
+        for(int x=0; x<iWidth; x++) pLight[x] -= (pLight[x] * pSrc[x]) >> 8;
+    }
+}
+
+struct CogeFXLightTask
+{
+    uint8_t* pDstData;
+    int iDstLineSize;
+    int iDstX;
+    int iDstY;
+    int iWidth;
+    int iBPP;
+
+    uint8_t* pLightData;
+    int iLightLineSize;
+    int iCols;
+    int iRows;
+    int iLightX;
+    int iLightY;
+
+    bool bUseSSE2;
+};
+
+// the bilinear position of the light pixel p in the cells, the centre of cell i is at the pixel 4i + 1.5
+static inline void OGE_FX_LightSample(int p, int iCount, int& i0, int& i1, int& f)
+{
+    int u = 2 * p - 3; // in 1/8 of a cell
+
+    if (u < 0) { i0 = i1 = 0; f = 0; return; }
+
+    i0 = u >> 3;
+    f = u & 7;
+    i1 = i0 + 1;
+
+    if (i1 >= iCount)
+    {
+        i0 = i1 = iCount - 1;
+        f = 0;
+    }
+}
+
+// a row of cells upsampled to the pixels of a row (x8, so 0 .. 255 * 8), returns false if all of them are 0
+static bool OGE_FX_LightRow(uint16_t* pRow, const uint8_t* pCells, int iCols, int iLightX, int iWidth)
+{
+    int x = 0;
+    int iAll = 0;
+
+    // the pixels before the centre of the first cell (and the ones after the last) get the cell as it is
+    while (x < iWidth && 2 * (iLightX + x) - 3 < 0)
+    {
+        pRow[x++] = pCells[0] << 3;
+        iAll |= pCells[0];
+    }
+
+    while (x < iWidth)
+    {
+        int u = 2 * (iLightX + x) - 3;
+        int i = u >> 3;
+
+        if (i + 1 >= iCols)
+        {
+            int m = pCells[iCols - 1];
+            iAll |= m;
+            while (x < iWidth) pRow[x++] = m << 3;
+            break;
+        }
+
+        int m0 = pCells[i];
+        int m1 = pCells[i + 1];
+
+        iAll |= m0 | m1;
+
+        // the pixels up to the next cell, u goes up by 2 per pixel
+        int f = u & 7;
+        int m = m0 * (8 - f) + m1 * f;
+        int iStep = (m1 - m0) * 2;
+        int iCount = (8 - f + 1) >> 1;
+        if (iCount > iWidth - x) iCount = iWidth - x;
+
+        while (iCount > 0)
+        {
+            pRow[x++] = m;
+            m += iStep;
+            iCount--;
+        }
+    }
+
+    return iAll != 0;
+}
+
+// the darkness of the pixels of a row, the vertical mix of two upsampled rows of cells
+static void OGE_FX_LightMix(uint8_t* pDarkness, const uint16_t* pRow0, const uint16_t* pRow1, int f, int iWidth,
+                bool bUseSSE2)
+{
+    int x = 0;
+
+#ifdef __FX_WITH_SSE__
+    if (bUseSSE2)
+    {
+        __m128i mF0 = _mm_set1_epi16(8 - f);
+        __m128i mF1 = _mm_set1_epi16(f);
+
+        int iVecWidth = iWidth & ~15;
+
+        for(; x<iVecWidth; x+=16)
+        {
+            __m128i a = _mm_add_epi16(_mm_mullo_epi16(_mm_loadu_si128((const __m128i*)(pRow0 + x)), mF0),
+                                      _mm_mullo_epi16(_mm_loadu_si128((const __m128i*)(pRow1 + x)), mF1));
+            __m128i b = _mm_add_epi16(_mm_mullo_epi16(_mm_loadu_si128((const __m128i*)(pRow0 + x + 8)), mF0),
+                                      _mm_mullo_epi16(_mm_loadu_si128((const __m128i*)(pRow1 + x + 8)), mF1));
+
+            _mm_storeu_si128((__m128i*)(pDarkness + x), _mm_packus_epi16(_mm_srli_epi16(a, 6), _mm_srli_epi16(b, 6)));
+        }
+    }
+#endif
+
+    for(; x<iWidth; x++) pDarkness[x] = (pRow0[x] * (8 - f) + pRow1[x] * f) >> 6;
+}
+
+#ifdef __FX_WITH_SSE__
+
+// darkens the pixels of a row by their darkness, returns the number of pixels done (the rest is left to the c code)
+static int OGE_FX_SSE_LightRow(uint8_t* pLine, const uint8_t* pDarkness, int iWidth, int iBPP)
+{
+    __m128i mZero = _mm_setzero_si128();
+
+    if (iBPP == 16)
+    {
+        int iVecWidth = iWidth & ~7;
+
+        __m128i mGreenMask = _mm_set1_epi16(0x3f);
+        __m128i mBlueMask = _mm_set1_epi16(0x1f);
+
+        for(int x=0; x<iVecWidth; x+=8)
+        {
+            __m128i d = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(pDarkness + x)), mZero);
+
+            if (_mm_movemask_epi8(_mm_cmpeq_epi16(d, mZero)) == 0xffff) continue;
+
+            __m128i a = _mm_srli_epi16(d, 3);
+            __m128i ag = _mm_srli_epi16(d, 2);
+
+            __m128i p = _mm_loadu_si128((__m128i*)(pLine + x * 2));
+
+            __m128i r = _mm_srli_epi16(p, 11);
+            __m128i g = _mm_and_si128(_mm_srli_epi16(p, 5), mGreenMask);
+            __m128i b = _mm_and_si128(p, mBlueMask);
+
+            r = _mm_sub_epi16(r, _mm_srli_epi16(_mm_mullo_epi16(a, r), 5));
+            g = _mm_sub_epi16(g, _mm_srli_epi16(_mm_mullo_epi16(ag, g), 6));
+            b = _mm_sub_epi16(b, _mm_srli_epi16(_mm_mullo_epi16(a, b), 5));
+
+            p = _mm_or_si128(_mm_or_si128(_mm_slli_epi16(r, 11), _mm_slli_epi16(g, 5)), b);
+
+            _mm_storeu_si128((__m128i*)(pLine + x * 2), p);
+        }
+
+        return iVecWidth;
+    }
+    else
+    {
+        int iVecWidth = iWidth & ~3;
+
+        // no darkness on the alpha byte
+        __m128i mAlphaMask = _mm_set1_epi32(0xff << (24 - lightblueshift));
+
+        for(int x=0; x<iVecWidth; x+=4)
+        {
+            int iFour;
+            memcpy(&iFour, pDarkness + x, 4);
+
+            if (iFour == 0) continue;
+
+            __m128i d = _mm_cvtsi32_si128(iFour);
+            d = _mm_unpacklo_epi8(d, d);
+            d = _mm_unpacklo_epi16(d, d);
+            d = _mm_andnot_si128(mAlphaMask, d);
+
+            __m128i p = _mm_loadu_si128((__m128i*)(pLine + x * 4));
+
+            __m128i pl = _mm_unpacklo_epi8(p, mZero);
+            __m128i ph = _mm_unpackhi_epi8(p, mZero);
+
+            pl = _mm_sub_epi16(pl, _mm_srli_epi16(_mm_mullo_epi16(pl, _mm_unpacklo_epi8(d, mZero)), 8));
+            ph = _mm_sub_epi16(ph, _mm_srli_epi16(_mm_mullo_epi16(ph, _mm_unpackhi_epi8(d, mZero)), 8));
+
+            _mm_storeu_si128((__m128i*)(pLine + x * 4), _mm_packus_epi16(pl, ph));
+        }
+
+        return iVecWidth;
+    }
+}
+
+#endif // __FX_WITH_SSE__
+
+static void OGE_FX_LightBand(void* pTask, int iFromRow, int iToRow)
+{
+    CogeFXLightTask* t = (CogeFXLightTask*) pTask;
+
+    // the upsampled rows of cells, a row of cells serves 4 rows of pixels
+    uint16_t* pRows[2];
+    int iRowIndex[2] = {-1, -1};
+    bool bRowLit[2] = {true, true};
+
+    uint16_t* pRowData = new uint16_t[t->iWidth * 2];
+
+    pRows[0] = pRowData;
+    pRows[1] = pRowData + t->iWidth;
+
+    uint8_t* pDarkness = new uint8_t[t->iWidth];
+
+    for(int y=iFromRow; y<iToRow; y++)
+    {
+        int j0, j1, fy;
+        OGE_FX_LightSample(t->iLightY + y, t->iRows, j0, j1, fy);
+
+        if (iRowIndex[1] == j0)
+        {
+            uint16_t* pRow = pRows[0]; pRows[0] = pRows[1]; pRows[1] = pRow;
+            int iIndex = iRowIndex[0]; iRowIndex[0] = iRowIndex[1]; iRowIndex[1] = iIndex;
+            bool bLit = bRowLit[0]; bRowLit[0] = bRowLit[1]; bRowLit[1] = bLit;
+        }
+
+        for(int k=0; k<2; k++)
+        {
+            int j = k == 0 ? j0 : j1;
+            if (iRowIndex[k] == j) continue;
+
+            bRowLit[k] = !OGE_FX_LightRow(pRows[k], t->pLightData + j * t->iLightLineSize, t->iCols, t->iLightX, t->iWidth);
+            iRowIndex[k] = j;
+        }
+
+        if (bRowLit[0] && (bRowLit[1] || fy == 0)) continue;
+
+        OGE_FX_LightMix(pDarkness, pRows[0], pRows[1], fy, t->iWidth, t->bUseSSE2);
+
+        uint8_t* pLine = t->pDstData + (t->iDstY + y) * t->iDstLineSize + t->iDstX * (t->iBPP >> 3);
+
+        int iDone = 0;
+
+#ifdef __FX_WITH_SSE__
+        if (t->bUseSSE2) iDone = OGE_FX_SSE_LightRow(pLine, pDarkness, t->iWidth, t->iBPP);
+#endif
+
+        if (t->iBPP == 16)
+        {
+            uint16_t* pDst = (uint16_t*) pLine;
+
+            for(int x=iDone; x<t->iWidth; x++)
+            {
+                int d = pDarkness[x];
+                if (d == 0) continue;
+
+                // the amounts of a 565 mask pixel of darkness d (see OGE_FX_LightMaskBlend())
+                int a = d >> 3;
+                int ag = d >> 2;
+
+                int iPixel = pDst[x];
+
+                int r = iPixel >> 11;
+                int g = (iPixel >> 5) & 0x3f;
+                int b = iPixel & 0x1f;
+
+                r -= (a * r) >> 5;
+                g -= (ag * g) >> 6;
+                b -= (a * b) >> 5;
+
+                pDst[x] = (r << 11) | (g << 5) | b;
+            }
+        }
+        else
+        {
+            uint32_t* pDst = (uint32_t*) pLine;
+
+            for(int x=iDone; x<t->iWidth; x++)
+            {
+                uint32_t d = pDarkness[x];
+                if (d == 0) continue;
+
+                // two channels at once (c * d / 256 of a byte never gets into the next one), the alpha byte is kept
+                uint32_t iPixel = pDst[x];
+                uint32_t iHigh = (iPixel >> 8) & 0x00ff00ff;
+                uint32_t iLow = iPixel & 0x00ff00ff;
+
+                iHigh -= ((iHigh * d) >> 8) & 0x00ff00ff;
+                iLow -= ((iLow * d) >> 8) & 0x00ff00ff;
+
+                if (lightblueshift == 0) iHigh = (iHigh & 0x000000ff) | ((iPixel >> 8) & 0x00ff0000);
+                else iLow = (iLow & 0x00ff0000) | (iPixel & 0x000000ff);
+
+                pDst[x] = (iHigh << 8) | iLow;
+            }
+        }
+    }
+
+    delete [] pDarkness;
+    delete [] pRowData;
+}
+
+void OGE_FX_LightBlend(uint8_t* pDstData, int iDstLineSize,
+                int iDstX, int iDstY,
+                int iWidth, int iHeight, int iBPP,
+                uint8_t* pLightData, int iLightLineSize, int iCols, int iRows,
+                int iLightX, int iLightY)
+{
+    if (iWidth <= 0 || iHeight <= 0 || iCols <= 0 || iRows <= 0 || (iBPP != 16 && iBPP != 32)) return;
+
+    CogeFXLightTask task;
+
+    task.pDstData = pDstData;
+    task.iDstLineSize = iDstLineSize;
+    task.iDstX = iDstX;
+    task.iDstY = iDstY;
+    task.iWidth = iWidth;
+    task.iBPP = iBPP;
+    task.pLightData = pLightData;
+    task.iLightLineSize = iLightLineSize;
+    task.iCols = iCols;
+    task.iRows = iRows;
+    task.iLightX = iLightX;
+    task.iLightY = iLightY;
+    task.bUseSSE2 = OGE_FX_GetBackend() >= _OGE_FX_BACKEND_SSE2_;
+
+    bool bUseThreads = OGE_FX_GetThreads() > 1 && iWidth * iHeight >= OGE_FX_GetThreadPixels();
+
+    if (bUseThreads && OGE_FX_RunBands(OGE_FX_LightBand, &task, iHeight)) return;
+
+    OGE_FX_LightBand(&task, 0, iHeight);
+}
@@ -27,6 +27,7 @@ THE SOFTWARE.
 */
 
 #include "ogeGraphicFX.h"
+#include "ogeGraphicFX_Kernel.h"
 #include <cmath>
 #include <cstring>
 #include <algorithm>
@@ -77,7 +78,6 @@ static uint64_t __attribute__((aligned(8))) i64X16         = 0x003f003f003f003fL
 static uint8_t  ri[65536], gi[65536], bi[65536], div3[766];
 static uint16_t rw[256],   gw[256],   bw[256];
 static uint16_t maskr16, maskg16, maskb16;
-static int wavex[65536], wavey[65536];
 //static int wavesin[65536], wavecos[65536];
 
 static ogeColor32 cm16[65536];
@@ -314,6 +314,23 @@ int OGE_FX_CheckMMX()
 
 }
 
+// the mmx build has only one set of kernels ...
+
+int OGE_FX_GetBestBackend()
+{
+    return mmxflag > 0 ? _OGE_FX_BACKEND_MMX_ : _OGE_FX_BACKEND_C_;
+}
+
+int OGE_FX_GetBackend()
+{
+    return OGE_FX_GetBestBackend();
+}
+
+int OGE_FX_SetBackend(int iBackend)
+{
+    return OGE_FX_GetBackend();
+}
+
 int OGE_FX_Saturate(int i, int iMax)
 {
     /*
@@ -5532,111 +5549,6 @@ void OGE_FX_UpdateAlphaBlt(uint8_t* pDstData, int iDstLineSize,
 
 }
 
-void OGE_FX_BltRotate(uint8_t* pDstData, int iDstLineSize,
-                int iDstX, int iDstY, uint32_t iDstWidth, uint32_t iDstHeight,
-                uint8_t* pSrcData, int iSrcLineSize,
-                int iSrcX, int iSrcY, uint32_t iSrcWidth, uint32_t iSrcHeight, int iBPP,
-                int iSrcColorKey, double fAngle, int iZoom)
-{
-
-    uint32_t X, Y, dx, dy, xd, yd, sdx, sdy, ax, ay, cx, cy, isin, icos;
-
-    int iColor;
-
-    uint32_t* pc32;
-    uint16_t* pc16;
-
-    cx = iDstWidth >> 1;
-    cy = iDstHeight >> 1;
-
-    //if(iBPP == 16) iZoom = iZoom >> 8;
-
-    isin = lround(sin(fAngle * _OGE_PI_ / 180) * iZoom);
-    icos = lround(cos(fAngle * _OGE_PI_ / 180) * iZoom);
-
-    xd = ((iSrcWidth  << 16) - (iDstWidth  << 16)) / 2;
-    yd = ((iSrcHeight << 16) - (iDstHeight << 16)) / 2;
-    ax = (cx << 16) - (icos * cx);
-    ay = (cy << 16) - (isin * cx);
-
-    //pc  = (ogeColor32*)(pDstData);
-
-
-    switch(iBPP)
-    {
-    case 16:
-
-        pDstData += iDstY * iDstLineSize + iDstX * 2;
-        pSrcData += iSrcY * iSrcLineSize + iSrcX * 2;
-
-        for(Y=0;Y<iDstHeight;Y++)
-        {
-            dy  = cy - Y;
-            sdx = (ax + (isin * dy)) + xd;
-            sdy = (ay - (icos * dy)) + yd;
-
-            pc16  = (uint16_t*)(pDstData + iDstLineSize*Y);
-
-            for(X=0;X<iDstWidth;X++)
-            {
-                dx = sdx >> 16;
-                dy = sdy >> 16;
-                if (dx < iSrcWidth && dy < iSrcHeight)
-                {
-                    iColor = *((uint16_t*)(pSrcData + dy * iSrcLineSize + dx * 2));
-                    if(iSrcColorKey == -1 || iColor != iSrcColorKey) *pc16 = iColor;
-                }
-
-                sdx += icos;
-                sdy += isin;
-
-                pc16++;
-
-            }
-
-        }
-
-    break;
-    case 32:
-
-        pDstData += iDstY * iDstLineSize + iDstX * 4;
-        pSrcData += iSrcY * iSrcLineSize + iSrcX * 4;
-
-        //iDstDataPad = (iDstLineSize - iDstWidth << 2) >> 2;
-
-
-        for(Y=0;Y<iDstHeight;Y++)
-        {
-            dy  = cy - Y;
-            sdx = (ax + (isin * dy)) + xd;
-            sdy = (ay - (icos * dy)) + yd;
-
-            pc32  = (uint32_t*)(pDstData + iDstLineSize*Y);
-
-            for(X=0;X<iDstWidth;X++)
-            {
-                dx = sdx >> 16;
-                dy = sdy >> 16;
-                if (dx < iSrcWidth && dy < iSrcHeight)
-                {
-                    iColor = *((uint32_t*)(pSrcData + dy * iSrcLineSize + dx * 4));
-                    if(iSrcColorKey == -1 || iColor != iSrcColorKey) *pc32 = iColor;
-                }
-
-                sdx += icos;
-                sdy += isin;
-
-                pc32++;
-
-            }
-
-        }
-
-    break;
-    }
-
-}
-
 void OGE_FX_Grayscale(uint8_t* pDstData, int iDstLineSize,
                       int iDstX, int iDstY,
                       int iWidth, int iHeight, int iBPP)
@@ -5703,188 +5615,6 @@ void OGE_FX_Grayscale(uint8_t* pDstData, int iDstLineSize,
 }
 
 
-void OGE_FX_BltSquareWave(uint8_t* pDstData, int iDstLineSize,
-                int iDstX, int iDstY,
-                uint8_t* pSrcData, int iSrcLineSize,
-                int iSrcX, int iSrcY,
-                int iWidth, int iHeight, int iBPP,
-                double iXAmount, double iYAmount, double iZAmount)
-{
-    int X, Y, xx, yy;
-    char* start;
-    int* pc32;
-    int* py;
-    uint16_t* pyw;
-    uint16_t* pw;
-
-
-    for(int i=0; i < iWidth; i++)  wavex[i] = lround(sin(i / iXAmount) * iZAmount);
-    for(int i=0; i < iHeight; i++) wavey[i] = lround(sin(i / iYAmount) * iZAmount);
-
-    switch(iBPP)
-    {
-    case 16:
-
-        pDstData += iDstY * iDstLineSize + iDstX * 2;
-        pSrcData += iSrcY * iSrcLineSize + iSrcX * 2;
-
-        pw  = (uint16_t*)(pDstData);
-
-        for(Y=0;Y<iHeight;Y++)
-        {
-            start = (char*)pw;
-
-            yy = wavey[Y] + Y;
-
-            if (yy >= 0 && yy < iHeight)
-            {
-                pyw  = (uint16_t*)(pSrcData + iSrcLineSize*yy);
-
-                for(X=0;X<iWidth;X++)
-                {
-                    xx = wavex[X] + X;
-                    if (xx >= 0 && xx < iWidth) *pw = *(pyw+xx);
-                    pw++;
-                }
-            }
-
-            pw = (uint16_t*)(start + iDstLineSize);
-        }
-
-
-    break;
-    case 32:
-
-        pDstData += iDstY * iDstLineSize + iDstX * 4;
-        pSrcData += iSrcY * iSrcLineSize + iSrcX * 4;
-
-        pc32  = (int*)(pDstData);
-
-        for(Y=0;Y<iHeight;Y++)
-        {
-            start = (char*)pc32;
-
-            yy = wavey[Y] + Y;
-
-            if (yy >= 0 && yy < iHeight)
-            {
-                py    = (int*)(pSrcData + iSrcLineSize*yy);
-
-                for(X=0;X<iWidth;X++)
-                {
-                    xx = wavex[X] + X;
-                    if (xx >= 0 && xx < iWidth) *pc32 = *(py+xx);
-                    pc32++;
-                }
-            }
-
-            pc32 = (int*)(start + iDstLineSize);
-        }
-
-
-    break;
-    }
-}
-
-void OGE_FX_BltRoundWave(uint8_t* pDstData, int iDstLineSize,
-                int iDstX, int iDstY,
-                uint8_t* pSrcData, int iSrcLineSize,
-                int iSrcX, int iSrcY,
-                int iWidth, int iHeight, int iBPP, int iSrcColorKey,
-                double iXAmount, double iYAmount, double iZAmount,
-                int iXSteps, int iYSteps)
-{
-    int X, Y, xx, yy;
-    char* start;
-    int* pc32;
-    int* py;
-    uint16_t* pyw;
-    uint16_t* pw;
-
-    int iColor;
-
-    if(iYSteps > 0)
-        for(int i=0; i < iHeight; i++) wavex[i] = lround(sin((i+iYSteps) / iXAmount) * iZAmount);
-    else
-        for(int i=0; i < iHeight; i++) wavex[i] = lround(sin(i / iXAmount) * iZAmount);
-
-    if(iXSteps > 0)
-        for(int i=0; i < iWidth; i++)  wavey[i] = lround(sin((i+iXSteps) / iYAmount) * iZAmount);
-    else
-        for(int i=0; i < iWidth; i++)  wavey[i] = lround(sin(i / iYAmount) * iZAmount);
-
-    switch(iBPP)
-    {
-    case 16:
-
-        pDstData += iDstY * iDstLineSize + iDstX * 2;
-        pSrcData += iSrcY * iSrcLineSize + iSrcX * 2;
-
-        pw  = (uint16_t*)(pDstData);
-
-        for(Y=0;Y<iHeight;Y++)
-        {
-            start = (char*)pw;
-
-            xx = wavex[Y];
-
-            for(X=0;X<iWidth;X++)
-            {
-                yy = wavey[X] + Y;
-
-                if (xx >= 0 && xx < iWidth
-                 && yy >= 0 && yy < iHeight)
-                {
-                    pyw = (uint16_t*)(pSrcData + iSrcLineSize*yy);
-                    iColor = *(pyw+xx);
-                    if(iSrcColorKey == -1 || iColor != iSrcColorKey) *pw = iColor;
-                }
-                pw++;
-                xx++;
-            }
-
-            pw = (uint16_t*)(start + iDstLineSize);
-        }
-
-
-    break;
-    case 32:
-
-        pDstData += iDstY * iDstLineSize + iDstX * 4;
-        pSrcData += iSrcY * iSrcLineSize + iSrcX * 4;
-
-        pc32  = (int*)(pDstData);
-
-        for(Y=0;Y<iHeight;Y++)
-        {
-            start = (char*)pc32;
-
-            xx = wavex[Y];
-
-            for(X=0;X<iWidth;X++)
-            {
-                yy = wavey[X] + Y;
-
-                if (xx >= 0 && xx < iWidth
-                 && yy >= 0 && yy < iHeight)
-                {
-                    py = (int*)(pSrcData + iSrcLineSize*yy);
-                    iColor = *(py+xx);
-                    if(iSrcColorKey == -1 || iColor != iSrcColorKey) *pc32 = iColor;
-
-                }
-                pc32++;
-                xx++;
-            }
-
-            pc32 = (int*)(start + iDstLineSize);
-        }
-
-
-    break;
-    }
-}
-
 
 void OGE_FX_SplitBlur(uint8_t* pDstData, int iDstLineSize,
                       int iDstX, int iDstY,
@@ -5982,7 +5712,7 @@ void OGE_FX_SplitBlur(uint8_t* pDstData, int iDstLineSize,
     }
 }
 
-void OGE_FX_GaussianBlur(uint8_t* pDstData, int iDstLineSize,
+void OGE_FX_IteratedBlur(uint8_t* pDstData, int iDstLineSize,
                           int iDstX, int iDstY,
                           int iWidth, int iHeight, int iBPP, int iAmount)
 {
@@ -6735,5 +6465,16 @@ void OGE_FX_BltWithColor(uint8_t* pDstData, int iDstLineSize,
 
 }
 
+// no mmx version of it, the c one is used
+void OGE_FX_BltPremultiplied(uint8_t* pDstData, int iDstLineSize,
+                int iDstX, int iDstY,
+                uint8_t* pSrcData, int iSrcLineSize,
+                int iSrcX, int iSrcY,
+                int iWidth, int iHeight, int iBPP, int iAlphaShift, uint8_t iAlpha)
+{
+    OGE_FX_C_BltPremultiplied(pDstData, iDstLineSize, iDstX, iDstY, pSrcData, iSrcLineSize,
+                              iSrcX, iSrcY, iWidth, iHeight, iBPP, iAlphaShift, iAlpha);
+}
+
 
 #endif //__FX_WITH_MMX__
@@ -0,0 +1,505 @@
+/*
+-----------------------------------------------------------------------------
+This source file is part of Open Game Engine 2D.
+It is licensed under the terms of the MIT license.
+For the latest info, see http://oge2d.sourceforge.net
+
+Copyright (c) 2010-2012 Lin Jia Jun (Joe Lam)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-----------------------------------------------------------------------------
+*/
+
+// the scalers of the screen (integer nearest, scale2x/scale3x, column map), shared by the c and the mmx backends
+
+#include "ogeGraphicFX_Kernel.h"
+#include <cstring>
+
+#ifdef __FX_WITH_SSE__
+#include <emmintrin.h>
+#endif
+
+struct CogeFXPresentTask
+{
+    uint8_t* pDstData;
+    int iDstLineSize;
+    int iDstX;
+    int iDstY;
+    int iDstWidth;
+
+    const uint8_t* pSrcData; // at the first pixel of the src rect
+    int iSrcLineSize;
+    int iSrcWidth;
+    int iSrcHeight;
+
+    int iPixelSize;
+
+    int iFactor;    // the integer ratio of both axes, 0 if there is none
+    int iBase;      // 2 (scale2x) or 3 (scale3x) for the pixel art filter, 0 for nearest
+    int* pColumns;  // the src column of each dst column (only without a ratio)
+    int* pRows;     // the src row of each dst row
+
+    bool bUseSSE2;
+};
+
+// copies each pixel of a row iFactor times
+static void OGE_FX_PresentReplicate(uint8_t* pDst, const uint8_t* pSrc, int iCount, int iFactor, int iPixelSize,
+                bool bUseSSE2)
+{
+    int x = 0;
+
+    if (iPixelSize == 4)
+    {
+        const uint32_t* s = (const uint32_t*) pSrc;
+        uint32_t* d = (uint32_t*) pDst;
+
+#ifdef __FX_WITH_SSE__
+        if (bUseSSE2)
+        {
+            if (iFactor == 2)
+            {
+                for(; x+4<=iCount; x+=4, d+=8)
+                {
+                    __m128i v = _mm_loadu_si128((const __m128i*)(s + x));
+                    _mm_storeu_si128((__m128i*)d, _mm_unpacklo_epi32(v, v));
+                    _mm_storeu_si128((__m128i*)(d + 4), _mm_unpackhi_epi32(v, v));
+                }
+            }
+            else if (iFactor == 3)
+            {
+                for(; x+4<=iCount; x+=4, d+=12)
+                {
+                    __m128i v = _mm_loadu_si128((const __m128i*)(s + x));
+                    _mm_storeu_si128((__m128i*)d, _mm_shuffle_epi32(v, _MM_SHUFFLE(1,0,0,0)));
+                    _mm_storeu_si128((__m128i*)(d + 4), _mm_shuffle_epi32(v, _MM_SHUFFLE(2,2,1,1)));
+                    _mm_storeu_si128((__m128i*)(d + 8), _mm_shuffle_epi32(v, _MM_SHUFFLE(3,3,3,2)));
+                }
+            }
+            else if (iFactor == 4)
+            {
+                for(; x+4<=iCount; x+=4, d+=16)
+                {
+                    __m128i v = _mm_loadu_si128((const __m128i*)(s + x));
+                    _mm_storeu_si128((__m128i*)d, _mm_shuffle_epi32(v, _MM_SHUFFLE(0,0,0,0)));
+                    _mm_storeu_si128((__m128i*)(d + 4), _mm_shuffle_epi32(v, _MM_SHUFFLE(1,1,1,1)));
+                    _mm_storeu_si128((__m128i*)(d + 8), _mm_shuffle_epi32(v, _MM_SHUFFLE(2,2,2,2)));
+                    _mm_storeu_si128((__m128i*)(d + 12), _mm_shuffle_epi32(v, _MM_SHUFFLE(3,3,3,3)));
+                }
+            }
+        }
+#endif
+
+        for(; x<iCount; x++)
+        {
+            uint32_t iPixel = s[x];
+            for(int k=0; k<iFactor; k++) *d++ = iPixel;
+        }
+    }
+    else
+    {
+        const uint16_t* s = (const uint16_t*) pSrc;
+        uint16_t* d = (uint16_t*) pDst;
+
+#ifdef __FX_WITH_SSE__
+        if (bUseSSE2)
+        {
+            if (iFactor == 2)
+            {
+                for(; x+8<=iCount; x+=8, d+=16)
+                {
+                    __m128i v = _mm_loadu_si128((const __m128i*)(s + x));
+                    _mm_storeu_si128((__m128i*)d, _mm_unpacklo_epi16(v, v));
+                    _mm_storeu_si128((__m128i*)(d + 8), _mm_unpackhi_epi16(v, v));
+                }
+            }
+            else if (iFactor == 4)
+            {
+                for(; x+8<=iCount; x+=8, d+=32)
+                {
+                    __m128i v = _mm_loadu_si128((const __m128i*)(s + x));
+                    __m128i lo = _mm_unpacklo_epi16(v, v);
+                    __m128i hi = _mm_unpackhi_epi16(v, v);
+                    _mm_storeu_si128((__m128i*)d, _mm_unpacklo_epi32(lo, lo));
+                    _mm_storeu_si128((__m128i*)(d + 8), _mm_unpackhi_epi32(lo, lo));
+                    _mm_storeu_si128((__m128i*)(d + 16), _mm_unpacklo_epi32(hi, hi));
+                    _mm_storeu_si128((__m128i*)(d + 24), _mm_unpackhi_epi32(hi, hi));
+                }
+            }
+        }
+#endif
+
+        for(; x<iCount; x++)
+        {
+            uint16_t iPixel = s[x];
+            for(int k=0; k<iFactor; k++) *d++ = iPixel;
+        }
+    }
+}
+
+// loads a src row into a working row with one more pixel on each side (a copy of the edge)
+static void OGE_FX_PresentLoadRow(uint32_t* pRow, const uint8_t* pSrc, int iWidth, int iPixelSize)
+{
+    if (iPixelSize == 4) memcpy(pRow + 1, pSrc, iWidth * 4);
+    else
+    {
+        const uint16_t* s = (const uint16_t*) pSrc;
+        for(int x=0; x<iWidth; x++) pRow[x + 1] = s[x];
+    }
+
+    pRow[0] = pRow[1];
+    pRow[iWidth + 1] = pRow[iWidth];
+}
+
+#ifdef __FX_WITH_SSE__
+
+// a = (c ? x : y)
+#define _FX_PRESENT_SELECT_(c, x, y) _mm_or_si128(_mm_and_si128(c, x), _mm_andnot_si128(c, y))
+
+// stores a0 b0 c0 a1 b1 c1 a2 b2 c2 a3 b3 c3
+static inline void OGE_FX_PresentStore3(uint32_t* pOut, __m128i a, __m128i b, __m128i c)
+{
+    __m128 ab = _mm_castsi128_ps(_mm_unpacklo_epi32(a, b));
+    __m128 ca = _mm_castsi128_ps(_mm_unpacklo_epi32(c, a));
+    __m128 bc = _mm_castsi128_ps(_mm_unpacklo_epi32(b, c));
+    __m128 ab2 = _mm_castsi128_ps(_mm_unpackhi_epi32(a, b));
+    __m128 ca2 = _mm_castsi128_ps(_mm_unpackhi_epi32(c, a));
+    __m128 bc2 = _mm_castsi128_ps(_mm_unpackhi_epi32(b, c));
+
+    _mm_storeu_si128((__m128i*)pOut, _mm_castps_si128(_mm_shuffle_ps(ab, ca, _MM_SHUFFLE(3,0,1,0))));
+    _mm_storeu_si128((__m128i*)(pOut + 4), _mm_castps_si128(_mm_shuffle_ps(bc, ab2, _MM_SHUFFLE(1,0,3,2))));
+    _mm_storeu_si128((__m128i*)(pOut + 8), _mm_castps_si128(_mm_shuffle_ps(ca2, bc2, _MM_SHUFFLE(3,2,3,0))));
+}
+
+#endif
+
+/* one output row of scale2x (epx), B is the working row above E and H the one below,
+   the upper half of a pixel is asked with (B, H) and the lower half with (H, B)
+*/
+static void OGE_FX_Scale2xRow(uint32_t* pOut, const uint32_t* pB, const uint32_t* pE, const uint32_t* pH,
+                int iWidth, bool bUseSSE2)
+{
+    int x = 0;
+
+#ifdef __FX_WITH_SSE__
+    if (bUseSSE2)
+    {
+        for(; x+4<=iWidth; x+=4)
+        {
+            __m128i b = _mm_loadu_si128((const __m128i*)(pB + x + 1));
+            __m128i h = _mm_loadu_si128((const __m128i*)(pH + x + 1));
+            __m128i d = _mm_loadu_si128((const __m128i*)(pE + x));
+            __m128i e = _mm_loadu_si128((const __m128i*)(pE + x + 1));
+            __m128i f = _mm_loadu_si128((const __m128i*)(pE + x + 2));
+
+            __m128i bd = _mm_cmpeq_epi32(b, d);
+            __m128i bf = _mm_cmpeq_epi32(b, f);
+            __m128i dh = _mm_cmpeq_epi32(d, h);
+            __m128i fh = _mm_cmpeq_epi32(f, h);
+
+            __m128i c0 = _mm_andnot_si128(_mm_or_si128(bf, dh), bd);
+            __m128i c1 = _mm_andnot_si128(_mm_or_si128(bd, fh), bf);
+
+            __m128i o0 = _FX_PRESENT_SELECT_(c0, d, e);
+            __m128i o1 = _FX_PRESENT_SELECT_(c1, f, e);
+
+            _mm_storeu_si128((__m128i*)(pOut + x * 2), _mm_unpacklo_epi32(o0, o1));
+            _mm_storeu_si128((__m128i*)(pOut + x * 2 + 4), _mm_unpackhi_epi32(o0, o1));
+        }
+    }
+#endif
+
+    for(; x<iWidth; x++)
+    {
+        uint32_t B = pB[x + 1], H = pH[x + 1];
+        uint32_t D = pE[x], E = pE[x + 1], F = pE[x + 2];
+
+        pOut[x * 2]     = (D == B && B != F && D != H) ? D : E;
+        pOut[x * 2 + 1] = (B == F && B != D && F != H) ? F : E;
+    }
+}
+
+/* one output row (iPart 0, 1 or 2) of scale3x (advmame3x), A B C is the working row above D E F and G H I the one below,
+   the lower third is the upper one asked with the rows swapped
+*/
+static void OGE_FX_Scale3xRow(uint32_t* pOut, const uint32_t* pB, const uint32_t* pE, const uint32_t* pH,
+                int iWidth, int iPart, bool bUseSSE2)
+{
+    if (iPart == 2)
+    {
+        const uint32_t* pTemp = pB;
+        pB = pH;
+        pH = pTemp;
+        iPart = 0;
+    }
+
+    int x = 0;
+
+#ifdef __FX_WITH_SSE__
+    if (bUseSSE2)
+    {
+        for(; x+4<=iWidth; x+=4)
+        {
+            __m128i a = _mm_loadu_si128((const __m128i*)(pB + x));
+            __m128i b = _mm_loadu_si128((const __m128i*)(pB + x + 1));
+            __m128i c = _mm_loadu_si128((const __m128i*)(pB + x + 2));
+            __m128i d = _mm_loadu_si128((const __m128i*)(pE + x));
+            __m128i e = _mm_loadu_si128((const __m128i*)(pE + x + 1));
+            __m128i f = _mm_loadu_si128((const __m128i*)(pE + x + 2));
+            __m128i g = _mm_loadu_si128((const __m128i*)(pH + x));
+            __m128i h = _mm_loadu_si128((const __m128i*)(pH + x + 1));
+            __m128i i = _mm_loadu_si128((const __m128i*)(pH + x + 2));
+
+            __m128i bd = _mm_cmpeq_epi32(b, d);
+            __m128i bf = _mm_cmpeq_epi32(b, f);
+            __m128i dh = _mm_cmpeq_epi32(d, h);
+            __m128i fh = _mm_cmpeq_epi32(f, h);
+
+            // the corners: top left, top right, bottom left, bottom right
+            __m128i tl = _mm_andnot_si128(_mm_or_si128(bf, dh), bd);
+            __m128i tr = _mm_andnot_si128(_mm_or_si128(bd, fh), bf);
+            __m128i bl = _mm_andnot_si128(_mm_or_si128(bd, fh), dh);
+            __m128i br = _mm_andnot_si128(_mm_or_si128(dh, bf), fh);
+
+            __m128i ea = _mm_cmpeq_epi32(e, a);
+            __m128i ec = _mm_cmpeq_epi32(e, c);
+            __m128i eg = _mm_cmpeq_epi32(e, g);
+            __m128i ei = _mm_cmpeq_epi32(e, i);
+
+            if (iPart == 0)
+            {
+                __m128i o1 = _mm_or_si128(_mm_andnot_si128(ec, tl), _mm_andnot_si128(ea, tr));
+
+                OGE_FX_PresentStore3(pOut + x * 3, _FX_PRESENT_SELECT_(tl, d, e), _FX_PRESENT_SELECT_(o1, b, e),
+                                     _FX_PRESENT_SELECT_(tr, f, e));
+            }
+            else
+            {
+                __m128i o3 = _mm_or_si128(_mm_andnot_si128(eg, tl), _mm_andnot_si128(ea, bl));
+                __m128i o5 = _mm_or_si128(_mm_andnot_si128(ei, tr), _mm_andnot_si128(ec, br));
+
+                OGE_FX_PresentStore3(pOut + x * 3, _FX_PRESENT_SELECT_(o3, d, e), e, _FX_PRESENT_SELECT_(o5, f, e));
+            }
+        }
+    }
+#endif
+
+    for(; x<iWidth; x++)
+    {
+        uint32_t A = pB[x], B = pB[x + 1], C = pB[x + 2];
+        uint32_t D = pE[x], E = pE[x + 1], F = pE[x + 2];
+        uint32_t G = pH[x], H = pH[x + 1], I = pH[x + 2];
+
+        bool tl = D == B && B != F && D != H;
+        bool tr = B == F && B != D && F != H;
+        bool bl = D == H && D != B && H != F;
+        bool br = H == F && D != H && B != F;
+
+        uint32_t* o = pOut + x * 3;
+
+        if (iPart == 0)
+        {
+            o[0] = tl ? D : E;
+            o[1] = ((tl && E != C) || (tr && E != A)) ? B : E;
+            o[2] = tr ? F : E;
+        }
+        else
+        {
+            o[0] = ((tl && E != G) || (bl && E != A)) ? D : E;
+            o[1] = E;
+            o[2] = ((tr && E != I) || (br && E != C)) ? F : E;
+        }
+    }
+}
+
+static void OGE_FX_PresentBand(void* pTask, int iFromRow, int iToRow)
+{
+    CogeFXPresentTask* t = (CogeFXPresentTask*) pTask;
+
+    int iSrcWidth = t->iSrcWidth;
+    int iPixelSize = t->iPixelSize;
+    int iRowSize = t->iDstWidth * iPixelSize;
+
+    // the dst rows of a src row (or of a part of it with the pixel art filter) are the same
+    int iBlock = t->iFactor > 0 ? (t->iBase > 0 ? t->iFactor / t->iBase : t->iFactor) : 0;
+
+    // the working rows of the pixel art filter (above, center, below) and its output
+    uint32_t* pWork = NULL;
+    uint8_t* pOut = NULL;
+    int iLoadedRow = -1;
+
+    if (t->iBase > 0)
+    {
+        pWork = new uint32_t[(iSrcWidth + 2) * 3];
+        pOut = new uint8_t[iSrcWidth * t->iBase * 4];
+    }
+
+    uint8_t* pPrevLine = NULL;
+    int iPrevKey = -1;
+
+    for(int y=iFromRow; y<iToRow; y++)
+    {
+        uint8_t* pLine = t->pDstData + (t->iDstY + y) * t->iDstLineSize + t->iDstX * iPixelSize;
+
+        int iSrcRow = t->pRows[y];
+
+        // the key of the content of a dst row
+        int iKey = iBlock > 0 ? y / iBlock : iSrcRow;
+
+        if (iKey == iPrevKey)
+        {
+            memcpy(pLine, pPrevLine, iRowSize);
+            continue;
+        }
+
+        const uint8_t* pSrc = t->pSrcData + iSrcRow * t->iSrcLineSize;
+
+        if (t->iBase > 0)
+        {
+            uint32_t* pB = pWork;
+            uint32_t* pE = pWork + (iSrcWidth + 2);
+            uint32_t* pH = pWork + (iSrcWidth + 2) * 2;
+
+            if (iLoadedRow != iSrcRow)
+            {
+                int iAbove = iSrcRow > 0 ? iSrcRow - 1 : 0;
+                int iBelow = iSrcRow + 1 < t->iSrcHeight ? iSrcRow + 1 : iSrcRow;
+
+                OGE_FX_PresentLoadRow(pB, t->pSrcData + iAbove * t->iSrcLineSize, iSrcWidth, iPixelSize);
+                OGE_FX_PresentLoadRow(pE, pSrc, iSrcWidth, iPixelSize);
+                OGE_FX_PresentLoadRow(pH, t->pSrcData + iBelow * t->iSrcLineSize, iSrcWidth, iPixelSize);
+
+                iLoadedRow = iSrcRow;
+            }
+
+            int iPart = (y - iSrcRow * t->iFactor) / iBlock;
+            int iCount = iSrcWidth * t->iBase;
+
+            uint32_t* pResult = (uint32_t*) pOut;
+
+            if (t->iBase == 2)
+            {
+                if (iPart == 0) OGE_FX_Scale2xRow(pResult, pB, pE, pH, iSrcWidth, t->bUseSSE2);
+                else OGE_FX_Scale2xRow(pResult, pH, pE, pB, iSrcWidth, t->bUseSSE2);
+            }
+            else OGE_FX_Scale3xRow(pResult, pB, pE, pH, iSrcWidth, iPart, t->bUseSSE2);
+
+            // back to the pixels of dst (in place)
+            if (iPixelSize == 2)
+            {
+                uint16_t* p16 = (uint16_t*) pOut;
+                for(int x=0; x<iCount; x++) p16[x] = (uint16_t) pResult[x];
+            }
+
+            if (iBlock == 1) memcpy(pLine, pOut, iRowSize);
+            else OGE_FX_PresentReplicate(pLine, pOut, iCount, iBlock, iPixelSize, t->bUseSSE2);
+        }
+        else if (t->iFactor > 0)
+        {
+            OGE_FX_PresentReplicate(pLine, pSrc, iSrcWidth, t->iFactor, iPixelSize, t->bUseSSE2);
+        }
+        else if (iPixelSize == 4)
+        {
+            const uint32_t* s = (const uint32_t*) pSrc;
+            uint32_t* d = (uint32_t*) pLine;
+            const int* pColumns = t->pColumns;
+
+            for(int x=0; x<t->iDstWidth; x++) d[x] = s[pColumns[x]];
+        }
+        else
+        {
+            const uint16_t* s = (const uint16_t*) pSrc;
+            uint16_t* d = (uint16_t*) pLine;
+            const int* pColumns = t->pColumns;
+
+            for(int x=0; x<t->iDstWidth; x++) d[x] = s[pColumns[x]];
+        }
+
+        pPrevLine = pLine;
+        iPrevKey = iKey;
+    }
+
+    delete [] pOut;
+    delete [] pWork;
+}
+
+void OGE_FX_BltPresent(uint8_t* pDstData, int iDstLineSize,
+                int iDstX, int iDstY, int iDstWidth, int iDstHeight,
+                uint8_t* pSrcData, int iSrcLineSize,
+                int iSrcX, int iSrcY, int iSrcWidth, int iSrcHeight, int iBPP, int iFilter)
+{
+    if (iDstWidth <= 0 || iDstHeight <= 0 || iSrcWidth <= 0 || iSrcHeight <= 0) return;
+
+    if (iBPP != 16 && iBPP != 32)
+    {
+        OGE_FX_BltStretch(pDstData, iDstLineSize, iDstX, iDstY, iDstWidth, iDstHeight,
+                          pSrcData, iSrcLineSize, -1, iSrcX, iSrcY, iSrcWidth, iSrcHeight, iBPP);
+        return;
+    }
+
+    if (iFilter == _OGE_FX_PRESENT_SMOOTH_)
+    {
+        OGE_FX_BltScale(pDstData, iDstLineSize, iDstX, iDstY, iDstWidth, iDstHeight, 0, 0, iDstWidth, iDstHeight,
+                        pSrcData, iSrcLineSize, -1, iSrcX, iSrcY, iSrcWidth, iSrcHeight, iBPP);
+        return;
+    }
+
+    CogeFXPresentTask task;
+
+    task.pDstData = pDstData;
+    task.iDstLineSize = iDstLineSize;
+    task.iDstX = iDstX;
+    task.iDstY = iDstY;
+    task.iDstWidth = iDstWidth;
+    task.iPixelSize = iBPP >> 3;
+    task.pSrcData = pSrcData + iSrcY * iSrcLineSize + iSrcX * task.iPixelSize;
+    task.iSrcLineSize = iSrcLineSize;
+    task.iSrcWidth = iSrcWidth;
+    task.iSrcHeight = iSrcHeight;
+    task.bUseSSE2 = OGE_FX_GetBackend() >= _OGE_FX_BACKEND_SSE2_;
+
+    task.iFactor = 0;
+    if (iDstWidth % iSrcWidth == 0 && iDstWidth / iSrcWidth == iDstHeight / iSrcHeight
+        && iDstHeight % iSrcHeight == 0) task.iFactor = iDstWidth / iSrcWidth;
+
+    task.iBase = 0;
+    if (iFilter == _OGE_FX_PRESENT_PIXELART_ && task.iFactor > 1)
+    {
+        if (task.iFactor % 2 == 0) task.iBase = 2;
+        else if (task.iFactor % 3 == 0) task.iBase = 3;
+    }
+
+    // the nearest src column of each dst column and src row of each dst row, computed once per call
+    task.pColumns = NULL;
+    if (task.iFactor == 0)
+    {
+        task.pColumns = new int[iDstWidth];
+        for(int x=0; x<iDstWidth; x++) task.pColumns[x] = (int)(((int64_t)x * iSrcWidth) / iDstWidth);
+    }
+
+    task.pRows = new int[iDstHeight];
+    for(int y=0; y<iDstHeight; y++) task.pRows[y] = (int)(((int64_t)y * iSrcHeight) / iDstHeight);
+
+    bool bUseThreads = OGE_FX_GetThreads() > 1 && iDstWidth * iDstHeight >= OGE_FX_GetThreadPixels();
+
+    if (!bUseThreads || !OGE_FX_RunBands(OGE_FX_PresentBand, &task, iDstHeight))
+        OGE_FX_PresentBand(&task, 0, iDstHeight);
+
+    delete [] task.pRows;
+    delete [] task.pColumns;
+}
@@ -0,0 +1,502 @@
+/*
+-----------------------------------------------------------------------------
+This source file is part of Open Game Engine 2D.
+It is licensed under the terms of the MIT license.
+For the latest info, see http://oge2d.sourceforge.net
+
+Copyright (c) 2010-2012 Lin Jia Jun (Joe Lam)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-----------------------------------------------------------------------------
+*/
+
+// 16.16 fixed point rotozoom, shared by the c and the mmx backends
+
+#include "ogeGraphicFX_Kernel.h"
+#include <cmath>
+#include <cstdlib>
+#include <algorithm>
+
+#ifdef __FX_WITH_SSE__
+#include <emmintrin.h>
+#endif
+
+#ifndef _OGE_PI_
+#define _OGE_PI_  3.14159265
+#endif //_OGE_PI_
+
+/* dst pixel (x, y) samples src at u = iU0 - iSin * y + iCos * x, v = iV0 + iCos * y + iSin * x (16.16),
+   each row only walks the span whose samples are inside src, so the loops do not test the bounds
+*/
+struct CogeFXRotateTask
+{
+    uint8_t* pDstData;
+    int iDstLineSize;
+    int iDstWidth;
+    int iDstHeight;
+
+    uint8_t* pSrcData;
+    int iSrcLineSize;
+    int iSrcWidth;
+    int iSrcHeight;
+    int iSrcColorKey;
+
+    int iBPP;
+
+    int64_t iU0;
+    int64_t iV0;
+    int iSin;
+    int iCos;
+
+    bool bBilinear;
+    bool bUseSSE;
+};
+
+static int64_t OGE_FX_FloorDiv(int64_t a, int64_t b)
+{
+    int64_t q = a / b;
+    if (a % b != 0 && a < 0) q--;
+    return q;
+}
+
+// narrows [iFrom, iTo) to the x which make 0 <= f0 + d * x < iLimit
+static void OGE_FX_ClipSpan(int64_t f0, int64_t d, int64_t iLimit, int& iFrom, int& iTo)
+{
+    int64_t iLow = iFrom;
+    int64_t iHigh = iTo;
+
+    if (d == 0)
+    {
+        if (f0 < 0 || f0 >= iLimit) iHigh = iLow;
+    }
+    else if (d > 0)
+    {
+        iLow  = std::max(iLow,  -OGE_FX_FloorDiv(f0, d));
+        iHigh = std::min(iHigh, OGE_FX_FloorDiv(iLimit - 1 - f0, d) + 1);
+    }
+    else
+    {
+        iLow  = std::max(iLow,  -OGE_FX_FloorDiv(iLimit - 1 - f0, -d));
+        iHigh = std::min(iHigh, OGE_FX_FloorDiv(f0, -d) + 1);
+    }
+
+    if (iHigh < iLow) iHigh = iLow;
+
+    iFrom = (int) iLow;
+    iTo   = (int) iHigh;
+}
+
+// (a * (256 - w) + b * w) >> 8 for the 4 bytes
+static inline uint32_t OGE_FX_Lerp8888(uint32_t a, uint32_t b, uint32_t w)
+{
+    uint32_t iWa = 256 - w;
+    uint32_t rb = ((((a & 0x00ff00ff) * iWa) + ((b & 0x00ff00ff) * w)) >> 8) & 0x00ff00ff;
+    uint32_t ag = ((((a >> 8) & 0x00ff00ff) * iWa) + (((b >> 8) & 0x00ff00ff) * w)) & 0xff00ff00;
+    return rb | ag;
+}
+
+static inline uint32_t OGE_FX_Bilinear8888(uint32_t p00, uint32_t p01, uint32_t p10, uint32_t p11,
+                                           uint32_t fx, uint32_t fy)
+{
+    return OGE_FX_Lerp8888(OGE_FX_Lerp8888(p00, p10, fy), OGE_FX_Lerp8888(p01, p11, fy), fx);
+}
+
+#ifdef __FX_WITH_SSE__
+
+// same as OGE_FX_Bilinear8888(), all the 4 channels in one go
+static inline uint32_t OGE_FX_SSE_Bilinear8888(uint32_t p00, uint32_t p01, uint32_t p10, uint32_t p11,
+                                               uint32_t fx, uint32_t fy)
+{
+    __m128i mZero = _mm_setzero_si128();
+
+    __m128i mTop    = _mm_unpacklo_epi8(_mm_unpacklo_epi32(_mm_cvtsi32_si128(p00), _mm_cvtsi32_si128(p01)), mZero);
+    __m128i mBottom = _mm_unpacklo_epi8(_mm_unpacklo_epi32(_mm_cvtsi32_si128(p10), _mm_cvtsi32_si128(p11)), mZero);
+
+    __m128i mRows = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(mTop, _mm_set1_epi16(256 - fy)),
+                                                 _mm_mullo_epi16(mBottom, _mm_set1_epi16(fy))), 8);
+
+    __m128i mCols = _mm_mullo_epi16(mRows, _mm_set_epi16(fx, fx, fx, fx, 256 - fx, 256 - fx, 256 - fx, 256 - fx));
+    mCols = _mm_srli_epi16(_mm_add_epi16(mCols, _mm_unpackhi_epi64(mCols, mCols)), 8);
+
+    return _mm_cvtsi128_si32(_mm_packus_epi16(mCols, mCols));
+}
+
+#endif // __FX_WITH_SSE__
+
+// 565 spread to 0x07E0F81F so the 3 channels can be scaled by 5 bit weights at once
+static inline uint32_t OGE_FX_Spread565(uint32_t c)
+{
+    return (c | (c << 16)) & 0x07E0F81F;
+}
+
+static inline uint32_t OGE_FX_Bilinear565(uint32_t p00, uint32_t p01, uint32_t p10, uint32_t p11,
+                                          uint32_t fx, uint32_t fy)
+{
+    fx >>= 3;
+    fy >>= 3;
+
+    uint32_t a = ((OGE_FX_Spread565(p00) * (32 - fy) + OGE_FX_Spread565(p10) * fy) >> 5) & 0x07E0F81F;
+    uint32_t b = ((OGE_FX_Spread565(p01) * (32 - fy) + OGE_FX_Spread565(p11) * fy) >> 5) & 0x07E0F81F;
+    uint32_t c = ((a * (32 - fx) + b * fx) >> 5) & 0x07E0F81F;
+
+    return (c | (c >> 16)) & 0xffff;
+}
+
+static inline uint32_t OGE_FX_GetPixel(uint8_t* pSrcData, int iSrcLineSize, int x, int y, int iBPP)
+{
+    if (iBPP == 16) return *(uint16_t*)(pSrcData + y * iSrcLineSize + x * 2);
+    else return *(uint32_t*)(pSrcData + y * iSrcLineSize + x * 4);
+}
+
+static inline void OGE_FX_SetPixel(uint8_t* pDstLine, int x, uint32_t iColor, int iBPP)
+{
+    if (iBPP == 16) ((uint16_t*)pDstLine)[x] = (uint16_t)iColor;
+    else ((uint32_t*)pDstLine)[x] = iColor;
+}
+
+static void OGE_FX_RotateNearest(CogeFXRotateTask* t, uint8_t* pDstLine, int iFrom, int iTo, int u, int v)
+{
+    bool bNoColorKey = t->iSrcColorKey == -1;
+
+    uint8_t* pSrcData = t->pSrcData;
+    int iSrcLineSize = t->iSrcLineSize;
+    int iSin = t->iSin;
+    int iCos = t->iCos;
+
+    if (t->iBPP == 16)
+    {
+        uint16_t* pDst = (uint16_t*) pDstLine;
+        uint16_t iColorKey = (uint16_t) t->iSrcColorKey;
+
+        for(int x=iFrom; x<iTo; x++)
+        {
+            uint16_t iColor = *(uint16_t*)(pSrcData + (v >> 16) * iSrcLineSize + (u >> 16) * 2);
+            if (bNoColorKey || iColor != iColorKey) pDst[x] = iColor;
+            u += iCos;
+            v += iSin;
+        }
+    }
+    else
+    {
+        uint32_t* pDst = (uint32_t*) pDstLine;
+        uint32_t iColorKey = (uint32_t) t->iSrcColorKey;
+
+        for(int x=iFrom; x<iTo; x++)
+        {
+            uint32_t iColor = *(uint32_t*)(pSrcData + (v >> 16) * iSrcLineSize + (u >> 16) * 4);
+            if (bNoColorKey || iColor != iColorKey) pDst[x] = iColor;
+            u += iCos;
+            v += iSin;
+        }
+    }
+}
+
+/* the bilinear samples are centered on the pixels (u - 0.5, v - 0.5), the ones near the edges repeat the edge pixels,
+   bClamp tells whether the span may have such samples; the transparency of a pixel is the same as the nearest one,
+   and the color key neighbours are replaced by the nearest pixel so the key never bleeds into the sprite
+*/
+static void OGE_FX_RotateBilinear(CogeFXRotateTask* t, uint8_t* pDstLine, int iFrom, int iTo, int u, int v, bool bClamp)
+{
+    bool bNoColorKey = t->iSrcColorKey == -1;
+    uint32_t iColorKey = t->iBPP == 16 ? (t->iSrcColorKey & 0xffff) : (uint32_t) t->iSrcColorKey;
+
+    uint8_t* pSrcData = t->pSrcData;
+    int iSrcLineSize = t->iSrcLineSize;
+    int iMaxX = t->iSrcWidth - 1;
+    int iMaxY = t->iSrcHeight - 1;
+    int iBPP = t->iBPP;
+
+    for(int x=iFrom; x<iTo; x++, u+=t->iCos, v+=t->iSin)
+    {
+        uint32_t iNearest = bNoColorKey ? 0 : OGE_FX_GetPixel(pSrcData, iSrcLineSize, u >> 16, v >> 16, iBPP);
+        if (!bNoColorKey && iNearest == iColorKey) continue;
+
+        int su = u - 0x8000;
+        int sv = v - 0x8000;
+
+        int x0 = su >> 16;
+        int y0 = sv >> 16;
+        int x1 = x0 + 1;
+        int y1 = y0 + 1;
+
+        if (bClamp)
+        {
+            x0 = std::max(0, std::min(x0, iMaxX));
+            y0 = std::max(0, std::min(y0, iMaxY));
+            x1 = std::max(0, std::min(x1, iMaxX));
+            y1 = std::max(0, std::min(y1, iMaxY));
+        }
+
+        uint32_t p00 = OGE_FX_GetPixel(pSrcData, iSrcLineSize, x0, y0, iBPP);
+        uint32_t p01 = OGE_FX_GetPixel(pSrcData, iSrcLineSize, x1, y0, iBPP);
+        uint32_t p10 = OGE_FX_GetPixel(pSrcData, iSrcLineSize, x0, y1, iBPP);
+        uint32_t p11 = OGE_FX_GetPixel(pSrcData, iSrcLineSize, x1, y1, iBPP);
+
+        if (!bNoColorKey)
+        {
+            if (p00 == iColorKey) p00 = iNearest;
+            if (p01 == iColorKey) p01 = iNearest;
+            if (p10 == iColorKey) p10 = iNearest;
+            if (p11 == iColorKey) p11 = iNearest;
+        }
+
+        uint32_t fx = (su >> 8) & 0xff;
+        uint32_t fy = (sv >> 8) & 0xff;
+
+        uint32_t iColor;
+
+        if (iBPP == 16) iColor = OGE_FX_Bilinear565(p00, p01, p10, p11, fx, fy);
+#ifdef __FX_WITH_SSE__
+        else if (t->bUseSSE) iColor = OGE_FX_SSE_Bilinear8888(p00, p01, p10, p11, fx, fy);
+#endif
+        else iColor = OGE_FX_Bilinear8888(p00, p01, p10, p11, fx, fy);
+
+        OGE_FX_SetPixel(pDstLine, x, iColor, iBPP);
+    }
+}
+
+/* draws the part of [iFrom, iTo) whose samples are inside src (u0, v0 are the ones of x = 0),
+   the part is returned in iFrom and iTo (empty if iFrom >= iTo)
+*/
+static void OGE_FX_RotateRow(CogeFXRotateTask* t, uint8_t* pDstLine, int64_t u0, int64_t v0, int& iFrom, int& iTo)
+{
+    int64_t iSrcRight  = (int64_t) t->iSrcWidth  << 16;
+    int64_t iSrcBottom = (int64_t) t->iSrcHeight << 16;
+
+    OGE_FX_ClipSpan(u0, t->iCos, iSrcRight,  iFrom, iTo);
+    OGE_FX_ClipSpan(v0, t->iSin, iSrcBottom, iFrom, iTo);
+
+    if (iFrom >= iTo) return;
+
+    int u = (int)(u0 + (int64_t) t->iCos * iFrom);
+    int v = (int)(v0 + (int64_t) t->iSin * iFrom);
+
+    if (!t->bBilinear)
+    {
+        OGE_FX_RotateNearest(t, pDstLine, iFrom, iTo, u, v);
+        return;
+    }
+
+    // the inner part whose 4 samples are all inside src
+    int iInnerFrom = iFrom;
+    int iInnerTo = iTo;
+
+    OGE_FX_ClipSpan(u0 - 0x8000, t->iCos, iSrcRight  - 0x10000, iInnerFrom, iInnerTo);
+    OGE_FX_ClipSpan(v0 - 0x8000, t->iSin, iSrcBottom - 0x10000, iInnerFrom, iInnerTo);
+
+    if (iInnerFrom >= iInnerTo) iInnerFrom = iInnerTo = iTo;
+
+    int iStep = iInnerFrom - iFrom;
+    OGE_FX_RotateBilinear(t, pDstLine, iFrom, iInnerFrom, u, v, true);
+
+    u += t->iCos * iStep;
+    v += t->iSin * iStep;
+    iStep = iInnerTo - iInnerFrom;
+    OGE_FX_RotateBilinear(t, pDstLine, iInnerFrom, iInnerTo, u, v, false);
+
+    u += t->iCos * iStep;
+    v += t->iSin * iStep;
+    OGE_FX_RotateBilinear(t, pDstLine, iInnerTo, iTo, u, v, true);
+}
+
+static void OGE_FX_RotateBand(void* pTask, int iFromRow, int iToRow)
+{
+    CogeFXRotateTask* t = (CogeFXRotateTask*) pTask;
+
+    for(int y=iFromRow; y<iToRow; y++)
+    {
+        int iFrom = 0;
+        int iTo = t->iDstWidth;
+
+        OGE_FX_RotateRow(t, t->pDstData + y * t->iDstLineSize,
+                         t->iU0 - (int64_t) t->iSin * y, t->iV0 + (int64_t) t->iCos * y, iFrom, iTo);
+    }
+}
+
+static void OGE_FX_SetupRotate(CogeFXRotateTask* t, uint32_t iDstWidth, uint32_t iDstHeight,
+                uint32_t iSrcWidth, uint32_t iSrcHeight, double fAngle, int iZoom)
+{
+    t->iSin = lround(sin(fAngle * _OGE_PI_ / 180) * iZoom);
+    t->iCos = lround(cos(fAngle * _OGE_PI_ / 180) * iZoom);
+
+    // both rects share the same center
+    int64_t cx = iDstWidth  >> 1;
+    int64_t cy = iDstHeight >> 1;
+    int64_t xd = (((int64_t) iSrcWidth  - (int64_t) iDstWidth)  << 16) / 2;
+    int64_t yd = (((int64_t) iSrcHeight - (int64_t) iDstHeight) << 16) / 2;
+
+    t->iU0 = (cx << 16) - t->iCos * cx + t->iSin * cy + xd;
+    t->iV0 = (cy << 16) - t->iSin * cx - t->iCos * cy + yd;
+}
+
+void OGE_FX_BltRotate(uint8_t* pDstData, int iDstLineSize,
+                int iDstX, int iDstY, uint32_t iDstWidth, uint32_t iDstHeight,
+                uint8_t* pSrcData, int iSrcLineSize,
+                int iSrcX, int iSrcY, uint32_t iSrcWidth, uint32_t iSrcHeight, int iBPP,
+                int iSrcColorKey, double fAngle, int iZoom, bool bBilinear)
+{
+    if (iBPP != 16 && iBPP != 32) return;
+    if (iDstWidth == 0 || iDstHeight == 0 || iSrcWidth == 0 || iSrcHeight == 0) return;
+
+    int iPixelSize = iBPP >> 3;
+
+    CogeFXRotateTask task;
+
+    task.pDstData = pDstData + iDstY * iDstLineSize + iDstX * iPixelSize;
+    task.iDstLineSize = iDstLineSize;
+    task.iDstWidth = iDstWidth;
+    task.iDstHeight = iDstHeight;
+
+    task.pSrcData = pSrcData + iSrcY * iSrcLineSize + iSrcX * iPixelSize;
+    task.iSrcLineSize = iSrcLineSize;
+    task.iSrcWidth = iSrcWidth;
+    task.iSrcHeight = iSrcHeight;
+    task.iSrcColorKey = iSrcColorKey;
+
+    task.iBPP = iBPP;
+
+    OGE_FX_SetupRotate(&task, iDstWidth, iDstHeight, iSrcWidth, iSrcHeight, fAngle, iZoom);
+
+    task.bBilinear = bBilinear;
+
+#ifdef __FX_WITH_SSE__
+    task.bUseSSE = OGE_FX_GetBackend() >= _OGE_FX_BACKEND_SSE2_;
+#else
+    task.bUseSSE = false;
+#endif
+
+    // the rows only read src, so they can run on the fx threads unless src is dst
+    bool bUseThreads = pSrcData != pDstData && OGE_FX_GetThreads() > 1 &&
+                       (int)(iDstWidth * iDstHeight) >= OGE_FX_GetThreadPixels();
+
+    if (bUseThreads && OGE_FX_RunBands(OGE_FX_RotateBand, &task, iDstHeight)) return;
+
+    OGE_FX_RotateBand(&task, 0, iDstHeight);
+}
+
+void OGE_FX_BltFused(uint8_t* pDstData, int iDstLineSize, int iDstClipWidth, int iDstClipHeight,
+                int iDstX, int iDstY, int iDstWidth, int iDstHeight,
+                uint8_t* pSrcData, int iSrcLineSize, int iSrcColorKey,
+                int iSrcX, int iSrcY, int iSrcWidth, int iSrcHeight, int iBPP,
+                double fAngle, bool bBilinear, CogeFXColorTransform* pTransform, int iAlpha)
+{
+    if (iBPP != 16 && iBPP != 32) return;
+    if (iDstWidth <= 0 || iDstHeight <= 0 || iSrcWidth <= 0 || iSrcHeight <= 0 || iAlpha <= 0) return;
+
+    if (pTransform && !OGE_FX_PrepareColorTransform(pTransform, iBPP)) return;
+
+    // the part of the dst rect inside dst
+    int iFromX = std::max(0, -iDstX);
+    int iToX   = std::min(iDstWidth, iDstClipWidth - iDstX);
+    int iFromY = std::max(0, -iDstY);
+    int iToY   = std::min(iDstHeight, iDstClipHeight - iDstY);
+
+    if (iFromX >= iToX || iFromY >= iToY) return;
+
+    int iPixelSize = iBPP >> 3;
+
+    CogeFXRotateTask task;
+
+    task.pDstData = NULL;
+    task.iDstLineSize = 0;
+    task.iDstWidth = iDstWidth;
+    task.iDstHeight = iDstHeight;
+
+    task.pSrcData = pSrcData + iSrcY * iSrcLineSize + iSrcX * iPixelSize;
+    task.iSrcLineSize = iSrcLineSize;
+    task.iSrcWidth = iSrcWidth;
+    task.iSrcHeight = iSrcHeight;
+    task.iSrcColorKey = iSrcColorKey;
+
+    task.iBPP = iBPP;
+
+#ifdef __FX_WITH_SSE__
+    task.bUseSSE = OGE_FX_GetBackend() >= _OGE_FX_BACKEND_SSE2_;
+#else
+    task.bUseSSE = false;
+#endif
+
+    // the steps of u and v from a row to the next one
+    int64_t iRowU, iRowV;
+
+    if (iDstWidth == iSrcWidth && iDstHeight == iSrcHeight)
+    {
+        OGE_FX_SetupRotate(&task, iDstWidth, iDstHeight, iSrcWidth, iSrcHeight, fAngle, 65536);
+        task.bBilinear = bBilinear && task.iSin != 0; // the pixels of a flip are exact
+
+        iRowU = -task.iSin;
+        iRowV = task.iCos;
+
+        // the nearest samples may copy the color key too, the row is drawn with it anyway
+        if (!task.bBilinear) task.iSrcColorKey = -1;
+    }
+    else
+    {
+        // the same samples as OGE_FX_BltStretch()
+        task.iCos = ((uint32_t) iSrcWidth << 16) / (uint32_t) iDstWidth;
+        task.iSin = 0;
+        task.iU0 = 0;
+        task.iV0 = 0;
+        task.bBilinear = false;
+        task.iSrcColorKey = -1;
+
+        iRowU = 0;
+        iRowV = ((uint32_t) iSrcHeight << 16) / (uint32_t) iDstHeight;
+    }
+
+    // one row of the transformed src
+    uint8_t* pLine = (uint8_t*) malloc(iDstWidth * iPixelSize);
+    if (pLine == NULL) return;
+
+    for(int y=iFromY; y<iToY; y++)
+    {
+        int iFrom = iFromX;
+        int iTo = iToX;
+
+        int64_t u0 = task.iU0 + iRowU * y;
+        int64_t v0 = task.iV0 + iRowV * y;
+
+        // the bilinear samples of the color key are not written, so the span starts with the color key
+        if (task.iSrcColorKey != -1)
+        {
+            OGE_FX_ClipSpan(u0, task.iCos, (int64_t) iSrcWidth  << 16, iFrom, iTo);
+            OGE_FX_ClipSpan(v0, task.iSin, (int64_t) iSrcHeight << 16, iFrom, iTo);
+
+            if (iBPP == 16) std::fill((uint16_t*)pLine + iFrom, (uint16_t*)pLine + iTo, (uint16_t) iSrcColorKey);
+            else std::fill((uint32_t*)pLine + iFrom, (uint32_t*)pLine + iTo, (uint32_t) iSrcColorKey);
+        }
+
+        OGE_FX_RotateRow(&task, pLine, u0, v0, iFrom, iTo);
+
+        if (iFrom >= iTo) continue;
+
+        uint8_t* pSpan = pLine + iFrom * iPixelSize;
+
+        if (pTransform) OGE_FX_ColorTransformRow(pTransform, pSpan, pSpan, iTo - iFrom, iBPP, iSrcColorKey);
+
+        if (iAlpha >= 255)
+            OGE_FX_Blt(pDstData, iDstLineSize, iDstX + iFrom, iDstY + y,
+                       pSpan, 0, iSrcColorKey, 0, 0, iTo - iFrom, 1, iBPP);
+        else
+            OGE_FX_AlphaBlend(pDstData, iDstLineSize, iDstX + iFrom, iDstY + y,
+                              pSpan, 0, iSrcColorKey, 0, 0, iTo - iFrom, 1, iBPP, (uint8_t) iAlpha);
+    }
+
+    free(pLine);
+}
@@ -0,0 +1,1205 @@
+/*
+-----------------------------------------------------------------------------
+This source file is part of Open Game Engine 2D.
+It is licensed under the terms of the MIT license.
+For the latest info, see http://oge2d.sourceforge.net
+
+Copyright (c) 2010-2012 Lin Jia Jun (Joe Lam)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-----------------------------------------------------------------------------
+*/
+
+#include "ogeGraphicFX_Kernel.h"
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+
+#ifdef __FX_WITH_SSE__
+
+#include <emmintrin.h>
+#include <immintrin.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// all kernels here must give exactly the same pixels as the c ones in ogeGraphicFX_C.cpp
+
+#if defined(__GNUC__)
+#define _FX_AVX2_FUNC_ __attribute__((target("avx2")))
+#else
+#define _FX_AVX2_FUNC_
+#endif
+
+#if defined(__MACOSX__) || defined(__IPHONE__)
+
+static const uint32_t alphamask = 0x000000ff;
+
+static const uint32_t redoffset   = 8;
+static const uint32_t greenoffset = 16;
+static const uint32_t blueoffset  = 24;
+
+#else
+
+static const uint32_t alphamask = 0xff000000;
+
+static const uint32_t redoffset   = 16;
+static const uint32_t greenoffset = 8;
+static const uint32_t blueoffset  = 0;
+
+#endif
+
+static CogeFXKernels fxc; // c kernels
+static CogeFXKernels fxs; // sse2 kernels
+
+static uint32_t ChannelBytes(int iRed, int iGreen, int iBlue)
+{
+    return ((uint32_t)iRed << redoffset) | ((uint32_t)iGreen << greenoffset) | ((uint32_t)iBlue << blueoffset);
+}
+
+/*================= SSE2 =======================*/
+
+static inline __m128i FX_SSE_Select(__m128i m, __m128i a, __m128i b)
+{
+    return _mm_or_si128(_mm_and_si128(m, a), _mm_andnot_si128(m, b));
+}
+
+// ((a * (s + 256 - d)) >> 8) + d - a, only the low byte is kept (same as the uint8_t in c code)
+static inline __m128i FX_SSE_Blend8(__m128i s, __m128i d, __m128i a)
+{
+    __m128i mZero = _mm_setzero_si128();
+    __m128i m256  = _mm_set1_epi16(256);
+    __m128i mByte = _mm_set1_epi16(0x00ff);
+
+    __m128i sl = _mm_unpacklo_epi8(s, mZero);
+    __m128i sh = _mm_unpackhi_epi8(s, mZero);
+    __m128i dl = _mm_unpacklo_epi8(d, mZero);
+    __m128i dh = _mm_unpackhi_epi8(d, mZero);
+
+    sl = _mm_mullo_epi16(a, _mm_add_epi16(_mm_sub_epi16(sl, dl), m256));
+    sh = _mm_mullo_epi16(a, _mm_add_epi16(_mm_sub_epi16(sh, dh), m256));
+
+    sl = _mm_and_si128(_mm_sub_epi16(_mm_add_epi16(_mm_srli_epi16(sl, 8), dl), a), mByte);
+    sh = _mm_and_si128(_mm_sub_epi16(_mm_add_epi16(_mm_srli_epi16(sh, 8), dh), a), mByte);
+
+    return _mm_packus_epi16(sl, sh);
+}
+
+// c + (a * (c ^ 255) >> 8) or c - (a * c >> 8)
+static inline __m128i FX_SSE_Lighten8(__m128i d, __m128i a, bool bBrighter)
+{
+    __m128i mZero = _mm_setzero_si128();
+    __m128i mByte = _mm_set1_epi16(0x00ff);
+
+    __m128i dl = _mm_unpacklo_epi8(d, mZero);
+    __m128i dh = _mm_unpackhi_epi8(d, mZero);
+
+    if (bBrighter)
+    {
+        dl = _mm_add_epi16(dl, _mm_srli_epi16(_mm_mullo_epi16(a, _mm_xor_si128(dl, mByte)), 8));
+        dh = _mm_add_epi16(dh, _mm_srli_epi16(_mm_mullo_epi16(a, _mm_xor_si128(dh, mByte)), 8));
+    }
+    else
+    {
+        dl = _mm_sub_epi16(dl, _mm_srli_epi16(_mm_mullo_epi16(a, dl), 8));
+        dh = _mm_sub_epi16(dh, _mm_srli_epi16(_mm_mullo_epi16(a, dh), 8));
+    }
+
+    return _mm_packus_epi16(dl, dh);
+}
+
+// split 8 pixels of 565 into 3 channels
+static inline void FX_SSE_Unpack565(__m128i m, __m128i& r, __m128i& g, __m128i& b)
+{
+    b = _mm_and_si128(m, _mm_set1_epi16(0x001f));
+    g = _mm_and_si128(_mm_srli_epi16(m, 5), _mm_set1_epi16(0x003f));
+    r = _mm_srli_epi16(m, 11);
+}
+
+static inline __m128i FX_SSE_Pack565(__m128i r, __m128i g, __m128i b)
+{
+    return _mm_or_si128(_mm_or_si128(_mm_slli_epi16(r, 11), _mm_slli_epi16(g, 5)), b);
+}
+
+static void OGE_FX_SSE_CopyRect(uint8_t* pDstData, int iDstLineSize,
+                int iDstX, int iDstY,
+                uint8_t* pSrcData, int iSrcLineSize,
+                int iSrcX, int iSrcY,
+                int iWidth, int iHeight, int iBPP)
+{
+    int iPixelSize = 0;
+
+    switch (iBPP)
+	{
+    case 8:  iPixelSize = 1; break;
+    case 15:
+    case 16: iPixelSize = 2; break;
+    case 24: iPixelSize = 3; break;
+    case 32: iPixelSize = 4; break;
+    default: return;
+	}
+
+	int iLineBytes = iWidth * iPixelSize;
+	if (iLineBytes <= 0) return;
+
+	pDstData += iDstY * iDstLineSize + iDstX * iPixelSize;
+    pSrcData += iSrcY * iSrcLineSize + iSrcX * iPixelSize;
+
+    while(iHeight > 0)
+    {
+        memmove(pDstData, pSrcData, iLineBytes);
+
+        pSrcData += iSrcLineSize;
+        pDstData += iDstLineSize;
+
+        iHeight--;
+    }
+}
+
+static void OGE_FX_SSE_Blt(uint8_t* pDstData, int iDstLineSize,
+                int iDstX, int iDstY,
+                uint8_t* pSrcData, int iSrcLineSize, int iSrcColorKey,
+                int iSrcX, int iSrcY,
+                int iWidth, int iHeight, int iBPP)
+{
+    if (iBPP != 16 && iBPP != 32)
+    {
+        fxc.Blt(pDstData, iDstLineSize, iDstX, iDstY, pSrcData, iSrcLineSize, iSrcColorKey,
+                iSrcX, iSrcY, iWidth, iHeight, iBPP);
+        return;
+    }
+
+    if (iSrcColorKey == -1)
+    {
+        OGE_FX_SSE_CopyRect(pDstData, iDstLineSize, iDstX, iDstY, pSrcData, iSrcLineSize,
+                            iSrcX, iSrcY, iWidth, iHeight, iBPP);
+        return;
+    }
+
+    int iStep = iBPP == 16 ? 8 : 4;
+    int iVecWidth = iWidth - iWidth % iStep;
+
+    if (iVecWidth < iWidth)
+        fxc.Blt(pDstData, iDstLineSize, iDstX + iVecWidth, iDstY, pSrcData, iSrcLineSize, iSrcColorKey,
+                iSrcX + iVecWidth, iSrcY, iWidth - iVecWidth, iHeight, iBPP);
+
+    if (iVecWidth <= 0) return;
+
+    int iPixelSize = iBPP >> 3;
+    int iLineBytes = iVecWidth * iPixelSize;
+
+    pDstData += iDstY * iDstLineSize + iDstX * iPixelSize;
+    pSrcData += iSrcY * iSrcLineSize + iSrcX * iPixelSize;
+
+    __m128i mKey, mSrc, mDst, mMask;
+
+    if (iBPP == 16) mKey = _mm_set1_epi16((short)(iSrcColorKey & 0x0000ffff));
+    else mKey = _mm_set1_epi32(iSrcColorKey);
+
+    while(iHeight > 0)
+    {
+        for(int i=0; i<iLineBytes; i+=16)
+        {
+            mSrc = _mm_loadu_si128((__m128i*)(pSrcData + i));
+            mDst = _mm_loadu_si128((__m128i*)(pDstData + i));
+
+            if (iBPP == 16) mMask = _mm_cmpeq_epi16(mSrc, mKey);
+            else mMask = _mm_cmpeq_epi32(mSrc, mKey);
+
+            _mm_storeu_si128((__m128i*)(pDstData + i), FX_SSE_Select(mMask, mDst, mSrc));
+        }
+
+        pSrcData += iSrcLineSize;
+        pDstData += iDstLineSize;
+
+        iHeight--;
+    }
+}
+
+static void OGE_FX_SSE_SubLight(uint8_t* pDstData, int iDstLineSize,
+                      int iDstX, int iDstY,
+                      int iWidth, int iHeight, int iBPP, int iAmount)
+{
+    if (iBPP != 16 && iBPP != 32)
+    {
+        fxc.SubLight(pDstData, iDstLineSize, iDstX, iDstY, iWidth, iHeight, iBPP, iAmount);
+        return;
+    }
+
+    int iStep = iBPP == 16 ? 8 : 4;
+    int iVecWidth = iWidth - iWidth % iStep;
+
+    if (iVecWidth < iWidth)
+        fxc.SubLight(pDstData, iDstLineSize, iDstX + iVecWidth, iDstY, iWidth - iVecWidth, iHeight, iBPP, iAmount);
+
+    if (iVecWidth <= 0) return;
+
+    int iPixelSize = iBPP >> 3;
+    int iLineBytes = iVecWidth * iPixelSize;
+
+    pDstData += iDstY * iDstLineSize + iDstX * iPixelSize;
+
+    uint8_t i8Amount = abs(iAmount);
+
+    __m128i mDst, r, g, b;
+
+    __m128i mRGB = _mm_set1_epi32(~alphamask);
+    __m128i mAmount = _mm_set1_epi8(i8Amount);
+    __m128i m5Amount = _mm_set1_epi16(i8Amount >> 3);
+    __m128i m6Amount = _mm_set1_epi16(i8Amount >> 2);
+
+    while(iHeight > 0)
+    {
+        for(int i=0; i<iLineBytes; i+=16)
+        {
+            mDst = _mm_loadu_si128((__m128i*)(pDstData + i));
+
+            if (iBPP == 16)
+            {
+                FX_SSE_Unpack565(mDst, r, g, b);
+                mDst = FX_SSE_Pack565(_mm_subs_epu16(r, m5Amount), _mm_subs_epu16(g, m6Amount), _mm_subs_epu16(b, m5Amount));
+            }
+            else mDst = _mm_and_si128(_mm_subs_epu8(mDst, mAmount), mRGB);
+
+            _mm_storeu_si128((__m128i*)(pDstData + i), mDst);
+        }
+
+        pDstData += iDstLineSize;
+
+        iHeight--;
+    }
+}
+
+static void OGE_FX_SSE_Lightness(uint8_t* pDstData, int iDstLineSize,
+                      int iDstX, int iDstY,
+                      int iWidth, int iHeight, int iBPP, int iAmount)
+{
+    if (iBPP != 16 && iBPP != 32)
+    {
+        fxc.Lightness(pDstData, iDstLineSize, iDstX, iDstY, iWidth, iHeight, iBPP, iAmount);
+        return;
+    }
+
+    int iStep = iBPP == 16 ? 8 : 4;
+    int iVecWidth = iWidth - iWidth % iStep;
+
+    if (iVecWidth < iWidth)
+        fxc.Lightness(pDstData, iDstLineSize, iDstX + iVecWidth, iDstY, iWidth - iVecWidth, iHeight, iBPP, iAmount);
+
+    if (iVecWidth <= 0) return;
+
+    int iPixelSize = iBPP >> 3;
+    int iLineBytes = iVecWidth * iPixelSize;
+
+    pDstData += iDstY * iDstLineSize + iDstX * iPixelSize;
+
+    uint8_t i8Amount = abs(iAmount);
+    bool bBrighter = iAmount >= 0;
+
+    __m128i mDst, r, g, b;
+
+    __m128i mRGB = _mm_set1_epi32(~alphamask);
+    __m128i mAmount = _mm_set1_epi16(i8Amount);
+    __m128i m5 = _mm_set1_epi16(31);
+    __m128i m6 = _mm_set1_epi16(63);
+
+    while(iHeight > 0)
+    {
+        for(int i=0; i<iLineBytes; i+=16)
+        {
+            mDst = _mm_loadu_si128((__m128i*)(pDstData + i));
+
+            if (iBPP == 16)
+            {
+                FX_SSE_Unpack565(mDst, r, g, b);
+                if (bBrighter)
+                {
+                    r = _mm_add_epi16(r, _mm_srli_epi16(_mm_mullo_epi16(mAmount, _mm_xor_si128(r, m5)), 8));
+                    g = _mm_add_epi16(g, _mm_srli_epi16(_mm_mullo_epi16(mAmount, _mm_xor_si128(g, m6)), 8));
+                    b = _mm_add_epi16(b, _mm_srli_epi16(_mm_mullo_epi16(mAmount, _mm_xor_si128(b, m5)), 8));
+                }
+                else
+                {
+                    r = _mm_sub_epi16(r, _mm_srli_epi16(_mm_mullo_epi16(mAmount, r), 8));
+                    g = _mm_sub_epi16(g, _mm_srli_epi16(_mm_mullo_epi16(mAmount, g), 8));
+                    b = _mm_sub_epi16(b, _mm_srli_epi16(_mm_mullo_epi16(mAmount, b), 8));
+                }
+                mDst = FX_SSE_Pack565(r, g, b);
+            }
+            else mDst = _mm_and_si128(FX_SSE_Lighten8(mDst, mAmount, bBrighter), mRGB);
+
+            _mm_storeu_si128((__m128i*)(pDstData + i), mDst);
+        }
+
+        pDstData += iDstLineSize;
+
+        iHeight--;
+    }
+}
+
+static void OGE_FX_SSE_ChangeColorRGB(uint8_t* pDstData, int iDstLineSize,
+                      int iDstX, int iDstY,
+                      int iWidth, int iHeight, int iBPP,
+                      int iRedAmount, int iGreenAmount, int iBlueAmount)
+{
+    if (iBPP != 32)
+    {
+        fxc.ChangeColorRGB(pDstData, iDstLineSize, iDstX, iDstY, iWidth, iHeight, iBPP,
+                           iRedAmount, iGreenAmount, iBlueAmount);
+        return;
+    }
+
+    int iVecWidth = iWidth & ~3;
+
+    if (iVecWidth < iWidth)
+        fxc.ChangeColorRGB(pDstData, iDstLineSize, iDstX + iVecWidth, iDstY, iWidth - iVecWidth, iHeight, iBPP,
+                           iRedAmount, iGreenAmount, iBlueAmount);
+
+    if (iVecWidth <= 0) return;
+
+    int iLineBytes = iVecWidth << 2;
+
+    pDstData += iDstY * iDstLineSize + iDstX * 4;
+
+    // positive amounts are added with saturation, negative ones are cut down to a byte first (like the c code)
+    uint32_t iAdd = ChannelBytes(iRedAmount   >= 0 ? std::min(iRedAmount,   255) : 0,
+                                 iGreenAmount >= 0 ? std::min(iGreenAmount, 255) : 0,
+                                 iBlueAmount  >= 0 ? std::min(iBlueAmount,  255) : 0);
+
+    uint32_t iSub = ChannelBytes(iRedAmount   < 0 ? (uint8_t)abs(iRedAmount)   : 0,
+                                 iGreenAmount < 0 ? (uint8_t)abs(iGreenAmount) : 0,
+                                 iBlueAmount  < 0 ? (uint8_t)abs(iBlueAmount)  : 0);
+
+    __m128i mDst;
+    __m128i mRGB = _mm_set1_epi32(~alphamask);
+    __m128i mAdd = _mm_set1_epi32(iAdd);
+    __m128i mSub = _mm_set1_epi32(iSub);
+
+    while(iHeight > 0)
+    {
+        for(int i=0; i<iLineBytes; i+=16)
+        {
+            mDst = _mm_loadu_si128((__m128i*)(pDstData + i));
+            mDst = _mm_and_si128(_mm_subs_epu8(_mm_adds_epu8(mDst, mAdd), mSub), mRGB);
+            _mm_storeu_si128((__m128i*)(pDstData + i), mDst);
+        }
+
+        pDstData += iDstLineSize;
+
+        iHeight--;
+    }
+}
+
+static void OGE_FX_SSE_BltLightness(uint8_t* pDstData, int iDstLineSize,
+                int iDstX, int iDstY,
+                uint8_t* pSrcData, int iSrcLineSize, int iSrcColorKey,
+                int iSrcX, int iSrcY,
+                int iWidth, int iHeight, int iBPP, int iAmount)
+{
+    // a positive amount above 256 would overflow the 16-bit lanes
+    if (iBPP != 32 || iAmount > 256)
+    {
+        fxc.BltLightness(pDstData, iDstLineSize, iDstX, iDstY, pSrcData, iSrcLineSize, iSrcColorKey,
+                         iSrcX, iSrcY, iWidth, iHeight, iBPP, iAmount);
+        return;
+    }
+
+    int iVecWidth = iWidth & ~3;
+
+    if (iVecWidth < iWidth)
+        fxc.BltLightness(pDstData, iDstLineSize, iDstX + iVecWidth, iDstY, pSrcData, iSrcLineSize, iSrcColorKey,
+                         iSrcX + iVecWidth, iSrcY, iWidth - iVecWidth, iHeight, iBPP, iAmount);
+
+    if (iVecWidth <= 0) return;
+
+    int iLineBytes = iVecWidth << 2;
+
+    pDstData += iDstY * iDstLineSize + iDstX * 4;
+    pSrcData += iSrcY * iSrcLineSize + iSrcX * 4;
+
+    bool bNoColorKey = iSrcColorKey == -1;
+    bool bBrighter = iAmount >= 0;
+
+    __m128i mSrc, mDst;
+    __m128i mRGB = _mm_set1_epi32(~alphamask);
+    __m128i mKey = _mm_set1_epi32(iSrcColorKey);
+    __m128i mAmount = _mm_set1_epi16(bBrighter ? iAmount : (uint8_t)abs(iAmount));
+
+    while(iHeight > 0)
+    {
+        for(int i=0; i<iLineBytes; i+=16)
+        {
+            mSrc = _mm_loadu_si128((__m128i*)(pSrcData + i));
+            mDst = _mm_and_si128(FX_SSE_Lighten8(mSrc, mAmount, bBrighter), mRGB);
+            if (!bNoColorKey)
+                mDst = FX_SSE_Select(_mm_cmpeq_epi32(mSrc, mKey), _mm_loadu_si128((__m128i*)(pDstData + i)), mDst);
+            _mm_storeu_si128((__m128i*)(pDstData + i), mDst);
+        }
+
+        pSrcData += iSrcLineSize;
+        pDstData += iDstLineSize;
+
+        iHeight--;
+    }
+}
+
+static void OGE_FX_SSE_BltChangedRGB(uint8_t* pDstData, int iDstLineSize,
+                      int iDstX, int iDstY,
+                      uint8_t* pSrcData, int iSrcLineSize, int iSrcColorKey,
+                      int iSrcX, int iSrcY,
+                      int iWidth, int iHeight, int iBPP,
+                      int iRedAmount, int iGreenAmount, int iBlueAmount)
+{
+    if (iBPP != 32)
+    {
+        fxc.BltChangedRGB(pDstData, iDstLineSize, iDstX, iDstY, pSrcData, iSrcLineSize, iSrcColorKey,
+                          iSrcX, iSrcY, iWidth, iHeight, iBPP, iRedAmount, iGreenAmount, iBlueAmount);
+        return;
+    }
+
+    int iVecWidth = iWidth & ~3;
+
+    if (iVecWidth < iWidth)
+        fxc.BltChangedRGB(pDstData, iDstLineSize, iDstX + iVecWidth, iDstY, pSrcData, iSrcLineSize, iSrcColorKey,
+                          iSrcX + iVecWidth, iSrcY, iWidth - iVecWidth, iHeight, iBPP, iRedAmount, iGreenAmount, iBlueAmount);
+
+    if (iVecWidth <= 0) return;
+
+    int iLineBytes = iVecWidth << 2;
+
+    pDstData += iDstY * iDstLineSize + iDstX * 4;
+    pSrcData += iSrcY * iSrcLineSize + iSrcX * 4;
+
+    bool bNoColorKey = iSrcColorKey == -1;
+
+    uint8_t i8RedAmount = abs(iRedAmount);
+	uint8_t i8GreenAmount = abs(iGreenAmount);
+	uint8_t i8BlueAmount = abs(iBlueAmount);
+
+    uint32_t iAdd = ChannelBytes(iRedAmount   >= 0 ? i8RedAmount   : 0,
+                                 iGreenAmount >= 0 ? i8GreenAmount : 0,
+                                 iBlueAmount  >= 0 ? i8BlueAmount  : 0);
+
+    uint32_t iSub = ChannelBytes(iRedAmount   < 0 ? i8RedAmount   : 0,
+                                 iGreenAmount < 0 ? i8GreenAmount : 0,
+                                 iBlueAmount  < 0 ? i8BlueAmount  : 0);
+
+    __m128i mSrc, mDst;
+    __m128i mRGB = _mm_set1_epi32(~alphamask);
+    __m128i mKey = _mm_set1_epi32(iSrcColorKey);
+    __m128i mAdd = _mm_set1_epi32(iAdd);
+    __m128i mSub = _mm_set1_epi32(iSub);
+
+    while(iHeight > 0)
+    {
+        for(int i=0; i<iLineBytes; i+=16)
+        {
+            mSrc = _mm_loadu_si128((__m128i*)(pSrcData + i));
+            mDst = _mm_and_si128(_mm_subs_epu8(_mm_adds_epu8(mSrc, mAdd), mSub), mRGB);
+            if (!bNoColorKey)
+                mDst = FX_SSE_Select(_mm_cmpeq_epi32(mSrc, mKey), _mm_loadu_si128((__m128i*)(pDstData + i)), mDst);
+            _mm_storeu_si128((__m128i*)(pDstData + i), mDst);
+        }
+
+        pSrcData += iSrcLineSize;
+        pDstData += iDstLineSize;
+
+        iHeight--;
+    }
+}
+
+static void OGE_FX_SSE_AlphaBlend(uint8_t* pDstData, int iDstLineSize,
+                int iDstX, int iDstY,
+                uint8_t* pSrcData, int iSrcLineSize, int iSrcColorKey,
+                int iSrcX, int iSrcY,
+                int iWidth, int iHeight, int iBPP, uint8_t iAlpha)
+{
+    if (iBPP != 16 && iBPP != 32)
+    {
+        fxc.AlphaBlend(pDstData, iDstLineSize, iDstX, iDstY, pSrcData, iSrcLineSize, iSrcColorKey,
+                       iSrcX, iSrcY, iWidth, iHeight, iBPP, iAlpha);
+        return;
+    }
+
+    int iStep = iBPP == 16 ? 8 : 4;
+    int iVecWidth = iWidth - iWidth % iStep;
+
+    if (iVecWidth < iWidth)
+        fxc.AlphaBlend(pDstData, iDstLineSize, iDstX + iVecWidth, iDstY, pSrcData, iSrcLineSize, iSrcColorKey,
+                       iSrcX + iVecWidth, iSrcY, iWidth - iVecWidth, iHeight, iBPP, iAlpha);
+
+    if (iVecWidth <= 0) return;
+
+    int iPixelSize = iBPP >> 3;
+    int iLineBytes = iVecWidth * iPixelSize;
+
+    pDstData += iDstY * iDstLineSize + iDstX * iPixelSize;
+    pSrcData += iSrcY * iSrcLineSize + iSrcX * iPixelSize;
+
+    bool bIsHalfAlpha = iAlpha == 128;
+	bool bNoColorKey = iSrcColorKey == -1;
+
+    __m128i mSrc, mDst, mColor, mKey, mHalf;
+    __m128i sr, sg, sb, dr, dg, db;
+
+    __m128i mRGB = _mm_set1_epi32(~alphamask);
+    __m128i mAlpha = _mm_set1_epi16(iAlpha);
+    __m128i mSmallAlpha = _mm_set1_epi16(iAlpha >> 2);
+    __m128i m64 = _mm_set1_epi16(64);
+
+    if (iBPP == 16)
+    {
+        mKey = _mm_set1_epi16((short)(iSrcColorKey & 0x0000ffff));
+        mHalf = _mm_set1_epi16((short)0xF7DE);
+    }
+    else
+    {
+        mKey = _mm_set1_epi32(iSrcColorKey);
+        mHalf = _mm_set1_epi32(0xFEFEFE);
+    }
+
+    while(iHeight > 0)
+    {
+        for(int i=0; i<iLineBytes; i+=16)
+        {
+            mSrc = _mm_loadu_si128((__m128i*)(pSrcData + i));
+            mDst = _mm_loadu_si128((__m128i*)(pDstData + i));
+
+            if (iBPP == 16)
+            {
+                if (bIsHalfAlpha)
+                    mColor = _mm_add_epi16(_mm_srli_epi16(_mm_and_si128(mSrc, mHalf), 1),
+                                           _mm_srli_epi16(_mm_and_si128(mDst, mHalf), 1));
+                else
+                {
+                    FX_SSE_Unpack565(mSrc, sr, sg, sb);
+                    FX_SSE_Unpack565(mDst, dr, dg, db);
+
+                    sr = _mm_sub_epi16(_mm_add_epi16(_mm_srli_epi16(_mm_mullo_epi16(mAlpha, _mm_sub_epi16(_mm_add_epi16(sr, m64), dr)), 8), dr), mSmallAlpha);
+                    sg = _mm_sub_epi16(_mm_add_epi16(_mm_srli_epi16(_mm_mullo_epi16(mAlpha, _mm_sub_epi16(_mm_add_epi16(sg, m64), dg)), 8), dg), mSmallAlpha);
+                    sb = _mm_sub_epi16(_mm_add_epi16(_mm_srli_epi16(_mm_mullo_epi16(mAlpha, _mm_sub_epi16(_mm_add_epi16(sb, m64), db)), 8), db), mSmallAlpha);
+
+                    mColor = FX_SSE_Pack565(sr, sg, sb);
+                }
+
+                if (!bNoColorKey) mColor = FX_SSE_Select(_mm_cmpeq_epi16(mSrc, mKey), mDst, mColor);
+            }
+            else
+            {
+                if (bIsHalfAlpha)
+                    mColor = _mm_add_epi32(_mm_srli_epi32(_mm_and_si128(mSrc, mHalf), 1),
+                                           _mm_srli_epi32(_mm_and_si128(mDst, mHalf), 1));
+                else
+                    mColor = _mm_and_si128(FX_SSE_Blend8(mSrc, mDst, mAlpha), mRGB);
+
+                if (!bNoColorKey) mColor = FX_SSE_Select(_mm_cmpeq_epi32(mSrc, mKey), mDst, mColor);
+            }
+
+            _mm_storeu_si128((__m128i*)(pDstData + i), mColor);
+        }
+
+        pSrcData += iSrcLineSize;
+        pDstData += iDstLineSize;
+
+        iHeight--;
+    }
+}
+
+static void OGE_FX_SSE_LightMaskBlend(uint8_t* pDstData, int iDstLineSize,
+                int iDstX, int iDstY,
+                uint8_t* pSrcData, int iSrcLineSize,
+                int iSrcX, int iSrcY,
+                int iWidth, int iHeight, int iBPP)
+{
+    if (iBPP != 16 && iBPP != 32)
+    {
+        fxc.LightMaskBlend(pDstData, iDstLineSize, iDstX, iDstY, pSrcData, iSrcLineSize,
+                           iSrcX, iSrcY, iWidth, iHeight, iBPP);
+        return;
+    }
+
+    int iStep = iBPP == 16 ? 8 : 4;
+    int iVecWidth = iWidth - iWidth % iStep;
+
+    if (iVecWidth < iWidth)
+        fxc.LightMaskBlend(pDstData, iDstLineSize, iDstX + iVecWidth, iDstY, pSrcData, iSrcLineSize,
+                           iSrcX + iVecWidth, iSrcY, iWidth - iVecWidth, iHeight, iBPP);
+
+    if (iVecWidth <= 0) return;
+
+    int iPixelSize = iBPP >> 3;
+    int iLineBytes = iVecWidth * iPixelSize;
+
+    pDstData += iDstY * iDstLineSize + iDstX * iPixelSize;
+    pSrcData += iSrcY * iSrcLineSize + iSrcX * iPixelSize;
+
+    __m128i mSrc, mDst, mAmount, mGreenAmount;
+    __m128i dr, dg, db;
+
+    __m128i mZero = _mm_setzero_si128();
+    __m128i mRGB = _mm_set1_epi32(~alphamask);
+    __m128i mByte = _mm_set1_epi32(0xff);
+
+    while(iHeight > 0)
+    {
+        for(int i=0; i<iLineBytes; i+=16)
+        {
+            mSrc = _mm_loadu_si128((__m128i*)(pSrcData + i));
+            mDst = _mm_loadu_si128((__m128i*)(pDstData + i));
+
+            if (iBPP == 16)
+            {
+                mAmount = _mm_and_si128(mSrc, _mm_set1_epi16(0x001f));
+                mGreenAmount = _mm_and_si128(_mm_srli_epi16(mSrc, 5), _mm_set1_epi16(0x003f));
+
+                FX_SSE_Unpack565(mDst, dr, dg, db);
+
+                db = _mm_sub_epi16(db, _mm_srli_epi16(_mm_mullo_epi16(mAmount, db), 5));
+                dg = _mm_sub_epi16(dg, _mm_srli_epi16(_mm_mullo_epi16(mGreenAmount, dg), 6));
+                dr = _mm_sub_epi16(dr, _mm_srli_epi16(_mm_mullo_epi16(mAmount, dr), 5));
+
+                mDst = FX_SSE_Pack565(dr, dg, db);
+            }
+            else
+            {
+                // the blue channel of the mask is the amount of all channels
+                mAmount = _mm_and_si128(_mm_srli_epi32(mSrc, blueoffset), mByte);
+                mAmount = _mm_or_si128(mAmount, _mm_slli_epi32(mAmount, 8));
+                mAmount = _mm_or_si128(mAmount, _mm_slli_epi32(mAmount, 16));
+
+                __m128i al = _mm_unpacklo_epi8(mAmount, mZero);
+                __m128i ah = _mm_unpackhi_epi8(mAmount, mZero);
+                __m128i dl = _mm_unpacklo_epi8(mDst, mZero);
+                __m128i dh = _mm_unpackhi_epi8(mDst, mZero);
+
+                dl = _mm_sub_epi16(dl, _mm_srli_epi16(_mm_mullo_epi16(al, dl), 8));
+                dh = _mm_sub_epi16(dh, _mm_srli_epi16(_mm_mullo_epi16(ah, dh), 8));
+
+                mDst = _mm_and_si128(_mm_packus_epi16(dl, dh), mRGB);
+            }
+
+            _mm_storeu_si128((__m128i*)(pDstData + i), mDst);
+        }
+
+        pSrcData += iSrcLineSize;
+        pDstData += iDstLineSize;
+
+        iHeight--;
+    }
+}
+
+static void OGE_FX_SSE_BltWithColor(uint8_t* pDstData, int iDstLineSize,
+                int iDstX, int iDstY,
+                uint8_t* pSrcData, int iSrcLineSize, int iSrcColorKey,
+                int iSrcX, int iSrcY,
+                int iWidth, int iHeight, int iBPP, int iColor, int iAlpha)
+{
+    if (iBPP != 16 && iBPP != 32)
+    {
+        fxc.BltWithColor(pDstData, iDstLineSize, iDstX, iDstY, pSrcData, iSrcLineSize, iSrcColorKey,
+                         iSrcX, iSrcY, iWidth, iHeight, iBPP, iColor, iAlpha);
+        return;
+    }
+
+    int iStep = iBPP == 16 ? 8 : 4;
+    int iVecWidth = iWidth - iWidth % iStep;
+
+    if (iVecWidth < iWidth)
+        fxc.BltWithColor(pDstData, iDstLineSize, iDstX + iVecWidth, iDstY, pSrcData, iSrcLineSize, iSrcColorKey,
+                         iSrcX + iVecWidth, iSrcY, iWidth - iVecWidth, iHeight, iBPP, iColor, iAlpha);
+
+    if (iVecWidth <= 0) return;
+
+    int iPixelSize = iBPP >> 3;
+    int iLineBytes = iVecWidth * iPixelSize;
+
+    pDstData += iDstY * iDstLineSize + iDstX * iPixelSize;
+    pSrcData += iSrcY * iSrcLineSize + iSrcX * iPixelSize;
+
+    bool bNoColorKey = iSrcColorKey == -1;
+
+    if(iAlpha > 256) iAlpha = 256;
+	else if(iAlpha < 0) iAlpha = 0;
+
+	iAlpha = 256 - iAlpha;
+
+    __m128i mSrc, mColor, mKey;
+    __m128i sr, sg, sb;
+
+    __m128i mRGB = _mm_set1_epi32(~alphamask);
+    __m128i mAlpha = _mm_set1_epi16(iAlpha);
+
+    __m128i cr = _mm_set1_epi16((iColor & 0xf800) >> 11);
+    __m128i cg = _mm_set1_epi16((iColor & 0x07e0) >> 5);
+    __m128i cb = _mm_set1_epi16(iColor & 0x001f);
+    __m128i c32 = _mm_set1_epi32(iColor);
+
+    if (iBPP == 16) mKey = _mm_set1_epi16((short)(iSrcColorKey & 0x0000ffff));
+    else mKey = _mm_set1_epi32(iSrcColorKey);
+
+    while(iHeight > 0)
+    {
+        for(int i=0; i<iLineBytes; i+=16)
+        {
+            mSrc = _mm_loadu_si128((__m128i*)(pSrcData + i));
+
+            if (iBPP == 16)
+            {
+                // (alpha * (src - color)) / 256 + color, fits in signed 16-bit
+                FX_SSE_Unpack565(mSrc, sr, sg, sb);
+
+                sr = _mm_add_epi16(_mm_srai_epi16(_mm_mullo_epi16(mAlpha, _mm_sub_epi16(sr, cr)), 8), cr);
+                sg = _mm_add_epi16(_mm_srai_epi16(_mm_mullo_epi16(mAlpha, _mm_sub_epi16(sg, cg)), 8), cg);
+                sb = _mm_add_epi16(_mm_srai_epi16(_mm_mullo_epi16(mAlpha, _mm_sub_epi16(sb, cb)), 8), cb);
+
+                mColor = FX_SSE_Pack565(sr, sg, sb);
+
+                if (!bNoColorKey)
+                    mColor = FX_SSE_Select(_mm_cmpeq_epi16(mSrc, mKey), _mm_loadu_si128((__m128i*)(pDstData + i)), mColor);
+            }
+            else
+            {
+                mColor = _mm_and_si128(FX_SSE_Blend8(mSrc, c32, mAlpha), mRGB);
+
+                if (!bNoColorKey)
+                    mColor = FX_SSE_Select(_mm_cmpeq_epi32(mSrc, mKey), _mm_loadu_si128((__m128i*)(pDstData + i)), mColor);
+            }
+
+            _mm_storeu_si128((__m128i*)(pDstData + i), mColor);
+        }
+
+        pSrcData += iSrcLineSize;
+        pDstData += iDstLineSize;
+
+        iHeight--;
+    }
+}
+
+// x / 255 with rounding (x <= 255 * 255)
+static inline __m128i FX_SSE_Div255(__m128i x)
+{
+    return _mm_mulhi_epu16(_mm_add_epi16(x, _mm_set1_epi16(128)), _mm_set1_epi16(257));
+}
+
+// the 4 bytes of each pixel multiplied by the 16 bit factors in al (pixel 0, 1) and ah (pixel 2, 3), divided by 255
+static inline __m128i FX_SSE_Scale8(__m128i c, __m128i al, __m128i ah)
+{
+    __m128i mZero = _mm_setzero_si128();
+
+    __m128i cl = FX_SSE_Div255(_mm_mullo_epi16(_mm_unpacklo_epi8(c, mZero), al));
+    __m128i ch = FX_SSE_Div255(_mm_mullo_epi16(_mm_unpackhi_epi8(c, mZero), ah));
+
+    return _mm_packus_epi16(cl, ch);
+}
+
+static void OGE_FX_SSE_BltPremultiplied(uint8_t* pDstData, int iDstLineSize,
+                int iDstX, int iDstY,
+                uint8_t* pSrcData, int iSrcLineSize,
+                int iSrcX, int iSrcY,
+                int iWidth, int iHeight, int iBPP, int iAlphaShift, uint8_t iAlpha)
+{
+    if (iBPP != 32 || iAlpha == 0)
+    {
+        fxc.BltPremultiplied(pDstData, iDstLineSize, iDstX, iDstY, pSrcData, iSrcLineSize,
+                             iSrcX, iSrcY, iWidth, iHeight, iBPP, iAlphaShift, iAlpha);
+        return;
+    }
+
+    int iVecWidth = iWidth & ~3;
+
+    if (iVecWidth < iWidth)
+        fxc.BltPremultiplied(pDstData, iDstLineSize, iDstX + iVecWidth, iDstY, pSrcData, iSrcLineSize,
+                             iSrcX + iVecWidth, iSrcY, iWidth - iVecWidth, iHeight, iBPP, iAlphaShift, iAlpha);
+
+    if (iVecWidth <= 0) return;
+
+    int iLineBytes = iVecWidth * 4;
+
+    pDstData += iDstY * iDstLineSize + iDstX * 4;
+    pSrcData += iSrcY * iSrcLineSize + iSrcX * 4;
+
+    bool bScaled = iAlpha != 255;
+
+    __m128i mSrc, mDst, mA, mInv;
+    __m128i mZero = _mm_setzero_si128();
+    __m128i mAlphaMask = _mm_set1_epi32(0xff << iAlphaShift);
+    __m128i mByte = _mm_set1_epi32(0xff);
+    __m128i mShift = _mm_cvtsi32_si128(iAlphaShift);
+    __m128i mGlobal = _mm_set1_epi16(iAlpha);
+
+    while(iHeight > 0)
+    {
+        for(int i=0; i<iLineBytes; i+=16)
+        {
+            mSrc = _mm_loadu_si128((__m128i*)(pSrcData + i));
+
+            if (bScaled) mSrc = FX_SSE_Scale8(mSrc, mGlobal, mGlobal);
+
+            mA = _mm_and_si128(mSrc, mAlphaMask);
+
+            // skip the transparent pixels and copy the opaque ones at once
+            if (_mm_movemask_epi8(_mm_cmpeq_epi32(mA, mZero)) == 0xffff) continue;
+
+            if (_mm_movemask_epi8(_mm_cmpeq_epi32(mA, mAlphaMask)) == 0xffff)
+            {
+                _mm_storeu_si128((__m128i*)(pDstData + i), mSrc);
+                continue;
+            }
+
+            // 255 - a in both 16 bit halves of each pixel
+            mInv = _mm_xor_si128(_mm_srl_epi32(mA, mShift), mByte);
+            mInv = _mm_or_si128(mInv, _mm_slli_epi32(mInv, 16));
+
+            mDst = _mm_loadu_si128((__m128i*)(pDstData + i));
+            mDst = FX_SSE_Scale8(mDst, _mm_unpacklo_epi32(mInv, mInv), _mm_unpackhi_epi32(mInv, mInv));
+
+            _mm_storeu_si128((__m128i*)(pDstData + i), _mm_add_epi8(mSrc, mDst));
+        }
+
+        pSrcData += iSrcLineSize;
+        pDstData += iDstLineSize;
+
+        iHeight--;
+    }
+}
+
+/*================= AVX2 (32 bpp only, the others go to sse2) =======================*/
+
+_FX_AVX2_FUNC_ static inline __m256i FX_AVX2_Select(__m256i m, __m256i a, __m256i b)
+{
+    return _mm256_blendv_epi8(b, a, m);
+}
+
+_FX_AVX2_FUNC_ static inline __m256i FX_AVX2_Blend8(__m256i s, __m256i d, __m256i a)
+{
+    __m256i mZero = _mm256_setzero_si256();
+    __m256i m256  = _mm256_set1_epi16(256);
+    __m256i mByte = _mm256_set1_epi16(0x00ff);
+
+    __m256i sl = _mm256_unpacklo_epi8(s, mZero);
+    __m256i sh = _mm256_unpackhi_epi8(s, mZero);
+    __m256i dl = _mm256_unpacklo_epi8(d, mZero);
+    __m256i dh = _mm256_unpackhi_epi8(d, mZero);
+
+    sl = _mm256_mullo_epi16(a, _mm256_add_epi16(_mm256_sub_epi16(sl, dl), m256));
+    sh = _mm256_mullo_epi16(a, _mm256_add_epi16(_mm256_sub_epi16(sh, dh), m256));
+
+    sl = _mm256_and_si256(_mm256_sub_epi16(_mm256_add_epi16(_mm256_srli_epi16(sl, 8), dl), a), mByte);
+    sh = _mm256_and_si256(_mm256_sub_epi16(_mm256_add_epi16(_mm256_srli_epi16(sh, 8), dh), a), mByte);
+
+    return _mm256_packus_epi16(sl, sh);
+}
+
+_FX_AVX2_FUNC_ static void OGE_FX_AVX2_Blt(uint8_t* pDstData, int iDstLineSize,
+                int iDstX, int iDstY,
+                uint8_t* pSrcData, int iSrcLineSize, int iSrcColorKey,
+                int iSrcX, int iSrcY,
+                int iWidth, int iHeight, int iBPP)
+{
+    if (iBPP != 32 || iSrcColorKey == -1)
+    {
+        fxs.Blt(pDstData, iDstLineSize, iDstX, iDstY, pSrcData, iSrcLineSize, iSrcColorKey,
+                iSrcX, iSrcY, iWidth, iHeight, iBPP);
+        return;
+    }
+
+    int iVecWidth = iWidth & ~7;
+
+    if (iVecWidth < iWidth)
+        fxs.Blt(pDstData, iDstLineSize, iDstX + iVecWidth, iDstY, pSrcData, iSrcLineSize, iSrcColorKey,
+                iSrcX + iVecWidth, iSrcY, iWidth - iVecWidth, iHeight, iBPP);
+
+    if (iVecWidth <= 0) return;
+
+    int iLineBytes = iVecWidth << 2;
+
+    pDstData += iDstY * iDstLineSize + iDstX * 4;
+    pSrcData += iSrcY * iSrcLineSize + iSrcX * 4;
+
+    __m256i mSrc, mMask;
+    __m256i mKey = _mm256_set1_epi32(iSrcColorKey);
+
+    while(iHeight > 0)
+    {
+        for(int i=0; i<iLineBytes; i+=32)
+        {
+            mSrc = _mm256_loadu_si256((__m256i*)(pSrcData + i));
+
+            // write only the pixels which are not the colour key
+            mMask = _mm256_xor_si256(_mm256_cmpeq_epi32(mSrc, mKey), _mm256_set1_epi32(-1));
+            _mm256_maskstore_epi32((int*)(pDstData + i), mMask, mSrc);
+        }
+
+        pSrcData += iSrcLineSize;
+        pDstData += iDstLineSize;
+
+        iHeight--;
+    }
+}
+
+_FX_AVX2_FUNC_ static void OGE_FX_AVX2_AlphaBlend(uint8_t* pDstData, int iDstLineSize,
+                int iDstX, int iDstY,
+                uint8_t* pSrcData, int iSrcLineSize, int iSrcColorKey,
+                int iSrcX, int iSrcY,
+                int iWidth, int iHeight, int iBPP, uint8_t iAlpha)
+{
+    if (iBPP != 32)
+    {
+        fxs.AlphaBlend(pDstData, iDstLineSize, iDstX, iDstY, pSrcData, iSrcLineSize, iSrcColorKey,
+                       iSrcX, iSrcY, iWidth, iHeight, iBPP, iAlpha);
+        return;
+    }
+
+    int iVecWidth = iWidth & ~7;
+
+    if (iVecWidth < iWidth)
+        fxs.AlphaBlend(pDstData, iDstLineSize, iDstX + iVecWidth, iDstY, pSrcData, iSrcLineSize, iSrcColorKey,
+                       iSrcX + iVecWidth, iSrcY, iWidth - iVecWidth, iHeight, iBPP, iAlpha);
+
+    if (iVecWidth <= 0) return;
+
+    int iLineBytes = iVecWidth << 2;
+
+    pDstData += iDstY * iDstLineSize + iDstX * 4;
+    pSrcData += iSrcY * iSrcLineSize + iSrcX * 4;
+
+    bool bIsHalfAlpha = iAlpha == 128;
+	bool bNoColorKey = iSrcColorKey == -1;
+
+    __m256i mSrc, mDst, mColor;
+
+    __m256i mRGB = _mm256_set1_epi32(~alphamask);
+    __m256i mKey = _mm256_set1_epi32(iSrcColorKey);
+    __m256i mHalf = _mm256_set1_epi32(0xFEFEFE);
+    __m256i mAlpha = _mm256_set1_epi16(iAlpha);
+
+    while(iHeight > 0)
+    {
+        for(int i=0; i<iLineBytes; i+=32)
+        {
+            mSrc = _mm256_loadu_si256((__m256i*)(pSrcData + i));
+            mDst = _mm256_loadu_si256((__m256i*)(pDstData + i));
+
+            if (bIsHalfAlpha)
+                mColor = _mm256_add_epi32(_mm256_srli_epi32(_mm256_and_si256(mSrc, mHalf), 1),
+                                          _mm256_srli_epi32(_mm256_and_si256(mDst, mHalf), 1));
+            else
+                mColor = _mm256_and_si256(FX_AVX2_Blend8(mSrc, mDst, mAlpha), mRGB);
+
+            if (!bNoColorKey) mColor = FX_AVX2_Select(_mm256_cmpeq_epi32(mSrc, mKey), mDst, mColor);
+
+            _mm256_storeu_si256((__m256i*)(pDstData + i), mColor);
+        }
+
+        pSrcData += iSrcLineSize;
+        pDstData += iDstLineSize;
+
+        iHeight--;
+    }
+}
+
+_FX_AVX2_FUNC_ static void OGE_FX_AVX2_LightMaskBlend(uint8_t* pDstData, int iDstLineSize,
+                int iDstX, int iDstY,
+                uint8_t* pSrcData, int iSrcLineSize,
+                int iSrcX, int iSrcY,
+                int iWidth, int iHeight, int iBPP)
+{
+    if (iBPP != 32)
+    {
+        fxs.LightMaskBlend(pDstData, iDstLineSize, iDstX, iDstY, pSrcData, iSrcLineSize,
+                           iSrcX, iSrcY, iWidth, iHeight, iBPP);
+        return;
+    }
+
+    int iVecWidth = iWidth & ~7;
+
+    if (iVecWidth < iWidth)
+        fxs.LightMaskBlend(pDstData, iDstLineSize, iDstX + iVecWidth, iDstY, pSrcData, iSrcLineSize,
+                           iSrcX + iVecWidth, iSrcY, iWidth - iVecWidth, iHeight, iBPP);
+
+    if (iVecWidth <= 0) return;
+
+    int iLineBytes = iVecWidth << 2;
+
+    pDstData += iDstY * iDstLineSize + iDstX * 4;
+    pSrcData += iSrcY * iSrcLineSize + iSrcX * 4;
+
+    __m256i mSrc, mDst, mAmount, al, ah, dl, dh;
+
+    __m256i mZero = _mm256_setzero_si256();
+    __m256i mRGB = _mm256_set1_epi32(~alphamask);
+    __m256i mByte = _mm256_set1_epi32(0xff);
+
+    while(iHeight > 0)
+    {
+        for(int i=0; i<iLineBytes; i+=32)
+        {
+            mSrc = _mm256_loadu_si256((__m256i*)(pSrcData + i));
+            mDst = _mm256_loadu_si256((__m256i*)(pDstData + i));
+
+            mAmount = _mm256_and_si256(_mm256_srli_epi32(mSrc, blueoffset), mByte);
+            mAmount = _mm256_or_si256(mAmount, _mm256_slli_epi32(mAmount, 8));
+            mAmount = _mm256_or_si256(mAmount, _mm256_slli_epi32(mAmount, 16));
+
+            al = _mm256_unpacklo_epi8(mAmount, mZero);
+            ah = _mm256_unpackhi_epi8(mAmount, mZero);
+            dl = _mm256_unpacklo_epi8(mDst, mZero);
+            dh = _mm256_unpackhi_epi8(mDst, mZero);
+
+            dl = _mm256_sub_epi16(dl, _mm256_srli_epi16(_mm256_mullo_epi16(al, dl), 8));
+            dh = _mm256_sub_epi16(dh, _mm256_srli_epi16(_mm256_mullo_epi16(ah, dh), 8));
+
+            _mm256_storeu_si256((__m256i*)(pDstData + i), _mm256_and_si256(_mm256_packus_epi16(dl, dh), mRGB));
+        }
+
+        pSrcData += iSrcLineSize;
+        pDstData += iDstLineSize;
+
+        iHeight--;
+    }
+}
+
+_FX_AVX2_FUNC_ static void OGE_FX_AVX2_BltWithColor(uint8_t* pDstData, int iDstLineSize,
+                int iDstX, int iDstY,
+                uint8_t* pSrcData, int iSrcLineSize, int iSrcColorKey,
+                int iSrcX, int iSrcY,
+                int iWidth, int iHeight, int iBPP, int iColor, int iAlpha)
+{
+    if (iBPP != 32)
+    {
+        fxs.BltWithColor(pDstData, iDstLineSize, iDstX, iDstY, pSrcData, iSrcLineSize, iSrcColorKey,
+                         iSrcX, iSrcY, iWidth, iHeight, iBPP, iColor, iAlpha);
+        return;
+    }
+
+    int iVecWidth = iWidth & ~7;
+
+    if (iVecWidth < iWidth)
+        fxs.BltWithColor(pDstData, iDstLineSize, iDstX + iVecWidth, iDstY, pSrcData, iSrcLineSize, iSrcColorKey,
+                         iSrcX + iVecWidth, iSrcY, iWidth - iVecWidth, iHeight, iBPP, iColor, iAlpha);
+
+    if (iVecWidth <= 0) return;
+
+    int iLineBytes = iVecWidth << 2;
+
+    pDstData += iDstY * iDstLineSize + iDstX * 4;
+    pSrcData += iSrcY * iSrcLineSize + iSrcX * 4;
+
+    bool bNoColorKey = iSrcColorKey == -1;
+
+    if(iAlpha > 256) iAlpha = 256;
+	else if(iAlpha < 0) iAlpha = 0;
+
+	iAlpha = 256 - iAlpha;
+
+    __m256i mSrc, mColor;
+
+    __m256i mRGB = _mm256_set1_epi32(~alphamask);
+    __m256i mKey = _mm256_set1_epi32(iSrcColorKey);
+    __m256i mAlpha = _mm256_set1_epi16(iAlpha);
+    __m256i c32 = _mm256_set1_epi32(iColor);
+
+    while(iHeight > 0)
+    {
+        for(int i=0; i<iLineBytes; i+=32)
+        {
+            mSrc = _mm256_loadu_si256((__m256i*)(pSrcData + i));
+
+            mColor = _mm256_and_si256(FX_AVX2_Blend8(mSrc, c32, mAlpha), mRGB);
+
+            if (!bNoColorKey)
+                mColor = FX_AVX2_Select(_mm256_cmpeq_epi32(mSrc, mKey), _mm256_loadu_si256((__m256i*)(pDstData + i)), mColor);
+
+            _mm256_storeu_si256((__m256i*)(pDstData + i), mColor);
+        }
+
+        pSrcData += iSrcLineSize;
+        pDstData += iDstLineSize;
+
+        iHeight--;
+    }
+}
+
+/*================= Setup =======================*/
+
+int OGE_FX_SSE_Check()
+{
+    int iBackend = _OGE_FX_BACKEND_C_;
+
+#if defined(__GNUC__)
+
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse2")) iBackend = _OGE_FX_BACKEND_SSE2_;
+    if (__builtin_cpu_supports("avx2")) iBackend = _OGE_FX_BACKEND_AVX2_;
+
+#elif defined(_MSC_VER)
+
+    int info[4];
+
+    iBackend = _OGE_FX_BACKEND_SSE2_; // we are built with sse2 already
+
+    __cpuid(info, 0);
+    int iMaxId = info[0];
+
+    __cpuid(info, 1);
+    bool bAVX = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0; // osxsave + avx
+
+    if (bAVX && iMaxId >= 7 && (_xgetbv(0) & 6) == 6)
+    {
+        __cpuidex(info, 7, 0);
+        if (info[1] & (1 << 5)) iBackend = _OGE_FX_BACKEND_AVX2_;
+    }
+
+#endif
+
+    return iBackend;
+}
+
+void OGE_FX_SSE_Setup(CogeFXKernels* pKernels, const CogeFXKernels* pFallback, int iBackend)
+{
+    fxc = *pFallback;
+    fxs = *pFallback;
+
+    if (iBackend < _OGE_FX_BACKEND_SSE2_) return;
+
+    fxs.CopyRect       = OGE_FX_SSE_CopyRect;
+    fxs.Blt            = OGE_FX_SSE_Blt;
+    fxs.SubLight       = OGE_FX_SSE_SubLight;
+    fxs.Lightness      = OGE_FX_SSE_Lightness;
+    fxs.ChangeColorRGB = OGE_FX_SSE_ChangeColorRGB;
+    fxs.BltLightness   = OGE_FX_SSE_BltLightness;
+    fxs.BltChangedRGB  = OGE_FX_SSE_BltChangedRGB;
+    fxs.AlphaBlend     = OGE_FX_SSE_AlphaBlend;
+    fxs.LightMaskBlend = OGE_FX_SSE_LightMaskBlend;
+    fxs.BltWithColor   = OGE_FX_SSE_BltWithColor;
+    fxs.BltPremultiplied = OGE_FX_SSE_BltPremultiplied;
+
+    *pKernels = fxs;
+
+    if (iBackend < _OGE_FX_BACKEND_AVX2_) return;
+
+    pKernels->Blt            = OGE_FX_AVX2_Blt;
+    pKernels->AlphaBlend     = OGE_FX_AVX2_AlphaBlend;
+    pKernels->LightMaskBlend = OGE_FX_AVX2_LightMaskBlend;
+    pKernels->BltWithColor   = OGE_FX_AVX2_BltWithColor;
+
+}
+
+#endif // __FX_WITH_SSE__
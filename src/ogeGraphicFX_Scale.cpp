@@ -0,0 +1,610 @@
+/*
+-----------------------------------------------------------------------------
+This source file is part of Open Game Engine 2D.
+It is licensed under the terms of the MIT license.
+For the latest info, see http://oge2d.sourceforge.net
+
+Copyright (c) 2010-2012 Lin Jia Jun (Joe Lam)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-----------------------------------------------------------------------------
+*/
+
+// smooth scaling with precomputed weights (bilinear to grow, box filter to shrink), shared by the c and the mmx backends
+
+#include "ogeGraphicFX_Kernel.h"
+#include <cstring>
+
+#ifdef __FX_WITH_SSE__
+#include <emmintrin.h>
+#endif
+
+// the byte of the alpha (or of the coverage of a color key) in a pixel of the working rows
+#if defined(__MACOSX__) || defined(__IPHONE__)
+static const uint32_t scalealphamask = 0x000000ff;
+static const uint32_t scalecoverage  = 0x00000001;
+static const int scalecolorshift = 8;
+#else
+static const uint32_t scalealphamask = 0xff000000;
+static const uint32_t scalecoverage  = 0x01000000;
+static const int scalecolorshift = 0;
+#endif
+
+// the weights of a row sum up to 128 (so a channel times them fits in a short), the weights of a column to 256
+#define _FX_SCALE_ROW_TOTAL_    128
+#define _FX_SCALE_COLUMN_TOTAL_ 256
+#define _FX_SCALE_SHIFT_        15 // of 128 * 256
+
+// iTaps weights for each dst pixel of an axis, from the src pixel pStart[i] on (each weight repeated iRepeat times)
+struct CogeFXScaleAxis
+{
+    int iTaps;
+    int iRepeat;
+    int* pStart;
+    int16_t* pWeights;
+};
+
+static void OGE_FX_PrepareScaleAxis(CogeFXScaleAxis* pAxis, int iSrcSize, int iDstSize, int iFrom, int iCount,
+                int iTotal, int iRepeat)
+{
+    int iTaps = iSrcSize > iDstSize ? (iSrcSize + iDstSize - 1) / iDstSize + 1 : 2;
+    if (iTaps > iSrcSize) iTaps = iSrcSize;
+
+    pAxis->iTaps = iTaps;
+    pAxis->iRepeat = iRepeat;
+    pAxis->pStart = new int[iCount];
+    pAxis->pWeights = new int16_t[iCount * iTaps * iRepeat];
+
+    int* pWeights = new int[iTaps];
+
+    for(int i=0; i<iCount; i++)
+    {
+        int d = iFrom + i;
+        int iStart = 0;
+        int n = 0;
+
+        memset(pWeights, 0, iTaps * sizeof(int));
+
+        if (iSrcSize > iDstSize)
+        {
+            // box filter: the dst pixel covers [d, d + 1) * iSrcSize / iDstSize of the src,
+            // a src pixel weighs as much as its part of it (counted in 1 / iDstSize of a pixel)
+            int iFromPos = d * iSrcSize;
+            int iToPos = iFromPos + iSrcSize;
+
+            iStart = iFromPos / iDstSize;
+            n = (iToPos - 1) / iDstSize - iStart + 1;
+
+            int iCovered = 0;
+            int iDone = 0;
+
+            for(int k=0; k<n; k++)
+            {
+                int iLow = (iStart + k) * iDstSize;
+                int iHigh = iLow + iDstSize;
+
+                if (iLow < iFromPos) iLow = iFromPos;
+                if (iHigh > iToPos) iHigh = iToPos;
+
+                // the rounding errors do not add up, the weights always sum up to iTotal
+                iCovered += iHigh - iLow;
+                int iNext = (int)((int64_t)iCovered * iTotal / iSrcSize);
+
+                pWeights[k] = iNext - iDone;
+                iDone = iNext;
+            }
+        }
+        else
+        {
+            // bilinear: the centre of the dst pixel in the src (16.16), the centre of a src pixel is at + 0.5
+            int p = (int)(((int64_t)(2 * d + 1) * iSrcSize << 16) / (2 * iDstSize)) - 32768;
+
+            if (p <= 0 || (p >> 16) >= iSrcSize - 1)
+            {
+                iStart = p <= 0 ? 0 : iSrcSize - 1;
+                pWeights[0] = iTotal;
+                n = 1;
+            }
+            else
+            {
+                int f = ((p & 0xffff) * iTotal + 32768) >> 16;
+
+                iStart = p >> 16;
+                pWeights[0] = iTotal - f;
+                pWeights[1] = f;
+                n = 2;
+            }
+        }
+
+        // all the taps have to be in the src
+        if (iStart + iTaps > iSrcSize)
+        {
+            int iShift = iStart + iTaps - iSrcSize;
+
+            for(int k=n-1; k>=0; k--) pWeights[k + iShift] = pWeights[k];
+            for(int k=0; k<iShift; k++) pWeights[k] = 0;
+
+            iStart -= iShift;
+        }
+
+        pAxis->pStart[i] = iStart;
+
+        int16_t* pAxisWeights = pAxis->pWeights + i * iTaps * iRepeat;
+
+        for(int k=0; k<iTaps; k++)
+        {
+            for(int r=0; r<iRepeat; r++) *pAxisWeights++ = (int16_t) pWeights[k];
+        }
+    }
+
+    delete [] pWeights;
+}
+
+static void OGE_FX_FreeScaleAxis(CogeFXScaleAxis* pAxis)
+{
+    delete [] pAxis->pStart;
+    delete [] pAxis->pWeights;
+}
+
+struct CogeFXScaleTask
+{
+    uint8_t* pDstData;
+    int iDstLineSize;
+    int iDstX;
+    int iDstY;
+
+    uint8_t* pSrcData;
+    int iSrcLineSize;
+    int iSrcColorKey;
+    int iSrcX;
+    int iSrcY;
+
+    int iWidth;
+    int iBPP;
+
+    CogeFXScaleAxis* pAxisX;
+    CogeFXScaleAxis* pAxisY;
+
+    bool bUseSSE2;
+};
+
+// a src row as 32 bit pixels, the color key gets zero and the other pixels get a coverage of one if there is a key
+static void OGE_FX_ScaleExpand(uint32_t* pPixels, const uint8_t* pLine, int iCount, int iBPP, int iColorKey,
+                bool bUseSSE2)
+{
+    if (iBPP == 16)
+    {
+        const uint16_t* pSrc = (const uint16_t*) pLine;
+
+        for(int x=0; x<iCount; x++)
+        {
+            int iPixel = pSrc[x];
+
+            if (iPixel == iColorKey)
+            {
+                pPixels[x] = 0;
+                continue;
+            }
+
+            uint32_t r = iPixel >> 11;
+            uint32_t g = (iPixel >> 5) & 0x3f;
+            uint32_t b = iPixel & 0x1f;
+
+            pPixels[x] = ((((r << 3) | (r >> 2)) << 16) | (((g << 2) | (g >> 4)) << 8) | ((b << 3) | (b >> 2)))
+                         << scalecolorshift;
+
+            if (iColorKey != -1) pPixels[x] |= scalecoverage;
+        }
+    }
+    else
+    {
+        const uint32_t* pSrc = (const uint32_t*) pLine;
+
+        if (iColorKey == -1)
+        {
+            memcpy(pPixels, pSrc, iCount * 4);
+            return;
+        }
+
+        int x = 0;
+
+#ifdef __FX_WITH_SSE__
+        if (bUseSSE2)
+        {
+            __m128i mKey = _mm_set1_epi32(iColorKey);
+            __m128i mColor = _mm_set1_epi32(~scalealphamask);
+            __m128i mCoverage = _mm_set1_epi32(scalecoverage);
+
+            for(; x+4<=iCount; x+=4)
+            {
+                __m128i v = _mm_loadu_si128((const __m128i*)(pSrc + x));
+                __m128i mIsKey = _mm_cmpeq_epi32(v, mKey);
+
+                v = _mm_or_si128(_mm_and_si128(v, mColor), mCoverage);
+                _mm_storeu_si128((__m128i*)(pPixels + x), _mm_andnot_si128(mIsKey, v));
+            }
+        }
+#endif
+
+        for(; x<iCount; x++)
+        {
+            uint32_t iPixel = pSrc[x];
+
+            if (iPixel == (uint32_t) iColorKey) pPixels[x] = 0;
+            else pPixels[x] = (iPixel & ~scalealphamask) | scalecoverage;
+        }
+    }
+}
+
+// the horizontal pass of a src row, 4 channels (sums of the weights times the bytes) for each dst pixel
+static void OGE_FX_ScaleRow(int16_t* pRow, const uint32_t* pPixels, const CogeFXScaleAxis* pAxis, int iWidth,
+                bool bUseSSE2)
+{
+    int iTaps = pAxis->iTaps;
+    int iFirst = pAxis->pStart[0];
+
+    int x = 0;
+
+#ifdef __FX_WITH_SSE__
+    if (bUseSSE2)
+    {
+        __m128i mZero = _mm_setzero_si128();
+
+        // two pixels at once, the weights of a tap are already 4 shorts for each of them
+        for(; x+2<=iWidth; x+=2)
+        {
+            const uint32_t* p0 = pPixels + pAxis->pStart[x] - iFirst;
+            const uint32_t* p1 = pPixels + pAxis->pStart[x + 1] - iFirst;
+            const int16_t* w0 = pAxis->pWeights + x * iTaps * 4;
+            const int16_t* w1 = w0 + iTaps * 4;
+
+            __m128i mSum = _mm_setzero_si128();
+
+            for(int k=0; k<iTaps; k++)
+            {
+                __m128i mPixels = _mm_unpacklo_epi32(_mm_cvtsi32_si128(p0[k]), _mm_cvtsi32_si128(p1[k]));
+                __m128i mWeights = _mm_unpacklo_epi64(_mm_loadl_epi64((const __m128i*)(w0 + k * 4)),
+                                                      _mm_loadl_epi64((const __m128i*)(w1 + k * 4)));
+
+                mSum = _mm_add_epi16(mSum, _mm_mullo_epi16(_mm_unpacklo_epi8(mPixels, mZero), mWeights));
+            }
+
+            _mm_storeu_si128((__m128i*)(pRow + x * 4), mSum);
+        }
+    }
+#endif
+
+    for(; x<iWidth; x++)
+    {
+        const uint32_t* p = pPixels + pAxis->pStart[x] - iFirst;
+        const int16_t* w = pAxis->pWeights + x * iTaps * 4;
+
+        int s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+
+        for(int k=0; k<iTaps; k++)
+        {
+            uint32_t c = p[k];
+            int iWeight = w[k * 4];
+
+            s0 += (c & 0xff) * iWeight;
+            s1 += ((c >> 8) & 0xff) * iWeight;
+            s2 += ((c >> 16) & 0xff) * iWeight;
+            s3 += (c >> 24) * iWeight;
+        }
+
+        int16_t* pSum = pRow + x * 4;
+
+        pSum[0] = s0; pSum[1] = s1; pSum[2] = s2; pSum[3] = s3;
+    }
+}
+
+// the vertical pass of a dst row, the sums of the weights times the horizontal sums (4 for each dst pixel)
+static void OGE_FX_ScaleSum(int32_t* pSums, int16_t** pRows, const int* pWeights, int iTaps, int iCount,
+                bool bUseSSE2)
+{
+    int i = 0;
+
+#ifdef __FX_WITH_SSE__
+    if (bUseSSE2)
+    {
+        __m128i mZero = _mm_setzero_si128();
+
+        for(; i+8<=iCount; i+=8)
+        {
+            __m128i mLow = _mm_setzero_si128();
+            __m128i mHigh = _mm_setzero_si128();
+
+            // two rows at once, madd gives w0 * a + w1 * b for each pair of shorts
+            for(int k=0; k<iTaps; k+=2)
+            {
+                __m128i a = _mm_loadu_si128((const __m128i*)(pRows[k] + i));
+                __m128i b = k + 1 < iTaps ? _mm_loadu_si128((const __m128i*)(pRows[k + 1] + i)) : mZero;
+                int iWeight1 = k + 1 < iTaps ? pWeights[k + 1] : 0;
+
+                __m128i mWeights = _mm_set1_epi32((iWeight1 << 16) | (pWeights[k] & 0xffff));
+
+                mLow = _mm_add_epi32(mLow, _mm_madd_epi16(_mm_unpacklo_epi16(a, b), mWeights));
+                mHigh = _mm_add_epi32(mHigh, _mm_madd_epi16(_mm_unpackhi_epi16(a, b), mWeights));
+            }
+
+            _mm_storeu_si128((__m128i*)(pSums + i), mLow);
+            _mm_storeu_si128((__m128i*)(pSums + i + 4), mHigh);
+        }
+    }
+#endif
+
+    if (i >= iCount) return;
+
+    // two rows after two others, so the compiler can vectorize the loops
+    for(int k=0; k<iTaps; k+=2)
+    {
+        const int16_t* a = pRows[k];
+        const int16_t* b = pRows[k + 1 < iTaps ? k + 1 : k];
+        int w0 = pWeights[k];
+        int w1 = k + 1 < iTaps ? pWeights[k + 1] : 0;
+
+        if (k == 0)
+        {
+            for(int j=i; j<iCount; j++) pSums[j] = a[j] * w0 + b[j] * w1;
+        }
+        else
+        {
+            for(int j=i; j<iCount; j++) pSums[j] += a[j] * w0 + b[j] * w1;
+        }
+    }
+}
+
+// the pixels of the sums (as the working rows have them), with a color key the coverage byte gets one if the pixel is
+// mostly covered by the other pixels (then they are averaged), or zero (so it is skipped)
+static void OGE_FX_ScalePixels(uint32_t* pPixels, const int32_t* pSums, int iWidth, bool bColorKey, bool bUseSSE2)
+{
+    int x = 0;
+
+#ifdef __FX_WITH_SSE__
+    if (bUseSSE2)
+    {
+        __m128i mRound = _mm_set1_epi32(1 << (_FX_SCALE_SHIFT_ - 1));
+
+        for(; x+4<=iWidth; x+=4)
+        {
+            const __m128i* s = (const __m128i*)(pSums + x * 4);
+
+            __m128i a = _mm_srai_epi32(_mm_add_epi32(_mm_loadu_si128(s), mRound), _FX_SCALE_SHIFT_);
+            __m128i b = _mm_srai_epi32(_mm_add_epi32(_mm_loadu_si128(s + 1), mRound), _FX_SCALE_SHIFT_);
+            __m128i c = _mm_srai_epi32(_mm_add_epi32(_mm_loadu_si128(s + 2), mRound), _FX_SCALE_SHIFT_);
+            __m128i d = _mm_srai_epi32(_mm_add_epi32(_mm_loadu_si128(s + 3), mRound), _FX_SCALE_SHIFT_);
+
+            _mm_storeu_si128((__m128i*)(pPixels + x),
+                             _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d)));
+        }
+    }
+#endif
+
+    // the weights sum up to 1 << _FX_SCALE_SHIFT_, so a channel never gets over 255
+    // (and a coverage gets one from a half on, which is what the color key needs)
+    const int iRound = 1 << (_FX_SCALE_SHIFT_ - 1);
+
+    for(; x<iWidth; x++)
+    {
+        const int32_t* s = pSums + x * 4;
+
+        pPixels[x] = ((uint32_t)((s[0] + iRound) >> _FX_SCALE_SHIFT_)) |
+                     ((uint32_t)((s[1] + iRound) >> _FX_SCALE_SHIFT_) << 8) |
+                     ((uint32_t)((s[2] + iRound) >> _FX_SCALE_SHIFT_) << 16) |
+                     ((uint32_t)((s[3] + iRound) >> _FX_SCALE_SHIFT_) << 24);
+    }
+
+    if (!bColorKey) return;
+
+    // the pixels partly covered by the key, the average of the rest
+    int iCoverageLane = scalecoverage == 1 ? 0 : 3;
+    int iTotal = 1 << _FX_SCALE_SHIFT_;
+
+    for(x=0; x<iWidth; x++)
+    {
+        const int32_t* s = pSums + x * 4;
+
+        int iCoverage = s[iCoverageLane];
+
+        if (iCoverage * 2 < iTotal || iCoverage == iTotal) continue;
+
+        // one division for the three channels
+        uint32_t iScale = ((uint32_t)1 << 31) / iCoverage;
+
+        uint32_t iPixel = scalecoverage;
+
+        for(int k=0; k<4; k++)
+        {
+            if (k == iCoverageLane) continue;
+            iPixel |= (uint32_t)(((uint64_t)s[k] * iScale + (1 << 30)) >> 31) << (k * 8);
+        }
+
+        pPixels[x] = iPixel;
+    }
+}
+
+static void OGE_FX_ScaleBand(void* pTask, int iFromRow, int iToRow)
+{
+    CogeFXScaleTask* t = (CogeFXScaleTask*) pTask;
+
+    CogeFXScaleAxis* pAxisX = t->pAxisX;
+    CogeFXScaleAxis* pAxisY = t->pAxisY;
+
+    int iWidth = t->iWidth;
+    int iPixelSize = t->iBPP >> 3;
+    int iTapsY = pAxisY->iTaps;
+    bool bColorKey = t->iSrcColorKey != -1;
+
+    // the src columns which the band reads
+    int iFirst = pAxisX->pStart[0];
+    int iSrcCount = pAxisX->pStart[iWidth - 1] + pAxisX->iTaps - iFirst;
+
+    // the horizontal sums of the src rows, a ring with room for the taps of a dst row (the src rows only go forward)
+    int16_t* pRowData = new int16_t[iWidth * 4 * iTapsY];
+    int* pRowIndex = new int[iTapsY];
+
+    for(int k=0; k<iTapsY; k++) pRowIndex[k] = -1;
+
+    int16_t** pRows = new int16_t*[iTapsY];
+    int* pWeights = new int[iTapsY];
+
+    uint32_t* pPixels = new uint32_t[iSrcCount > iWidth ? iSrcCount : iWidth];
+    int32_t* pSums = new int32_t[iWidth * 4];
+
+    const uint8_t* pSrc = t->pSrcData + t->iSrcY * t->iSrcLineSize + (t->iSrcX + iFirst) * iPixelSize;
+
+    for(int y=iFromRow; y<iToRow; y++)
+    {
+        int iStart = pAxisY->pStart[y];
+        const int16_t* w = pAxisY->pWeights + y * iTapsY;
+
+        // only the rows with some weight
+        int iTaps = 0;
+
+        for(int k=0; k<iTapsY; k++)
+        {
+            if (w[k] == 0) continue;
+
+            int iSrcRow = iStart + k;
+            int iSlot = iSrcRow % iTapsY;
+
+            int16_t* pRow = pRowData + iSlot * iWidth * 4;
+
+            if (pRowIndex[iSlot] != iSrcRow)
+            {
+                OGE_FX_ScaleExpand(pPixels, pSrc + iSrcRow * t->iSrcLineSize, iSrcCount, t->iBPP, t->iSrcColorKey,
+                                   t->bUseSSE2);
+                OGE_FX_ScaleRow(pRow, pPixels, pAxisX, iWidth, t->bUseSSE2);
+                pRowIndex[iSlot] = iSrcRow;
+            }
+
+            pRows[iTaps] = pRow;
+            pWeights[iTaps] = w[k];
+            iTaps++;
+        }
+
+        OGE_FX_ScaleSum(pSums, pRows, pWeights, iTaps, iWidth * 4, t->bUseSSE2);
+        OGE_FX_ScalePixels(pPixels, pSums, iWidth, bColorKey, t->bUseSSE2);
+
+        uint8_t* pLine = t->pDstData + (t->iDstY + y) * t->iDstLineSize + t->iDstX * iPixelSize;
+
+        if (t->iBPP == 16)
+        {
+            uint16_t* pDst = (uint16_t*) pLine;
+
+            for(int x=0; x<iWidth; x++)
+            {
+                uint32_t iPixel = pPixels[x];
+                if (bColorKey && (iPixel & scalealphamask) == 0) continue;
+
+                iPixel >>= scalecolorshift;
+
+                pDst[x] = ((iPixel >> 8) & 0xf800) | ((iPixel >> 5) & 0x07e0) | ((iPixel >> 3) & 0x001f);
+            }
+        }
+        else if (bColorKey)
+        {
+            uint32_t* pDst = (uint32_t*) pLine;
+
+            int x = 0;
+
+#ifdef __FX_WITH_SSE__
+            if (t->bUseSSE2)
+            {
+                __m128i mAlpha = _mm_set1_epi32(scalealphamask);
+                __m128i mZero = _mm_setzero_si128();
+
+                for(; x+4<=iWidth; x+=4)
+                {
+                    __m128i v = _mm_loadu_si128((const __m128i*)(pPixels + x));
+                    __m128i d = _mm_loadu_si128((const __m128i*)(pDst + x));
+                    __m128i mSkip = _mm_cmpeq_epi32(_mm_and_si128(v, mAlpha), mZero);
+
+                    v = _mm_or_si128(_mm_and_si128(d, mAlpha), _mm_andnot_si128(mAlpha, v));
+                    _mm_storeu_si128((__m128i*)(pDst + x), _mm_or_si128(_mm_and_si128(mSkip, d), _mm_andnot_si128(mSkip, v)));
+                }
+            }
+#endif
+
+            // the alpha byte of dst is kept
+            for(; x<iWidth; x++)
+            {
+                uint32_t iPixel = pPixels[x];
+                if ((iPixel & scalealphamask) == 0) continue;
+
+                pDst[x] = (pDst[x] & scalealphamask) | (iPixel & ~scalealphamask);
+            }
+        }
+        else memcpy(pLine, pPixels, iWidth * 4);
+    }
+
+    delete [] pSums;
+    delete [] pPixels;
+    delete [] pWeights;
+    delete [] pRows;
+    delete [] pRowIndex;
+    delete [] pRowData;
+}
+
+void OGE_FX_BltScale(uint8_t* pDstData, int iDstLineSize,
+                int iDstX, int iDstY, int iDstWidth, int iDstHeight,
+                int iClipX, int iClipY, int iClipWidth, int iClipHeight,
+                uint8_t* pSrcData, int iSrcLineSize, int iSrcColorKey,
+                int iSrcX, int iSrcY, int iSrcWidth, int iSrcHeight, int iBPP)
+{
+    if (iDstWidth <= 0 || iDstHeight <= 0 || iSrcWidth <= 0 || iSrcHeight <= 0 || (iBPP != 16 && iBPP != 32)) return;
+
+    if (iClipX < 0) { iClipWidth += iClipX; iClipX = 0; }
+    if (iClipY < 0) { iClipHeight += iClipY; iClipY = 0; }
+    if (iClipX + iClipWidth > iDstWidth) iClipWidth = iDstWidth - iClipX;
+    if (iClipY + iClipHeight > iDstHeight) iClipHeight = iDstHeight - iClipY;
+
+    if (iClipWidth <= 0 || iClipHeight <= 0) return;
+
+    CogeFXScaleAxis axisX;
+    CogeFXScaleAxis axisY;
+
+    OGE_FX_PrepareScaleAxis(&axisX, iSrcWidth, iDstWidth, iClipX, iClipWidth, _FX_SCALE_ROW_TOTAL_, 4);
+    OGE_FX_PrepareScaleAxis(&axisY, iSrcHeight, iDstHeight, iClipY, iClipHeight, _FX_SCALE_COLUMN_TOTAL_, 1);
+
+    CogeFXScaleTask task;
+
+    task.pDstData = pDstData;
+    task.iDstLineSize = iDstLineSize;
+    task.iDstX = iDstX + iClipX;
+    task.iDstY = iDstY + iClipY;
+    task.pSrcData = pSrcData;
+    task.iSrcLineSize = iSrcLineSize;
+    task.iSrcColorKey = iSrcColorKey;
+    task.iSrcX = iSrcX;
+    task.iSrcY = iSrcY;
+    task.iWidth = iClipWidth;
+    task.iBPP = iBPP;
+    task.pAxisX = &axisX;
+    task.pAxisY = &axisY;
+    task.bUseSSE2 = OGE_FX_GetBackend() >= _OGE_FX_BACKEND_SSE2_;
+
+    bool bUseThreads = OGE_FX_GetThreads() > 1 && iClipWidth * iClipHeight >= OGE_FX_GetThreadPixels();
+
+    if (!bUseThreads || !OGE_FX_RunBands(OGE_FX_ScaleBand, &task, iClipHeight))
+        OGE_FX_ScaleBand(&task, 0, iClipHeight);
+
+    OGE_FX_FreeScaleAxis(&axisX);
+    OGE_FX_FreeScaleAxis(&axisY);
+}
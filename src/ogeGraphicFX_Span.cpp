@@ -0,0 +1,313 @@
+/*
+-----------------------------------------------------------------------------
+This source file is part of Open Game Engine 2D.
+It is licensed under the terms of the MIT license.
+For the latest info, see http://oge2d.sourceforge.net
+
+Copyright (c) 2010-2012 Lin Jia Jun (Joe Lam)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-----------------------------------------------------------------------------
+*/
+
+// run-length encoded color key images, shared by the c and the mmx backends
+
+#include "ogeGraphicFX_Kernel.h"
+#include <cstring>
+
+// one opaque run of a row
+struct CogeFXSpan
+{
+    int iX;
+    int iLength;
+    int iOffset;  // offset of the first pixel in pPixels (in pixels)
+};
+
+struct CogeFXSpans
+{
+    int iWidth;
+    int iHeight;
+    int iBPP;
+    int iPixelSize;
+
+    int*        pRows;   // the spans of row y are pSpans[pRows[y]] ~ pSpans[pRows[y+1]-1]
+    CogeFXSpan* pSpans;
+    uint8_t*    pPixels; // all the opaque pixels, row by row
+
+    int iSpanCount;
+    int iPixelCount;
+};
+
+enum ogeFXSpanOp
+{
+    _FX_SPAN_BLT_ = 0,
+    _FX_SPAN_ALPHABLEND_,
+    _FX_SPAN_BLTLIGHTNESS_,
+    _FX_SPAN_BLTCHANGEDRGB_,
+    _FX_SPAN_BLTWITHCOLOR_
+};
+
+static bool OGE_FX_IsKeyPixel(uint8_t* p, int iBPP, int iColorKey)
+{
+    if (iBPP == 16) return *((uint16_t*)p) == (uint16_t)(iColorKey & 0x0000ffff);
+    else return *((uint32_t*)p) == (uint32_t)iColorKey;
+}
+
+CogeFXSpans* OGE_FX_BuildSpans(uint8_t* pSrcData, int iSrcLineSize,
+                               int iWidth, int iHeight, int iBPP, int iColorKey)
+{
+    if (iBPP != 16 && iBPP != 32) return NULL;
+    if (iWidth <= 0 || iHeight <= 0 || iColorKey == -1) return NULL;
+
+    int iPixelSize = iBPP >> 3;
+
+    // count them first ...
+    int iSpanCount = 0;
+    int iPixelCount = 0;
+
+    for(int y=0; y<iHeight; y++)
+    {
+        uint8_t* p = pSrcData + y * iSrcLineSize;
+        bool bInSpan = false;
+
+        for(int x=0; x<iWidth; x++)
+        {
+            bool bOpaque = !OGE_FX_IsKeyPixel(p, iBPP, iColorKey);
+            if (bOpaque)
+            {
+                if (!bInSpan) iSpanCount++;
+                iPixelCount++;
+            }
+            bInSpan = bOpaque;
+            p += iPixelSize;
+        }
+    }
+
+    CogeFXSpans* pSpans = new CogeFXSpans();
+
+    pSpans->iWidth = iWidth;
+    pSpans->iHeight = iHeight;
+    pSpans->iBPP = iBPP;
+    pSpans->iPixelSize = iPixelSize;
+    pSpans->iSpanCount = iSpanCount;
+    pSpans->iPixelCount = iPixelCount;
+
+    pSpans->pRows = new int[iHeight + 1];
+    pSpans->pSpans = iSpanCount > 0 ? new CogeFXSpan[iSpanCount] : NULL;
+    pSpans->pPixels = iPixelCount > 0 ? new uint8_t[iPixelCount * iPixelSize] : NULL;
+
+    // then fill them
+    int iSpan = 0;
+    int iOffset = 0;
+
+    for(int y=0; y<iHeight; y++)
+    {
+        uint8_t* pLine = pSrcData + y * iSrcLineSize;
+
+        pSpans->pRows[y] = iSpan;
+
+        int x = 0;
+        while (x < iWidth)
+        {
+            while (x < iWidth && OGE_FX_IsKeyPixel(pLine + x * iPixelSize, iBPP, iColorKey)) x++;
+            if (x >= iWidth) break;
+
+            int iStart = x;
+            while (x < iWidth && !OGE_FX_IsKeyPixel(pLine + x * iPixelSize, iBPP, iColorKey)) x++;
+
+            CogeFXSpan* pSpan = &pSpans->pSpans[iSpan++];
+            pSpan->iX = iStart;
+            pSpan->iLength = x - iStart;
+            pSpan->iOffset = iOffset;
+
+            memcpy(pSpans->pPixels + iOffset * iPixelSize, pLine + iStart * iPixelSize, pSpan->iLength * iPixelSize);
+
+            iOffset += pSpan->iLength;
+        }
+    }
+
+    pSpans->pRows[iHeight] = iSpan;
+
+    return pSpans;
+}
+
+void OGE_FX_FreeSpans(CogeFXSpans* pSpans)
+{
+    if (pSpans == NULL) return;
+
+    delete[] pSpans->pPixels;
+    delete[] pSpans->pSpans;
+    delete[] pSpans->pRows;
+
+    delete pSpans;
+}
+
+int OGE_FX_GetSpansSize(CogeFXSpans* pSpans)
+{
+    if (pSpans == NULL) return 0;
+
+    return sizeof(CogeFXSpans) + (pSpans->iHeight + 1) * sizeof(int)
+           + pSpans->iSpanCount * sizeof(CogeFXSpan)
+           + pSpans->iPixelCount * pSpans->iPixelSize;
+}
+
+void OGE_FX_UnpackSpans(uint8_t* pDstData, int iDstLineSize,
+                        CogeFXSpans* pSpans, int iColorKey)
+{
+    if (pSpans == NULL) return;
+
+    int iPixelSize = pSpans->iPixelSize;
+
+    for(int y=0; y<pSpans->iHeight; y++)
+    {
+        uint8_t* pLine = pDstData + y * iDstLineSize;
+
+        if (pSpans->iBPP == 16)
+        {
+            uint16_t* pw = (uint16_t*) pLine;
+            for(int x=0; x<pSpans->iWidth; x++) pw[x] = iColorKey & 0x0000ffff;
+        }
+        else
+        {
+            uint32_t* pc = (uint32_t*) pLine;
+            for(int x=0; x<pSpans->iWidth; x++) pc[x] = iColorKey;
+        }
+
+        for(int i=pSpans->pRows[y]; i<pSpans->pRows[y+1]; i++)
+        {
+            CogeFXSpan* pSpan = &pSpans->pSpans[i];
+            memcpy(pLine + pSpan->iX * iPixelSize,
+                   pSpans->pPixels + pSpan->iOffset * iPixelSize,
+                   pSpan->iLength * iPixelSize);
+        }
+    }
+}
+
+// runs the op on every opaque run inside the src rect, the runs are sent to the normal kernels without color key
+static void OGE_FX_SpanOp(int iOp, uint8_t* pDstData, int iDstLineSize,
+                int iDstX, int iDstY,
+                CogeFXSpans* pSpans,
+                int iSrcX, int iSrcY,
+                int iWidth, int iHeight,
+                int iParam1 = 0, int iParam2 = 0, int iParam3 = 0)
+{
+    if (pSpans == NULL || iWidth <= 0 || iHeight <= 0) return;
+
+    int iBPP = pSpans->iBPP;
+    int iPixelSize = pSpans->iPixelSize;
+    int iSrcRight = iSrcX + iWidth;
+
+    for(int y=0; y<iHeight; y++)
+    {
+        int iRow = iSrcY + y;
+        int iDstRow = iDstY + y;
+
+        for(int i=pSpans->pRows[iRow]; i<pSpans->pRows[iRow+1]; i++)
+        {
+            CogeFXSpan* pSpan = &pSpans->pSpans[i];
+
+            int iFrom = pSpan->iX;
+            int iTo = pSpan->iX + pSpan->iLength;
+
+            if (iTo <= iSrcX) continue;
+            if (iFrom >= iSrcRight) break;
+
+            if (iFrom < iSrcX) iFrom = iSrcX;
+            if (iTo > iSrcRight) iTo = iSrcRight;
+
+            int iLength = iTo - iFrom;
+            int iDstCol = iDstX + iFrom - iSrcX;
+            uint8_t* pRun = pSpans->pPixels + (pSpan->iOffset + iFrom - pSpan->iX) * iPixelSize;
+
+            switch (iOp)
+            {
+            case _FX_SPAN_BLT_:
+                memcpy(pDstData + iDstRow * iDstLineSize + iDstCol * iPixelSize, pRun, iLength * iPixelSize);
+                break;
+            case _FX_SPAN_ALPHABLEND_:
+                OGE_FX_AlphaBlend(pDstData, iDstLineSize, iDstCol, iDstRow,
+                                  pRun, 0, -1, 0, 0, iLength, 1, iBPP, iParam1);
+                break;
+            case _FX_SPAN_BLTLIGHTNESS_:
+                OGE_FX_BltLightness(pDstData, iDstLineSize, iDstCol, iDstRow,
+                                    pRun, 0, -1, 0, 0, iLength, 1, iBPP, iParam1);
+                break;
+            case _FX_SPAN_BLTCHANGEDRGB_:
+                OGE_FX_BltChangedRGB(pDstData, iDstLineSize, iDstCol, iDstRow,
+                                     pRun, 0, -1, 0, 0, iLength, 1, iBPP, iParam1, iParam2, iParam3);
+                break;
+            case _FX_SPAN_BLTWITHCOLOR_:
+                OGE_FX_BltWithColor(pDstData, iDstLineSize, iDstCol, iDstRow,
+                                    pRun, 0, -1, 0, 0, iLength, 1, iBPP, iParam1, iParam2);
+                break;
+            }
+        }
+    }
+}
+
+void OGE_FX_SpanBlt(uint8_t* pDstData, int iDstLineSize,
+                int iDstX, int iDstY,
+                CogeFXSpans* pSrcSpans,
+                int iSrcX, int iSrcY,
+                int iWidth, int iHeight)
+{
+    OGE_FX_SpanOp(_FX_SPAN_BLT_, pDstData, iDstLineSize, iDstX, iDstY,
+                  pSrcSpans, iSrcX, iSrcY, iWidth, iHeight);
+}
+
+void OGE_FX_SpanAlphaBlend(uint8_t* pDstData, int iDstLineSize,
+                int iDstX, int iDstY,
+                CogeFXSpans* pSrcSpans,
+                int iSrcX, int iSrcY,
+                int iWidth, int iHeight, uint8_t iAlpha)
+{
+    OGE_FX_SpanOp(_FX_SPAN_ALPHABLEND_, pDstData, iDstLineSize, iDstX, iDstY,
+                  pSrcSpans, iSrcX, iSrcY, iWidth, iHeight, iAlpha);
+}
+
+void OGE_FX_SpanBltLightness(uint8_t* pDstData, int iDstLineSize,
+                int iDstX, int iDstY,
+                CogeFXSpans* pSrcSpans,
+                int iSrcX, int iSrcY,
+                int iWidth, int iHeight, int iAmount)
+{
+    OGE_FX_SpanOp(_FX_SPAN_BLTLIGHTNESS_, pDstData, iDstLineSize, iDstX, iDstY,
+                  pSrcSpans, iSrcX, iSrcY, iWidth, iHeight, iAmount);
+}
+
+void OGE_FX_SpanBltChangedRGB(uint8_t* pDstData, int iDstLineSize,
+                int iDstX, int iDstY,
+                CogeFXSpans* pSrcSpans,
+                int iSrcX, int iSrcY,
+                int iWidth, int iHeight,
+                int iRedAmount, int iGreenAmount, int iBlueAmount)
+{
+    OGE_FX_SpanOp(_FX_SPAN_BLTCHANGEDRGB_, pDstData, iDstLineSize, iDstX, iDstY,
+                  pSrcSpans, iSrcX, iSrcY, iWidth, iHeight, iRedAmount, iGreenAmount, iBlueAmount);
+}
+
+void OGE_FX_SpanBltWithColor(uint8_t* pDstData, int iDstLineSize,
+                int iDstX, int iDstY,
+                CogeFXSpans* pSrcSpans,
+                int iSrcX, int iSrcY,
+                int iWidth, int iHeight, int iColor, int iAlpha)
+{
+    OGE_FX_SpanOp(_FX_SPAN_BLTWITHCOLOR_, pDstData, iDstLineSize, iDstX, iDstY,
+                  pSrcSpans, iSrcX, iSrcY, iWidth, iHeight, iColor, iAlpha);
+}
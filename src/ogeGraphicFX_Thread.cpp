@@ -0,0 +1,211 @@
+/*
+-----------------------------------------------------------------------------
+This source file is part of Open Game Engine 2D.
+It is licensed under the terms of the MIT license.
+For the latest info, see http://oge2d.sourceforge.net
+
+Copyright (c) 2010-2012 Lin Jia Jun (Joe Lam)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-----------------------------------------------------------------------------
+*/
+
+#include "ogeGraphicFX_Kernel.h"
+
+#include "SDL.h"
+#include "SDL_thread.h"
+
+#define _OGE_FX_MAX_THREADS_        32
+#define _OGE_FX_DF_THREAD_PIXELS_   (256*256)
+
+struct CogeFXWorker
+{
+    SDL_Thread* pThread;
+    SDL_sem*    pStart;
+    int         iBand;
+};
+
+static CogeFXWorker workers[_OGE_FX_MAX_THREADS_];
+
+static SDL_sem*   pWorkDone = NULL;
+static SDL_mutex* pWorkLock = NULL;
+
+static int iThreadCount = 1;  // the calling thread is counted
+static int iThreadPixels = _OGE_FX_DF_THREAD_PIXELS_;
+
+static volatile bool bQuitWork = false;
+
+// current task
+static ogeFXBandProc pTaskProc = NULL;
+static void* pTaskData = NULL;
+static int iTaskRows = 0;
+static int iTaskBands = 0;
+
+// a band of a task which runs a task of its own does it by itself
+static volatile bool bTaskRunning = false;
+
+static void OGE_FX_RunBand(int iBand)
+{
+    int iFromRow = iTaskRows * iBand / iTaskBands;
+    int iToRow = iTaskRows * (iBand + 1) / iTaskBands;
+
+    if (iToRow > iFromRow) pTaskProc(pTaskData, iFromRow, iToRow);
+}
+
+static int OGE_FX_WorkerProc(void* pData)
+{
+    CogeFXWorker* pWorker = (CogeFXWorker*) pData;
+
+    while(true)
+    {
+        SDL_SemWait(pWorker->pStart);
+
+        if (bQuitWork) break;
+
+        OGE_FX_RunBand(pWorker->iBand);
+
+        SDL_SemPost(pWorkDone);
+    }
+
+    return 0;
+}
+
+static void OGE_FX_StopThreads()
+{
+    bQuitWork = true;
+
+    for(int i=1; i<iThreadCount; i++)
+    {
+        SDL_SemPost(workers[i].pStart);
+        SDL_WaitThread(workers[i].pThread, NULL);
+        SDL_DestroySemaphore(workers[i].pStart);
+
+        workers[i].pThread = NULL;
+        workers[i].pStart = NULL;
+    }
+
+    bQuitWork = false;
+
+    iThreadCount = 1;
+}
+
+int OGE_FX_SetThreads(int iThreads, int iMinPixels)
+{
+#ifdef __FX_WITH_MMX__
+    iThreads = 1; // the mmx kernels are not split into bands
+#endif
+
+    if (pWorkLock == NULL) pWorkLock = SDL_CreateMutex();
+    if (pWorkDone == NULL) pWorkDone = SDL_CreateSemaphore(0);
+
+    if (pWorkLock == NULL || pWorkDone == NULL) return iThreadCount;
+
+    SDL_LockMutex(pWorkLock);
+
+    OGE_FX_StopThreads();
+
+    if (iMinPixels > 0) iThreadPixels = iMinPixels;
+
+    if (iThreads < 0)
+    {
+#if SDL_VERSION_ATLEAST(2,0,0)
+        iThreads = SDL_GetCPUCount();
+#else
+        iThreads = 1;
+#endif
+    }
+
+    if (iThreads > _OGE_FX_MAX_THREADS_) iThreads = _OGE_FX_MAX_THREADS_;
+
+    for(int i=1; i<iThreads; i++)
+    {
+        workers[i].iBand = i;
+        workers[i].pStart = SDL_CreateSemaphore(0);
+        if (workers[i].pStart == NULL) break;
+
+#if SDL_VERSION_ATLEAST(2,0,0)
+        workers[i].pThread = SDL_CreateThread(OGE_FX_WorkerProc, "oge_fx", &workers[i]);
+#else
+        workers[i].pThread = SDL_CreateThread(OGE_FX_WorkerProc, &workers[i]);
+#endif
+
+        if (workers[i].pThread == NULL)
+        {
+            SDL_DestroySemaphore(workers[i].pStart);
+            workers[i].pStart = NULL;
+            break;
+        }
+
+        iThreadCount = i + 1;
+    }
+
+    SDL_UnlockMutex(pWorkLock);
+
+    return iThreadCount;
+}
+
+int OGE_FX_GetThreads()
+{
+    return iThreadCount;
+}
+
+int OGE_FX_GetThreadPixels()
+{
+    return iThreadPixels;
+}
+
+bool OGE_FX_RunBands(ogeFXBandProc pProc, void* pTask, int iRows)
+{
+    if (iThreadCount <= 1 || iRows <= 1 || pWorkLock == NULL || bTaskRunning) return false;
+
+    // another thread is using the workers, just let the caller do it
+#if SDL_VERSION_ATLEAST(2,0,0)
+    if (SDL_TryLockMutex(pWorkLock) != 0) return false;
+#else
+    SDL_LockMutex(pWorkLock);
+#endif
+
+    if (iThreadCount <= 1)
+    {
+        SDL_UnlockMutex(pWorkLock);
+        return false;
+    }
+
+    pTaskProc = pProc;
+    pTaskData = pTask;
+    iTaskRows = iRows;
+    iTaskBands = iThreadCount < iRows ? iThreadCount : iRows;
+
+    bTaskRunning = true;
+
+    for(int i=1; i<iTaskBands; i++) SDL_SemPost(workers[i].pStart);
+
+    OGE_FX_RunBand(0);
+
+    for(int i=1; i<iTaskBands; i++) SDL_SemWait(pWorkDone);
+
+    bTaskRunning = false;
+
+    pTaskProc = NULL;
+    pTaskData = NULL;
+
+    SDL_UnlockMutex(pWorkLock);
+
+    return true;
+}
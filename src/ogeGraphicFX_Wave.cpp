@@ -0,0 +1,447 @@
+/*
+-----------------------------------------------------------------------------
+This source file is part of Open Game Engine 2D.
+It is licensed under the terms of the MIT license.
+For the latest info, see http://oge2d.sourceforge.net
+
+Copyright (c) 2010-2012 Lin Jia Jun (Joe Lam)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-----------------------------------------------------------------------------
+*/
+
+// cached displacement tables of the wave effects, shared by the c and the mmx backends
+
+#include "ogeGraphicFX_Kernel.h"
+#include <cmath>
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+
+#ifdef __FX_WITH_SSE__
+#include <immintrin.h>
+
+#if defined(__GNUC__)
+#define _FX_AVX2_FUNC_ __attribute__((target("avx2")))
+#else
+#define _FX_AVX2_FUNC_
+#endif
+
+#endif // __FX_WITH_SSE__
+
+#define _OGE_FX_WAVE_TABLES_      16
+#define _OGE_FX_WAVE_MAX_VALUES_  (1 << 20)
+
+/* lround(sin(k / fPeriod) * fAmount) for k = iFrom ~ iFrom + iCount - 1,
+   the steps of an animated wave only move the window of k, so one table serves all of them
+*/
+struct CogeFXWaveTable
+{
+    double fPeriod;
+    double fAmount;
+
+    int iFrom;
+    int iCount;
+    int* pValues;
+
+    unsigned int iLastUse;
+};
+
+static CogeFXWaveTable wavetables[_OGE_FX_WAVE_TABLES_];
+static unsigned int wavetick = 0;
+
+static void OGE_FX_FillWave(int* pValues, double fPeriod, double fAmount, int iFrom, int iCount)
+{
+    if (fPeriod == 0)
+    {
+        memset(pValues, 0, iCount * sizeof(int));
+        return;
+    }
+
+    for(int i=0; i<iCount; i++) pValues[i] = lround(sin((iFrom + i) / fPeriod) * fAmount);
+}
+
+// returns the values of k = iSteps ~ iSteps + iLength - 1, or NULL if out of memory
+static const int* OGE_FX_GetWave(double fPeriod, double fAmount, int iSteps, int iLength)
+{
+    CogeFXWaveTable* pTable = NULL;
+    CogeFXWaveTable* pOldest = &wavetables[0];
+
+    wavetick++;
+
+    for(int i=0; i<_OGE_FX_WAVE_TABLES_; i++)
+    {
+        CogeFXWaveTable* t = &wavetables[i];
+
+        if (t->pValues && t->fPeriod == fPeriod && t->fAmount == fAmount)
+        {
+            pTable = t;
+            break;
+        }
+
+        if (t->pValues == NULL || t->iLastUse < pOldest->iLastUse) pOldest = t;
+    }
+
+    if (pTable && iSteps >= pTable->iFrom && iSteps + iLength <= pTable->iFrom + pTable->iCount)
+    {
+        pTable->iLastUse = wavetick;
+        return pTable->pValues + (iSteps - pTable->iFrom);
+    }
+
+    int iFrom = iSteps;
+    int iTo = iSteps + iLength;
+
+    // grow the old window if it is not too big, or start a new one
+    if (pTable)
+    {
+        int iNewFrom = std::min(iFrom, pTable->iFrom);
+        int iNewTo = std::max(iTo, pTable->iFrom + pTable->iCount);
+
+        if (iNewTo - iNewFrom <= _OGE_FX_WAVE_MAX_VALUES_)
+        {
+            iFrom = iNewFrom;
+            iTo = iNewTo;
+        }
+    }
+    else pTable = pOldest;
+
+    int* pValues = (int*) malloc((iTo - iFrom) * sizeof(int));
+    if (pValues == NULL) return NULL;
+
+    OGE_FX_FillWave(pValues, fPeriod, fAmount, iFrom, iTo - iFrom);
+
+    if (pTable->pValues) free(pTable->pValues);
+
+    pTable->fPeriod = fPeriod;
+    pTable->fAmount = fAmount;
+    pTable->iFrom = iFrom;
+    pTable->iCount = iTo - iFrom;
+    pTable->pValues = pValues;
+    pTable->iLastUse = wavetick;
+
+    return pValues + (iSteps - iFrom);
+}
+
+// a buffer for the column offsets of a call (only called by the main thread)
+static int* OGE_FX_GetColOffsets(int iWidth)
+{
+    static int* pBuffer = NULL;
+    static int iBufferSize = 0;
+
+    if (iWidth > iBufferSize)
+    {
+        int* pNewBuffer = (int*) realloc(pBuffer, iWidth * sizeof(int));
+        if (pNewBuffer == NULL) return NULL;
+
+        pBuffer = pNewBuffer;
+        iBufferSize = iWidth;
+    }
+
+    return pBuffer;
+}
+
+void OGE_FX_PrepareWave(double fPeriod, double fAmount, int iFromSteps, int iToSteps, int iLength)
+{
+    if (iLength <= 0) return;
+
+    if (iFromSteps < 0) iFromSteps = 0;
+    if (iToSteps < iFromSteps) iToSteps = iFromSteps;
+
+    OGE_FX_GetWave(fPeriod, fAmount, iFromSteps, iToSteps - iFromSteps + iLength);
+}
+
+void OGE_FX_FreeWaves()
+{
+    for(int i=0; i<_OGE_FX_WAVE_TABLES_; i++)
+    {
+        if (wavetables[i].pValues) free(wavetables[i].pValues);
+        memset(&wavetables[i], 0, sizeof(CogeFXWaveTable));
+    }
+}
+
+enum ogeFXWaveType
+{
+    _FX_WAVE_SQUARE_ = 0,
+    _FX_WAVE_ROUND_
+};
+
+struct CogeFXWaveTask
+{
+    int iType;
+
+    uint8_t* pDstData;
+    int iDstLineSize;
+
+    uint8_t* pSrcData;
+    int iSrcLineSize;
+    int iSrcColorKey;
+
+    int iWidth;
+    int iHeight;
+    int iBPP;
+
+    const int* pRowWave;  // one value per row
+    const int* pColWave;  // one value per column
+
+    int* pColOffsets;     // byte offset of pColWave[x] rows and x columns in src
+
+    int iColWaveMin;
+    int iColWaveMax;
+
+    bool bUseAVX2;
+};
+
+static inline void OGE_FX_CopyPixel(uint8_t* pDst, uint8_t* pSrc, int iBPP, int iColorKey)
+{
+    if (iBPP == 16)
+    {
+        uint16_t iColor = *(uint16_t*)pSrc;
+        if (iColorKey == -1 || iColor != iColorKey) *(uint16_t*)pDst = iColor;
+    }
+    else
+    {
+        uint32_t iColor = *(uint32_t*)pSrc;
+        if (iColorKey == -1 || iColor != (uint32_t)iColorKey) *(uint32_t*)pDst = iColor;
+    }
+}
+
+#ifdef __FX_WITH_SSE__
+
+// gathers 8 pixels at a time for a row of the round wave (32 bpp), returns the first column left
+_FX_AVX2_FUNC_ static int OGE_FX_AVX2_WaveRow(uint32_t* pDst, uint8_t* pSrc, const int* pColOffsets,
+                                             int iFrom, int iTo, int iColorKey)
+{
+    __m256i mKey = _mm256_set1_epi32(iColorKey);
+
+    int x = iFrom;
+
+    for(; x+8<=iTo; x+=8)
+    {
+        __m256i mOffsets = _mm256_loadu_si256((__m256i*)(pColOffsets + x));
+        __m256i mColor = _mm256_i32gather_epi32((const int*)pSrc, mOffsets, 1);
+
+        if (iColorKey != -1)
+        {
+            __m256i mDst = _mm256_loadu_si256((__m256i*)(pDst + x));
+            mColor = _mm256_blendv_epi8(mColor, mDst, _mm256_cmpeq_epi32(mColor, mKey));
+        }
+
+        _mm256_storeu_si256((__m256i*)(pDst + x), mColor);
+    }
+
+    return x;
+}
+
+#endif // __FX_WITH_SSE__
+
+// src row = row + pRowWave[row], src column = column + pColWave[column]
+static void OGE_FX_SquareWaveBand(CogeFXWaveTask* t, int iFromRow, int iToRow)
+{
+    int iPixelSize = t->iBPP >> 3;
+
+    for(int y=iFromRow; y<iToRow; y++)
+    {
+        int yy = t->pRowWave[y] + y;
+        if (yy < 0 || yy >= t->iHeight) continue;
+
+        uint8_t* pDst = t->pDstData + y * t->iDstLineSize;
+        uint8_t* pSrc = t->pSrcData + yy * t->iSrcLineSize;
+
+        for(int x=0; x<t->iWidth; x++)
+        {
+            int xx = t->pColWave[x] + x;
+            if (xx >= 0 && xx < t->iWidth)
+                OGE_FX_CopyPixel(pDst + x * iPixelSize, pSrc + xx * iPixelSize, t->iBPP, -1);
+        }
+    }
+}
+
+// src column = column + pRowWave[row], src row = row + pColWave[column]
+static void OGE_FX_RoundWaveBand(CogeFXWaveTask* t, int iFromRow, int iToRow)
+{
+    int iPixelSize = t->iBPP >> 3;
+    int iSrcLineSize = t->iSrcLineSize;
+    int iColorKey = t->iSrcColorKey;
+
+    for(int y=iFromRow; y<iToRow; y++)
+    {
+        int iShift = t->pRowWave[y];
+
+        // the columns whose src column is inside src
+        int iFrom = std::max(0, -iShift);
+        int iTo = std::min(t->iWidth, t->iWidth - iShift);
+
+        if (iFrom >= iTo) continue;
+
+        uint8_t* pDst = t->pDstData + y * t->iDstLineSize;
+        uint8_t* pSrc = t->pSrcData + y * iSrcLineSize + iShift * iPixelSize;
+
+        const int* pColWave = t->pColWave;
+        const int* pColOffsets = t->pColOffsets;
+
+        if (y + t->iColWaveMin >= 0 && y + t->iColWaveMax < t->iHeight)
+        {
+            // all the src rows of this row are inside src
+            if (t->iBPP == 16)
+            {
+                uint16_t* pDst16 = (uint16_t*) pDst;
+                for(int x=iFrom; x<iTo; x++)
+                {
+                    uint16_t iColor = *(uint16_t*)(pSrc + pColOffsets[x]);
+                    if (iColorKey == -1 || iColor != iColorKey) pDst16[x] = iColor;
+                }
+            }
+            else
+            {
+                uint32_t* pDst32 = (uint32_t*) pDst;
+#ifdef __FX_WITH_SSE__
+                if (t->bUseAVX2) iFrom = OGE_FX_AVX2_WaveRow(pDst32, pSrc, pColOffsets, iFrom, iTo, iColorKey);
+#endif
+                for(int x=iFrom; x<iTo; x++)
+                {
+                    uint32_t iColor = *(uint32_t*)(pSrc + pColOffsets[x]);
+                    if (iColorKey == -1 || iColor != (uint32_t)iColorKey) pDst32[x] = iColor;
+                }
+            }
+        }
+        else
+        {
+            for(int x=iFrom; x<iTo; x++)
+            {
+                int yy = pColWave[x] + y;
+                if (yy >= 0 && yy < t->iHeight)
+                    OGE_FX_CopyPixel(pDst + x * iPixelSize, pSrc + pColOffsets[x], t->iBPP, iColorKey);
+            }
+        }
+    }
+}
+
+static void OGE_FX_WaveBand(void* pTask, int iFromRow, int iToRow)
+{
+    CogeFXWaveTask* t = (CogeFXWaveTask*) pTask;
+
+    if (t->iType == _FX_WAVE_SQUARE_) OGE_FX_SquareWaveBand(t, iFromRow, iToRow);
+    else OGE_FX_RoundWaveBand(t, iFromRow, iToRow);
+}
+
+static void OGE_FX_RunWave(CogeFXWaveTask* t)
+{
+    // the rows only read src, so they can run on the fx threads unless src is dst
+    bool bUseThreads = t->pSrcData != t->pDstData && OGE_FX_GetThreads() > 1 &&
+                       t->iWidth * t->iHeight >= OGE_FX_GetThreadPixels();
+
+    if (bUseThreads && OGE_FX_RunBands(OGE_FX_WaveBand, t, t->iHeight)) return;
+
+    OGE_FX_WaveBand(t, 0, t->iHeight);
+}
+
+void OGE_FX_BltSquareWave(uint8_t* pDstData, int iDstLineSize,
+                int iDstX, int iDstY,
+                uint8_t* pSrcData, int iSrcLineSize,
+                int iSrcX, int iSrcY,
+                int iWidth, int iHeight, int iBPP,
+                double iXAmount, double iYAmount, double iZAmount)
+{
+    if (iBPP != 16 && iBPP != 32) return;
+    if (iWidth <= 0 || iHeight <= 0) return;
+
+    int iPixelSize = iBPP >> 3;
+
+    CogeFXWaveTask task;
+
+    task.iType = _FX_WAVE_SQUARE_;
+
+    task.pDstData = pDstData + iDstY * iDstLineSize + iDstX * iPixelSize;
+    task.iDstLineSize = iDstLineSize;
+    task.pSrcData = pSrcData + iSrcY * iSrcLineSize + iSrcX * iPixelSize;
+    task.iSrcLineSize = iSrcLineSize;
+    task.iSrcColorKey = -1;
+
+    task.iWidth = iWidth;
+    task.iHeight = iHeight;
+    task.iBPP = iBPP;
+
+    task.pColWave = OGE_FX_GetWave(iXAmount, iZAmount, 0, iWidth);
+    task.pRowWave = OGE_FX_GetWave(iYAmount, iZAmount, 0, iHeight);
+    task.pColWave = OGE_FX_GetWave(iXAmount, iZAmount, 0, iWidth);
+
+    if (task.pColWave == NULL || task.pRowWave == NULL) return;
+
+    task.iColWaveMin = 0;
+    task.iColWaveMax = 0;
+
+    task.pColOffsets = NULL;
+    task.bUseAVX2 = false;
+
+    OGE_FX_RunWave(&task);
+}
+
+void OGE_FX_BltRoundWave(uint8_t* pDstData, int iDstLineSize,
+                int iDstX, int iDstY,
+                uint8_t* pSrcData, int iSrcLineSize,
+                int iSrcX, int iSrcY,
+                int iWidth, int iHeight, int iBPP, int iSrcColorKey,
+                double iXAmount, double iYAmount, double iZAmount,
+                int iXSteps, int iYSteps)
+{
+    if (iBPP != 16 && iBPP != 32) return;
+    if (iWidth <= 0 || iHeight <= 0) return;
+
+    if (iXSteps < 0) iXSteps = 0;
+    if (iYSteps < 0) iYSteps = 0;
+
+    int iPixelSize = iBPP >> 3;
+
+    CogeFXWaveTask task;
+
+    task.iType = _FX_WAVE_ROUND_;
+
+    task.pDstData = pDstData + iDstY * iDstLineSize + iDstX * iPixelSize;
+    task.iDstLineSize = iDstLineSize;
+    task.pSrcData = pSrcData + iSrcY * iSrcLineSize + iSrcX * iPixelSize;
+    task.iSrcLineSize = iSrcLineSize;
+    task.iSrcColorKey = iBPP == 16 && iSrcColorKey != -1 ? (iSrcColorKey & 0xffff) : iSrcColorKey;
+
+    task.iWidth = iWidth;
+    task.iHeight = iHeight;
+    task.iBPP = iBPP;
+
+    // the second table may grow (and move) the first one if they share the same wave, so fetch the first again
+    task.pRowWave = OGE_FX_GetWave(iXAmount, iZAmount, iYSteps, iHeight);
+    task.pColWave = OGE_FX_GetWave(iYAmount, iZAmount, iXSteps, iWidth);
+    task.pRowWave = OGE_FX_GetWave(iXAmount, iZAmount, iYSteps, iHeight);
+
+    if (task.pColWave == NULL || task.pRowWave == NULL) return;
+
+    task.iColWaveMin = *std::min_element(task.pColWave, task.pColWave + iWidth);
+    task.iColWaveMax = *std::max_element(task.pColWave, task.pColWave + iWidth);
+
+    task.pColOffsets = OGE_FX_GetColOffsets(iWidth);
+    if (task.pColOffsets == NULL) return;
+
+    for(int x=0; x<iWidth; x++) task.pColOffsets[x] = task.pColWave[x] * iSrcLineSize + x * iPixelSize;
+
+#ifdef __FX_WITH_SSE__
+    task.bUseAVX2 = OGE_FX_GetBackend() >= _OGE_FX_BACKEND_AVX2_;
+#else
+    task.bUseAVX2 = false;
+#endif
+
+    OGE_FX_RunWave(&task);
+}
@@ -141,24 +141,15 @@ static SDL_Surface* OGE_DisplayFormat(SDL_Surface* pSurface)
 }
 
 
-static SDL_Surface* OGE_DisplayFormatAlpha(SDL_Surface* pSurface)
+// the 32 bpp alpha format which goes with the format of the screen (red, green, blue, alpha)
+static void OGE_GetAlphaFormatMasks(SDL_PixelFormat* vf, Uint32* pMasks)
 {
-    SDL_Surface* pResult = NULL;
-
-#if defined(__OGE_WITH_GLWIN__) || SDL_VERSION_ATLEAST(2,0,0)
-
-    SDL_PixelFormat *vf;
-    SDL_PixelFormat *format;
-
     /* default to ARGB8888 */
     Uint32 amask = 0xff000000;
     Uint32 rmask = 0x00ff0000;
     Uint32 gmask = 0x0000ff00;
     Uint32 bmask = 0x000000ff;
 
-    if(g_pMainSurface == NULL) return pResult;
-    vf = g_pMainSurface->format;
-
     switch (vf->BytesPerPixel) {
     case 2:
         /* For XGY5[56]5, use, AXGY8888, where {X, Y} = {R, B}.
@@ -186,7 +177,26 @@ static SDL_Surface* OGE_DisplayFormatAlpha(SDL_Surface* pSurface)
            optimised alpha format is written, add the converter here */
         break;
     }
-    format = SDL_AllocFormat(SDL_MasksToPixelFormatEnum(32, rmask, gmask, bmask, amask));
+
+    pMasks[0] = rmask;
+    pMasks[1] = gmask;
+    pMasks[2] = bmask;
+    pMasks[3] = amask;
+}
+
+static SDL_Surface* OGE_DisplayFormatAlpha(SDL_Surface* pSurface)
+{
+    SDL_Surface* pResult = NULL;
+
+#if defined(__OGE_WITH_GLWIN__) || SDL_VERSION_ATLEAST(2,0,0)
+
+    SDL_PixelFormat *format;
+    Uint32 masks[4];
+
+    if(g_pMainSurface == NULL) return pResult;
+    OGE_GetAlphaFormatMasks(g_pMainSurface->format, masks);
+
+    format = SDL_AllocFormat(SDL_MasksToPixelFormatEnum(32, masks[0], masks[1], masks[2], masks[3]));
     if (format == NULL) return NULL;
 
     pResult = SDL_ConvertSurface(pSurface, format, 0);
@@ -205,6 +215,84 @@ static SDL_Surface* OGE_DisplayFormatAlpha(SDL_Surface* pSurface)
     return pResult;
 }
 
+// a color key or a surface alpha, which only the converters of sdl apply
+static bool OGE_HasSurfaceKey(SDL_Surface* pSurface)
+{
+#if SDL_VERSION_ATLEAST(2,0,0)
+    Uint32 iColorKey = 0;
+    Uint8 iAlpha = 255;
+    SDL_GetSurfaceAlphaMod(pSurface, &iAlpha);
+    return SDL_GetColorKey(pSurface, &iColorKey) == 0 || iAlpha != 255;
+#else
+    return (pSurface->flags & SDL_SRCCOLORKEY) || (pSurface->format->Amask == 0 && (pSurface->flags & SDL_SRCALPHA));
+#endif
+}
+
+// a copy of a surface in the same format
+static SDL_Surface* OGE_CopySurface(SDL_Surface* pSurface)
+{
+    SDL_PixelFormat* format = pSurface->format;
+
+    SDL_Surface* pResult = SDL_CreateRGBSurface(_OGE_VIDEO_DF_MODE_, pSurface->w, pSurface->h, format->BitsPerPixel,
+                                                format->Rmask, format->Gmask, format->Bmask, format->Amask);
+    if(pResult == NULL) return NULL;
+
+    int iRowSize = pSurface->w * format->BytesPerPixel;
+
+    for(int y=0; y<pSurface->h; y++)
+        memcpy((Uint8*)pResult->pixels + y * pResult->pitch, (Uint8*)pSurface->pixels + y * pSurface->pitch, iRowSize);
+
+    return pResult;
+}
+
+// the time in ms (only for the statistics)
+static double OGE_GetStatTime()
+{
+#if SDL_VERSION_ATLEAST(2,0,0)
+    return SDL_GetPerformanceCounter() * 1000.0 / SDL_GetPerformanceFrequency();
+#else
+    return SDL_GetTicks();
+#endif
+}
+
+Uint64 OGE_GetPerfCounter()
+{
+#if SDL_VERSION_ATLEAST(2,0,0)
+    return SDL_GetPerformanceCounter();
+#else
+    return SDL_GetTicks();
+#endif
+}
+
+Uint64 OGE_GetPerfFrequency()
+{
+#if SDL_VERSION_ATLEAST(2,0,0)
+    static Uint64 iFrequency = SDL_GetPerformanceFrequency();
+    return iFrequency;
+#else
+    return 1000;
+#endif
+}
+
+void OGE_WaitPerfCounter(Uint64 iCounter)
+{
+    Uint64 iFrequency = OGE_GetPerfFrequency();
+    Uint64 iCurrent = OGE_GetPerfCounter();
+
+    while (iCurrent < iCounter)
+    {
+        // the sleep may take a ms or two more than it is asked for
+        Uint64 iLeftMS = (iCounter - iCurrent) * 1000 / iFrequency;
+
+        if (iLeftMS > 2) SDL_Delay((Uint32)(iLeftMS - 2));
+#if !SDL_VERSION_ATLEAST(2,0,0)
+        else SDL_Delay(1); // the ms ticks can not be spun on
+#endif
+
+        iCurrent = OGE_GetPerfCounter();
+    }
+}
+
 
 
 /*---------------- Video -----------------*/
@@ -446,6 +534,14 @@ m_pTextArea(NULL),
 m_pClipboardA(NULL),
 m_pClipboardB(NULL),
 m_pClipboardC(NULL),
+m_pColorTransform(NULL),
+m_iFrameCacheSize(0),
+m_iFrameCacheBytes(0),
+m_iFrameCacheHits(0),
+m_iFrameCacheMisses(0),
+m_iConvertedImages(0),
+m_iSDLConvertedImages(0),
+m_fConvertTime(0),
 m_pDotFont(NULL),
 m_pFontStock(NULL),
 m_pDefaultFont(NULL),
@@ -459,6 +555,32 @@ m_iMode(0)
     m_bShowFPS         = true;
 	m_iLockedFPS       = 0;
 	m_iFrameInterval   = 0;
+	m_iFrameTicks      = 0;
+	m_iNextFrameCounter = 0;
+
+	m_iColorKeySpans   = 0;
+	m_iIndexedImages   = 0;
+	m_bPremultipliedAlpha = false;
+	m_bSmoothRotation  = false;
+	m_bSmoothScaling   = false;
+	m_iPresentFilter   = _OGE_FX_PRESENT_NEAREST_;
+
+	m_bPartialUpdate   = false;
+	m_iLastUploadX     = -1;
+	m_iLastUploadY     = -1;
+	m_iUploadBytes     = 0;
+
+	m_bDirectScreen    = false;
+	m_bScreenLost      = false;
+	m_pScreenSurface   = NULL;
+
+	m_pPresentThread   = NULL;
+	m_pPresentStart    = NULL;
+	m_pPresentDone     = NULL;
+	m_bQuitPresent     = false;
+	m_bPresentPending  = false;
+	m_pPresentPixels   = NULL;
+	m_iPresentPitch    = 0;
 
 	m_bIsBGRA          = false;
 
@@ -488,11 +610,11 @@ m_iMode(0)
 	m_bSupportMMX = iMMXFlag > 0;
 
 #if SDL_VERSION_ATLEAST(2,0,0)
-	OGE_Log( "Video Flags: SDL = 2.0, MMX = %d\n", iMMXFlag );
+	OGE_Log( "Video Flags: SDL = 2.0, MMX = %d, FX = %d\n", iMMXFlag, OGE_FX_GetBackend() );
 #elif SDL_VERSION_ATLEAST(1,3,0)
-	OGE_Log( "Video Flags: SDL = 1.3, MMX = %d\n", iMMXFlag );
+	OGE_Log( "Video Flags: SDL = 1.3, MMX = %d, FX = %d\n", iMMXFlag, OGE_FX_GetBackend() );
 #else
-    OGE_Log( "Video Flags: SDL = 1.2, MMX = %d\n", iMMXFlag );
+    OGE_Log( "Video Flags: SDL = 1.2, MMX = %d, FX = %d\n", iMMXFlag, OGE_FX_GetBackend() );
 #endif
 
 	m_iState = 0;
@@ -514,6 +636,7 @@ m_iMode(0)
 CogeVideo::~CogeVideo()
 {
     Finalize();
+    StopPresentThread();
     return;
 }
 
@@ -654,6 +777,9 @@ int CogeVideo::Initialize(int iWidth, int iHeight, int iBPP, bool bFullscreen, i
     m_pMainRenderer = SDL_CreateRenderer(m_pMainWindow, -1, 0);
     m_pMainTexture = SDL_CreateTexture(m_pMainRenderer, m_pFrontBuffer->format->format, SDL_TEXTUREACCESS_STREAMING, iWidth, iHeight);
 
+    m_iLastUploadX = -1;
+    m_iLastUploadY = -1;
+
 #else
 
     if(m_bNeedStretch) m_pFrontBuffer = SDL_SetVideoMode(m_iRealWidth, m_iRealHeight, iBPP, iFlags);
@@ -955,8 +1081,31 @@ int CogeVideo::Initialize(int iWidth, int iHeight, int iBPP, bool bFullscreen, i
 
 void CogeVideo::Finalize()
 {
+    WaitPresent();
+
     m_iState = -1;
 
+    UnmapScreen();
+
+    OGE_FX_SetThreads(0, 0);
+
+    OGE_FX_FreeWaves();
+
+    if (m_iFrameCacheHits + m_iFrameCacheMisses > 0)
+        OGE_Log("Frame Cache: %d hits, %d misses\n", m_iFrameCacheHits, m_iFrameCacheMisses);
+
+    if (m_iConvertedImages + m_iSDLConvertedImages > 0)
+        OGE_Log("Image Conversion: %d images (%d by SDL), %.1f ms\n",
+                m_iConvertedImages + m_iSDLConvertedImages, m_iSDLConvertedImages, m_fConvertTime);
+
+    ClearFrameCache();
+
+    if (m_pColorTransform)
+    {
+        OGE_FX_FreeColorTransform(m_pColorTransform);
+        m_pColorTransform = NULL;
+    }
+
     DelAllImages();
 
     if (m_pClipboardA)
@@ -1054,6 +1203,10 @@ int CogeVideo::Resume()
             //SDL_ShowWindow(m_pMainWindow);
             //SDL_RaiseWindow(m_pMainWindow);
         }
+
+        // the texture may have been lost
+        m_iLastUploadX = -1;
+        m_iLastUploadY = -1;
 #endif
 
     }
@@ -1065,6 +1218,8 @@ int CogeVideo::Pause()
 	if (m_iState < 0) return m_iState;
 	if (m_iState > 0)
     {
+        WaitPresent();
+
         m_iState = 0;
 
 #ifdef __OGE_WITH_GLWIN__
@@ -1072,6 +1227,9 @@ int CogeVideo::Pause()
         {
             //SDL_HideWindow(m_pMainWindow);
         }
+
+        // the texture may be lost while it is paused
+        UnmapScreen();
 #endif
 
     }
@@ -1493,6 +1651,8 @@ void* CogeVideo::GetMainWindow()
 
 CogeImage* CogeVideo::GetScreen()
 {
+    // the screen may be drawn on once the last frame is out of it
+    WaitPresent();
 	return m_pMainScreen;
 }
 
@@ -1504,6 +1664,7 @@ void CogeVideo::SetScreen(CogeImage* pTheScreen)
 
     int iOldState = GetState();
 	if(iOldState > 0) Pause();
+	pTheScreen->PrepareRawData(true);
 	m_pMainScreen = pTheScreen;
 	if(iOldState > 0) Resume();
 }
@@ -1543,6 +1704,12 @@ CogeImage* CogeVideo::GetClipboardC()
     return m_pClipboardC;
 }
 
+CogeFXColorTransform* CogeVideo::GetColorTransform()
+{
+    if (m_pColorTransform == NULL) m_pColorTransform = OGE_FX_NewColorTransform();
+    return m_pColorTransform;
+}
+
 CogeImage* CogeVideo::GetDefaultBg()
 {
     return m_pDefaultBg;
@@ -1560,6 +1727,7 @@ void CogeVideo::ClearDefaultBg(int iRGBColor)
 
 void CogeVideo::SetView(int x, int y)
 {
+    WaitPresent();
     m_ViewRect.x = x;
     m_ViewRect.y = y;
 }
@@ -1574,6 +1742,8 @@ void CogeVideo::DrawFPS(int x, int y)
     else
         sprintf(sFPS,"FPS:%d", m_iFrameRate);
 
+    WaitPresent();
+
     /*
     m_pTextArea->FillRect(0xff00ff);
     m_pTextArea->DotTextOut(sFPS, x, y);
@@ -1598,2069 +1768,4396 @@ void CogeVideo::LockFPS(int iFPS)
 {
     m_iFrameRateWanted = iFPS;
 	m_iFrameInterval = 1000/iFPS;
+	m_iFrameTicks = OGE_GetPerfFrequency()/iFPS;
+	m_iNextFrameCounter = 0;
 	m_iLockedFPS = iFPS;
 }
 void CogeVideo::UnlockFPS()
 {
 	m_iLockedFPS = 0;
 }
+Uint64 CogeVideo::GetNextFrameCounter()
+{
+    if (m_iLockedFPS > 0 && m_iFrameTicks > 0) return m_iNextFrameCounter;
+    else return 0;
+}
 
-bool CogeVideo::IsBGRAMode()
+int CogeVideo::SetFXThreads(int iThreads, int iMinPixels)
 {
-    return m_bIsBGRA;
+    int iCount = OGE_FX_SetThreads(iThreads, iMinPixels);
+    OGE_Log("FX Threads: %d (min pixels: %d)\n", iCount, OGE_FX_GetThreadPixels());
+    return iCount;
+}
+int CogeVideo::GetFXThreads()
+{
+    return OGE_FX_GetThreads();
 }
 
-void CogeVideo::FillRect(int iRGBColor, int iLeft, int iTop, int iWidth, int iHeight)
+void CogeVideo::SetColorKeySpans(int iMode)
 {
-    //if (m_iState < 0) return;
-    //if (!m_pMainScreen) return;
-    m_pMainScreen->FillRect(iRGBColor, iLeft, iTop, iWidth, iHeight);
+    m_iColorKeySpans = iMode;
+}
+int CogeVideo::GetColorKeySpans()
+{
+    return m_iColorKeySpans;
 }
 
-void CogeVideo::DrawImage(CogeImage* pSrcImage,
-                    int iDstLeft, int iDstTop,
-                    int iSrcLeft, int iSrcTop, int iSrcWidth, int iSrcHeight)
+void CogeVideo::SetIndexedImages(int iMode)
 {
-    //if (m_iState < 0) return;
+    m_iIndexedImages = iMode;
+}
+int CogeVideo::GetIndexedImages()
+{
+    return m_iIndexedImages;
+}
 
-    //if (m_pMainScreen && pSrcImage)
-    //{
+void CogeVideo::SetPremultipliedAlpha(bool bEnable)
+{
+    m_bPremultipliedAlpha = bEnable;
+}
+bool CogeVideo::GetPremultipliedAlpha()
+{
+    return m_bPremultipliedAlpha;
+}
 
-    //iDstLeft = m_iViewX + iDstLeft;
-    //iDstTop  = m_iViewY + iDstTop;
+void CogeVideo::SetSmoothRotation(bool bEnable)
+{
+    m_bSmoothRotation = bEnable;
+}
+bool CogeVideo::GetSmoothRotation()
+{
+    return m_bSmoothRotation;
+}
 
+void CogeVideo::SetSmoothScaling(bool bEnable)
+{
+    // the cached frames were scaled the other way
+    if (m_bSmoothScaling != bEnable) ClearFrameCache();
+    m_bSmoothScaling = bEnable;
+}
+bool CogeVideo::GetSmoothScaling()
+{
+    return m_bSmoothScaling;
+}
 
-    m_pMainScreen->Draw(pSrcImage,
-                        iDstLeft,  iDstTop,  //iDstWidth,  iDstHeight,
-                        iSrcLeft,  iSrcTop,  iSrcWidth,  iSrcHeight);
-    //}
+void CogeVideo::SetPresentFilter(int iFilter)
+{
+    if (iFilter < _OGE_FX_PRESENT_NEAREST_ || iFilter > _OGE_FX_PRESENT_SMOOTH_) iFilter = _OGE_FX_PRESENT_NEAREST_;
+    m_iPresentFilter = iFilter;
+}
+int CogeVideo::GetPresentFilter()
+{
+    return m_iPresentFilter;
+}
 
+void CogeVideo::SetUpdateRects(const std::vector<CogeRect>& rects)
+{
+    // the rects of a dropped frame are still there, they have not been uploaded either
+    m_UpdateRects.insert(m_UpdateRects.end(), rects.begin(), rects.end());
+    m_bPartialUpdate = true;
+}
+int CogeVideo::GetUploadBytes()
+{
+    return m_iUploadBytes;
 }
 
-void CogeVideo::DrawImage(const std::string& sSrcImageName,
-                           int iDstLeft, int iDstTop,
-                           int iSrcLeft, int iSrcTop, int iSrcWidth, int iSrcHeight)
+void CogeVideo::SetDirectScreen(bool bEnable)
 {
-    //if (m_iState < 0) return;
-    //if (!m_pMainScreen) return;
+    WaitPresent();
 
-    CogeImage* pSrcImage = FindImage(sSrcImageName);
+#ifdef __OGE_WITH_GLWIN__
 
-    if (pSrcImage)
+    // the renderers which draw from the pixels of the lock (they stay where they are with all of their content)
+    if(bEnable && m_pMainRenderer)
     {
+        SDL_RendererInfo info;
 
-    //iDstLeft = m_iViewX + iDstLeft;
-    //iDstTop  = m_iViewY + iDstTop;
+        if(SDL_GetRendererInfo(m_pMainRenderer, &info) != 0 ||
+           (SDL_strcmp(info.name, "opengl") != 0 && SDL_strcmp(info.name, "opengles2") != 0 &&
+            SDL_strcmp(info.name, "opengles") != 0 && SDL_strcmp(info.name, "software") != 0))
+        {
+            OGE_Log("The direct screen is not supported by the renderer.\n");
+            bEnable = false;
+        }
+    }
 
+#else
 
-    m_pMainScreen->Draw(pSrcImage,
-                        iDstLeft,  iDstTop,  //iDstWidth,  iDstHeight,
-                        iSrcLeft,  iSrcTop,  iSrcWidth,  iSrcHeight);
-    }
+    bEnable = false;
+
+#endif
 
+    if(!bEnable) UnmapScreen();
 
+    m_bDirectScreen = bEnable;
 }
-
-void CogeVideo::DotTextOut(char* pText, int x, int y,
-                            int iMaxWidth, int iFontSpace , int iLineSpace)
+bool CogeVideo::GetDirectScreen()
 {
-    //if (m_iState < 0) return;
-    //if (!m_pDotFont) return;
-    //if (!m_pMainScreen) return;
-
-    if(m_pMainScreen)
-    m_pMainScreen->DotTextOut(pText, x, y, iMaxWidth, iFontSpace, iLineSpace);
+    return m_bDirectScreen;
 }
 
-void CogeVideo::PrintText(const std::string& sText, int x, int y, CogeFont* pFont, int iAlpha)
+bool CogeVideo::IsScreenLost()
 {
-    if(m_pMainScreen)
-    {
-        if(pFont == NULL) pFont = m_pDefaultFont;
-        m_pMainScreen->PrintText(sText, x, y, pFont, iAlpha);
-    }
+    bool bLost = m_bScreenLost;
+    m_bScreenLost = false;
+    return bLost;
 }
 
-int CogeVideo::Update(int x, int y)
+bool CogeVideo::MapScreen()
 {
-    if (m_iState < 0) return 0;
-
-    // get FPS
-
-	int iCurrentTime = SDL_GetTicks();
+#ifdef __OGE_WITH_GLWIN__
 
-	if (m_iLockedFPS > 0 && m_iFrameInterval > 0)
-	{
-	    /*
-		while (iCurrentTime - m_iGlobalTime < m_iFrameInterval)
-		{
-			SDL_Delay(10);  // cool down cpu time ...
-			iCurrentTime = SDL_GetTicks();
-		}
-		*/
+    if(m_pScreenSurface) return true;
 
-		if (iCurrentTime - m_iGlobalTime < m_iFrameInterval)
-		{
-			//SDL_Delay(10);  // cool down cpu time ...
-			//iCurrentTime = SDL_GetTicks();
-			return 0;
-		}
+    if(!m_bDirectScreen || m_pMainTexture == NULL || m_pDefaultScreen == NULL || m_pDefaultScreen->m_pSurface == NULL) return false;
 
-		//if(iCurrentTime - m_iGlobalTime < m_iFrameInterval) return 0;
-		// QueryPerformanceCounter(iNowTime);
+    SDL_Surface* pSurface = m_pDefaultScreen->m_pSurface;
 
-	}
-	else m_iFrameInterval = iCurrentTime - m_iGlobalTime;
+    Uint32 iFormat = 0;
+    int iTextureWidth = 0;
+    int iTextureHeight = 0;
 
-	m_iFrameCount++;
+    if(SDL_QueryTexture(m_pMainTexture, &iFormat, NULL, &iTextureWidth, &iTextureHeight) != 0) return false;
 
-	if (iCurrentTime - m_iLastFrameTime >= 1000)
-	{
-	    m_iOldFrameRate = m_iFrameRate;
-		m_iFrameRate = m_iFrameCount;
-		m_iFrameCount = 0;
-		m_iLastFrameTime = iCurrentTime;
+    if(iFormat != pSurface->format->format || iTextureWidth != pSurface->w || iTextureHeight != pSurface->h) return false;
 
-		//if(m_iFrameRate < m_iFrameRateWanted-5) m_iFrameInterval -= 2;
-		//if(m_iFrameRate > m_iFrameRateWanted+5) m_iFrameInterval += 2;
-		//if (m_bTimerActive) m_iTimerTime++;
-	}
+    void* pPixels = NULL;
+    int iPitch = 0;
 
-	m_iGlobalTime = iCurrentTime;
+    if(SDL_LockTexture(m_pMainTexture, NULL, &pPixels, &iPitch) != 0) return false;
 
-	// flip
+    SDL_Surface* pMapped = SDL_CreateRGBSurfaceFrom(pPixels, pSurface->w, pSurface->h,
+                                                    pSurface->format->BitsPerPixel, iPitch,
+                                                    pSurface->format->Rmask,
+                                                    pSurface->format->Gmask,
+                                                    pSurface->format->Bmask,
+                                                    pSurface->format->Amask);
+    if(pMapped == NULL)
+    {
+        SDL_UnlockTexture(m_pMainTexture);
+        return false;
+    }
 
-    m_ViewRect.x = x;
-    m_ViewRect.y = y;
+    // the screen goes on with what it has
+    OGE_FX_CopyRect((uint8_t*)pPixels, iPitch, 0, 0,
+                    (uint8_t*)pSurface->pixels, pSurface->pitch,
+                    0, 0, pSurface->w, pSurface->h, m_iBPP);
 
+    m_pScreenSurface = pSurface;
+    m_pDefaultScreen->m_pSurface = pMapped;
 
-#ifdef __OGE_WITH_GLWIN__
+    return true;
 
-    //if(m_iState == 0 && m_pMainWindow)
-    //{
-    //    //SDL_Flip(m_pFrontBuffer);
-    //    SDL_UpdateWindowSurface(m_pMainWindow);
-    //}
+#else
 
-    /*
-    if (m_iState > 0 && m_pMainTexture && m_pMainScreen && (m_pMainScreen->m_pSurface))
-	{
-	    void* pSrc = NULL;
-        void* pDst = NULL;
-        int iSrcLineSize = 0;
-        int iDstLineSize = 0;
+    return false;
 
-        //OGE_Log("Flip: --- Begin --- \n");
+#endif
+}
 
-        //SDL_LockSurface(m_pMainScreen->m_pSurface);
-        SDL_LockTexture(m_pMainTexture, NULL, &pDst, &iDstLineSize);
+void CogeVideo::UnmapScreen()
+{
+#ifdef __OGE_WITH_GLWIN__
 
-        pSrc = (void *)m_pMainScreen->m_pSurface->pixels;
-        iSrcLineSize = m_pMainScreen->m_pSurface->pitch;
+    if(m_pScreenSurface == NULL) return;
 
-        OGE_FX_CopyRect((uint8_t*)pDst, iDstLineSize, 0, 0,
-                        (uint8_t*)pSrc, iSrcLineSize,
-                        m_ViewRect.x, m_ViewRect.y, m_ViewRect.w, m_ViewRect.h, m_iBPP);
+    SDL_Surface* pMapped = m_pDefaultScreen->m_pSurface;
 
-        SDL_UnlockTexture(m_pMainTexture);
-        //SDL_UnlockSurface(m_pMainScreen->m_pSurface);
+    OGE_FX_CopyRect((uint8_t*)m_pScreenSurface->pixels, m_pScreenSurface->pitch, 0, 0,
+                    (uint8_t*)pMapped->pixels, pMapped->pitch,
+                    0, 0, pMapped->w, pMapped->h, m_iBPP);
 
-        SDL_RenderCopy(m_pMainRenderer, m_pMainTexture, NULL, NULL);
+    m_pDefaultScreen->m_pSurface = m_pScreenSurface;
+    m_pScreenSurface = NULL;
 
-        SDL_RenderPresent(m_pMainRenderer);
+    SDL_FreeSurface(pMapped);
 
-        //OGE_Log("Flip: --- End --- \n");
+    SDL_UnlockTexture(m_pMainTexture);
 
-	}
-	*/
+    m_iLastUploadX = -1;
+    m_iLastUploadY = -1;
 
-	if (m_iState > 0) UpdateRenderer(m_pMainScreen->m_pSurface);
+#endif
+}
 
+bool CogeFrameCacheKey::operator<(const CogeFrameCacheKey& other) const
+{
+    if (pImage != other.pImage) return pImage < other.pImage;
+    if (iLeft != other.iLeft) return iLeft < other.iLeft;
+    if (iTop != other.iTop) return iTop < other.iTop;
+    if (iWidth != other.iWidth) return iWidth < other.iWidth;
+    if (iHeight != other.iHeight) return iHeight < other.iHeight;
+    if (iEffectCount != other.iEffectCount) return iEffectCount < other.iEffectCount;
 
-#else
+    for (int i=0; i<iEffectCount; i++)
+    {
+        if (iEffectTypes[i] != other.iEffectTypes[i]) return iEffectTypes[i] < other.iEffectTypes[i];
+        if (iEffectValues[i] != other.iEffectValues[i]) return iEffectValues[i] < other.iEffectValues[i];
+    }
 
-	if (m_iState > 0 && m_pFrontBuffer && m_pMainScreen && (m_pMainScreen->m_pSurface))
-	{
-	    if(m_bNeedStretch)
-        {
-            /*
-            SDL_Rect rcDst = {0};
+    return false;
+}
 
-            rcDst.x = 0;
-            rcDst.y = 0;
-            rcDst.w = m_iRealWidth;
-            rcDst.y = m_iRealHeight;
+void CogeVideo::SetFrameCacheSize(int iKBytes)
+{
+    m_iFrameCacheSize = iKBytes > 0 ? iKBytes : 0;
 
-            SDL_SoftStretch(m_pMainScreen->m_pSurface, &m_ViewRect, m_pFrontBuffer, &rcDst);
-            */
+    // drops the old ones until it fits
+    while (m_FrameCacheList.size() > 0 && m_iFrameCacheBytes > m_iFrameCacheSize * 1024)
+        DelFrameCacheItem(--m_FrameCacheList.end());
+}
+int CogeVideo::GetFrameCacheSize()
+{
+    return m_iFrameCacheSize;
+}
+int CogeVideo::GetFrameCacheHits()
+{
+    return m_iFrameCacheHits;
+}
+int CogeVideo::GetFrameCacheMisses()
+{
+    return m_iFrameCacheMisses;
+}
 
+SDL_Surface* CogeVideo::ConvertImage(SDL_Surface* pSurface, bool bAlphaChannel)
+{
+    if (pSurface == NULL) return NULL;
 
-            //bool bNeedLockSrc = SDL_MUSTLOCK(m_pMainScreen->m_pSurface);
-            //if(bNeedLockSrc) bNeedLockSrc = SDL_LockSurface(m_pMainScreen->m_pSurface) == 0;
-            //bool bNeedLockDst = SDL_MUSTLOCK(m_pFrontBuffer);
-            //if(bNeedLockDst) bNeedLockDst = SDL_LockSurface(m_pFrontBuffer) == 0;
+    double fStartTime = OGE_GetStatTime();
 
-            uint8_t* pSrc = (Uint8 *)m_pMainScreen->m_pSurface->pixels;
-            int iSrcLineSize = m_pMainScreen->m_pSurface->pitch;
+    SDL_Surface* pResult = NULL;
+    SDL_PixelFormat* src = pSurface->format;
 
-            uint8_t* pDst = (Uint8 *)m_pFrontBuffer->pixels;
-            int iDstLineSize = m_pFrontBuffer->pitch;
+    bool bSupported = g_pMainSurface != NULL && !OGE_HasSurfaceKey(pSurface)
+                      && (src->BitsPerPixel != 8 || src->palette != NULL)
+                      && (src->BitsPerPixel != 24 || SDL_BYTEORDER == SDL_LIL_ENDIAN);
 
-            OGE_FX_BltStretch(pDst, iDstLineSize,
-                                0, 0, m_iRealWidth, m_iRealHeight,
-                                pSrc, iSrcLineSize, -1,
-                                m_ViewRect.x, m_ViewRect.y, m_ViewRect.w, m_ViewRect.h, m_iBPP);
+    if (bSupported)
+    {
+        SDL_PixelFormat* vf = g_pMainSurface->format;
 
-            //if (bNeedLockSrc) SDL_UnlockSurface(m_pMainScreen->m_pSurface);
-            //if (bNeedLockDst) SDL_UnlockSurface(m_pFrontBuffer);
+        Uint32 iDstMasks[4] = { vf->Rmask, vf->Gmask, vf->Bmask, vf->Amask };
+        Uint32 iSrcMasks[4] = { src->Rmask, src->Gmask, src->Bmask, src->Amask };
+        int iDstBPP = vf->BitsPerPixel;
 
-        }
-        else
+        if (bAlphaChannel)
         {
+            OGE_GetAlphaFormatMasks(vf, iDstMasks);
+            iDstBPP = 32;
+        }
 
-#if defined(__ANDROID__) || defined(__IPHONE__)
-
-            //bool bNeedLockSrc = SDL_MUSTLOCK(m_pMainScreen->m_pSurface);
-            //if(bNeedLockSrc) bNeedLockSrc = SDL_LockSurface(m_pMainScreen->m_pSurface) == 0;
-            //bool bNeedLockDst = SDL_MUSTLOCK(m_pFrontBuffer);
-            //if(bNeedLockDst) bNeedLockDst = SDL_LockSurface(m_pFrontBuffer) == 0;
-
-            uint8_t* pSrc = (Uint8 *)m_pMainScreen->m_pSurface->pixels;
-            int iSrcLineSize = m_pMainScreen->m_pSurface->pitch;
-
-            uint8_t* pDst = (Uint8 *)m_pFrontBuffer->pixels;
-            int iDstLineSize = m_pFrontBuffer->pitch;
-
-            OGE_FX_CopyRect(pDst, iDstLineSize,
-                        0, 0,
-                        pSrc, iSrcLineSize,
-                        m_ViewRect.x, m_ViewRect.y,
-                        m_ViewRect.w, m_ViewRect.h, m_iBPP);
+        Uint32 iPalette[256];
+        int iPaletteSize = 0;
 
-            //if (bNeedLockSrc) SDL_UnlockSurface(m_pMainScreen->m_pSurface);
-            //if (bNeedLockDst) SDL_UnlockSurface(m_pFrontBuffer);
+        if (src->BitsPerPixel == 8)
+        {
+            SDL_Palette* pPalette = src->palette;
+            iPaletteSize = pPalette->ncolors < 256 ? pPalette->ncolors : 256;
 
+            for(int i=0; i<iPaletteSize; i++)
+            {
+                SDL_Color* c = &pPalette->colors[i];
+#if SDL_VERSION_ATLEAST(2,0,0)
+                iPalette[i] = ((Uint32)c->a << 24) | (c->r << 16) | (c->g << 8) | c->b;
 #else
-
-            SDL_BlitSurface(m_pMainScreen->m_pSurface, &m_ViewRect, m_pFrontBuffer, 0);
-
+                iPalette[i] = 0xff000000 | (c->r << 16) | (c->g << 8) | c->b;
 #endif
-
+            }
         }
 
+        pResult = SDL_CreateRGBSurface(_OGE_VIDEO_DF_MODE_, pSurface->w, pSurface->h, iDstBPP,
+                                       iDstMasks[0], iDstMasks[1], iDstMasks[2], iDstMasks[3]);
 
-        //SDL_UpdateRect(m_pFrontBuffer, 0, 0, m_iWidth, m_iHeight);
-
-        SDL_Flip(m_pFrontBuffer);
-
-	}
-
-#endif
-
-	return 1;
-
-}
+        if (pResult)
+        {
+            bool bNeedLock = SDL_MUSTLOCK(pSurface);
+            if (bNeedLock) bNeedLock = SDL_LockSurface(pSurface) == 0;
 
-void CogeVideo::UpdateRenderer(void* pSurface, int x, int y, unsigned int w, unsigned int h)
-{
+            bool bDone = OGE_FX_ConvertPixels((uint8_t*)pResult->pixels, pResult->pitch, iDstBPP, iDstMasks,
+                                              (uint8_t*)pSurface->pixels, pSurface->pitch, src->BitsPerPixel, iSrcMasks,
+                                              iPalette, iPaletteSize, pSurface->w, pSurface->h);
 
-#ifdef __OGE_WITH_GLWIN__
+            if (bNeedLock) SDL_UnlockSurface(pSurface);
 
-    //OGE_Log("Calling UpdateRenderer(): %d ... ", (int)pSurface);
+            if (!bDone)
+            {
+                SDL_FreeSurface(pResult);
+                pResult = NULL;
+            }
+        }
+    }
 
-    if(pSurface == (void*)(m_pMainScreen->m_pSurface))
+    if (pResult) m_iConvertedImages++;
+    else
     {
-        if (m_pMainTexture && m_pMainScreen)
-        {
-            void* pSrc = NULL;
-            void* pDst = NULL;
-            int iSrcLineSize = 0;
-            int iDstLineSize = 0;
+        if (bAlphaChannel) pResult = OGE_DisplayFormatAlpha(pSurface);
+        else pResult = OGE_DisplayFormat(pSurface);
 
-            //OGE_Log("Flip: --- Begin --- \n");
+        if (pResult) m_iSDLConvertedImages++;
+    }
 
-            //SDL_LockSurface(m_pMainScreen->m_pSurface);
-            SDL_LockTexture(m_pMainTexture, NULL, &pDst, &iDstLineSize);
+    m_fConvertTime += OGE_GetStatTime() - fStartTime;
 
-            pSrc = (void *)m_pMainScreen->m_pSurface->pixels;
-            iSrcLineSize = m_pMainScreen->m_pSurface->pitch;
+    return pResult;
+}
+int CogeVideo::GetConvertedImages()
+{
+    return m_iConvertedImages + m_iSDLConvertedImages;
+}
+double CogeVideo::GetConvertTime()
+{
+    return m_fConvertTime;
+}
 
-            OGE_FX_CopyRect((uint8_t*)pDst, iDstLineSize, 0, 0,
-                            (uint8_t*)pSrc, iSrcLineSize,
-                            m_ViewRect.x, m_ViewRect.y, m_ViewRect.w, m_ViewRect.h, m_iBPP);
+void CogeVideo::DelFrameCacheItem(ogeFrameCacheList::iterator it)
+{
+    if (it->key.pImage) it->key.pImage->m_iCachedFrames--;
 
-            SDL_UnlockTexture(m_pMainTexture);
-            //SDL_UnlockSurface(m_pMainScreen->m_pSurface);
+    m_iFrameCacheBytes -= it->iBytes;
 
-            SDL_RenderCopy(m_pMainRenderer, m_pMainTexture, NULL, NULL);
+    delete it->pFrame;
 
-            SDL_RenderPresent(m_pMainRenderer);
+    m_FrameCacheMap.erase(it->key);
+    m_FrameCacheList.erase(it);
+}
 
-            //OGE_Log("Flip: --- End --- \n");
+void CogeVideo::ClearFrameCache()
+{
+    while (m_FrameCacheList.size() > 0) DelFrameCacheItem(m_FrameCacheList.begin());
+}
 
-        }
+void CogeVideo::DelCachedFrames(CogeImage* pImage)
+{
+    ogeFrameCacheList::iterator it = m_FrameCacheList.begin();
 
-    }
-    else
+    while (it != m_FrameCacheList.end() && pImage->m_iCachedFrames > 0)
     {
-        SDL_Surface* pCurrentSurface = (SDL_Surface*) pSurface;
-
-        if (m_pMainTexture && pCurrentSurface)
-        {
-            void* pSrc = NULL;
-            void* pDst = NULL;
-            int iSrcLineSize = 0;
-            int iDstLineSize = 0;
-
-            //SDL_LockSurface(pCurrentSurface->m_pSurface);
-            SDL_LockTexture(m_pMainTexture, NULL, &pDst, &iDstLineSize);
-
-            pSrc = (void *)pCurrentSurface->pixels;
-            iSrcLineSize = pCurrentSurface->pitch;
-
-            OGE_FX_CopyRect((uint8_t*)pDst, iDstLineSize, 0, 0,
-                            (uint8_t*)pSrc, iSrcLineSize,
-                            0, 0, w, h, m_iBPP);
-
-            SDL_UnlockTexture(m_pMainTexture);
-            //SDL_UnlockSurface(pCurrentSurface->m_pSurface);
+        ogeFrameCacheList::iterator itCurrent = it++;
+        if (itCurrent->key.pImage == pImage) DelFrameCacheItem(itCurrent);
+    }
+}
 
-            SDL_RenderCopy(m_pMainRenderer, m_pMainTexture, NULL, NULL);
+CogeImage* CogeVideo::FindCachedFrame(const CogeFrameCacheKey& key)
+{
+    if (m_iFrameCacheSize <= 0) return NULL;
 
-            SDL_RenderPresent(m_pMainRenderer);
-        }
+    ogeFrameCacheMap::iterator it = m_FrameCacheMap.find(key);
 
+    if (it == m_FrameCacheMap.end())
+    {
+        m_iFrameCacheMisses++;
+        return NULL;
     }
 
-#endif
+    m_iFrameCacheHits++;
 
+    // moves it to the front
+    m_FrameCacheList.splice(m_FrameCacheList.begin(), m_FrameCacheList, it->second);
+
+    return it->second->pFrame;
 }
 
-CogeImage* CogeVideo::NewImage(const std::string& sName,
-                               int iWidth, int iHeight, int iColorKeyRGB,
-                               bool bLoadAlphaChannel, bool bCreateLocalClipboard,
-                               const std::string& sFileName)
+CogeImage* CogeVideo::NewCachedFrame(const CogeFrameCacheKey& key, int iWidth, int iHeight, int iColorKeyRGB)
 {
-    CogeImage* pTheNewImage = NULL;
+    if (m_iFrameCacheSize <= 0 || m_pFrontBuffer == NULL || key.pImage == NULL) return NULL;
+    if (iWidth <= 0 || iHeight <= 0) return NULL;
 
-	ogeImageMap::iterator it;
+    int iBytes = iWidth * iHeight * m_pFrontBuffer->format->BytesPerPixel;
+    if (iBytes > m_iFrameCacheSize * 1024) return NULL;
 
-    it = m_ImageMap.find(sName);
-	if (it != m_ImageMap.end())
-	{
-        OGE_Log("The Image name '%s' is in use.\n", sName.c_str());
-        return NULL;
-	}
+    if (m_FrameCacheMap.find(key) != m_FrameCacheMap.end()) return NULL;
 
-	//if (m_ImageMap.find(sName) != m_ImageMap.end()) return NULL;
+    while (m_FrameCacheList.size() > 0 && m_iFrameCacheBytes + iBytes > m_iFrameCacheSize * 1024)
+        DelFrameCacheItem(--m_FrameCacheList.end());
 
-	pTheNewImage = new CogeImage(sName);
-	// set parent
-	pTheNewImage->m_pVideo = this;
+    CogeImage* pFrame = new CogeImage("FRAME_CACHE_ITEM");
 
-	// create surface
-	if (sFileName.length() > 0) pTheNewImage->LoadData(sFileName, bLoadAlphaChannel, bCreateLocalClipboard);
+    pFrame->m_pDotFont = this->m_pDotFont;
+    pFrame->m_pVideo = this;
 
-	// create empty surface if in need
-	if (pTheNewImage->m_pSurface == NULL)
-	{
-	    pTheNewImage->m_pSurface = SDL_CreateRGBSurface(_OGE_VIDEO_DF_MODE_, iWidth, iHeight,
+    pFrame->m_iWidth = iWidth;
+    pFrame->m_iHeight = iHeight;
+
+    pFrame->m_iBPP = m_pFrontBuffer->format->BitsPerPixel;
+
+    pFrame->m_pSurface = SDL_CreateRGBSurface(_OGE_VIDEO_DF_MODE_,
+                                         iWidth, iHeight,
                                          m_pFrontBuffer->format->BitsPerPixel,
                                          m_pFrontBuffer->format->Rmask,
                                          m_pFrontBuffer->format->Gmask,
                                          m_pFrontBuffer->format->Bmask,
                                          m_pFrontBuffer->format->Amask);
 
+    if (pFrame->m_pSurface == NULL)
+    {
+        delete pFrame;
+        return NULL;
     }
 
-    if (pTheNewImage->m_pSurface == NULL)
-	{
-	    delete pTheNewImage;
-		return NULL;
-	}
-
-	// set size
-	pTheNewImage->m_iWidth  = pTheNewImage->m_pSurface->w;
-    pTheNewImage->m_iHeight = pTheNewImage->m_pSurface->h;
-
-    pTheNewImage->m_iBPP = m_pFrontBuffer->format->BitsPerPixel;
+    pFrame->SetPenColor(-1);
 
-	// set parent
-	//pTheNewImage->m_pVideo = this;
+    if (iColorKeyRGB != -1)
+    {
+        pFrame->SetColorKey(iColorKeyRGB);
+        pFrame->FillRect(iColorKeyRGB, 0, 0, iWidth, iHeight);
+    }
 
-	// set default font drawer
-	pTheNewImage->m_pDotFont = this->m_pDotFont;
+    CogeFrameCacheItem item;
+    item.key = key;
+    item.pFrame = pFrame;
+    item.iBytes = iBytes;
 
-	//pTheNewImage->m_pFontStock = this->m_pFontStock;
+    m_FrameCacheList.push_front(item);
+    m_FrameCacheMap[key] = m_FrameCacheList.begin();
 
-	// set default pen color
-	pTheNewImage->SetPenColor(-1);
+    m_iFrameCacheBytes += iBytes;
+    key.pImage->m_iCachedFrames++;
 
-	pTheNewImage->SetColorKey(iColorKeyRGB);
+    return pFrame;
+}
 
-	// set background color
-	//pTheNewImage->SetBgColor(iBgColorRGB);
+bool CogeVideo::IsBGRAMode()
+{
+    return m_bIsBGRA;
+}
 
-	m_ImageMap.insert(ogeImageMap::value_type(sName, pTheNewImage));
+void CogeVideo::FillRect(int iRGBColor, int iLeft, int iTop, int iWidth, int iHeight)
+{
+    //if (m_iState < 0) return;
+    //if (!m_pMainScreen) return;
 
-	return pTheNewImage;
+    // the present thread may still be reading the main screen
+    WaitPresent();
 
+    m_pMainScreen->FillRect(iRGBColor, iLeft, iTop, iWidth, iHeight);
 }
 
-CogeImage* CogeVideo::NewImageFromBuffer(const std::string& sName,
-                        int iWidth, int iHeight, int iColorKeyRGB,
-                        bool bLoadAlphaChannel, bool bCreateLocalClipboard,
-                        char* pBuffer, int iBufferSize)
+void CogeVideo::DrawImage(CogeImage* pSrcImage,
+                    int iDstLeft, int iDstTop,
+                    int iSrcLeft, int iSrcTop, int iSrcWidth, int iSrcHeight)
 {
-    CogeImage* pTheNewImage = NULL;
-
-	ogeImageMap::iterator it;
+    //if (m_iState < 0) return;
 
-    it = m_ImageMap.find(sName);
-	if (it != m_ImageMap.end())
-	{
-        OGE_Log("The Image name '%s' is in use.\n", sName.c_str());
-        return NULL;
-	}
+    WaitPresent();
 
-	//if (m_ImageMap.find(sName) != m_ImageMap.end()) return NULL;
+    //if (m_pMainScreen && pSrcImage)
+    //{
 
-	pTheNewImage = new CogeImage(sName);
+    //iDstLeft = m_iViewX + iDstLeft;
+    //iDstTop  = m_iViewY + iDstTop;
 
-	// create surface
-	if (pBuffer && iBufferSize > 0)
-        pTheNewImage->LoadDataFromBuffer(pBuffer, iBufferSize, bLoadAlphaChannel, bCreateLocalClipboard);
 
-	// create empty surface if in need
-	if (pTheNewImage->m_pSurface == NULL)
-	{
-	    pTheNewImage->m_pSurface = SDL_CreateRGBSurface(_OGE_VIDEO_DF_MODE_, iWidth, iHeight,
-                                         m_pFrontBuffer->format->BitsPerPixel,
-                                         m_pFrontBuffer->format->Rmask,
-                                         m_pFrontBuffer->format->Gmask,
-                                         m_pFrontBuffer->format->Bmask,
-                                         m_pFrontBuffer->format->Amask);
+    m_pMainScreen->Draw(pSrcImage,
+                        iDstLeft,  iDstTop,  //iDstWidth,  iDstHeight,
+                        iSrcLeft,  iSrcTop,  iSrcWidth,  iSrcHeight);
+    //}
 
-    }
+}
 
-    if (pTheNewImage->m_pSurface == NULL)
-	{
-	    delete pTheNewImage;
-		return NULL;
-	}
+void CogeVideo::DrawImage(const std::string& sSrcImageName,
+                           int iDstLeft, int iDstTop,
+                           int iSrcLeft, int iSrcTop, int iSrcWidth, int iSrcHeight)
+{
+    //if (m_iState < 0) return;
+    //if (!m_pMainScreen) return;
 
-	// set size
-	pTheNewImage->m_iWidth  = pTheNewImage->m_pSurface->w;
-    pTheNewImage->m_iHeight = pTheNewImage->m_pSurface->h;
+    CogeImage* pSrcImage = FindImage(sSrcImageName);
 
-    pTheNewImage->m_iBPP = m_pFrontBuffer->format->BitsPerPixel;
+    if (pSrcImage)
+    {
 
-	// set parent
-	pTheNewImage->m_pVideo = this;
+    WaitPresent();
 
-	// set default font drawer
-	pTheNewImage->m_pDotFont = this->m_pDotFont;
+    //iDstLeft = m_iViewX + iDstLeft;
+    //iDstTop  = m_iViewY + iDstTop;
 
-	// set default pen color
-	pTheNewImage->SetPenColor(-1);
 
-	pTheNewImage->SetColorKey(iColorKeyRGB);
+    m_pMainScreen->Draw(pSrcImage,
+                        iDstLeft,  iDstTop,  //iDstWidth,  iDstHeight,
+                        iSrcLeft,  iSrcTop,  iSrcWidth,  iSrcHeight);
+    }
 
-	m_ImageMap.insert(ogeImageMap::value_type(sName, pTheNewImage));
 
-	return pTheNewImage;
 }
 
-CogeImage* CogeVideo::FindImage(const std::string& sName)
+void CogeVideo::DotTextOut(char* pText, int x, int y,
+                            int iMaxWidth, int iFontSpace , int iLineSpace)
 {
-    ogeImageMap::iterator it;
+    //if (m_iState < 0) return;
+    //if (!m_pDotFont) return;
+    //if (!m_pMainScreen) return;
 
-    it = m_ImageMap.find(sName);
-	if (it != m_ImageMap.end()) return it->second;
-	else return NULL;
+    WaitPresent();
 
+    if(m_pMainScreen)
+    m_pMainScreen->DotTextOut(pText, x, y, iMaxWidth, iFontSpace, iLineSpace);
 }
 
-CogeImage* CogeVideo::GetImage(const std::string& sName,
-                               int iWidth, int iHeight, int iColorKeyRGB,
-                               bool bLoadAlphaChannel, bool bCreateLocalClipboard,
-                               const std::string& sFileName)
+void CogeVideo::PrintText(const std::string& sText, int x, int y, CogeFont* pFont, int iAlpha)
 {
-    CogeImage* pMatchedImage = FindImage(sName);
-    if (!pMatchedImage)
-        pMatchedImage = NewImage(sName, iWidth, iHeight, iColorKeyRGB, bLoadAlphaChannel, bCreateLocalClipboard, sFileName);
-    //if (pMatchedImage) pMatchedImage->Hire();
-    return pMatchedImage;
+    WaitPresent();
 
+    if(m_pMainScreen)
+    {
+        if(pFont == NULL) pFont = m_pDefaultFont;
+        m_pMainScreen->PrintText(sText, x, y, pFont, iAlpha);
+    }
 }
 
-CogeImage* CogeVideo::GetImageFromBuffer(const std::string& sName,
-                        int iWidth, int iHeight, int iColorKeyRGB,
-                        bool bLoadAlphaChannel, bool bCreateLocalClipboard,
-                        char* pBuffer, int iBufferSize)
+int CogeVideo::Update(int x, int y)
 {
-    CogeImage* pMatchedImage = FindImage(sName);
-    if (!pMatchedImage)
-        pMatchedImage = NewImageFromBuffer(sName, iWidth, iHeight, iColorKeyRGB, bLoadAlphaChannel, bCreateLocalClipboard, pBuffer, iBufferSize);
-    return pMatchedImage;
-}
+    if (m_iState < 0) return 0;
 
-bool CogeVideo::DelImage(const std::string& sName)
-{
-    CogeImage* pMatchedImage = NULL;
-    ogeImageMap::iterator it = m_ImageMap.find(sName);
-	if (it != m_ImageMap.end()) pMatchedImage = it->second;
+    // get FPS
 
-	if (pMatchedImage)
+	int iCurrentTime = SDL_GetTicks();
+
+	Uint64 iCounter = OGE_GetPerfCounter();
+
+	if (m_iLockedFPS > 0 && m_iFrameTicks > 0)
 	{
-	    //pMatchedImage->Fire();
-	    if (pMatchedImage->m_iTotalUsers > 0) return false;
-		m_ImageMap.erase(it);
-		delete pMatchedImage;
-		return true;
+	    /*
+		while (iCurrentTime - m_iGlobalTime < m_iFrameInterval)
+		{
+			SDL_Delay(10);  // cool down cpu time ...
+			iCurrentTime = SDL_GetTicks();
+		}
+		*/
+
+		if (iCounter < m_iNextFrameCounter)
+		{
+			//SDL_Delay(10);  // cool down cpu time ...
+			//iCurrentTime = SDL_GetTicks();
+
+			// what the dropped frame has changed goes with the next one (all of the view if it had no rects)
+			if (!m_bPartialUpdate)
+			{
+			    m_UpdateRects.clear();
+			    m_iLastUploadX = -1;
+			    m_iLastUploadY = -1;
+			}
+			m_bPartialUpdate = false;
+
+			return 0;
+		}
+
+		// the next one is due an interval after this one was due (not after now), unless it is too late for that
+		m_iNextFrameCounter += m_iFrameTicks;
+		if (m_iNextFrameCounter <= iCounter) m_iNextFrameCounter = iCounter + m_iFrameTicks;
+
+		//if(iCurrentTime - m_iGlobalTime < m_iFrameInterval) return 0;
+		// QueryPerformanceCounter(iNowTime);
 
 	}
-	return false;
+	else m_iFrameInterval = iCurrentTime - m_iGlobalTime;
 
-}
+	m_iFrameCount++;
 
-bool CogeVideo::DelImage(CogeImage* pImage)
-{
-    if(!pImage) return false;
+	if (iCurrentTime - m_iLastFrameTime >= 1000)
+	{
+	    m_iOldFrameRate = m_iFrameRate;
+		m_iFrameRate = m_iFrameCount;
+		m_iFrameCount = 0;
+		m_iLastFrameTime = iCurrentTime;
 
-    CogeImage* pMatchedImage = NULL;
-    ogeImageMap::iterator it = m_ImageMap.begin();
+		//if(m_iFrameRate < m_iFrameRateWanted-5) m_iFrameInterval -= 2;
+		//if(m_iFrameRate > m_iFrameRateWanted+5) m_iFrameInterval += 2;
+		//if (m_bTimerActive) m_iTimerTime++;
+	}
 
-    while(it != m_ImageMap.end())
-    {
-        pMatchedImage = it->second;
+	m_iGlobalTime = iCurrentTime;
 
-        if(pMatchedImage == pImage)
-        {
-            if (pMatchedImage->m_iTotalUsers > 0) return false;
-            else
-            {
-                m_ImageMap.erase(it);
-                delete pMatchedImage;
-                return true;
-            }
-        }
+	// the last frame is shown before the view changes
+	WaitPresent();
 
-        it++;
-    }
+	// flip
 
-    return false;
+    m_ViewRect.x = x;
+    m_ViewRect.y = y;
 
-}
 
-void CogeVideo::DelAllImages()
-{
-    // free all Images
-	ogeImageMap::iterator it;
-	CogeImage* pMatchedImage = NULL;
+#ifdef __OGE_WITH_GLWIN__
 
-	it = m_ImageMap.begin();
-	int iCount = m_ImageMap.size();
-	for(int i=0; i<iCount; i++)
+    //if(m_iState == 0 && m_pMainWindow)
+    //{
+    //    //SDL_Flip(m_pFrontBuffer);
+    //    SDL_UpdateWindowSurface(m_pMainWindow);
+    //}
+
+    /*
+    if (m_iState > 0 && m_pMainTexture && m_pMainScreen && (m_pMainScreen->m_pSurface))
 	{
-	    pMatchedImage = it->second;
-	    delete pMatchedImage;
-	    it++;
+	    void* pSrc = NULL;
+        void* pDst = NULL;
+        int iSrcLineSize = 0;
+        int iDstLineSize = 0;
+
+        //OGE_Log("Flip: --- Begin --- \n");
+
+        //SDL_LockSurface(m_pMainScreen->m_pSurface);
+        SDL_LockTexture(m_pMainTexture, NULL, &pDst, &iDstLineSize);
+
+        pSrc = (void *)m_pMainScreen->m_pSurface->pixels;
+        iSrcLineSize = m_pMainScreen->m_pSurface->pitch;
+
+        OGE_FX_CopyRect((uint8_t*)pDst, iDstLineSize, 0, 0,
+                        (uint8_t*)pSrc, iSrcLineSize,
+                        m_ViewRect.x, m_ViewRect.y, m_ViewRect.w, m_ViewRect.h, m_iBPP);
+
+        SDL_UnlockTexture(m_pMainTexture);
+        //SDL_UnlockSurface(m_pMainScreen->m_pSurface);
+
+        SDL_RenderCopy(m_pMainRenderer, m_pMainTexture, NULL, NULL);
+
+        SDL_RenderPresent(m_pMainRenderer);
+
+        //OGE_Log("Flip: --- End --- \n");
+
 	}
-	m_ImageMap.clear();
+	*/
 
-}
+	if (m_iState > 0)
+	{
+	    if (!StartPresent()) UpdateRenderer(m_pMainScreen->m_pSurface);
+	}
+	else
+	{
+	    // the frame is not uploaded, so the texture is out of date
+	    m_iLastUploadX = -1;
+	    m_iLastUploadY = -1;
+	}
 
-/*
-bool CogeVideo::InstallFont(const std::string& sFontName, int iFontSize, const std::string& sFontFileName)
-{
 
-    if(m_pFontStock &&
-       m_pFontStock->NewFont(sFontName, iFontSize, sFontFileName) != NULL)
-    return true;
+#else
 
-    printf("Install TTF Font Error: Can not load ttf font file: ");
-    printf(sFontFileName.c_str());
-    printf("\n");
+	if (m_iState > 0 && m_pFrontBuffer && m_pMainScreen && (m_pMainScreen->m_pSurface))
+	{
+	    if (!StartPresent())
+	    {
+	        DrawFrame();
+	        ShowFrame();
+	    }
+	}
 
-    return false;
+#endif
+
+	// the rects are only for this frame
+	m_UpdateRects.clear();
+	m_bPartialUpdate = false;
+
+	return 1;
 
-}
-void CogeVideo::UninstallFont(const std::string& sFontName)
-{
-    if(m_pFontStock) m_pFontStock->DelFont(sFontName);
 }
 
-bool CogeVideo::UseFont(const std::string& sFontName)
+int CogeVideo::PresentThreadProc(void* pData)
 {
-    if(m_pFontStock) return m_pFontStock->PrepareFont(sFontName) >= 0;
-    else return false;
+    CogeVideo* pVideo = (CogeVideo*) pData;
+
+    while(true)
+    {
+        SDL_SemWait(pVideo->m_pPresentStart);
+
+        if (pVideo->m_bQuitPresent) break;
+
+        pVideo->DrawFrame();
+
+        SDL_SemPost(pVideo->m_pPresentDone);
+    }
+
+    return 0;
 }
-*/
 
-CogeFont* CogeVideo::NewFont(const std::string& sFontName, int iFontSize, const std::string& sFileName)
+void CogeVideo::SetPresentThread(bool bEnable)
 {
-    if(m_pFontStock) return m_pFontStock->NewFont(sFontName, iFontSize, sFileName);
-    else return NULL;
+    if (bEnable == (m_pPresentThread != NULL)) return;
+
+    if (!bEnable)
+    {
+        StopPresentThread();
+        return;
+    }
+
+    if (m_pPresentStart == NULL) m_pPresentStart = SDL_CreateSemaphore(0);
+    if (m_pPresentDone == NULL) m_pPresentDone = SDL_CreateSemaphore(0);
+
+    if (m_pPresentStart == NULL || m_pPresentDone == NULL) return;
+
+    m_bQuitPresent = false;
+
+#if SDL_VERSION_ATLEAST(2,0,0)
+    m_pPresentThread = SDL_CreateThread(PresentThreadProc, "oge_present", this);
+#else
+    m_pPresentThread = SDL_CreateThread(PresentThreadProc, this);
+#endif
+
+    if (m_pPresentThread == NULL) OGE_Log("Failed to start the present thread.\n");
 }
-CogeFont* CogeVideo::NewFontFromBuffer(const std::string& sFontName, int iFontSize, char* pBuffer, int iBufferSize)
+bool CogeVideo::GetPresentThread()
 {
-    if(m_pFontStock) return m_pFontStock->NewFontFromBuffer(sFontName, iFontSize, pBuffer, iBufferSize);
-    else return NULL;
+    return m_pPresentThread != NULL;
 }
-CogeFont* CogeVideo::FindFont(const std::string& sFontName, int iFontSize)
+
+void CogeVideo::StopPresentThread()
 {
-    if(m_pFontStock) return m_pFontStock->FindFont(sFontName, iFontSize);
-    else return NULL;
+    WaitPresent();
+
+    if (m_pPresentThread)
+    {
+        m_bQuitPresent = true;
+        SDL_SemPost(m_pPresentStart);
+        SDL_WaitThread(m_pPresentThread, NULL);
+        m_pPresentThread = NULL;
+        m_bQuitPresent = false;
+    }
+
+    if (m_pPresentStart)
+    {
+        SDL_DestroySemaphore(m_pPresentStart);
+        m_pPresentStart = NULL;
+    }
+
+    if (m_pPresentDone)
+    {
+        SDL_DestroySemaphore(m_pPresentDone);
+        m_pPresentDone = NULL;
+    }
 }
-CogeFont* CogeVideo::GetFont(const std::string& sFontName, int iFontSize, const std::string& sFileName)
+
+// gives the frame to the present thread, false if it has to be presented at once
+bool CogeVideo::StartPresent()
 {
-    if(m_pFontStock) return m_pFontStock->GetFont(sFontName, iFontSize, sFileName);
-    else return NULL;
+    if (m_pPresentThread == NULL || m_bPresentPending || m_pMainScreen == NULL || m_pMainScreen->m_pSurface == NULL) return false;
+
+#ifdef __OGE_WITH_GLWIN__
+
+    // nothing to copy for the direct screen
+    if (m_bDirectScreen || m_pMainTexture == NULL) return false;
+
+    void* pPixels = NULL;
+    int iPitch = 0;
+
+    // the texture is locked here (and unlocked by ShowFrame()), the renderer is only used on this thread
+    if (SDL_LockTexture(m_pMainTexture, NULL, &pPixels, &iPitch) != 0) return false;
+
+    m_pPresentPixels = (uint8_t*) pPixels;
+    m_iPresentPitch = iPitch;
+
+    m_iUploadBytes = m_ViewRect.w * m_ViewRect.h * (m_iBPP >> 3);
+
+#else
+
+    // only a software front buffer can be drawn on by another thread
+    if (m_pFrontBuffer == NULL || SDL_MUSTLOCK(m_pFrontBuffer)) return false;
+
+#endif
+
+    m_bPresentPending = true;
+
+    SDL_SemPost(m_pPresentStart);
+
+    return true;
 }
-int CogeVideo::DelFont(const std::string& sFontName, int iFontSize)
+
+void CogeVideo::WaitPresent()
 {
-    if(m_pFontStock) return m_pFontStock->DelFont(sFontName, iFontSize);
-    else return -1;
+    if (!m_bPresentPending) return;
+
+    SDL_SemWait(m_pPresentDone);
+
+    m_bPresentPending = false;
+
+    ShowFrame();
 }
 
-CogeFont* CogeVideo::GetDefaultFont()
+void CogeVideo::PollPresent()
 {
-    return m_pDefaultFont;
+    if (!m_bPresentPending) return;
+
+    if (SDL_SemTryWait(m_pPresentDone) != 0) return;
+
+    m_bPresentPending = false;
+
+    ShowFrame();
 }
-void CogeVideo::SetDefaultFont(CogeFont* pFont)
+
+void CogeVideo::DrawFrame()
 {
-    //if(m_pDefaultFont != pFont) m_pDefaultFont = pFont;
+#ifdef __OGE_WITH_GLWIN__
 
-    if(m_pDefaultFont == pFont) return;
+    OGE_FX_CopyRect(m_pPresentPixels, m_iPresentPitch, 0, 0,
+                    (uint8_t*)m_pMainScreen->m_pSurface->pixels, m_pMainScreen->m_pSurface->pitch,
+                    m_ViewRect.x, m_ViewRect.y, m_ViewRect.w, m_ViewRect.h, m_iBPP);
 
-    if(m_pDefaultFont) m_pDefaultFont->Fire();
-    m_pDefaultFont = pFont;
-    if(m_pDefaultFont) m_pDefaultFont->Hire();
-}
+#else
 
-const std::string& CogeVideo::GetDefaultCharset()
-{
-    if(m_pFontStock) return m_pFontStock->GetDefaultCharset();
-    else return _OGE_EMPTY_STR_;
-}
-void CogeVideo::SetDefaultCharset(const std::string& sDefaultCharset)
-{
-    if(m_pFontStock) m_pFontStock->SetDefaultCharset(sDefaultCharset);
-}
+    if(m_bNeedStretch)
+    {
+        /*
+        SDL_Rect rcDst = {0};
 
-const std::string& CogeVideo::GetSystemCharset()
-{
-    if(m_pFontStock) return m_pFontStock->GetSystemCharset();
-    else return _OGE_EMPTY_STR_;
-}
-void CogeVideo::SetSystemCharset(const std::string& sSystemCharset)
-{
-    if(m_pFontStock) m_pFontStock->SetSystemCharset(sSystemCharset);
-}
+        rcDst.x = 0;
+        rcDst.y = 0;
+        rcDst.w = m_iRealWidth;
+        rcDst.y = m_iRealHeight;
 
-/*--------------- Dot Matrix Font ----------------*/
+        SDL_SoftStretch(m_pMainScreen->m_pSurface, &m_ViewRect, m_pFrontBuffer, &rcDst);
+        */
 
-//constructor
-CogeDotFont::CogeDotFont()
-//m_pVideo(pVideo)
-{
-	//asc12 = NULL;
-	asc16 = NULL;
-	//hzk12 = NULL;
-	hzk16 = NULL;
 
-}
+        //bool bNeedLockSrc = SDL_MUSTLOCK(m_pMainScreen->m_pSurface);
+        //if(bNeedLockSrc) bNeedLockSrc = SDL_LockSurface(m_pMainScreen->m_pSurface) == 0;
+        //bool bNeedLockDst = SDL_MUSTLOCK(m_pFrontBuffer);
+        //if(bNeedLockDst) bNeedLockDst = SDL_LockSurface(m_pFrontBuffer) == 0;
 
-//destructor
-CogeDotFont::~CogeDotFont()
-{
-	//if(asc12) { delete asc12; asc12=NULL; }
-	//if(asc16) { delete asc16; asc16=NULL; }
-	if(asc16) { free(asc16); asc16=NULL; }
+        uint8_t* pSrc = (Uint8 *)m_pMainScreen->m_pSurface->pixels;
+        int iSrcLineSize = m_pMainScreen->m_pSurface->pitch;
 
-	//if(hzk12) { delete hzk12; hzk12=NULL; }
-	//if(hzk16) { delete hzk16; hzk16=NULL; }
-	if(hzk16) { free(hzk16); hzk16=NULL; }
+        uint8_t* pDst = (Uint8 *)m_pFrontBuffer->pixels;
+        int iDstLineSize = m_pFrontBuffer->pitch;
 
-}
+        OGE_FX_BltPresent(pDst, iDstLineSize,
+                            0, 0, m_iRealWidth, m_iRealHeight,
+                            pSrc, iSrcLineSize,
+                            m_ViewRect.x, m_ViewRect.y, m_ViewRect.w, m_ViewRect.h, m_iBPP, m_iPresentFilter);
 
+        //if (bNeedLockSrc) SDL_UnlockSurface(m_pMainScreen->m_pSurface);
+        //if (bNeedLockDst) SDL_UnlockSurface(m_pFrontBuffer);
 
-bool CogeDotFont::InstallFont(const char* sFontFileName, int iType)
-{
-	bool bResult = false;
-	std::ifstream fontfile;
-	fontfile.open(sFontFileName, std::ios::binary);
-	if (!fontfile.is_open()) return false;
+    }
+    else
+    {
+
+#if defined(__ANDROID__) || defined(__IPHONE__)
+
+        //bool bNeedLockSrc = SDL_MUSTLOCK(m_pMainScreen->m_pSurface);
+        //if(bNeedLockSrc) bNeedLockSrc = SDL_LockSurface(m_pMainScreen->m_pSurface) == 0;
+        //bool bNeedLockDst = SDL_MUSTLOCK(m_pFrontBuffer);
+        //if(bNeedLockDst) bNeedLockDst = SDL_LockSurface(m_pFrontBuffer) == 0;
+
+        uint8_t* pSrc = (Uint8 *)m_pMainScreen->m_pSurface->pixels;
+        int iSrcLineSize = m_pMainScreen->m_pSurface->pitch;
+
+        uint8_t* pDst = (Uint8 *)m_pFrontBuffer->pixels;
+        int iDstLineSize = m_pFrontBuffer->pitch;
+
+        OGE_FX_CopyRect(pDst, iDstLineSize,
+                    0, 0,
+                    pSrc, iSrcLineSize,
+                    m_ViewRect.x, m_ViewRect.y,
+                    m_ViewRect.w, m_ViewRect.h, m_iBPP);
+
+        //if (bNeedLockSrc) SDL_UnlockSurface(m_pMainScreen->m_pSurface);
+        //if (bNeedLockDst) SDL_UnlockSurface(m_pFrontBuffer);
+
+#else
+
+        SDL_BlitSurface(m_pMainScreen->m_pSurface, &m_ViewRect, m_pFrontBuffer, 0);
+
+#endif
 
-	switch(iType)
-	{
-    case 0:
-        asc16 = (char*)malloc(160*16);
-		fontfile.read(asc16, 160*16);
-		bResult = true;
-		break;
-    case 1:
-        hzk16 = (char*)malloc(94*87*16 * 2);
-		fontfile.read(hzk16, 94*87*16 * 2);
-		bResult = true;
-		break;
     }
 
-    /*
-	if (sType == "_asc12_")
-	{
-		asc12 = (char*)malloc(160*12);
-		fontfile.read(asc12, 160*12);
-		bResult = true;
-	}
-	else if (sType == "_asc16_")
-	{
-		asc16 = (char*)malloc(160*16);
-		fontfile.read(asc16, 160*16);
-		bResult = true;
-	}
-	else if (sType == "_hzk12_")
-	{
-		hzk12 = (char*)malloc(94*87*12 * 2);
-		fontfile.read(hzk12, 94*87*12 * 2);
-		bResult = true;
-	}
-	else if (sType == "_hzk16_")
-	{
-		hzk16 = (char*)malloc(94*87*16 * 2);
-		fontfile.read(hzk16, 94*87*16 * 2);
-		bResult = true;
-	}
-	*/
 
-	fontfile.close();
-	return bResult;
+#endif
 }
 
-void CogeDotFont::UninstallFont(int iType)
+void CogeVideo::ShowFrame()
 {
-	// do something ...
-}
+#ifdef __OGE_WITH_GLWIN__
 
-int CogeDotFont::GetTextWidth(const char* pText, int iFontSpace)
-{
-	int iResult = 0;
-	while((unsigned char)(*pText))
-	{
-		if ((unsigned char)(*pText) <= 0x00a0) // if ascii
-		{
-			iResult += (8+iFontSpace);
-			pText ++;
-		}
-		else if ( (pText+1) && (unsigned char)(*pText) > 0x00a0 && (unsigned char)(*(pText+1)) > 0x00a0 ) // if hzk
-		{
-			iResult += (_OGE_DOT_FONT_SIZE_+iFontSpace);
-			pText += 2;
-		}
-		else pText ++;
-	}
-	return iResult;
+    if (m_pPresentPixels == NULL) return;
+
+    m_pPresentPixels = NULL;
+    m_iPresentPitch = 0;
+
+    SDL_UnlockTexture(m_pMainTexture);
+
+    if (m_iState < 0) return;
+
+    m_iLastUploadX = m_ViewRect.x;
+    m_iLastUploadY = m_ViewRect.y;
+
+    SDL_RenderCopy(m_pMainRenderer, m_pMainTexture, NULL, NULL);
+
+    SDL_RenderPresent(m_pMainRenderer);
+
+#else
+
+    if (m_iState < 0) return;
+
+    //SDL_UpdateRect(m_pFrontBuffer, 0, 0, m_iWidth, m_iHeight);
 
+    SDL_Flip(m_pFrontBuffer);
+
+#endif
 }
 
-int CogeDotFont::GetTextHeight(const char* pText, int iMaxWidth,
-                               int iFontSpace, int iLineSpace)
+#ifdef __OGE_WITH_GLWIN__
+
+/* clips the rects to the view (into its coords) and merges the ones which overlap or touch,
+   returns false if they cover so much of the view that a single upload of all of it would be cheaper
+*/
+static bool OGE_PrepareUpdateRects(std::vector<CogeRect>& rects, const SDL_Rect& view)
 {
-	int iResult = 0;
-	int x = 0;
-	if((unsigned char)(*pText) != 0) iResult += (_OGE_DOT_FONT_SIZE_+iLineSpace);
-	bool bNextLine = (unsigned char)(*pText) == 10 || (unsigned char)(*pText) == 13;
-	while((unsigned char)(*pText))
-	{
-		if (bNextLine)
-		{
-			iResult += (_OGE_DOT_FONT_SIZE_+iLineSpace);
-			x = 0;
-			bNextLine = false;
-			continue;
-		}
+    size_t n = 0;
 
-		if ((unsigned char)(*pText) <= 0x00a0) // if ascii
-		{
-			if ((unsigned char)(*pText) == 10 || (unsigned char)(*pText) == 13)
-			{
-				pText ++;
-				bNextLine = true;
-                continue;
-			}
+    for(size_t i=0; i<rects.size(); i++)
+    {
+        CogeRect rc = rects[i];
 
-			if (x+8+iFontSpace > iMaxWidth)
-			{
-				bNextLine = true;
-                continue;
-			}
+        if(rc.left < view.x) rc.left = view.x;
+        if(rc.top < view.y) rc.top = view.y;
+        if(rc.right > view.x + view.w) rc.right = view.x + view.w;
+        if(rc.bottom > view.y + view.h) rc.bottom = view.y + view.h;
 
-			x += (8+iFontSpace);
-			pText ++;
-		}
-		else if ( (pText+1) && (unsigned char)(*pText) > 0x00a0 && (unsigned char)(*(pText+1)) > 0x00a0 ) // if hzk
-		{
-			if (x+_OGE_DOT_FONT_SIZE_+iFontSpace > iMaxWidth)
-			{
-				bNextLine = true;
-                continue;
-			}
+        if(rc.right <= rc.left || rc.bottom <= rc.top) continue;
 
-			x += (_OGE_DOT_FONT_SIZE_+iFontSpace);
-			pText += 2;
-		}
-		else pText ++;
-	}
+        rc.left   -= view.x;
+        rc.right  -= view.x;
+        rc.top    -= view.y;
+        rc.bottom -= view.y;
 
-	//if(x > 0 && iResult==0) iResult += (_OGE_DOT_FONT_SIZE_+iLineSpace);
+        rects[n++] = rc;
+    }
 
-	return iResult;
+    rects.resize(n);
+
+    bool bMerged = true;
+
+    while(bMerged)
+    {
+        bMerged = false;
+
+        for(size_t i=0; i<rects.size(); i++)
+        {
+            size_t j = i + 1;
+
+            while(j < rects.size())
+            {
+                CogeRect& a = rects[i];
+                CogeRect& b = rects[j];
+
+                if(b.left <= a.right && a.left <= b.right && b.top <= a.bottom && a.top <= b.bottom)
+                {
+                    if(b.left < a.left) a.left = b.left;
+                    if(b.top < a.top) a.top = b.top;
+                    if(b.right > a.right) a.right = b.right;
+                    if(b.bottom > a.bottom) a.bottom = b.bottom;
+
+                    rects[j] = rects.back();
+                    rects.pop_back();
+
+                    bMerged = true;
+                }
+                else j++;
+            }
+        }
+    }
+
+    int iArea = 0;
+
+    for(size_t i=0; i<rects.size(); i++)
+        iArea += (rects[i].right - rects[i].left) * (rects[i].bottom - rects[i].top);
+
+    return iArea * 2 <= view.w * view.h;
 }
 
-void CogeDotFont::OneLine(const char* pText, char* pDstBuffer, int iLineSize, int iBPP, int iPenColor,
-			                             int x, int y, int iWidth, int iFontSpace)
+#endif
+
+void CogeVideo::UpdateRenderer(void* pSurface, int x, int y, unsigned int w, unsigned int h)
 {
-	char* pFontData = NULL;
-	char* pDst = NULL;
-	//int iPenColor = m_pVideo->FormatColor(iPenColorRGB);
-	int iMask = 0;
-	int iBeginX = x;
-	int i, j;
 
-	while((unsigned char)(*pText))
-	{
-		if ((unsigned char)(*pText) <= 0x00a0) // if ascii
-		{
-			if (x+8+iFontSpace - iBeginX > iWidth) break;
+#ifdef __OGE_WITH_GLWIN__
 
-            /*
-			switch (iFontSize)
-			{
-			case 12:
-				pFontData = asc12;
-				break;
-			case 16:
-				pFontData = asc16;
-				break;
-			default:
-				pFontData = asc12;
-			}
-			*/
+    //OGE_Log("Calling UpdateRenderer(): %d ... ", (int)pSurface);
 
-            pFontData = asc16;
+    WaitPresent();
 
-			if (pFontData) pFontData += ((unsigned char)(*pText)) * _OGE_DOT_FONT_SIZE_;
-			else
-			{
-				pText++;
-				continue;
-			}
+    if(pSurface == (void*)(m_pMainScreen->m_pSurface))
+    {
+        // the default screen is the locked texture itself, the unlock uploads the frame
+        if (m_pScreenSurface && m_pMainScreen == m_pDefaultScreen && m_ViewRect.x == 0 && m_ViewRect.y == 0)
+        {
+            SDL_Surface* pMapped = m_pDefaultScreen->m_pSurface;
 
-			switch (iBPP)
-			{
-            case 8:
-				for(i=0; i<_OGE_DOT_FONT_SIZE_; i++)
-				{
-					iMask = 0x80;
-					for(j=0;j<8;j++)
-					{
-						if (((unsigned char)(*pFontData) & iMask) > 0)  // if there is a dot ...
-						{
-							pDst = pDstBuffer + iLineSize * (y+i) + (x+j);
-							(*((char*)pDst)) = iPenColor;
-						}
-						iMask >>= 1;
-					}
-					pFontData++;
-				}
-				x += (iFontSpace+8);
-				break;
-			case 15:
-			case 16:
-				for(i=0; i<_OGE_DOT_FONT_SIZE_; i++)
-				{
-					iMask = 0x80;
-					for(j=0;j<8;j++)
-					{
-						if (((unsigned char)(*pFontData) & iMask) > 0)  // if there is a dot ...
-						{
-							pDst = pDstBuffer + iLineSize * (y+i) + 2*(x+j);
-							(*((short*)pDst)) = iPenColor;
-						}
-						iMask >>= 1;
-					}
-					pFontData++;
-				}
-				x += (iFontSpace+8);
-				break;
+            SDL_UnlockTexture(m_pMainTexture);
 
-			case 32:
-				for(i=0; i<_OGE_DOT_FONT_SIZE_; i++)
-				{
-					iMask = 0x80;
-					for(j=0;j<8;j++)
-					{
-						if (((unsigned char)(*pFontData) & iMask) > 0)  // if there is a dot ...
-						{
-							pDst = pDstBuffer + iLineSize * (y+i) + 4*(x+j);
-							(*((int*)pDst)) = iPenColor;
-						}
-						iMask >>= 1;
-					}
-					pFontData++;
-				}
-				x += (iFontSpace+8);
-				break;
+            m_iUploadBytes = pMapped->w * pMapped->h * (m_iBPP >> 3);
 
-			} // end of switch
+            m_iLastUploadX = -1;
+            m_iLastUploadY = -1;
 
-			pText++;
+            m_UpdateRects.clear();
+            m_bPartialUpdate = false;
 
-		}  // end if ascii
-		else if ( (pText+1) && (unsigned char)(*pText) > 0x00a0 && (unsigned char)(*(pText+1)) > 0x00a0 ) // if hzk
-		{
-			if (x+_OGE_DOT_FONT_SIZE_+iFontSpace - iBeginX > iWidth) break;
+            SDL_RenderCopy(m_pMainRenderer, m_pMainTexture, NULL, NULL);
 
-            /*
-			switch (iFontSize)
-			{
-			case 12:
-				pFontData = hzk12;
-				break;
-			case 16:
-				pFontData = hzk16;
-				break;
-			default:
-				pFontData = hzk12;
-			}
-			*/
+            SDL_RenderPresent(m_pMainRenderer);
 
-            pFontData = hzk16;
+            void* pPixels = NULL;
+            int iPitch = 0;
 
-			if (pFontData) pFontData += ( ((unsigned char)(*pText)-0x00a1)*94 + ((unsigned char)(*(pText+1))-0x00a1) ) * _OGE_DOT_FONT_SIZE_ * 2;
-			else
-			{
-				pText += 2;
-				continue;
-			}
+            if (SDL_LockTexture(m_pMainTexture, NULL, &pPixels, &iPitch) == 0)
+            {
+                if (pPixels == pMapped->pixels && iPitch == pMapped->pitch) return;
+                SDL_UnlockTexture(m_pMainTexture);
+            }
 
-			switch (iBPP)
-			{
-            case 8:
-				for(i=0; i<_OGE_DOT_FONT_SIZE_; i++)
-				{
-					//iMask = 0x8000;
-					pFontData += 1;
-					iMask = 0x80;
-					for(j=8;j<_OGE_DOT_FONT_SIZE_;j++)
-					{
-						if (((*(short*)pFontData) & iMask) > 0)  // if there is a dot ...
-						{
-							pDst = pDstBuffer + iLineSize * (y+i) + (x+j);
-							(*((char*)pDst)) = iPenColor;
-						}
-						iMask >>= 1;
-					}
+            // the pixels have moved (so their content is gone), the screen goes back to its own surface,
+            // which has missed all the frames since it was mapped, so the scene has to draw all of it again
+            OGE_Log("The direct screen has been lost.\n");
 
-					pFontData -= 1;
-					iMask = 0x80;
-					for(j=0;j<8;j++)
-					{
-						if (((*(short*)pFontData) & iMask) > 0)  // if there is a dot ...
-						{
-							pDst = pDstBuffer + iLineSize * (y+i) + (x+j);
-							(*((char*)pDst)) = iPenColor;
-						}
-						iMask >>= 1;
-					}
+            m_pDefaultScreen->m_pSurface = m_pScreenSurface;
+            m_pScreenSurface = NULL;
+            SDL_FreeSurface(pMapped);
 
-					pFontData += 2;
-				}
-				x += (iFontSpace+_OGE_DOT_FONT_SIZE_);
-				break;
-			case 15:
-			case 16:
-				for(i=0; i<_OGE_DOT_FONT_SIZE_; i++)
-				{
-					//iMask = 0x8000;
-					pFontData += 1;
-					iMask = 0x80;
-					for(j=8;j<_OGE_DOT_FONT_SIZE_;j++)
-					{
-						if (((*(short*)pFontData) & iMask) > 0)  // if there is a dot ...
-						{
-							pDst = pDstBuffer + iLineSize * (y+i) + 2*(x+j);
-							(*((short*)pDst)) = iPenColor;
-						}
-						iMask >>= 1;
-					}
-					pFontData -= 1;
-					iMask = 0x80;
-					for(j=0;j<8;j++)
-					{
-						if (((*(short*)pFontData) & iMask) > 0)  // if there is a dot ...
-						{
-							pDst = pDstBuffer + iLineSize * (y+i) + 2*(x+j);
-							(*((short*)pDst)) = iPenColor;
-						}
-						iMask >>= 1;
-					}
+            m_bDirectScreen = false;
+            m_bScreenLost = true;
 
-					pFontData += 2;
-				}
-				x += (iFontSpace+_OGE_DOT_FONT_SIZE_);
-				break;
+            return;
+        }
 
-			case 32:
-				for(i=0; i<_OGE_DOT_FONT_SIZE_; i++)
-				{
-					//iMask = 0x8000;
-					pFontData += 1;
-					iMask = 0x80;
-					for(j=8;j<_OGE_DOT_FONT_SIZE_;j++)
-					{
-						if (((*(short*)pFontData) & iMask) > 0)  // if there is a dot ...
-						{
-							pDst = pDstBuffer + iLineSize * (y+i) + 4*(x+j);
-							(*((int*)pDst)) = iPenColor;
-						}
-						iMask >>= 1;
-					}
-					pFontData -= 1;
-					iMask = 0x80;
-					for(j=0;j<8;j++)
-					{
-						if (((*(short*)pFontData) & iMask) > 0)  // if there is a dot ...
-						{
-							pDst = pDstBuffer + iLineSize * (y+i) + 4*(x+j);
-							(*((int*)pDst)) = iPenColor;
-						}
-						iMask >>= 1;
-					}
+        if (m_pMainTexture && m_pMainScreen)
+        {
+            // it has to be copied, the texture is needed for that
+            UnmapScreen();
 
-					pFontData += 2;
-				}
-				x += (iFontSpace+_OGE_DOT_FONT_SIZE_);
-				break;
+            void* pSrc = NULL;
+            void* pDst = NULL;
+            int iSrcLineSize = 0;
+            int iDstLineSize = 0;
 
-			} // end of switch
+            int iPixelSize = m_iBPP >> 3;
 
-			pText += 2;
+            //OGE_Log("Flip: --- Begin --- \n");
 
-		}  // end of if hzk ...
-		else
-		{
-			pText++;
-		}
+            pSrc = (void *)m_pMainScreen->m_pSurface->pixels;
+            iSrcLineSize = m_pMainScreen->m_pSurface->pitch;
 
-	} // end while ...
+            // the texture keeps the last frame, so only what has changed needs to go (if the view is the same)
+            bool bUploadAll = !m_bPartialUpdate || m_ViewRect.x != m_iLastUploadX || m_ViewRect.y != m_iLastUploadY;
 
+            if(!bUploadAll) bUploadAll = !OGE_PrepareUpdateRects(m_UpdateRects, m_ViewRect);
 
-}
+            m_iUploadBytes = 0;
 
-void CogeDotFont::Lines(const char* pText, char* pDstBuffer, int iLineSize, int iBPP, int iPenColor,
-			                        int x, int y, int iWidth, int iHeight,
-									int iFontSpace, int iLineSpace)
-{
-	char* pFontData = NULL;
-	char* pDst = NULL;
-	//int iPenColor = m_pVideo->FormatColor(iPenColorRGB);
-	int iMask = 0;
-	int iBeginX = x;
-	int iBeginY = y;
-	int i, j;
-	bool bNextLine = (unsigned char)(*pText) == 10 || (unsigned char)(*pText) == 13;
+            if(bUploadAll)
+            {
+                //SDL_LockSurface(m_pMainScreen->m_pSurface);
+                SDL_LockTexture(m_pMainTexture, NULL, &pDst, &iDstLineSize);
 
-	while((unsigned char)(*pText))
-	{
-		if (bNextLine)
-		{
-			y += (_OGE_DOT_FONT_SIZE_+iLineSpace);
-			x = iBeginX;
-			bNextLine = false;
-			continue;
-		}
+                OGE_FX_CopyRect((uint8_t*)pDst, iDstLineSize, 0, 0,
+                                (uint8_t*)pSrc, iSrcLineSize,
+                                m_ViewRect.x, m_ViewRect.y, m_ViewRect.w, m_ViewRect.h, m_iBPP);
 
-		if (y+_OGE_DOT_FONT_SIZE_+iLineSpace - iBeginY > iHeight) break;
+                SDL_UnlockTexture(m_pMainTexture);
+                //SDL_UnlockSurface(m_pMainScreen->m_pSurface);
 
-		if ((unsigned char)(*pText) <= 0x00a0) // if ascii
-		{
+                m_iUploadBytes = m_ViewRect.w * m_ViewRect.h * iPixelSize;
+            }
+            else
+            {
+                for(size_t i=0; i<m_UpdateRects.size(); i++)
+                {
+                    const CogeRect& rc = m_UpdateRects[i];
 
-			if ((unsigned char)(*pText) == 10 || (unsigned char)(*pText) == 13)
-			{
-				pText ++;
-				bNextLine = true;
-                continue;
-			}
+                    SDL_Rect rcDst;
+                    rcDst.x = rc.left;
+                    rcDst.y = rc.top;
+                    rcDst.w = rc.right - rc.left;
+                    rcDst.h = rc.bottom - rc.top;
 
-			if (x+8+iFontSpace - iBeginX > iWidth)
-			{
-				bNextLine = true;
-                continue;
-			}
+                    uint8_t* pRect = (uint8_t*)pSrc + (m_ViewRect.y + rc.top) * iSrcLineSize + (m_ViewRect.x + rc.left) * iPixelSize;
 
-            /*
-			switch (iFontSize)
-			{
-			case 12:
-				pFontData = asc12;
-				break;
-			case 16:
-				pFontData = asc16;
-				break;
-			default:
-				pFontData = asc12;
-			}
-			*/
+                    SDL_UpdateTexture(m_pMainTexture, &rcDst, pRect, iSrcLineSize);
 
-            pFontData = asc16;
+                    m_iUploadBytes += rcDst.w * rcDst.h * iPixelSize;
+                }
+            }
 
-			if (pFontData) pFontData += ((unsigned char)(*pText)) * _OGE_DOT_FONT_SIZE_;
-			else
-			{
+            m_iLastUploadX = m_ViewRect.x;
+            m_iLastUploadY = m_ViewRect.y;
+
+            m_UpdateRects.clear();
+            m_bPartialUpdate = false;
+
+            SDL_RenderCopy(m_pMainRenderer, m_pMainTexture, NULL, NULL);
+
+            SDL_RenderPresent(m_pMainRenderer);
+
+            // the next frames are drawn straight into the texture
+            if (m_bDirectScreen && m_pMainScreen == m_pDefaultScreen) MapScreen();
+
+            //OGE_Log("Flip: --- End --- \n");
+
+        }
+
+    }
+    else
+    {
+        SDL_Surface* pCurrentSurface = (SDL_Surface*) pSurface;
+
+        if (m_pMainTexture && pCurrentSurface)
+        {
+            UnmapScreen();
+
+            void* pSrc = NULL;
+            void* pDst = NULL;
+            int iSrcLineSize = 0;
+            int iDstLineSize = 0;
+
+            //SDL_LockSurface(pCurrentSurface->m_pSurface);
+            SDL_LockTexture(m_pMainTexture, NULL, &pDst, &iDstLineSize);
+
+            pSrc = (void *)pCurrentSurface->pixels;
+            iSrcLineSize = pCurrentSurface->pitch;
+
+            OGE_FX_CopyRect((uint8_t*)pDst, iDstLineSize, 0, 0,
+                            (uint8_t*)pSrc, iSrcLineSize,
+                            0, 0, w, h, m_iBPP);
+
+            SDL_UnlockTexture(m_pMainTexture);
+            //SDL_UnlockSurface(pCurrentSurface->m_pSurface);
+
+            // the view is not in the texture any more
+            m_iLastUploadX = -1;
+            m_iLastUploadY = -1;
+            m_iUploadBytes = w * h * (m_iBPP >> 3);
+
+            SDL_RenderCopy(m_pMainRenderer, m_pMainTexture, NULL, NULL);
+
+            SDL_RenderPresent(m_pMainRenderer);
+        }
+
+    }
+
+#endif
+
+}
+
+CogeImage* CogeVideo::NewImage(const std::string& sName,
+                               int iWidth, int iHeight, int iColorKeyRGB,
+                               bool bLoadAlphaChannel, bool bCreateLocalClipboard,
+                               const std::string& sFileName)
+{
+    CogeImage* pTheNewImage = NULL;
+
+	ogeImageMap::iterator it;
+
+    it = m_ImageMap.find(sName);
+	if (it != m_ImageMap.end())
+	{
+        OGE_Log("The Image name '%s' is in use.\n", sName.c_str());
+        return NULL;
+	}
+
+	//if (m_ImageMap.find(sName) != m_ImageMap.end()) return NULL;
+
+	pTheNewImage = new CogeImage(sName);
+	// set parent
+	pTheNewImage->m_pVideo = this;
+
+	// create surface
+	if (sFileName.length() > 0) pTheNewImage->LoadData(sFileName, bLoadAlphaChannel, bCreateLocalClipboard);
+
+	// create empty surface if in need
+	if (pTheNewImage->m_pSurface == NULL)
+	{
+	    pTheNewImage->m_pSurface = SDL_CreateRGBSurface(_OGE_VIDEO_DF_MODE_, iWidth, iHeight,
+                                         m_pFrontBuffer->format->BitsPerPixel,
+                                         m_pFrontBuffer->format->Rmask,
+                                         m_pFrontBuffer->format->Gmask,
+                                         m_pFrontBuffer->format->Bmask,
+                                         m_pFrontBuffer->format->Amask);
+
+    }
+
+    if (pTheNewImage->m_pSurface == NULL)
+	{
+	    delete pTheNewImage;
+		return NULL;
+	}
+
+	// set size
+	pTheNewImage->m_iWidth  = pTheNewImage->m_pSurface->w;
+    pTheNewImage->m_iHeight = pTheNewImage->m_pSurface->h;
+
+    pTheNewImage->m_iBPP = m_pFrontBuffer->format->BitsPerPixel;
+
+	// set parent
+	//pTheNewImage->m_pVideo = this;
+
+	// set default font drawer
+	pTheNewImage->m_pDotFont = this->m_pDotFont;
+
+	//pTheNewImage->m_pFontStock = this->m_pFontStock;
+
+	// set default pen color
+	pTheNewImage->SetPenColor(-1);
+
+	pTheNewImage->SetColorKey(iColorKeyRGB);
+
+	// pack the loaded sprites
+	bool bIndexed = false;
+	if (m_iIndexedImages > 0 && !bLoadAlphaChannel && sFileName.length() > 0)
+        bIndexed = pTheNewImage->BuildIndexed(m_iIndexedImages > 1);
+	if (!bIndexed && m_iColorKeySpans > 0 && iColorKeyRGB != -1 && sFileName.length() > 0)
+        pTheNewImage->BuildSpans(m_iColorKeySpans > 1);
+
+	// set background color
+	//pTheNewImage->SetBgColor(iBgColorRGB);
+
+	m_ImageMap.insert(ogeImageMap::value_type(sName, pTheNewImage));
+
+	return pTheNewImage;
+
+}
+
+CogeImage* CogeVideo::NewImageFromBuffer(const std::string& sName,
+                        int iWidth, int iHeight, int iColorKeyRGB,
+                        bool bLoadAlphaChannel, bool bCreateLocalClipboard,
+                        char* pBuffer, int iBufferSize)
+{
+    CogeImage* pTheNewImage = NULL;
+
+	ogeImageMap::iterator it;
+
+    it = m_ImageMap.find(sName);
+	if (it != m_ImageMap.end())
+	{
+        OGE_Log("The Image name '%s' is in use.\n", sName.c_str());
+        return NULL;
+	}
+
+	//if (m_ImageMap.find(sName) != m_ImageMap.end()) return NULL;
+
+	pTheNewImage = new CogeImage(sName);
+	// set parent
+	pTheNewImage->m_pVideo = this;
+
+	// create surface
+	if (pBuffer && iBufferSize > 0)
+        pTheNewImage->LoadDataFromBuffer(pBuffer, iBufferSize, bLoadAlphaChannel, bCreateLocalClipboard);
+
+	// create empty surface if in need
+	if (pTheNewImage->m_pSurface == NULL)
+	{
+	    pTheNewImage->m_pSurface = SDL_CreateRGBSurface(_OGE_VIDEO_DF_MODE_, iWidth, iHeight,
+                                         m_pFrontBuffer->format->BitsPerPixel,
+                                         m_pFrontBuffer->format->Rmask,
+                                         m_pFrontBuffer->format->Gmask,
+                                         m_pFrontBuffer->format->Bmask,
+                                         m_pFrontBuffer->format->Amask);
+
+    }
+
+    if (pTheNewImage->m_pSurface == NULL)
+	{
+	    delete pTheNewImage;
+		return NULL;
+	}
+
+	// set size
+	pTheNewImage->m_iWidth  = pTheNewImage->m_pSurface->w;
+    pTheNewImage->m_iHeight = pTheNewImage->m_pSurface->h;
+
+    pTheNewImage->m_iBPP = m_pFrontBuffer->format->BitsPerPixel;
+
+	// set parent
+	pTheNewImage->m_pVideo = this;
+
+	// set default font drawer
+	pTheNewImage->m_pDotFont = this->m_pDotFont;
+
+	// set default pen color
+	pTheNewImage->SetPenColor(-1);
+
+	pTheNewImage->SetColorKey(iColorKeyRGB);
+
+	// pack the loaded sprites
+	bool bIndexed = false;
+	if (m_iIndexedImages > 0 && !bLoadAlphaChannel && pBuffer && iBufferSize > 0)
+        bIndexed = pTheNewImage->BuildIndexed(m_iIndexedImages > 1);
+	if (!bIndexed && m_iColorKeySpans > 0 && iColorKeyRGB != -1 && pBuffer && iBufferSize > 0)
+        pTheNewImage->BuildSpans(m_iColorKeySpans > 1);
+
+	m_ImageMap.insert(ogeImageMap::value_type(sName, pTheNewImage));
+
+	return pTheNewImage;
+}
+
+SDL_Surface* CogeVideo::FindAtlas(const std::string& sFileName)
+{
+    ogeAtlasMap::iterator it = m_AtlasMap.find(sFileName);
+    if (it != m_AtlasMap.end()) return it->second;
+    else return NULL;
+}
+
+SDL_Surface* CogeVideo::LoadAtlas(const std::string& sFileName, bool bLoadAlphaChannel,
+                        char* pBuffer, int iBufferSize)
+{
+    SDL_Surface* pAtlas = FindAtlas(sFileName);
+    if (pAtlas) return pAtlas;
+
+    SDL_Surface* img = NULL;
+
+    if (pBuffer && iBufferSize > 0) img = IMG_Load_RW(SDL_RWFromMem((void*)pBuffer, iBufferSize), 0);
+    else img = IMG_Load(sFileName.c_str());
+
+    if (img == NULL)
+    {
+        OGE_Log("Couldn't load atlas sheet '%s': %s\n", sFileName.c_str(), SDL_GetError());
+        return NULL;
+    }
+
+    // no color key and no rle on the sheet, its images only point into its pixels
+    pAtlas = ConvertImage(img, bLoadAlphaChannel);
+
+    SDL_FreeSurface(img);
+
+    if (pAtlas == NULL)
+    {
+        OGE_Log("Could not convert atlas sheet '%s': %s\n", sFileName.c_str(), SDL_GetError());
+        return NULL;
+    }
+
+    m_AtlasMap.insert(ogeAtlasMap::value_type(sFileName, pAtlas));
+
+    return pAtlas;
+}
+
+void CogeVideo::FreeUnusedAtlases()
+{
+    ogeAtlasMap::iterator it = m_AtlasMap.begin();
+
+    while (it != m_AtlasMap.end())
+    {
+        // the map holds one reference, the images on the sheet hold the others
+        if (it->second->refcount <= 1)
+        {
+            SDL_FreeSurface(it->second);
+            m_AtlasMap.erase(it++);
+        }
+        else it++;
+    }
+}
+
+CogeImage* CogeVideo::NewImageFromAtlas(const std::string& sName,
+                        int iWidth, int iHeight, int iColorKeyRGB,
+                        bool bLoadAlphaChannel, bool bCreateLocalClipboard,
+                        SDL_Surface* pAtlas, int iAtlasX, int iAtlasY)
+{
+    if (pAtlas == NULL) return NULL;
+
+    ogeImageMap::iterator it = m_ImageMap.find(sName);
+	if (it != m_ImageMap.end())
+	{
+        OGE_Log("The Image name '%s' is in use.\n", sName.c_str());
+        return NULL;
+	}
+
+	CogeImage* pTheNewImage = new CogeImage(sName);
+	pTheNewImage->m_pVideo = this;
+
+	if (!pTheNewImage->LoadAtlasRect(pAtlas, iAtlasX, iAtlasY, iWidth, iHeight, bLoadAlphaChannel, bCreateLocalClipboard))
+	{
+	    OGE_Log("The rect of image '%s' is out of its atlas sheet.\n", sName.c_str());
+	    delete pTheNewImage;
+		return NULL;
+	}
+
+	pTheNewImage->m_iWidth  = pTheNewImage->m_pSurface->w;
+    pTheNewImage->m_iHeight = pTheNewImage->m_pSurface->h;
+
+    pTheNewImage->m_iBPP = m_pFrontBuffer->format->BitsPerPixel;
+
+	pTheNewImage->m_pDotFont = this->m_pDotFont;
+
+	pTheNewImage->SetPenColor(-1);
+
+	// SetColorKey() would give the image its own pixels, the key does not change them
+	if (iColorKeyRGB != -1)
+	{
+	    pTheNewImage->m_iColorKey = FormatColor(iColorKeyRGB);
+	    pTheNewImage->m_iColorKeyRGB = iColorKeyRGB;
+	    SDL_SetColorKey(pTheNewImage->m_pSurface, OGE_SRCCOLORKEY, pTheNewImage->m_iColorKey);
+	}
+
+	// pack the loaded sprites (they get their own data then)
+	bool bIndexed = false;
+	if (m_iIndexedImages > 0 && !bLoadAlphaChannel)
+        bIndexed = pTheNewImage->BuildIndexed(m_iIndexedImages > 1);
+	if (!bIndexed && m_iColorKeySpans > 0 && iColorKeyRGB != -1)
+        pTheNewImage->BuildSpans(m_iColorKeySpans > 1);
+
+	m_ImageMap.insert(ogeImageMap::value_type(sName, pTheNewImage));
+
+	return pTheNewImage;
+}
+
+CogeImage* CogeVideo::FindImage(const std::string& sName)
+{
+    ogeImageMap::iterator it;
+
+    it = m_ImageMap.find(sName);
+	if (it != m_ImageMap.end()) return it->second;
+	else return NULL;
+
+}
+
+CogeImage* CogeVideo::GetImage(const std::string& sName,
+                               int iWidth, int iHeight, int iColorKeyRGB,
+                               bool bLoadAlphaChannel, bool bCreateLocalClipboard,
+                               const std::string& sFileName)
+{
+    CogeImage* pMatchedImage = FindImage(sName);
+    if (!pMatchedImage)
+        pMatchedImage = NewImage(sName, iWidth, iHeight, iColorKeyRGB, bLoadAlphaChannel, bCreateLocalClipboard, sFileName);
+    //if (pMatchedImage) pMatchedImage->Hire();
+    return pMatchedImage;
+
+}
+
+CogeImage* CogeVideo::GetImageFromBuffer(const std::string& sName,
+                        int iWidth, int iHeight, int iColorKeyRGB,
+                        bool bLoadAlphaChannel, bool bCreateLocalClipboard,
+                        char* pBuffer, int iBufferSize)
+{
+    CogeImage* pMatchedImage = FindImage(sName);
+    if (!pMatchedImage)
+        pMatchedImage = NewImageFromBuffer(sName, iWidth, iHeight, iColorKeyRGB, bLoadAlphaChannel, bCreateLocalClipboard, pBuffer, iBufferSize);
+    return pMatchedImage;
+}
+
+bool CogeVideo::DelImage(const std::string& sName)
+{
+    CogeImage* pMatchedImage = NULL;
+    ogeImageMap::iterator it = m_ImageMap.find(sName);
+	if (it != m_ImageMap.end()) pMatchedImage = it->second;
+
+	if (pMatchedImage)
+	{
+	    //pMatchedImage->Fire();
+	    if (pMatchedImage->m_iTotalUsers > 0) return false;
+		m_ImageMap.erase(it);
+		delete pMatchedImage;
+		FreeUnusedAtlases();
+		return true;
+
+	}
+	return false;
+
+}
+
+bool CogeVideo::DelImage(CogeImage* pImage)
+{
+    if(!pImage) return false;
+
+    CogeImage* pMatchedImage = NULL;
+    ogeImageMap::iterator it = m_ImageMap.begin();
+
+    while(it != m_ImageMap.end())
+    {
+        pMatchedImage = it->second;
+
+        if(pMatchedImage == pImage)
+        {
+            if (pMatchedImage->m_iTotalUsers > 0) return false;
+            else
+            {
+                m_ImageMap.erase(it);
+                delete pMatchedImage;
+                FreeUnusedAtlases();
+                return true;
+            }
+        }
+
+        it++;
+    }
+
+    return false;
+
+}
+
+void CogeVideo::DelAllImages()
+{
+    // free all Images
+	ogeImageMap::iterator it;
+	CogeImage* pMatchedImage = NULL;
+
+	it = m_ImageMap.begin();
+	int iCount = m_ImageMap.size();
+	for(int i=0; i<iCount; i++)
+	{
+	    pMatchedImage = it->second;
+	    delete pMatchedImage;
+	    it++;
+	}
+	m_ImageMap.clear();
+
+	FreeUnusedAtlases();
+
+}
+
+/*
+bool CogeVideo::InstallFont(const std::string& sFontName, int iFontSize, const std::string& sFontFileName)
+{
+
+    if(m_pFontStock &&
+       m_pFontStock->NewFont(sFontName, iFontSize, sFontFileName) != NULL)
+    return true;
+
+    printf("Install TTF Font Error: Can not load ttf font file: ");
+    printf(sFontFileName.c_str());
+    printf("\n");
+
+    return false;
+
+}
+void CogeVideo::UninstallFont(const std::string& sFontName)
+{
+    if(m_pFontStock) m_pFontStock->DelFont(sFontName);
+}
+
+bool CogeVideo::UseFont(const std::string& sFontName)
+{
+    if(m_pFontStock) return m_pFontStock->PrepareFont(sFontName) >= 0;
+    else return false;
+}
+*/
+
+CogeFont* CogeVideo::NewFont(const std::string& sFontName, int iFontSize, const std::string& sFileName)
+{
+    if(m_pFontStock) return m_pFontStock->NewFont(sFontName, iFontSize, sFileName);
+    else return NULL;
+}
+CogeFont* CogeVideo::NewFontFromBuffer(const std::string& sFontName, int iFontSize, char* pBuffer, int iBufferSize)
+{
+    if(m_pFontStock) return m_pFontStock->NewFontFromBuffer(sFontName, iFontSize, pBuffer, iBufferSize);
+    else return NULL;
+}
+CogeFont* CogeVideo::FindFont(const std::string& sFontName, int iFontSize)
+{
+    if(m_pFontStock) return m_pFontStock->FindFont(sFontName, iFontSize);
+    else return NULL;
+}
+CogeFont* CogeVideo::GetFont(const std::string& sFontName, int iFontSize, const std::string& sFileName)
+{
+    if(m_pFontStock) return m_pFontStock->GetFont(sFontName, iFontSize, sFileName);
+    else return NULL;
+}
+int CogeVideo::DelFont(const std::string& sFontName, int iFontSize)
+{
+    if(m_pFontStock) return m_pFontStock->DelFont(sFontName, iFontSize);
+    else return -1;
+}
+
+CogeFont* CogeVideo::GetDefaultFont()
+{
+    return m_pDefaultFont;
+}
+void CogeVideo::SetDefaultFont(CogeFont* pFont)
+{
+    //if(m_pDefaultFont != pFont) m_pDefaultFont = pFont;
+
+    if(m_pDefaultFont == pFont) return;
+
+    if(m_pDefaultFont) m_pDefaultFont->Fire();
+    m_pDefaultFont = pFont;
+    if(m_pDefaultFont) m_pDefaultFont->Hire();
+}
+
+const std::string& CogeVideo::GetDefaultCharset()
+{
+    if(m_pFontStock) return m_pFontStock->GetDefaultCharset();
+    else return _OGE_EMPTY_STR_;
+}
+void CogeVideo::SetDefaultCharset(const std::string& sDefaultCharset)
+{
+    if(m_pFontStock) m_pFontStock->SetDefaultCharset(sDefaultCharset);
+}
+
+const std::string& CogeVideo::GetSystemCharset()
+{
+    if(m_pFontStock) return m_pFontStock->GetSystemCharset();
+    else return _OGE_EMPTY_STR_;
+}
+void CogeVideo::SetSystemCharset(const std::string& sSystemCharset)
+{
+    if(m_pFontStock) m_pFontStock->SetSystemCharset(sSystemCharset);
+}
+
+/*--------------- Dot Matrix Font ----------------*/
+
+//constructor
+CogeDotFont::CogeDotFont()
+//m_pVideo(pVideo)
+{
+	//asc12 = NULL;
+	asc16 = NULL;
+	//hzk12 = NULL;
+	hzk16 = NULL;
+
+}
+
+//destructor
+CogeDotFont::~CogeDotFont()
+{
+	//if(asc12) { delete asc12; asc12=NULL; }
+	//if(asc16) { delete asc16; asc16=NULL; }
+	if(asc16) { free(asc16); asc16=NULL; }
+
+	//if(hzk12) { delete hzk12; hzk12=NULL; }
+	//if(hzk16) { delete hzk16; hzk16=NULL; }
+	if(hzk16) { free(hzk16); hzk16=NULL; }
+
+}
+
+
+bool CogeDotFont::InstallFont(const char* sFontFileName, int iType)
+{
+	bool bResult = false;
+	std::ifstream fontfile;
+	fontfile.open(sFontFileName, std::ios::binary);
+	if (!fontfile.is_open()) return false;
+
+	switch(iType)
+	{
+    case 0:
+        asc16 = (char*)malloc(160*16);
+		fontfile.read(asc16, 160*16);
+		bResult = true;
+		break;
+    case 1:
+        hzk16 = (char*)malloc(94*87*16 * 2);
+		fontfile.read(hzk16, 94*87*16 * 2);
+		bResult = true;
+		break;
+    }
+
+    /*
+	if (sType == "_asc12_")
+	{
+		asc12 = (char*)malloc(160*12);
+		fontfile.read(asc12, 160*12);
+		bResult = true;
+	}
+	else if (sType == "_asc16_")
+	{
+		asc16 = (char*)malloc(160*16);
+		fontfile.read(asc16, 160*16);
+		bResult = true;
+	}
+	else if (sType == "_hzk12_")
+	{
+		hzk12 = (char*)malloc(94*87*12 * 2);
+		fontfile.read(hzk12, 94*87*12 * 2);
+		bResult = true;
+	}
+	else if (sType == "_hzk16_")
+	{
+		hzk16 = (char*)malloc(94*87*16 * 2);
+		fontfile.read(hzk16, 94*87*16 * 2);
+		bResult = true;
+	}
+	*/
+
+	fontfile.close();
+	return bResult;
+}
+
+void CogeDotFont::UninstallFont(int iType)
+{
+	// do something ...
+}
+
+int CogeDotFont::GetTextWidth(const char* pText, int iFontSpace)
+{
+	int iResult = 0;
+	while((unsigned char)(*pText))
+	{
+		if ((unsigned char)(*pText) <= 0x00a0) // if ascii
+		{
+			iResult += (8+iFontSpace);
+			pText ++;
+		}
+		else if ( (pText+1) && (unsigned char)(*pText) > 0x00a0 && (unsigned char)(*(pText+1)) > 0x00a0 ) // if hzk
+		{
+			iResult += (_OGE_DOT_FONT_SIZE_+iFontSpace);
+			pText += 2;
+		}
+		else pText ++;
+	}
+	return iResult;
+
+}
+
+int CogeDotFont::GetTextHeight(const char* pText, int iMaxWidth,
+                               int iFontSpace, int iLineSpace)
+{
+	int iResult = 0;
+	int x = 0;
+	if((unsigned char)(*pText) != 0) iResult += (_OGE_DOT_FONT_SIZE_+iLineSpace);
+	bool bNextLine = (unsigned char)(*pText) == 10 || (unsigned char)(*pText) == 13;
+	while((unsigned char)(*pText))
+	{
+		if (bNextLine)
+		{
+			iResult += (_OGE_DOT_FONT_SIZE_+iLineSpace);
+			x = 0;
+			bNextLine = false;
+			continue;
+		}
+
+		if ((unsigned char)(*pText) <= 0x00a0) // if ascii
+		{
+			if ((unsigned char)(*pText) == 10 || (unsigned char)(*pText) == 13)
+			{
+				pText ++;
+				bNextLine = true;
+                continue;
+			}
+
+			if (x+8+iFontSpace > iMaxWidth)
+			{
+				bNextLine = true;
+                continue;
+			}
+
+			x += (8+iFontSpace);
+			pText ++;
+		}
+		else if ( (pText+1) && (unsigned char)(*pText) > 0x00a0 && (unsigned char)(*(pText+1)) > 0x00a0 ) // if hzk
+		{
+			if (x+_OGE_DOT_FONT_SIZE_+iFontSpace > iMaxWidth)
+			{
+				bNextLine = true;
+                continue;
+			}
+
+			x += (_OGE_DOT_FONT_SIZE_+iFontSpace);
+			pText += 2;
+		}
+		else pText ++;
+	}
+
+	//if(x > 0 && iResult==0) iResult += (_OGE_DOT_FONT_SIZE_+iLineSpace);
+
+	return iResult;
+}
+
+void CogeDotFont::OneLine(const char* pText, char* pDstBuffer, int iLineSize, int iBPP, int iPenColor,
+			                             int x, int y, int iWidth, int iFontSpace)
+{
+	char* pFontData = NULL;
+	char* pDst = NULL;
+	//int iPenColor = m_pVideo->FormatColor(iPenColorRGB);
+	int iMask = 0;
+	int iBeginX = x;
+	int i, j;
+
+	while((unsigned char)(*pText))
+	{
+		if ((unsigned char)(*pText) <= 0x00a0) // if ascii
+		{
+			if (x+8+iFontSpace - iBeginX > iWidth) break;
+
+            /*
+			switch (iFontSize)
+			{
+			case 12:
+				pFontData = asc12;
+				break;
+			case 16:
+				pFontData = asc16;
+				break;
+			default:
+				pFontData = asc12;
+			}
+			*/
+
+            pFontData = asc16;
+
+			if (pFontData) pFontData += ((unsigned char)(*pText)) * _OGE_DOT_FONT_SIZE_;
+			else
+			{
+				pText++;
+				continue;
+			}
+
+			switch (iBPP)
+			{
+            case 8:
+				for(i=0; i<_OGE_DOT_FONT_SIZE_; i++)
+				{
+					iMask = 0x80;
+					for(j=0;j<8;j++)
+					{
+						if (((unsigned char)(*pFontData) & iMask) > 0)  // if there is a dot ...
+						{
+							pDst = pDstBuffer + iLineSize * (y+i) + (x+j);
+							(*((char*)pDst)) = iPenColor;
+						}
+						iMask >>= 1;
+					}
+					pFontData++;
+				}
+				x += (iFontSpace+8);
+				break;
+			case 15:
+			case 16:
+				for(i=0; i<_OGE_DOT_FONT_SIZE_; i++)
+				{
+					iMask = 0x80;
+					for(j=0;j<8;j++)
+					{
+						if (((unsigned char)(*pFontData) & iMask) > 0)  // if there is a dot ...
+						{
+							pDst = pDstBuffer + iLineSize * (y+i) + 2*(x+j);
+							(*((short*)pDst)) = iPenColor;
+						}
+						iMask >>= 1;
+					}
+					pFontData++;
+				}
+				x += (iFontSpace+8);
+				break;
+
+			case 32:
+				for(i=0; i<_OGE_DOT_FONT_SIZE_; i++)
+				{
+					iMask = 0x80;
+					for(j=0;j<8;j++)
+					{
+						if (((unsigned char)(*pFontData) & iMask) > 0)  // if there is a dot ...
+						{
+							pDst = pDstBuffer + iLineSize * (y+i) + 4*(x+j);
+							(*((int*)pDst)) = iPenColor;
+						}
+						iMask >>= 1;
+					}
+					pFontData++;
+				}
+				x += (iFontSpace+8);
+				break;
+
+			} // end of switch
+
+			pText++;
+
+		}  // end if ascii
+		else if ( (pText+1) && (unsigned char)(*pText) > 0x00a0 && (unsigned char)(*(pText+1)) > 0x00a0 ) // if hzk
+		{
+			if (x+_OGE_DOT_FONT_SIZE_+iFontSpace - iBeginX > iWidth) break;
+
+            /*
+			switch (iFontSize)
+			{
+			case 12:
+				pFontData = hzk12;
+				break;
+			case 16:
+				pFontData = hzk16;
+				break;
+			default:
+				pFontData = hzk12;
+			}
+			*/
+
+            pFontData = hzk16;
+
+			if (pFontData) pFontData += ( ((unsigned char)(*pText)-0x00a1)*94 + ((unsigned char)(*(pText+1))-0x00a1) ) * _OGE_DOT_FONT_SIZE_ * 2;
+			else
+			{
+				pText += 2;
+				continue;
+			}
+
+			switch (iBPP)
+			{
+            case 8:
+				for(i=0; i<_OGE_DOT_FONT_SIZE_; i++)
+				{
+					//iMask = 0x8000;
+					pFontData += 1;
+					iMask = 0x80;
+					for(j=8;j<_OGE_DOT_FONT_SIZE_;j++)
+					{
+						if (((*(short*)pFontData) & iMask) > 0)  // if there is a dot ...
+						{
+							pDst = pDstBuffer + iLineSize * (y+i) + (x+j);
+							(*((char*)pDst)) = iPenColor;
+						}
+						iMask >>= 1;
+					}
+
+					pFontData -= 1;
+					iMask = 0x80;
+					for(j=0;j<8;j++)
+					{
+						if (((*(short*)pFontData) & iMask) > 0)  // if there is a dot ...
+						{
+							pDst = pDstBuffer + iLineSize * (y+i) + (x+j);
+							(*((char*)pDst)) = iPenColor;
+						}
+						iMask >>= 1;
+					}
+
+					pFontData += 2;
+				}
+				x += (iFontSpace+_OGE_DOT_FONT_SIZE_);
+				break;
+			case 15:
+			case 16:
+				for(i=0; i<_OGE_DOT_FONT_SIZE_; i++)
+				{
+					//iMask = 0x8000;
+					pFontData += 1;
+					iMask = 0x80;
+					for(j=8;j<_OGE_DOT_FONT_SIZE_;j++)
+					{
+						if (((*(short*)pFontData) & iMask) > 0)  // if there is a dot ...
+						{
+							pDst = pDstBuffer + iLineSize * (y+i) + 2*(x+j);
+							(*((short*)pDst)) = iPenColor;
+						}
+						iMask >>= 1;
+					}
+					pFontData -= 1;
+					iMask = 0x80;
+					for(j=0;j<8;j++)
+					{
+						if (((*(short*)pFontData) & iMask) > 0)  // if there is a dot ...
+						{
+							pDst = pDstBuffer + iLineSize * (y+i) + 2*(x+j);
+							(*((short*)pDst)) = iPenColor;
+						}
+						iMask >>= 1;
+					}
+
+					pFontData += 2;
+				}
+				x += (iFontSpace+_OGE_DOT_FONT_SIZE_);
+				break;
+
+			case 32:
+				for(i=0; i<_OGE_DOT_FONT_SIZE_; i++)
+				{
+					//iMask = 0x8000;
+					pFontData += 1;
+					iMask = 0x80;
+					for(j=8;j<_OGE_DOT_FONT_SIZE_;j++)
+					{
+						if (((*(short*)pFontData) & iMask) > 0)  // if there is a dot ...
+						{
+							pDst = pDstBuffer + iLineSize * (y+i) + 4*(x+j);
+							(*((int*)pDst)) = iPenColor;
+						}
+						iMask >>= 1;
+					}
+					pFontData -= 1;
+					iMask = 0x80;
+					for(j=0;j<8;j++)
+					{
+						if (((*(short*)pFontData) & iMask) > 0)  // if there is a dot ...
+						{
+							pDst = pDstBuffer + iLineSize * (y+i) + 4*(x+j);
+							(*((int*)pDst)) = iPenColor;
+						}
+						iMask >>= 1;
+					}
+
+					pFontData += 2;
+				}
+				x += (iFontSpace+_OGE_DOT_FONT_SIZE_);
+				break;
+
+			} // end of switch
+
+			pText += 2;
+
+		}  // end of if hzk ...
+		else
+		{
+			pText++;
+		}
+
+	} // end while ...
+
+
+}
+
+void CogeDotFont::Lines(const char* pText, char* pDstBuffer, int iLineSize, int iBPP, int iPenColor,
+			                        int x, int y, int iWidth, int iHeight,
+									int iFontSpace, int iLineSpace)
+{
+	char* pFontData = NULL;
+	char* pDst = NULL;
+	//int iPenColor = m_pVideo->FormatColor(iPenColorRGB);
+	int iMask = 0;
+	int iBeginX = x;
+	int iBeginY = y;
+	int i, j;
+	bool bNextLine = (unsigned char)(*pText) == 10 || (unsigned char)(*pText) == 13;
+
+	while((unsigned char)(*pText))
+	{
+		if (bNextLine)
+		{
+			y += (_OGE_DOT_FONT_SIZE_+iLineSpace);
+			x = iBeginX;
+			bNextLine = false;
+			continue;
+		}
+
+		if (y+_OGE_DOT_FONT_SIZE_+iLineSpace - iBeginY > iHeight) break;
+
+		if ((unsigned char)(*pText) <= 0x00a0) // if ascii
+		{
+
+			if ((unsigned char)(*pText) == 10 || (unsigned char)(*pText) == 13)
+			{
+				pText ++;
+				bNextLine = true;
+                continue;
+			}
+
+			if (x+8+iFontSpace - iBeginX > iWidth)
+			{
+				bNextLine = true;
+                continue;
+			}
+
+            /*
+			switch (iFontSize)
+			{
+			case 12:
+				pFontData = asc12;
+				break;
+			case 16:
+				pFontData = asc16;
+				break;
+			default:
+				pFontData = asc12;
+			}
+			*/
+
+            pFontData = asc16;
+
+			if (pFontData) pFontData += ((unsigned char)(*pText)) * _OGE_DOT_FONT_SIZE_;
+			else
+			{
 				pText++;
 				continue;
 			}
 
-			switch (iBPP)
-			{
-            case 8:
-                for(i=0; i<_OGE_DOT_FONT_SIZE_; i++)
-				{
-					iMask = 0x80;
-					for(j=0;j<8;j++)
-					{
-						if (((unsigned char)(*pFontData) & iMask) > 0)  // if there is a dot ...
-						{
-							pDst = pDstBuffer + iLineSize * (y+i) + (x+j);
-							(*((char*)pDst)) = iPenColor;
-						}
-						iMask >>= 1;
-					}
-					pFontData++;
-				}
-				x += (iFontSpace+8);
-				break;
-			case 15:
-			case 16:
-				for(i=0; i<_OGE_DOT_FONT_SIZE_; i++)
-				{
-					iMask = 0x80;
-					for(j=0;j<8;j++)
-					{
-						if (((unsigned char)(*pFontData) & iMask) > 0)  // if there is a dot ...
-						{
-							pDst = pDstBuffer + iLineSize * (y+i) + 2*(x+j);
-							(*((short*)pDst)) = iPenColor;
-						}
-						iMask >>= 1;
-					}
-					pFontData++;
-				}
-				x += (iFontSpace+8);
-				break;
+			switch (iBPP)
+			{
+            case 8:
+                for(i=0; i<_OGE_DOT_FONT_SIZE_; i++)
+				{
+					iMask = 0x80;
+					for(j=0;j<8;j++)
+					{
+						if (((unsigned char)(*pFontData) & iMask) > 0)  // if there is a dot ...
+						{
+							pDst = pDstBuffer + iLineSize * (y+i) + (x+j);
+							(*((char*)pDst)) = iPenColor;
+						}
+						iMask >>= 1;
+					}
+					pFontData++;
+				}
+				x += (iFontSpace+8);
+				break;
+			case 15:
+			case 16:
+				for(i=0; i<_OGE_DOT_FONT_SIZE_; i++)
+				{
+					iMask = 0x80;
+					for(j=0;j<8;j++)
+					{
+						if (((unsigned char)(*pFontData) & iMask) > 0)  // if there is a dot ...
+						{
+							pDst = pDstBuffer + iLineSize * (y+i) + 2*(x+j);
+							(*((short*)pDst)) = iPenColor;
+						}
+						iMask >>= 1;
+					}
+					pFontData++;
+				}
+				x += (iFontSpace+8);
+				break;
+
+			case 32:
+				for(i=0; i<_OGE_DOT_FONT_SIZE_; i++)
+				{
+					iMask = 0x80;
+					for(j=0;j<8;j++)
+					{
+						if (((unsigned char)(*pFontData) & iMask) > 0)  // if there is a dot ...
+						{
+							pDst = pDstBuffer + iLineSize * (y+i) + 4*(x+j);
+							(*((int*)pDst)) = iPenColor;
+						}
+						iMask >>= 1;
+					}
+					pFontData++;
+				}
+				x += (iFontSpace+8);
+				break;
+
+			} // end of switch
+
+			pText++;
+
+		}  // end if ascii
+		else if ( (pText+1) && (unsigned char)(*pText) > 0x00a0 && (unsigned char)(*(pText+1)) > 0x00a0 ) // if hzk
+		{
+			if (x+8+iFontSpace - iBeginX > iWidth)
+			{
+				bNextLine = true;
+                continue;
+			}
+
+            /*
+			switch (iFontSize)
+			{
+			case 12:
+				pFontData = hzk12;
+				break;
+			case 16:
+				pFontData = hzk16;
+				break;
+			default:
+				pFontData = hzk12;
+			}
+			*/
+
+            pFontData = hzk16;
+
+			if (pFontData) pFontData += ( ((unsigned char)(*pText)-0x00a1)*94 + ((unsigned char)(*(pText+1))-0x00a1) ) * _OGE_DOT_FONT_SIZE_ * 2;
+			else
+			{
+				pText += 2;
+				continue;
+			}
+
+			switch (iBPP)
+			{
+            case 8:
+                for(i=0; i<_OGE_DOT_FONT_SIZE_; i++)
+				{
+					//iMask = 0x8000;
+					pFontData += 1;
+					iMask = 0x80;
+					for(j=8;j<_OGE_DOT_FONT_SIZE_;j++)
+					{
+						if (((*(short*)pFontData) & iMask) > 0)  // if there is a dot ...
+						{
+							pDst = pDstBuffer + iLineSize * (y+i) + (x+j);
+							(*((char*)pDst)) = iPenColor;
+						}
+						iMask >>= 1;
+					}
+
+					pFontData -= 1;
+					iMask = 0x80;
+					for(j=0;j<8;j++)
+					{
+						if (((*(short*)pFontData) & iMask) > 0)  // if there is a dot ...
+						{
+							pDst = pDstBuffer + iLineSize * (y+i) + (x+j);
+							(*((char*)pDst)) = iPenColor;
+						}
+						iMask >>= 1;
+					}
+
+					pFontData += 2;
+				}
+				x += (iFontSpace+_OGE_DOT_FONT_SIZE_);
+				break;
+			case 15:
+			case 16:
+				for(i=0; i<_OGE_DOT_FONT_SIZE_; i++)
+				{
+					//iMask = 0x8000;
+					pFontData += 1;
+					iMask = 0x80;
+					for(j=8;j<_OGE_DOT_FONT_SIZE_;j++)
+					{
+						if (((*(short*)pFontData) & iMask) > 0)  // if there is a dot ...
+						{
+							pDst = pDstBuffer + iLineSize * (y+i) + 2*(x+j);
+							(*((short*)pDst)) = iPenColor;
+						}
+						iMask >>= 1;
+					}
+					pFontData -= 1;
+					iMask = 0x80;
+					for(j=0;j<8;j++)
+					{
+						if (((*(short*)pFontData) & iMask) > 0)  // if there is a dot ...
+						{
+							pDst = pDstBuffer + iLineSize * (y+i) + 2*(x+j);
+							(*((short*)pDst)) = iPenColor;
+						}
+						iMask >>= 1;
+					}
+
+					pFontData += 2;
+				}
+				x += (iFontSpace+_OGE_DOT_FONT_SIZE_);
+				break;
+
+			case 32:
+				for(i=0; i<_OGE_DOT_FONT_SIZE_; i++)
+				{
+					//iMask = 0x8000;
+					pFontData += 1;
+					iMask = 0x80;
+					for(j=8;j<_OGE_DOT_FONT_SIZE_;j++)
+					{
+						if (((*(short*)pFontData) & iMask) > 0)  // if there is a dot ...
+						{
+							pDst = pDstBuffer + iLineSize * (y+i) + 4*(x+j);
+							(*((int*)pDst)) = iPenColor;
+						}
+						iMask >>= 1;
+					}
+					pFontData -= 1;
+					iMask = 0x80;
+					for(j=0;j<8;j++)
+					{
+						if (((*(short*)pFontData) & iMask) > 0)  // if there is a dot ...
+						{
+							pDst = pDstBuffer + iLineSize * (y+i) + 4*(x+j);
+							(*((int*)pDst)) = iPenColor;
+						}
+						iMask >>= 1;
+					}
+
+					pFontData += 2;
+				}
+				x += (iFontSpace+_OGE_DOT_FONT_SIZE_);
+				break;
+
+			} // end of switch
+
+			pText += 2;
+
+		}  // end of if hzk ...
+		else
+		{
+			pText++;
+		}
+
+	} // end while ...
+}
+
+
+
+/*---------------- Image -----------------*/
+
+
+CogeImage::CogeImage(const std::string& sName):
+m_pSurface(NULL),
+m_pLocalClipboardA(NULL),
+m_pLocalClipboardB(NULL),
+m_pCurrentClipboard(NULL),
+m_pSpans(NULL),
+m_pIndexed(NULL),
+m_pPalette(NULL),
+m_pAtlas(NULL),
+m_pVideo(NULL),
+m_pDotFont(NULL),
+m_pDefaultFont(NULL),
+m_iWidth(0),
+m_iHeight(0),
+m_iBPP(0),
+m_iColorKeyRGB(-1),
+m_iColorKey(-1),
+m_iAlpha(-1),
+m_iPenColorRGB(0),
+m_iLockTimes(0),
+m_iTotalUsers(0),
+m_sName(sName)
+{
+    m_iPenColor = 0;
+    memset(&m_iPenColorSDL, 0, sizeof(m_iPenColorSDL));
+
+    m_bHasAlphaChannel = false;
+    m_bPremultiplied = false;
+    m_pPremultiplied = NULL;
+
+    m_iEffectCount = 0;
+
+    m_iCachedFrames = 0;
+}
+
+CogeImage::~CogeImage()
+{
+    if (m_iCachedFrames > 0 && m_pVideo) m_pVideo->DelCachedFrames(this);
+
+    if (m_pSpans)
+    {
+        OGE_FX_FreeSpans(m_pSpans);
+        m_pSpans = NULL;
+    }
+
+    ClearIndexed();
+
+    ReleaseAtlas();
+
+    FreePremultiplied();
+
+    if (m_pSurface)
+    {
+        SDL_FreeSurface(m_pSurface);
+        m_pSurface = NULL;
+    }
+
+    if (m_pLocalClipboardA)
+    {
+        SDL_FreeSurface(m_pLocalClipboardA);
+        m_pLocalClipboardA = NULL;
+    }
+
+    if (m_pLocalClipboardB)
+    {
+        SDL_FreeSurface(m_pLocalClipboardB);
+        m_pLocalClipboardB = NULL;
+    }
+
+    m_pCurrentClipboard = NULL;
+
+	m_iTotalUsers  =  0;
+
+	m_pDotFont = NULL;
+	m_pDefaultFont = NULL;
+
+}
+
+const std::string& CogeImage::GetName()
+{
+	return m_sName;
+}
+
+
+// Width getter
+int CogeImage::GetWidth()
+{
+	return m_iWidth;
+}
+
+// Height getter
+int CogeImage::GetHeight()
+{
+	return m_iHeight;
+}
+
+// BPP getter
+int CogeImage::GetBPP()
+{
+	return m_iBPP;
+}
+
+bool CogeImage::HasAlphaChannel()
+{
+    return m_bHasAlphaChannel;
+}
+
+bool CogeImage::HasLocalClipboard()
+{
+    return m_bHasLocalClipboard;
+}
+
+bool CogeImage::IsPremultiplied()
+{
+    return m_bPremultiplied;
+}
+
+int CogeImage::GetPenColor()
+{
+	return m_iPenColorRGB;
+}
+void CogeImage::SetPenColor(int iRGBColor)
+{
+
+    if(m_iPenColorRGB == iRGBColor) return;
+
+	m_iPenColorRGB = iRGBColor;
+
+	m_iPenColor = m_pVideo->FormatColor(iRGBColor);
+
+	m_iPenColorSDL.r = (iRGBColor&0x00ff0000)>>16;
+	m_iPenColorSDL.g = (iRGBColor&0x0000ff00)>>8;
+	m_iPenColorSDL.b =  iRGBColor&0x000000ff;
+
+}
+
+void CogeImage::SetColorKey(int iColorKeyRGB)
+{
+    if (iColorKeyRGB != m_iColorKeyRGB) PrepareRawData(true);
+
+    if (iColorKeyRGB == -1)
+    {
+        SDL_SetColorKey(m_pSurface, 0, 0);
+        m_iColorKeyRGB = -1;
+        m_iColorKey = -1;
+    }
+	else
+	{
+	    if(m_iColorKeyRGB != iColorKeyRGB)
+	    {
+	        m_iColorKey = m_pVideo->FormatColor(iColorKeyRGB);
+            SDL_SetColorKey(m_pSurface,
+                            OGE_SRCCOLORKEY,
+                            m_iColorKey);
+            m_iColorKeyRGB = iColorKeyRGB;
+	    }
+	}
+}
+
+int CogeImage::GetColorKey()
+{
+    return m_iColorKeyRGB;
+}
+
+int CogeImage::GetRawColorKey()
+{
+    return m_iColorKey;
+}
+
+void CogeImage::SetAlpha(int iAlpha)
+{
+    PrepareRawData();
+
+    if(iAlpha >= 0)
+	{
+	    if(m_iAlpha != iAlpha)
+	    {
+            OGE_SetAlpha(m_pSurface, OGE_SRCALPHA, iAlpha);
+            m_iAlpha = iAlpha;
+	    }
+    }
+    else
+    {
+        OGE_SetAlpha(m_pSurface, 0, 0);
+        m_iAlpha = -1;
+    }
+}
+
+void CogeImage::SetDefaultFont(CogeFont* pFont)
+{
+    if(m_pDefaultFont == pFont) return;
+
+    if(m_pDefaultFont) m_pDefaultFont->Fire();
+    m_pDefaultFont = pFont;
+    if(m_pDefaultFont) m_pDefaultFont->Hire();
+
+}
+CogeFont* CogeImage::GetDefaultFont()
+{
+    return m_pDefaultFont;
+}
+
+//int CogeImage::GetTotalUsers()
+//{
+//    return m_iTotalUsers;
+//}
+
+CogeVideo* CogeImage::GetVideoEngine()
+{
+    return m_pVideo;
+}
+
+int CogeImage::SaveAsBMP(const std::string& sFileName)
+{
+    PrepareRawData();
+    if(m_pSurface) return SDL_SaveBMP(m_pSurface, sFileName.c_str());
+    else return -1;
+}
+
+SDL_Surface * CogeImage::GetSurface()
+{
+    PrepareRawData();
+    return m_pSurface;
+}
+
+SDL_Surface* CogeImage::GetFreeClipboard()
+{
+    if(m_pCurrentClipboard && m_pCurrentClipboard == m_pLocalClipboardA) return m_pLocalClipboardB;
+    else return m_pLocalClipboardA;
+}
+SDL_Surface* CogeImage::GetCurrentClipboard()
+{
+    return m_pCurrentClipboard;
+}
+void CogeImage::SetCurrentClipboard(SDL_Surface* pClipboard)
+{
+    if(pClipboard == NULL) m_pCurrentClipboard = NULL;
+    else if(pClipboard == m_pLocalClipboardA) m_pCurrentClipboard = m_pLocalClipboardA;
+    else if(pClipboard == m_pLocalClipboardB) m_pCurrentClipboard = m_pLocalClipboardB;
+}
+void CogeImage::PrepareLocalClipboards(int iEffectCount)
+{
+    SetCurrentClipboard(NULL);
+    m_iEffectCount = iEffectCount;
+}
+
+
+void CogeImage::Fire()
+{
+    m_iTotalUsers--;
+	if (m_iTotalUsers < 0) m_iTotalUsers = 0;
+}
+
+void CogeImage::Hire()
+{
+    if (m_iTotalUsers < 0) m_iTotalUsers = 0;
+	m_iTotalUsers++;
+}
+
+bool CogeImage::BuildSpans(bool bDropRawData)
+{
+    if (!PrepareRawData(true)) return false;
+
+    if (m_iColorKey == -1 || m_bHasAlphaChannel) return false;
+
+    BeginUpdate();
+
+    m_pSpans = OGE_FX_BuildSpans((uint8_t*)m_pSurface->pixels, m_pSurface->pitch,
+                                 m_iWidth, m_iHeight, m_iBPP, m_iColorKey);
+
+    EndUpdate();
+
+    if (m_pSpans == NULL) return false;
+
+    if (bDropRawData && m_iLockTimes == 0)
+    {
+        SDL_FreeSurface(m_pSurface);
+        m_pSurface = NULL;
+    }
+
+    return true;
+}
+
+void CogeImage::FreeSpans()
+{
+    if (m_pSpans == NULL) return;
+
+    PrepareRawData();
+
+    OGE_FX_FreeSpans(m_pSpans);
+    m_pSpans = NULL;
+}
+
+bool CogeImage::HasSpans()
+{
+    return m_pSpans != NULL;
+}
+
+int CogeImage::GetSpansSize()
+{
+    return OGE_FX_GetSpansSize(m_pSpans);
+}
+
+bool CogeImage::BuildIndexed(bool bDropRawData)
+{
+    if (m_pIndexed) return true;
+
+    if (!PrepareRawData(true)) return false;
+
+    if (m_bHasAlphaChannel) return false;
+
+    BeginUpdate();
+
+    m_pIndexed = OGE_FX_BuildIndexed((uint8_t*)m_pSurface->pixels, m_pSurface->pitch,
+                                     m_iWidth, m_iHeight, m_iBPP, m_iColorKey);
+
+    EndUpdate();
+
+    if (m_pIndexed == NULL) return false;
+
+    m_pPalette = new uint8_t[256 * 4];
+    memcpy(m_pPalette, OGE_FX_GetIndexedPalette(m_pIndexed), 256 * (m_iBPP >> 3));
+
+    if (bDropRawData && m_iLockTimes == 0)
+    {
+        SDL_FreeSurface(m_pSurface);
+        m_pSurface = NULL;
+    }
+
+    return true;
+}
+
+void CogeImage::ClearIndexed()
+{
+    if (m_pIndexed)
+    {
+        OGE_FX_FreeIndexed(m_pIndexed);
+        m_pIndexed = NULL;
+    }
+
+    if (m_pPalette)
+    {
+        delete [] m_pPalette;
+        m_pPalette = NULL;
+    }
+}
+
+void CogeImage::FreeIndexed()
+{
+    if (m_pIndexed == NULL) return;
+
+    PrepareRawData();
+
+    ClearIndexed();
+}
+
+bool CogeImage::IsIndexed()
+{
+    return m_pIndexed != NULL;
+}
+
+int CogeImage::GetIndexedSize()
+{
+    if (m_pIndexed == NULL) return 0;
+    return OGE_FX_GetIndexedSize(m_pIndexed) + 256 * 4;
+}
+
+int CogeImage::GetPaletteSize()
+{
+    return OGE_FX_GetIndexedColors(m_pIndexed);
+}
+
+int CogeImage::GetPaletteColor(int iIndex)
+{
+    if (m_pIndexed == NULL || m_pVideo == NULL || m_pVideo->m_pFrontBuffer == NULL) return -1;
+    if (iIndex < 0 || iIndex >= OGE_FX_GetIndexedColors(m_pIndexed)) return -1;
+
+    Uint32 iColor = 0;
+    if (m_iBPP == 16) iColor = ((uint16_t*)m_pPalette)[iIndex];
+    else iColor = ((uint32_t*)m_pPalette)[iIndex];
+
+    Uint8 r = 0, g = 0, b = 0;
+    SDL_GetRGB(iColor, m_pVideo->m_pFrontBuffer->format, &r, &g, &b);
+
+    return (r << 16) | (g << 8) | b;
+}
+
+bool CogeImage::SetPaletteColor(int iIndex, int iRGBColor)
+{
+    if (m_pIndexed == NULL || m_pVideo == NULL || iRGBColor < 0) return false;
+    if (iIndex < 0 || iIndex >= OGE_FX_GetIndexedColors(m_pIndexed)) return false;
+
+    // the pixels of the color key stay transparent, and no others may become transparent
+    if (iIndex == OGE_FX_GetIndexedKey(m_pIndexed)) return false;
+
+    int iColor = m_pVideo->FormatColor(iRGBColor);
+    if (m_iColorKey != -1 && iColor == m_iColorKey) return false;
+
+    if (m_iBPP == 16) ((uint16_t*)m_pPalette)[iIndex] = (uint16_t) iColor;
+    else ((uint32_t*)m_pPalette)[iIndex] = (uint32_t) iColor;
+
+    UpdatePalette();
+
+    return true;
+}
+
+int CogeImage::FindPaletteColor(int iRGBColor)
+{
+    if (m_pIndexed == NULL || m_pVideo == NULL || iRGBColor < 0) return -1;
+
+    uint32_t iColor = (uint32_t) m_pVideo->FormatColor(iRGBColor);
+    if (m_iBPP == 16) iColor &= 0xffff;
+
+    int iColors = OGE_FX_GetIndexedColors(m_pIndexed);
+    uint8_t* pColors = OGE_FX_GetIndexedPalette(m_pIndexed);
+
+    for(int i=0; i<iColors; i++)
+    {
+        uint32_t iOldColor = m_iBPP == 16 ? ((uint16_t*)pColors)[i] : ((uint32_t*)pColors)[i];
+        if (iOldColor == iColor) return i;
+    }
+
+    return -1;
+}
+
+void CogeImage::ResetPalette()
+{
+    if (m_pIndexed == NULL) return;
+
+    memcpy(m_pPalette, OGE_FX_GetIndexedPalette(m_pIndexed), 256 * (m_iBPP >> 3));
+
+    UpdatePalette();
+}
+
+void CogeImage::UpdatePalette()
+{
+    // keep the surface (if it is still there) the same as the pixels drawn through the palette
+    if (m_pSurface)
+    {
+        if (SDL_MUSTLOCK(m_pSurface)) SDL_LockSurface(m_pSurface);
+        OGE_FX_UnpackIndexed((uint8_t*)m_pSurface->pixels, m_pSurface->pitch, m_pIndexed, m_pPalette);
+        if (SDL_MUSTLOCK(m_pSurface)) SDL_UnlockSurface(m_pSurface);
+    }
+
+    if (m_iCachedFrames > 0 && m_pVideo) m_pVideo->DelCachedFrames(this);
+}
+
+bool CogeImage::PrepareRawData(bool bForWriting)
+{
+    if (m_pSurface == NULL && (m_pSpans != NULL || m_pIndexed != NULL) && m_pVideo && m_pVideo->m_pFrontBuffer)
+    {
+        m_pSurface = SDL_CreateRGBSurface(_OGE_VIDEO_DF_MODE_, m_iWidth, m_iHeight,
+                                         m_pVideo->m_pFrontBuffer->format->BitsPerPixel,
+                                         m_pVideo->m_pFrontBuffer->format->Rmask,
+                                         m_pVideo->m_pFrontBuffer->format->Gmask,
+                                         m_pVideo->m_pFrontBuffer->format->Bmask,
+                                         m_pVideo->m_pFrontBuffer->format->Amask);
+
+        if (m_pSurface)
+        {
+            if (SDL_MUSTLOCK(m_pSurface)) SDL_LockSurface(m_pSurface);
+            if (m_pSpans) OGE_FX_UnpackSpans((uint8_t*)m_pSurface->pixels, m_pSurface->pitch, m_pSpans, m_iColorKey);
+            else OGE_FX_UnpackIndexed((uint8_t*)m_pSurface->pixels, m_pSurface->pitch, m_pIndexed, m_pPalette);
+            if (SDL_MUSTLOCK(m_pSurface)) SDL_UnlockSurface(m_pSurface);
+
+            SDL_SetColorKey(m_pSurface, OGE_SRCCOLORKEY, m_iColorKey);
+            if (m_iAlpha >= 0) OGE_SetAlpha(m_pSurface, OGE_SRCALPHA, m_iAlpha);
+        }
+        else OGE_Log("Failed to restore the raw data of image '%s'.\n", m_sName.c_str());
+    }
+
+    if (bForWriting && m_pSpans != NULL && m_pSurface != NULL)
+    {
+        OGE_FX_FreeSpans(m_pSpans);
+        m_pSpans = NULL;
+    }
+
+    if (bForWriting && m_pIndexed != NULL && m_pSurface != NULL) ClearIndexed();
+
+    if (bForWriting && m_pAtlas != NULL) DetachAtlas();
+
+    // the transformed frames are out of date
+    if (bForWriting && m_iCachedFrames > 0 && m_pVideo) m_pVideo->DelCachedFrames(this);
+
+    // the premultiplied copy is out of date, it is made again when it is drawn
+    if (bForWriting && m_pPremultiplied != NULL) FreePremultiplied();
+
+    return m_pSurface != NULL;
+}
+
+bool CogeImage::PremultiplyAlpha()
+{
+    if (m_pPremultiplied) return true;
+
+    // the local clipboards are still blitted by sdl, so keep the normal alpha for them
+    if (m_pSurface == NULL || !m_bHasAlphaChannel || m_bHasLocalClipboard) return false;
+    if (m_pVideo == NULL || m_pVideo->m_pFrontBuffer == NULL) return false;
+
+    SDL_PixelFormat* pFormat = m_pSurface->format;
+    SDL_PixelFormat* pScreenFormat = m_pVideo->m_pFrontBuffer->format;
+
+    if (pFormat->BitsPerPixel != 32 || pFormat->Amask == 0 || pScreenFormat->BitsPerPixel != 32) return false;
+
+    if (pFormat->Rmask != pScreenFormat->Rmask ||
+        pFormat->Gmask != pScreenFormat->Gmask ||
+        pFormat->Bmask != pScreenFormat->Bmask) return false;
+
+    // a copy, so the readers of the image (and the others on its atlas sheet) keep the normal alpha
+    if (SDL_MUSTLOCK(m_pSurface)) SDL_LockSurface(m_pSurface);
+    m_pPremultiplied = OGE_CopySurface(m_pSurface);
+    if (SDL_MUSTLOCK(m_pSurface)) SDL_UnlockSurface(m_pSurface);
+
+    if (m_pPremultiplied == NULL) return false;
+
+    OGE_FX_Premultiply((uint8_t*)m_pPremultiplied->pixels, m_pPremultiplied->pitch, 0, 0,
+                       m_pPremultiplied->w, m_pPremultiplied->h, 32, pFormat->Ashift);
+
+    m_bPremultiplied = true;
+
+    return true;
+}
+
+void CogeImage::FreePremultiplied()
+{
+    if (m_pPremultiplied == NULL) return;
+
+    SDL_FreeSurface(m_pPremultiplied);
+    m_pPremultiplied = NULL;
+}
+
+bool CogeImage::DrawPremultiplied(CogeImage* pSrcImage, int iAlpha,
+                        int iDstLeft, int iDstTop,
+                        int iSrcLeft, int iSrcTop, int iSrcWidth, int iSrcHeight)
+{
+    if (pSrcImage == NULL || pSrcImage == this) return false;
+    if (!pSrcImage->m_bPremultiplied || pSrcImage->m_pSurface == NULL || m_iBPP != 32) return false;
+    if (!pSrcImage->PremultiplyAlpha()) return false;
+
+    PrepareRawData(true);
+
+    SDL_Rect rcSrc = {0};
+	SDL_Rect rcDst = {0};
+
+	if (iSrcWidth == -1) iSrcWidth = pSrcImage->m_iWidth;
+	if (iSrcHeight == -1) iSrcHeight = pSrcImage->m_iHeight;
+
+	// only the premultiplied copy is read
+	if(!pSrcImage->ClipRect(iSrcLeft, iSrcTop, iSrcWidth, iSrcHeight, &rcSrc)) return true;
+	if (!GetValidRect(iDstLeft, iDstTop, &rcSrc, &rcDst)) return true;
+
+	SDL_Surface* pSrcSurface = pSrcImage->m_pPremultiplied;
+
+	bool bNeedLockSrc = SDL_MUSTLOCK(pSrcSurface) != 0;
+	if (bNeedLockSrc) bNeedLockSrc = SDL_LockSurface(pSrcSurface) == 0;
+
+	BeginUpdate();
+
+	OGE_FX_BltPremultiplied((Uint8 *)m_pSurface->pixels, m_pSurface->pitch,
+                            rcDst.x, rcDst.y,
+                            (Uint8 *)pSrcSurface->pixels, pSrcSurface->pitch,
+                            rcSrc.x, rcSrc.y,
+                            rcSrc.w, rcSrc.h, 32, pSrcSurface->format->Ashift, iAlpha);
+
+	EndUpdate();
+
+	if (bNeedLockSrc) SDL_UnlockSurface(pSrcSurface);
+
+	return true;
+}
+
+
+/*
+void CogeImage::GetValidRect(SDL_Rect& rc)
+{
+//  if(rc.x < 0) rc.x = 0;
+//	if(rc.y < 0) rc.y = 0;
+//	if(rc.w < 0) rc.w = 0;
+//	if(rc.h < 0) rc.h = 0;
+
+	if(rc.x > m_iWidth) rc.x  = m_iWidth;
+	if(rc.y > m_iHeight) rc.y = m_iHeight;
+	if(rc.x+rc.w > m_iWidth) rc.w = m_iWidth - rc.x;
+	if(rc.y+rc.h > m_iHeight) rc.h = m_iHeight - rc.y;
+}
+*/
+
+bool CogeImage::GetValidRect(int x, int y, int w, int h, SDL_Rect* rslrc)
+{
+    PrepareRawData();
+
+    return ClipRect(x, y, w, h, rslrc);
+}
+
+bool CogeImage::ClipRect(int x, int y, int w, int h, SDL_Rect* rslrc)
+{
+    //SDL_Rect rc = {0};
+
+    //volatile SDL_Rect* rslrc = rc;
+
+    if(x > m_iWidth || y > m_iHeight) return false;
+
+    if(x < 0) {w=w+x; x=0;}
+	if(y < 0) {h=h+y; y=0;}
+
+	//if(w < 0) w = 0;
+	//if(h < 0) h = 0;
+
+	if(w <= 0 || h <= 0) return false;
+
+	//if(x > m_iWidth) x = m_iWidth;
+	//if(y > m_iHeight) y = m_iHeight;
+
+	if(x+w > m_iWidth) w = m_iWidth - x;
+	if(y+h > m_iHeight) h = m_iHeight - y;
+
+	rslrc->x = x;
+	rslrc->y = y;
+	rslrc->w = w;
+	rslrc->h = h;
+
+	return true;
+
+}
+
+bool CogeImage::GetValidRect(int x, int y, SDL_Rect* rcRslSrc, SDL_Rect* rcRslDst)
+{
+    // the image is the target
+    PrepareRawData(true);
+
+    //SDL_Rect rc = {0};
+
+    //volatile SDL_Rect* rcRslSrc = rcSrc;
+    //volatile SDL_Rect* rcRslDst = rcDst;
+
+    if(x > m_iWidth || y > m_iHeight) return false;
+
+    int w = rcRslSrc->w;
+	int h = rcRslSrc->h;
+
+    if(x < 0) {rcRslSrc->x=rcRslSrc->x-x; w=w+x; x=0;}
+	if(y < 0) {rcRslSrc->y=rcRslSrc->y-y; h=h+y; y=0;}
+
+	if(w <= 0 || h <= 0) return false;
+
+	//if(x > m_iWidth) x = m_iWidth;
+	//if(y > m_iHeight) y = m_iHeight;
+
+	if(x+w > m_iWidth)  w = m_iWidth - x;
+	if(y+h > m_iHeight) h = m_iHeight - y;
+
+	rcRslSrc->w = w;
+	rcRslSrc->h = h;
+
+	rcRslDst->x = x;
+	rcRslDst->y = y;
+	rcRslDst->w = w;
+	rcRslDst->h = h;
+
+	return true;
+}
+
+
+void CogeImage::GetValidRect(CogeRect* rslrc)
+{
+    //volatile CogeRect* rslrc = rc;
+
+    if(rslrc->left < 0) rslrc->left = 0;
+	if(rslrc->top < 0) rslrc->top = 0;
+	if(rslrc->right < 0) rslrc->right = 0;
+	if(rslrc->bottom < 0) rslrc->bottom = 0;
+
+	if(rslrc->left > m_iWidth) rslrc->left = m_iWidth;
+	if(rslrc->top > m_iHeight) rslrc->top = m_iHeight;
+	if(rslrc->right > m_iWidth) rslrc->right = m_iWidth;
+	if(rslrc->bottom > m_iHeight) rslrc->bottom = m_iHeight;
+}
+
+void CogeImage::BeginUpdate()
+{
+    PrepareRawData();
+
+#ifdef __OGE_WITH_SDL2__
+
+#ifdef __IMG_WITH_LOCK__
+    if(m_iLockTimes < 0) m_iLockTimes = 0;
+    if(m_pSurface && SDL_MUSTLOCK(m_pSurface))
+    {
+        if(SDL_LockSurface(m_pSurface) == 0) m_iLockTimes++;
+    }
+#else
+    return;
+#endif
+
+#else
+
+    return;
+
+#endif
+
+}
+void CogeImage::EndUpdate()
+{
+
+#ifdef __OGE_WITH_SDL2__
+
+#ifdef __IMG_WITH_LOCK__
+    if(m_pSurface && m_iLockTimes > 0)
+    {
+        SDL_UnlockSurface(m_pSurface);
+        m_iLockTimes--;
+    }
+    if(m_iLockTimes < 0) m_iLockTimes = 0;
+#else
+    return;
+#endif
+
+#else
+
+    return;
+
+#endif
+
+}
+
+CogeRect CogeImage::GetDotTextRect(const char* pText, int x, int y,
+                                    int iMaxWidth, int iFontSpace, int iLineSpace)
+{
+    CogeRect rcDst = {0};
+
+	int iWidth = 0;
+	int iHeight = 0;
+
+	if (!m_pDotFont) return rcDst;
+
+	if (iMaxWidth == 0)
+	{
+		iWidth = m_pDotFont->GetTextWidth(pText, iFontSpace) + iFontSpace;
+		iHeight = _OGE_DOT_FONT_SIZE_ + iLineSpace;
+	}
+	else
+	{
+		iWidth = iMaxWidth + iFontSpace;
+		iHeight = m_pDotFont->GetTextHeight(pText, iMaxWidth, iFontSpace, iLineSpace) + iLineSpace;
+	}
+
+    rcDst.left   = x;
+	rcDst.top    = y;
+	rcDst.right  = x + iWidth;
+	rcDst.bottom = y  + iHeight;
+
+	return rcDst;
+
+}
+
+void CogeImage::DotTextOut(const char* pText, int x, int y,
+                            int iMaxWidth, int iFontSpace, int iLineSpace)
+{
+    if(m_pDotFont == NULL) return;
+
+    SDL_Rect rcDst = {0};
+
+	void* pDst = NULL;
+
+	int iLineSize = 0;
+
+	int iWidth = 0;
+	int iHeight = 0;
+
+	//if (!m_VideoEngine) return;
+	//if (!m_pSurface) return;
+	//if (!m_pDotFont) return;
+
+	//if ( m_pVideo->m_iState < 0 ) return;
+
+	if (iMaxWidth == 0)
+	{
+		iWidth = m_pDotFont->GetTextWidth(pText, iFontSpace) + iFontSpace;
+		iHeight = _OGE_DOT_FONT_SIZE_ + iLineSpace;
+	}
+	else
+	{
+		iWidth = iMaxWidth + iFontSpace;
+		iHeight = m_pDotFont->GetTextHeight(pText, iMaxWidth, iFontSpace, iLineSpace) + iLineSpace;
+	}
+
+	rcDst.x = x;
+	rcDst.y = y;
+	rcDst.w = iWidth;
+	rcDst.h = iHeight;
+
+	//if (SDL_LockSurface(m_pSurface) < 0) return;
+
+	//try
+	//{
+
+	//if (m_pddSurface->Lock(&rcDst, &ddsd, DDLOCK_WAIT, NULL) != DD_OK) return;
+
+	PrepareRawData(true);
+
+	BeginUpdate();
+
+	pDst = (Uint8 *)m_pSurface->pixels;
+	iLineSize = m_pSurface->pitch;
+
+	if (iMaxWidth == 0)
+	{
+		m_pDotFont->OneLine(pText, (char*)pDst, iLineSize, m_iBPP, m_iPenColor, rcDst.x, rcDst.y, iWidth, iFontSpace);
+	}
+	else
+	{
+		m_pDotFont->Lines(pText, (char*)pDst, iLineSize, m_iBPP, m_iPenColor, rcDst.x, rcDst.y, iWidth, iHeight,
+		                  iFontSpace, iLineSpace);
+	}
+
+	//}
+	//catch ( ... )
+	//{
+	//    SDL_UnlockSurface( m_pSurface );
+    //}
+
+	//m_pddSurface->Unlock(&rcDst);
+
+	//SDL_UnlockSurface( m_pSurface );
+
+	EndUpdate();
+
+}
+
+void CogeImage::PrintBufferText(const char* pBufferText, int iBufferSize, int x, int y, const char* pCharsetName, CogeFont* pFont, int iAlpha)
+{
+    //if(m_pFontStock == NULL) return;
+
+    if(pBufferText == NULL || iBufferSize <= 0) return;
+
+    PrepareRawData(true);
+
+    SDL_Surface* pTextImg = NULL;
+
+    if(pFont == NULL)
+    {
+        if(m_pDefaultFont) pFont = m_pDefaultFont;
+        else pFont = m_pVideo->GetDefaultFont();
+    }
+
+    if(pFont)
+    {
+        pTextImg = pFont->PrintBufferText(pBufferText, iBufferSize, pCharsetName, m_iPenColorSDL);
+    }
+
+    if(pTextImg)
+    {
+        if(iAlpha >= 0)
+        OGE_SetAlpha(pTextImg, OGE_SRCALPHA, iAlpha);
+
+        SDL_Rect rcSrc = {0};
+        SDL_Rect rcDst = {0};
+
+        rcSrc.w = pTextImg->w;
+        rcSrc.h = pTextImg->h;
+
+        if (GetValidRect(x, y, &rcSrc, &rcDst))
+        SDL_BlitSurface(pTextImg, &rcSrc, m_pSurface, &rcDst);
+
+        //SDL_FreeSurface( pTextImg );
+
+    }
+    else
+    {
+        if(pCharsetName == NULL || strlen(pCharsetName) == 0) DotTextOut(pBufferText, x, y);
+        else
+        {
+            std::string sDefaultCharset = m_pVideo->GetDefaultCharset();
+            if(sDefaultCharset.length() == 0) DotTextOut(pBufferText, x, y);
+            else DotTextOut("Error", x, y);
+        }
+
+        //printf("Text: %s (%d) (%s) \n", pBufferText, iBufferSize, pCharsetName);
+    }
+}
+
+void CogeImage::PrintBufferTextWrap(const char* pBufferText, int iBufferSize, int x, int y, const char* pCharsetName, CogeFont* pFont, int iAlpha)
+{
+    if(pBufferText == NULL || iBufferSize <= 0) return;
+
+    PrepareRawData(true);
+
+    SDL_Surface* pTextImg = NULL;
+
+    int iFontSpace = 2;
+    int iLineSpace = 2;
+    bool bPrintOK = false;
+
+    if(pFont == NULL)
+    {
+        if(m_pDefaultFont) pFont = m_pDefaultFont;
+        else pFont = m_pVideo->GetDefaultFont();
+    }
+
+    if(pFont)
+    {
+        bPrintOK = pFont->PrintBufferTextWrap(pBufferText, iBufferSize, pCharsetName, m_iWidth, m_iPenColorSDL);
+    }
+
+    if(bPrintOK)
+    {
+        std::vector<SDL_Surface*> txtimgs = pFont->GetTextImages();
+
+        for(size_t i = 0; i < txtimgs.size(); i++)
+        {
+            pTextImg = txtimgs[i];
+            if(pTextImg)
+            {
+                if(iAlpha >= 0)
+                OGE_SetAlpha(pTextImg, OGE_SRCALPHA, iAlpha);
+
+                SDL_Rect rcSrc = {0};
+                SDL_Rect rcDst = {0};
+
+                rcSrc.w = pTextImg->w;
+                rcSrc.h = pTextImg->h;
+
+                if (GetValidRect(x, y, &rcSrc, &rcDst))
+                SDL_BlitSurface(pTextImg, &rcSrc, m_pSurface, &rcDst);
+
+                y = y + rcDst.h + iLineSpace;
+            }
+        }
+    }
+    else
+    {
+        if(pCharsetName == NULL || strlen(pCharsetName) == 0) DotTextOut(pBufferText, x, y, m_iWidth-iFontSpace, iFontSpace, iLineSpace);
+    }
+}
+
+void CogeImage::PrintBufferTextAlign(const char* pBufferText, int iBufferSize, int iAlignX, int iAlignY, const char* pCharsetName, CogeFont* pFont, int iAlpha)
+{
+    //iAlignX: -1=>Left, 0=>Center, 1=>Right;
+    //iAlignY: -1=>Top,  0=>Middle, 1=>Bottom;
+
+    if(pBufferText == NULL || iBufferSize <= 0) return;
+
+    PrepareRawData(true);
+
+    SDL_Surface* pTextImg = NULL;
+
+    if(pFont == NULL)
+    {
+        if(m_pDefaultFont) pFont = m_pDefaultFont;
+        else pFont = m_pVideo->GetDefaultFont();
+    }
+
+    if(pFont)
+    {
+        pTextImg = pFont->PrintBufferText(pBufferText, iBufferSize, pCharsetName, m_iPenColorSDL);
+    }
+
+    if(pTextImg)
+    {
+        int x = 0; int y = 0;
+
+        if(iAlignX > 0)  x = m_iWidth - pTextImg->w;
+        if(iAlignX == 0) x = (m_iWidth - pTextImg->w)/2;
+
+        if(iAlignY > 0)  y = m_iHeight - pTextImg->h;
+        if(iAlignY == 0) y = (m_iHeight - pTextImg->h)/2;
+
+        if(iAlpha >= 0)
+        OGE_SetAlpha(pTextImg, OGE_SRCALPHA, iAlpha);
+
+        SDL_Rect rcSrc = {0};
+        SDL_Rect rcDst = {0};
+
+        rcSrc.w = pTextImg->w;
+        rcSrc.h = pTextImg->h;
+
+        if (GetValidRect(x, y, &rcSrc, &rcDst))
+        SDL_BlitSurface(pTextImg, &rcSrc, m_pSurface, &rcDst);
+
+        //SDL_FreeSurface( pTextImg );
+
+    }
+    else if(m_pDotFont && (pCharsetName == NULL || strlen(pCharsetName) == 0))
+    {
+        int x = 0; int y = 0;
+
+        int iWidth  = m_pDotFont->GetTextWidth(pBufferText, 0) + 0;
+		int iHeight = _OGE_DOT_FONT_SIZE_ + 0;
+
+        if(iAlignX > 0)  x = m_iWidth - iWidth;
+        if(iAlignX == 0) x = (m_iWidth - iWidth)/2;
+
+        if(iAlignY > 0)  y = m_iHeight - iHeight;
+        if(iAlignY == 0) y = (m_iHeight - iHeight)/2;
+
+        DotTextOut(pBufferText, x, y);
+    }
+
+}
+
+bool CogeImage::GetBufferTextSize(const char* pBufferText, int iBufferSize, int* iWidth, int* iHeight, const char* pCharsetName, CogeFont* pFont)
+{
+    if(pBufferText == NULL || iBufferSize <= 0) return false;
+
+    if(pFont == NULL)
+    {
+        if(m_pDefaultFont) pFont = m_pDefaultFont;
+        else pFont = m_pVideo->GetDefaultFont();
+    }
+
+    if(pFont)
+    {
+        return pFont->GetBufferTextSize(pBufferText, iBufferSize, pCharsetName, iWidth, iHeight);
+    }
+    else if(pCharsetName == NULL)
+    {
+        *iWidth  = m_pDotFont->GetTextWidth(pBufferText, 0) + 0;
+		*iHeight = _OGE_DOT_FONT_SIZE_ + 0;
+
+		return true;
+    }
+    else return false;
+}
+
+
+void CogeImage::PrintText(const std::string& sText, int x, int y, CogeFont* pFont, int iAlpha)
+{
+    const char* pBufferText = sText.c_str();
+    int iBufferSize = sText.length() + 1; // included end char '\0' ...
+
+    std::string sDefaultCharset = m_pVideo->GetDefaultCharset();
+    if(sDefaultCharset.length() > 0)
+        PrintBufferText(pBufferText, iBufferSize, x, y, sDefaultCharset.c_str(), pFont, iAlpha);
+    else
+        PrintBufferText(pBufferText, iBufferSize, x, y, _OGE_FONT_DF_CHARSET_, pFont, iAlpha);
+}
+
+void CogeImage::PrintTextWrap(const std::string& sText, int x, int y, CogeFont* pFont, int iAlpha)
+{
+    const char* pBufferText = sText.c_str();
+    int iBufferSize = sText.length() + 1; // included end char '\0' ...
+
+    std::string sDefaultCharset = m_pVideo->GetDefaultCharset();
+    if(sDefaultCharset.length() > 0)
+        PrintBufferTextWrap(pBufferText, iBufferSize, x, y, sDefaultCharset.c_str(), pFont, iAlpha);
+    else
+        PrintBufferTextWrap(pBufferText, iBufferSize, x, y, _OGE_FONT_DF_CHARSET_, pFont, iAlpha);
+}
+
+void CogeImage::PrintTextAlign(const std::string& sText, int iAlignX, int iAlignY, CogeFont* pFont, int iAlpha)
+{
+    const char* pBufferText = sText.c_str();
+    int iBufferSize = sText.length() + 1; // included end char '\0' ...
+
+    std::string sDefaultCharset = m_pVideo->GetDefaultCharset();
+    if(sDefaultCharset.length() > 0)
+        PrintBufferTextAlign(pBufferText, iBufferSize, iAlignX, iAlignY, sDefaultCharset.c_str(), pFont, iAlpha);
+    else
+        PrintBufferTextAlign(pBufferText, iBufferSize, iAlignX, iAlignY, _OGE_FONT_DF_CHARSET_, pFont, iAlpha);
+}
+
+bool CogeImage::GetTextSize(const std::string& sText, int* iWidth, int* iHeight, CogeFont* pFont)
+{
+    const char* pBufferText = sText.c_str();
+    int iBufferSize = sText.length() + 1; // included end char '\0' ...
+
+    if(pFont == NULL)
+    {
+        if(m_pDefaultFont) pFont = m_pDefaultFont;
+        else pFont = m_pVideo->GetDefaultFont();
+    }
+
+    std::string sDefaultCharset = m_pVideo->GetDefaultCharset();
+    if(sDefaultCharset.length() > 0)
+    {
+        return GetBufferTextSize(pBufferText, iBufferSize, iWidth, iHeight, sDefaultCharset.c_str(), pFont);
+    }
+    else
+    {
+        if(pFont)
+            return GetBufferTextSize(pBufferText, iBufferSize, iWidth, iHeight, _OGE_FONT_DF_CHARSET_, pFont);
+        else
+            return GetBufferTextSize(pBufferText, iBufferSize, iWidth, iHeight, NULL, NULL);
+    }
+
+}
+
+void CogeImage::Draw(CogeImage* pSrcImage,
+                      int iDstLeft, int iDstTop,
+                      int iSrcLeft, int iSrcTop, int iSrcWidth, int iSrcHeight)
+{
+    if(pSrcImage==NULL) return;
+
+    PrepareRawData(true);
+
+    if(DrawPremultiplied(pSrcImage, 255, iDstLeft, iDstTop, iSrcLeft, iSrcTop, iSrcWidth, iSrcHeight)) return;
+
+	SDL_Rect rcSrc = {0};
+	SDL_Rect rcDst = {0};
+
+	if (iSrcWidth == -1) iSrcWidth = pSrcImage->m_iWidth;
+	if (iSrcHeight == -1) iSrcHeight = pSrcImage->m_iHeight;
+
+	bool bUseSpans = pSrcImage->m_pSpans != NULL && pSrcImage != this;
+
+	// the indexed pixels of the source are drawn through its palette
+	bool bUseIndexed = pSrcImage->m_pIndexed != NULL && pSrcImage != this;
+
+	if(bUseSpans || bUseIndexed)
+	{
+	    if(!pSrcImage->ClipRect(iSrcLeft, iSrcTop, iSrcWidth, iSrcHeight, &rcSrc)) return;
+	}
+	else if(!pSrcImage->GetValidRect(iSrcLeft, iSrcTop, iSrcWidth, iSrcHeight, &rcSrc)) return;
+
+	if(pSrcImage->m_iAlpha >= 0)
+	{
+	    if(pSrcImage->m_pSurface) OGE_SetAlpha(pSrcImage->m_pSurface, 0, 0);
+	    pSrcImage->m_iAlpha = -1;
+    }
+
+    if (!GetValidRect(iDstLeft, iDstTop, &rcSrc, &rcDst)) return;
+
+    if(bUseSpans)
+    {
+        BeginUpdate();
+
+        OGE_FX_SpanBlt((Uint8 *)m_pSurface->pixels, m_pSurface->pitch,
+                        rcDst.x, rcDst.y,
+                        pSrcImage->m_pSpans,
+                        rcSrc.x, rcSrc.y,
+                        rcSrc.w, rcSrc.h);
+
+        EndUpdate();
+        return;
+    }
+
+    if(bUseIndexed)
+    {
+        BeginUpdate();
+
+        OGE_FX_IndexedBlt((Uint8 *)m_pSurface->pixels, m_pSurface->pitch,
+                        rcDst.x, rcDst.y,
+                        pSrcImage->m_pIndexed, pSrcImage->m_pPalette,
+                        rcSrc.x, rcSrc.y,
+                        rcSrc.w, rcSrc.h);
+
+        EndUpdate();
+        return;
+    }
+
+
+/*
+    if(pSrcImage->m_bHasAlphaChannel)
+    {
+#if (defined __OGE_WITH_SDL2__)
+        //bool bNeedLockSrc = SDL_MUSTLOCK(pSrcImage->m_pSurface) != 0;
+        //bool bNeedLockDst = SDL_MUSTLOCK(m_pSurface) != 0;
+        // just force the images to be locked ...
+        bool bNeedLockSrc = true;
+        bool bNeedLockDst = true;
+#else
+        bool bNeedLockSrc = false;
+        bool bNeedLockDst = false;
+#endif
+
+        if (bNeedLockSrc) bNeedLockSrc = SDL_LockSurface(pSrcImage->m_pSurface) == 0;
+        if (bNeedLockDst) bNeedLockDst = SDL_LockSurface(m_pSurface) == 0;
+
+        SDL_BlitSurface(pSrcImage->m_pSurface, &rcSrc, m_pSurface, &rcDst);
+
+        if (bNeedLockSrc) SDL_UnlockSurface(pSrcImage->m_pSurface);
+        if (bNeedLockDst) SDL_UnlockSurface(m_pSurface);
+    }
+    else
+    {
+        SDL_BlitSurface(pSrcImage->m_pSurface, &rcSrc, m_pSurface, &rcDst);
+    }
+*/
+
+    SDL_BlitSurface(pSrcImage->m_pSurface, &rcSrc, m_pSurface, &rcDst);
+
+}
+
+void CogeImage::BltAlphaBlend( CogeImage* pSrcImage, int iAlpha,
+                        int iDstLeft, int iDstTop,
+                        int iSrcLeft, int iSrcTop, int iSrcWidth, int iSrcHeight )
+{
+    if(iAlpha <= 0) return;
+
+    PrepareRawData(true);
+
+    // the global alpha works along with the per-pixel one only in this way
+    if(iAlpha < 255 && DrawPremultiplied(pSrcImage, iAlpha, iDstLeft, iDstTop, iSrcLeft, iSrcTop, iSrcWidth, iSrcHeight)) return;
+
+    bool bAutoAlpha = false;
+
+    if(iAlpha < 255)
+	{
+	    if(pSrcImage->m_bHasAlphaChannel && pSrcImage->m_bHasLocalClipboard)
+	    {
+	        SDL_Rect rcSrc = {0};
+            SDL_Rect rcDst = {0};
+
+            if (iSrcWidth == -1) iSrcWidth = pSrcImage->m_iWidth;
+            if (iSrcHeight == -1) iSrcHeight = pSrcImage->m_iHeight;
+
+            if(!pSrcImage->GetValidRect(iSrcLeft, iSrcTop, iSrcWidth, iSrcHeight, &rcSrc)) return;
+            if (!GetValidRect(iDstLeft, iDstTop, &rcSrc, &rcDst)) return;
+
+            SDL_Surface* pSurface = pSrcImage->GetCurrentClipboard();
+            if(pSurface == NULL) pSurface = pSrcImage->GetSurface();
+
+            SDL_Surface* pBackup = pSrcImage->GetFreeClipboard();
+
+            if (!pBackup)
+            {
+                SDL_BlitSurface(pSurface, &rcSrc, m_pSurface, &rcDst);
+                return;
+            }
+
+#if (defined __OGE_WITH_SDL2__) && (defined __IMG_WITH_LOCK__)
+//#if (defined __OGE_WITH_SDL2__)
+            bool bNeedLockSrc = SDL_MUSTLOCK(pSurface) != 0;
+            bool bNeedLockDst = SDL_MUSTLOCK(pBackup) != 0;
+            // just force the images to be locked ...
+            //bool bNeedLockSrc = true;
+            //bool bNeedLockDst = true;
+#else
+            bool bNeedLockSrc = false;
+            bool bNeedLockDst = false;
+#endif
+
+            if (bNeedLockSrc) bNeedLockSrc = SDL_LockSurface(pSurface) == 0;
+            if (bNeedLockDst) bNeedLockDst = SDL_LockSurface(pBackup) == 0;
+
+            uint8_t* pSrc = (Uint8 *)pSurface->pixels;
+            uint8_t* pDst = (Uint8 *)pBackup->pixels;
+
+            int iSrcLineSize = pSurface->pitch;
+            int iDstLineSize = pBackup->pitch;
+
+            //OGE_FX_UpdateAlphaBlt(pDst, iDstLineSize, 0, 0,
+            //                      pSrc, iSrcLineSize, 0, 0,
+            //                      iSrcWidth, iSrcHeight,
+            //                      pSurface->format->BitsPerPixel,
+            //                      pSurface->format->Amask,
+            //                      iAlpha - 255);
+
+            //OGE_Log("\n BPP: %d, AMask: %d \n", pSurface->format->BitsPerPixel, pSurface->format->Amask);
+
+            OGE_FX_UpdateAlphaBlt(pDst, iDstLineSize, 0, 0,
+                                  pSrc, iSrcLineSize, 0, 0,
+                                  iSrcWidth, iSrcHeight,
+                                  pSurface->format->BitsPerPixel,
+                                  pSurface->format->Amask,
+                                  iAlpha);
+
+            if (bNeedLockSrc) SDL_UnlockSurface(pSurface);
+            if (bNeedLockDst) SDL_UnlockSurface(pBackup);
+
+            pSrcImage->m_iEffectCount = pSrcImage->m_iEffectCount - 1;
+
+            if(pSrcImage->m_iEffectCount < 0) pSrcImage->m_iEffectCount = 0;
+
+            if(pSrcImage->m_iEffectCount == 0)
+            {
+                pSrcImage->SetCurrentClipboard(NULL);
+                SDL_BlitSurface(pBackup, &rcSrc, m_pSurface, &rcDst);
+            }
+            else pSrcImage->SetCurrentClipboard(pBackup);
+
+            return ;
+
+	    }
+	    else if(pSrcImage->m_pSpans && pSrcImage != this)
+	    {
+	        SDL_Rect rcSrc = {0};
+            SDL_Rect rcDst = {0};
+
+            if (iSrcWidth == -1) iSrcWidth = pSrcImage->m_iWidth;
+            if (iSrcHeight == -1) iSrcHeight = pSrcImage->m_iHeight;
+
+            if(!pSrcImage->ClipRect(iSrcLeft, iSrcTop, iSrcWidth, iSrcHeight, &rcSrc)) return;
+            if (!GetValidRect(iDstLeft, iDstTop, &rcSrc, &rcDst)) return;
+
+            BeginUpdate();
+
+            OGE_FX_SpanAlphaBlend((Uint8 *)m_pSurface->pixels, m_pSurface->pitch,
+                                  rcDst.x, rcDst.y,
+                                  pSrcImage->m_pSpans,
+                                  rcSrc.x, rcSrc.y,
+                                  rcSrc.w, rcSrc.h, iAlpha);
+
+            EndUpdate();
+            return;
+	    }
+	    else if(pSrcImage->m_pIndexed && pSrcImage != this)
+	    {
+	        // the indexed pixels of the source are drawn through its palette
+	        SDL_Rect rcSrc = {0};
+            SDL_Rect rcDst = {0};
+
+            if (iSrcWidth == -1) iSrcWidth = pSrcImage->m_iWidth;
+            if (iSrcHeight == -1) iSrcHeight = pSrcImage->m_iHeight;
+
+            if(!pSrcImage->ClipRect(iSrcLeft, iSrcTop, iSrcWidth, iSrcHeight, &rcSrc)) return;
+            if (!GetValidRect(iDstLeft, iDstTop, &rcSrc, &rcDst)) return;
 
-			case 32:
-				for(i=0; i<_OGE_DOT_FONT_SIZE_; i++)
-				{
-					iMask = 0x80;
-					for(j=0;j<8;j++)
-					{
-						if (((unsigned char)(*pFontData) & iMask) > 0)  // if there is a dot ...
-						{
-							pDst = pDstBuffer + iLineSize * (y+i) + 4*(x+j);
-							(*((int*)pDst)) = iPenColor;
-						}
-						iMask >>= 1;
-					}
-					pFontData++;
-				}
-				x += (iFontSpace+8);
-				break;
+            BeginUpdate();
 
-			} // end of switch
+            OGE_FX_IndexedAlphaBlend((Uint8 *)m_pSurface->pixels, m_pSurface->pitch,
+                                  rcDst.x, rcDst.y,
+                                  pSrcImage->m_pIndexed, pSrcImage->m_pPalette,
+                                  rcSrc.x, rcSrc.y,
+                                  rcSrc.w, rcSrc.h, iAlpha);
 
-			pText++;
+            EndUpdate();
+            return;
+	    }
+	    else
+	    {
 
-		}  // end if ascii
-		else if ( (pText+1) && (unsigned char)(*pText) > 0x00a0 && (unsigned char)(*(pText+1)) > 0x00a0 ) // if hzk
-		{
-			if (x+8+iFontSpace - iBeginX > iWidth)
-			{
-				bNextLine = true;
-                continue;
-			}
+//#if (!defined __ANDROID__)
 
-            /*
-			switch (iFontSize)
-			{
-			case 12:
-				pFontData = hzk12;
-				break;
-			case 16:
-				pFontData = hzk16;
-				break;
-			default:
-				pFontData = hzk12;
-			}
-			*/
+	        if(pSrcImage->m_iAlpha != iAlpha)
+            {
+                OGE_SetAlpha(pSrcImage->m_pSurface, OGE_SRCALPHA, iAlpha);
+                pSrcImage->m_iAlpha = iAlpha;
+            }
 
-            pFontData = hzk16;
+            bAutoAlpha = true;
 
-			if (pFontData) pFontData += ( ((unsigned char)(*pText)-0x00a1)*94 + ((unsigned char)(*(pText+1))-0x00a1) ) * _OGE_DOT_FONT_SIZE_ * 2;
-			else
-			{
-				pText += 2;
-				continue;
-			}
+//#endif
 
-			switch (iBPP)
-			{
-            case 8:
-                for(i=0; i<_OGE_DOT_FONT_SIZE_; i++)
-				{
-					//iMask = 0x8000;
-					pFontData += 1;
-					iMask = 0x80;
-					for(j=8;j<_OGE_DOT_FONT_SIZE_;j++)
-					{
-						if (((*(short*)pFontData) & iMask) > 0)  // if there is a dot ...
-						{
-							pDst = pDstBuffer + iLineSize * (y+i) + (x+j);
-							(*((char*)pDst)) = iPenColor;
-						}
-						iMask >>= 1;
-					}
+	    }
+    }
+    else
+    {
+        Draw(pSrcImage, iDstLeft, iDstTop, iSrcLeft, iSrcTop, iSrcWidth, iSrcHeight);
+        return;
+    }
 
-					pFontData -= 1;
-					iMask = 0x80;
-					for(j=0;j<8;j++)
-					{
-						if (((*(short*)pFontData) & iMask) > 0)  // if there is a dot ...
-						{
-							pDst = pDstBuffer + iLineSize * (y+i) + (x+j);
-							(*((char*)pDst)) = iPenColor;
-						}
-						iMask >>= 1;
-					}
+    SDL_Rect rcSrc = {0};
+	SDL_Rect rcDst = {0};
 
-					pFontData += 2;
-				}
-				x += (iFontSpace+_OGE_DOT_FONT_SIZE_);
-				break;
-			case 15:
-			case 16:
-				for(i=0; i<_OGE_DOT_FONT_SIZE_; i++)
-				{
-					//iMask = 0x8000;
-					pFontData += 1;
-					iMask = 0x80;
-					for(j=8;j<_OGE_DOT_FONT_SIZE_;j++)
-					{
-						if (((*(short*)pFontData) & iMask) > 0)  // if there is a dot ...
-						{
-							pDst = pDstBuffer + iLineSize * (y+i) + 2*(x+j);
-							(*((short*)pDst)) = iPenColor;
-						}
-						iMask >>= 1;
-					}
-					pFontData -= 1;
-					iMask = 0x80;
-					for(j=0;j<8;j++)
-					{
-						if (((*(short*)pFontData) & iMask) > 0)  // if there is a dot ...
-						{
-							pDst = pDstBuffer + iLineSize * (y+i) + 2*(x+j);
-							(*((short*)pDst)) = iPenColor;
-						}
-						iMask >>= 1;
-					}
+	if (iSrcWidth == -1) iSrcWidth = pSrcImage->m_iWidth;
+	if (iSrcHeight == -1) iSrcHeight = pSrcImage->m_iHeight;
 
-					pFontData += 2;
-				}
-				x += (iFontSpace+_OGE_DOT_FONT_SIZE_);
-				break;
+	//rcSrc.x = iSrcLeft;
+	//rcSrc.y = iSrcTop;
+	//rcSrc.w = iSrcWidth;
+	//rcSrc.h = iSrcHeight;
 
-			case 32:
-				for(i=0; i<_OGE_DOT_FONT_SIZE_; i++)
-				{
-					//iMask = 0x8000;
-					pFontData += 1;
-					iMask = 0x80;
-					for(j=8;j<_OGE_DOT_FONT_SIZE_;j++)
-					{
-						if (((*(short*)pFontData) & iMask) > 0)  // if there is a dot ...
-						{
-							pDst = pDstBuffer + iLineSize * (y+i) + 4*(x+j);
-							(*((int*)pDst)) = iPenColor;
-						}
-						iMask >>= 1;
-					}
-					pFontData -= 1;
-					iMask = 0x80;
-					for(j=0;j<8;j++)
-					{
-						if (((*(short*)pFontData) & iMask) > 0)  // if there is a dot ...
-						{
-							pDst = pDstBuffer + iLineSize * (y+i) + 4*(x+j);
-							(*((int*)pDst)) = iPenColor;
-						}
-						iMask >>= 1;
-					}
+	if(!pSrcImage->GetValidRect(iSrcLeft, iSrcTop, iSrcWidth, iSrcHeight, &rcSrc)) return;
+    if (!GetValidRect(iDstLeft, iDstTop, &rcSrc, &rcDst)) return;
 
-					pFontData += 2;
-				}
-				x += (iFontSpace+_OGE_DOT_FONT_SIZE_);
-				break;
 
-			} // end of switch
+    if(bAutoAlpha)
+    {
+        SDL_BlitSurface(pSrcImage->m_pSurface, &rcSrc, m_pSurface, &rcDst);
+    }
+    else
+    {
+        uint8_t* pSrc = (Uint8 *)pSrcImage->m_pSurface->pixels;
+        uint8_t* pDst = (Uint8 *)m_pSurface->pixels;
 
-			pText += 2;
+        int iSrcLineSize = pSrcImage->m_pSurface->pitch;
+        int iDstLineSize = m_pSurface->pitch;
+
+        OGE_FX_AlphaBlend(pDst, iDstLineSize,
+                            rcDst.x, rcDst.y,
+                            pSrc, iSrcLineSize, pSrcImage->m_iColorKey,
+                            rcSrc.x, rcSrc.y,
+                            rcSrc.w, rcSrc.h, m_iBPP, iAlpha);
+    }
+
+}
+
+void CogeImage::DrawLine(int iStartX, int iStartY, int iEndX, int iEndY)
+{
+	uint8_t* pDst;
+	int iLineSize = 0;
+
+	PrepareRawData(true);
+
+	BeginUpdate();
+
+	pDst = (Uint8 *)m_pSurface->pixels;
+	iLineSize = m_pSurface->pitch;
+
+	OGE_FX_Line(pDst, iLineSize, m_iBPP, m_iPenColor, m_iWidth-1, m_iHeight-1, iStartX, iStartY, iEndX, iEndY);
+
+	EndUpdate();
+}
+void CogeImage::DrawCircle(int iCenterX, int iCenterY, int iRadius)
+{
+    uint8_t* pDst;
+
+	int iLineSize = 0;
+
+	//if (SDL_LockSurface(m_pSurface) < 0) return;
+
+	//try
+	//{
+
+	//if (m_pddSurface->Lock(&rcDst, &ddsd, DDLOCK_WAIT, NULL) != DD_OK) return;
 
-		}  // end of if hzk ...
-		else
-		{
-			pText++;
-		}
+	PrepareRawData(true);
 
-	} // end while ...
-}
+	BeginUpdate();
 
+	pDst = (Uint8 *)m_pSurface->pixels;
+	iLineSize = m_pSurface->pitch;
 
+	OGE_FX_Circle(pDst, iLineSize, m_iBPP, m_iPenColor, m_iWidth-1, m_iHeight-1, iCenterX, iCenterY, iRadius);
 
-/*---------------- Image -----------------*/
+	//OGE_FX_LightnessRGB(pDst, iLineSize, rcDst.x, rcDst.y, rcDst.w, rcDst.h, m_iBPP, -iAmount, 0, 0 );
 
+	//}
+	//catch ( ... )
+	//{
+	//    SDL_UnlockSurface( m_pSurface );
+    //}
 
-CogeImage::CogeImage(const std::string& sName):
-m_pSurface(NULL),
-m_pLocalClipboardA(NULL),
-m_pLocalClipboardB(NULL),
-m_pCurrentClipboard(NULL),
-m_pVideo(NULL),
-m_pDotFont(NULL),
-m_pDefaultFont(NULL),
-m_iWidth(0),
-m_iHeight(0),
-m_iBPP(0),
-m_iColorKeyRGB(-1),
-m_iColorKey(-1),
-m_iAlpha(-1),
-m_iPenColorRGB(0),
-m_iLockTimes(0),
-m_iTotalUsers(0),
-m_sName(sName)
-{
-    m_iPenColor = 0;
-    memset(&m_iPenColorSDL, 0, sizeof(m_iPenColorSDL));
+	//m_pddSurface->Unlock(&rcDst);
 
-    m_bHasAlphaChannel = false;
+	//SDL_UnlockSurface( m_pSurface );
 
-    m_iEffectCount = 0;
+	EndUpdate();
 }
 
-CogeImage::~CogeImage()
+void CogeImage::CopyRect(CogeImage* pSrcImage,
+                  int iDstLeft, int iDstTop,
+                  int iSrcLeft, int iSrcTop, int iSrcWidth, int iSrcHeight )
 {
-    if (m_pSurface)
-    {
-        SDL_FreeSurface(m_pSurface);
-        m_pSurface = NULL;
-    }
+    if ( m_pVideo->m_iState < 0 ) return;
 
-    if (m_pLocalClipboardA)
-    {
-        SDL_FreeSurface(m_pLocalClipboardA);
-        m_pLocalClipboardA = NULL;
-    }
+    PrepareRawData(true);
 
-    if (m_pLocalClipboardB)
-    {
-        SDL_FreeSurface(m_pLocalClipboardB);
-        m_pLocalClipboardB = NULL;
-    }
+    SDL_Rect rcSrc = {0};
+	SDL_Rect rcDst = {0};
 
-    m_pCurrentClipboard = NULL;
+	if (iSrcWidth == -1) iSrcWidth = pSrcImage->m_iWidth;
+	if (iSrcHeight == -1) iSrcHeight = pSrcImage->m_iHeight;
 
-	m_iTotalUsers  =  0;
+	if(!pSrcImage->GetValidRect(iSrcLeft, iSrcTop, iSrcWidth, iSrcHeight, &rcSrc)) return;
 
-	m_pDotFont = NULL;
-	m_pDefaultFont = NULL;
+	uint8_t* pSrc;
+	uint8_t* pDst;
 
-}
+	int iSrcLineSize = 0;
+	int iDstLineSize = 0;
 
-const std::string& CogeImage::GetName()
-{
-	return m_sName;
-}
+	if(!GetValidRect(iDstLeft, iDstTop, &rcSrc, &rcDst)) return;
 
+	pSrcImage->BeginUpdate();
+	this->BeginUpdate();
 
-// Width getter
-int CogeImage::GetWidth()
-{
-	return m_iWidth;
-}
+	pSrc = (Uint8 *)pSrcImage->m_pSurface->pixels;
+	iSrcLineSize =  pSrcImage->m_pSurface->pitch;
 
-// Height getter
-int CogeImage::GetHeight()
-{
-	return m_iHeight;
-}
+	pDst = (Uint8 *)m_pSurface->pixels;
+	iDstLineSize = m_pSurface->pitch;
 
-// BPP getter
-int CogeImage::GetBPP()
-{
-	return m_iBPP;
-}
+	OGE_FX_CopyRect(pDst, iDstLineSize,
+                        rcDst.x, rcDst.y,
+                        pSrc, iSrcLineSize,
+                        rcSrc.x, rcSrc.y,
+                        rcSrc.w, rcSrc.h, m_iBPP);
 
-bool CogeImage::HasAlphaChannel()
-{
-    return m_bHasAlphaChannel;
-}
+    pSrcImage->EndUpdate();
+	this->EndUpdate();
 
-bool CogeImage::HasLocalClipboard()
-{
-    return m_bHasLocalClipboard;
 }
 
-int CogeImage::GetPenColor()
-{
-	return m_iPenColorRGB;
-}
-void CogeImage::SetPenColor(int iRGBColor)
+
+void CogeImage::Blt( CogeImage* pSrcImage,
+              int iDstLeft, int iDstTop, int iSrcColorKey,
+              int iSrcLeft, int iSrcTop, int iSrcWidth, int iSrcHeight )
 {
+    if ( m_pVideo->m_iState < 0 ) return;
 
-    if(m_iPenColorRGB == iRGBColor) return;
+    PrepareRawData(true);
 
-	m_iPenColorRGB = iRGBColor;
+    SDL_Rect rcSrc = {0};
+	SDL_Rect rcDst = {0};
 
-	m_iPenColor = m_pVideo->FormatColor(iRGBColor);
+	if (iSrcWidth == -1) iSrcWidth = pSrcImage->m_iWidth;
+	if (iSrcHeight == -1) iSrcHeight = pSrcImage->m_iHeight;
 
-	m_iPenColorSDL.r = (iRGBColor&0x00ff0000)>>16;
-	m_iPenColorSDL.g = (iRGBColor&0x0000ff00)>>8;
-	m_iPenColorSDL.b =  iRGBColor&0x000000ff;
+	bool bUseSpans = pSrcImage->m_pSpans != NULL && pSrcImage != this && iSrcColorKey == pSrcImage->m_iColorKey;
 
-}
+	// the indexed pixels of the source are drawn through its palette
+	bool bUseIndexed = pSrcImage->m_pIndexed != NULL && pSrcImage != this && iSrcColorKey == pSrcImage->m_iColorKey;
 
-void CogeImage::SetColorKey(int iColorKeyRGB)
-{
-    if (iColorKeyRGB == -1)
-    {
-        SDL_SetColorKey(m_pSurface, 0, 0);
-        m_iColorKeyRGB = -1;
-        m_iColorKey = -1;
-    }
-	else
+	if(bUseSpans || bUseIndexed)
 	{
-	    if(m_iColorKeyRGB != iColorKeyRGB)
-	    {
-	        m_iColorKey = m_pVideo->FormatColor(iColorKeyRGB);
-            SDL_SetColorKey(m_pSurface,
-                            OGE_SRCCOLORKEY,
-                            m_iColorKey);
-            m_iColorKeyRGB = iColorKeyRGB;
-	    }
+	    if(!pSrcImage->ClipRect(iSrcLeft, iSrcTop, iSrcWidth, iSrcHeight, &rcSrc)) return;
 	}
-}
-
-int CogeImage::GetColorKey()
-{
-    return m_iColorKeyRGB;
-}
-
-int CogeImage::GetRawColorKey()
-{
-    return m_iColorKey;
-}
+	else if(!pSrcImage->GetValidRect(iSrcLeft, iSrcTop, iSrcWidth, iSrcHeight, &rcSrc)) return;
 
-void CogeImage::SetAlpha(int iAlpha)
-{
-    if(iAlpha >= 0)
-	{
-	    if(m_iAlpha != iAlpha)
-	    {
-            OGE_SetAlpha(m_pSurface, OGE_SRCALPHA, iAlpha);
-            m_iAlpha = iAlpha;
-	    }
-    }
-    else
-    {
-        OGE_SetAlpha(m_pSurface, 0, 0);
-        m_iAlpha = -1;
-    }
-}
+	uint8_t* pSrc;
+	uint8_t* pDst;
 
-void CogeImage::SetDefaultFont(CogeFont* pFont)
-{
-    if(m_pDefaultFont == pFont) return;
+	int iSrcLineSize = 0;
+	int iDstLineSize = 0;
 
-    if(m_pDefaultFont) m_pDefaultFont->Fire();
-    m_pDefaultFont = pFont;
-    if(m_pDefaultFont) m_pDefaultFont->Hire();
+	if(!GetValidRect(iDstLeft, iDstTop, &rcSrc, &rcDst)) return;
 
-}
-CogeFont* CogeImage::GetDefaultFont()
-{
-    return m_pDefaultFont;
-}
+	if(bUseSpans)
+	{
+	    this->BeginUpdate();
 
-//int CogeImage::GetTotalUsers()
-//{
-//    return m_iTotalUsers;
-//}
+	    pDst = (Uint8 *)m_pSurface->pixels;
+	    iDstLineSize = m_pSurface->pitch;
 
-CogeVideo* CogeImage::GetVideoEngine()
-{
-    return m_pVideo;
-}
+	    OGE_FX_SpanBlt(pDst, iDstLineSize,
+                            rcDst.x, rcDst.y,
+                            pSrcImage->m_pSpans,
+                            rcSrc.x, rcSrc.y,
+                            rcSrc.w, rcSrc.h);
 
-int CogeImage::SaveAsBMP(const std::string& sFileName)
-{
-    if(m_pSurface) return SDL_SaveBMP(m_pSurface, sFileName.c_str());
-    else return -1;
-}
+	    this->EndUpdate();
+	    return;
+	}
 
-SDL_Surface * CogeImage::GetSurface()
-{
-    return m_pSurface;
-}
+	if(bUseIndexed)
+	{
+	    this->BeginUpdate();
 
-SDL_Surface* CogeImage::GetFreeClipboard()
-{
-    if(m_pCurrentClipboard && m_pCurrentClipboard == m_pLocalClipboardA) return m_pLocalClipboardB;
-    else return m_pLocalClipboardA;
-}
-SDL_Surface* CogeImage::GetCurrentClipboard()
-{
-    return m_pCurrentClipboard;
-}
-void CogeImage::SetCurrentClipboard(SDL_Surface* pClipboard)
-{
-    if(pClipboard == NULL) m_pCurrentClipboard = NULL;
-    else if(pClipboard == m_pLocalClipboardA) m_pCurrentClipboard = m_pLocalClipboardA;
-    else if(pClipboard == m_pLocalClipboardB) m_pCurrentClipboard = m_pLocalClipboardB;
-}
-void CogeImage::PrepareLocalClipboards(int iEffectCount)
-{
-    SetCurrentClipboard(NULL);
-    m_iEffectCount = iEffectCount;
-}
+	    pDst = (Uint8 *)m_pSurface->pixels;
+	    iDstLineSize = m_pSurface->pitch;
 
+	    OGE_FX_IndexedBlt(pDst, iDstLineSize,
+                            rcDst.x, rcDst.y,
+                            pSrcImage->m_pIndexed, pSrcImage->m_pPalette,
+                            rcSrc.x, rcSrc.y,
+                            rcSrc.w, rcSrc.h);
 
-void CogeImage::Fire()
-{
-    m_iTotalUsers--;
-	if (m_iTotalUsers < 0) m_iTotalUsers = 0;
-}
+	    this->EndUpdate();
+	    return;
+	}
 
-void CogeImage::Hire()
-{
-    if (m_iTotalUsers < 0) m_iTotalUsers = 0;
-	m_iTotalUsers++;
-}
+	pSrcImage->BeginUpdate();
+	this->BeginUpdate();
 
+	pSrc = (Uint8 *)pSrcImage->m_pSurface->pixels;
+	iSrcLineSize =  pSrcImage->m_pSurface->pitch;
 
-/*
-void CogeImage::GetValidRect(SDL_Rect& rc)
-{
-//  if(rc.x < 0) rc.x = 0;
-//	if(rc.y < 0) rc.y = 0;
-//	if(rc.w < 0) rc.w = 0;
-//	if(rc.h < 0) rc.h = 0;
+	pDst = (Uint8 *)m_pSurface->pixels;
+	iDstLineSize = m_pSurface->pitch;
 
-	if(rc.x > m_iWidth) rc.x  = m_iWidth;
-	if(rc.y > m_iHeight) rc.y = m_iHeight;
-	if(rc.x+rc.w > m_iWidth) rc.w = m_iWidth - rc.x;
-	if(rc.y+rc.h > m_iHeight) rc.h = m_iHeight - rc.y;
+	OGE_FX_Blt(pDst, iDstLineSize,
+                        rcDst.x, rcDst.y,
+                        pSrc, iSrcLineSize, iSrcColorKey,
+                        rcSrc.x, rcSrc.y,
+                        rcSrc.w, rcSrc.h, m_iBPP);
+
+    pSrcImage->EndUpdate();
+	this->EndUpdate();
 }
-*/
 
-bool CogeImage::GetValidRect(int x, int y, int w, int h, SDL_Rect* rslrc)
+void CogeImage::BltChangedRGB( CogeImage* pSrcImage, int iAmount,
+                        int iDstLeft, int iDstTop,
+                        int iSrcLeft, int iSrcTop, int iSrcWidth, int iSrcHeight )
 {
-    //SDL_Rect rc = {0};
 
-    //volatile SDL_Rect* rslrc = rc;
+	if ( m_pVideo->m_iState < 0 ) return;
 
-    if(x > m_iWidth || y > m_iHeight) return false;
+	PrepareRawData(true);
 
-    if(x < 0) {w=w+x; x=0;}
-	if(y < 0) {h=h+y; y=0;}
+	int iBlueAmount  = iAmount & 0x000000ff;
+	int iGreenAmount = (iAmount & 0x0000ff00) >> 8;
+	int iRedAmount   = (iAmount & 0x00ff0000) >> 16;
+	int iAlphaAmount = (iAmount & 0xff000000) >> 24;
 
-	//if(w < 0) w = 0;
-	//if(h < 0) h = 0;
+	if((iAlphaAmount & 1) > 0) iBlueAmount = 0 - iBlueAmount;
+	if((iAlphaAmount & 2) > 0) iGreenAmount = 0 - iGreenAmount;
+	if((iAlphaAmount & 4) > 0) iRedAmount = 0 - iRedAmount;
 
-	if(w <= 0 || h <= 0) return false;
+    SDL_Rect rcSrc = {0};
+	SDL_Rect rcDst = {0};
 
-	//if(x > m_iWidth) x = m_iWidth;
-	//if(y > m_iHeight) y = m_iHeight;
+	if (iSrcWidth == -1) iSrcWidth = pSrcImage->m_iWidth;
+	if (iSrcHeight == -1) iSrcHeight = pSrcImage->m_iHeight;
 
-	if(x+w > m_iWidth) w = m_iWidth - x;
-	if(y+h > m_iHeight) h = m_iHeight - y;
+	bool bUseSpans = pSrcImage->m_pSpans != NULL && pSrcImage != this;
 
-	rslrc->x = x;
-	rslrc->y = y;
-	rslrc->w = w;
-	rslrc->h = h;
+	// the indexed pixels of the source are drawn through its palette
+	bool bUseIndexed = pSrcImage->m_pIndexed != NULL && pSrcImage != this;
 
-	return true;
+	if(bUseSpans || bUseIndexed)
+	{
+	    if(!pSrcImage->ClipRect(iSrcLeft, iSrcTop, iSrcWidth, iSrcHeight, &rcSrc)) return;
+	}
+	else if(!pSrcImage->GetValidRect(iSrcLeft, iSrcTop, iSrcWidth, iSrcHeight, &rcSrc)) return;
 
-}
+	uint8_t* pSrc;
+	uint8_t* pDst;
 
-bool CogeImage::GetValidRect(int x, int y, SDL_Rect* rcRslSrc, SDL_Rect* rcRslDst)
-{
-    //SDL_Rect rc = {0};
+	int iSrcLineSize = 0;
+	int iDstLineSize = 0;
 
-    //volatile SDL_Rect* rcRslSrc = rcSrc;
-    //volatile SDL_Rect* rcRslDst = rcDst;
+	if(!GetValidRect(iDstLeft, iDstTop, &rcSrc, &rcDst)) return;
 
-    if(x > m_iWidth || y > m_iHeight) return false;
+	if(bUseSpans)
+	{
+	    this->BeginUpdate();
 
-    int w = rcRslSrc->w;
-	int h = rcRslSrc->h;
+	    pDst = (Uint8 *)m_pSurface->pixels;
+	    iDstLineSize = m_pSurface->pitch;
 
-    if(x < 0) {rcRslSrc->x=rcRslSrc->x-x; w=w+x; x=0;}
-	if(y < 0) {rcRslSrc->y=rcRslSrc->y-y; h=h+y; y=0;}
+	    OGE_FX_SpanBltChangedRGB(pDst, iDstLineSize,
+                            rcDst.x, rcDst.y,
+                            pSrcImage->m_pSpans,
+                            rcSrc.x, rcSrc.y,
+                            rcSrc.w, rcSrc.h,
+                            iRedAmount, iGreenAmount, iBlueAmount);
 
-	if(w <= 0 || h <= 0) return false;
+	    this->EndUpdate();
+	    return;
+	}
 
-	//if(x > m_iWidth) x = m_iWidth;
-	//if(y > m_iHeight) y = m_iHeight;
+	if(bUseIndexed)
+	{
+	    this->BeginUpdate();
 
-	if(x+w > m_iWidth)  w = m_iWidth - x;
-	if(y+h > m_iHeight) h = m_iHeight - y;
+	    pDst = (Uint8 *)m_pSurface->pixels;
+	    iDstLineSize = m_pSurface->pitch;
 
-	rcRslSrc->w = w;
-	rcRslSrc->h = h;
+	    OGE_FX_IndexedBltChangedRGB(pDst, iDstLineSize,
+                            rcDst.x, rcDst.y,
+                            pSrcImage->m_pIndexed, pSrcImage->m_pPalette,
+                            rcSrc.x, rcSrc.y,
+                            rcSrc.w, rcSrc.h,
+                            iRedAmount, iGreenAmount, iBlueAmount);
 
-	rcRslDst->x = x;
-	rcRslDst->y = y;
-	rcRslDst->w = w;
-	rcRslDst->h = h;
+	    this->EndUpdate();
+	    return;
+	}
 
-	return true;
-}
+	pSrcImage->BeginUpdate();
+	this->BeginUpdate();
 
+	pSrc = (Uint8 *)pSrcImage->m_pSurface->pixels;
+	iSrcLineSize =  pSrcImage->m_pSurface->pitch;
 
-void CogeImage::GetValidRect(CogeRect* rslrc)
-{
-    //volatile CogeRect* rslrc = rc;
+	pDst = (Uint8 *)m_pSurface->pixels;
+	iDstLineSize = m_pSurface->pitch;
 
-    if(rslrc->left < 0) rslrc->left = 0;
-	if(rslrc->top < 0) rslrc->top = 0;
-	if(rslrc->right < 0) rslrc->right = 0;
-	if(rslrc->bottom < 0) rslrc->bottom = 0;
+	OGE_FX_BltChangedRGB(pDst, iDstLineSize,
+                        rcDst.x, rcDst.y,
+                        pSrc, iSrcLineSize, pSrcImage->m_iColorKey,
+                        rcSrc.x, rcSrc.y,
+                        rcSrc.w, rcSrc.h, m_iBPP,
+                        iRedAmount, iGreenAmount, iBlueAmount);
 
-	if(rslrc->left > m_iWidth) rslrc->left = m_iWidth;
-	if(rslrc->top > m_iHeight) rslrc->top = m_iHeight;
-	if(rslrc->right > m_iWidth) rslrc->right = m_iWidth;
-	if(rslrc->bottom > m_iHeight) rslrc->bottom = m_iHeight;
+    pSrcImage->EndUpdate();
+	this->EndUpdate();
 }
 
-void CogeImage::BeginUpdate()
+void CogeImage::BltWithColor( CogeImage* pSrcImage, int iColor, int iAlpha,
+                        int iDstLeft, int iDstTop,
+                        int iSrcLeft, int iSrcTop, int iSrcWidth, int iSrcHeight )
 {
-#ifdef __OGE_WITH_SDL2__
-
-#ifdef __IMG_WITH_LOCK__
-    if(m_iLockTimes < 0) m_iLockTimes = 0;
-    if(m_pSurface && SDL_MUSTLOCK(m_pSurface))
-    {
-        if(SDL_LockSurface(m_pSurface) == 0) m_iLockTimes++;
-    }
-#else
-    return;
-#endif
+    if ( m_pVideo->m_iState < 0 ) return;
 
-#else
+    PrepareRawData(true);
 
-    return;
+    SDL_Rect rcSrc = {0};
+	SDL_Rect rcDst = {0};
 
-#endif
+	if (iSrcWidth == -1) iSrcWidth = pSrcImage->m_iWidth;
+	if (iSrcHeight == -1) iSrcHeight = pSrcImage->m_iHeight;
 
-}
-void CogeImage::EndUpdate()
-{
+	bool bUseSpans = pSrcImage->m_pSpans != NULL && pSrcImage != this;
 
-#ifdef __OGE_WITH_SDL2__
+	// the indexed pixels of the source are drawn through its palette
+	bool bUseIndexed = pSrcImage->m_pIndexed != NULL && pSrcImage != this;
 
-#ifdef __IMG_WITH_LOCK__
-    if(m_pSurface && m_iLockTimes > 0)
-    {
-        SDL_UnlockSurface(m_pSurface);
-        m_iLockTimes--;
-    }
-    if(m_iLockTimes < 0) m_iLockTimes = 0;
-#else
-    return;
-#endif
+	if(bUseSpans || bUseIndexed)
+	{
+	    if(!pSrcImage->ClipRect(iSrcLeft, iSrcTop, iSrcWidth, iSrcHeight, &rcSrc)) return;
+	}
+	else if(!pSrcImage->GetValidRect(iSrcLeft, iSrcTop, iSrcWidth, iSrcHeight, &rcSrc)) return;
 
-#else
+	uint8_t* pSrc;
+	uint8_t* pDst;
 
-    return;
+	int iSrcLineSize = 0;
+	int iDstLineSize = 0;
 
-#endif
+	if(!GetValidRect(iDstLeft, iDstTop, &rcSrc, &rcDst)) return;
 
-}
+	iColor = m_pVideo->FormatColor(iColor);
 
-CogeRect CogeImage::GetDotTextRect(const char* pText, int x, int y,
-                                    int iMaxWidth, int iFontSpace, int iLineSpace)
-{
-    CogeRect rcDst = {0};
+	if(bUseSpans)
+	{
+	    this->BeginUpdate();
 
-	int iWidth = 0;
-	int iHeight = 0;
+	    pDst = (Uint8 *)m_pSurface->pixels;
+	    iDstLineSize = m_pSurface->pitch;
 
-	if (!m_pDotFont) return rcDst;
+	    OGE_FX_SpanBltWithColor(pDst, iDstLineSize,
+                            rcDst.x, rcDst.y,
+                            pSrcImage->m_pSpans,
+                            rcSrc.x, rcSrc.y,
+                            rcSrc.w, rcSrc.h, iColor, iAlpha);
 
-	if (iMaxWidth == 0)
-	{
-		iWidth = m_pDotFont->GetTextWidth(pText, iFontSpace) + iFontSpace;
-		iHeight = _OGE_DOT_FONT_SIZE_ + iLineSpace;
+	    this->EndUpdate();
+	    return;
 	}
-	else
+
+	if(bUseIndexed)
 	{
-		iWidth = iMaxWidth + iFontSpace;
-		iHeight = m_pDotFont->GetTextHeight(pText, iMaxWidth, iFontSpace, iLineSpace) + iLineSpace;
+	    this->BeginUpdate();
+
+	    pDst = (Uint8 *)m_pSurface->pixels;
+	    iDstLineSize = m_pSurface->pitch;
+
+	    OGE_FX_IndexedBltWithColor(pDst, iDstLineSize,
+                            rcDst.x, rcDst.y,
+                            pSrcImage->m_pIndexed, pSrcImage->m_pPalette,
+                            rcSrc.x, rcSrc.y,
+                            rcSrc.w, rcSrc.h, iColor, iAlpha);
+
+	    this->EndUpdate();
+	    return;
 	}
 
-    rcDst.left   = x;
-	rcDst.top    = y;
-	rcDst.right  = x + iWidth;
-	rcDst.bottom = y  + iHeight;
+	pSrcImage->BeginUpdate();
+	this->BeginUpdate();
 
-	return rcDst;
+	pSrc = (Uint8 *)pSrcImage->m_pSurface->pixels;
+	iSrcLineSize =  pSrcImage->m_pSurface->pitch;
+
+	pDst = (Uint8 *)m_pSurface->pixels;
+	iDstLineSize = m_pSurface->pitch;
+
+	OGE_FX_BltWithColor(pDst, iDstLineSize,
+                        rcDst.x, rcDst.y,
+                        pSrc, iSrcLineSize, pSrcImage->m_iColorKey,
+                        rcSrc.x, rcSrc.y,
+                        rcSrc.w, rcSrc.h, m_iBPP, iColor, iAlpha);
 
+    pSrcImage->EndUpdate();
+	this->EndUpdate();
 }
 
-void CogeImage::DotTextOut(const char* pText, int x, int y,
-                            int iMaxWidth, int iFontSpace, int iLineSpace)
+void CogeImage::BltWithEdge( CogeImage* pSrcImage, int iEdgeColor,
+                        int iDstLeft, int iDstTop,
+                        int iSrcLeft, int iSrcTop, int iSrcWidth, int iSrcHeight )
 {
-    if(m_pDotFont == NULL) return;
+    if ( m_pVideo->m_iState < 0 ) return;
+
+    PrepareRawData(true);
+
+    SDL_Rect rcSrc = {0};
+	SDL_Rect rcDst = {0};
+
+	if (iSrcWidth == -1) iSrcWidth = pSrcImage->m_iWidth;
+	if (iSrcHeight == -1) iSrcHeight = pSrcImage->m_iHeight;
+
+	if(!pSrcImage->GetValidRect(iSrcLeft, iSrcTop, iSrcWidth, iSrcHeight, &rcSrc)) return;
+
+	uint8_t* pSrc;
+	uint8_t* pDst;
+
+	int iSrcLineSize = 0;
+	int iDstLineSize = 0;
+
+	if(!GetValidRect(iDstLeft, iDstTop, &rcSrc, &rcDst)) return;
+
+	iEdgeColor = m_pVideo->FormatColor(iEdgeColor);
+
+	pSrcImage->BeginUpdate();
+	this->BeginUpdate();
+
+	pSrc = (Uint8 *)pSrcImage->m_pSurface->pixels;
+	iSrcLineSize =  pSrcImage->m_pSurface->pitch;
+
+	pDst = (Uint8 *)m_pSurface->pixels;
+	iDstLineSize = m_pSurface->pitch;
+
+	OGE_FX_BltWithEdge(pDst, iDstLineSize,
+                        rcDst.x, rcDst.y,
+                        pSrc, iSrcLineSize, pSrcImage->m_iColorKey,
+                        rcSrc.x, rcSrc.y,
+                        rcSrc.w, rcSrc.h, m_iBPP, iEdgeColor);
+
+    pSrcImage->EndUpdate();
+	this->EndUpdate();
+}
 
-    SDL_Rect rcDst = {0};
+void CogeImage::BltWithLightness( CogeImage* pSrcImage, int iAmount,
+                        int iDstLeft, int iDstTop,
+                        int iSrcLeft, int iSrcTop, int iSrcWidth, int iSrcHeight )
+{
+    if ( m_pVideo->m_iState < 0 ) return;
 
-	void* pDst = NULL;
+    PrepareRawData(true);
 
-	int iLineSize = 0;
+    SDL_Rect rcSrc = {0};
+	SDL_Rect rcDst = {0};
 
-	int iWidth = 0;
-	int iHeight = 0;
+	if (iSrcWidth == -1) iSrcWidth = pSrcImage->m_iWidth;
+	if (iSrcHeight == -1) iSrcHeight = pSrcImage->m_iHeight;
 
-	//if (!m_VideoEngine) return;
-	//if (!m_pSurface) return;
-	//if (!m_pDotFont) return;
+	bool bUseSpans = pSrcImage->m_pSpans != NULL && pSrcImage != this;
 
-	//if ( m_pVideo->m_iState < 0 ) return;
+	// the indexed pixels of the source are drawn through its palette
+	bool bUseIndexed = pSrcImage->m_pIndexed != NULL && pSrcImage != this;
 
-	if (iMaxWidth == 0)
-	{
-		iWidth = m_pDotFont->GetTextWidth(pText, iFontSpace) + iFontSpace;
-		iHeight = _OGE_DOT_FONT_SIZE_ + iLineSpace;
-	}
-	else
+	if(bUseSpans || bUseIndexed)
 	{
-		iWidth = iMaxWidth + iFontSpace;
-		iHeight = m_pDotFont->GetTextHeight(pText, iMaxWidth, iFontSpace, iLineSpace) + iLineSpace;
+	    if(!pSrcImage->ClipRect(iSrcLeft, iSrcTop, iSrcWidth, iSrcHeight, &rcSrc)) return;
 	}
+	else if(!pSrcImage->GetValidRect(iSrcLeft, iSrcTop, iSrcWidth, iSrcHeight, &rcSrc)) return;
 
-	rcDst.x = x;
-	rcDst.y = y;
-	rcDst.w = iWidth;
-	rcDst.h = iHeight;
+	uint8_t* pSrc;
+	uint8_t* pDst;
 
-	//if (SDL_LockSurface(m_pSurface) < 0) return;
+	int iSrcLineSize = 0;
+	int iDstLineSize = 0;
 
-	//try
-	//{
+	if(!GetValidRect(iDstLeft, iDstTop, &rcSrc, &rcDst)) return;
 
-	//if (m_pddSurface->Lock(&rcDst, &ddsd, DDLOCK_WAIT, NULL) != DD_OK) return;
+	if(bUseSpans)
+	{
+	    this->BeginUpdate();
 
-	BeginUpdate();
+	    pDst = (Uint8 *)m_pSurface->pixels;
+	    iDstLineSize = m_pSurface->pitch;
 
-	pDst = (Uint8 *)m_pSurface->pixels;
-	iLineSize = m_pSurface->pitch;
+	    OGE_FX_SpanBltLightness(pDst, iDstLineSize,
+                            rcDst.x, rcDst.y,
+                            pSrcImage->m_pSpans,
+                            rcSrc.x, rcSrc.y,
+                            rcSrc.w, rcSrc.h, iAmount);
 
-	if (iMaxWidth == 0)
-	{
-		m_pDotFont->OneLine(pText, (char*)pDst, iLineSize, m_iBPP, m_iPenColor, rcDst.x, rcDst.y, iWidth, iFontSpace);
+	    this->EndUpdate();
+	    return;
 	}
-	else
+
+	if(bUseIndexed)
 	{
-		m_pDotFont->Lines(pText, (char*)pDst, iLineSize, m_iBPP, m_iPenColor, rcDst.x, rcDst.y, iWidth, iHeight,
-		                  iFontSpace, iLineSpace);
+	    this->BeginUpdate();
+
+	    pDst = (Uint8 *)m_pSurface->pixels;
+	    iDstLineSize = m_pSurface->pitch;
+
+	    OGE_FX_IndexedBltLightness(pDst, iDstLineSize,
+                            rcDst.x, rcDst.y,
+                            pSrcImage->m_pIndexed, pSrcImage->m_pPalette,
+                            rcSrc.x, rcSrc.y,
+                            rcSrc.w, rcSrc.h, iAmount);
+
+	    this->EndUpdate();
+	    return;
 	}
 
-	//}
-	//catch ( ... )
-	//{
-	//    SDL_UnlockSurface( m_pSurface );
-    //}
+	pSrcImage->BeginUpdate();
+	this->BeginUpdate();
 
-	//m_pddSurface->Unlock(&rcDst);
+	pSrc = (Uint8 *)pSrcImage->m_pSurface->pixels;
+	iSrcLineSize =  pSrcImage->m_pSurface->pitch;
 
-	//SDL_UnlockSurface( m_pSurface );
+	pDst = (Uint8 *)m_pSurface->pixels;
+	iDstLineSize = m_pSurface->pitch;
 
-	EndUpdate();
+	OGE_FX_BltLightness(pDst, iDstLineSize,
+                        rcDst.x, rcDst.y,
+                        pSrc, iSrcLineSize, pSrcImage->m_iColorKey,
+                        rcSrc.x, rcSrc.y,
+                        rcSrc.w, rcSrc.h, m_iBPP, iAmount);
 
+    pSrcImage->EndUpdate();
+	this->EndUpdate();
 }
 
-void CogeImage::PrintBufferText(const char* pBufferText, int iBufferSize, int x, int y, const char* pCharsetName, CogeFont* pFont, int iAlpha)
+void CogeImage::BltColorTransform( CogeImage* pSrcImage, CogeFXColorTransform* pTransform,
+                        int iDstLeft, int iDstTop,
+                        int iSrcLeft, int iSrcTop, int iSrcWidth, int iSrcHeight )
 {
-    //if(m_pFontStock == NULL) return;
+    if ( m_pVideo->m_iState < 0 ) return;
 
-    if(pBufferText == NULL || iBufferSize <= 0) return;
+    PrepareRawData(true);
 
-    SDL_Surface* pTextImg = NULL;
+    if (pTransform == NULL) return;
 
-    if(pFont == NULL)
-    {
-        if(m_pDefaultFont) pFont = m_pDefaultFont;
-        else pFont = m_pVideo->GetDefaultFont();
-    }
+    SDL_Rect rcSrc = {0};
+	SDL_Rect rcDst = {0};
 
-    if(pFont)
-    {
-        pTextImg = pFont->PrintBufferText(pBufferText, iBufferSize, pCharsetName, m_iPenColorSDL);
-    }
+	if (iSrcWidth == -1) iSrcWidth = pSrcImage->m_iWidth;
+	if (iSrcHeight == -1) iSrcHeight = pSrcImage->m_iHeight;
 
-    if(pTextImg)
-    {
-        if(iAlpha >= 0)
-        OGE_SetAlpha(pTextImg, OGE_SRCALPHA, iAlpha);
+	if(!pSrcImage->GetValidRect(iSrcLeft, iSrcTop, iSrcWidth, iSrcHeight, &rcSrc)) return;
 
-        SDL_Rect rcSrc = {0};
-        SDL_Rect rcDst = {0};
+	uint8_t* pSrc;
+	uint8_t* pDst;
 
-        rcSrc.w = pTextImg->w;
-        rcSrc.h = pTextImg->h;
+	int iSrcLineSize = 0;
+	int iDstLineSize = 0;
 
-        if (GetValidRect(x, y, &rcSrc, &rcDst))
-        SDL_BlitSurface(pTextImg, &rcSrc, m_pSurface, &rcDst);
+	if(!GetValidRect(iDstLeft, iDstTop, &rcSrc, &rcDst)) return;
 
-        //SDL_FreeSurface( pTextImg );
+	pSrcImage->BeginUpdate();
+	this->BeginUpdate();
 
-    }
-    else
-    {
-        if(pCharsetName == NULL || strlen(pCharsetName) == 0) DotTextOut(pBufferText, x, y);
-        else
-        {
-            std::string sDefaultCharset = m_pVideo->GetDefaultCharset();
-            if(sDefaultCharset.length() == 0) DotTextOut(pBufferText, x, y);
-            else DotTextOut("Error", x, y);
-        }
+	pSrc = (Uint8 *)pSrcImage->m_pSurface->pixels;
+	iSrcLineSize =  pSrcImage->m_pSurface->pitch;
 
-        //printf("Text: %s (%d) (%s) \n", pBufferText, iBufferSize, pCharsetName);
-    }
+	pDst = (Uint8 *)m_pSurface->pixels;
+	iDstLineSize = m_pSurface->pitch;
+
+	OGE_FX_BltColorTransform(pDst, iDstLineSize,
+                        rcDst.x, rcDst.y,
+                        pSrc, iSrcLineSize, pSrcImage->m_iColorKey,
+                        rcSrc.x, rcSrc.y,
+                        rcSrc.w, rcSrc.h, m_iBPP, pTransform);
+
+    pSrcImage->EndUpdate();
+	this->EndUpdate();
 }
 
-void CogeImage::PrintBufferTextWrap(const char* pBufferText, int iBufferSize, int x, int y, const char* pCharsetName, CogeFont* pFont, int iAlpha)
+bool CogeImage::BltFused( CogeImage* pSrcImage, double fAngle, CogeFXColorTransform* pTransform, int iAlpha,
+                        int iDstLeft, int iDstTop, int iDstWidth, int iDstHeight,
+                        int iSrcLeft, int iSrcTop, int iSrcWidth, int iSrcHeight )
 {
-    if(pBufferText == NULL || iBufferSize <= 0) return;
+    if ( m_pVideo->m_iState < 0 ) return false;
 
-    SDL_Surface* pTextImg = NULL;
+    if (pSrcImage == this || pSrcImage->m_iBPP != m_iBPP) return false;
+    if (m_iBPP != 16 && m_iBPP != 32) return false;
 
-    int iFontSpace = 2;
-    int iLineSpace = 2;
-    bool bPrintOK = false;
+    // the images with alpha channel or clipboards have their own ways
+    if (pSrcImage->m_bHasAlphaChannel || pSrcImage->m_bHasLocalClipboard) return false;
 
-    if(pFont == NULL)
-    {
-        if(m_pDefaultFont) pFont = m_pDefaultFont;
-        else pFont = m_pVideo->GetDefaultFont();
-    }
+    SDL_Rect rcSrc = {0};
 
-    if(pFont)
-    {
-        bPrintOK = pFont->PrintBufferTextWrap(pBufferText, iBufferSize, pCharsetName, m_iWidth, m_iPenColorSDL);
-    }
+	if(!pSrcImage->GetValidRect(iSrcLeft, iSrcTop, iSrcWidth, iSrcHeight, &rcSrc)) return true;
+	if(!PrepareRawData(true)) return false;
 
-    if(bPrintOK)
-    {
-        std::vector<SDL_Surface*> txtimgs = pFont->GetTextImages();
+	if (iDstWidth <= 0 || iDstHeight <= 0 || iAlpha <= 0) return true;
 
-        for(size_t i = 0; i < txtimgs.size(); i++)
-        {
-            pTextImg = txtimgs[i];
-            if(pTextImg)
-            {
-                if(iAlpha >= 0)
-                OGE_SetAlpha(pTextImg, OGE_SRCALPHA, iAlpha);
+	pSrcImage->BeginUpdate();
+	this->BeginUpdate();
 
-                SDL_Rect rcSrc = {0};
-                SDL_Rect rcDst = {0};
+	bool bSmoothScale = m_pVideo && m_pVideo->m_bSmoothScaling && (iDstWidth != rcSrc.w || iDstHeight != rcSrc.h);
 
-                rcSrc.w = pTextImg->w;
-                rcSrc.h = pTextImg->h;
+	if (bSmoothScale && pTransform == NULL && iAlpha >= 255)
+	{
+	    OGE_FX_BltScale((Uint8 *)m_pSurface->pixels, m_pSurface->pitch,
+                        iDstLeft, iDstTop, iDstWidth, iDstHeight,
+                        -iDstLeft, -iDstTop, m_iWidth, m_iHeight,
+                        (Uint8 *)pSrcImage->m_pSurface->pixels, pSrcImage->m_pSurface->pitch, pSrcImage->m_iColorKey,
+                        rcSrc.x, rcSrc.y, rcSrc.w, rcSrc.h, m_iBPP);
+	}
+	else if (bSmoothScale)
+	{
+	    // the visible part is scaled first, then it goes through the colors and the alpha as it is
+	    SDL_Rect rcDst = {0};
 
-                if (GetValidRect(x, y, &rcSrc, &rcDst))
-                SDL_BlitSurface(pTextImg, &rcSrc, m_pSurface, &rcDst);
+	    if (ClipRect(iDstLeft, iDstTop, iDstWidth, iDstHeight, &rcDst))
+	    {
+	        int iPixelSize = m_iBPP >> 3;
+	        int iLineSize = rcDst.w * iPixelSize;
+
+	        uint8_t* pScaled = new uint8_t[iLineSize * rcDst.h];
+
+	        if (pSrcImage->m_iColorKey != -1)
+	        {
+	            for (int i=0; i<rcDst.w*rcDst.h; i++)
+	            {
+	                if (iPixelSize == 2) ((uint16_t*)pScaled)[i] = pSrcImage->m_iColorKey;
+	                else ((uint32_t*)pScaled)[i] = pSrcImage->m_iColorKey;
+	            }
+	        }
+
+	        OGE_FX_BltScale(pScaled, iLineSize,
+                            iDstLeft - rcDst.x, iDstTop - rcDst.y, iDstWidth, iDstHeight,
+                            rcDst.x - iDstLeft, rcDst.y - iDstTop, rcDst.w, rcDst.h,
+                            (Uint8 *)pSrcImage->m_pSurface->pixels, pSrcImage->m_pSurface->pitch, pSrcImage->m_iColorKey,
+                            rcSrc.x, rcSrc.y, rcSrc.w, rcSrc.h, m_iBPP);
+
+	        OGE_FX_BltFused((Uint8 *)m_pSurface->pixels, m_pSurface->pitch, m_iWidth, m_iHeight,
+                            rcDst.x, rcDst.y, rcDst.w, rcDst.h,
+                            pScaled, iLineSize, pSrcImage->m_iColorKey,
+                            0, 0, rcDst.w, rcDst.h, m_iBPP,
+                            0, false, pTransform, iAlpha);
+
+	        delete [] pScaled;
+	    }
+	}
+	else
+	{
+	    OGE_FX_BltFused((Uint8 *)m_pSurface->pixels, m_pSurface->pitch, m_iWidth, m_iHeight,
+                        iDstLeft, iDstTop, iDstWidth, iDstHeight,
+                        (Uint8 *)pSrcImage->m_pSurface->pixels, pSrcImage->m_pSurface->pitch, pSrcImage->m_iColorKey,
+                        rcSrc.x, rcSrc.y, rcSrc.w, rcSrc.h, m_iBPP,
+                        fAngle, m_pVideo && m_pVideo->m_bSmoothRotation, pTransform, iAlpha);
+	}
 
-                y = y + rcDst.h + iLineSpace;
-            }
-        }
-    }
-    else
-    {
-        if(pCharsetName == NULL || strlen(pCharsetName) == 0) DotTextOut(pBufferText, x, y, m_iWidth-iFontSpace, iFontSpace, iLineSpace);
-    }
+    pSrcImage->EndUpdate();
+	this->EndUpdate();
+
+	return true;
 }
 
-void CogeImage::PrintBufferTextAlign(const char* pBufferText, int iBufferSize, int iAlignX, int iAlignY, const char* pCharsetName, CogeFont* pFont, int iAlpha)
+void CogeImage::LightMaskBlend( CogeImage* pSrcImage, int iDstLeft, int iDstTop,
+                        int iSrcLeft, int iSrcTop, int iSrcWidth, int iSrcHeight )
 {
-    //iAlignX: -1=>Left, 0=>Center, 1=>Right;
-    //iAlignY: -1=>Top,  0=>Middle, 1=>Bottom;
-
-    if(pBufferText == NULL || iBufferSize <= 0) return;
-
-    SDL_Surface* pTextImg = NULL;
-
-    if(pFont == NULL)
-    {
-        if(m_pDefaultFont) pFont = m_pDefaultFont;
-        else pFont = m_pVideo->GetDefaultFont();
-    }
-
-    if(pFont)
-    {
-        pTextImg = pFont->PrintBufferText(pBufferText, iBufferSize, pCharsetName, m_iPenColorSDL);
-    }
-
-    if(pTextImg)
-    {
-        int x = 0; int y = 0;
+    if ( m_pVideo->m_iState < 0 ) return;
 
-        if(iAlignX > 0)  x = m_iWidth - pTextImg->w;
-        if(iAlignX == 0) x = (m_iWidth - pTextImg->w)/2;
+    PrepareRawData(true);
 
-        if(iAlignY > 0)  y = m_iHeight - pTextImg->h;
-        if(iAlignY == 0) y = (m_iHeight - pTextImg->h)/2;
+    SDL_Rect rcSrc = {0};
+	SDL_Rect rcDst = {0};
 
-        if(iAlpha >= 0)
-        OGE_SetAlpha(pTextImg, OGE_SRCALPHA, iAlpha);
+	if (iSrcWidth == -1) iSrcWidth = pSrcImage->m_iWidth;
+	if (iSrcHeight == -1) iSrcHeight = pSrcImage->m_iHeight;
 
-        SDL_Rect rcSrc = {0};
-        SDL_Rect rcDst = {0};
+	if(!pSrcImage->GetValidRect(iSrcLeft, iSrcTop, iSrcWidth, iSrcHeight, &rcSrc)) return;
 
-        rcSrc.w = pTextImg->w;
-        rcSrc.h = pTextImg->h;
+	uint8_t* pSrc;
+	uint8_t* pDst;
 
-        if (GetValidRect(x, y, &rcSrc, &rcDst))
-        SDL_BlitSurface(pTextImg, &rcSrc, m_pSurface, &rcDst);
+	int iSrcLineSize = 0;
+	int iDstLineSize = 0;
 
-        //SDL_FreeSurface( pTextImg );
+	if(!GetValidRect(iDstLeft, iDstTop, &rcSrc, &rcDst)) return;
 
-    }
-    else if(m_pDotFont && (pCharsetName == NULL || strlen(pCharsetName) == 0))
-    {
-        int x = 0; int y = 0;
+	pSrcImage->BeginUpdate();
+	this->BeginUpdate();
 
-        int iWidth  = m_pDotFont->GetTextWidth(pBufferText, 0) + 0;
-		int iHeight = _OGE_DOT_FONT_SIZE_ + 0;
+	pSrc = (Uint8 *)pSrcImage->m_pSurface->pixels;
+	iSrcLineSize =  pSrcImage->m_pSurface->pitch;
 
-        if(iAlignX > 0)  x = m_iWidth - iWidth;
-        if(iAlignX == 0) x = (m_iWidth - iWidth)/2;
+	pDst = (Uint8 *)m_pSurface->pixels;
+	iDstLineSize = m_pSurface->pitch;
 
-        if(iAlignY > 0)  y = m_iHeight - iHeight;
-        if(iAlignY == 0) y = (m_iHeight - iHeight)/2;
+	OGE_FX_LightMaskBlend(pDst, iDstLineSize,
+                        rcDst.x, rcDst.y,
+                        pSrc, iSrcLineSize,
+                        rcSrc.x, rcSrc.y,
+                        rcSrc.w, rcSrc.h, m_iBPP);
 
-        DotTextOut(pBufferText, x, y);
-    }
+    pSrcImage->EndUpdate();
+	this->EndUpdate();
 
 }
 
-bool CogeImage::GetBufferTextSize(const char* pBufferText, int iBufferSize, int* iWidth, int* iHeight, const char* pCharsetName, CogeFont* pFont)
+bool CogeImage::DownsampleLight( uint8_t* pLightData, int iLightLineSize, int iPhaseX, int iPhaseY, int iOutside )
 {
-    if(pBufferText == NULL || iBufferSize <= 0) return false;
-
-    if(pFont == NULL)
-    {
-        if(m_pDefaultFont) pFont = m_pDefaultFont;
-        else pFont = m_pVideo->GetDefaultFont();
-    }
+    if ( m_pVideo->m_iState < 0 ) return false;
 
-    if(pFont)
-    {
-        return pFont->GetBufferTextSize(pBufferText, iBufferSize, pCharsetName, iWidth, iHeight);
-    }
-    else if(pCharsetName == NULL)
-    {
-        *iWidth  = m_pDotFont->GetTextWidth(pBufferText, 0) + 0;
-		*iHeight = _OGE_DOT_FONT_SIZE_ + 0;
+    if (m_iBPP != 16 && m_iBPP != 32) return false;
 
-		return true;
-    }
-    else return false;
-}
+    this->BeginUpdate();
 
+    OGE_FX_DownsampleLight(pLightData, iLightLineSize,
+                        (Uint8 *)m_pSurface->pixels, m_pSurface->pitch,
+                        0, 0, m_iWidth, m_iHeight, m_iBPP,
+                        iPhaseX, iPhaseY, iOutside);
 
-void CogeImage::PrintText(const std::string& sText, int x, int y, CogeFont* pFont, int iAlpha)
-{
-    const char* pBufferText = sText.c_str();
-    int iBufferSize = sText.length() + 1; // included end char '\0' ...
+    this->EndUpdate();
 
-    std::string sDefaultCharset = m_pVideo->GetDefaultCharset();
-    if(sDefaultCharset.length() > 0)
-        PrintBufferText(pBufferText, iBufferSize, x, y, sDefaultCharset.c_str(), pFont, iAlpha);
-    else
-        PrintBufferText(pBufferText, iBufferSize, x, y, _OGE_FONT_DF_CHARSET_, pFont, iAlpha);
+    return true;
 }
 
-void CogeImage::PrintTextWrap(const std::string& sText, int x, int y, CogeFont* pFont, int iAlpha)
+void CogeImage::LightBlend( uint8_t* pLightData, int iLightLineSize, int iLightCols, int iLightRows, int iLightX, int iLightY,
+                     int iDstLeft, int iDstTop, int iWidth, int iHeight )
 {
-    const char* pBufferText = sText.c_str();
-    int iBufferSize = sText.length() + 1; // included end char '\0' ...
-
-    std::string sDefaultCharset = m_pVideo->GetDefaultCharset();
-    if(sDefaultCharset.length() > 0)
-        PrintBufferTextWrap(pBufferText, iBufferSize, x, y, sDefaultCharset.c_str(), pFont, iAlpha);
-    else
-        PrintBufferTextWrap(pBufferText, iBufferSize, x, y, _OGE_FONT_DF_CHARSET_, pFont, iAlpha);
-}
+    if ( m_pVideo->m_iState < 0 ) return;
 
-void CogeImage::PrintTextAlign(const std::string& sText, int iAlignX, int iAlignY, CogeFont* pFont, int iAlpha)
-{
-    const char* pBufferText = sText.c_str();
-    int iBufferSize = sText.length() + 1; // included end char '\0' ...
+    PrepareRawData(true);
 
-    std::string sDefaultCharset = m_pVideo->GetDefaultCharset();
-    if(sDefaultCharset.length() > 0)
-        PrintBufferTextAlign(pBufferText, iBufferSize, iAlignX, iAlignY, sDefaultCharset.c_str(), pFont, iAlpha);
-    else
-        PrintBufferTextAlign(pBufferText, iBufferSize, iAlignX, iAlignY, _OGE_FONT_DF_CHARSET_, pFont, iAlpha);
-}
+    SDL_Rect rcDst = {0};
 
-bool CogeImage::GetTextSize(const std::string& sText, int* iWidth, int* iHeight, CogeFont* pFont)
-{
-    const char* pBufferText = sText.c_str();
-    int iBufferSize = sText.length() + 1; // included end char '\0' ...
+    if(!GetValidRect(iDstLeft, iDstTop, iWidth, iHeight, &rcDst)) return;
 
-    if(pFont == NULL)
-    {
-        if(m_pDefaultFont) pFont = m_pDefaultFont;
-        else pFont = m_pVideo->GetDefaultFont();
-    }
+    this->BeginUpdate();
 
-    std::string sDefaultCharset = m_pVideo->GetDefaultCharset();
-    if(sDefaultCharset.length() > 0)
-    {
-        return GetBufferTextSize(pBufferText, iBufferSize, iWidth, iHeight, sDefaultCharset.c_str(), pFont);
-    }
-    else
-    {
-        if(pFont)
-            return GetBufferTextSize(pBufferText, iBufferSize, iWidth, iHeight, _OGE_FONT_DF_CHARSET_, pFont);
-        else
-            return GetBufferTextSize(pBufferText, iBufferSize, iWidth, iHeight, NULL, NULL);
-    }
+    OGE_FX_LightBlend((Uint8 *)m_pSurface->pixels, m_pSurface->pitch,
+                        rcDst.x, rcDst.y, rcDst.w, rcDst.h, m_iBPP,
+                        pLightData, iLightLineSize, iLightCols, iLightRows,
+                        iLightX + rcDst.x - iDstLeft, iLightY + rcDst.y - iDstTop);
 
+    this->EndUpdate();
 }
 
-void CogeImage::Draw(CogeImage* pSrcImage,
-                      int iDstLeft, int iDstTop,
-                      int iSrcLeft, int iSrcTop, int iSrcWidth, int iSrcHeight)
+void CogeImage::BltMask( CogeImage* pSrcImage, CogeImage* pMaskImage, int iDstLeft, int iDstTop,
+                  int iSrcLeft, int iSrcTop, int iMaskLeft, int iMaskTop,
+                  int iSrcWidth, int iSrcHeight )
 {
-    if(pSrcImage==NULL) return;
+    if ( m_pVideo->m_iState < 0 ) return;
 
-	SDL_Rect rcSrc = {0};
+    PrepareRawData(true);
+
+    SDL_Rect rcSrc = {0};
 	SDL_Rect rcDst = {0};
 
 	if (iSrcWidth == -1) iSrcWidth = pSrcImage->m_iWidth;
@@ -3668,78 +6165,90 @@ void CogeImage::Draw(CogeImage* pSrcImage,
 
 	if(!pSrcImage->GetValidRect(iSrcLeft, iSrcTop, iSrcWidth, iSrcHeight, &rcSrc)) return;
 
-	if(pSrcImage->m_iAlpha >= 0)
-	{
-	    OGE_SetAlpha(pSrcImage->m_pSurface, 0, 0);
-	    pSrcImage->m_iAlpha = -1;
-    }
+	if(iMaskLeft + rcSrc.w > pMaskImage->m_iWidth ||
+	   iMaskTop + rcSrc.h > pMaskImage->m_iHeight) return;
 
-    if (!GetValidRect(iDstLeft, iDstTop, &rcSrc, &rcDst)) return;
+	uint8_t* pSrc;
+	uint8_t* pDst;
+	uint8_t* pMask;
 
+	int iSrcLineSize = 0;
+	int iDstLineSize = 0;
+	int iMaskLineSize = 0;
 
-/*
-    if(pSrcImage->m_bHasAlphaChannel)
-    {
-#if (defined __OGE_WITH_SDL2__)
-        //bool bNeedLockSrc = SDL_MUSTLOCK(pSrcImage->m_pSurface) != 0;
-        //bool bNeedLockDst = SDL_MUSTLOCK(m_pSurface) != 0;
-        // just force the images to be locked ...
-        bool bNeedLockSrc = true;
-        bool bNeedLockDst = true;
-#else
-        bool bNeedLockSrc = false;
-        bool bNeedLockDst = false;
-#endif
+	if(!GetValidRect(iDstLeft, iDstTop, &rcSrc, &rcDst)) return;
 
-        if (bNeedLockSrc) bNeedLockSrc = SDL_LockSurface(pSrcImage->m_pSurface) == 0;
-        if (bNeedLockDst) bNeedLockDst = SDL_LockSurface(m_pSurface) == 0;
+	pSrcImage->BeginUpdate();
+	pMaskImage->BeginUpdate();
+	this->BeginUpdate();
 
-        SDL_BlitSurface(pSrcImage->m_pSurface, &rcSrc, m_pSurface, &rcDst);
+	pSrc = (Uint8 *)pSrcImage->m_pSurface->pixels;
+	iSrcLineSize =  pSrcImage->m_pSurface->pitch;
 
-        if (bNeedLockSrc) SDL_UnlockSurface(pSrcImage->m_pSurface);
-        if (bNeedLockDst) SDL_UnlockSurface(m_pSurface);
-    }
-    else
-    {
-        SDL_BlitSurface(pSrcImage->m_pSurface, &rcSrc, m_pSurface, &rcDst);
-    }
-*/
+	pDst = (Uint8 *)m_pSurface->pixels;
+	iDstLineSize = m_pSurface->pitch;
 
-    SDL_BlitSurface(pSrcImage->m_pSurface, &rcSrc, m_pSurface, &rcDst);
+	pMask = (Uint8 *)pMaskImage->m_pSurface->pixels;
+	iMaskLineSize =  pMaskImage->m_pSurface->pitch;
+
+	OGE_FX_BltMask(pDst, iDstLineSize,
+                        rcDst.x, rcDst.y,
+                        pSrc, iSrcLineSize,
+                        rcSrc.x, rcSrc.y,
+                        pMask, iMaskLineSize,
+                        iMaskLeft, iMaskTop,
+                        rcSrc.w, rcSrc.h, m_iBPP);
 
+    pSrcImage->EndUpdate();
+    pMaskImage->EndUpdate();
+	this->EndUpdate();
 }
 
-void CogeImage::BltAlphaBlend( CogeImage* pSrcImage, int iAlpha,
-                        int iDstLeft, int iDstTop,
-                        int iSrcLeft, int iSrcTop, int iSrcWidth, int iSrcHeight )
+void CogeImage::BltStretchFast(CogeImage* pSrcImage, int iSrcLeft, int iSrcTop, int iSrcRight, int iSrcBottom,
+                    int iDstLeft, int iDstTop, int iDstRight, int iDstBottom)
 {
-    if(iAlpha <= 0) return;
+    SDL_Rect rcSrc = {0};
+	SDL_Rect rcDst = {0};
 
-    bool bAutoAlpha = false;
+	if(!pSrcImage->GetValidRect(iSrcLeft, iSrcTop, iSrcRight-iSrcLeft, iSrcBottom-iSrcTop, &rcSrc)) return;
+	PrepareRawData(true);
 
-    if(iAlpha < 255)
-	{
-	    if(pSrcImage->m_bHasAlphaChannel && pSrcImage->m_bHasLocalClipboard)
-	    {
-	        SDL_Rect rcSrc = {0};
-            SDL_Rect rcDst = {0};
+	if(!GetValidRect(iDstLeft, iDstTop, iDstRight-iDstLeft, iDstBottom-iDstTop, &rcDst)) return;
 
-            if (iSrcWidth == -1) iSrcWidth = pSrcImage->m_iWidth;
-            if (iSrcHeight == -1) iSrcHeight = pSrcImage->m_iHeight;
+	SDL_SoftStretch(pSrcImage->m_pSurface, &rcSrc, m_pSurface, &rcDst);
+}
 
-            if(!pSrcImage->GetValidRect(iSrcLeft, iSrcTop, iSrcWidth, iSrcHeight, &rcSrc)) return;
-            if (!GetValidRect(iDstLeft, iDstTop, &rcSrc, &rcDst)) return;
+void CogeImage::BltStretch(CogeImage* pSrcImage, int iSrcLeft, int iSrcTop, int iSrcRight, int iSrcBottom,
+                    int iDstLeft, int iDstTop, int iDstRight, int iDstBottom)
+{
+    SDL_Rect rcSrc = {0};
+	SDL_Rect rcDst = {0};
 
-            SDL_Surface* pSurface = pSrcImage->GetCurrentClipboard();
-            if(pSurface == NULL) pSurface = pSrcImage->GetSurface();
+	if(!pSrcImage->GetValidRect(iSrcLeft, iSrcTop, iSrcRight-iSrcLeft, iSrcBottom-iSrcTop, &rcSrc)) return;
+	PrepareRawData(true);
 
-            SDL_Surface* pBackup = pSrcImage->GetFreeClipboard();
+	if(!GetValidRect(iDstLeft, iDstTop, iDstRight-iDstLeft, iDstBottom-iDstTop, &rcDst)) return;
 
-            if (!pBackup)
-            {
-                SDL_BlitSurface(pSurface, &rcSrc, m_pSurface, &rcDst);
-                return;
-            }
+	//SDL_SoftStretch(pSrcImage->m_pSurface, &rcSrc, m_pSurface, &rcDst);
+
+	uint8_t* pSrc;
+	uint8_t* pDst;
+
+	int iSrcLineSize = 0;
+	int iDstLineSize = 0;
+
+	if(pSrcImage->m_bHasAlphaChannel && pSrcImage->m_bHasLocalClipboard)
+    {
+        //SDL_Surface* pSurface = pSrcImage->GetSurface();
+        //SDL_Surface* pBackup = pSrcImage->GetBackupSurface();
+
+        SDL_Surface* pSurface = pSrcImage->GetCurrentClipboard();
+        if(pSurface == NULL) pSurface = pSrcImage->GetSurface();
+
+        SDL_Surface* pBackup = pSrcImage->GetFreeClipboard();
+
+        if (pSurface && pBackup)
+        {
 
 #if (defined __OGE_WITH_SDL2__) && (defined __IMG_WITH_LOCK__)
 //#if (defined __OGE_WITH_SDL2__)
@@ -3753,30 +6262,29 @@ void CogeImage::BltAlphaBlend( CogeImage* pSrcImage, int iAlpha,
             bool bNeedLockDst = false;
 #endif
 
+            bool bStretched = false;
+
             if (bNeedLockSrc) bNeedLockSrc = SDL_LockSurface(pSurface) == 0;
             if (bNeedLockDst) bNeedLockDst = SDL_LockSurface(pBackup) == 0;
 
-            uint8_t* pSrc = (Uint8 *)pSurface->pixels;
-            uint8_t* pDst = (Uint8 *)pBackup->pixels;
-
-            int iSrcLineSize = pSurface->pitch;
-            int iDstLineSize = pBackup->pitch;
-
-            //OGE_FX_UpdateAlphaBlt(pDst, iDstLineSize, 0, 0,
-            //                      pSrc, iSrcLineSize, 0, 0,
-            //                      iSrcWidth, iSrcHeight,
-            //                      pSurface->format->BitsPerPixel,
-            //                      pSurface->format->Amask,
-            //                      iAlpha - 255);
+            pSrc = (Uint8 *)pSurface->pixels;
+            pDst = (Uint8 *)pBackup->pixels;
 
-            //OGE_Log("\n BPP: %d, AMask: %d \n", pSurface->format->BitsPerPixel, pSurface->format->Amask);
+            iSrcLineSize = pSurface->pitch;
+            iDstLineSize = pBackup->pitch;
 
-            OGE_FX_UpdateAlphaBlt(pDst, iDstLineSize, 0, 0,
-                                  pSrc, iSrcLineSize, 0, 0,
-                                  iSrcWidth, iSrcHeight,
-                                  pSurface->format->BitsPerPixel,
-                                  pSurface->format->Amask,
-                                  iAlpha);
+            if(rcDst.w <= pSrcImage->m_iWidth && rcDst.h <= pSrcImage->m_iHeight)
+            {
+                bStretched = true;
+                OGE_FX_BltStretch(pDst, iDstLineSize,
+                        0, 0, rcDst.w, rcDst.h,
+                        pSrc, iSrcLineSize, -1,
+                        rcSrc.x, rcSrc.y, rcSrc.w, rcSrc.h, pSurface->format->BitsPerPixel);
+            }
+            else
+            {
+                SDL_BlitSurface(pSurface, &rcSrc, pBackup, &rcSrc);
+            }
 
             if (bNeedLockSrc) SDL_UnlockSurface(pSurface);
             if (bNeedLockDst) SDL_UnlockSurface(pBackup);
@@ -3788,144 +6296,156 @@ void CogeImage::BltAlphaBlend( CogeImage* pSrcImage, int iAlpha,
             if(pSrcImage->m_iEffectCount == 0)
             {
                 pSrcImage->SetCurrentClipboard(NULL);
+                if(bStretched)
+                {
+                    rcSrc.x = 0; rcSrc.y = 0;
+                    rcSrc.w = rcDst.w; rcSrc.h = rcDst.h;
+                }
                 SDL_BlitSurface(pBackup, &rcSrc, m_pSurface, &rcDst);
             }
             else pSrcImage->SetCurrentClipboard(pBackup);
 
             return ;
 
-	    }
-	    else
-	    {
+        }
 
-//#if (!defined __ANDROID__)
+    }
 
-	        if(pSrcImage->m_iAlpha != iAlpha)
-            {
-                OGE_SetAlpha(pSrcImage->m_pSurface, OGE_SRCALPHA, iAlpha);
-                pSrcImage->m_iAlpha = iAlpha;
-            }
+	pSrcImage->BeginUpdate();
+	this->BeginUpdate();
 
-            bAutoAlpha = true;
+	pSrc = (Uint8 *)pSrcImage->m_pSurface->pixels;
+	iSrcLineSize =  pSrcImage->m_pSurface->pitch;
 
-//#endif
+	pDst = (Uint8 *)m_pSurface->pixels;
+	iDstLineSize = m_pSurface->pitch;
 
-	    }
-    }
-    else
-    {
-        Draw(pSrcImage, iDstLeft, iDstTop, iSrcLeft, iSrcTop, iSrcWidth, iSrcHeight);
-        return;
-    }
+	OGE_FX_BltStretch(pDst, iDstLineSize,
+                        rcDst.x, rcDst.y, rcDst.w, rcDst.h,
+                        pSrc, iSrcLineSize, pSrcImage->m_iColorKey,
+                        rcSrc.x, rcSrc.y, rcSrc.w, rcSrc.h, m_iBPP);
+
+    pSrcImage->EndUpdate();
+	this->EndUpdate();
+}
 
+void CogeImage::BltStretchSmoothly(CogeImage* pSrcImage, int iSrcLeft, int iSrcTop, int iSrcRight, int iSrcBottom,
+                    int iDstLeft, int iDstTop, int iDstRight, int iDstBottom)
+{
     SDL_Rect rcSrc = {0};
 	SDL_Rect rcDst = {0};
 
-	if (iSrcWidth == -1) iSrcWidth = pSrcImage->m_iWidth;
-	if (iSrcHeight == -1) iSrcHeight = pSrcImage->m_iHeight;
+	if(!pSrcImage->GetValidRect(iSrcLeft, iSrcTop, iSrcRight-iSrcLeft, iSrcBottom-iSrcTop, &rcSrc)) return;
+	PrepareRawData(true);
 
-	//rcSrc.x = iSrcLeft;
-	//rcSrc.y = iSrcTop;
-	//rcSrc.w = iSrcWidth;
-	//rcSrc.h = iSrcHeight;
+	if(!GetValidRect(iDstLeft, iDstTop, iDstRight-iDstLeft, iDstBottom-iDstTop, &rcDst)) return;
 
-	if(!pSrcImage->GetValidRect(iSrcLeft, iSrcTop, iSrcWidth, iSrcHeight, &rcSrc)) return;
-    if (!GetValidRect(iDstLeft, iDstTop, &rcSrc, &rcDst)) return;
+	uint8_t* pSrc;
+	uint8_t* pDst;
 
+	int iSrcLineSize = 0;
+	int iDstLineSize = 0;
 
-    if(bAutoAlpha)
-    {
-        SDL_BlitSurface(pSrcImage->m_pSurface, &rcSrc, m_pSurface, &rcDst);
-    }
-    else
-    {
-        uint8_t* pSrc = (Uint8 *)pSrcImage->m_pSurface->pixels;
-        uint8_t* pDst = (Uint8 *)m_pSurface->pixels;
+	pSrcImage->BeginUpdate();
+	this->BeginUpdate();
 
-        int iSrcLineSize = pSrcImage->m_pSurface->pitch;
-        int iDstLineSize = m_pSurface->pitch;
+	pSrc = (Uint8 *)pSrcImage->m_pSurface->pixels;
+	iSrcLineSize =  pSrcImage->m_pSurface->pitch;
 
-        OGE_FX_AlphaBlend(pDst, iDstLineSize,
-                            rcDst.x, rcDst.y,
-                            pSrc, iSrcLineSize, pSrcImage->m_iColorKey,
-                            rcSrc.x, rcSrc.y,
-                            rcSrc.w, rcSrc.h, m_iBPP, iAlpha);
-    }
+	pDst = (Uint8 *)m_pSurface->pixels;
+	iDstLineSize = m_pSurface->pitch;
 
+	// the whole dst rect keeps the scale, only the part of it in the image is drawn
+	OGE_FX_BltScale(pDst, iDstLineSize,
+                        iDstLeft, iDstTop, iDstRight-iDstLeft, iDstBottom-iDstTop,
+                        rcDst.x-iDstLeft, rcDst.y-iDstTop, rcDst.w, rcDst.h,
+                        pSrc, iSrcLineSize, pSrcImage->m_iColorKey,
+                        rcSrc.x, rcSrc.y, rcSrc.w, rcSrc.h, m_iBPP);
+
+    pSrcImage->EndUpdate();
+	this->EndUpdate();
 }
 
-void CogeImage::DrawLine(int iStartX, int iStartY, int iEndX, int iEndY)
+void CogeImage::BltRotate(CogeImage* pSrcImage, double fAngle,
+                    int iDstLeft, int iDstTop,
+                    int iSrcLeft, int iSrcTop, int iSrcWidth, int iSrcHeight )
 {
-	uint8_t* pDst;
-	int iLineSize = 0;
-
-	BeginUpdate();
-
-	pDst = (Uint8 *)m_pSurface->pixels;
-	iLineSize = m_pSurface->pitch;
+    SDL_Rect rcSrc = {0};
+	SDL_Rect rcDst = {0};
 
-	OGE_FX_Line(pDst, iLineSize, m_iBPP, m_iPenColor, m_iWidth-1, m_iHeight-1, iStartX, iStartY, iEndX, iEndY);
+	if (iSrcWidth == -1) iSrcWidth = pSrcImage->m_iWidth;
+	if (iSrcHeight == -1) iSrcHeight = pSrcImage->m_iHeight;
 
-	EndUpdate();
-}
-void CogeImage::DrawCircle(int iCenterX, int iCenterY, int iRadius)
-{
-    uint8_t* pDst;
+	if(!pSrcImage->GetValidRect(iSrcLeft, iSrcTop, iSrcWidth, iSrcHeight, &rcSrc)) return;
+	PrepareRawData(true);
 
-	int iLineSize = 0;
+	if(!GetValidRect(iDstLeft, iDstTop, iSrcWidth, iSrcHeight, &rcDst)) return;
 
-	//if (SDL_LockSurface(m_pSurface) < 0) return;
+	uint8_t* pSrc;
+	uint8_t* pDst;
 
-	//try
-	//{
+	int iSrcLineSize = 0;
+	int iDstLineSize = 0;
 
-	//if (m_pddSurface->Lock(&rcDst, &ddsd, DDLOCK_WAIT, NULL) != DD_OK) return;
+	if(pSrcImage->m_bHasAlphaChannel && pSrcImage->m_bHasLocalClipboard)
+    {
+        //SDL_Surface* pSurface = pSrcImage->GetSurface();
+        //SDL_Surface* pBackup = pSrcImage->GetBackupSurface();
 
-	BeginUpdate();
+        SDL_Surface* pSurface = pSrcImage->GetCurrentClipboard();
+        if(pSurface == NULL) pSurface = pSrcImage->GetSurface();
 
-	pDst = (Uint8 *)m_pSurface->pixels;
-	iLineSize = m_pSurface->pitch;
+        SDL_Surface* pBackup = pSrcImage->GetFreeClipboard();
 
-	OGE_FX_Circle(pDst, iLineSize, m_iBPP, m_iPenColor, m_iWidth-1, m_iHeight-1, iCenterX, iCenterY, iRadius);
+        if (pSurface && pBackup)
+        {
 
-	//OGE_FX_LightnessRGB(pDst, iLineSize, rcDst.x, rcDst.y, rcDst.w, rcDst.h, m_iBPP, -iAmount, 0, 0 );
+#if (defined __OGE_WITH_SDL2__) && (defined __IMG_WITH_LOCK__)
+//#if (defined __OGE_WITH_SDL2__)
+            bool bNeedLockSrc = SDL_MUSTLOCK(pSurface) != 0;
+            bool bNeedLockDst = SDL_MUSTLOCK(pBackup) != 0;
+            // just force the images to be locked ...
+            //bool bNeedLockSrc = true;
+            //bool bNeedLockDst = true;
+#else
+            bool bNeedLockSrc = false;
+            bool bNeedLockDst = false;
+#endif
 
-	//}
-	//catch ( ... )
-	//{
-	//    SDL_UnlockSurface( m_pSurface );
-    //}
+            if (bNeedLockSrc) bNeedLockSrc = SDL_LockSurface(pSurface) == 0;
+            if (bNeedLockDst) bNeedLockDst = SDL_LockSurface(pBackup) == 0;
 
-	//m_pddSurface->Unlock(&rcDst);
+            pSrc = (Uint8 *)pSurface->pixels;
+            pDst = (Uint8 *)pBackup->pixels;
 
-	//SDL_UnlockSurface( m_pSurface );
+            iSrcLineSize = pSurface->pitch;
+            iDstLineSize = pBackup->pitch;
 
-	EndUpdate();
-}
+            OGE_FX_BltRotate(pDst, iDstLineSize, 0, 0, pSrcImage->m_iWidth, pSrcImage->m_iHeight,
+                  pSrc, iSrcLineSize, 0, 0, pSrcImage->m_iWidth, pSrcImage->m_iHeight,
+                  pSurface->format->BitsPerPixel, -1, fAngle, 65536, m_pVideo && m_pVideo->m_bSmoothRotation);
 
-void CogeImage::CopyRect(CogeImage* pSrcImage,
-                  int iDstLeft, int iDstTop,
-                  int iSrcLeft, int iSrcTop, int iSrcWidth, int iSrcHeight )
-{
-    if ( m_pVideo->m_iState < 0 ) return;
+            if (bNeedLockSrc) SDL_UnlockSurface(pSurface);
+            if (bNeedLockDst) SDL_UnlockSurface(pBackup);
 
-    SDL_Rect rcSrc = {0};
-	SDL_Rect rcDst = {0};
+            pSrcImage->m_iEffectCount = pSrcImage->m_iEffectCount - 1;
 
-	if (iSrcWidth == -1) iSrcWidth = pSrcImage->m_iWidth;
-	if (iSrcHeight == -1) iSrcHeight = pSrcImage->m_iHeight;
+            if(pSrcImage->m_iEffectCount < 0) pSrcImage->m_iEffectCount = 0;
 
-	if(!pSrcImage->GetValidRect(iSrcLeft, iSrcTop, iSrcWidth, iSrcHeight, &rcSrc)) return;
+            if(pSrcImage->m_iEffectCount == 0)
+            {
+                pSrcImage->SetCurrentClipboard(NULL);
+                SDL_BlitSurface(pBackup, &rcSrc, m_pSurface, &rcDst);
+            }
+            else pSrcImage->SetCurrentClipboard(pBackup);
 
-	uint8_t* pSrc;
-	uint8_t* pDst;
+            return ;
 
-	int iSrcLineSize = 0;
-	int iDstLineSize = 0;
+        }
 
-	if(!GetValidRect(iDstLeft, iDstTop, &rcSrc, &rcDst)) return;
+    }
 
-	pSrcImage->BeginUpdate();
+    pSrcImage->BeginUpdate();
 	this->BeginUpdate();
 
 	pSrc = (Uint8 *)pSrcImage->m_pSurface->pixels;
@@ -3934,31 +6454,33 @@ void CogeImage::CopyRect(CogeImage* pSrcImage,
 	pDst = (Uint8 *)m_pSurface->pixels;
 	iDstLineSize = m_pSurface->pitch;
 
-	OGE_FX_CopyRect(pDst, iDstLineSize,
-                        rcDst.x, rcDst.y,
-                        pSrc, iSrcLineSize,
-                        rcSrc.x, rcSrc.y,
-                        rcSrc.w, rcSrc.h, m_iBPP);
+	OGE_FX_BltRotate(pDst, iDstLineSize, rcDst.x, rcDst.y, rcDst.w, rcDst.h,
+                  pSrc, iSrcLineSize, rcSrc.x, rcSrc.y, rcSrc.w, rcSrc.h,
+                  m_iBPP, pSrcImage->m_iColorKey, fAngle, 65536, m_pVideo && m_pVideo->m_bSmoothRotation);
 
     pSrcImage->EndUpdate();
 	this->EndUpdate();
-
 }
 
-
-void CogeImage::Blt( CogeImage* pSrcImage,
-              int iDstLeft, int iDstTop, int iSrcColorKey,
-              int iSrcLeft, int iSrcTop, int iSrcWidth, int iSrcHeight )
+void CogeImage::BltRotozoom(CogeImage* pSrcImage, double fAngle, int iZoom,
+                    int iDstLeft, int iDstTop,
+                    int iSrcLeft, int iSrcTop, int iSrcWidth, int iSrcHeight )
 {
-    if ( m_pVideo->m_iState < 0 ) return;
-
     SDL_Rect rcSrc = {0};
 	SDL_Rect rcDst = {0};
 
 	if (iSrcWidth == -1) iSrcWidth = pSrcImage->m_iWidth;
 	if (iSrcHeight == -1) iSrcHeight = pSrcImage->m_iHeight;
 
+	//rcSrc.x = iSrcLeft;
+	//rcSrc.y = iSrcTop;
+	//rcSrc.w = iSrcWidth;
+	//rcSrc.h = iSrcHeight;
+
 	if(!pSrcImage->GetValidRect(iSrcLeft, iSrcTop, iSrcWidth, iSrcHeight, &rcSrc)) return;
+	PrepareRawData(true);
+
+	if(!GetValidRect(iDstLeft, iDstTop, iSrcWidth, iSrcHeight, &rcDst)) return;
 
 	uint8_t* pSrc;
 	uint8_t* pDst;
@@ -3966,7 +6488,21 @@ void CogeImage::Blt( CogeImage* pSrcImage,
 	int iSrcLineSize = 0;
 	int iDstLineSize = 0;
 
-	if(!GetValidRect(iDstLeft, iDstTop, &rcSrc, &rcDst)) return;
+	//if(!GetValidRect(iDstLeft, iDstTop, rcSrc, rcDst)) return;
+
+	//int iColorKey = pSrcImage->m_iColorKeyRGB
+
+	//if (SDL_LockSurface(m_pSurface) < 0) return;
+	//if (SDL_LockSurface(pSrcImage->m_pSurface) < 0)
+	//{
+	//    SDL_UnlockSurface( m_pSurface );
+    //    return;
+	//}
+
+	//try
+	//{
+
+	//if (m_pddSurface->Lock(&rcDst, &ddsd, DDLOCK_WAIT, NULL) != DD_OK) return;
 
 	pSrcImage->BeginUpdate();
 	this->BeginUpdate();
@@ -3977,32 +6513,32 @@ void CogeImage::Blt( CogeImage* pSrcImage,
 	pDst = (Uint8 *)m_pSurface->pixels;
 	iDstLineSize = m_pSurface->pitch;
 
-	OGE_FX_Blt(pDst, iDstLineSize,
-                        rcDst.x, rcDst.y,
-                        pSrc, iSrcLineSize, iSrcColorKey,
-                        rcSrc.x, rcSrc.y,
-                        rcSrc.w, rcSrc.h, m_iBPP);
+	OGE_FX_BltRotate(pDst, iDstLineSize, rcDst.x, rcDst.y, rcDst.w, rcDst.h,
+                  pSrc, iSrcLineSize, rcSrc.x, rcSrc.y, rcSrc.w, rcSrc.h,
+                  m_iBPP, pSrcImage->m_iColorKey, fAngle, iZoom, m_pVideo && m_pVideo->m_bSmoothRotation);
 
-    pSrcImage->EndUpdate();
-	this->EndUpdate();
-}
 
-void CogeImage::BltChangedRGB( CogeImage* pSrcImage, int iAmount,
-                        int iDstLeft, int iDstTop,
-                        int iSrcLeft, int iSrcTop, int iSrcWidth, int iSrcHeight )
-{
+	//}
+	//catch ( ... )
+	//{
+	//    SDL_UnlockSurface( pSrcImage->m_pSurface );
+	//    SDL_UnlockSurface( m_pSurface );
+    //}
 
-	if ( m_pVideo->m_iState < 0 ) return;
+	//m_pddSurface->Unlock(&rcDst);
 
-	int iBlueAmount  = iAmount & 0x000000ff;
-	int iGreenAmount = (iAmount & 0x0000ff00) >> 8;
-	int iRedAmount   = (iAmount & 0x00ff0000) >> 16;
-	int iAlphaAmount = (iAmount & 0xff000000) >> 24;
+    //SDL_UnlockSurface( pSrcImage->m_pSurface );
+	//SDL_UnlockSurface( m_pSurface );
 
-	if((iAlphaAmount & 1) > 0) iBlueAmount = 0 - iBlueAmount;
-	if((iAlphaAmount & 2) > 0) iGreenAmount = 0 - iGreenAmount;
-	if((iAlphaAmount & 4) > 0) iRedAmount = 0 - iRedAmount;
+	pSrcImage->EndUpdate();
+	this->EndUpdate();
+}
 
+void CogeImage::BltWave(CogeImage* pSrcImage, double iXAmount, double iYAmount, double iZAmount,
+                int iXSteps, int iYSteps,
+                int iDstLeft, int iDstTop,
+                int iSrcLeft, int iSrcTop, int iSrcWidth, int iSrcHeight)
+{
     SDL_Rect rcSrc = {0};
 	SDL_Rect rcDst = {0};
 
@@ -4010,6 +6546,9 @@ void CogeImage::BltChangedRGB( CogeImage* pSrcImage, int iAmount,
 	if (iSrcHeight == -1) iSrcHeight = pSrcImage->m_iHeight;
 
 	if(!pSrcImage->GetValidRect(iSrcLeft, iSrcTop, iSrcWidth, iSrcHeight, &rcSrc)) return;
+	PrepareRawData(true);
+
+	if(!GetValidRect(iDstLeft, iDstTop, iSrcWidth, iSrcHeight, &rcDst)) return;
 
 	uint8_t* pSrc;
 	uint8_t* pDst;
@@ -4017,8 +6556,6 @@ void CogeImage::BltChangedRGB( CogeImage* pSrcImage, int iAmount,
 	int iSrcLineSize = 0;
 	int iDstLineSize = 0;
 
-	if(!GetValidRect(iDstLeft, iDstTop, &rcSrc, &rcDst)) return;
-
 	pSrcImage->BeginUpdate();
 	this->BeginUpdate();
 
@@ -4028,982 +6565,1173 @@ void CogeImage::BltChangedRGB( CogeImage* pSrcImage, int iAmount,
 	pDst = (Uint8 *)m_pSurface->pixels;
 	iDstLineSize = m_pSurface->pitch;
 
-	OGE_FX_BltChangedRGB(pDst, iDstLineSize,
-                        rcDst.x, rcDst.y,
-                        pSrc, iSrcLineSize, pSrcImage->m_iColorKey,
-                        rcSrc.x, rcSrc.y,
-                        rcSrc.w, rcSrc.h, m_iBPP,
-                        iRedAmount, iGreenAmount, iBlueAmount);
+	OGE_FX_BltRoundWave(pDst, iDstLineSize, rcDst.x, rcDst.y,
+                  pSrc, iSrcLineSize, rcSrc.x, rcSrc.y, rcSrc.w, rcSrc.h,
+                  m_iBPP, pSrcImage->m_iColorKey, iXAmount, iYAmount, iZAmount, iXSteps, iYSteps);
 
     pSrcImage->EndUpdate();
 	this->EndUpdate();
 }
 
-void CogeImage::BltWithColor( CogeImage* pSrcImage, int iColor, int iAlpha,
-                        int iDstLeft, int iDstTop,
-                        int iSrcLeft, int iSrcTop, int iSrcWidth, int iSrcHeight )
+void CogeImage::BltWave(CogeImage* pSrcImage, int iAmount,
+                int iDstLeft, int iDstTop,
+                int iSrcLeft, int iSrcTop, int iSrcWidth, int iSrcHeight)
 {
-    if ( m_pVideo->m_iState < 0 ) return;
+    BltWave(pSrcImage, 10, 70, 5, 0, iAmount, iDstLeft, iDstTop,
+            iSrcLeft, iSrcTop, iSrcWidth, iSrcHeight);
+}
 
-    SDL_Rect rcSrc = {0};
-	SDL_Rect rcDst = {0};
+void CogeImage::PrepareWave(double iXAmount, double iYAmount, double iZAmount,
+                int iFromXSteps, int iToXSteps, int iFromYSteps, int iToYSteps)
+{
+    // the rows and the columns of the image as the source of BltWave()
+    OGE_FX_PrepareWave(iXAmount, iZAmount, iFromYSteps, iToYSteps, m_iHeight);
+    OGE_FX_PrepareWave(iYAmount, iZAmount, iFromXSteps, iToXSteps, m_iWidth);
+}
 
-	if (iSrcWidth == -1) iSrcWidth = pSrcImage->m_iWidth;
-	if (iSrcHeight == -1) iSrcHeight = pSrcImage->m_iHeight;
+void CogeImage::PrepareWave(int iFromAmount, int iToAmount)
+{
+    if (iFromAmount > iToAmount)
+    {
+        int iTemp = iFromAmount;
+        iFromAmount = iToAmount;
+        iToAmount = iTemp;
+    }
 
-	if(!pSrcImage->GetValidRect(iSrcLeft, iSrcTop, iSrcWidth, iSrcHeight, &rcSrc)) return;
+    PrepareWave(10, 70, 5, 0, 0, iFromAmount, iToAmount);
+}
 
-	uint8_t* pSrc;
-	uint8_t* pDst;
 
-	int iSrcLineSize = 0;
-	int iDstLineSize = 0;
+void CogeImage::Grayscale(int iDstX, int iDstY, int iWidth, int iHeight)
+{
+    if ( m_pVideo->m_iState < 0 ) return;
 
-	if(!GetValidRect(iDstLeft, iDstTop, &rcSrc, &rcDst)) return;
+    SDL_Rect rcDst = {0};
 
-	iColor = m_pVideo->FormatColor(iColor);
+	uint8_t* pDst;
 
-	pSrcImage->BeginUpdate();
-	this->BeginUpdate();
+	int iLineSize = 0;
 
-	pSrc = (Uint8 *)pSrcImage->m_pSurface->pixels;
-	iSrcLineSize =  pSrcImage->m_pSurface->pitch;
+	PrepareRawData(true);
+
+	if(!GetValidRect(iDstX, iDstY, iWidth, iHeight, &rcDst)) return;
+
+	BeginUpdate();
 
 	pDst = (Uint8 *)m_pSurface->pixels;
-	iDstLineSize = m_pSurface->pitch;
+	iLineSize = m_pSurface->pitch;
 
-	OGE_FX_BltWithColor(pDst, iDstLineSize,
-                        rcDst.x, rcDst.y,
-                        pSrc, iSrcLineSize, pSrcImage->m_iColorKey,
-                        rcSrc.x, rcSrc.y,
-                        rcSrc.w, rcSrc.h, m_iBPP, iColor, iAlpha);
+	OGE_FX_Grayscale(pDst, iLineSize, rcDst.x, rcDst.y, rcDst.w, rcDst.h, m_iBPP);
 
-    pSrcImage->EndUpdate();
-	this->EndUpdate();
+	EndUpdate();
 }
 
-void CogeImage::BltWithEdge( CogeImage* pSrcImage, int iEdgeColor,
-                        int iDstLeft, int iDstTop,
-                        int iSrcLeft, int iSrcTop, int iSrcWidth, int iSrcHeight )
+void CogeImage::SubLight(int iDstX, int iDstY, int iWidth, int iHeight, int iAmount)
 {
     if ( m_pVideo->m_iState < 0 ) return;
 
-    SDL_Rect rcSrc = {0};
-	SDL_Rect rcDst = {0};
-
-	if (iSrcWidth == -1) iSrcWidth = pSrcImage->m_iWidth;
-	if (iSrcHeight == -1) iSrcHeight = pSrcImage->m_iHeight;
-
-	if(!pSrcImage->GetValidRect(iSrcLeft, iSrcTop, iSrcWidth, iSrcHeight, &rcSrc)) return;
+    SDL_Rect rcDst = {0};
 
-	uint8_t* pSrc;
 	uint8_t* pDst;
 
-	int iSrcLineSize = 0;
-	int iDstLineSize = 0;
-
-	if(!GetValidRect(iDstLeft, iDstTop, &rcSrc, &rcDst)) return;
+	int iLineSize = 0;
 
-	iEdgeColor = m_pVideo->FormatColor(iEdgeColor);
+	PrepareRawData(true);
 
-	pSrcImage->BeginUpdate();
-	this->BeginUpdate();
+	if(!GetValidRect(iDstX, iDstY, iWidth, iHeight, &rcDst)) return;
 
-	pSrc = (Uint8 *)pSrcImage->m_pSurface->pixels;
-	iSrcLineSize =  pSrcImage->m_pSurface->pitch;
+	BeginUpdate();
 
 	pDst = (Uint8 *)m_pSurface->pixels;
-	iDstLineSize = m_pSurface->pitch;
+	iLineSize = m_pSurface->pitch;
 
-	OGE_FX_BltWithEdge(pDst, iDstLineSize,
-                        rcDst.x, rcDst.y,
-                        pSrc, iSrcLineSize, pSrcImage->m_iColorKey,
-                        rcSrc.x, rcSrc.y,
-                        rcSrc.w, rcSrc.h, m_iBPP, iEdgeColor);
+	OGE_FX_SubLight(pDst, iLineSize, rcDst.x, rcDst.y, rcDst.w, rcDst.h, m_iBPP, iAmount );
+
+	EndUpdate();
 
-    pSrcImage->EndUpdate();
-	this->EndUpdate();
 }
 
-void CogeImage::BltWithLightness( CogeImage* pSrcImage, int iAmount,
-                        int iDstLeft, int iDstTop,
-                        int iSrcLeft, int iSrcTop, int iSrcWidth, int iSrcHeight )
+void CogeImage::Lightness(int iDstX, int iDstY, int iWidth, int iHeight, int iAmount)
 {
     if ( m_pVideo->m_iState < 0 ) return;
 
-    SDL_Rect rcSrc = {0};
-	SDL_Rect rcDst = {0};
-
-	if (iSrcWidth == -1) iSrcWidth = pSrcImage->m_iWidth;
-	if (iSrcHeight == -1) iSrcHeight = pSrcImage->m_iHeight;
-
-	if(!pSrcImage->GetValidRect(iSrcLeft, iSrcTop, iSrcWidth, iSrcHeight, &rcSrc)) return;
+    SDL_Rect rcDst = {0};
 
-	uint8_t* pSrc;
 	uint8_t* pDst;
 
-	int iSrcLineSize = 0;
-	int iDstLineSize = 0;
+	int iLineSize = 0;
 
-	if(!GetValidRect(iDstLeft, iDstTop, &rcSrc, &rcDst)) return;
+	PrepareRawData(true);
 
-	pSrcImage->BeginUpdate();
-	this->BeginUpdate();
+	if(!GetValidRect(iDstX, iDstY, iWidth, iHeight, &rcDst)) return;
 
-	pSrc = (Uint8 *)pSrcImage->m_pSurface->pixels;
-	iSrcLineSize =  pSrcImage->m_pSurface->pitch;
+	BeginUpdate();
 
 	pDst = (Uint8 *)m_pSurface->pixels;
-	iDstLineSize = m_pSurface->pitch;
+	iLineSize = m_pSurface->pitch;
 
-	OGE_FX_BltLightness(pDst, iDstLineSize,
-                        rcDst.x, rcDst.y,
-                        pSrc, iSrcLineSize, pSrcImage->m_iColorKey,
-                        rcSrc.x, rcSrc.y,
-                        rcSrc.w, rcSrc.h, m_iBPP, iAmount);
+	OGE_FX_Lightness(pDst, iLineSize, rcDst.x, rcDst.y, rcDst.w, rcDst.h, m_iBPP, iAmount );
 
-    pSrcImage->EndUpdate();
-	this->EndUpdate();
+	EndUpdate();
 }
 
-void CogeImage::LightMaskBlend( CogeImage* pSrcImage, int iDstLeft, int iDstTop,
-                        int iSrcLeft, int iSrcTop, int iSrcWidth, int iSrcHeight )
+void CogeImage::Blur(int iDstX, int iDstY, int iWidth, int iHeight, int iAmount)
 {
     if ( m_pVideo->m_iState < 0 ) return;
 
-    SDL_Rect rcSrc = {0};
-	SDL_Rect rcDst = {0};
-
-	if (iSrcWidth == -1) iSrcWidth = pSrcImage->m_iWidth;
-	if (iSrcHeight == -1) iSrcHeight = pSrcImage->m_iHeight;
-
-	if(!pSrcImage->GetValidRect(iSrcLeft, iSrcTop, iSrcWidth, iSrcHeight, &rcSrc)) return;
+    SDL_Rect rcDst = {0};
 
-	uint8_t* pSrc;
 	uint8_t* pDst;
 
-	int iSrcLineSize = 0;
-	int iDstLineSize = 0;
+	int iLineSize = 0;
 
-	if(!GetValidRect(iDstLeft, iDstTop, &rcSrc, &rcDst)) return;
+	PrepareRawData(true);
 
-	pSrcImage->BeginUpdate();
-	this->BeginUpdate();
+	if(!GetValidRect(iDstX, iDstY, iWidth, iHeight, &rcDst)) return;
 
-	pSrc = (Uint8 *)pSrcImage->m_pSurface->pixels;
-	iSrcLineSize =  pSrcImage->m_pSurface->pitch;
+	BeginUpdate();
 
 	pDst = (Uint8 *)m_pSurface->pixels;
-	iDstLineSize = m_pSurface->pitch;
-
-	OGE_FX_LightMaskBlend(pDst, iDstLineSize,
-                        rcDst.x, rcDst.y,
-                        pSrc, iSrcLineSize,
-                        rcSrc.x, rcSrc.y,
-                        rcSrc.w, rcSrc.h, m_iBPP);
+	iLineSize = m_pSurface->pitch;
 
-    pSrcImage->EndUpdate();
-	this->EndUpdate();
+	OGE_FX_GaussianBlur(pDst, iLineSize, rcDst.x, rcDst.y, rcDst.w, rcDst.h, m_iBPP, iAmount );
 
+	EndUpdate();
 }
 
-void CogeImage::BltMask( CogeImage* pSrcImage, CogeImage* pMaskImage, int iDstLeft, int iDstTop,
-                  int iSrcLeft, int iSrcTop, int iMaskLeft, int iMaskTop,
-                  int iSrcWidth, int iSrcHeight )
+void CogeImage::Grayscale(int iDstX, int iDstY, int iWidth, int iHeight, int iAmount)
 {
     if ( m_pVideo->m_iState < 0 ) return;
 
-    SDL_Rect rcSrc = {0};
-	SDL_Rect rcDst = {0};
-
-	if (iSrcWidth == -1) iSrcWidth = pSrcImage->m_iWidth;
-	if (iSrcHeight == -1) iSrcHeight = pSrcImage->m_iHeight;
-
-	if(!pSrcImage->GetValidRect(iSrcLeft, iSrcTop, iSrcWidth, iSrcHeight, &rcSrc)) return;
-
-	if(iMaskLeft + rcSrc.w > pMaskImage->m_iWidth ||
-	   iMaskTop + rcSrc.h > pMaskImage->m_iHeight) return;
+    SDL_Rect rcDst = {0};
 
-	uint8_t* pSrc;
 	uint8_t* pDst;
-	uint8_t* pMask;
 
-	int iSrcLineSize = 0;
-	int iDstLineSize = 0;
-	int iMaskLineSize = 0;
+	int iLineSize = 0;
 
-	if(!GetValidRect(iDstLeft, iDstTop, &rcSrc, &rcDst)) return;
+	PrepareRawData(true);
 
-	pSrcImage->BeginUpdate();
-	pMaskImage->BeginUpdate();
-	this->BeginUpdate();
+	if(!GetValidRect(iDstX, iDstY, iWidth, iHeight, &rcDst)) return;
 
-	pSrc = (Uint8 *)pSrcImage->m_pSurface->pixels;
-	iSrcLineSize =  pSrcImage->m_pSurface->pitch;
+	BeginUpdate();
 
 	pDst = (Uint8 *)m_pSurface->pixels;
-	iDstLineSize = m_pSurface->pitch;
-
-	pMask = (Uint8 *)pMaskImage->m_pSurface->pixels;
-	iMaskLineSize =  pMaskImage->m_pSurface->pitch;
+	iLineSize = m_pSurface->pitch;
 
-	OGE_FX_BltMask(pDst, iDstLineSize,
-                        rcDst.x, rcDst.y,
-                        pSrc, iSrcLineSize,
-                        rcSrc.x, rcSrc.y,
-                        pMask, iMaskLineSize,
-                        iMaskLeft, iMaskTop,
-                        rcSrc.w, rcSrc.h, m_iBPP);
+	OGE_FX_ChangeGrayLevel(pDst, iLineSize, rcDst.x, rcDst.y, rcDst.w, rcDst.h, m_iBPP, iAmount );
 
-    pSrcImage->EndUpdate();
-    pMaskImage->EndUpdate();
-	this->EndUpdate();
+	EndUpdate();
 }
 
-void CogeImage::BltStretchFast(CogeImage* pSrcImage, int iSrcLeft, int iSrcTop, int iSrcRight, int iSrcBottom,
-                    int iDstLeft, int iDstTop, int iDstRight, int iDstBottom)
+void CogeImage::ChangeColorRGB(int iDstX, int iDstY, int iWidth, int iHeight,
+                     int iRedAmount, int iGreenAmount, int iBlueAmount )
 {
-    SDL_Rect rcSrc = {0};
-	SDL_Rect rcDst = {0};
+    if ( m_pVideo->m_iState < 0 ) return;
 
-	if(!pSrcImage->GetValidRect(iSrcLeft, iSrcTop, iSrcRight-iSrcLeft, iSrcBottom-iSrcTop, &rcSrc)) return;
-	if(!GetValidRect(iDstLeft, iDstTop, iDstRight-iDstLeft, iDstBottom-iDstTop, &rcDst)) return;
+    SDL_Rect rcDst = {0};
 
-	SDL_SoftStretch(pSrcImage->m_pSurface, &rcSrc, m_pSurface, &rcDst);
+	uint8_t* pDst;
+
+	int iLineSize = 0;
+
+	PrepareRawData(true);
+
+	if(!GetValidRect(iDstX, iDstY, iWidth, iHeight, &rcDst)) return;
+
+	BeginUpdate();
+
+	pDst = (Uint8 *)m_pSurface->pixels;
+	iLineSize = m_pSurface->pitch;
+
+	OGE_FX_ChangeColorRGB(pDst, iLineSize, rcDst.x, rcDst.y, rcDst.w, rcDst.h, m_iBPP,
+	                    iRedAmount, iGreenAmount, iBlueAmount );
+
+    EndUpdate();
 }
 
-void CogeImage::BltStretch(CogeImage* pSrcImage, int iSrcLeft, int iSrcTop, int iSrcRight, int iSrcBottom,
-                    int iDstLeft, int iDstTop, int iDstRight, int iDstBottom)
-{
-    SDL_Rect rcSrc = {0};
-	SDL_Rect rcDst = {0};
+void CogeImage::ColorTransform(CogeFXColorTransform* pTransform, int iDstX, int iDstY, int iWidth, int iHeight)
+{
+    if ( m_pVideo->m_iState < 0 ) return;
 
-	if(!pSrcImage->GetValidRect(iSrcLeft, iSrcTop, iSrcRight-iSrcLeft, iSrcBottom-iSrcTop, &rcSrc)) return;
-	if(!GetValidRect(iDstLeft, iDstTop, iDstRight-iDstLeft, iDstBottom-iDstTop, &rcDst)) return;
+    if (pTransform == NULL) return;
 
-	//SDL_SoftStretch(pSrcImage->m_pSurface, &rcSrc, m_pSurface, &rcDst);
+    SDL_Rect rcDst = {0};
 
-	uint8_t* pSrc;
 	uint8_t* pDst;
 
-	int iSrcLineSize = 0;
-	int iDstLineSize = 0;
+	int iLineSize = 0;
 
-	if(pSrcImage->m_bHasAlphaChannel && pSrcImage->m_bHasLocalClipboard)
-    {
-        //SDL_Surface* pSurface = pSrcImage->GetSurface();
-        //SDL_Surface* pBackup = pSrcImage->GetBackupSurface();
+	PrepareRawData(true);
 
-        SDL_Surface* pSurface = pSrcImage->GetCurrentClipboard();
-        if(pSurface == NULL) pSurface = pSrcImage->GetSurface();
+	if(!GetValidRect(iDstX, iDstY, iWidth, iHeight, &rcDst)) return;
 
-        SDL_Surface* pBackup = pSrcImage->GetFreeClipboard();
+	BeginUpdate();
 
-        if (pSurface && pBackup)
-        {
+	pDst = (Uint8 *)m_pSurface->pixels;
+	iLineSize = m_pSurface->pitch;
 
-#if (defined __OGE_WITH_SDL2__) && (defined __IMG_WITH_LOCK__)
-//#if (defined __OGE_WITH_SDL2__)
-            bool bNeedLockSrc = SDL_MUSTLOCK(pSurface) != 0;
-            bool bNeedLockDst = SDL_MUSTLOCK(pBackup) != 0;
-            // just force the images to be locked ...
-            //bool bNeedLockSrc = true;
-            //bool bNeedLockDst = true;
-#else
-            bool bNeedLockSrc = false;
-            bool bNeedLockDst = false;
-#endif
+	OGE_FX_ColorTransform(pDst, iLineSize, rcDst.x, rcDst.y, rcDst.w, rcDst.h, m_iBPP, pTransform);
 
-            bool bStretched = false;
+    EndUpdate();
+}
 
-            if (bNeedLockSrc) bNeedLockSrc = SDL_LockSurface(pSurface) == 0;
-            if (bNeedLockDst) bNeedLockDst = SDL_LockSurface(pBackup) == 0;
+/*
+void CogeImage::UpdateRect(int iSrcLeft, int iSrcTop, int iSrcWidth, int iSrcHeight)
+{
+    if(m_pSurface)
+    {
+        if(iSrcWidth < 0) iSrcWidth = m_iWidth;
+        if(iSrcHeight < 0) iSrcHeight = m_iHeight;
 
-            pSrc = (Uint8 *)pSurface->pixels;
-            pDst = (Uint8 *)pBackup->pixels;
+#if SDL_VERSION_ATLEAST(2,0,0)
+        SDL_Rect rect;
+        rect.x = iSrcLeft;
+        rect.y = iSrcTop;
+        rect.w = iSrcWidth;
+        rect.h = iSrcHeight;
+        SDL_UpdateRects(m_pSurface, 1, &rect);
 
-            iSrcLineSize = pSurface->pitch;
-            iDstLineSize = pBackup->pitch;
+#else
+        SDL_UpdateRect(m_pSurface, iSrcLeft, iSrcTop, iSrcWidth, iSrcHeight);
+#endif
+    }
+}
+*/
 
-            if(rcDst.w <= pSrcImage->m_iWidth && rcDst.h <= pSrcImage->m_iHeight)
-            {
-                bStretched = true;
-                OGE_FX_BltStretch(pDst, iDstLineSize,
-                        0, 0, rcDst.w, rcDst.h,
-                        pSrc, iSrcLineSize, -1,
-                        rcSrc.x, rcSrc.y, rcSrc.w, rcSrc.h, pSurface->format->BitsPerPixel);
-            }
-            else
-            {
-                SDL_BlitSurface(pSurface, &rcSrc, pBackup, &rcSrc);
-            }
 
-            if (bNeedLockSrc) SDL_UnlockSurface(pSurface);
-            if (bNeedLockDst) SDL_UnlockSurface(pBackup);
+void CogeImage::FillRect(int iRGBColor, int iLeft, int iTop, int iWidth, int iHeight)
+{
+	SDL_Rect rcDst = {0};
 
-            pSrcImage->m_iEffectCount = pSrcImage->m_iEffectCount - 1;
+	int iColor = m_pVideo->FormatColor(iRGBColor);
 
-            if(pSrcImage->m_iEffectCount < 0) pSrcImage->m_iEffectCount = 0;
+	PrepareRawData(true);
 
-            if(pSrcImage->m_iEffectCount == 0)
-            {
-                pSrcImage->SetCurrentClipboard(NULL);
-                if(bStretched)
-                {
-                    rcSrc.x = 0; rcSrc.y = 0;
-                    rcSrc.w = rcDst.w; rcSrc.h = rcDst.h;
-                }
-                SDL_BlitSurface(pBackup, &rcSrc, m_pSurface, &rcDst);
-            }
-            else pSrcImage->SetCurrentClipboard(pBackup);
+	//int iR = (iRGBColor&0x00ff0000)>>16;
+    //int iG = (iRGBColor&0x0000ff00)>>8;
+    //int iB = iRGBColor&0x000000ff;
+    //int iColor = SDL_MapRGB(m_pSurface->format, iR, iG, iB);
 
-            return ;
+	if (iWidth <= 0 && iHeight <= 0)
+        SDL_FillRect(m_pSurface, 0, iColor);
+    else
+    {
+        if (GetValidRect(iLeft, iTop, iWidth, iHeight, &rcDst))
+        SDL_FillRect(m_pSurface, &rcDst, iColor);
+    }
+}
 
-        }
+bool CogeImage::LoadBMP(const std::string& sFileName, bool bLoadAlphaChannel, bool bCreateLocalClipboard)
+{
+    //return false;
+    //SDL_Surface* bmp = m_pVideo->OGE_LoadBMP(sFileName.c_str());
+    SDL_Surface* bmp = SDL_LoadBMP(sFileName.c_str());
+
+    if (!bmp) return false;
 
+    if (m_pSpans)
+    {
+        OGE_FX_FreeSpans(m_pSpans);
+        m_pSpans = NULL;
     }
 
-	pSrcImage->BeginUpdate();
-	this->BeginUpdate();
+    ClearIndexed();
 
-	pSrc = (Uint8 *)pSrcImage->m_pSurface->pixels;
-	iSrcLineSize =  pSrcImage->m_pSurface->pitch;
+    ReleaseAtlas();
 
-	pDst = (Uint8 *)m_pSurface->pixels;
-	iDstLineSize = m_pSurface->pitch;
+    if (m_pSurface)
+    {
+        SDL_FreeSurface(m_pSurface);
+        m_pSurface = NULL;
+    }
 
-	OGE_FX_BltStretch(pDst, iDstLineSize,
-                        rcDst.x, rcDst.y, rcDst.w, rcDst.h,
-                        pSrc, iSrcLineSize, pSrcImage->m_iColorKey,
-                        rcSrc.x, rcSrc.y, rcSrc.w, rcSrc.h, m_iBPP);
+    FreePremultiplied();
+    m_bPremultiplied = false;
 
-    pSrcImage->EndUpdate();
-	this->EndUpdate();
-}
+    m_pSurface = m_pVideo->ConvertImage(bmp, bLoadAlphaChannel);
 
-void CogeImage::BltStretchSmoothly(CogeImage* pSrcImage, int iSrcLeft, int iSrcTop, int iSrcRight, int iSrcBottom,
-                    int iDstLeft, int iDstTop, int iDstRight, int iDstBottom)
-{
-    SDL_Rect rcSrc = {0};
-	SDL_Rect rcDst = {0};
+    m_bHasAlphaChannel = bLoadAlphaChannel;
+    m_bHasLocalClipboard = m_bHasAlphaChannel && bCreateLocalClipboard;
 
-	if(!pSrcImage->GetValidRect(iSrcLeft, iSrcTop, iSrcRight-iSrcLeft, iSrcBottom-iSrcTop, &rcSrc)) return;
-	if(!GetValidRect(iDstLeft, iDstTop, iDstRight-iDstLeft, iDstBottom-iDstTop, &rcDst)) return;
+    if(m_pSurface && m_bHasAlphaChannel && m_bHasLocalClipboard)
+    {
+        if (m_pLocalClipboardA)
+        {
+            SDL_FreeSurface(m_pLocalClipboardA);
+            m_pLocalClipboardA = NULL;
+        }
 
-	uint8_t* pSrc;
-	uint8_t* pDst;
+        m_pLocalClipboardA = OGE_CopySurface(m_pSurface);
 
-	int iSrcLineSize = 0;
-	int iDstLineSize = 0;
+        if (m_pLocalClipboardB)
+        {
+            SDL_FreeSurface(m_pLocalClipboardB);
+            m_pLocalClipboardB = NULL;
+        }
 
-	pSrcImage->BeginUpdate();
-	this->BeginUpdate();
+        m_pLocalClipboardB = OGE_CopySurface(m_pSurface);
 
-	pSrc = (Uint8 *)pSrcImage->m_pSurface->pixels;
-	iSrcLineSize =  pSrcImage->m_pSurface->pitch;
+    }
 
-	pDst = (Uint8 *)m_pSurface->pixels;
-	iDstLineSize = m_pSurface->pitch;
+    if(m_pVideo && m_pVideo->m_bPremultipliedAlpha) PremultiplyAlpha();
 
-	OGE_FX_StretchSmoothly(pDst, iDstLineSize,
-                        rcDst.x, rcDst.y, rcDst.w, rcDst.h,
-                        pSrc, iSrcLineSize,
-                        rcSrc.x, rcSrc.y, rcSrc.w, rcSrc.h, m_iBPP);
+    SDL_FreeSurface( bmp );
+
+    if (!m_pSurface) return false;
+    else return true;
 
-    pSrcImage->EndUpdate();
-	this->EndUpdate();
 }
 
-void CogeImage::BltRotate(CogeImage* pSrcImage, double fAngle,
-                    int iDstLeft, int iDstTop,
-                    int iSrcLeft, int iSrcTop, int iSrcWidth, int iSrcHeight )
+bool CogeImage::LoadImg(const std::string& sFileName, bool bLoadAlphaChannel, bool bCreateLocalClipboard)
 {
-    SDL_Rect rcSrc = {0};
-	SDL_Rect rcDst = {0};
+    //return false;
 
-	if (iSrcWidth == -1) iSrcWidth = pSrcImage->m_iWidth;
-	if (iSrcHeight == -1) iSrcHeight = pSrcImage->m_iHeight;
+    //SDL_RWops *src = SDL_RWFromFile(sFileName.c_str(), "rb");
+    //bool bIsPng = IMG_isPNG(src);
+    //SDL_Surface* img = IMG_Load_RW(src, 1);
 
-	if(!pSrcImage->GetValidRect(iSrcLeft, iSrcTop, iSrcWidth, iSrcHeight, &rcSrc)) return;
-	if(!GetValidRect(iDstLeft, iDstTop, iSrcWidth, iSrcHeight, &rcDst)) return;
+    //int iPos = sFileName.find_last_of('.');
+    //if(iPos < 0) return false;
+    //std::string sExt = sFileName.substr(iPos);
+    //bool bIsPng = sExt == ".png";
 
-	uint8_t* pSrc;
-	uint8_t* pDst;
+//#ifdef __OGE_WITH_SDL2__
+//    if(sFileName.find_last_of(".bmp") > 0)
+//    {
+//        return LoadBMP(sFileName, bLoadAlphaChannel);
+//    }
+//#endif
 
-	int iSrcLineSize = 0;
-	int iDstLineSize = 0;
+    //SDL_Surface* img = m_pVideo->OGE_LoadIMG(sFileName.c_str());
+    SDL_Surface* img = IMG_Load(sFileName.c_str());
 
-	if(pSrcImage->m_bHasAlphaChannel && pSrcImage->m_bHasLocalClipboard)
+    if(img)
     {
-        //SDL_Surface* pSurface = pSrcImage->GetSurface();
-        //SDL_Surface* pBackup = pSrcImage->GetBackupSurface();
+        if (m_pSpans)
+        {
+            OGE_FX_FreeSpans(m_pSpans);
+            m_pSpans = NULL;
+        }
 
-        SDL_Surface* pSurface = pSrcImage->GetCurrentClipboard();
-        if(pSurface == NULL) pSurface = pSrcImage->GetSurface();
+        ClearIndexed();
 
-        SDL_Surface* pBackup = pSrcImage->GetFreeClipboard();
+        ReleaseAtlas();
 
-        if (pSurface && pBackup)
+        if (m_pSurface)
         {
+            SDL_FreeSurface(m_pSurface);
+            m_pSurface = NULL;
+        }
 
-#if (defined __OGE_WITH_SDL2__) && (defined __IMG_WITH_LOCK__)
-//#if (defined __OGE_WITH_SDL2__)
-            bool bNeedLockSrc = SDL_MUSTLOCK(pSurface) != 0;
-            bool bNeedLockDst = SDL_MUSTLOCK(pBackup) != 0;
-            // just force the images to be locked ...
-            //bool bNeedLockSrc = true;
-            //bool bNeedLockDst = true;
-#else
-            bool bNeedLockSrc = false;
-            bool bNeedLockDst = false;
-#endif
-
-            if (bNeedLockSrc) bNeedLockSrc = SDL_LockSurface(pSurface) == 0;
-            if (bNeedLockDst) bNeedLockDst = SDL_LockSurface(pBackup) == 0;
-
-            pSrc = (Uint8 *)pSurface->pixels;
-            pDst = (Uint8 *)pBackup->pixels;
+        FreePremultiplied();
+        m_bPremultiplied = false;
 
-            iSrcLineSize = pSurface->pitch;
-            iDstLineSize = pBackup->pitch;
+        m_pSurface = m_pVideo->ConvertImage(img, bLoadAlphaChannel);
 
-            OGE_FX_BltRotate(pDst, iDstLineSize, 0, 0, pSrcImage->m_iWidth, pSrcImage->m_iHeight,
-                  pSrc, iSrcLineSize, 0, 0, pSrcImage->m_iWidth, pSrcImage->m_iHeight,
-                  pSurface->format->BitsPerPixel, -1, fAngle);
+        m_bHasAlphaChannel = bLoadAlphaChannel;
+        m_bHasLocalClipboard = m_bHasAlphaChannel && bCreateLocalClipboard;
 
-            if (bNeedLockSrc) SDL_UnlockSurface(pSurface);
-            if (bNeedLockDst) SDL_UnlockSurface(pBackup);
+        if(m_pSurface && m_bHasAlphaChannel && m_bHasLocalClipboard)
+        {
+            //uint8_t* pDst = (Uint8 *)m_pSurface->pixels;
+            //int iDstLineSize = m_pSurface->pitch;
+            //OGE_FX_UpdateAlpha(pDst, iDstLineSize, 0, 0, m_pSurface->w, m_pSurface->h, 32, -192);
 
-            pSrcImage->m_iEffectCount = pSrcImage->m_iEffectCount - 1;
+            if (m_pLocalClipboardA)
+            {
+                SDL_FreeSurface(m_pLocalClipboardA);
+                m_pLocalClipboardA = NULL;
+            }
 
-            if(pSrcImage->m_iEffectCount < 0) pSrcImage->m_iEffectCount = 0;
+            m_pLocalClipboardA = OGE_CopySurface(m_pSurface);
 
-            if(pSrcImage->m_iEffectCount == 0)
+            if (m_pLocalClipboardB)
             {
-                pSrcImage->SetCurrentClipboard(NULL);
-                SDL_BlitSurface(pBackup, &rcSrc, m_pSurface, &rcDst);
+                SDL_FreeSurface(m_pLocalClipboardB);
+                m_pLocalClipboardB = NULL;
             }
-            else pSrcImage->SetCurrentClipboard(pBackup);
 
-            return ;
+            m_pLocalClipboardB = OGE_CopySurface(m_pSurface);
 
         }
 
-    }
-
-    pSrcImage->BeginUpdate();
-	this->BeginUpdate();
+        if(m_pVideo && m_pVideo->m_bPremultipliedAlpha) PremultiplyAlpha();
 
-	pSrc = (Uint8 *)pSrcImage->m_pSurface->pixels;
-	iSrcLineSize =  pSrcImage->m_pSurface->pitch;
-
-	pDst = (Uint8 *)m_pSurface->pixels;
-	iDstLineSize = m_pSurface->pitch;
+        SDL_FreeSurface(img);
 
-	OGE_FX_BltRotate(pDst, iDstLineSize, rcDst.x, rcDst.y, rcDst.w, rcDst.h,
-                  pSrc, iSrcLineSize, rcSrc.x, rcSrc.y, rcSrc.w, rcSrc.h,
-                  m_iBPP, pSrcImage->m_iColorKey, fAngle);
+        if (m_pSurface) return true;
+        else
+        {
+            OGE_Log("Could not convert image bbp format %s: %s\n", sFileName.c_str(), SDL_GetError());
+            return false;
+        }
+    }
+    else
+    {
+        OGE_Log("Can not load image %s from file: %s, reason: %s\n", m_sName.c_str(), sFileName.c_str(), SDL_GetError());
+        return false;
+    }
 
-    pSrcImage->EndUpdate();
-	this->EndUpdate();
 }
 
-void CogeImage::BltRotozoom(CogeImage* pSrcImage, double fAngle, int iZoom,
-                    int iDstLeft, int iDstTop,
-                    int iSrcLeft, int iSrcTop, int iSrcWidth, int iSrcHeight )
+bool CogeImage::LoadImgFromBuffer(char* pBuffer, int iBufferSize, bool bLoadAlphaChannel, bool bCreateLocalClipboard)
 {
-    SDL_Rect rcSrc = {0};
-	SDL_Rect rcDst = {0};
-
-	if (iSrcWidth == -1) iSrcWidth = pSrcImage->m_iWidth;
-	if (iSrcHeight == -1) iSrcHeight = pSrcImage->m_iHeight;
-
-	//rcSrc.x = iSrcLeft;
-	//rcSrc.y = iSrcTop;
-	//rcSrc.w = iSrcWidth;
-	//rcSrc.h = iSrcHeight;
-
-	if(!pSrcImage->GetValidRect(iSrcLeft, iSrcTop, iSrcWidth, iSrcHeight, &rcSrc)) return;
-	if(!GetValidRect(iDstLeft, iDstTop, iSrcWidth, iSrcHeight, &rcDst)) return;
-
-	uint8_t* pSrc;
-	uint8_t* pDst;
+    SDL_Surface* img = IMG_Load_RW(SDL_RWFromMem((void*)pBuffer, iBufferSize), 0);
 
-	int iSrcLineSize = 0;
-	int iDstLineSize = 0;
+    if(img)
+    {
+        if (m_pSpans)
+        {
+            OGE_FX_FreeSpans(m_pSpans);
+            m_pSpans = NULL;
+        }
 
-	//if(!GetValidRect(iDstLeft, iDstTop, rcSrc, rcDst)) return;
+        ClearIndexed();
 
-	//int iColorKey = pSrcImage->m_iColorKeyRGB
+        ReleaseAtlas();
 
-	//if (SDL_LockSurface(m_pSurface) < 0) return;
-	//if (SDL_LockSurface(pSrcImage->m_pSurface) < 0)
-	//{
-	//    SDL_UnlockSurface( m_pSurface );
-    //    return;
-	//}
+        if (m_pSurface)
+        {
+            SDL_FreeSurface(m_pSurface);
+            m_pSurface = NULL;
+        }
 
-	//try
-	//{
+        FreePremultiplied();
+        m_bPremultiplied = false;
 
-	//if (m_pddSurface->Lock(&rcDst, &ddsd, DDLOCK_WAIT, NULL) != DD_OK) return;
+        m_pSurface = m_pVideo->ConvertImage(img, bLoadAlphaChannel);
 
-	pSrcImage->BeginUpdate();
-	this->BeginUpdate();
+        m_bHasAlphaChannel = bLoadAlphaChannel;
+        m_bHasLocalClipboard = m_bHasAlphaChannel && bCreateLocalClipboard;
 
-	pSrc = (Uint8 *)pSrcImage->m_pSurface->pixels;
-	iSrcLineSize =  pSrcImage->m_pSurface->pitch;
+        if(m_pSurface && m_bHasAlphaChannel && m_bHasLocalClipboard)
+        {
+            if (m_pLocalClipboardA)
+            {
+                SDL_FreeSurface(m_pLocalClipboardA);
+                m_pLocalClipboardA = NULL;
+            }
 
-	pDst = (Uint8 *)m_pSurface->pixels;
-	iDstLineSize = m_pSurface->pitch;
+            m_pLocalClipboardA = OGE_CopySurface(m_pSurface);
 
-	OGE_FX_BltRotate(pDst, iDstLineSize, rcDst.x, rcDst.y, rcDst.w, rcDst.h,
-                  pSrc, iSrcLineSize, rcSrc.x, rcSrc.y, rcSrc.w, rcSrc.h,
-                  m_iBPP, pSrcImage->m_iColorKey, fAngle, iZoom);
+            if (m_pLocalClipboardB)
+            {
+                SDL_FreeSurface(m_pLocalClipboardB);
+                m_pLocalClipboardB = NULL;
+            }
 
+            m_pLocalClipboardB = OGE_CopySurface(m_pSurface);
+        }
 
-	//}
-	//catch ( ... )
-	//{
-	//    SDL_UnlockSurface( pSrcImage->m_pSurface );
-	//    SDL_UnlockSurface( m_pSurface );
-    //}
+        if(m_pVideo && m_pVideo->m_bPremultipliedAlpha) PremultiplyAlpha();
 
-	//m_pddSurface->Unlock(&rcDst);
+        SDL_FreeSurface(img);
 
-    //SDL_UnlockSurface( pSrcImage->m_pSurface );
-	//SDL_UnlockSurface( m_pSurface );
+        if (m_pSurface) return true;
+        else
+        {
+            OGE_Log("Could not convert image bbp format: %s\n", SDL_GetError());
+            return false;
+        }
+    }
+    else
+    {
+        OGE_Log("Couldn't load image from buffer: %s\n", SDL_GetError());
+        return false;
+    }
 
-	pSrcImage->EndUpdate();
-	this->EndUpdate();
 }
 
-void CogeImage::BltWave(CogeImage* pSrcImage, double iXAmount, double iYAmount, double iZAmount,
-                int iXSteps, int iYSteps,
-                int iDstLeft, int iDstTop,
-                int iSrcLeft, int iSrcTop, int iSrcWidth, int iSrcHeight)
+bool CogeImage::LoadAtlasRect(SDL_Surface* pAtlas, int iAtlasX, int iAtlasY, int iWidth, int iHeight,
+                              bool bLoadAlphaChannel, bool bCreateLocalClipboard)
 {
-    SDL_Rect rcSrc = {0};
-	SDL_Rect rcDst = {0};
-
-	if (iSrcWidth == -1) iSrcWidth = pSrcImage->m_iWidth;
-	if (iSrcHeight == -1) iSrcHeight = pSrcImage->m_iHeight;
+    if (pAtlas == NULL || iWidth <= 0 || iHeight <= 0) return false;
+    if (iAtlasX < 0 || iAtlasY < 0 || iAtlasX + iWidth > pAtlas->w || iAtlasY + iHeight > pAtlas->h) return false;
 
-	if(!pSrcImage->GetValidRect(iSrcLeft, iSrcTop, iSrcWidth, iSrcHeight, &rcSrc)) return;
-	if(!GetValidRect(iDstLeft, iDstTop, iSrcWidth, iSrcHeight, &rcDst)) return;
+    SDL_PixelFormat* format = pAtlas->format;
 
-	uint8_t* pSrc;
-	uint8_t* pDst;
+    SDL_Surface* pSurface = SDL_CreateRGBSurfaceFrom((Uint8*)pAtlas->pixels + iAtlasY * pAtlas->pitch + iAtlasX * format->BytesPerPixel,
+                                                     iWidth, iHeight, format->BitsPerPixel, pAtlas->pitch,
+                                                     format->Rmask, format->Gmask, format->Bmask, format->Amask);
+    if (pSurface == NULL)
+    {
+        OGE_Log("Couldn't create image from atlas: %s\n", SDL_GetError());
+        return false;
+    }
 
-	int iSrcLineSize = 0;
-	int iDstLineSize = 0;
+    if (m_pSpans)
+    {
+        OGE_FX_FreeSpans(m_pSpans);
+        m_pSpans = NULL;
+    }
 
-	pSrcImage->BeginUpdate();
-	this->BeginUpdate();
+    ClearIndexed();
 
-	pSrc = (Uint8 *)pSrcImage->m_pSurface->pixels;
-	iSrcLineSize =  pSrcImage->m_pSurface->pitch;
+    ReleaseAtlas();
 
-	pDst = (Uint8 *)m_pSurface->pixels;
-	iDstLineSize = m_pSurface->pitch;
+    if (m_pSurface)
+    {
+        SDL_FreeSurface(m_pSurface);
+        m_pSurface = NULL;
+    }
 
-	OGE_FX_BltRoundWave(pDst, iDstLineSize, rcDst.x, rcDst.y,
-                  pSrc, iSrcLineSize, rcSrc.x, rcSrc.y, rcSrc.w, rcSrc.h,
-                  m_iBPP, pSrcImage->m_iColorKey, iXAmount, iYAmount, iZAmount, iXSteps, iYSteps);
+    FreePremultiplied();
+    m_bPremultiplied = false;
 
-    pSrcImage->EndUpdate();
-	this->EndUpdate();
-}
+    // keep the sheet while the image points into it
+    pAtlas->refcount++;
+    m_pAtlas = pAtlas;
 
-void CogeImage::BltWave(CogeImage* pSrcImage, int iAmount,
-                int iDstLeft, int iDstTop,
-                int iSrcLeft, int iSrcTop, int iSrcWidth, int iSrcHeight)
-{
-    BltWave(pSrcImage, 10, 70, 5, 0, iAmount, iDstLeft, iDstTop,
-            iSrcLeft, iSrcTop, iSrcWidth, iSrcHeight);
-}
+    m_pSurface = pSurface;
 
+    m_bHasAlphaChannel = bLoadAlphaChannel && format->Amask != 0;
+    m_bHasLocalClipboard = m_bHasAlphaChannel && bCreateLocalClipboard;
 
-void CogeImage::Grayscale(int iDstX, int iDstY, int iWidth, int iHeight)
-{
-    if ( m_pVideo->m_iState < 0 ) return;
+    if (m_bHasAlphaChannel && m_bHasLocalClipboard)
+    {
+        if (m_pLocalClipboardA) SDL_FreeSurface(m_pLocalClipboardA);
+        m_pLocalClipboardA = OGE_CopySurface(m_pSurface);
 
-    SDL_Rect rcDst = {0};
+        if (m_pLocalClipboardB) SDL_FreeSurface(m_pLocalClipboardB);
+        m_pLocalClipboardB = OGE_CopySurface(m_pSurface);
+    }
 
-	uint8_t* pDst;
+    if (m_pVideo && m_pVideo->m_bPremultipliedAlpha) PremultiplyAlpha();
 
-	int iLineSize = 0;
+    return true;
+}
 
-	if(!GetValidRect(iDstX, iDstY, iWidth, iHeight, &rcDst)) return;
+void CogeImage::DetachAtlas()
+{
+    if (m_pAtlas == NULL || m_pSurface == NULL) return;
 
-	BeginUpdate();
+    SDL_Surface* pSurface = OGE_CopySurface(m_pSurface);
+    if (pSurface == NULL)
+    {
+        OGE_Log("Failed to copy the pixels of atlas image '%s'.\n", m_sName.c_str());
+        return;
+    }
 
-	pDst = (Uint8 *)m_pSurface->pixels;
-	iLineSize = m_pSurface->pitch;
+    if (m_iColorKey != -1) SDL_SetColorKey(pSurface, OGE_SRCCOLORKEY, m_iColorKey);
+    if (m_iAlpha >= 0) OGE_SetAlpha(pSurface, OGE_SRCALPHA, m_iAlpha);
 
-	OGE_FX_Grayscale(pDst, iLineSize, rcDst.x, rcDst.y, rcDst.w, rcDst.h, m_iBPP);
+    SDL_FreeSurface(m_pSurface);
+    m_pSurface = pSurface;
 
-	EndUpdate();
+    ReleaseAtlas();
 }
 
-void CogeImage::SubLight(int iDstX, int iDstY, int iWidth, int iHeight, int iAmount)
+void CogeImage::ReleaseAtlas()
 {
-    if ( m_pVideo->m_iState < 0 ) return;
-
-    SDL_Rect rcDst = {0};
-
-	uint8_t* pDst;
-
-	int iLineSize = 0;
+    if (m_pAtlas == NULL) return;
 
-	if(!GetValidRect(iDstX, iDstY, iWidth, iHeight, &rcDst)) return;
+    SDL_FreeSurface(m_pAtlas);
+    m_pAtlas = NULL;
+}
 
-	BeginUpdate();
+bool CogeImage::LoadData(const std::string& sFileName, bool bLoadAlphaChannel, bool bCreateLocalClipboard)
+{
+    return LoadImg(sFileName, bLoadAlphaChannel, bCreateLocalClipboard);
+}
 
-	pDst = (Uint8 *)m_pSurface->pixels;
-	iLineSize = m_pSurface->pitch;
+bool CogeImage::LoadDataFromBuffer(char* pBuffer, int iBufferSize, bool bLoadAlphaChannel, bool bCreateLocalClipboard)
+{
+    return LoadImgFromBuffer(pBuffer, iBufferSize, bLoadAlphaChannel, bCreateLocalClipboard);
+}
 
-	OGE_FX_SubLight(pDst, iLineSize, rcDst.x, rcDst.y, rcDst.w, rcDst.h, m_iBPP, iAmount );
 
-	EndUpdate();
+/*------------------ CogeLightBuffer ------------------*/
 
+// floor(v / 4) for the negative positions too
+static int OGE_LightCell(int v)
+{
+    return v >= 0 ? v >> 2 : -((3 - v) >> 2);
 }
 
-void CogeImage::Lightness(int iDstX, int iDstY, int iWidth, int iHeight, int iAmount)
+CogeLightBuffer::CogeLightBuffer():
+m_pBase(NULL),
+m_pBaseCells(NULL),
+m_iBaseCols(0),
+m_iBaseRows(0),
+m_pCells(NULL),
+m_iCols(0),
+m_iRows(0),
+m_iCellX(0),
+m_iCellY(0),
+m_bLit(false),
+m_iViewX(0),
+m_iViewY(0),
+m_iViewWidth(0),
+m_iViewHeight(0),
+m_iTileCols(0),
+m_iTileRows(0),
+m_bAllDirty(true)
 {
-    if ( m_pVideo->m_iState < 0 ) return;
-
-    SDL_Rect rcDst = {0};
-
-	uint8_t* pDst;
+}
 
-	int iLineSize = 0;
+CogeLightBuffer::~CogeLightBuffer()
+{
+    Reset();
 
-	if(!GetValidRect(iDstX, iDstY, iWidth, iHeight, &rcDst)) return;
+    if (m_pCells) delete [] m_pCells;
+    m_pCells = NULL;
+}
 
-	BeginUpdate();
+void CogeLightBuffer::Reset()
+{
+    for (size_t i=0; i<m_Masks.size(); i++)
+    {
+        delete [] m_Masks[i]->pCells;
+        delete m_Masks[i];
+    }
+    m_Masks.clear();
 
-	pDst = (Uint8 *)m_pSurface->pixels;
-	iLineSize = m_pSurface->pitch;
+    m_Spots.clear();
+    m_LastSpots.clear();
 
-	OGE_FX_Lightness(pDst, iLineSize, rcDst.x, rcDst.y, rcDst.w, rcDst.h, m_iBPP, iAmount );
+    if (m_pBaseCells) delete [] m_pBaseCells;
+    m_pBaseCells = NULL;
+    m_pBase = NULL;
+    m_sBaseName = "";
 
-	EndUpdate();
+    m_bAllDirty = true;
 }
 
-void CogeImage::Blur(int iDstX, int iDstY, int iWidth, int iHeight, int iAmount)
+CogeLightBuffer::CogeLightMask* CogeLightBuffer::GetMask(CogeImage* pImage, int iPhaseX, int iPhaseY)
 {
-    if ( m_pVideo->m_iState < 0 ) return;
-
-    SDL_Rect rcDst = {0};
-
-	uint8_t* pDst;
-
-	int iLineSize = 0;
+    // the name and the size guard against a new image at the address of a deleted one
+    for (size_t i=0; i<m_Masks.size(); i++)
+    {
+        CogeLightMask* pMask = m_Masks[i];
+        if (pMask->pImage == pImage && pMask->iPhaseX == iPhaseX && pMask->iPhaseY == iPhaseY &&
+            pMask->iWidth == pImage->GetWidth() && pMask->iHeight == pImage->GetHeight() &&
+            pMask->sName == pImage->GetName())
+        {
+            pMask->bUsed = true;
+            return pMask;
+        }
+    }
 
-	if(!GetValidRect(iDstX, iDstY, iWidth, iHeight, &rcDst)) return;
+    CogeLightMask* pMask = new CogeLightMask();
 
-	BeginUpdate();
+    pMask->pImage = pImage;
+    pMask->sName = pImage->GetName();
+    pMask->iWidth = pImage->GetWidth();
+    pMask->iHeight = pImage->GetHeight();
+    pMask->iPhaseX = iPhaseX;
+    pMask->iPhaseY = iPhaseY;
+    pMask->iCols = (pMask->iWidth + iPhaseX + 3) >> 2;
+    pMask->iRows = (pMask->iHeight + iPhaseY + 3) >> 2;
+    pMask->pCells = new uint8_t[pMask->iCols * pMask->iRows];
+    pMask->bUsed = true;
 
-	pDst = (Uint8 *)m_pSurface->pixels;
-	iLineSize = m_pSurface->pitch;
+    // no light out of the mask
+    if (!pImage->DownsampleLight(pMask->pCells, pMask->iCols, iPhaseX, iPhaseY, 0))
+        memset(pMask->pCells, 0, pMask->iCols * pMask->iRows);
 
-	OGE_FX_GaussianBlur(pDst, iLineSize, rcDst.x, rcDst.y, rcDst.w, rcDst.h, m_iBPP, iAmount );
+    m_Masks.push_back(pMask);
 
-	EndUpdate();
+    return pMask;
 }
 
-void CogeImage::Grayscale(int iDstX, int iDstY, int iWidth, int iHeight, int iAmount)
+void CogeLightBuffer::Begin(CogeImage* pBase, int iViewX, int iViewY, int iViewWidth, int iViewHeight)
 {
-    if ( m_pVideo->m_iState < 0 ) return;
+    // all of the view is dirty if the base or the view is new
+    m_bAllDirty = false;
 
-    SDL_Rect rcDst = {0};
+    if (pBase != m_pBase || pBase->GetName() != m_sBaseName ||
+        ((pBase->GetWidth() + 3) >> 2) != m_iBaseCols || ((pBase->GetHeight() + 3) >> 2) != m_iBaseRows)
+    {
+        if (m_pBaseCells) delete [] m_pBaseCells;
 
-	uint8_t* pDst;
+        m_pBase = pBase;
+        m_sBaseName = pBase->GetName();
+        m_iBaseCols = (pBase->GetWidth() + 3) >> 2;
+        m_iBaseRows = (pBase->GetHeight() + 3) >> 2;
+        m_pBaseCells = new uint8_t[m_iBaseCols * m_iBaseRows];
+
+        if (!pBase->DownsampleLight(m_pBaseCells, m_iBaseCols, 0, 0, 0))
+            memset(m_pBaseCells, 0, m_iBaseCols * m_iBaseRows);
 
-	int iLineSize = 0;
+        m_bAllDirty = true;
+    }
 
-	if(!GetValidRect(iDstX, iDstY, iWidth, iHeight, &rcDst)) return;
+    if (iViewX != m_iViewX || iViewY != m_iViewY || iViewWidth != m_iViewWidth || iViewHeight != m_iViewHeight)
+    {
+        m_iViewX = iViewX;
+        m_iViewY = iViewY;
+        m_iViewWidth = iViewWidth;
+        m_iViewHeight = iViewHeight;
 
-	BeginUpdate();
+        m_bAllDirty = true;
+    }
 
-	pDst = (Uint8 *)m_pSurface->pixels;
-	iLineSize = m_pSurface->pitch;
+    // the cells of the view and one more on each side for the bilinear upsampling
+    m_iCellX = OGE_LightCell(iViewX) - 1;
+    m_iCellY = OGE_LightCell(iViewY) - 1;
 
-	OGE_FX_ChangeGrayLevel(pDst, iLineSize, rcDst.x, rcDst.y, rcDst.w, rcDst.h, m_iBPP, iAmount );
+    int iCols = OGE_LightCell(iViewX + iViewWidth - 1) + 2 - m_iCellX;
+    int iRows = OGE_LightCell(iViewY + iViewHeight - 1) + 2 - m_iCellY;
 
-	EndUpdate();
-}
+    if (iCols != m_iCols || iRows != m_iRows || m_pCells == NULL)
+    {
+        if (m_pCells) delete [] m_pCells;
+        m_iCols = iCols;
+        m_iRows = iRows;
+        m_pCells = new uint8_t[m_iCols * m_iRows];
+    }
 
-void CogeImage::ChangeColorRGB(int iDstX, int iDstY, int iWidth, int iHeight,
-                     int iRedAmount, int iGreenAmount, int iBlueAmount )
-{
-    if ( m_pVideo->m_iState < 0 ) return;
+    for (int j=0; j<m_iRows; j++)
+    {
+        int y = m_iCellY + j;
+        if (y < 0) y = 0;
+        if (y >= m_iBaseRows) y = m_iBaseRows - 1;
 
-    SDL_Rect rcDst = {0};
+        uint8_t* pBaseLine = m_pBaseCells + y * m_iBaseCols;
+        uint8_t* pLine = m_pCells + j * m_iCols;
 
-	uint8_t* pDst;
+        for (int i=0; i<m_iCols; i++)
+        {
+            int x = m_iCellX + i;
+            if (x < 0) x = 0;
+            if (x >= m_iBaseCols) x = m_iBaseCols - 1;
 
-	int iLineSize = 0;
+            pLine[i] = pBaseLine[x];
+        }
+    }
 
-	if(!GetValidRect(iDstX, iDstY, iWidth, iHeight, &rcDst)) return;
+    m_bLit = false;
 
-	BeginUpdate();
+    m_LastSpots.swap(m_Spots);
+    m_Spots.clear();
 
-	pDst = (Uint8 *)m_pSurface->pixels;
-	iLineSize = m_pSurface->pitch;
+    for (size_t i=0; i<m_Masks.size(); i++) m_Masks[i]->bUsed = false;
 
-	OGE_FX_ChangeColorRGB(pDst, iLineSize, rcDst.x, rcDst.y, rcDst.w, rcDst.h, m_iBPP,
-	                    iRedAmount, iGreenAmount, iBlueAmount );
+    m_iTileCols = (iViewWidth + _OGE_LIGHT_TILE_SIZE_ - 1) / _OGE_LIGHT_TILE_SIZE_;
+    m_iTileRows = (iViewHeight + _OGE_LIGHT_TILE_SIZE_ - 1) / _OGE_LIGHT_TILE_SIZE_;
 
-    EndUpdate();
+    m_Tiles.assign(m_iTileCols * m_iTileRows, 0);
 }
 
-/*
-void CogeImage::UpdateRect(int iSrcLeft, int iSrcTop, int iSrcWidth, int iSrcHeight)
+void CogeLightBuffer::AddLight(CogeImage* pMask, int x, int y)
 {
-    if(m_pSurface)
-    {
-        if(iSrcWidth < 0) iSrcWidth = m_iWidth;
-        if(iSrcHeight < 0) iSrcHeight = m_iHeight;
+    CogeLightSpot spot;
 
-#if SDL_VERSION_ATLEAST(2,0,0)
-        SDL_Rect rect;
-        rect.x = iSrcLeft;
-        rect.y = iSrcTop;
-        rect.w = iSrcWidth;
-        rect.h = iSrcHeight;
-        SDL_UpdateRects(m_pSurface, 1, &rect);
+    spot.pImage = pMask;
+    spot.x = x;
+    spot.y = y;
+    spot.iWidth = pMask->GetWidth();
+    spot.iHeight = pMask->GetHeight();
+    spot.pMask = GetMask(pMask, x - (OGE_LightCell(x) << 2), y - (OGE_LightCell(y) << 2));
 
-#else
-        SDL_UpdateRect(m_pSurface, iSrcLeft, iSrcTop, iSrcWidth, iSrcHeight);
-#endif
-    }
+    m_Spots.push_back(spot);
 }
-*/
 
+void CogeLightBuffer::MarkSpot(const CogeLightSpot& spot)
+{
+    // the cells of the light and the pixels they reach by the upsampling
+    int iLeft = (OGE_LightCell(spot.x) << 2) - 4;
+    int iTop = (OGE_LightCell(spot.y) << 2) - 4;
+    int iRight = (OGE_LightCell(spot.x + spot.iWidth - 1) << 2) + 8;
+    int iBottom = (OGE_LightCell(spot.y + spot.iHeight - 1) << 2) + 8;
 
-void CogeImage::FillRect(int iRGBColor, int iLeft, int iTop, int iWidth, int iHeight)
+    MarkRect(iLeft - m_iViewX, iTop - m_iViewY, iRight - iLeft, iBottom - iTop);
+}
+
+void CogeLightBuffer::End()
 {
-	SDL_Rect rcDst = {0};
+    size_t iCount = m_Spots.size() > m_LastSpots.size() ? m_Spots.size() : m_LastSpots.size();
 
-	int iColor = m_pVideo->FormatColor(iRGBColor);
+    for (size_t i=0; i<iCount; i++)
+    {
+        bool bNew = i < m_Spots.size();
+        bool bOld = i < m_LastSpots.size();
 
-	//int iR = (iRGBColor&0x00ff0000)>>16;
-    //int iG = (iRGBColor&0x0000ff00)>>8;
-    //int iB = iRGBColor&0x000000ff;
-    //int iColor = SDL_MapRGB(m_pSurface->format, iR, iG, iB);
+        if (bNew && bOld)
+        {
+            const CogeLightSpot& a = m_Spots[i];
+            const CogeLightSpot& b = m_LastSpots[i];
 
-	if (iWidth <= 0 && iHeight <= 0)
-        SDL_FillRect(m_pSurface, 0, iColor);
-    else
+            if (a.pImage == b.pImage && a.x == b.x && a.y == b.y && a.iWidth == b.iWidth && a.iHeight == b.iHeight)
+                continue;
+        }
+
+        if (bNew) MarkSpot(m_Spots[i]);
+        if (bOld) MarkSpot(m_LastSpots[i]);
+    }
+
+    // the masks of the lights gone
+    size_t iUsed = 0;
+    for (size_t i=0; i<m_Masks.size(); i++)
     {
-        if (GetValidRect(iLeft, iTop, iWidth, iHeight, &rcDst))
-        SDL_FillRect(m_pSurface, &rcDst, iColor);
+        if (m_Masks[i]->bUsed) m_Masks[iUsed++] = m_Masks[i];
+        else
+        {
+            delete [] m_Masks[i]->pCells;
+            delete m_Masks[i];
+        }
     }
+    m_Masks.resize(iUsed);
 }
 
-bool CogeImage::LoadBMP(const std::string& sFileName, bool bLoadAlphaChannel, bool bCreateLocalClipboard)
+void CogeLightBuffer::Splat()
 {
-    //return false;
-    //SDL_Surface* bmp = m_pVideo->OGE_LoadBMP(sFileName.c_str());
-    SDL_Surface* bmp = SDL_LoadBMP(sFileName.c_str());
-
-    if (!bmp) return false;
+    if (m_bLit) return;
 
-    if (m_pSurface)
+    for (size_t i=0; i<m_Spots.size(); i++)
     {
-        SDL_FreeSurface(m_pSurface);
-        m_pSurface = NULL;
+        CogeLightSpot& spot = m_Spots[i];
+
+        OGE_FX_AddLight(m_pCells, m_iCols, m_iCols, m_iRows,
+                        OGE_LightCell(spot.x) - m_iCellX, OGE_LightCell(spot.y) - m_iCellY,
+                        spot.pMask->pCells, spot.pMask->iCols,
+                        spot.pMask->iCols, spot.pMask->iRows);
     }
 
-    if(bLoadAlphaChannel) m_pSurface = OGE_DisplayFormatAlpha( bmp );
-    else m_pSurface = OGE_DisplayFormat( bmp );
+    m_bLit = true;
+}
 
-    m_bHasAlphaChannel = bLoadAlphaChannel;
-    m_bHasLocalClipboard = m_bHasAlphaChannel && bCreateLocalClipboard;
+void CogeLightBuffer::Blend(CogeImage* pScreen, int iScreenX, int iScreenY)
+{
+    if (m_pCells == NULL) return;
 
-    if(m_pSurface && m_bHasAlphaChannel && m_bHasLocalClipboard)
+    Splat();
+
+    const std::vector<CogeRect>& regions = GetRegions();
+
+    for (size_t i=0; i<regions.size(); i++)
     {
-        if (m_pLocalClipboardA)
-        {
-            SDL_FreeSurface(m_pLocalClipboardA);
-            m_pLocalClipboardA = NULL;
-        }
+        const CogeRect& rc = regions[i];
 
-        m_pLocalClipboardA = OGE_DisplayFormatAlpha( bmp );
+        pScreen->LightBlend(m_pCells, m_iCols, m_iCols, m_iRows,
+                            m_iViewX + rc.left - (m_iCellX << 2), m_iViewY + rc.top - (m_iCellY << 2),
+                            iScreenX + rc.left, iScreenY + rc.top, rc.right - rc.left, rc.bottom - rc.top);
+    }
+}
 
-        if (m_pLocalClipboardB)
-        {
-            SDL_FreeSurface(m_pLocalClipboardB);
-            m_pLocalClipboardB = NULL;
-        }
+void CogeLightBuffer::MarkAll()
+{
+    m_bAllDirty = true;
+}
 
-        m_pLocalClipboardB = OGE_DisplayFormatAlpha( bmp );
+void CogeLightBuffer::MarkRect(int x, int y, int iWidth, int iHeight)
+{
+    if (m_bAllDirty) return;
 
-    }
+    int iRight = x + iWidth;
+    int iBottom = y + iHeight;
 
-    SDL_FreeSurface( bmp );
+    if (x < 0) x = 0;
+    if (y < 0) y = 0;
+    if (iRight > m_iViewWidth) iRight = m_iViewWidth;
+    if (iBottom > m_iViewHeight) iBottom = m_iViewHeight;
 
-    if (!m_pSurface) return false;
-    else return true;
+    if (x >= iRight || y >= iBottom) return;
 
+    for (int j = y / _OGE_LIGHT_TILE_SIZE_; j <= (iBottom - 1) / _OGE_LIGHT_TILE_SIZE_; j++)
+    {
+        uint8_t* pLine = &m_Tiles[j * m_iTileCols];
+        for (int i = x / _OGE_LIGHT_TILE_SIZE_; i <= (iRight - 1) / _OGE_LIGHT_TILE_SIZE_; i++) pLine[i] = 1;
+    }
 }
 
-bool CogeImage::LoadImg(const std::string& sFileName, bool bLoadAlphaChannel, bool bCreateLocalClipboard)
+const std::vector<CogeRect>& CogeLightBuffer::GetRegions()
 {
-    //return false;
+    m_Regions.clear();
 
-    //SDL_RWops *src = SDL_RWFromFile(sFileName.c_str(), "rb");
-    //bool bIsPng = IMG_isPNG(src);
-    //SDL_Surface* img = IMG_Load_RW(src, 1);
+    if (m_bAllDirty)
+    {
+        CogeRect rc;
+        rc.left = 0;
+        rc.top = 0;
+        rc.right = m_iViewWidth;
+        rc.bottom = m_iViewHeight;
 
-    //int iPos = sFileName.find_last_of('.');
-    //if(iPos < 0) return false;
-    //std::string sExt = sFileName.substr(iPos);
-    //bool bIsPng = sExt == ".png";
+        if (rc.right > 0 && rc.bottom > 0) m_Regions.push_back(rc);
 
-//#ifdef __OGE_WITH_SDL2__
-//    if(sFileName.find_last_of(".bmp") > 0)
-//    {
-//        return LoadBMP(sFileName, bLoadAlphaChannel);
-//    }
-//#endif
+        return m_Regions;
+    }
 
-    //SDL_Surface* img = m_pVideo->OGE_LoadIMG(sFileName.c_str());
-    SDL_Surface* img = IMG_Load(sFileName.c_str());
+    // the runs of dirty tiles of each row, a run goes on a region of the row above if they have the same columns
+    size_t iRowStart = 0;
 
-    if(img)
+    for (int j=0; j<m_iTileRows; j++)
     {
-        if (m_pSurface)
-        {
-            SDL_FreeSurface(m_pSurface);
-            m_pSurface = NULL;
-        }
+        size_t iLastRowStart = iRowStart;
+        size_t iLastRowEnd = m_Regions.size();
 
-        if(bLoadAlphaChannel) m_pSurface = OGE_DisplayFormatAlpha( img );
-        else m_pSurface = OGE_DisplayFormat( img );
+        iRowStart = m_Regions.size();
 
-        m_bHasAlphaChannel = bLoadAlphaChannel;
-        m_bHasLocalClipboard = m_bHasAlphaChannel && bCreateLocalClipboard;
+        uint8_t* pLine = &m_Tiles[j * m_iTileCols];
 
-        if(m_pSurface && m_bHasAlphaChannel && m_bHasLocalClipboard)
+        int i = 0;
+        while (i < m_iTileCols)
         {
-            //uint8_t* pDst = (Uint8 *)m_pSurface->pixels;
-            //int iDstLineSize = m_pSurface->pitch;
-            //OGE_FX_UpdateAlpha(pDst, iDstLineSize, 0, 0, m_pSurface->w, m_pSurface->h, 32, -192);
+            if (!pLine[i]) { i++; continue; }
 
-            if (m_pLocalClipboardA)
-            {
-                SDL_FreeSurface(m_pLocalClipboardA);
-                m_pLocalClipboardA = NULL;
-            }
+            int iFrom = i;
+            while (i < m_iTileCols && pLine[i]) i++;
 
-            m_pLocalClipboardA = OGE_DisplayFormatAlpha( img );
+            CogeRect rc;
+            rc.left = iFrom * _OGE_LIGHT_TILE_SIZE_;
+            rc.top = j * _OGE_LIGHT_TILE_SIZE_;
+            rc.right = i * _OGE_LIGHT_TILE_SIZE_;
+            rc.bottom = (j + 1) * _OGE_LIGHT_TILE_SIZE_;
 
-            if (m_pLocalClipboardB)
-            {
-                SDL_FreeSurface(m_pLocalClipboardB);
-                m_pLocalClipboardB = NULL;
-            }
+            if (rc.right > m_iViewWidth) rc.right = m_iViewWidth;
+            if (rc.bottom > m_iViewHeight) rc.bottom = m_iViewHeight;
 
-            m_pLocalClipboardB = OGE_DisplayFormatAlpha( img );
+            bool bMerged = false;
 
-        }
+            for (size_t k=iLastRowStart; k<iLastRowEnd; k++)
+            {
+                CogeRect& last = m_Regions[k];
+                if (last.left == rc.left && last.right == rc.right && last.bottom == rc.top)
+                {
+                    last.bottom = rc.bottom;
 
-        SDL_FreeSurface(img);
+                    // it now ends on this row
+                    CogeRect merged = last;
+                    m_Regions.erase(m_Regions.begin() + k);
+                    iLastRowEnd--;
+                    iRowStart--;
+                    m_Regions.push_back(merged);
 
-        if (m_pSurface) return true;
-        else
-        {
-            OGE_Log("Could not convert image bbp format %s: %s\n", sFileName.c_str(), SDL_GetError());
-            return false;
+                    bMerged = true;
+                    break;
+                }
+            }
+
+            if (!bMerged) m_Regions.push_back(rc);
         }
     }
-    else
-    {
-        OGE_Log("Can not load image %s from file: %s, reason: %s\n", m_sName.c_str(), sFileName.c_str(), SDL_GetError());
-        return false;
-    }
 
+    return m_Regions;
 }
 
-bool CogeImage::LoadImgFromBuffer(char* pBuffer, int iBufferSize, bool bLoadAlphaChannel, bool bCreateLocalClipboard)
+// the kinds of the recorded draws (the kernel each one goes through)
+#define _OGE_TILE_CMD_COPY_           0
+#define _OGE_TILE_CMD_KEY_            1
+#define _OGE_TILE_CMD_PREMULTIPLIED_  2
+#define _OGE_TILE_CMD_SPANS_          3
+#define _OGE_TILE_CMD_INDEXED_        4
+
+CogeTileRenderer::CogeTileRenderer():
+m_pScreen(NULL),
+m_pDstData(NULL),
+m_iDstLineSize(0),
+m_iAreaX(0),
+m_iAreaY(0),
+m_iAreaWidth(0),
+m_iAreaHeight(0),
+m_iTileSize(64),
+m_iTileCols(0),
+m_iTileRows(0)
 {
-    SDL_Surface* img = IMG_Load_RW(SDL_RWFromMem((void*)pBuffer, iBufferSize), 0);
+}
 
-    if(img)
+CogeTileRenderer::~CogeTileRenderer()
+{
+    m_Commands.clear();
+    m_Bins.clear();
+}
+
+void CogeTileRenderer::Begin(CogeImage* pScreen, int iAreaX, int iAreaY, int iAreaWidth, int iAreaHeight, int iTileSize)
+{
+    Flush();
+
+    m_pScreen = pScreen;
+
+    if (m_pScreen == NULL || iTileSize <= 0) return;
+
+    // the area must be on the screen
+    if (iAreaX < 0) { iAreaWidth += iAreaX; iAreaX = 0; }
+    if (iAreaY < 0) { iAreaHeight += iAreaY; iAreaY = 0; }
+    if (iAreaX + iAreaWidth > m_pScreen->m_iWidth) iAreaWidth = m_pScreen->m_iWidth - iAreaX;
+    if (iAreaY + iAreaHeight > m_pScreen->m_iHeight) iAreaHeight = m_pScreen->m_iHeight - iAreaY;
+
+    if (iAreaWidth <= 0 || iAreaHeight <= 0)
     {
-        if (m_pSurface)
-        {
-            SDL_FreeSurface(m_pSurface);
-            m_pSurface = NULL;
-        }
+        m_pScreen = NULL;
+        return;
+    }
 
-        if(bLoadAlphaChannel) m_pSurface = OGE_DisplayFormatAlpha( img );
-        else m_pSurface = OGE_DisplayFormat( img );
+    m_iAreaX = iAreaX;
+    m_iAreaY = iAreaY;
+    m_iAreaWidth = iAreaWidth;
+    m_iAreaHeight = iAreaHeight;
 
-        m_bHasAlphaChannel = bLoadAlphaChannel;
-        m_bHasLocalClipboard = m_bHasAlphaChannel && bCreateLocalClipboard;
+    m_iTileSize = iTileSize;
+    m_iTileCols = (iAreaWidth + iTileSize - 1) / iTileSize;
+    m_iTileRows = (iAreaHeight + iTileSize - 1) / iTileSize;
 
-        if(m_pSurface && m_bHasAlphaChannel && m_bHasLocalClipboard)
-        {
-            if (m_pLocalClipboardA)
-            {
-                SDL_FreeSurface(m_pLocalClipboardA);
-                m_pLocalClipboardA = NULL;
-            }
+    // the bins keep their memory from frame to frame
+    if ((int)m_Bins.size() < m_iTileCols * m_iTileRows) m_Bins.resize(m_iTileCols * m_iTileRows);
+}
 
-            m_pLocalClipboardA = OGE_DisplayFormatAlpha( img );
+bool CogeTileRenderer::Add(CogeImage* pSrcImage, int iDstX, int iDstY, int iSrcX, int iSrcY, int iWidth, int iHeight)
+{
+    if (m_pScreen == NULL || pSrcImage == NULL || pSrcImage == m_pScreen) return false;
 
-            if (m_pLocalClipboardB)
-            {
-                SDL_FreeSurface(m_pLocalClipboardB);
-                m_pLocalClipboardB = NULL;
-            }
+    CogeDrawCommand cmd;
 
-            m_pLocalClipboardB = OGE_DisplayFormatAlpha( img );
-        }
+    if (pSrcImage->m_pSpans) cmd.iType = _OGE_TILE_CMD_SPANS_;
+    else if (pSrcImage->m_pIndexed) cmd.iType = _OGE_TILE_CMD_INDEXED_;
+    else
+    {
+        SDL_Surface* pSurface = pSrcImage->m_pSurface;
 
-        SDL_FreeSurface(img);
+        if (pSurface == NULL || SDL_MUSTLOCK(pSurface) || pSrcImage->m_iBPP != m_pScreen->m_iBPP) return false;
 
-        if (m_pSurface) return true;
-        else
-        {
-            OGE_Log("Could not convert image bbp format: %s\n", SDL_GetError());
-            return false;
-        }
+        if (pSrcImage->m_bPremultiplied && m_pScreen->m_iBPP == 32 && pSrcImage->PremultiplyAlpha()) cmd.iType = _OGE_TILE_CMD_PREMULTIPLIED_;
+        else if (pSrcImage->m_bHasAlphaChannel) return false; // sdl does the normal alpha
+        else if (pSrcImage->m_iColorKey == -1) cmd.iType = _OGE_TILE_CMD_COPY_;
+        else cmd.iType = _OGE_TILE_CMD_KEY_;
     }
-    else
+
+    // the same as Draw() does
+    if (pSrcImage->m_iAlpha >= 0)
     {
-        OGE_Log("Couldn't load image from buffer: %s\n", SDL_GetError());
-        return false;
+        if (pSrcImage->m_pSurface) OGE_SetAlpha(pSrcImage->m_pSurface, 0, 0);
+        pSrcImage->m_iAlpha = -1;
     }
 
-}
+    SDL_Rect rcSrc = {0};
+    if (!pSrcImage->ClipRect(iSrcX, iSrcY, iWidth, iHeight, &rcSrc)) return true;
+
+    // clipped to the area
+    int x = iDstX;
+    int y = iDstY;
+    int w = rcSrc.w;
+    int h = rcSrc.h;
+
+    if (x < m_iAreaX) { rcSrc.x += m_iAreaX - x; w -= m_iAreaX - x; x = m_iAreaX; }
+    if (y < m_iAreaY) { rcSrc.y += m_iAreaY - y; h -= m_iAreaY - y; y = m_iAreaY; }
+    if (x + w > m_iAreaX + m_iAreaWidth) w = m_iAreaX + m_iAreaWidth - x;
+    if (y + h > m_iAreaY + m_iAreaHeight) h = m_iAreaY + m_iAreaHeight - y;
+
+    if (w <= 0 || h <= 0) return true;
+
+    cmd.pImage = pSrcImage;
+    cmd.iDstX = x;
+    cmd.iDstY = y;
+    cmd.iSrcX = rcSrc.x;
+    cmd.iSrcY = rcSrc.y;
+    cmd.iWidth = w;
+    cmd.iHeight = h;
+
+    int iIndex = m_Commands.size();
+    m_Commands.push_back(cmd);
+
+    int iFirstCol = (x - m_iAreaX) / m_iTileSize;
+    int iLastCol = (x + w - 1 - m_iAreaX) / m_iTileSize;
+    int iFirstRow = (y - m_iAreaY) / m_iTileSize;
+    int iLastRow = (y + h - 1 - m_iAreaY) / m_iTileSize;
+
+    for (int j = iFirstRow; j <= iLastRow; j++)
+    {
+        for (int i = iFirstCol; i <= iLastCol; i++) m_Bins[j * m_iTileCols + i].push_back(iIndex);
+    }
 
-bool CogeImage::LoadData(const std::string& sFileName, bool bLoadAlphaChannel, bool bCreateLocalClipboard)
-{
-    return LoadImg(sFileName, bLoadAlphaChannel, bCreateLocalClipboard);
+    return true;
 }
 
-bool CogeImage::LoadDataFromBuffer(char* pBuffer, int iBufferSize, bool bLoadAlphaChannel, bool bCreateLocalClipboard)
+void CogeTileRenderer::DrawTiles(void* pTask, int iFromTile, int iToTile)
 {
-    return LoadImgFromBuffer(pBuffer, iBufferSize, bLoadAlphaChannel, bCreateLocalClipboard);
-}
+    CogeTileRenderer* pRenderer = (CogeTileRenderer*) pTask;
+
+    int iSize = pRenderer->m_iTileSize;
+    int iBPP = pRenderer->m_pScreen->m_iBPP;
+
+    for (int t = iFromTile; t < iToTile; t++)
+    {
+        const std::vector<int>& bin = pRenderer->m_Bins[t];
+
+        if (bin.empty()) continue;
+
+        int iTileLeft = pRenderer->m_iAreaX + (t % pRenderer->m_iTileCols) * iSize;
+        int iTileTop = pRenderer->m_iAreaY + (t / pRenderer->m_iTileCols) * iSize;
+        int iTileRight = iTileLeft + iSize;
+        int iTileBottom = iTileTop + iSize;
+
+        for (size_t k = 0; k < bin.size(); k++)
+        {
+            const CogeDrawCommand& cmd = pRenderer->m_Commands[bin[k]];
+
+            // the part of the command in the tile
+            int x = cmd.iDstX > iTileLeft ? cmd.iDstX : iTileLeft;
+            int y = cmd.iDstY > iTileTop ? cmd.iDstY : iTileTop;
+            int r = cmd.iDstX + cmd.iWidth < iTileRight ? cmd.iDstX + cmd.iWidth : iTileRight;
+            int b = cmd.iDstY + cmd.iHeight < iTileBottom ? cmd.iDstY + cmd.iHeight : iTileBottom;
+
+            if (r <= x || b <= y) continue;
 
+            int iSrcX = cmd.iSrcX + x - cmd.iDstX;
+            int iSrcY = cmd.iSrcY + y - cmd.iDstY;
 
+            CogeImage* pImage = cmd.pImage;
+            SDL_Surface* pSurface = pImage->m_pSurface;
 
+            switch (cmd.iType)
+            {
+            case _OGE_TILE_CMD_COPY_:
+                OGE_FX_CopyRect(pRenderer->m_pDstData, pRenderer->m_iDstLineSize, x, y,
+                                (uint8_t*)pSurface->pixels, pSurface->pitch, iSrcX, iSrcY,
+                                r - x, b - y, iBPP);
+            break;
 
+            case _OGE_TILE_CMD_KEY_:
+                OGE_FX_Blt(pRenderer->m_pDstData, pRenderer->m_iDstLineSize, x, y,
+                           (uint8_t*)pSurface->pixels, pSurface->pitch, pImage->m_iColorKey, iSrcX, iSrcY,
+                           r - x, b - y, iBPP);
+            break;
 
+            case _OGE_TILE_CMD_PREMULTIPLIED_:
+                pSurface = pImage->m_pPremultiplied;
+                OGE_FX_BltPremultiplied(pRenderer->m_pDstData, pRenderer->m_iDstLineSize, x, y,
+                                        (uint8_t*)pSurface->pixels, pSurface->pitch, iSrcX, iSrcY,
+                                        r - x, b - y, 32, pSurface->format->Ashift, 255);
+            break;
 
+            case _OGE_TILE_CMD_SPANS_:
+                OGE_FX_SpanBlt(pRenderer->m_pDstData, pRenderer->m_iDstLineSize, x, y,
+                               pImage->m_pSpans, iSrcX, iSrcY, r - x, b - y);
+            break;
 
+            case _OGE_TILE_CMD_INDEXED_:
+                OGE_FX_IndexedBlt(pRenderer->m_pDstData, pRenderer->m_iDstLineSize, x, y,
+                                  pImage->m_pIndexed, pImage->m_pPalette, iSrcX, iSrcY, r - x, b - y);
+            break;
+            }
+        }
+    }
+}
 
+void CogeTileRenderer::Flush()
+{
+    if (m_Commands.empty()) return;
 
+    if (m_pScreen && m_pScreen->PrepareRawData(true))
+    {
+        m_pScreen->BeginUpdate();
 
+        m_pDstData = (uint8_t*) m_pScreen->m_pSurface->pixels;
+        m_iDstLineSize = m_pScreen->m_pSurface->pitch;
 
+        int iTiles = m_iTileCols * m_iTileRows;
 
+        if (!OGE_FX_RunBands(CogeTileRenderer::DrawTiles, this, iTiles)) DrawTiles(this, 0, iTiles);
 
+        m_pScreen->EndUpdate();
 
+        m_pDstData = NULL;
+    }
 
+    for (size_t i=0; i<m_Bins.size(); i++) m_Bins[i].clear();
+    m_Commands.clear();
+}
 
+int CogeTileRenderer::GetCommandCount()
+{
+    return m_Commands.size();
+}
@@ -45,6 +45,10 @@ THE SOFTWARE.
 
 #define _OGE_FONT_DF_CHARSET_        "UTF-8"
 
+#define _OGE_MAX_CACHED_EFFECTS_     8
+
+#define _OGE_LIGHT_TILE_SIZE_        16
+
 // pure 2d rendering will always use software surfaces ...
 
 #ifndef __OGE_WITH_SDL2__
@@ -61,13 +65,49 @@ THE SOFTWARE.
 #endif
 #endif
 
+/* a high resolution clock for the timing of the frames (the performance counter of sdl2, the ms ticks with sdl 1.2) */
+Uint64 OGE_GetPerfCounter();
+Uint64 OGE_GetPerfFrequency();
+/* waits until the clock reaches iCounter, it sleeps while it is far and spins for the last ms */
+void OGE_WaitPerfCounter(Uint64 iCounter);
+
 
 /*================== Classes ===============================*/
 
 class CogeImage;
 class CogeDotFont;
 
+struct CogeFXSpans;
+struct CogeFXIndexed;
+struct CogeFXColorTransform;
+
 typedef std::map<std::string, CogeImage*> ogeImageMap;
+typedef std::map<std::string, SDL_Surface*> ogeAtlasMap;
+
+// a frame of an image with a list of effects (the values are quantized by the caller)
+struct CogeFrameCacheKey
+{
+    CogeImage* pImage;
+    int iLeft;
+    int iTop;
+    int iWidth;
+    int iHeight;
+    int iEffectCount;
+    int iEffectTypes[_OGE_MAX_CACHED_EFFECTS_];
+    int iEffectValues[_OGE_MAX_CACHED_EFFECTS_];
+
+    bool operator<(const CogeFrameCacheKey& other) const;
+};
+
+struct CogeFrameCacheItem
+{
+    CogeFrameCacheKey key;
+    CogeImage* pFrame;
+    int iBytes;
+};
+
+typedef std::list<CogeFrameCacheItem> ogeFrameCacheList;
+typedef std::map<CogeFrameCacheKey, ogeFrameCacheList::iterator> ogeFrameCacheMap;
 
 
 /*---------------- Video -----------------*/
@@ -111,6 +151,19 @@ private:
     CogeImage*         m_pClipboardB;
     CogeImage*         m_pClipboardC;
 
+    CogeFXColorTransform* m_pColorTransform;
+
+    ogeFrameCacheList  m_FrameCacheList; // the most recently used one is the first
+    ogeFrameCacheMap   m_FrameCacheMap;
+    int                m_iFrameCacheSize;
+    int                m_iFrameCacheBytes;
+    int                m_iFrameCacheHits;
+    int                m_iFrameCacheMisses;
+
+    int                m_iConvertedImages;    // by the fx converters
+    int                m_iSDLConvertedImages; // the formats which they do not support
+    double             m_fConvertTime;        // ms
+
     CogeDotFont*       m_pDotFont;    // default font for video
 
     CogeFontStock*     m_pFontStock;
@@ -118,6 +171,8 @@ private:
     CogeFont*          m_pDefaultFont;
 
     ogeImageMap        m_ImageMap;
+
+    ogeAtlasMap        m_AtlasMap; // the sheets of the atlas images, by file name
     //ogeAnimaMap        m_AnimaMap;
 
     SDL_Rect           m_ViewRect;
@@ -159,11 +214,55 @@ private:
 
     int  m_iFrameInterval;
 
+    Uint64 m_iFrameTicks;        // the locked frame interval in the ticks of OGE_GetPerfCounter()
+    Uint64 m_iNextFrameCounter;  // when the next frame is due
+
+    int  m_iColorKeySpans;
+
+    int  m_iIndexedImages;
+
+    bool m_bPremultipliedAlpha;
+
+    bool m_bSmoothRotation;
+
+    bool m_bSmoothScaling;
+
+    int  m_iPresentFilter;
+
+    std::vector<CogeRect> m_UpdateRects; // the changed regions of the main screen for the next upload
+    bool m_bPartialUpdate;               // false: the whole view is uploaded
+    int  m_iLastUploadX;                 // the view in the texture, -1 if it is not known
+    int  m_iLastUploadY;
+    int  m_iUploadBytes;
+
+    bool m_bDirectScreen;
+    bool m_bScreenLost;            // the direct screen has been lost, the main screen has to be drawn again
+    SDL_Surface* m_pScreenSurface; // the own surface of the default screen while it is in the texture
+
+    SDL_Thread* m_pPresentThread;
+    SDL_sem*    m_pPresentStart;
+    SDL_sem*    m_pPresentDone;
+    volatile bool m_bQuitPresent;
+    bool     m_bPresentPending;  // a frame has been given to the present thread and it is not shown yet
+    uint8_t* m_pPresentPixels;   // the locked texture which the present thread draws the frame into
+    int      m_iPresentPitch;
+
 
     void DelAllImages();
 
+    void DelFrameCacheItem(ogeFrameCacheList::iterator it);
+
     void SetView(int x, int y);
 
+    bool MapScreen();
+    void UnmapScreen();
+
+    static int PresentThreadProc(void* pData);
+    bool StartPresent();
+    void StopPresentThread();
+    void DrawFrame();  // draws the view of the main screen for the window (stretched or copied)
+    void ShowFrame();  // shows what DrawFrame() has drawn
+
     int CheckSystemScreenSize(int iRequiredWidth, int iRequiredHeight, int iRequiredBPP);
 
 
@@ -236,6 +335,9 @@ public:
     CogeImage* GetClipboardB();
     CogeImage* GetClipboardC();
 
+    // a shared chain of color adjustments for the effects of a single draw
+    CogeFXColorTransform* GetColorTransform();
+
     CogeImage* GetDefaultBg();
     void ClearDefaultBg(int iRGBColor = -1);
 
@@ -246,8 +348,85 @@ public:
     int GetLockedFPS();
     void LockFPS(int iFPS);
     void UnlockFPS();
+    // when the next frame will be shown (see OGE_GetPerfCounter()), 0 if the fps is not locked
+    Uint64 GetNextFrameCounter();
     bool IsFPSChanged();
 
+    int SetFXThreads(int iThreads, int iMinPixels = 0);
+    int GetFXThreads();
+
+    // 0 = off, 1 = build the color key spans of the images loaded with a color key, 2 = also drop their raw data
+    void SetColorKeySpans(int iMode);
+    int GetColorKeySpans();
+
+    // 0: off, 1: the loaded images of up to 256 colors get indexed pixels, 2: and their surfaces are freed
+    void SetIndexedImages(int iMode);
+    int GetIndexedImages();
+
+    // premultiply the images loaded with an alpha channel (32 bpp screen only), see CogeImage::IsPremultiplied()
+    void SetPremultipliedAlpha(bool bEnable);
+    bool GetPremultipliedAlpha();
+
+    // bilinear sampling for BltRotate() and BltRotozoom()
+    void SetSmoothRotation(bool bEnable);
+    bool GetSmoothRotation();
+
+    // bilinear (area averaging to shrink) scaling for BltFused() and the scale effect of the animations
+    void SetSmoothScaling(bool bEnable);
+    bool GetSmoothScaling();
+
+    // the scaler of the screen when the window is bigger than it (see _OGE_FX_PRESENT_NEAREST_ ...)
+    void SetPresentFilter(int iFilter);
+    int GetPresentFilter();
+
+    /* the regions of the main screen (in its coords) which have changed since the last frame,
+       the next Update() only uploads them to the texture of the window (an empty list skips the upload),
+       without them (or if the view has moved) the whole view is uploaded
+    */
+    void SetUpdateRects(const std::vector<CogeRect>& rects);
+    // the bytes which the last frame uploaded to the texture of the window
+    int GetUploadBytes();
+
+    /* the default screen is drawn straight into the locked texture of the window, so the frames are not copied
+       into it, only with the renderers which keep the pixels of a streaming texture between the locks
+    */
+    void SetDirectScreen(bool bEnable);
+    bool GetDirectScreen();
+    bool IsScreenLost(); // (it is reset by the call)
+
+    /* the frame is drawn for the window (stretched or copied into the texture) on a thread of its own,
+       while the next frame is being updated, it is shown by the next WaitPresent() or PollPresent(),
+       the main screen must not be drawn on before WaitPresent() (GetScreen() and the scene call it)
+    */
+    void SetPresentThread(bool bEnable);
+    bool GetPresentThread();
+    // waits for the frame on the present thread and shows it, does nothing if there is none
+    void WaitPresent();
+    // shows the frame if the present thread is done with it, without waiting
+    void PollPresent();
+
+    // the memory (in KB) for the transformed frames of the animations, 0 = off,
+    // the least recently used frames go first when it is full
+    void SetFrameCacheSize(int iKBytes);
+    int GetFrameCacheSize();
+    int GetFrameCacheHits();
+    int GetFrameCacheMisses();
+    void ClearFrameCache();
+
+    // returns NULL if the frame is not in the cache
+    CogeImage* FindCachedFrame(const CogeFrameCacheKey& key);
+    // returns an empty frame (filled with the color key if there is one) to be drawn, NULL if it does not fit
+    CogeImage* NewCachedFrame(const CogeFrameCacheKey& key, int iWidth, int iHeight, int iColorKeyRGB);
+    // drops the frames of an image (when it is changed or deleted)
+    void DelCachedFrames(CogeImage* pImage);
+
+    /* converts a loaded image into the format of the screen (or into the 32 bpp alpha format which goes with it),
+       so the image is never converted again when it is drawn, returns NULL if it fails (the src is kept)
+    */
+    SDL_Surface* ConvertImage(SDL_Surface* pSurface, bool bAlphaChannel);
+    int GetConvertedImages();
+    double GetConvertTime();
+
     bool IsBGRAMode();
 
     bool GetFullScreen();
@@ -285,6 +464,20 @@ public:
                         bool bLoadAlphaChannel = false, bool bCreateLocalClipboard = false,
                         char* pBuffer = NULL, int iBufferSize = 0);
 
+    // atlas images: the small images which the pack tool has put together in sheets,
+    // a sheet is loaded once and its images only point into its pixels (until one of them is changed).
+    // LoadAtlas() loads the sheet from the file, or from the buffer if there is one.
+    SDL_Surface* FindAtlas(const std::string& sFileName);
+    SDL_Surface* LoadAtlas(const std::string& sFileName, bool bLoadAlphaChannel,
+                        char* pBuffer = NULL, int iBufferSize = 0);
+    // frees the sheets which have no image on them any more
+    void FreeUnusedAtlases();
+
+    CogeImage* NewImageFromAtlas(const std::string& sName,
+                        int iWidth, int iHeight, int iColorKeyRGB,
+                        bool bLoadAlphaChannel, bool bCreateLocalClipboard,
+                        SDL_Surface* pAtlas, int iAtlasX, int iAtlasY);
+
     CogeImage* FindImage(const std::string& sName);
 
     CogeImage* GetImage(const std::string& sName,
@@ -379,6 +572,13 @@ private:
     SDL_Surface*       m_pLocalClipboardB;
     SDL_Surface*       m_pCurrentClipboard;
 
+    CogeFXSpans*       m_pSpans;
+
+    CogeFXIndexed*     m_pIndexed;
+    uint8_t*           m_pPalette; // the current palette of the indexed pixels
+
+    SDL_Surface*       m_pAtlas;   // the sheet which the pixels of m_pSurface belong to (atlas images only)
+
     CogeVideo*         m_pVideo;
 
     CogeDotFont*       m_pDotFont;
@@ -400,9 +600,13 @@ private:
 
     bool m_bHasAlphaChannel;
     bool m_bHasLocalClipboard;
+    bool m_bPremultiplied;
+    SDL_Surface* m_pPremultiplied; // the copy of the pixels for the premultiplied blend, NULL until it is drawn again after a change
 
     int m_iEffectCount;
 
+    int m_iCachedFrames; // the frames of the image in the frame cache of the video
+
     int m_iPenColor;
 
     int m_iPenColorRGB;
@@ -427,6 +631,7 @@ private:
     //void GetValidRect(RECT& SrcRc, RECT& DstRc);
 
     bool GetValidRect(int x, int y, int w, int h, SDL_Rect* rslrc);
+    bool ClipRect(int x, int y, int w, int h, SDL_Rect* rslrc);
     bool GetValidRect(int x, int y, SDL_Rect* rcRslSrc, SDL_Rect* rcRslDst);
     void GetValidRect(CogeRect* rslrc);
 
@@ -436,6 +641,33 @@ private:
 
     bool LoadImgFromBuffer(char* pBuffer, int iBufferSize, bool bLoadAlphaChannel = false, bool bCreateLocalClipboard = false);
 
+    // the surface becomes a part of the sheet (no pixels are copied)
+    bool LoadAtlasRect(SDL_Surface* pAtlas, int iAtlasX, int iAtlasY, int iWidth, int iHeight,
+                       bool bLoadAlphaChannel = false, bool bCreateLocalClipboard = false);
+
+    // gives the image its own copy of the pixels before they are changed, so the sheet stays as it is
+    void DetachAtlas();
+
+    // frees the sheet (not the surface)
+    void ReleaseAtlas();
+
+    // brings the raw data back if it was dropped or premultiplied, and frees the spans (and the indexed pixels) if the image is going to be changed
+    bool PrepareRawData(bool bForWriting = false);
+
+    // frees the indexed pixels and the palette (without bringing the raw data back)
+    void ClearIndexed();
+
+    // the palette has been changed
+    void UpdatePalette();
+
+    bool PremultiplyAlpha();
+    void FreePremultiplied();
+
+    // returns false if the source is not premultiplied (or the target is not 32 bpp), then the caller should draw it by itself
+    bool DrawPremultiplied(CogeImage* pSrcImage, int iAlpha,
+                int iDstLeft, int iDstTop,
+                int iSrcLeft, int iSrcTop, int iSrcWidth, int iSrcHeight);
+
 
 
 protected:
@@ -460,6 +692,11 @@ public:
     bool HasAlphaChannel();
     bool HasLocalClipboard();
 
+    // a premultiplied image keeps a copy of its pixels with the colors multiplied by the alpha channel,
+    // Draw() and BltAlphaBlend() blend that copy with its own fx kernel (the global alpha works with the per-pixel one then),
+    // the other uses of the image read its normal pixels, a change of them drops the copy until it is drawn again.
+    bool IsPremultiplied();
+
     //int GetTotalUsers();
 
     int GetPenColor();
@@ -480,6 +717,31 @@ public:
     void Hire();
     void Fire();
 
+    // color key spans (run-length encoded opaque pixels) for the images which are only drawn on others,
+    // the blits of the image skip the transparent pixels at once.
+    // bDropRawData frees the surface too, it comes back by itself when the image is needed as a surface.
+    // the spans are freed when the image is changed.
+    bool BuildSpans(bool bDropRawData = false);
+    void FreeSpans();
+    bool HasSpans();
+    int GetSpansSize();
+
+    // 8 bit indexed pixels and a palette (up to 256 colors) for the images which are only drawn on others,
+    // the blits of the image look the colors up in the palette, so the colors can be swapped without touching the pixels,
+    // and the effects of the blits (lightness, rgb, color) are done on the palette only.
+    // bDropRawData frees the surface too (see BuildSpans()), the indexed pixels are freed when the image is changed.
+    bool BuildIndexed(bool bDropRawData = false);
+    void FreeIndexed();
+    bool IsIndexed();
+    int GetIndexedSize();
+
+    // the palette (the color key is not one of the colors which can be changed), the colors are rgb
+    int GetPaletteSize();
+    int GetPaletteColor(int iIndex);
+    bool SetPaletteColor(int iIndex, int iRGBColor);
+    int FindPaletteColor(int iRGBColor); // looks it up in the original palette, -1 if not found
+    void ResetPalette();
+
     bool LoadData(const std::string& sFileName, bool bLoadAlphaChannel = false, bool bCreateLocalClipboard = false);
 
     bool LoadDataFromBuffer(char* pBuffer, int iBufferSize, bool bLoadAlphaChannel = false, bool bCreateLocalClipboard = false);
@@ -541,6 +803,9 @@ public:
     void ChangeColorRGB(int iDstX, int iDstY, int iWidth, int iHeight,
                       int iRedAmount, int iGreenAmount, int iBlueAmount);
 
+    // runs a chain of color adjustments (see OGE_FX_NewColorTransform()) in one pass
+    void ColorTransform(CogeFXColorTransform* pTransform, int iDstX, int iDstY, int iWidth, int iHeight);
+
 
     void BltAlphaBlend( CogeImage* pSrcImage, int iAlpha,
                         int iDstLeft, int iDstTop,
@@ -562,9 +827,26 @@ public:
                         int iDstLeft, int iDstTop,
                         int iSrcLeft=0, int iSrcTop=0, int iSrcWidth=-1, int iSrcHeight=-1 );
 
+    void BltColorTransform( CogeImage* pSrcImage, CogeFXColorTransform* pTransform,
+                        int iDstLeft, int iDstTop,
+                        int iSrcLeft=0, int iSrcTop=0, int iSrcWidth=-1, int iSrcHeight=-1 );
+
+    // rotates (a dst rect of the src size) or stretches src, changes the colors and blends it in one pass (see OGE_FX_BltFused()),
+    // returns false if the images can not do it (then nothing is drawn)
+    bool BltFused( CogeImage* pSrcImage, double fAngle, CogeFXColorTransform* pTransform, int iAlpha,
+                        int iDstLeft, int iDstTop, int iDstWidth, int iDstHeight,
+                        int iSrcLeft, int iSrcTop, int iSrcWidth, int iSrcHeight );
+
     void LightMaskBlend( CogeImage* pSrcImage, int iDstLeft, int iDstTop,
                         int iSrcLeft=0, int iSrcTop=0, int iSrcWidth=-1, int iSrcHeight=-1 );
 
+    // averages the image (a light mask) into the cells of a light buffer (see OGE_FX_DownsampleLight())
+    bool DownsampleLight( uint8_t* pLightData, int iLightLineSize, int iPhaseX, int iPhaseY, int iOutside );
+
+    // darkens a rect by a light buffer upsampled x4, (iLightX, iLightY) is the pixel of the light buffer at (iDstLeft, iDstTop)
+    void LightBlend( uint8_t* pLightData, int iLightLineSize, int iLightCols, int iLightRows, int iLightX, int iLightY,
+                     int iDstLeft, int iDstTop, int iWidth, int iHeight );
+
     void BltMask( CogeImage* pSrcImage, CogeImage* pMaskImage, int iDstLeft, int iDstTop,
                   int iSrcLeft=0, int iSrcTop=0, int iMaskLeft=0, int iMaskTop=0,
                   int iSrcWidth=-1, int iSrcHeight=-1 );
@@ -595,6 +877,13 @@ public:
                 int iDstLeft, int iDstTop,
                 int iSrcLeft, int iSrcTop, int iSrcWidth, int iSrcHeight);
 
+    // builds the wave tables of the image (as the source of BltWave()) for a range of steps,
+    // so an animated wave effect does not have to build them while it is running
+    void PrepareWave(double iXAmount, double iYAmount, double iZAmount,
+                int iFromXSteps, int iToXSteps, int iFromYSteps, int iToYSteps);
+
+    void PrepareWave(int iFromAmount, int iToAmount);
+
 
     //constructor
     explicit CogeImage(const std::string& sName);
@@ -605,6 +894,159 @@ public:
 
     friend class CogeVideo;
     friend class CogeAnima;
+    friend class CogeTileRenderer;
+
+};
+
+// the light of a scene at a quarter of the resolution, a darkness byte per 4x4 pixels (see OGE_FX_LightBlend()),
+// the positions of the lights are in the pixels of the light space (the map or the view), the cells are aligned to 4 of them,
+// the dirty tiles of the view are the parts to light (and to redraw before) in the frame
+class CogeLightBuffer
+{
+private:
+
+    // a light mask downsampled at a phase (the position of the mask in its first cell)
+    struct CogeLightMask
+    {
+        CogeImage*  pImage;
+        std::string sName;
+        int iWidth;
+        int iHeight;
+        int iPhaseX;
+        int iPhaseY;
+        int iCols;
+        int iRows;
+        uint8_t* pCells;
+        bool bUsed;
+    };
+
+    struct CogeLightSpot
+    {
+        CogeImage* pImage;
+        CogeLightMask* pMask;
+        int x;
+        int y;
+        int iWidth;
+        int iHeight;
+    };
+
+    CogeImage*  m_pBase;
+    std::string m_sBaseName;
+    uint8_t*    m_pBaseCells;
+    int         m_iBaseCols;
+    int         m_iBaseRows;
+
+    uint8_t*    m_pCells;
+    int         m_iCols;
+    int         m_iRows;
+    int         m_iCellX; // the cell of the first column in the light space
+    int         m_iCellY;
+    bool        m_bLit;
+
+    int         m_iViewX;
+    int         m_iViewY;
+    int         m_iViewWidth;
+    int         m_iViewHeight;
+
+    std::vector<CogeLightSpot>  m_Spots;
+    std::vector<CogeLightSpot>  m_LastSpots;
+    std::vector<CogeLightMask*> m_Masks;
+
+    std::vector<uint8_t>  m_Tiles;
+    int                   m_iTileCols;
+    int                   m_iTileRows;
+    bool                  m_bAllDirty;
+    std::vector<CogeRect> m_Regions;
+
+    CogeLightMask* GetMask(CogeImage* pImage, int iPhaseX, int iPhaseY);
+    void MarkSpot(const CogeLightSpot& spot);
+
+public:
+
+    // starts a frame, the base light is pBase (at the origin of the light space) and the view is at (iViewX, iViewY) of it
+    void Begin(CogeImage* pBase, int iViewX, int iViewY, int iViewWidth, int iViewHeight);
+    // a light mask with its top left at (x, y) of the light space
+    void AddLight(CogeImage* pMask, int x, int y);
+    // marks the tiles of the lights which are not the same as the last frame
+    void End();
+    // lights the cells with the lights of the frame
+    void Splat();
+    // darkens the dirty tiles of the view, the view is at (iScreenX, iScreenY) of the screen
+    void Blend(CogeImage* pScreen, int iScreenX, int iScreenY);
+
+    // the dirty tiles (in the view)
+    void MarkAll();
+    void MarkRect(int x, int y, int iWidth, int iHeight);
+    const std::vector<CogeRect>& GetRegions();
+
+    // drops the cached cells of the masks and the base
+    void Reset();
+
+    //constructor
+    CogeLightBuffer();
+
+    //destructor
+    ~CogeLightBuffer();
+
+};
+
+// the plain frame draws of the sprites recorded as commands and drawn tile by tile on the fx threads (see OGE_FX_RunBands()),
+// a tile is drawn by one thread only and in the order of the commands, so the result is the same as drawing them one by one
+class CogeTileRenderer
+{
+private:
+
+    struct CogeDrawCommand
+    {
+        CogeImage* pImage;
+        int iType;
+        int iDstX;
+        int iDstY;
+        int iSrcX;
+        int iSrcY;
+        int iWidth;
+        int iHeight;
+    };
+
+    CogeImage*  m_pScreen;
+    uint8_t*    m_pDstData;
+    int         m_iDstLineSize;
+
+    int         m_iAreaX; // the area to draw in (the view) on the screen
+    int         m_iAreaY;
+    int         m_iAreaWidth;
+    int         m_iAreaHeight;
+
+    int         m_iTileSize;
+    int         m_iTileCols;
+    int         m_iTileRows;
+
+    std::vector<CogeDrawCommand>   m_Commands;
+    std::vector< std::vector<int> > m_Bins; // the commands of each tile
+
+    static void DrawTiles(void* pTask, int iFromTile, int iToTile);
+
+public:
+
+    // starts recording the draws on the area of pScreen, the tiles are iTileSize x iTileSize
+    void Begin(CogeImage* pScreen, int iAreaX, int iAreaY, int iAreaWidth, int iAreaHeight, int iTileSize);
+
+    /* records pScreen->Draw(pSrcImage, ...), returns false if the image can not be drawn by the fx kernels
+       (an alpha channel not premultiplied, a surface which must be locked ...), then the caller should
+       Flush() and draw it by itself
+    */
+    bool Add(CogeImage* pSrcImage, int iDstX, int iDstY, int iSrcX, int iSrcY, int iWidth, int iHeight);
+
+    // draws the commands recorded so far, the screen is up to date then
+    void Flush();
+
+    int GetCommandCount();
+
+    //constructor
+    CogeTileRenderer();
+
+    //destructor
+    ~CogeTileRenderer();
 
 };
 
@@ -0,0 +1,1168 @@
+/*
+-----------------------------------------------------------------------------
+This source file is part of Open Game Engine 2D.
+It is licensed under the terms of the MIT license.
+For the latest info, see http://oge2d.sourceforge.net
+
+Copyright (c) 2010-2012 Lin Jia Jun (Joe Lam)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-----------------------------------------------------------------------------
+*/
+
+/*
+   benchmark of the fx kernels on raw pixel buffers (no window), it only needs the fx sources and sdl:
+
+   g++ -O2 -I../../src bench_fx.cpp ../../src/ogeGraphicFX_C.cpp ../../src/ogeGraphicFX_SSE.cpp
+       ../../src/ogeGraphicFX_Thread.cpp ../../src/ogeGraphicFX_Blur.cpp ../../src/ogeGraphicFX_Span.cpp
+       ../../src/ogeGraphicFX_Alpha.cpp ../../src/ogeGraphicFX_Rotate.cpp ../../src/ogeGraphicFX_Wave.cpp
+       ../../src/ogeGraphicFX_LUT.cpp ../../src/ogeGraphicFX_Light.cpp ../../src/ogeGraphicFX_Scale.cpp
+       ../../src/ogeGraphicFX_Present.cpp ../../src/ogeGraphicFX_Convert.cpp ../../src/ogeGraphicFX_Index.cpp
+       `sdl2-config --cflags --libs`
+
+   (or -D__FX_WITH_MMX__ with ../../src/ogeGraphicFX_MMX.cpp instead of the C and SSE files)
+
+   usage: bench_fx [-threads n] [-kernel name] [-ms time] > result.json
+          bench_fx -verify [-kernel name] [-seed n] [-dump dir] [-save file | -baseline file] > result.json
+
+   every kernel runs on each backend available in the build, at 16 and 32 bpp, for a few sizes,
+   with and without color key and with a few alpha values (for the kernels which take them),
+   the result is a json document, one record per case with the time per call and the throughput
+
+   with -verify the kernels run on random inputs (odd sizes included) on each backend and on the threaded path,
+   and the whole dst buffer (the margin around the rect too) is compared with the single thread C output,
+   a case fails if a channel is off by more than the kernel tolerance (0 for most of them, so bit exact),
+   the ref/out/diff images of the failed cases are saved as bmp files in the dump dir,
+   the exit code is the number of failed cases
+
+   the C output itself is checked against a baseline: -save file writes a checksum of the C output of each case
+   (run it on a tree with the kernels known to be good), -baseline file compares the C output with it,
+   so a change of the C kernels shows up too and not only a simd backend which does not follow them
+*/
+
+#include "ogeGraphicFX.h"
+
+#include "SDL.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <vector>
+
+#define _BENCH_MARGIN_      32
+
+#define _BENCH_KEY_         0x01  // runs with and without color key
+#define _BENCH_KEY_ONLY_    0x02  // needs the color key (spans, edge)
+#define _BENCH_ALPHA_       0x04  // runs with a few alpha values
+#define _BENCH_32BPP_ONLY_  0x08
+
+// the light buffer of a case (quarter size, with the margin and a border cell)
+#define _BENCH_LIGHT_LINE_  ((640 + _BENCH_MARGIN_ * 2) / 4 + 2)
+#define _BENCH_LIGHT_ROWS_  ((480 + _BENCH_MARGIN_ * 2) / 4 + 2)
+
+static uint8_t LightCells[_BENCH_LIGHT_LINE_ * _BENCH_LIGHT_ROWS_];
+
+static uint32_t iRandSeed = 20100101;
+
+static uint32_t Rand()
+{
+    iRandSeed = iRandSeed * 1103515245 + 12345;
+    return iRandSeed >> 8;
+}
+
+static double GetTime()
+{
+#if SDL_VERSION_ATLEAST(2,0,0)
+    return (double)SDL_GetPerformanceCounter() * 1000.0 / (double)SDL_GetPerformanceFrequency();
+#else
+    return SDL_GetTicks();
+#endif
+}
+
+// some soft blocks (so the blur has something to work on) with holes of the color key
+static void FillImage(uint8_t* pData, int iLineSize, int iWidth, int iHeight, int iBPP, int iColorKey)
+{
+    for(int y=0; y<iHeight; y++)
+    {
+        for(int x=0; x<iWidth; x++)
+        {
+            int r = ((x >> 4) * 37 + (y >> 4) * 91) & 0xff;
+            int g = ((x >> 3) * 53 + (y >> 5) * 17) & 0xff;
+            int b = (x * y + (Rand() & 0x1f)) & 0xff;
+            int a = (x * 7 + y * 3) & 0xff;
+
+            bool bHole = iColorKey != -1 && (((x >> 3) + (y >> 3)) & 3) == 0;
+
+            if (iBPP == 16)
+                ((uint16_t*)(pData + y * iLineSize))[x] = bHole ? iColorKey : (r >> 3 << 11) | (g >> 2 << 5) | (b >> 3);
+            else
+                ((uint32_t*)(pData + y * iLineSize))[x] = bHole ? iColorKey : (a << 24) | (r << 16) | (g << 8) | b;
+        }
+    }
+}
+
+struct CogeBenchCase
+{
+    int iBPP;
+    int iWidth;
+    int iHeight;
+    int iColorKey;
+    int iAlpha;
+
+    int iLineSize; // of all the buffers, the rect starts at (_BENCH_MARGIN_, _BENCH_MARGIN_)
+
+    uint8_t* pDst;
+    uint8_t* pSrc;
+    uint8_t* pMask;
+    uint8_t* pPremultiplied; // the src premultiplied (32 bpp), a blend of it on invalid data would not be comparable
+    uint8_t* pLight;         // the src downsampled into a light buffer, one cell per 4x4 pixels
+
+    CogeFXSpans* pSpans;
+    CogeFXIndexed* pIndexed; // the src with fewer colors (see BuildBenchIndexed())
+    CogeFXColorTransform* pTransform;
+};
+
+typedef void (*ogeBenchFunc)(CogeBenchCase* c);
+
+struct CogeBenchKernel
+{
+    const char* sName;
+    int iFlags;
+    ogeBenchFunc pRun;
+    int iTolerance; // max difference of a channel from the C output in -verify
+};
+
+#define M _BENCH_MARGIN_
+
+static void RunSetPixel(CogeBenchCase* c)
+{
+    for(int y=M; y<M+c->iHeight; y++)
+    for(int x=M; x<M+c->iWidth; x++)
+    {
+        if (c->iBPP == 16) OGE_FX_SetPixel16(c->pDst, c->iLineSize, x, y, (uint16_t) x);
+        else OGE_FX_SetPixel32(c->pDst, c->iLineSize, x, y, (uint32_t) x);
+    }
+}
+static void RunLine(CogeBenchCase* c)
+{
+    OGE_FX_Line(c->pDst, c->iLineSize, c->iBPP, 0x1234, c->iWidth + M*2 - 1, c->iHeight + M*2 - 1,
+                M, M, M + c->iWidth - 1, M + c->iHeight - 1);
+}
+static void RunCircle(CogeBenchCase* c)
+{
+    OGE_FX_Circle(c->pDst, c->iLineSize, c->iBPP, 0x1234, c->iWidth + M*2 - 1, c->iHeight + M*2 - 1,
+                  M + c->iWidth/2, M + c->iHeight/2, std::min(c->iWidth, c->iHeight)/2);
+}
+static void RunCopyRect(CogeBenchCase* c)
+{
+    OGE_FX_CopyRect(c->pDst, c->iLineSize, M, M, c->pSrc, c->iLineSize, M, M, c->iWidth, c->iHeight, c->iBPP);
+}
+static void RunBlt(CogeBenchCase* c)
+{
+    OGE_FX_Blt(c->pDst, c->iLineSize, M, M, c->pSrc, c->iLineSize, c->iColorKey, M, M, c->iWidth, c->iHeight, c->iBPP);
+}
+static void RunUpdateAlphaBlt(CogeBenchCase* c)
+{
+    OGE_FX_UpdateAlphaBlt(c->pDst, c->iLineSize, M, M, c->pSrc, c->iLineSize, M, M,
+                          c->iWidth, c->iHeight, c->iBPP, 0xff000000, 128);
+}
+static void RunGrayscale(CogeBenchCase* c)
+{
+    OGE_FX_Grayscale(c->pDst, c->iLineSize, M, M, c->iWidth, c->iHeight, c->iBPP);
+}
+static void RunChangeGrayLevel(CogeBenchCase* c)
+{
+    OGE_FX_ChangeGrayLevel(c->pDst, c->iLineSize, M, M, c->iWidth, c->iHeight, c->iBPP, 64);
+}
+static void RunSubLight(CogeBenchCase* c)
+{
+    OGE_FX_SubLight(c->pDst, c->iLineSize, M, M, c->iWidth, c->iHeight, c->iBPP, 32);
+}
+static void RunLightness(CogeBenchCase* c)
+{
+    OGE_FX_Lightness(c->pDst, c->iLineSize, M, M, c->iWidth, c->iHeight, c->iBPP, 48);
+}
+static void RunBltLightness(CogeBenchCase* c)
+{
+    OGE_FX_BltLightness(c->pDst, c->iLineSize, M, M, c->pSrc, c->iLineSize, c->iColorKey, M, M,
+                        c->iWidth, c->iHeight, c->iBPP, 48);
+}
+static void RunChangeColorRGB(CogeBenchCase* c)
+{
+    OGE_FX_ChangeColorRGB(c->pDst, c->iLineSize, M, M, c->iWidth, c->iHeight, c->iBPP, 40, -20, 10);
+}
+static void RunBltChangedRGB(CogeBenchCase* c)
+{
+    OGE_FX_BltChangedRGB(c->pDst, c->iLineSize, M, M, c->pSrc, c->iLineSize, c->iColorKey, M, M,
+                         c->iWidth, c->iHeight, c->iBPP, 40, -20, 10);
+}
+static void RunColorTransform(CogeBenchCase* c)
+{
+    OGE_FX_ColorTransform(c->pDst, c->iLineSize, M, M, c->iWidth, c->iHeight, c->iBPP, c->pTransform);
+}
+static void RunBltColorTransform(CogeBenchCase* c)
+{
+    OGE_FX_BltColorTransform(c->pDst, c->iLineSize, M, M, c->pSrc, c->iLineSize, c->iColorKey, M, M,
+                             c->iWidth, c->iHeight, c->iBPP, c->pTransform);
+}
+static void RunSplitBlur(CogeBenchCase* c)
+{
+    OGE_FX_SplitBlur(c->pDst, c->iLineSize, M, M, c->iWidth, c->iHeight, c->iBPP, 1);
+}
+static void RunGaussianBlur(CogeBenchCase* c)
+{
+    OGE_FX_GaussianBlur(c->pDst, c->iLineSize, M, M, c->iWidth, c->iHeight, c->iBPP, 8);
+}
+static void RunIteratedBlur(CogeBenchCase* c)
+{
+    OGE_FX_IteratedBlur(c->pDst, c->iLineSize, M, M, c->iWidth, c->iHeight, c->iBPP, 8);
+}
+static void RunAlphaBlend(CogeBenchCase* c)
+{
+    OGE_FX_AlphaBlend(c->pDst, c->iLineSize, M, M, c->pSrc, c->iLineSize, c->iColorKey, M, M,
+                      c->iWidth, c->iHeight, c->iBPP, (uint8_t) c->iAlpha);
+}
+static void RunLightMaskBlend(CogeBenchCase* c)
+{
+    OGE_FX_LightMaskBlend(c->pDst, c->iLineSize, M, M, c->pSrc, c->iLineSize, M, M, c->iWidth, c->iHeight, c->iBPP);
+}
+static void RunDownsampleLight(CogeBenchCase* c)
+{
+    // the cells go to the dst, the phase is not aligned to the rect on purpose
+    OGE_FX_DownsampleLight(c->pDst, c->iLineSize, c->pSrc, c->iLineSize, M, M, c->iWidth, c->iHeight, c->iBPP, 1, 2, 255);
+}
+static void RunAddLight(CogeBenchCase* c)
+{
+    OGE_FX_AddLight(c->pDst, c->iLineSize, c->iLineSize, c->iHeight + M * 2, M, M,
+                    c->pLight, _BENCH_LIGHT_LINE_, (c->iWidth + 3) / 4, (c->iHeight + 3) / 4);
+}
+static void RunLightBlend(CogeBenchCase* c)
+{
+    OGE_FX_LightBlend(c->pDst, c->iLineSize, M, M, c->iWidth, c->iHeight, c->iBPP,
+                      c->pLight, _BENCH_LIGHT_LINE_, (c->iWidth + M * 2 + 3) / 4, (c->iHeight + M * 2 + 3) / 4, M, M);
+}
+static void RunBltMask(CogeBenchCase* c)
+{
+    OGE_FX_BltMask(c->pDst, c->iLineSize, M, M, c->pSrc, c->iLineSize, M, M, c->pMask, c->iLineSize, M, M,
+                   c->iWidth, c->iHeight, c->iBPP);
+}
+static void RunStretchSmoothly(CogeBenchCase* c)
+{
+    OGE_FX_StretchSmoothly(c->pDst, c->iLineSize, M, M, c->iWidth, c->iHeight,
+                           c->pSrc, c->iLineSize, M, M, c->iWidth/2 + 1, c->iHeight/2 + 1, c->iBPP);
+}
+static void RunBltStretch(CogeBenchCase* c)
+{
+    OGE_FX_BltStretch(c->pDst, c->iLineSize, M, M, c->iWidth, c->iHeight,
+                      c->pSrc, c->iLineSize, c->iColorKey, M, M, c->iWidth/2 + 1, c->iHeight/2 + 1, c->iBPP);
+}
+static void RunBltScaleUp(CogeBenchCase* c)
+{
+    OGE_FX_BltScale(c->pDst, c->iLineSize, M, M, c->iWidth, c->iHeight, 0, 0, c->iWidth, c->iHeight,
+                    c->pSrc, c->iLineSize, c->iColorKey, M, M, c->iWidth / 2 + 1, c->iHeight / 2 + 1, c->iBPP);
+}
+static void RunBltScaleDown(CogeBenchCase* c)
+{
+    // the whole src with its margin, part of the dst rect is clipped
+    OGE_FX_BltScale(c->pDst, c->iLineSize, M / 2, M / 2, c->iWidth, c->iHeight, M / 2, 0, c->iWidth, c->iHeight,
+                    c->pSrc, c->iLineSize, c->iColorKey, 0, 0, c->iWidth + M * 2, c->iHeight + M * 2, c->iBPP);
+}
+static void RunPresentNearest(CogeBenchCase* c)
+{
+    // 3x, like 640x360 on 1920x1080
+    OGE_FX_BltPresent(c->pDst, c->iLineSize, M, M, c->iWidth / 3 * 3, c->iHeight / 3 * 3,
+                      c->pSrc, c->iLineSize, M, M, c->iWidth / 3, c->iHeight / 3, c->iBPP, _OGE_FX_PRESENT_NEAREST_);
+}
+static void RunPresentPixelArt(CogeBenchCase* c)
+{
+    OGE_FX_BltPresent(c->pDst, c->iLineSize, M, M, c->iWidth / 3 * 3, c->iHeight / 3 * 3,
+                      c->pSrc, c->iLineSize, M, M, c->iWidth / 3, c->iHeight / 3, c->iBPP, _OGE_FX_PRESENT_PIXELART_);
+}
+static void RunPresentMap(CogeBenchCase* c)
+{
+    OGE_FX_BltPresent(c->pDst, c->iLineSize, M, M, c->iWidth, c->iHeight,
+                      c->pSrc, c->iLineSize, M, M, c->iWidth / 2 + 1, c->iHeight / 2 + 1, c->iBPP, _OGE_FX_PRESENT_NEAREST_);
+}
+static void RunConvertRGBA(CogeBenchCase* c)
+{
+    // the byte order of a png (abgr) to the argb of the screen
+    static const uint32_t iSrcMasks[4] = { 0x000000ff, 0x0000ff00, 0x00ff0000, 0xff000000 };
+    static const uint32_t iDstMasks[4] = { 0x00ff0000, 0x0000ff00, 0x000000ff, 0xff000000 };
+
+    OGE_FX_ConvertPixels(c->pDst + M * c->iLineSize + M * 4, c->iLineSize, 32, iDstMasks,
+                         c->pSrc + M * c->iLineSize + M * 4, c->iLineSize, 32, iSrcMasks, NULL, 0,
+                         c->iWidth, c->iHeight);
+}
+static void RunConvertPalette(CogeBenchCase* c)
+{
+    static const uint32_t iMasks16[4] = { 0xf800, 0x07e0, 0x001f, 0 };
+    static const uint32_t iMasks32[4] = { 0x00ff0000, 0x0000ff00, 0x000000ff, 0 };
+    static const uint32_t iNoMasks[4] = { 0, 0, 0, 0 };
+
+    uint32_t iPalette[256];
+    for(int i=0; i<256; i++) iPalette[i] = 0xff000000 | (i * 0x010305);
+
+    OGE_FX_ConvertPixels(c->pDst + M * c->iLineSize + M * (c->iBPP >> 3), c->iLineSize, c->iBPP,
+                         c->iBPP == 16 ? iMasks16 : iMasks32,
+                         c->pSrc + M * c->iLineSize + M, c->iLineSize, 8, iNoMasks, iPalette, 256,
+                         c->iWidth, c->iHeight);
+}
+static void RunIndexedBlt(CogeBenchCase* c)
+{
+    OGE_FX_IndexedBlt(c->pDst, c->iLineSize, M, M, c->pIndexed, NULL, 0, 0, c->iWidth, c->iHeight);
+}
+static void RunIndexedAlphaBlend(CogeBenchCase* c)
+{
+    OGE_FX_IndexedAlphaBlend(c->pDst, c->iLineSize, M, M, c->pIndexed, NULL, 0, 0, c->iWidth, c->iHeight, (uint8_t) c->iAlpha);
+}
+static void RunIndexedBltLightness(CogeBenchCase* c)
+{
+    OGE_FX_IndexedBltLightness(c->pDst, c->iLineSize, M, M, c->pIndexed, NULL, 0, 0, c->iWidth, c->iHeight, 48);
+}
+static void RunIndexedBltChangedRGB(CogeBenchCase* c)
+{
+    OGE_FX_IndexedBltChangedRGB(c->pDst, c->iLineSize, M, M, c->pIndexed, NULL, 0, 0, c->iWidth, c->iHeight, 40, -20, 10);
+}
+static void RunIndexedBltWithColor(CogeBenchCase* c)
+{
+    OGE_FX_IndexedBltWithColor(c->pDst, c->iLineSize, M, M, c->pIndexed, NULL, 0, 0, c->iWidth, c->iHeight, 0x1234, c->iAlpha);
+}
+static void RunBltRotate(CogeBenchCase* c)
+{
+    OGE_FX_BltRotate(c->pDst, c->iLineSize, M, M, c->iWidth, c->iHeight,
+                     c->pSrc, c->iLineSize, M, M, c->iWidth, c->iHeight, c->iBPP, c->iColorKey, 30, 65536, false);
+}
+static void RunBltRotateBilinear(CogeBenchCase* c)
+{
+    OGE_FX_BltRotate(c->pDst, c->iLineSize, M, M, c->iWidth, c->iHeight,
+                     c->pSrc, c->iLineSize, M, M, c->iWidth, c->iHeight, c->iBPP, c->iColorKey, 30, 65536, true);
+}
+static void RunBltFused(CogeBenchCase* c)
+{
+    OGE_FX_BltFused(c->pDst, c->iLineSize, c->iWidth + M*2, c->iHeight + M*2, M, M, c->iWidth, c->iHeight,
+                    c->pSrc, c->iLineSize, c->iColorKey, M, M, c->iWidth, c->iHeight, c->iBPP,
+                    30, false, c->pTransform, c->iAlpha);
+}
+static void RunBltSquareWave(CogeBenchCase* c)
+{
+    OGE_FX_BltSquareWave(c->pDst, c->iLineSize, M, M, c->pSrc, c->iLineSize, M, M,
+                         c->iWidth, c->iHeight, c->iBPP, 10, 10, 4);
+}
+static void RunBltRoundWave(CogeBenchCase* c)
+{
+    OGE_FX_BltRoundWave(c->pDst, c->iLineSize, M, M, c->pSrc, c->iLineSize, M, M,
+                        c->iWidth, c->iHeight, c->iBPP, c->iColorKey, 10, 10, 4, 3, 5);
+}
+static void RunBltWithEdge(CogeBenchCase* c)
+{
+    OGE_FX_BltWithEdge(c->pDst, c->iLineSize, M, M, c->pSrc, c->iLineSize, c->iColorKey, M, M,
+                       c->iWidth, c->iHeight, c->iBPP, 0x1234);
+}
+static void RunBltWithColor(CogeBenchCase* c)
+{
+    OGE_FX_BltWithColor(c->pDst, c->iLineSize, M, M, c->pSrc, c->iLineSize, c->iColorKey, M, M,
+                        c->iWidth, c->iHeight, c->iBPP, 0x1234, c->iAlpha);
+}
+static void RunPremultiply(CogeBenchCase* c)
+{
+    OGE_FX_Premultiply(c->pDst, c->iLineSize, M, M, c->iWidth, c->iHeight, c->iBPP, 24);
+}
+static void RunUnpremultiply(CogeBenchCase* c)
+{
+    OGE_FX_Unpremultiply(c->pDst, c->iLineSize, M, M, c->iWidth, c->iHeight, c->iBPP, 24);
+}
+static void RunBltPremultiplied(CogeBenchCase* c)
+{
+    OGE_FX_BltPremultiplied(c->pDst, c->iLineSize, M, M, c->pPremultiplied, c->iLineSize, M, M,
+                            c->iWidth, c->iHeight, c->iBPP, 24, (uint8_t) c->iAlpha);
+}
+static void RunBuildSpans(CogeBenchCase* c)
+{
+    OGE_FX_FreeSpans(OGE_FX_BuildSpans(c->pSrc + M * c->iLineSize + M * (c->iBPP >> 3), c->iLineSize,
+                                       c->iWidth, c->iHeight, c->iBPP, c->iColorKey));
+}
+static void RunUnpackSpans(CogeBenchCase* c)
+{
+    OGE_FX_UnpackSpans(c->pDst + M * c->iLineSize + M * (c->iBPP >> 3), c->iLineSize, c->pSpans, c->iColorKey);
+}
+static void RunSpanBlt(CogeBenchCase* c)
+{
+    OGE_FX_SpanBlt(c->pDst, c->iLineSize, M, M, c->pSpans, 0, 0, c->iWidth, c->iHeight);
+}
+static void RunSpanAlphaBlend(CogeBenchCase* c)
+{
+    OGE_FX_SpanAlphaBlend(c->pDst, c->iLineSize, M, M, c->pSpans, 0, 0, c->iWidth, c->iHeight, (uint8_t) c->iAlpha);
+}
+static void RunSpanBltLightness(CogeBenchCase* c)
+{
+    OGE_FX_SpanBltLightness(c->pDst, c->iLineSize, M, M, c->pSpans, 0, 0, c->iWidth, c->iHeight, 48);
+}
+static void RunSpanBltChangedRGB(CogeBenchCase* c)
+{
+    OGE_FX_SpanBltChangedRGB(c->pDst, c->iLineSize, M, M, c->pSpans, 0, 0, c->iWidth, c->iHeight, 40, -20, 10);
+}
+static void RunSpanBltWithColor(CogeBenchCase* c)
+{
+    OGE_FX_SpanBltWithColor(c->pDst, c->iLineSize, M, M, c->pSpans, 0, 0, c->iWidth, c->iHeight, 0x1234, c->iAlpha);
+}
+
+#undef M
+
+static const CogeBenchKernel Kernels[] =
+{
+    {"SetPixel",            0,                  RunSetPixel,             0},
+    {"Line",                0,                  RunLine,                 0},
+    {"Circle",              0,                  RunCircle,               0},
+    {"CopyRect",            0,                  RunCopyRect,             0},
+    {"Blt",                 _BENCH_KEY_,        RunBlt,                  0},
+    {"UpdateAlphaBlt",      _BENCH_32BPP_ONLY_, RunUpdateAlphaBlt,       0},
+    {"Grayscale",           0,                  RunGrayscale,            0},
+    {"ChangeGrayLevel",     0,                  RunChangeGrayLevel,      0},
+    {"SubLight",            0,                  RunSubLight,             0},
+    {"Lightness",           0,                  RunLightness,            0},
+    {"BltLightness",        _BENCH_KEY_,        RunBltLightness,         0},
+    {"ChangeColorRGB",      0,                  RunChangeColorRGB,       0},
+    {"BltChangedRGB",       _BENCH_KEY_,        RunBltChangedRGB,        0},
+    {"ColorTransform",      0,                  RunColorTransform,       0},
+    {"BltColorTransform",   _BENCH_KEY_,        RunBltColorTransform,    0},
+    {"SplitBlur",           0,                  RunSplitBlur,            0},
+    {"GaussianBlur",        0,                  RunGaussianBlur,         0},
+    {"IteratedBlur",        0,                  RunIteratedBlur,         0},
+    {"AlphaBlend",          _BENCH_KEY_ | _BENCH_ALPHA_, RunAlphaBlend, 0},
+    {"LightMaskBlend",      0,                  RunLightMaskBlend,       0},
+    {"DownsampleLight",     0,                  RunDownsampleLight,      0},
+    {"AddLight",            0,                  RunAddLight,             0},
+    {"LightBlend",          0,                  RunLightBlend,           0},
+    {"BltMask",             0,                  RunBltMask,              0},
+    {"StretchSmoothly",     0,                  RunStretchSmoothly,      0},
+    {"BltStretch",          _BENCH_KEY_,        RunBltStretch,           0},
+    {"BltScaleUp",          _BENCH_KEY_,        RunBltScaleUp,           0},
+    {"BltScaleDown",        _BENCH_KEY_,        RunBltScaleDown,         0},
+    {"PresentNearest",      0,                  RunPresentNearest,       0},
+    {"PresentPixelArt",     0,                  RunPresentPixelArt,      0},
+    {"PresentMap",          0,                  RunPresentMap,           0},
+    {"ConvertRGBA",         _BENCH_32BPP_ONLY_, RunConvertRGBA,          0},
+    {"ConvertPalette",      0,                  RunConvertPalette,       0},
+    {"BltRotate",           _BENCH_KEY_,        RunBltRotate,            0},
+    {"BltRotateBilinear",   _BENCH_KEY_,        RunBltRotateBilinear,    0},
+    {"BltFused",            _BENCH_KEY_ | _BENCH_ALPHA_, RunBltFused, 0},
+    {"BltSquareWave",       0,                  RunBltSquareWave,        0},
+    {"BltRoundWave",        _BENCH_KEY_,        RunBltRoundWave,         0},
+    {"BltWithEdge",         _BENCH_KEY_ONLY_,   RunBltWithEdge,          0},
+    {"BltWithColor",        _BENCH_KEY_ | _BENCH_ALPHA_, RunBltWithColor, 0},
+    {"Premultiply",         _BENCH_32BPP_ONLY_, RunPremultiply,          0},
+    {"Unpremultiply",       _BENCH_32BPP_ONLY_, RunUnpremultiply,        0},
+    {"BltPremultiplied",    _BENCH_32BPP_ONLY_ | _BENCH_ALPHA_, RunBltPremultiplied, 0},
+    {"BuildSpans",          _BENCH_KEY_ONLY_,   RunBuildSpans,           0},
+    {"UnpackSpans",         _BENCH_KEY_ONLY_,   RunUnpackSpans,          0},
+    {"SpanBlt",             _BENCH_KEY_ONLY_,   RunSpanBlt,              0},
+    {"SpanAlphaBlend",      _BENCH_KEY_ONLY_ | _BENCH_ALPHA_, RunSpanAlphaBlend, 0},
+    {"SpanBltLightness",    _BENCH_KEY_ONLY_,   RunSpanBltLightness,     0},
+    {"SpanBltChangedRGB",   _BENCH_KEY_ONLY_,   RunSpanBltChangedRGB,    0},
+    {"SpanBltWithColor",    _BENCH_KEY_ONLY_ | _BENCH_ALPHA_, RunSpanBltWithColor, 0},
+    {"IndexedBlt",          _BENCH_KEY_,        RunIndexedBlt,           0},
+    {"IndexedAlphaBlend",   _BENCH_KEY_ | _BENCH_ALPHA_, RunIndexedAlphaBlend, 0},
+    {"IndexedBltLightness", _BENCH_KEY_,        RunIndexedBltLightness,  0},
+    {"IndexedBltChangedRGB", _BENCH_KEY_,       RunIndexedBltChangedRGB, 0},
+    {"IndexedBltWithColor", _BENCH_KEY_ | _BENCH_ALPHA_, RunIndexedBltWithColor, 0},
+};
+
+static const char* BackendNames[] = {"c", "mmx", "sse2", "avx2"};
+
+static const int Sizes[][2] = { {32, 32}, {128, 128}, {640, 480} };
+
+static const int Alphas[] = {64, 128, 255};
+
+// ns per call, the dst is restored before each batch (out of the timing) so the in-place kernels do not drift
+static double TimeKernel(const CogeBenchKernel* pKernel, CogeBenchCase* c, uint8_t* pDstBackup, int iBufferSize,
+                         double fMinTime)
+{
+    int iBatch = 1;
+    double fBatchTime = 0;
+
+    // one warm up call, then a batch long enough for the timer
+    memcpy(c->pDst, pDstBackup, iBufferSize);
+    pKernel->pRun(c);
+
+    while (true)
+    {
+        memcpy(c->pDst, pDstBackup, iBufferSize);
+
+        double fStart = GetTime();
+        for(int i=0; i<iBatch; i++) pKernel->pRun(c);
+        fBatchTime = GetTime() - fStart;
+
+        if (fBatchTime >= 2 || iBatch >= (1 << 20)) break;
+        iBatch *= 2;
+    }
+
+    int iCalls = iBatch;
+    double fTotal = fBatchTime;
+
+    while (fTotal < fMinTime)
+    {
+        memcpy(c->pDst, pDstBackup, iBufferSize);
+
+        double fStart = GetTime();
+        for(int i=0; i<iBatch; i++) pKernel->pRun(c);
+        fTotal += GetTime() - fStart;
+
+        iCalls += iBatch;
+    }
+
+    return fTotal * 1000000.0 / iCalls;
+}
+
+// pixels touched by one call
+static double GetKernelPixels(const CogeBenchKernel* pKernel, CogeBenchCase* c)
+{
+    if (pKernel->pRun == RunLine) return std::max(c->iWidth, c->iHeight);
+    if (pKernel->pRun == RunCircle) return 2 * 3.14159265 * (std::min(c->iWidth, c->iHeight)/2);
+    return (double) c->iWidth * c->iHeight;
+}
+
+static bool IsKernelCase(const CogeBenchKernel* pKernel, CogeBenchCase* c, const char* sKernel)
+{
+    if (sKernel && strcmp(sKernel, pKernel->sName) != 0) return false;
+    if ((pKernel->iFlags & _BENCH_32BPP_ONLY_) && c->iBPP != 32) return false;
+    if ((pKernel->iFlags & _BENCH_KEY_ONLY_) && c->iColorKey == -1) return false;
+    if (!(pKernel->iFlags & (_BENCH_KEY_ | _BENCH_KEY_ONLY_)) && c->iColorKey != -1) return false;
+    return true;
+}
+
+// the rect of the src cut down to 128 colors (and the color key) so it can be indexed
+static CogeFXIndexed* BuildBenchIndexed(uint8_t* pSrc, int iLineSize, int iWidth, int iHeight, int iBPP, int iColorKey)
+{
+    uint32_t iMask = iBPP == 16 ? 0xe618 : 0xe0c0c0;
+    int iRowSize = iWidth * (iBPP >> 3);
+
+    uint8_t* pPixels = new uint8_t[iRowSize * iHeight];
+
+    for(int y=0; y<iHeight; y++)
+    {
+        uint8_t* s = pSrc + (y + _BENCH_MARGIN_) * iLineSize + _BENCH_MARGIN_ * (iBPP >> 3);
+        uint8_t* d = pPixels + y * iRowSize;
+
+        for(int x=0; x<iWidth; x++)
+        {
+            if (iBPP == 16)
+            {
+                uint16_t iPixel = ((uint16_t*)s)[x];
+                ((uint16_t*)d)[x] = (int)iPixel == iColorKey ? iPixel : (uint16_t)(iPixel & iMask);
+            }
+            else
+            {
+                uint32_t iPixel = ((uint32_t*)s)[x];
+                ((uint32_t*)d)[x] = (int)iPixel == iColorKey ? iPixel : (iPixel & iMask);
+            }
+        }
+    }
+
+    CogeFXIndexed* pIndexed = OGE_FX_BuildIndexed(pPixels, iRowSize, iWidth, iHeight, iBPP, iColorKey);
+
+    delete [] pPixels;
+
+    return pIndexed;
+}
+
+// fills the inputs of a case, the buffers are big enough for the largest size with its margin
+static void SetupCase(CogeBenchCase* c, int iBPP, int iWidth, int iHeight, bool bColorKey,
+                      uint8_t* pDst, uint8_t* pDstBackup, uint8_t* pSrc, uint8_t* pMask, uint8_t* pPremultiplied,
+                      CogeFXColorTransform* pTransform)
+{
+    c->iBPP = iBPP;
+    c->iWidth = iWidth;
+    c->iHeight = iHeight;
+    c->iColorKey = bColorKey ? (iBPP == 16 ? 0xf81f : 0xff00ff) : -1;
+    c->iAlpha = 255;
+    c->iLineSize = (iWidth + _BENCH_MARGIN_ * 2) * (iBPP >> 3);
+    c->pDst = pDst;
+    c->pSrc = pSrc;
+    c->pMask = pMask;
+    c->pPremultiplied = pPremultiplied;
+    c->pLight = LightCells;
+    c->pTransform = pTransform;
+
+    FillImage(pDstBackup, c->iLineSize, iWidth + _BENCH_MARGIN_ * 2, iHeight + _BENCH_MARGIN_ * 2, iBPP, -1);
+    FillImage(pSrc, c->iLineSize, iWidth + _BENCH_MARGIN_ * 2, iHeight + _BENCH_MARGIN_ * 2, iBPP, c->iColorKey);
+    FillImage(pMask, c->iLineSize, iWidth + _BENCH_MARGIN_ * 2, iHeight + _BENCH_MARGIN_ * 2, iBPP, -1);
+
+    memcpy(pPremultiplied, pSrc, c->iLineSize * (iHeight + _BENCH_MARGIN_ * 2));
+    OGE_FX_Premultiply(pPremultiplied, c->iLineSize, 0, 0, iWidth + _BENCH_MARGIN_ * 2, iHeight + _BENCH_MARGIN_ * 2, iBPP, 24);
+
+    OGE_FX_DownsampleLight(LightCells, _BENCH_LIGHT_LINE_, pSrc, c->iLineSize, 0, 0,
+                           iWidth + _BENCH_MARGIN_ * 2, iHeight + _BENCH_MARGIN_ * 2, iBPP, 0, 0, 255);
+
+    c->pSpans = c->iColorKey == -1 ? NULL :
+        OGE_FX_BuildSpans(pSrc + _BENCH_MARGIN_ * c->iLineSize + _BENCH_MARGIN_ * (iBPP >> 3), c->iLineSize,
+                          iWidth, iHeight, iBPP, c->iColorKey);
+
+    c->pIndexed = BuildBenchIndexed(pSrc, c->iLineSize, iWidth, iHeight, iBPP, c->iColorKey);
+}
+
+static int RunBenchmark(const char* sKernel, double fMinTime,
+                        uint8_t* pDst, uint8_t* pDstBackup, uint8_t* pSrc, uint8_t* pMask, uint8_t* pPremultiplied,
+                        CogeFXColorTransform* pTransform)
+{
+    int iBestBackend = OGE_FX_GetBestBackend();
+
+    printf("{\n  \"best_backend\": \"%s\",\n  \"threads\": %d,\n  \"results\": [", BackendNames[iBestBackend], OGE_FX_GetThreads());
+
+    int iCount = 0;
+
+    for(int iBackend=_OGE_FX_BACKEND_C_; iBackend<=iBestBackend; iBackend++)
+    {
+        // the ones out of the build fall back to another one
+        if (OGE_FX_SetBackend(iBackend) != iBackend) continue;
+
+        for(int iBPP=16; iBPP<=32; iBPP+=16)
+        {
+            for(size_t s=0; s<sizeof(Sizes)/sizeof(Sizes[0]); s++)
+            {
+                for(int k=0; k<2; k++)
+                {
+                    CogeBenchCase c;
+
+                    SetupCase(&c, iBPP, Sizes[s][0], Sizes[s][1], k != 0, pDst, pDstBackup, pSrc, pMask, pPremultiplied, pTransform);
+
+                    for(size_t i=0; i<sizeof(Kernels)/sizeof(Kernels[0]); i++)
+                    {
+                        const CogeBenchKernel* pKernel = &Kernels[i];
+
+                        if (!IsKernelCase(pKernel, &c, sKernel)) continue;
+
+                        int iAlphaCount = (pKernel->iFlags & _BENCH_ALPHA_) ? sizeof(Alphas)/sizeof(Alphas[0]) : 1;
+
+                        for(int a=0; a<iAlphaCount; a++)
+                        {
+                            c.iAlpha = (pKernel->iFlags & _BENCH_ALPHA_) ? Alphas[a] : 255;
+
+                            fprintf(stderr, "%s %s %d bpp %dx%d key %d alpha %d\n", pKernel->sName, BackendNames[iBackend],
+                                    iBPP, c.iWidth, c.iHeight, c.iColorKey != -1, c.iAlpha);
+
+                            double fTime = TimeKernel(pKernel, &c, pDstBackup, c.iLineSize * (c.iHeight + _BENCH_MARGIN_ * 2), fMinTime);
+                            double fPixels = GetKernelPixels(pKernel, &c);
+
+                            printf("%s\n    {\"kernel\": \"%s\", \"backend\": \"%s\", \"bpp\": %d, \"width\": %d, \"height\": %d, "
+                                   "\"color_key\": %s, \"alpha\": %d, \"ns_per_call\": %.1f, \"mpixels_per_s\": %.2f}",
+                                   iCount > 0 ? "," : "", pKernel->sName, BackendNames[iBackend], iBPP, c.iWidth, c.iHeight,
+                                   c.iColorKey != -1 ? "true" : "false", (pKernel->iFlags & _BENCH_ALPHA_) ? c.iAlpha : -1,
+                                   fTime, fTime > 0 ? fPixels * 1000.0 / fTime : 0);
+
+                            iCount++;
+                        }
+                    }
+
+                    if (c.pSpans) OGE_FX_FreeSpans(c.pSpans);
+                    if (c.pIndexed) OGE_FX_FreeIndexed(c.pIndexed);
+                }
+            }
+        }
+    }
+
+    printf("\n  ]\n}\n");
+
+    return 0;
+}
+
+// odd sizes so the simd tails and the thread bands are not always aligned
+static const int VerifySizes[][2] = { {37, 29}, {203, 131}, {640, 480} };
+
+static void GetPixelRGBA(const uint8_t* pLine, int x, int iBPP, int* pRGBA)
+{
+    if (iBPP == 16)
+    {
+        uint16_t iPixel = ((const uint16_t*)pLine)[x];
+        pRGBA[0] = (iPixel >> 11) & 0x1f;
+        pRGBA[1] = (iPixel >> 5) & 0x3f;
+        pRGBA[2] = iPixel & 0x1f;
+        pRGBA[3] = 0;
+    }
+    else
+    {
+        uint32_t iPixel = ((const uint32_t*)pLine)[x];
+        pRGBA[0] = (iPixel >> 16) & 0xff;
+        pRGBA[1] = (iPixel >> 8) & 0xff;
+        pRGBA[2] = iPixel & 0xff;
+        pRGBA[3] = iPixel >> 24;
+    }
+}
+
+// returns the number of pixels with a channel off by more than iTolerance
+static int ComparePixels(const uint8_t* pRef, const uint8_t* pOut, int iLineSize, int iWidth, int iHeight, int iBPP,
+                         int iTolerance, int* pMaxDiff)
+{
+    int iBadPixels = 0;
+    int iRef[4], iOut[4];
+
+    *pMaxDiff = 0;
+
+    for(int y=0; y<iHeight; y++)
+    {
+        const uint8_t* pRefLine = pRef + y * iLineSize;
+        const uint8_t* pOutLine = pOut + y * iLineSize;
+
+        if (memcmp(pRefLine, pOutLine, iWidth * (iBPP >> 3)) == 0) continue;
+
+        for(int x=0; x<iWidth; x++)
+        {
+            GetPixelRGBA(pRefLine, x, iBPP, iRef);
+            GetPixelRGBA(pOutLine, x, iBPP, iOut);
+
+            int iDiff = 0;
+            for(int i=0; i<4; i++) iDiff = std::max(iDiff, abs(iRef[i] - iOut[i]));
+
+            if (iDiff > *pMaxDiff) *pMaxDiff = iDiff;
+            if (iDiff > iTolerance) iBadPixels++;
+        }
+    }
+
+    return iBadPixels;
+}
+
+// 24 bit bmp, the diff image has the differences of the channels scaled up (red for alpha only ones)
+static bool SaveImage(const char* sFileName, const uint8_t* pData, const uint8_t* pRef, int iLineSize,
+                      int iWidth, int iHeight, int iBPP, int iTolerance)
+{
+    FILE* f = fopen(sFileName, "wb");
+    if (!f) return false;
+
+    int iRowSize = (iWidth * 3 + 3) & ~3;
+    int iFileSize = 54 + iRowSize * iHeight;
+
+    uint8_t Header[54];
+    memset(Header, 0, sizeof(Header));
+
+    Header[0] = 'B'; Header[1] = 'M';
+    Header[2] = iFileSize; Header[3] = iFileSize >> 8; Header[4] = iFileSize >> 16; Header[5] = iFileSize >> 24;
+    Header[10] = 54;
+    Header[14] = 40;
+    Header[18] = iWidth; Header[19] = iWidth >> 8; Header[20] = iWidth >> 16; Header[21] = iWidth >> 24;
+    Header[22] = iHeight; Header[23] = iHeight >> 8; Header[24] = iHeight >> 16; Header[25] = iHeight >> 24;
+    Header[26] = 1;
+    Header[28] = 24;
+
+    fwrite(Header, 1, sizeof(Header), f);
+
+    uint8_t* pRow = new uint8_t[iRowSize];
+    memset(pRow, 0, iRowSize);
+
+    int iShift = iBPP == 16 ? 3 : 0;
+    int iPixel[4], iRefPixel[4];
+
+    for(int y=iHeight-1; y>=0; y--)
+    {
+        for(int x=0; x<iWidth; x++)
+        {
+            GetPixelRGBA(pData + y * iLineSize, x, iBPP, iPixel);
+
+            int r = iPixel[0] << iShift;
+            int g = iPixel[1] << (iBPP == 16 ? 2 : 0);
+            int b = iPixel[2] << iShift;
+
+            if (pRef)
+            {
+                GetPixelRGBA(pRef + y * iLineSize, x, iBPP, iRefPixel);
+
+                int iDiff = 0;
+                for(int i=0; i<4; i++) iDiff = std::max(iDiff, abs(iRefPixel[i] - iPixel[i]));
+
+                r = g = b = 0;
+
+                if (iDiff > iTolerance)
+                {
+                    r = std::min(255, std::max(64, abs(iRefPixel[0] - iPixel[0]) * 32));
+                    g = std::min(255, abs(iRefPixel[1] - iPixel[1]) * 32);
+                    b = std::min(255, abs(iRefPixel[2] - iPixel[2]) * 32);
+                }
+            }
+
+            pRow[x*3] = b;
+            pRow[x*3+1] = g;
+            pRow[x*3+2] = r;
+        }
+
+        fwrite(pRow, 1, iRowSize, f);
+    }
+
+    delete[] pRow;
+
+    fclose(f);
+
+    return true;
+}
+
+struct CogeVerifyConfig
+{
+    int iBackend;
+    int iThreads;
+};
+
+struct CogeBaselineRecord
+{
+    char sKernel[64];
+    int iBPP;
+    int iWidth;
+    int iHeight;
+    int iColorKey;
+    int iAlpha;
+    uint32_t iHash;
+};
+
+// fnv-1a of the whole dst buffer (the margin too)
+static uint32_t HashPixels(const uint8_t* pData, int iLineSize, int iWidth, int iHeight, int iBPP)
+{
+    uint32_t iHash = 2166136261u;
+
+    for(int y=0; y<iHeight; y++)
+    {
+        const uint8_t* pLine = pData + y * iLineSize;
+
+        for(int i=0; i<iWidth * (iBPP >> 3); i++)
+        {
+            iHash ^= pLine[i];
+            iHash *= 16777619u;
+        }
+    }
+
+    return iHash;
+}
+
+// one line per case: kernel bpp width height key alpha hash, after a first line with the seed
+static bool LoadBaseline(const char* sFileName, uint32_t iSeed, std::vector<CogeBaselineRecord>& Records)
+{
+    FILE* f = fopen(sFileName, "r");
+    if (!f) return false;
+
+    unsigned int iFileSeed = 0;
+
+    if (fscanf(f, "seed %u", &iFileSeed) != 1 || iFileSeed != iSeed)
+    {
+        fprintf(stderr, "the baseline %s was not saved with the seed %u\n", sFileName, iSeed);
+        fclose(f);
+        return false;
+    }
+
+    CogeBaselineRecord r;
+    unsigned int iHash = 0;
+
+    while (fscanf(f, "%63s %d %d %d %d %d %x", r.sKernel, &r.iBPP, &r.iWidth, &r.iHeight,
+                  &r.iColorKey, &r.iAlpha, &iHash) == 7)
+    {
+        r.iHash = iHash;
+        Records.push_back(r);
+    }
+
+    fclose(f);
+
+    return true;
+}
+
+static const CogeBaselineRecord* FindBaseline(const std::vector<CogeBaselineRecord>& Records, const char* sKernel,
+                                              const CogeBenchCase* c)
+{
+    for(size_t i=0; i<Records.size(); i++)
+    {
+        const CogeBaselineRecord* r = &Records[i];
+        if (r->iBPP == c->iBPP && r->iWidth == c->iWidth && r->iHeight == c->iHeight &&
+            r->iColorKey == (c->iColorKey != -1) && r->iAlpha == c->iAlpha && strcmp(r->sKernel, sKernel) == 0) return r;
+    }
+
+    return NULL;
+}
+
+static int RunVerify(const char* sKernel, uint32_t iSeed, const char* sDumpPath,
+                     const char* sSavePath, const char* sBaselinePath, uint8_t* pDst, uint8_t* pDstBackup, uint8_t* pSrc, uint8_t* pMask, uint8_t* pPremultiplied,
+                     CogeFXColorTransform* pTransform)
+{
+    CogeVerifyConfig Configs[8];
+    int iConfigCount = 0;
+
+    // the reference is the single thread C output, then each simd backend, then the threaded path on the best one
+    int iBestBackend = OGE_FX_GetBestBackend();
+
+    for(int iBackend=_OGE_FX_BACKEND_C_; iBackend<=iBestBackend; iBackend++)
+    {
+        if (OGE_FX_SetBackend(iBackend) != iBackend) continue;
+        Configs[iConfigCount].iBackend = iBackend;
+        Configs[iConfigCount].iThreads = 1;
+        iConfigCount++;
+    }
+
+    if (iConfigCount == 0) return 1;
+
+    std::vector<CogeBaselineRecord> Baseline;
+
+    if (sBaselinePath && !LoadBaseline(sBaselinePath, iSeed, Baseline))
+    {
+        fprintf(stderr, "cannot load the baseline %s\n", sBaselinePath);
+        return 1;
+    }
+
+    FILE* pSaveFile = NULL;
+
+    if (sSavePath)
+    {
+        pSaveFile = fopen(sSavePath, "w");
+        if (!pSaveFile)
+        {
+            fprintf(stderr, "cannot create the baseline %s\n", sSavePath);
+            return 1;
+        }
+
+        fprintf(pSaveFile, "seed %u\n", iSeed);
+    }
+
+    Configs[iConfigCount].iBackend = Configs[iConfigCount-1].iBackend;
+    Configs[iConfigCount].iThreads = 4;
+    iConfigCount++;
+
+    int iBufferSize = (VerifySizes[sizeof(VerifySizes)/sizeof(VerifySizes[0]) - 1][0] + _BENCH_MARGIN_ * 2) *
+                      (VerifySizes[sizeof(VerifySizes)/sizeof(VerifySizes[0]) - 1][1] + _BENCH_MARGIN_ * 2) * 4;
+
+    uint8_t* pRef = new uint8_t[iBufferSize];
+
+    printf("{\n  \"reference\": \"%s\",\n  \"seed\": %u,\n  \"results\": [", BackendNames[Configs[0].iBackend], iSeed);
+
+    int iCount = 0;
+    int iFailures = 0;
+    int iMissing = 0;
+
+    for(int iBPP=16; iBPP<=32; iBPP+=16)
+    {
+        for(size_t s=0; s<sizeof(VerifySizes)/sizeof(VerifySizes[0]); s++)
+        {
+            for(int k=0; k<2; k++)
+            {
+                CogeBenchCase c;
+
+                iRandSeed = iSeed + iBPP * 1000 + s * 10 + k;
+
+                SetupCase(&c, iBPP, VerifySizes[s][0], VerifySizes[s][1], k != 0, pDst, pDstBackup, pSrc, pMask, pPremultiplied, pTransform);
+
+                int iWidth = c.iWidth + _BENCH_MARGIN_ * 2;
+                int iHeight = c.iHeight + _BENCH_MARGIN_ * 2;
+                int iSize = c.iLineSize * iHeight;
+
+                for(size_t i=0; i<sizeof(Kernels)/sizeof(Kernels[0]); i++)
+                {
+                    const CogeBenchKernel* pKernel = &Kernels[i];
+
+                    // it writes nothing, UnpackSpans covers what it builds
+                    if (pKernel->pRun == RunBuildSpans) continue;
+
+                    if (!IsKernelCase(pKernel, &c, sKernel)) continue;
+
+                    int iAlphaCount = (pKernel->iFlags & _BENCH_ALPHA_) ? sizeof(Alphas)/sizeof(Alphas[0]) : 1;
+
+                    for(int a=0; a<iAlphaCount; a++)
+                    {
+                        c.iAlpha = (pKernel->iFlags & _BENCH_ALPHA_) ? Alphas[a] : 255;
+
+                        for(int n=0; n<iConfigCount; n++)
+                        {
+                            OGE_FX_SetBackend(Configs[n].iBackend);
+                            OGE_FX_SetThreads(Configs[n].iThreads, 1);
+
+                            memcpy(pDst, pDstBackup, iSize);
+                            pKernel->pRun(&c);
+
+                            if (n == 0)
+                            {
+                                memcpy(pRef, pDst, iSize);
+
+                                uint32_t iHash = HashPixels(pDst, c.iLineSize, iWidth, iHeight, iBPP);
+
+                                if (pSaveFile)
+                                    fprintf(pSaveFile, "%s %d %d %d %d %d %08x\n", pKernel->sName, iBPP, c.iWidth,
+                                            c.iHeight, c.iColorKey != -1, c.iAlpha, iHash);
+
+                                if (!sBaselinePath) continue;
+
+                                const CogeBaselineRecord* r = FindBaseline(Baseline, pKernel->sName, &c);
+                                if (!r)
+                                {
+                                    iMissing++;
+                                    continue;
+                                }
+
+                                // only a checksum is saved, so the C output must be bit exact with the baseline
+                                bool bPassed = r->iHash == iHash;
+
+                                printf("%s\n    {\"kernel\": \"%s\", \"backend\": \"baseline\", \"threads\": 1, \"bpp\": %d, "
+                                       "\"width\": %d, \"height\": %d, \"color_key\": %s, \"alpha\": %d, "
+                                       "\"hash\": \"%08x\", \"baseline_hash\": \"%08x\", \"passed\": %s}",
+                                       iCount > 0 ? "," : "", pKernel->sName, iBPP, c.iWidth, c.iHeight,
+                                       c.iColorKey != -1 ? "true" : "false",
+                                       (pKernel->iFlags & _BENCH_ALPHA_) ? c.iAlpha : -1,
+                                       iHash, r->iHash, bPassed ? "true" : "false");
+
+                                iCount++;
+
+                                if (bPassed) continue;
+
+                                iFailures++;
+
+                                fprintf(stderr, "FAILED: %s c against the baseline %d bpp %dx%d key %d alpha %d: %08x, was %08x\n",
+                                        pKernel->sName, iBPP, c.iWidth, c.iHeight, c.iColorKey != -1, c.iAlpha,
+                                        iHash, r->iHash);
+
+                                continue;
+                            }
+
+                            int iMaxDiff = 0;
+                            int iBadPixels = ComparePixels(pRef, pDst, c.iLineSize, iWidth, iHeight, iBPP,
+                                                           pKernel->iTolerance, &iMaxDiff);
+
+                            printf("%s\n    {\"kernel\": \"%s\", \"backend\": \"%s\", \"threads\": %d, \"bpp\": %d, "
+                                   "\"width\": %d, \"height\": %d, \"color_key\": %s, \"alpha\": %d, "
+                                   "\"tolerance\": %d, \"max_diff\": %d, \"bad_pixels\": %d, \"passed\": %s}",
+                                   iCount > 0 ? "," : "", pKernel->sName, BackendNames[Configs[n].iBackend],
+                                   OGE_FX_GetThreads(), iBPP, c.iWidth, c.iHeight, c.iColorKey != -1 ? "true" : "false",
+                                   (pKernel->iFlags & _BENCH_ALPHA_) ? c.iAlpha : -1, pKernel->iTolerance,
+                                   iMaxDiff, iBadPixels, iBadPixels == 0 ? "true" : "false");
+
+                            iCount++;
+
+                            if (iBadPixels == 0) continue;
+
+                            iFailures++;
+
+                            fprintf(stderr, "FAILED: %s %s (%d threads) %d bpp %dx%d key %d alpha %d: %d pixels, max diff %d\n",
+                                    pKernel->sName, BackendNames[Configs[n].iBackend], OGE_FX_GetThreads(), iBPP,
+                                    c.iWidth, c.iHeight, c.iColorKey != -1, c.iAlpha, iBadPixels, iMaxDiff);
+
+                            if (sDumpPath)
+                            {
+                                char sFileName[1024];
+                                const char* sImages[] = {"ref", "out", "diff"};
+
+                                for(int m=0; m<3; m++)
+                                {
+                                    snprintf(sFileName, sizeof(sFileName), "%s/%s_%s_t%d_%d_%dx%d_k%d_a%d_%s.bmp",
+                                             sDumpPath, pKernel->sName, BackendNames[Configs[n].iBackend],
+                                             OGE_FX_GetThreads(), iBPP, c.iWidth, c.iHeight, c.iColorKey != -1,
+                                             c.iAlpha, sImages[m]);
+
+                                    SaveImage(sFileName, m == 0 ? pRef : pDst, m == 2 ? pRef : NULL, c.iLineSize,
+                                              iWidth, iHeight, iBPP, pKernel->iTolerance);
+                                }
+                            }
+                        }
+                    }
+                }
+
+                if (c.pSpans) OGE_FX_FreeSpans(c.pSpans);
+                if (c.pIndexed) OGE_FX_FreeIndexed(c.pIndexed);
+            }
+        }
+    }
+
+    printf("\n  ],\n  \"failures\": %d\n}\n", iFailures);
+
+    fprintf(stderr, "%d cases, %d failed\n", iCount, iFailures);
+
+    if (iMissing > 0) fprintf(stderr, "%d cases not in the baseline\n", iMissing);
+
+    if (pSaveFile) fclose(pSaveFile);
+
+    delete[] pRef;
+
+    OGE_FX_SetThreads(0, 0);
+    OGE_FX_SetBackend(iBestBackend);
+
+    return iFailures;
+}
+
+int main(int argc, char** argv)
+{
+    int iThreads = 0;
+    const char* sKernel = NULL;
+    double fMinTime = 50;
+    bool bVerify = false;
+    uint32_t iSeed = 20100101;
+    const char* sDumpPath = NULL;
+    const char* sSavePath = NULL;
+    const char* sBaselinePath = NULL;
+
+    for(int i=1; i<argc; i++)
+    {
+        if (strcmp(argv[i], "-threads") == 0 && i+1 < argc) iThreads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-kernel") == 0 && i+1 < argc) sKernel = argv[++i];
+        else if (strcmp(argv[i], "-ms") == 0 && i+1 < argc) fMinTime = atof(argv[++i]);
+        else if (strcmp(argv[i], "-verify") == 0) bVerify = true;
+        else if (strcmp(argv[i], "-seed") == 0 && i+1 < argc) iSeed = strtoul(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "-dump") == 0 && i+1 < argc) sDumpPath = argv[++i];
+        else if (strcmp(argv[i], "-save") == 0 && i+1 < argc) sSavePath = argv[++i];
+        else if (strcmp(argv[i], "-baseline") == 0 && i+1 < argc) sBaselinePath = argv[++i];
+        else
+        {
+            fprintf(stderr, "usage: bench_fx [-threads n] [-kernel name] [-ms time] > result.json\n"
+                            "       bench_fx -verify [-kernel name] [-seed n] [-dump dir] [-save file | -baseline file] > result.json\n");
+            return 1;
+        }
+    }
+
+    if (SDL_Init(0) < 0)
+    {
+        fprintf(stderr, "SDL_Init() failed: %s\n", SDL_GetError());
+        return 1;
+    }
+
+    OGE_FX_Init();
+
+    if (iThreads != 0) OGE_FX_SetThreads(iThreads, 0);
+
+    int iMaxWidth = std::max(Sizes[sizeof(Sizes)/sizeof(Sizes[0]) - 1][0],
+                             VerifySizes[sizeof(VerifySizes)/sizeof(VerifySizes[0]) - 1][0]) + _BENCH_MARGIN_ * 2;
+    int iMaxHeight = std::max(Sizes[sizeof(Sizes)/sizeof(Sizes[0]) - 1][1],
+                              VerifySizes[sizeof(VerifySizes)/sizeof(VerifySizes[0]) - 1][1]) + _BENCH_MARGIN_ * 2;
+    int iBufferSize = iMaxWidth * iMaxHeight * 4;
+
+    uint8_t* pDst = new uint8_t[iBufferSize];
+    uint8_t* pDstBackup = new uint8_t[iBufferSize];
+    uint8_t* pSrc = new uint8_t[iBufferSize];
+    uint8_t* pMask = new uint8_t[iBufferSize];
+    uint8_t* pPremultiplied = new uint8_t[iBufferSize];
+
+    CogeFXColorTransform* pTransform = OGE_FX_NewColorTransform();
+    OGE_FX_AddColorAdjustment(pTransform, _OGE_FX_COLOR_LIGHTNESS_, 40);
+    OGE_FX_AddColorAdjustment(pTransform, _OGE_FX_COLOR_RGB_, 20, -10, 0);
+
+    int iResult = 0;
+
+    if (bVerify) iResult = RunVerify(sKernel, iSeed, sDumpPath, sSavePath, sBaselinePath, pDst, pDstBackup, pSrc, pMask, pPremultiplied, pTransform);
+    else iResult = RunBenchmark(sKernel, fMinTime, pDst, pDstBackup, pSrc, pMask, pPremultiplied, pTransform);
+
+    OGE_FX_FreeColorTransform(pTransform);
+
+    delete[] pPremultiplied;
+    delete[] pMask;
+    delete[] pSrc;
+    delete[] pDstBackup;
+    delete[] pDst;
+
+    OGE_FX_SetThreads(0, 0);
+
+    SDL_Quit();
+
+    return iResult;
+}